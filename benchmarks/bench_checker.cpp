@@ -0,0 +1,88 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+/* The passes run over a parsed document: type checking (again), feature
+   checking and signal flow analysis. */
+
+#include "models.h"
+
+#include "utap/featurechecker.h"
+#include "utap/signalflow.h"
+#include "utap/typechecker.h"
+
+using UTAP::Document;
+
+/* Type checks the already checked document again, restoring its diagnostics after each round. */
+static void typeCheck(benchmark::State& state, Document& doc)
+{
+    const auto errors = doc.getErrors();
+    const auto warnings = doc.getWarnings();
+    for (auto _ : state) {
+        auto checker = UTAP::TypeChecker{doc};
+        doc.accept(checker);
+        doc.setDiagnostics(errors, warnings);
+    }
+}
+
+static void featureCheck(benchmark::State& state, Document& doc)
+{
+    for (auto _ : state) {
+        auto checker = UTAP::FeatureChecker{doc};
+        benchmark::DoNotOptimize(checker.getSupportedMethods());
+    }
+}
+
+static void signalFlow(benchmark::State& state, Document& doc)
+{
+    if (!doc.getDynamicTemplates().empty()) {
+        state.SkipWithError("signal flow does not support dynamic templates");
+        return;
+    }
+    for (auto _ : state) {
+        auto flow = UTAP::SignalFlow{"benchmark", doc};
+        benchmark::DoNotOptimize(flow.getGraph());
+    }
+}
+
+template <void (*pass)(benchmark::State&, Document&)>
+static void synthetic(benchmark::State& state)
+{
+    auto doc = parseModel(generateXTA(state.range(0), state.range(1), state.range(2)));
+    pass(state, *doc);
+    state.SetItemsProcessed(state.range(0) * state.range(1) * state.iterations());
+}
+
+template <void (*pass)(benchmark::State&, Document&)>
+static void model(benchmark::State& state, const std::filesystem::path& path)
+{
+    if (auto doc = parseModel(path))
+        pass(state, *doc);
+    else
+        state.SkipWithError("the model has errors");
+}
+
+BENCHMARK(synthetic<typeCheck>)->Name("BM_TypeChecker")->Apply(syntheticSizes);
+BENCHMARK(synthetic<featureCheck>)->Name("BM_FeatureChecker")->Apply(syntheticSizes);
+BENCHMARK(synthetic<signalFlow>)->Name("BM_SignalFlow")->Apply(syntheticSizes);
+
+[[maybe_unused]] static const int registered = (registerCorpus("BM_TypeChecker", model<typeCheck>),
+                                                registerCorpus("BM_FeatureChecker", model<featureCheck>),
+                                                registerCorpus("BM_SignalFlow", model<signalFlow>), 0);
@@ -0,0 +1,107 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+/* Microbenchmarks of the expression and symbol operations used by the passes,
+   over the edge labels and the names of a synthetic model. */
+
+#include "models.h"
+
+using UTAP::expression_t;
+using UTAP::frame_t;
+using UTAP::symbol_t;
+
+/* The guards and updates of the edges of the model. */
+static std::vector<expression_t> labels(UTAP::Document& doc)
+{
+    auto exprs = std::vector<expression_t>{};
+    for (const auto& templ : doc.getTemplates()) {
+        for (const auto& edge : templ.edges) {
+            if (!edge.guard.empty())
+                exprs.push_back(edge.guard);
+            if (!edge.assign.empty())
+                exprs.push_back(edge.assign);
+        }
+    }
+    return exprs;
+}
+
+static void BM_DeeperClone(benchmark::State& state)
+{
+    auto doc = parseModel(generateXTA(state.range(0), state.range(1), state.range(2)));
+    const auto exprs = labels(*doc);
+    for (auto _ : state)
+        for (const auto& expr : exprs)
+            benchmark::DoNotOptimize(expr.deeperClone());
+    state.SetItemsProcessed(static_cast<int64_t>(exprs.size() * state.iterations()));
+}
+BENCHMARK(BM_DeeperClone)->Apply(syntheticSizes);
+
+static void BM_ToString(benchmark::State& state)
+{
+    auto doc = parseModel(generateXTA(state.range(0), state.range(1), state.range(2)));
+    const auto exprs = labels(*doc);
+    auto text = std::string{};
+    for (auto _ : state) {
+        for (const auto& expr : exprs) {
+            text.clear();
+            expr.toString(text);
+            benchmark::DoNotOptimize(text.data());
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(exprs.size() * state.iterations()));
+}
+BENCHMARK(BM_ToString)->Apply(syntheticSizes);
+
+static void BM_Equal(benchmark::State& state)
+{
+    auto doc = parseModel(generateXTA(state.range(0), state.range(1), state.range(2)));
+    const auto exprs = labels(*doc);
+    auto clones = std::vector<expression_t>{};
+    for (const auto& expr : exprs)
+        clones.push_back(expr.deeperClone());
+    for (auto _ : state)
+        for (size_t i = 0; i < exprs.size(); ++i)
+            benchmark::DoNotOptimize(exprs[i].equal(clones[i]));
+    state.SetItemsProcessed(static_cast<int64_t>(exprs.size() * state.iterations()));
+}
+BENCHMARK(BM_Equal)->Apply(syntheticSizes);
+
+/* Resolves every global and template name from every template frame. */
+static void BM_Resolve(benchmark::State& state)
+{
+    auto doc = parseModel(generateXTA(state.range(0), state.range(1), state.range(2)));
+    auto names = std::vector<std::string>{};
+    auto frames = std::vector<frame_t>{};
+    for (const auto& symbol : doc->getGlobals().frame)
+        names.push_back(symbol.getName());
+    for (const auto& templ : doc->getTemplates()) {
+        frames.push_back(templ.frame);
+        for (const auto& symbol : templ.frame)
+            names.push_back(symbol.getName());
+    }
+    auto symbol = symbol_t{};
+    for (auto _ : state)
+        for (const auto& frame : frames)
+            for (const auto& name : names)
+                benchmark::DoNotOptimize(frame.resolve(name, symbol));
+    state.SetItemsProcessed(static_cast<int64_t>(frames.size() * names.size() * state.iterations()));
+}
+BENCHMARK(BM_Resolve)->Apply(syntheticSizes);
@@ -0,0 +1,71 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+/* End-to-end parsing (including type checking) of synthetic and corpus models. */
+
+#include "models.h"
+
+#include "utap/utap.h"
+
+using UTAP::Document;
+
+static void setEdges(benchmark::State& state)
+{
+    const auto edges = state.range(0) * state.range(1);
+    state.counters["edges"] = benchmark::Counter(static_cast<double>(edges));
+    state.counters["edges/s"] =
+        benchmark::Counter(static_cast<double>(edges * state.iterations()), benchmark::Counter::kIsRate);
+}
+
+static void BM_ParseXTA(benchmark::State& state)
+{
+    const auto text = generateXTA(state.range(0), state.range(1), state.range(2));
+    for (auto _ : state) {
+        auto doc = Document{};
+        benchmark::DoNotOptimize(parseXTA(text.c_str(), &doc, true));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(text.size() * state.iterations()));
+    setEdges(state);
+}
+BENCHMARK(BM_ParseXTA)->Apply(syntheticSizes);
+
+static void BM_ParseXMLBuffer(benchmark::State& state)
+{
+    const auto text = generateXML(state.range(0), state.range(1), state.range(2));
+    for (auto _ : state) {
+        auto doc = Document{};
+        benchmark::DoNotOptimize(parseXMLBuffer(text, &doc, true));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(text.size() * state.iterations()));
+    setEdges(state);
+}
+BENCHMARK(BM_ParseXMLBuffer)->Apply(syntheticSizes);
+
+static void BM_ParseXMLFile(benchmark::State& state, const std::filesystem::path& path)
+{
+    for (auto _ : state) {
+        auto doc = Document{};
+        benchmark::DoNotOptimize(parseXMLFile(path.string().c_str(), &doc, true));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(std::filesystem::file_size(path) * state.iterations()));
+}
+
+[[maybe_unused]] static const int registered = (registerCorpus("BM_ParseXMLFile", BM_ParseXMLFile), 0);
@@ -0,0 +1,81 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+/* Counts the heap allocations made while parsing a long initialiser
+   list and a long function body, per parsed expression. */
+
+#include "utap/utap.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+/* n elements (c + i) * 2 - k of an initialiser and n statements s = s + i * k of a function, 2n expressions. */
+static std::string generate(int n)
+{
+    auto text = std::string{"const int k = 3;\nconst int c = 1;\nint a["} + std::to_string(n) + "] = {";
+    for (auto i = 0; i < n; ++i)
+        text += (i ? ", (c + " : "(c + ") + std::to_string(i) + ") * 2 - k";
+    text += "};\nint f() {\n    int s = 0;\n";
+    for (auto i = 0; i < n; ++i)
+        text += "    s = s + " + std::to_string(i) + " * k;\n";
+    text += "    return s;\n}\nprocess P() { state A; init A; }\nsystem P;\n";
+    return text;
+}
+
+int main(int argc, char* argv[])
+{
+    const auto n = argc > 1 ? std::atoi(argv[1]) : 10000;
+    const auto rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+    const auto text = generate(n);
+    for (auto r = 0; r < rounds; ++r) {
+        const auto before = allocations.load();
+        const auto start = std::chrono::steady_clock::now();
+        {
+            auto doc = UTAP::Document{};
+            parseXTA(text.c_str(), &doc, true);
+            if (!doc.getErrors().empty()) {
+                std::cerr << doc.getErrors().front() << std::endl;
+                return 1;
+            }
+        }
+        const auto time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+        const auto count = allocations.load() - before;
+        std::cout << count << " allocations, " << static_cast<double>(count) / (2 * n) << " per expression, "
+                  << time.count() << " ms" << std::endl;
+    }
+}
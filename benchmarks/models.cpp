@@ -0,0 +1,120 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "models.h"
+
+#include "utap/utap.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using UTAP::Document;
+
+std::string generateXTA(int templates, int edges, int processes)
+{
+    const auto n = std::to_string(templates);
+    const auto k = std::to_string(processes);
+    auto text = std::string{};
+    text += "const int N = " + n + ";\nconst int K = " + k + ";\n";
+    text += "typedef int[0, K - 1] id_t;\n";
+    text += "chan c[N];\nbroadcast chan go;\nint[0, 100] v[N];\nbool done[N][K];\nclock now;\n";
+    text += "int mix(int a, int b) { return a + b; }\n";
+    for (auto t = 0; t < templates; ++t) {
+        const auto i = std::to_string(t);
+        const auto next = std::to_string((t + 1) % templates);
+        text += "process T" + i + "(const id_t id) {\n";
+        text += "    clock x;\n    int[0, 100] n;\n    meta int m;\n";
+        text += "    void step(int d) { n = (n + d) % 100; v[" + i + "] = mix(n, id) % 100; }\n";
+        text += "    state ";
+        for (auto e = 0; e < edges; ++e)
+            text += (e ? ", L" : "L") + std::to_string(e) + (e % 2 ? " { x <= 10 }" : "");
+        text += ";\n    init L0;\n    trans ";
+        for (auto e = 0; e < edges; ++e) {
+            const auto d = std::to_string(e);
+            const auto to = std::to_string((e + 1) % edges);
+            text += e ? ",\n        L" : "L";
+            text += d + " -> L" + to + " { ";
+            switch (e % 4) {
+            case 0: text += "guard x >= 1 && n < " + std::to_string(50 + e % 50) + "; sync c[" + i + "]!; "; break;
+            case 1: text += "guard v[" + next + "] > id && now < 100; sync c[" + next + "]?; "; break;
+            case 2: text += "select j : id_t; guard !done[" + i + "][j]; "; break;
+            default: text += "guard x > 2 || n == " + d + "; sync go!; "; break;
+            }
+            text += "assign x = 0, step(" + d + "), m = n * 2";
+            if (e % 4 == 2)
+                text += ", done[" + i + "][j] = true";
+            text += "; }";
+        }
+        text += ";\n}\n";
+    }
+    text += "system ";
+    for (auto t = 0; t < templates; ++t)
+        text += (t ? ", T" : "T") + std::to_string(t);
+    text += ";\n";
+    return text;
+}
+
+std::string generateXML(int templates, int edges, int processes)
+{
+    auto doc = parseModel(generateXTA(templates, edges, processes));
+    auto text = std::string{};
+    writeXMLBuffer(text, doc.get());
+    return text;
+}
+
+const std::vector<std::filesystem::path>& corpus()
+{
+    static const auto models = [] {
+        auto paths = std::vector<std::filesystem::path>{};
+        for (const auto& entry : std::filesystem::directory_iterator{MODELS_DIR})
+            if (entry.path().extension() == ".xml")
+                paths.push_back(entry.path());
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }();
+    return models;
+}
+
+std::unique_ptr<Document> parseModel(const std::filesystem::path& path)
+{
+    auto doc = std::make_unique<Document>();
+    if (parseXMLFile(path.string().c_str(), doc.get(), true) != 0 || doc->hasErrors())
+        return nullptr;
+    return doc;
+}
+
+std::unique_ptr<Document> parseModel(const std::string& xta)
+{
+    auto doc = std::make_unique<Document>();
+    if (!parseXTA(xta.c_str(), doc.get(), true))
+        throw std::runtime_error{"synthetic model does not parse: " + doc->getErrors().front().msg};
+    return doc;
+}
+
+void syntheticSizes(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({"templates", "edges", "processes"});
+    for (auto templates : {1, 4, 16})
+        for (auto edges : {8, 64})
+            for (auto processes : {1, 8})
+                b->Args({templates, edges, processes});
+    b->Unit(benchmark::kMicrosecond);
+}
@@ -0,0 +1,66 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_BENCHMARKS_MODELS_H
+#define UTAP_BENCHMARKS_MODELS_H
+
+#include "utap/document.h"
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Returns the XTA text of a synthetic model: `templates` templates
+ * with a ring of `edges` edges each (guards, synchronisations,
+ * updates and function calls on clocks, integers and arrays), every
+ * template partially instantiated into `processes` processes.
+ */
+std::string generateXTA(int templates, int edges, int processes);
+
+/** Returns the synthetic model of generateXTA as an XML document. */
+std::string generateXML(int templates, int edges, int processes);
+
+/** Returns the XML models of the test corpus (MODELS_DIR), sorted by name. */
+const std::vector<std::filesystem::path>& corpus();
+
+/** Parses and type checks the XML file, or returns nullptr if it does not parse without errors. */
+std::unique_ptr<UTAP::Document> parseModel(const std::filesystem::path& path);
+
+/** Parses and type checks the XTA text, throws std::runtime_error on errors. */
+std::unique_ptr<UTAP::Document> parseModel(const std::string& xta);
+
+/** The templates × edges × processes sizes of the scaling benchmarks. */
+void syntheticSizes(benchmark::internal::Benchmark* b);
+
+/** Registers fn(state, path) as one benchmark per corpus model, named prefix/model. */
+template <typename Fn>
+void registerCorpus(const std::string& prefix, Fn fn)
+{
+    for (const auto& path : corpus())
+        benchmark::RegisterBenchmark((prefix + "/" + path.stem().string()).c_str(),
+                                     [path, fn](benchmark::State& state) { fn(state, path); });
+}
+
+#endif /* UTAP_BENCHMARKS_MODELS_H */
@@ -116,6 +116,7 @@ namespace UTAP
         void procBegin(const char* name, const bool isTA = true, const std::string& type = "",
                        const std::string& mode = "") override;
         void procEnd() override;                                                   // 1 ProcBody
+        void procSkipped(const char* name, const std::string& xpath, const std::string& text) override;
         void procState(const char* name, bool hasInvariant, bool hasER) override;  // 1 expr
         void procStateCommit(const char* name) override;                           // mark previously decl. state
         void procStateUrgent(const char* name) override;                           // mark previously decl. state
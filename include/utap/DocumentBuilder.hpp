@@ -120,6 +120,7 @@ namespace UTAP
         void procBegin(const char* name, const bool isTA = true, const std::string& type = "",
                        const std::string& mode = "") override;
         void procEnd() override;
+        void procSkipped(const char* name, const std::string& xpath, const std::string& text) override;
         void procState(const char* name, bool hasInvariant, bool hasER) override;
         void procStateCommit(const char* name) override;
         void procStateUrgent(const char* name) override;
@@ -54,13 +54,31 @@ namespace UTAP
         {
         private:
             std::vector<expression_t> data;
+            SourceIndex* index{nullptr};
 
         public:
+            explicit ExpressionFragments(SourceIndex* index = nullptr): index{index} {}
             expression_t& operator[](int idx) { return data[data.size() - idx - 1]; }
-            void push(expression_t e) { data.push_back(e); }
+            void push(expression_t e)
+            {
+                if (index)
+                    index->addExpression(e);
+                data.push_back(std::move(e));
+            }
+            /** Replaces the topmost expression, usually by an expression built from it. */
+            void replace(expression_t e)
+            {
+                if (index)
+                    index->addExpression(e);
+                data.back() = std::move(e);
+            }
             void pop() { data.pop_back(); }
             void pop(uint32_t n);
+            /** Removes the topmost n expressions and returns them in the order they were pushed. */
+            std::vector<expression_t> take(uint32_t n);
             uint32_t size() { return data.size(); }
+            /** Returns the index recording the expressions pushed, if any. */
+            SourceIndex* getIndex() const { return index; }
         };
 
         class TypeFragments
@@ -70,7 +88,7 @@ namespace UTAP
 
         public:
             type_t& operator[](int idx) { return data[data.size() - idx - 1]; }
-            void push(type_t value) { data.push_back(value); }
+            void push(type_t value) { data.push_back(std::move(value)); }
             void pop()
             {
                 assert(!data.empty());
@@ -93,6 +111,19 @@ namespace UTAP
         /** Frame stack. */
         std::stack<frame_t> frames;
 
+        /** The scope of each frame on the stack, a number given by pushFrame. */
+        std::vector<uint32_t> scopes;
+        uint32_t scopeCount{0};
+
+        /** The answer of isType for a name in a scope, while the version of the name stays. */
+        struct type_name_t
+        {
+            uint32_t scope{0};
+            uint32_t version{0};
+            bool type{false};
+        };
+        std::vector<type_name_t> typeNames; /**< By the atom of the name in the document */
+
         /** Pointer to the document under construction. */
         Document& document;
 
@@ -42,7 +42,7 @@ namespace UTAP
          * The \a params frame is used temporarily during parameter
          * parsing.
          */
-        frame_t params{frame_t::createFrame()};
+        frame_t params{frame_t::createRoot(document.getGlobals().frame)};
 
         /** The function currently being parsed. */
         function_t* currentFun{nullptr};
@@ -62,8 +62,9 @@ namespace UTAP
         virtual variable_t* addVariable(type_t type, const std::string& name, expression_t init, position_t pos) = 0;
         virtual bool addFunction(type_t type, const std::string& name, position_t pos) = 0;
 
-        static void collectDependencies(std::set<symbol_t>&, expression_t);
-        static void collectDependencies(std::set<symbol_t>&, type_t);
+        /** Marks the symbols the expression or type depends on as restricted in the instance. */
+        static void collectDependencies(instance_t&, expression_t);
+        static void collectDependencies(instance_t&, type_t);
 
     public:
         explicit StatementBuilder(Document&, std::vector<std::filesystem::path> libpaths = {});
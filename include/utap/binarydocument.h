@@ -0,0 +1,79 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_BINARYDOCUMENT_H
+#define UTAP_BINARYDOCUMENT_H
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+
+namespace UTAP
+{
+    class Document;
+
+    /**
+     * Errors writing or loading binary documents: I/O errors, documents
+     * with content that cannot be stored (external functions) and files
+     * which are not binary documents of this version of the library.
+     */
+    class BinaryDocumentError : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * A type checked document kept in the binary format of
+     * writeBinaryDocument, from which variants differing in the values
+     * of global constants are restored without parsing, e.g. for
+     * parameter sweeps.  A fork is a copy of its own: documents share
+     * symbols, types and expressions through raw pointers, which rules
+     * out copying parts of them on write.
+     */
+    class DocumentSnapshot
+    {
+    public:
+        /** Throws BinaryDocumentError if the document cannot be stored. */
+        explicit DocumentSnapshot(const Document& doc);
+
+        /**
+         * Restores the document into an empty document, with the
+         * initialisers of the named global integer (or Boolean)
+         * constants replaced by the values.  The declarations of the
+         * replaced constants are checked again, reporting to \a fork;
+         * the type checker does not depend on the values of constants
+         * otherwise.  Array sizes and ranges refer to the constants, so
+         * they follow the new values.  Throws TypeException if a name is
+         * not such a constant.
+         */
+        void fork(Document& fork, const std::map<std::string, int32_t>& constants = {}) const;
+
+        /** Returns the size of the stored document in bytes. */
+        size_t size() const { return binary.size(); }
+
+    private:
+        std::string binary;
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_BINARYDOCUMENT_H */
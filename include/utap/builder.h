@@ -27,6 +27,7 @@
 
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace UTAP
@@ -52,9 +53,11 @@ namespace UTAP
      * ParserBuilder interface.
      *
      * Errors (such as type errors) can be reported back to the parser
-     * by either throwing a TypeException or by calling an error
-     * method in the ErrorHandler that has been set by a call to
-     * setErrorHandler().
+     * by either throwing a TypeException or by calling handleError().
+     * The builders of this library call handleError() and go on with a
+     * placeholder (e.g. false for an unknown identifier), so malformed
+     * input costs no stack unwinding; the parser still catches the
+     * exceptions thrown by other implementations.
      *
      * <h3>Expressions</h3>
      *
@@ -253,6 +256,8 @@ namespace UTAP
         virtual void procBegin(const char* name, const bool isTA = true, const std::string& type = "",
                                const std::string& mode = "") = 0;                     // m parameters
         virtual void procEnd() = 0;                                                   // 1 ProcBody
+        /** Called instead of procBegin() and procEnd() for a template left unbuilt by a lazy parse. */
+        virtual void procSkipped(const char* name, const std::string& xpath, const std::string& text) = 0;
         virtual void procState(const char* name, bool hasInvariant, bool hasER) = 0;  // 1 expr
         virtual void procStateCommit(const char* name) = 0;                           // mark previously decl. state
         virtual void procStateUrgent(const char* name) = 0;                           // mark previously decl. state
@@ -469,6 +474,14 @@ namespace UTAP
  */
 int32_t parseXTA(FILE*, UTAP::ParserBuilder*, bool newxta);
 
+/**
+ * Parses the XTA file with the given name as parseXTA(FILE*, ...) does.
+ * Where supported, the file is memory mapped copy-on-write and scanned
+ * in place, without being read into the lexer's buffers.  Returns -1 if
+ * the file cannot be opened.
+ */
+int32_t parseXTAFile(const char* filename, UTAP::ParserBuilder*, bool newxta);
+
 int32_t parseXTA(const char*, UTAP::ParserBuilder*, bool newxta);
 
 /**
@@ -478,7 +491,7 @@ int32_t parseXTA(const char*, UTAP::ParserBuilder*, bool newxta);
  * is used; otherwise the 3.x syntax is used. On success, this
  * function returns with a positive value.
  */
-int32_t parseXTA(const char*, UTAP::ParserBuilder*, bool newxta, UTAP::xta_part_t part, std::string xpath);
+int32_t parseXTA(std::string_view, UTAP::ParserBuilder*, bool newxta, UTAP::xta_part_t part, std::string xpath);
 
 /**
  * Parse a buffer in the XML format, reporting the document to the given
@@ -486,8 +499,21 @@ int32_t parseXTA(const char*, UTAP::ParserBuilder*, bool newxta, UTAP::xta_part_
  * errors to the ErrorHandler. If newxta is true, then the 4.x syntax
  * is used; otherwise the 3.x syntax is used. On success, this
  * function returns with a positive value.
+ *
+ * If threads is positive, then the parameters, declarations and labels
+ * of the templates are parsed by that many worker threads ahead of the
+ * builder, which still receives exactly the same calls in document
+ * order as if the document was parsed sequentially.
+ *
+ * If lazy is true, then the templates that cannot be instantiated (see
+ * Document::setLazyTemplates) are reported by procSkipped() alone.
  */
-int32_t parseXMLBuffer(const char* buffer, UTAP::ParserBuilder*, bool newxta);
+int32_t parseXMLBuffer(const char* buffer, UTAP::ParserBuilder*, bool newxta, uint32_t threads = 0,
+                       bool lazy = false);
+
+/** Same as above for a buffer of known size, which need not be NUL terminated. */
+int32_t parseXMLBuffer(std::string_view buffer, UTAP::ParserBuilder*, bool newxta, uint32_t threads = 0,
+                       bool lazy = false);
 
 /**
  * Parse the file with the given name assuming it is in the XML
@@ -495,12 +521,27 @@ int32_t parseXMLBuffer(const char* buffer, UTAP::ParserBuilder*, bool newxta);
  * ParserBuilder interface and reporting errors to the
  * ErrorHandler. If newxta is true, then the 4.x syntax is used;
  * otherwise the 3.x syntax is used. On success, this function returns
- * with a positive value.
+ * with a positive value. See parseXMLBuffer for threads and lazy.
+ *
+ * Where supported, the file is memory mapped and read in place instead
+ * of being copied into the reader's buffers.
  */
-int32_t parseXMLFile(const char* filename, UTAP::ParserBuilder*, bool newxta);
+int32_t parseXMLFile(const char* filename, UTAP::ParserBuilder*, bool newxta, uint32_t threads = 0,
+                     bool lazy = false);
 
 int32_t parseXMLFd(int fd, UTAP::ParserBuilder* pb, bool newxta);
 
+/**
+ * Parse a single element of an XML document: \a element is the text of
+ * the template or query element found at \a xpath (e.g. /nta/template[2]
+ * or /nta/queries/query[1]) in the document.  The builder receives the
+ * calls of parsing this element alone, at the same XPath as when parsing
+ * the whole document, but no global declarations, instantiation, system
+ * or done() call.  Returns -1 if \a xpath does not name a template or a
+ * query.
+ */
+int32_t parseXMLElement(std::string_view element, const std::string& xpath, UTAP::ParserBuilder* pb, bool newxta);
+
 /**
  * Parse properties from a buffer. The properties are reported using
  * the given ParserBuilder and errors are reported using the
@@ -0,0 +1,245 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_BYTECODE_H
+#define UTAP_BYTECODE_H
+
+#include "utap/document.h"
+#include "utap/expression.h"
+#include "utap/symbols.h"
+
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <cstdint>
+
+namespace UTAP
+{
+    /** Thrown when an expression or statement cannot be compiled to bytecode. */
+    class BytecodeError : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /** Thrown by the interpreter on run-time errors, e.g. an array index out of range. */
+    class EvaluationError : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * Instructions of a stack machine over 32 bit integers (Booleans are
+     * 0 and 1).  Addresses on the operand stack are indices into the
+     * state vector, or into the local frames when LOCAL_ADDRESS is set.
+     */
+    enum class opcode_t : uint8_t {
+        PUSH,              /**< Pushes a. */
+        POP,               /**< Discards the top. */
+        DUP,               /**< Duplicates the top. */
+        LOAD_STATE,        /**< Pushes state[a]. */
+        STORE_STATE,       /**< Stores the top in state[a], leaving it on the stack. */
+        LOAD_LOCAL,        /**< Pushes slot a of the current frame. */
+        STORE_LOCAL,       /**< Stores the top in slot a of the current frame, leaving it on the stack. */
+        ADDRESS_LOCAL,     /**< Pushes the address of slot a of the current frame. */
+        LOAD,              /**< Replaces an address by the value stored there. */
+        STORE,             /**< Pops a value and an address, stores the value and pushes it. */
+        COPY,              /**< Pops a source and a destination address and copies a values. */
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        MOD,
+        NEG,
+        BIT_AND,
+        BIT_OR,
+        BIT_XOR,
+        SHL,
+        SHR,
+        MIN,
+        MAX,
+        ABS,
+        LT,
+        LE,
+        EQ,
+        NE,
+        GE,
+        GT,
+        NOT,
+        BOOL,              /**< Replaces the top by 1 if it is not 0. */
+        XOR,               /**< Logical exclusive or. */
+        JUMP,              /**< Continues at a. */
+        JUMP_IF_ZERO,      /**< Pops the top and continues at a if it is 0. */
+        JUMP_IF_NOT_ZERO,  /**< Pops the top and continues at a if it is not 0. */
+        CHECK_INDEX,       /**< Fails unless 0 <= top < a. */
+        CHECK_RANGE,       /**< Fails unless a <= top <= b. */
+        ASSERT,            /**< Pops the top and fails if it is 0. */
+        CALL,              /**< Calls function a, whose arguments are on the stack. */
+        RETURN             /**< Pops the result and returns it to the caller. */
+    };
+
+    struct instruction_t
+    {
+        opcode_t op;
+        int32_t a{0};
+        int32_t b{0};
+    };
+
+    /**
+     * Compiled expressions and functions, which are entered by index.
+     * A program does not change when run, thus it can be shared by any
+     * number of interpreters.
+     */
+    struct Program
+    {
+        static constexpr int32_t LOCAL_ADDRESS = 1 << 30;
+
+        struct routine_t
+        {
+            uint32_t entry;      /**< Index of the first instruction. */
+            uint32_t frameSize;  /**< Number of local slots, parameters first. */
+            uint32_t parameters; /**< Number of arguments taken from the stack. */
+        };
+
+        std::vector<instruction_t> code;
+        std::vector<routine_t> routines; /**< Compiled expressions and statements. */
+        std::vector<routine_t> functions;
+        uint32_t stateSize{0}; /**< Number of values in the state vector. */
+    };
+
+    /**
+     * Compiles typed integer and Boolean expressions, and the bodies of
+     * the functions they call, into a Program.  Variables are laid out
+     * in a flat state vector of integers; arrays and records take one
+     * slot per element.  Identifiers of variables that were not added to
+     * the layout must be constants, whose initialisers are compiled in
+     * place.  Assignments to bounded integers check their range.
+     *
+     * Clocks, doubles, strings, channels, processes, scalar sets,
+     * external functions and switch statements are not supported.
+     */
+    class BytecodeCompiler
+    {
+    public:
+        /** Lays out a variable in the state vector and returns its first slot. */
+        int32_t addVariable(const symbol_t& symbol);
+        /**
+         * Lays out the variables in order, except for scalar constants,
+         * which are compiled in place, and variables of types that
+         * cannot be laid out, such as clocks.
+         */
+        void addVariables(const std::list<variable_t>& variables);
+        /** Returns the first slot of a variable or -1 if it is not in the state vector. */
+        int32_t getSlot(const symbol_t& symbol) const;
+
+        /** Compiles an expression and returns the index of its routine. */
+        uint32_t compile(const expression_t& expr);
+        /**
+         * Compiles the initialisers of all variables laid out so far and
+         * returns the index of a routine writing the initial state.
+         * Variables without initialiser are set to 0.
+         */
+        uint32_t compileInitialiser();
+
+        const Program& getProgram() const { return program; }
+
+    private:
+        struct address_t
+        {
+            bool dynamic;  /**< The address is on the stack (otherwise it is base). */
+            bool local;    /**< A static address is a slot of the current frame. */
+            int32_t base;
+        };
+        struct loop_t
+        {
+            std::vector<size_t> breaks;
+            std::vector<size_t> continues;
+        };
+        struct context_t
+        {
+            std::unordered_map<symbol_t, int32_t> locals;
+            std::unordered_set<symbol_t> references; /**< Locals holding an address. */
+            uint32_t frameSize{0};
+            std::vector<loop_t> loops;
+            bool usesState{false};
+        };
+        class StatementCompiler;
+        friend class StatementCompiler;
+
+        Program program;
+        std::vector<symbol_t> variables; /**< In layout order. */
+        std::unordered_map<symbol_t, int32_t> slots;
+        std::unordered_map<const function_t*, int32_t> functionIndex;
+        std::vector<std::pair<const function_t*, int32_t>> pending; /**< Called functions still to be compiled. */
+        context_t context;
+
+        size_t emit(opcode_t op, int32_t a = 0, int32_t b = 0);
+        void patch(size_t at) { program.code[at].a = static_cast<int32_t>(program.code.size()); }
+        int32_t reserveLocal(uint32_t size) { return static_cast<int32_t>((context.frameSize += size) - size); }
+        int32_t allocateLocal(const symbol_t& symbol, uint32_t size);
+        uint32_t sizeOf(const type_t& type);
+        int32_t evaluate(const expression_t& expr);
+        bool getBounds(const type_t& type, int32_t& lower, int32_t& upper);
+
+        void compileValue(const expression_t& expr);
+        address_t compileAddress(const expression_t& expr);
+        void makeDynamic(address_t& address);
+        void load(const address_t& address);
+        void store(const address_t& address, const type_t& type);
+        void compileAssignment(const expression_t& expr);
+        void compileIncrement(const expression_t& expr);
+        void compileCall(const expression_t& expr);
+        void compileQuantifier(const expression_t& expr);
+        void initialise(const address_t& address, const type_t& type, const expression_t& init);
+        void compileFunction(const function_t& fun, int32_t index);
+        void compilePending();
+    };
+
+    /**
+     * Reference interpreter of compiled programs.  Not thread safe; use
+     * one interpreter per thread, sharing the program.
+     */
+    class BytecodeInterpreter
+    {
+    public:
+        explicit BytecodeInterpreter(const Program& program): program{program} {}
+
+        /** Runs a routine on the state vector (of program.stateSize values) and returns its value. */
+        int32_t run(uint32_t routine, int32_t* state);
+
+    private:
+        struct call_t
+        {
+            uint32_t pc;
+            uint32_t frame;
+        };
+        const Program& program;
+        std::vector<int32_t> stack;
+        std::vector<int32_t> locals;
+        std::vector<call_t> calls;
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_BYTECODE_H */
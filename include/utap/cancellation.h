@@ -0,0 +1,114 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_CANCELLATION_H
+#define UTAP_CANCELLATION_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <cstddef>
+
+namespace UTAP
+{
+    /** Thrown out of the parsing entry points and the type checker when the parse is cancelled. */
+    class CancelledError : public std::runtime_error
+    {
+    public:
+        CancelledError(): std::runtime_error{"$Parsing_cancelled"} {}
+    };
+
+    /** A flag for cancelling a parse from another thread; copies share the flag. */
+    class CancellationToken
+    {
+    public:
+        CancellationToken(): flag{std::make_shared<std::atomic<bool>>(false)} {}
+
+        void cancel() const noexcept { flag->store(true, std::memory_order_relaxed); }
+        bool isCancelled() const noexcept { return flag->load(std::memory_order_relaxed); }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> flag;
+    };
+
+    /**
+     * Watches the parses made on the thread while a Scope is alive: the
+     * XML reader reports each template it has read, and the reader, the
+     * lexer and the type checker stop once the token is cancelled.  The
+     * token is polled for every token lexed and at every template and
+     * function, so a cancelled parse ends within the time it takes to
+     * build or check one of them.  Cancelling only stops the thread
+     * watched: worker threads (see the threads argument of parseXMLFile)
+     * finish the template at hand and are joined.
+     */
+    class ParseMonitor
+    {
+    public:
+        /** Called with the name of each template read and the number of templates read so far. */
+        using progress_t = std::function<void(const std::string& name, size_t templates)>;
+
+        explicit ParseMonitor(CancellationToken token = {}, progress_t progress = {}):
+            token{std::move(token)}, progress{std::move(progress)}
+        {}
+
+        const CancellationToken& getToken() const { return token; }
+        bool isCancelled() const noexcept { return token.isCancelled(); }
+        /** Reports a template read, then throws CancelledError if cancelled. */
+        void templateRead(const std::string& name);
+
+        /** Returns the monitor of this thread, or nullptr. */
+        static ParseMonitor* current() noexcept;
+        /** Returns true if the parse on this thread is cancelled. */
+        static bool cancelled() noexcept
+        {
+            const auto* monitor = current();
+            return monitor != nullptr && monitor->isCancelled();
+        }
+        /** Throws CancelledError if the parse on this thread is cancelled. */
+        static void checkpoint()
+        {
+            if (cancelled())
+                throw CancelledError{};
+        }
+
+        /** Makes the monitor that of this thread until destroyed. */
+        class Scope
+        {
+        public:
+            explicit Scope(ParseMonitor& monitor) noexcept;
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            ~Scope() noexcept;
+
+        private:
+            ParseMonitor* previous;
+        };
+
+    private:
+        CancellationToken token;
+        progress_t progress;
+        size_t templates{0};
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_CANCELLATION_H */
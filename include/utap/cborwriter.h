@@ -0,0 +1,82 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_CBORWRITER_H
+#define UTAP_CBORWRITER_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace UTAP
+{
+    class Document;
+
+    /**
+     * Streams a built document as CBOR (RFC 8949) or as the equivalent
+     * JSON, for clients that should not parse the XML again.
+     *
+     * The document is one array of records, each a map with a "record"
+     * entry naming its kind: "document" first, then "variable",
+     * "function", "template", "location", "branchpoint", "edge",
+     * "instance", "process" and "query" records in document order.
+     * Types and symbols are written as "type" and "symbol" records
+     * just before the first record referring to them, and referred to
+     * by number: types are numbered from 1, symbols by
+     * symbol_t::getId(); 0 is none.
+     *
+     * An expression is an array of four entries per node in post-order
+     * (the children of a node come before it): the kind (a value of
+     * Constants::kind_t), the number of children, the type and the
+     * operand, which is the symbol of an identifier and otherwise the
+     * value of a constant, the field of a DOT or the synchronisation of
+     * a SYNC.  An empty expression is null.  Statements are arrays
+     * starting with the name of the statement, e.g. ["if", cond, then,
+     * else].
+     *
+     * The output goes to the sink in chunks of about the given size, so
+     * the memory used does not grow with the output, only with the
+     * number of types and symbols written.  LSC scenarios are written
+     * as templates without their messages, conditions and updates.
+     */
+    class CBORWriter
+    {
+    public:
+        /** Receives the next chunk of the output. */
+        using sink_t = std::function<void(std::string_view chunk)>;
+        enum format_t { CBOR, JSON };
+
+        explicit CBORWriter(sink_t sink, format_t format = CBOR, size_t chunk = 64 * 1024):
+            sink{std::move(sink)}, format{format}, chunk{chunk}
+        {}
+
+        /** Writes the document and flushes the output. */
+        void write(Document& doc);
+
+    private:
+        sink_t sink;
+        format_t format;
+        size_t chunk;
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_CBORWRITER_H */
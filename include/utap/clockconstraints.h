@@ -0,0 +1,69 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_CLOCKCONSTRAINTS_H
+#define UTAP_CLOCKCONSTRAINTS_H
+
+#include "utap/expression.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace UTAP
+{
+    /** The difference constraint clocks[i] - clocks[j] < bound, or <= bound if not strict. */
+    struct clock_constraint_t
+    {
+        uint32_t i;
+        uint32_t j;
+        expression_t bound; /**< Integer and free of clocks, usually a constant or a template parameter */
+        bool strict;
+    };
+
+    /**
+     * A guard or an invariant split into its conjuncts: the difference
+     * constraints on clocks, the conjuncts free of clocks, and the rest
+     * (rates, disjunctions, comparisons with a non-integer bound, etc).
+     *
+     * The constraints refer to the clocks by their index in clocks,
+     * index 0 being the reference clock whose value is always 0.  The
+     * clocks are expressions of the template, e.g. x or c[id], listed
+     * in the order they first occur, so the same clock in two forms may
+     * have different indices.  A conjunct x == c gives two constraints;
+     * conjuncts are otherwise kept in their order.
+     */
+    struct constraint_form_t
+    {
+        expression_t source; /**< The expression split */
+        std::vector<expression_t> clocks;
+        std::vector<clock_constraint_t> constraints;
+        expression_t data;                /**< The conjunction of the conjuncts free of clocks, true if none */
+        std::vector<expression_t> others; /**< The conjuncts on clocks which are not difference constraints */
+
+        /** Returns true if the expression is a conjunction of difference constraints and data only. */
+        bool isConvex() const { return others.empty(); }
+
+        /** Splits a type checked guard or invariant; an empty expression is true. */
+        static constraint_form_t split(const expression_t& expr);
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_CLOCKCONSTRAINTS_H */
@@ -24,14 +24,21 @@
 #define UTAP_INTERMEDIATE_HH
 
 #include "utap/expression.h"
+#include "utap/librarycache.h"
+#include "utap/node.h"
 #include "utap/position.h"
+#include "utap/sourceindex.h"
+#include "utap/statistics.h"
 #include "utap/symbols.h"
 
 #include <algorithm>  // find
 #include <deque>
+#include <initializer_list>
 #include <list>
 #include <map>
+#include <memory>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 namespace UTAP
@@ -55,6 +62,8 @@ namespace UTAP
         std::string toString() const;
     };
 
+    struct constraint_form_t;
+
     /** Information about a location.
         The symbol's user data points to this structure, i.e.
         s.uid.getData() is a pointer to s. Notice that the rate list
@@ -70,6 +79,10 @@ namespace UTAP
         expression_t costRate; /**< Rate expression */
         int32_t locNr;         /**< Location number in template */
         std::string toString() const;
+        /** Returns the invariant split into clock constraints and data, split again if the invariant changed.
+            The cache is not guarded, so this is not to be called concurrently on the same location. */
+        const constraint_form_t& getInvariantForm() const;
+        mutable std::shared_ptr<const constraint_form_t> invariantForm{}; /**< Cache of getInvariantForm() */
     };
 
     /** Information about a branchpoint.
@@ -105,6 +118,10 @@ namespace UTAP
         expression_t prob;   /**< Probability for probabilistic edges. */
         std::string toString() const;
         std::list<int32_t> selectValues; /**<The select values, if any */
+        /** Returns the guard split into clock constraints and data, split again if the guard changed.
+            The cache is not guarded, so this is not to be called concurrently on the same edge. */
+        const constraint_form_t& getGuardForm() const;
+        mutable std::shared_ptr<const constraint_form_t> guardForm{}; /**< Cache of getGuardForm() */
     };
 
     class BlockStatement;  // Forward declaration
@@ -117,6 +134,8 @@ namespace UTAP
         symbol_t uid;                                  /**< The symbol of the function. */
         std::set<symbol_t> changes{};                  /**< Variables changed by this function. */
         std::set<symbol_t> depends{};                  /**< Variables the function depends on. */
+        symbol_set_t changeSet{};                      /**< The changes as a bitset, kept by the type checker. */
+        symbol_set_t dependSet{};                      /**< The depends as a bitset, kept by the type checker. */
         std::list<variable_t> variables{};             /**< Local variables. */
         std::unique_ptr<BlockStatement> body{nullptr}; /**< Pointer to the block. */
         function_t() = default;
@@ -314,7 +333,10 @@ namespace UTAP
      * parameters are ordered such that unbound symbols are listed
      * first, i.e., uid.getType().size() == parameters.getSize().
      *
-     * \a mapping binds parameters to expressions.
+     * \a mapping binds parameters to expressions. Instances share the
+     * expression trees of their template: getArgument() and resolve()
+     * look the bindings up when needed, and instantiate() makes a copy
+     * with the arguments in place only when a caller asks for one.
      *
      * \a arguments is the number of arguments given by the partial
      * instance. The first \a arguments bound symbols of \a parameters
@@ -337,6 +359,17 @@ namespace UTAP
         size_t unbound;
         struct template_t* templ;
         std::set<symbol_t> restricted; /**< Restricted variables */
+        symbol_set_t restrictedSet;    /**< The restricted variables as a bitset */
+
+        /** Returns the argument bound to the parameter as given, or an empty expression if it is unbound. The
+            argument of a parameter bound by a partial instance may refer to the parameters of that instance. */
+        expression_t getArgument(symbol_t parameter) const;
+        /** Returns the instantiated argument if the expression is the identifier of a bound parameter, otherwise
+            the expression. */
+        expression_t resolve(const expression_t& expr) const;
+        /** Returns the expression with the bound parameters replaced by their arguments, sharing the unchanged
+            subexpressions with the template (see expression_t::subst). */
+        expression_t instantiate(const expression_t& expr) const { return expr.subst(mapping); }
 
         std::string writeMapping() const;
         std::string writeParameters() const;
@@ -506,8 +539,100 @@ namespace UTAP
         virtual void visitUpdate(update_t&) {}
     };
 
+    /**
+     * Forwards every visit to several visitors in turn, such that a
+     * single traversal of the document serves all of them.  Each element
+     * is visited by the visitors in the given order before the traversal
+     * moves on.  The elements of a template are only visited by the
+     * visitors whose visitTemplateBefore() returned true.
+     */
+    class CompositeVisitor : public SystemVisitor
+    {
+    public:
+        explicit CompositeVisitor(std::vector<SystemVisitor*> visitors);
+        void visitSystemBefore(Document*) override;
+        void visitSystemAfter(Document*) override;
+        void visitVariable(variable_t&) override;
+        bool visitTemplateBefore(template_t&) override;
+        void visitTemplateAfter(template_t&) override;
+        void visitState(state_t&) override;
+        void visitEdge(edge_t&) override;
+        void visitInstance(instance_t&) override;
+        void visitProcess(instance_t&) override;
+        void visitFunction(function_t&) override;
+        void visitTypeDef(symbol_t) override;
+        void visitIODecl(iodecl_t&) override;
+        void visitProgressMeasure(progress_t&) override;
+        void visitGanttChart(gantt_t&) override;
+        void visitInstanceLine(instanceLine_t&) override;
+        void visitMessage(message_t&) override;
+        void visitCondition(condition_t&) override;
+        void visitUpdate(update_t&) override;
+
+    private:
+        std::vector<SystemVisitor*> visitors;
+        std::vector<SystemVisitor*> active; /**< The visitors of the current template, all outside templates. */
+    };
+
+    /**
+     * Hashed lookup by name and dense ids, in order of declaration, of
+     * the templates or instances of a list. The index does not own the
+     * entries, which the list keeps at their addresses. With several
+     * entries of the same name, the first is found.
+     */
+    template <typename T>
+    class NameIndex
+    {
+    public:
+        /** Appends an entry, whose id is the number of entries before it. */
+        void add(T& entry)
+        {
+            ids.emplace(entry.uid.getName(), static_cast<uint32_t>(table.size()));
+            table.push_back(&entry);
+        }
+        template <typename List>
+        void assign(List& list)
+        {
+            table.clear();
+            ids.clear();
+            for (auto& entry : list)
+                add(entry);
+        }
+        /** Returns the entry of the name, or nullptr if there is none. */
+        T* find(const std::string& name) const
+        {
+            auto it = ids.find(name);
+            return it != ids.end() ? table[it->second] : nullptr;
+        }
+        /** Returns the id of the entry of the name, or -1 if there is none. */
+        int32_t getId(const std::string& name) const
+        {
+            auto it = ids.find(name);
+            return it != ids.end() ? static_cast<int32_t>(it->second) : -1;
+        }
+        T& operator[](uint32_t id) const { return *table[id]; }
+        uint32_t size() const { return static_cast<uint32_t>(table.size()); }
+        /** Returns the entries by id. */
+        const std::vector<T*>& getTable() const { return table; }
+
+    private:
+        std::vector<T*> table;
+        std::unordered_map<std::string, uint32_t> ids;
+    };
+
+    /** A template left unbuilt by a lazy parse (see Document::setLazyTemplates). */
+    struct skipped_template_t
+    {
+        std::string name;  /**< The name of the template */
+        std::string xpath; /**< The XPath of the template element, e.g. /nta/template[3] */
+        std::string text;  /**< The XML text of the template element, see parseXMLElement */
+    };
+
     class Document
     {
+        friend class BinaryReader;
+        friend class BinaryWriter;
+
     public:
         Document();
         Document(const Document&);
@@ -522,8 +647,38 @@ namespace UTAP
         std::vector<template_t*>& getDynamicTemplates();
         template_t* getDynamicTemplate(const std::string& name);
 
+        /**
+         * Makes the XML parsing entry points skip the templates that
+         * cannot be instantiated: those whose names appear neither in
+         * the global declarations, the instantiation, the system
+         * definition or the queries, nor in a template that does.  The
+         * skipped templates are neither built nor checked, but only
+         * recorded, see getSkippedTemplates().  A file descriptor is
+         * read once and thus always parsed in full.
+         */
+        void setLazyTemplates(bool lazy) { lazyTemplates = lazy; }
+        bool hasLazyTemplates() const { return lazyTemplates; }
+        /** Returns the templates skipped by a lazy parse, in document order. */
+        const std::vector<skipped_template_t>& getSkippedTemplates() const { return skippedTemplates; }
+        void addSkippedTemplate(skipped_template_t templ) { skippedTemplates.push_back(std::move(templ)); }
+
         /** Returns the processes of the document. */
         std::list<instance_t>& getProcesses();
+        const instance_t* findProcess(const std::string& name) const { return processIndex.find(name); }
+        /** Returns the (partial) instances declared in the system definition by name. */
+        const instance_t* findInstance(const std::string& name) const { return instanceIndex.find(name); }
+
+        /** Ids of the templates, dynamic templates, instances and processes in order of declaration. The
+            indices follow the add and remove methods; freeze() rebuilds them after other changes to the lists. */
+        const NameIndex<template_t>& getTemplateIndex() const { return templateIndex; }
+        const NameIndex<template_t>& getDynamicTemplateIndex() const { return dynamicTemplateIndex; }
+        const NameIndex<instance_t>& getInstanceIndex() const { return instanceIndex; }
+        const NameIndex<instance_t>& getProcessIndex() const { return processIndex; }
+
+        /** Rebuilds the indices and keeps the ids stable from now on: adding or removing templates, instances
+            and processes throws TypeException. Meant for after building, e.g. when mapping traces back. */
+        void freeze();
+        bool isFrozen() const { return frozen; }
 
         options_t& getOptions();
         void setOptions(const options_t& options);
@@ -532,7 +687,17 @@ namespace UTAP
         queries_t& getQueries();
 
         void addPosition(uint32_t position, uint32_t offset, uint32_t line, const std::string& path);
-        const Positions::line_t& findPosition(uint32_t position) const;
+        Positions::line_t findPosition(uint32_t position) const;
+        const Positions& getPositions() const { return positions; }
+
+        /**
+         * Makes the builders created from now on, i.e. by later parsing entry points, record what they parse
+         * into the document, see SourceIndex.  Builders that already exist keep indexing or not.
+         */
+        void enableSourceIndex();
+        /** Returns the index of the expressions and symbols by position, or nullptr unless enabled. */
+        SourceIndex* getSourceIndex() { return sourceIndex.get(); }
+        const SourceIndex* getSourceIndex() const { return sourceIndex.get(); }
 
         variable_t* addVariableToFunction(function_t*, frame_t, type_t, const std::string&, expression_t initital,
                                           position_t);
@@ -556,8 +721,25 @@ namespace UTAP
         std::string obsTA;  // name of the observer TA instance
 
         void addProcess(instance_t& instance, position_t);
+        /**
+         * Rebuilds the types of the processes of the template after its
+         * frame was replaced, and looks up the fields of those processes
+         * in the progress measures and gantt charts again.  Returns false
+         * if one of the fields referred to is gone.
+         */
+        bool updateProcesses(const template_t& templ);
         void addGantt(declarations_t*, gantt_t);  // copies gantt_t and moves it
         void accept(SystemVisitor&);
+        /** Visits the document once for all the visitors, see CompositeVisitor. */
+        void accept(std::initializer_list<SystemVisitor*> visitors);
+        /** Visits a single declaration of a frame, as accept() does for each of them. */
+        static void acceptDeclaration(SystemVisitor&, symbol_t);
+        /** Visits a template with its declarations, edges and LSC elements, as accept() does. */
+        static void acceptTemplate(SystemVisitor&, template_t&);
+        /** Visits a global process or instance declaration, as accept() does. */
+        static void acceptInstance(SystemVisitor&, symbol_t);
+        /** Visits the system level declarations which accept() visits after the processes. */
+        void acceptSystem(SystemVisitor&);
 
         void setBeforeUpdate(expression_t);
         expression_t getBeforeUpdate();
@@ -641,6 +823,8 @@ namespace UTAP
         // List of dynamic template
         std::list<template_t> dynamicTemplates;
         std::vector<template_t*> dynamicTemplatesVec;
+        std::vector<skipped_template_t> skippedTemplates;
+        bool lazyTemplates{false};
 
         // The list of template instances.
         std::list<instance_t> instances;
@@ -651,6 +835,14 @@ namespace UTAP
         // List of processes.
         std::list<instance_t> processes;
 
+        NameIndex<template_t> templateIndex;
+        NameIndex<template_t> dynamicTemplateIndex;
+        NameIndex<instance_t> instanceIndex;
+        NameIndex<instance_t> processIndex;
+        bool frozen{false};
+        void reindex();
+        void checkNotFrozen() const;
+
         // Global declarations
         declarations_t global;
 
@@ -663,13 +855,13 @@ namespace UTAP
                                 position_t);
 
         std::string location;
-        std::vector<void*> libraries;
+        std::vector<LibraryCache::Handle> libraries; /**< The imported libraries, in the order of import */
         std::vector<std::string> strings;
         SupportedMethods supportedMethods{};
 
     public:
-        void addLibrary(void* lib);
-        void* lastLibrary();
+        void addLibrary(LibraryCache::Handle lib);
+        const LibraryCache::Handle& lastLibrary();
         void addError(position_t, std::string msg, std::string ctx = "");
         void addWarning(position_t, const std::string& msg, const std::string& ctx = "");
         bool hasErrors() const { return !errors.empty(); }
@@ -678,17 +870,46 @@ namespace UTAP
         const std::vector<error_t>& getWarnings() const { return warnings; }
         void clearErrors() const;
         void clearWarnings() const;
+        /** Reserves room for the given number of errors and warnings, e.g. when most inputs are malformed. */
+        void reserveDiagnostics(size_t errors, size_t warnings) const;
+        /** Replaces all errors and warnings, e.g. by those of an incremental re-check. */
+        void setDiagnostics(std::vector<error_t> errors, std::vector<error_t> warnings) const;
         bool isModified() const;
         void setModified(bool mod);
         iodecl_t* addIODecl();
         void setSupportedMethods(const SupportedMethods& supportedMethods);
         const SupportedMethods& getSupportedMethods() const;
 
+        /**
+         * Makes the parsing entry points create local nodes for the document, see NodeScope.  Throws
+         * std::logic_error once they created nodes for it, as its nodes would then be counted both ways.
+         */
+        void setLocal(bool local);
+        /** Returns whether the document must stay on one thread since its nodes are local. Passes given threads
+            for it then work on the calling thread alone. */
+        bool isLocal() const { return local; }
+        /** Selects the counting of the nodes created for the document on this thread until destroyed. */
+        NodeScope createNodes()
+        {
+            hasNodes = true;
+            return NodeScope{local};
+        }
+        /** Returns the table interning the types created by the parsing entry points. */
+        TypeTable& getTypeTable() { return typeTable; }
+        /** Returns the statistics of the parsing entry points, collected once enabled. */
+        Statistics& getStatistics() { return statistics; }
+        const Statistics& getStatistics() const { return statistics; }
+
     private:
         // TODO: move errors & warnings to ParserBuilder to get rid of mutable
         mutable std::vector<error_t> errors;
         mutable std::vector<error_t> warnings;
         Positions positions;
+        std::unique_ptr<SourceIndex> sourceIndex;
+        bool local{false};
+        bool hasNodes{false}; /**< Whether createNodes was called. */
+        TypeTable typeTable;
+        Statistics statistics;
     };
 }  // namespace UTAP
 
@@ -23,11 +23,13 @@
 #define UTAP_EXPRESSION_HH
 
 #include "utap/common.h"
+#include "utap/node.h"
 #include "utap/position.h"
 #include "utap/symbols.h"
 
-#include <memory>  // shared_ptr
+#include <map>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 namespace UTAP
@@ -65,11 +67,19 @@ namespace UTAP
         Expressions are created by using the static factory methods.
     */
 
+    class ExpressionTable;
+    class MemoryReport;
+
     class expression_t
     {
     private:
+        friend class ExpressionTable;
+        friend class BinaryReader;
+        friend class BinaryWriter;
         struct expression_data;
-        std::shared_ptr<expression_data> data = nullptr;  // PIMPL pattern with cheap/shallow copying
+        struct footprint_t;
+        static const footprint_t noFootprint; /**< Shared by all expressions without reads and writes. */
+        node_ptr<expression_data> data = nullptr;  // PIMPL pattern with cheap/shallow copying
         expression_t(Constants::kind_t, const position_t&);
 
     public:
@@ -135,6 +145,23 @@ namespace UTAP
         /** Returns a string representation of the expression. */
         std::string toString(bool old = false) const;
 
+        /** Appends the string representation of the expression to str, reusing its capacity. */
+        void toString(std::string& str, bool old = false) const;
+
+        /**
+         * Returns a copy of the string representation of the expression,
+         * printed once and kept with the node until it is changed through
+         * get(), operator[] or setType().  Meant for expressions that are
+         * printed over and over, such as the guards and updates of edges.
+         * Like the other caches it does not notice changes of the names or
+         * types of symbols, nor of subexpressions changed in place; only
+         * this method uses the cache, toString() always prints.
+         */
+        std::string toStringCached() const;
+
+        /** Adds the node and the nodes it refers to, those not counted yet, to the report. */
+        void measure(MemoryReport& report) const;
+
         /** Returns the ith subexpression. */
         expression_t& operator[](uint32_t);
 
@@ -181,12 +208,14 @@ namespace UTAP
         /** Returns true if this expression is a reference to a
             symbol in the given set. */
         bool isReferenceTo(const std::set<symbol_t>&) const;
+        bool isReferenceTo(const symbol_set_t&) const;
 
         /** Returns true if the expression contains deadlock expression */
         bool contains_deadlock() const;
         /** True if this expression can change any of the variables
                 identified by the given symbols. */
         bool changesVariable(const std::set<symbol_t>&) const;
+        bool changesVariable(const symbol_set_t&) const;
 
         /** True if this expression can change any variable at all. */
         bool changesAnyVariable() const;
@@ -194,20 +223,41 @@ namespace UTAP
         /** True if the evaluation of this expression depends on
             any of the symbols in the given set. */
         bool dependsOn(const std::set<symbol_t>&) const;
+        bool dependsOn(const symbol_set_t&) const;
 
+        /**
+         * The read and write footprints of an expression are computed
+         * once and cached on its nodes; the effects of called functions
+         * are looked up in function_t::changes and function_t::depends
+         * on every call, as those are only known after type checking.
+         * Modifying a node through operator[] or get() discards its
+         * cache, thus subexpressions must be modified through their
+         * parent expressions, not through copies of them.
+         */
         void collectPossibleWrites(std::set<symbol_t>&) const;
         void collectPossibleReads(std::set<symbol_t>&, bool collectRandom = false) const;
+        void collectPossibleWrites(symbol_set_t&) const;
+        void collectPossibleReads(symbol_set_t&, bool collectRandom = false) const;
 
         /** Less-than operator. Makes it possible to put expression_t
             objects into an STL set. */
-        bool operator<(const expression_t) const;
+        bool operator<(const expression_t&) const;
 
         /** Equality operator. Returns true if the two references point
             to the same expression object. */
-        bool operator==(const expression_t) const;
+        bool operator==(const expression_t&) const;
 
         expression_t subst(symbol_t, expression_t) const;
 
+        /** Replaces identifiers of the symbols in the map by the mapped
+            expressions, in which the mapped symbols are replaced as
+            well, so the map must not be cyclic. Unlike
+            subst(symbol_t, expression_t), only the
+            nodes on the paths to replaced identifiers are copied; the
+            other subexpressions, and the expression itself when nothing
+            is replaced, are shared with the original. */
+        expression_t subst(const std::map<symbol_t, expression_t>&) const;
+
         static int getPrecedence(Constants::kind_t);
 
         /** Create a CONSTANT expression. */
@@ -245,12 +295,68 @@ namespace UTAP
 
         // true if empty or equal to 1.
         bool isTrue() const;
-        friend std::ostream& operator<<(std::ostream& o, const UTAP::expression_t& e) { return o << e.toString(); }
+        friend std::ostream& operator<<(std::ostream& o, const UTAP::expression_t& e);
 
     private:
+        static expression_t intern(expression_t);
+        /** Creates a node from all of its fields without interning it. */
+        static expression_t createNode(Constants::kind_t, position_t, int32_t value, double doubleValue, symbol_t,
+                                       type_t, std::vector<expression_t> sub);
+        /** Returns the value field whatever the kind of the node (but not for double constants). */
+        int32_t getRawValue() const;
         int getPrecedence() const;
-        void toString(bool, char*& str, char*& end, int& size) const;
-        void appendBoundType(char*& str, char*& end, int& size, expression_t e) const;
+        const footprint_t& getFootprint() const;
+        void collectFootprint(footprint_t&) const;
+        void discardCaches();
+        void print(std::string& str, bool old) const;
+        void appendBoundType(std::string& str, const expression_t& e) const;
+    };
+
+    /**
+     * Hash-consing table for expressions. While a Scope for the table is
+     * active on the current thread, the create* factories, subst and
+     * deeperClone return one shared node for each structurally equal
+     * (kind, value, symbol, type, subexpressions) tuple, keeping the
+     * position of the first one created. Equality of interned
+     * expressions is a pointer compare and repeated subexpressions are
+     * stored once.
+     *
+     * Interned nodes are shared and must not be modified afterwards
+     * (setType, assigning through operator[]), so the table is meant for
+     * expressions that are already type checked, e.g. when instantiating
+     * templates with deeperClone. The table keeps its nodes alive.
+     */
+    class ExpressionTable
+    {
+    public:
+        ExpressionTable() = default;
+        ExpressionTable(const ExpressionTable&) = delete;
+        ExpressionTable& operator=(const ExpressionTable&) = delete;
+
+        /** Returns the unique node structurally equal to expr, adding expr if there is none. */
+        expression_t intern(expression_t expr);
+
+        /** Returns the number of distinct nodes in the table. */
+        size_t size() const { return nodes.size(); }
+
+        /** Makes the factories of expression_t use the table on this thread until destroyed. */
+        class Scope
+        {
+        public:
+            explicit Scope(ExpressionTable& table);
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            ~Scope() noexcept;
+
+        private:
+            ExpressionTable* previous;
+        };
+
+        /** Returns the table of the innermost active scope on this thread, or nullptr. */
+        static ExpressionTable* current();
+
+    private:
+        std::unordered_multimap<size_t, expression_t> nodes;
     };
 
 }  // namespace UTAP
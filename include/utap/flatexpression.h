@@ -0,0 +1,95 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_FLATEXPRESSION_H
+#define UTAP_FLATEXPRESSION_H
+
+#include "utap/common.h"
+#include "utap/expression.h"
+#include "utap/symbols.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace UTAP
+{
+    /**
+     * A read-only copy of one or more expression trees as parallel
+     * arrays in post-order: the children of a node come before it, and
+     * the nodes of a subtree are contiguous and end with its root.
+     * Passes that look at every node (collecting identifiers, searching
+     * for kinds) can scan the arrays linearly instead of chasing the
+     * children of each node.
+     *
+     * Values are those of integer constants (the field index for DOT
+     * and the synchronisation for SYNC), 0 for other nodes.  Symbols
+     * are those of identifiers.  Empty subexpressions become nodes of
+     * kind UNKNOWN.  The view does not follow later changes of the
+     * expressions it was built from.
+     */
+    class flat_expression_t
+    {
+    public:
+        flat_expression_t() = default;
+        explicit flat_expression_t(const expression_t& expr) { add(expr); }
+
+        /** Appends an expression and returns the index of its root. */
+        uint32_t add(const expression_t& expr);
+
+        /** Returns the number of nodes. */
+        uint32_t size() const { return static_cast<uint32_t>(kinds.size()); }
+        bool empty() const { return kinds.empty(); }
+        /** Returns the indices of the roots of the added expressions, in order. */
+        const std::vector<uint32_t>& getRoots() const { return roots; }
+
+        Constants::kind_t getKind(uint32_t node) const { return kinds[node]; }
+        int32_t getValue(uint32_t node) const { return values[node]; }
+        /** Returns the dense identifier of the symbol (see symbol_t::getId()), 0 if not an identifier. */
+        uint32_t getSymbolId(uint32_t node) const { return symbolIds[node]; }
+        symbol_t getSymbol(uint32_t node) const { return nodes[node].getSymbol(); }
+        /** Returns the original node, e.g. for its type and position. */
+        const expression_t& getExpression(uint32_t node) const { return nodes[node]; }
+
+        /** Returns the number of children of the node. */
+        uint32_t getSize(uint32_t node) const { return childStart[node + 1] - childStart[node]; }
+        /** Returns the index of the ith child of the node. */
+        uint32_t getChild(uint32_t node, uint32_t i) const { return children[childStart[node] + i]; }
+        /** Returns the index of the first node of the subtree of the node. */
+        uint32_t getFirst(uint32_t node) const { return first[node]; }
+
+        /** The arrays themselves, indexed by node. */
+        const std::vector<Constants::kind_t>& getKinds() const { return kinds; }
+        const std::vector<int32_t>& getValues() const { return values; }
+        const std::vector<uint32_t>& getSymbolIds() const { return symbolIds; }
+
+    private:
+        std::vector<Constants::kind_t> kinds;
+        std::vector<int32_t> values;
+        std::vector<uint32_t> symbolIds;
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> childStart{0};  // children of node i are children[childStart[i]..childStart[i+1])
+        std::vector<uint32_t> children;
+        std::vector<expression_t> nodes;
+        std::vector<uint32_t> roots;
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_FLATEXPRESSION_H */
@@ -0,0 +1,133 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_INCREMENTALTYPECHECKER_H
+#define UTAP_INCREMENTALTYPECHECKER_H
+
+#include "utap/document.h"
+#include "utap/typechecker.h"
+
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace UTAP
+{
+    /**
+     * Type checks a document like TypeChecker, but splits the work into
+     * units (each global declaration, each template, each process or
+     * instance and the system declarations) and remembers which symbols
+     * every unit reads and which diagnostics it produced.  After an edit
+     * of the document, recheck() only checks the invalidated units and
+     * the units reading what they declare, and replaces their
+     * diagnostics in the document.
+     *
+     * Edits must keep the symbols they do not change: when a
+     * declaration changes its type, the identifiers referring to it have
+     * to be rebuilt.  Adding or removing global declarations, templates
+     * or processes makes the next recheck() check everything.  The
+     * feature flags recorded in the document (stop watches, urgent
+     * edges, ...) are only ever set, never cleared, by a re-check.
+     *
+     * Given worker threads, the templates to check are checked
+     * concurrently (after the global declarations they depend on), each
+     * into its own diagnostics, which are merged in the order of the
+     * templates.  A template whose outcome depends on the kinds of
+     * synchronisation used by the templates before it is checked again
+     * once those are known, so the diagnostics are the same as those of
+     * a sequential check.
+     *
+     * The compile time computable values are collected once and then
+     * only extended by the units being checked again; they are collected
+     * anew when the layout changes or a constant is invalidated.
+     */
+    class IncrementalTypeChecker
+    {
+    public:
+        /** Diagnostics already in the document, such as parse errors, are kept in front of those found. */
+        explicit IncrementalTypeChecker(Document& doc, bool refinement = false);
+
+        /** Checks the whole document, the templates using \a threads worker threads. */
+        void check(uint32_t threads = 0);
+
+        /** Marks the declaration of the symbol and everything reading the symbol as changed. */
+        void invalidate(symbol_t symbol);
+
+        /** Marks the template (its declarations, locations, edges, ...) as changed. */
+        void invalidate(template_t& templ);
+
+        /** Marks the system level declarations (I/O, progress, gantt charts, priorities) as changed. */
+        void invalidateSystem();
+
+        /** Checks the changed units and their dependents; returns the number of units checked. */
+        size_t recheck(uint32_t threads = 0);
+
+        /**
+         * Replaces the diagnostics kept from parsing the XML element at
+         * \a xpath (or below it) by those reported to the document since
+         * the diagnostics were last published, that is, by re-parsing the
+         * element.  Returns true if no parse errors are left, in which
+         * case the document should be re-checked; otherwise the document
+         * only reports the parse diagnostics, like a document failing to
+         * parse is not type checked.
+         */
+        bool reparsed(const std::string& xpath);
+
+    private:
+        enum unit_kind_t { DECLARATION, TEMPLATE, INSTANCE, SYSTEM };
+
+        struct unit_t
+        {
+            unit_kind_t kind;
+            symbol_t symbol;         /**< The symbol declared by the unit, if any. */
+            template_t* templ;       /**< The template of a TEMPLATE unit. */
+            std::set<symbol_t> reads{}; /**< The symbols of the identifiers checked in the unit. */
+            std::vector<error_t> errors{};
+            std::vector<error_t> warnings{};
+            int syncBefore{0}; /**< The synchronisation kind used before the unit was checked. */
+            int syncAfter{0};
+            bool dirty{false};
+        };
+
+        Document& doc;
+        bool refinement;
+        std::vector<error_t> errors; /**< Diagnostics which were in the document before checking. */
+        std::vector<error_t> warnings;
+        std::vector<error_t> prologueErrors; /**< Diagnostics of the before/after update expressions. */
+        std::vector<error_t> prologueWarnings;
+        size_t publishedErrors; /**< The number of diagnostics put in the document by publish(). */
+        size_t publishedWarnings;
+        std::vector<unit_t> units;
+        std::set<symbol_t> changed;
+        CompileTimeComputableValues computable;
+        bool collected{false}; /**< Whether computable holds the values of the current layout. */
+
+        std::vector<unit_t> layout() const;
+        bool sameLayout() const;
+        void collect(const std::set<symbol_t>& invalidated);
+        void run(TypeChecker& checker, unit_t& unit, int& sync);
+        size_t runTemplates(const TypeChecker& checker, size_t first, uint32_t threads);
+        void publish();
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_INCREMENTALTYPECHECKER_H */
@@ -0,0 +1,100 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_INDEPENDENCE_H
+#define UTAP_INDEPENDENCE_H
+
+#include "utap/symbols.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace UTAP
+{
+    class Document;
+    struct edge_t;
+    struct instance_t;
+
+    /**
+     * The static independence relation over the edges of the processes
+     * of a type checked document, e.g. for partial-order reduction.
+     *
+     * Two edges are dependent if they belong to the same process, if
+     * one writes a global variable the other reads or writes, or if
+     * both synchronise on the same channel (any element of a channel
+     * array).  Reads and writes are those of the guard, synchronisation
+     * and update, with the bound parameters replaced by their arguments,
+     * and the reads of the invariant of the target location.  The
+     * variables of a process and its value parameters are private to it.
+     * A process set counts as a single process, so its edges are all
+     * dependent.
+     *
+     * Edges are numbered per process in system order, and within a
+     * process in the order of its template.  The relation is built from
+     * the edges accessing each variable and channel, so the cost is in
+     * the number of dependent pairs rather than all pairs, and is stored
+     * as a triangular bit matrix with constant time queries.
+     */
+    class Independence
+    {
+    public:
+        struct edge_ref_t
+        {
+            const instance_t* process;
+            const edge_t* edge;
+            uint32_t processNr; /**< The position of the process in Document::getProcesses() */
+            symbol_set_t reads, writes, channels; /**< The global symbols accessed */
+        };
+
+        explicit Independence(Document& doc);
+
+        /** Returns the edges in the order of their numbers. */
+        const std::vector<edge_ref_t>& getEdges() const { return edges; }
+        /** Returns the number of an edge of a process, or getEdges().size() if there is none. */
+        uint32_t getEdgeNr(const instance_t& process, const edge_t& edge) const;
+
+        /** Returns true if the edges are independent; an edge is dependent on itself. */
+        bool isIndependent(uint32_t a, uint32_t b) const
+        {
+            if (a == b)
+                return false;
+            const auto bit = a < b ? pairOf(b, a) : pairOf(a, b);
+            return (dependent[bit / 64] >> bit % 64 & 1u) == 0;
+        }
+        /** Returns the edges the given edge depends on, itself excluded, in increasing order. */
+        std::vector<uint32_t> getDependent(uint32_t edge) const;
+        /** Returns the number of dependent pairs of distinct edges. */
+        size_t getDependentPairs() const;
+
+    private:
+        std::vector<edge_ref_t> edges;
+        std::map<std::pair<const instance_t*, const edge_t*>, uint32_t> index;
+        std::vector<uint64_t> dependent; /**< Bit pairOf(a, b) is set if a > b are dependent */
+
+        static size_t pairOf(uint32_t a, uint32_t b) { return size_t{a} * (a - 1) / 2 + b; }
+        void markDependent(uint32_t a, uint32_t b);
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_INDEPENDENCE_H */
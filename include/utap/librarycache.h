@@ -0,0 +1,106 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_LIBRARYCACHE_H
+#define UTAP_LIBRARYCACHE_H
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+
+namespace UTAP
+{
+    /**
+     * The external function libraries loaded by the documents of the
+     * process (see the import declaration), shared between documents.
+     *
+     * A library is looked up once per name, search paths and working
+     * directory and loaded once per resolved path; the functions are
+     * resolved once per library.  Documents hold a Handle on the
+     * libraries they import, and a library stays loaded until purge() is
+     * called when no handle refers to it any more.  All members may be
+     * called concurrently.
+     */
+    class LibraryCache
+    {
+        struct library_t;
+
+    public:
+        /** A reference to a loaded library, or to none if it could not be loaded. */
+        class Handle
+        {
+        public:
+            Handle() = default;
+
+            explicit operator bool() const { return library != nullptr; }
+            /** Returns the path the library was loaded from, empty if none. */
+            const std::string& getPath() const;
+            /** Returns the function of the library, or nullptr if there is none. */
+            void* getFunction(const std::string& name) const;
+
+        private:
+            friend class LibraryCache;
+            explicit Handle(std::shared_ptr<library_t> library): library{std::move(library)} {}
+            std::shared_ptr<library_t> library;
+        };
+
+        /** Returns the cache of the process. */
+        static LibraryCache& instance();
+
+        /**
+         * Loads the library called name (".so" or ".dll" is appended if
+         * needed) from the working directory or else the first of the
+         * paths that has it; a path may be empty for the system search.
+         */
+        Handle load(const std::string& name, const std::vector<std::filesystem::path>& paths);
+
+        /** Unloads the libraries no handle refers to and forgets the lookups; returns the number unloaded. */
+        size_t purge();
+        /** Returns the number of libraries loaded. */
+        size_t size() const;
+
+    private:
+        struct library_t
+        {
+            std::string path;
+            void* handle;
+            std::unordered_map<std::string, void*> functions; /**< Resolved so far, guarded by the cache */
+            LibraryCache& cache;
+            library_t(std::string path, void* handle, LibraryCache& cache):
+                path{std::move(path)}, handle{handle}, cache{cache}
+            {}
+            ~library_t() noexcept;
+        };
+
+        mutable std::mutex mutex;
+        std::map<std::string, std::shared_ptr<library_t>> libraries; /**< By resolved path */
+        std::map<std::string, std::string> lookups; /**< Resolved path by working directory, name and search paths */
+
+        std::shared_ptr<library_t> open(const std::string& path);
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_LIBRARYCACHE_H */
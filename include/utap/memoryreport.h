@@ -0,0 +1,118 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_MEMORYREPORT_H
+#define UTAP_MEMORYREPORT_H
+
+#include "utap/common.h"
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <cstddef>
+
+namespace UTAP
+{
+    class Document;
+
+    /**
+     * The memory retained by a document, found by walking everything
+     * reachable from it.  Nodes shared by several expressions, types,
+     * symbols or documents are counted once, by the first path reaching
+     * them.
+     *
+     * A node accounts for its allocation (header included, rounded to
+     * the node alignment) and the buffers it owns, e.g. the subexpressions
+     * beyond those kept in place, the children of a type, the symbol table
+     * of a frame and the cached footprint and rendering of an expression, but
+     * not the nodes it refers to.  Containers account for their elements
+     * without slack.  Not included are the interned names of symbols,
+     * which are shared by all documents, and the allocator's overhead.
+     */
+    class MemoryReport
+    {
+    public:
+        struct item_t
+        {
+            size_t count{0};
+            size_t bytes{0};
+
+            item_t& operator+=(const item_t& other)
+            {
+                count += other.count;
+                bytes += other.bytes;
+                return *this;
+            }
+        };
+        enum category_t {
+            TYPES,
+            SYMBOLS,
+            FRAMES,
+            POSITIONS, /**< Document::getPositions(). */
+            STRINGS,   /**< Document::get_strings(). */
+            CATEGORIES
+        };
+        /** The locations and edges of a template. */
+        struct template_memory_t
+        {
+            std::string name;
+            item_t states;
+            item_t edges;
+        };
+
+        MemoryReport() = default;
+        /** Measures the document. */
+        explicit MemoryReport(Document& doc);
+
+        /** Returns the expression nodes by kind. */
+        const std::map<Constants::kind_t, item_t>& getExpressions() const { return expressions; }
+        const item_t& operator[](category_t category) const { return categories[category]; }
+        /** Returns the templates (dynamic ones included) in the order of the document. */
+        const std::vector<template_memory_t>& getTemplates() const { return templates; }
+        /** Returns the sum of all categories. */
+        size_t getTotal() const;
+
+        /** Returns true the first time it is called for the node, i.e. if it is still to be counted. */
+        bool enter(const void* node) { return visited.insert(node).second; }
+        void addExpression(Constants::kind_t kind, size_t bytes);
+        void add(category_t category, size_t bytes, size_t count = 1);
+
+        /** Returns the bytes taken by a node of the size, with its header. */
+        static size_t nodeBytes(size_t size);
+        /** Returns the bytes of the string including the buffer it owns, if not kept in place. */
+        static size_t stringBytes(const std::string& str);
+        /** Returns the bytes of the buffer owned by the string, 0 if kept in place. */
+        static size_t bufferBytes(const std::string& str);
+
+    private:
+        std::map<Constants::kind_t, item_t> expressions;
+        item_t categories[CATEGORIES];
+        std::vector<template_memory_t> templates;
+        std::unordered_set<const void*> visited;
+    };
+
+    /** Writes one line per category: its name, count and bytes separated by tabs. */
+    std::ostream& operator<<(std::ostream& os, const MemoryReport& report);
+}  // namespace UTAP
+
+#endif /* UTAP_MEMORYREPORT_H */
@@ -0,0 +1,75 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_MODELREDUCTION_H
+#define UTAP_MODELREDUCTION_H
+
+#include "utap/position.h"
+
+#include <string>
+#include <vector>
+
+namespace UTAP
+{
+    class Document;
+
+    /**
+     * Removes from a type checked document what cannot affect its
+     * behaviour, in this order:
+     *
+     * - edges whose guard is false for every process of the template,
+     *   i.e. with a conjunct depending on constants only (template
+     *   parameters included) which evaluates to false;
+     * - variables, global or local to a template, which are never read:
+     *   their assignments are dropped from the updates and function
+     *   bodies, unless they have other effects, and the variables from
+     *   the declarations and frames;
+     * - functions no longer called.
+     *
+     * Variables and functions whose names appear in a query are kept,
+     * as are constants and channels; a local read as the field of a
+     * process (P.x) is read.  The types of the processes follow the
+     * reduced frames of their templates.  The reduced document is not meant
+     * to be written to a file: comments and layout are not updated.
+     */
+    class ModelReduction
+    {
+    public:
+        enum removal_kind_t { EDGE, VARIABLE, FUNCTION };
+        struct removal_t
+        {
+            removal_kind_t kind;
+            std::string name;  /**< Qualified by the template if local, "P: A -> B" for edges */
+            position_t position; /**< Of the declaration, or of the guard of an edge */
+        };
+
+        /** Reduces the document. */
+        explicit ModelReduction(Document& doc);
+
+        /** Returns what was removed, edges first and in the order of the document. */
+        const std::vector<removal_t>& getRemovals() const { return removals; }
+
+    private:
+        std::vector<removal_t> removals;
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_MODELREDUCTION_H */
@@ -0,0 +1,173 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_NODE_H
+#define UTAP_NODE_H
+
+#include <atomic>
+#include <functional>  // less
+#include <new>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace UTAP
+{
+    /**
+     * Selects how the nodes behind expression_t, type_t, symbol_t and
+     * frame_t created on this thread count their references, until
+     * destroyed.  Nodes count atomically by default.  Local nodes count
+     * with plain loads and stores instead: handles to them must then only
+     * be copied and released by one thread at a time, i.e. a document
+     * built with local nodes stays on one thread and is processed with
+     * threads = 0 (see Document::setLocal).
+     */
+    class NodeScope
+    {
+    public:
+        explicit NodeScope(bool local);
+        NodeScope(const NodeScope&) = delete;
+        NodeScope& operator=(const NodeScope&) = delete;
+        ~NodeScope() noexcept;
+
+        /** Returns whether the nodes created on this thread now count their references for one thread. */
+        static bool isLocal();
+
+    private:
+        bool previous;
+    };
+
+    /** The reference count of a node created by make_node, placed before the node. */
+    struct node_header_t
+    {
+        std::atomic<uint32_t> refs{1};
+        bool local{false};                         /**< Counted without atomic instructions. */
+        void (*destroy)(node_header_t*) noexcept;  /**< Destroys the node and releases its memory. */
+    };
+    inline constexpr size_t node_alignment = alignof(std::max_align_t);
+    /** The distance from the header to the node. */
+    inline constexpr size_t node_offset = (sizeof(node_header_t) + node_alignment - 1) / node_alignment * node_alignment;
+
+    /**
+     * Intrusively counted handle to a node created by make_node, used by
+     * expression_t, type_t, symbol_t and frame_t in place of shared_ptr:
+     * it is one pointer wide, and copies of handles to local nodes are
+     * not atomic.
+     */
+    template <typename T>
+    class node_ptr
+    {
+    public:
+        constexpr node_ptr() noexcept = default;
+        constexpr node_ptr(std::nullptr_t) noexcept {}
+        /** Shares the node created by make_node at the address. */
+        explicit node_ptr(T* node) noexcept: header{node == nullptr ? nullptr : headerOf(node)} { acquire(); }
+        node_ptr(const node_ptr& other) noexcept: header{other.header} { acquire(); }
+        node_ptr(node_ptr&& other) noexcept: header{std::exchange(other.header, nullptr)} {}
+        ~node_ptr() noexcept { release(); }
+
+        node_ptr& operator=(node_ptr other) noexcept
+        {
+            std::swap(header, other.header);
+            return *this;
+        }
+
+        T* get() const noexcept
+        {
+            return header == nullptr ? nullptr
+                                     : reinterpret_cast<T*>(reinterpret_cast<char*>(header) + node_offset);
+        }
+        T* operator->() const noexcept { return get(); }
+        T& operator*() const noexcept { return *get(); }
+        explicit operator bool() const noexcept { return header != nullptr; }
+
+        friend bool operator==(const node_ptr& a, const node_ptr& b) noexcept { return a.header == b.header; }
+        friend bool operator!=(const node_ptr& a, const node_ptr& b) noexcept { return a.header != b.header; }
+        friend bool operator<(const node_ptr& a, const node_ptr& b) noexcept
+        {
+            return std::less<const node_header_t*>{}(a.header, b.header);
+        }
+        friend bool operator==(const node_ptr& a, std::nullptr_t) noexcept { return a.header == nullptr; }
+        friend bool operator!=(const node_ptr& a, std::nullptr_t) noexcept { return a.header != nullptr; }
+
+    private:
+        template <typename U, typename... Args>
+        friend node_ptr<U> make_node(Args&&... args);
+
+        node_header_t* header{nullptr};
+
+        static node_header_t* headerOf(T* node) noexcept
+        {
+            return reinterpret_cast<node_header_t*>(reinterpret_cast<char*>(node) - node_offset);
+        }
+
+        void acquire() const noexcept
+        {
+            if (header == nullptr)
+                return;
+            if (header->local)
+                header->refs.store(header->refs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            else
+                header->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void release() noexcept
+        {
+            if (header == nullptr)
+                return;
+            if (header->local) {
+                const auto refs = header->refs.load(std::memory_order_relaxed) - 1;
+                if (refs != 0) {
+                    header->refs.store(refs, std::memory_order_relaxed);
+                    return;
+                }
+            } else if (header->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                return;
+            }
+            header->destroy(header);
+        }
+    };
+
+    /** Creates a node counted as selected by the innermost NodeScope on this thread. */
+    template <typename T, typename... Args>
+    node_ptr<T> make_node(Args&&... args)
+    {
+        static_assert(alignof(T) <= node_alignment);
+        void* memory = ::operator new(node_offset + sizeof(T));
+        try {
+            new (static_cast<char*>(memory) + node_offset) T(std::forward<Args>(args)...);
+        } catch (...) {
+            ::operator delete(memory);
+            throw;
+        }
+        auto res = node_ptr<T>{};
+        res.header = new (memory) node_header_t{};
+        res.header->local = NodeScope::isLocal();
+        res.header->destroy = [](node_header_t* header) noexcept {
+            reinterpret_cast<T*>(reinterpret_cast<char*>(header) + node_offset)->~T();
+            header->~node_header_t();
+            ::operator delete(header);
+        };
+        return res;
+    }
+}  // namespace UTAP
+
+#endif /* UTAP_NODE_H */
@@ -26,7 +26,10 @@
 #include <iosfwd>
 #include <limits>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
+#include <cstdint>
 
 namespace UTAP
 {
@@ -77,19 +80,71 @@ namespace UTAP
         };
 
     private:
-        std::vector<line_t> elements;
-        const line_t& find(uint32_t position, uint32_t first, uint32_t last) const;
+        /**
+         * Every block_size-th line is stored in full and the lines in
+         * between as deltas to their predecessor, thus find() is a binary
+         * search over the blocks followed by decoding at most block_size
+         * lines.
+         *
+         * Paths are interned as nodes of a tree of their '/' separated
+         * steps, so a path is stored once as a pair of its parent path
+         * and its last step, and common steps like "label[1]" are only
+         * stored once as well.
+         */
+        static constexpr uint32_t block_size = 32;
+        struct entry_t
+        {
+            uint32_t position;
+            uint32_t offset;
+            uint32_t line;
+            uint32_t path; /**< Index into nodes. */
+        };
+        struct block_t
+        {
+            entry_t first;
+            uint32_t deltas; /**< Index into deltas of the lines following first. */
+        };
+        struct node_t
+        {
+            uint32_t parent; /**< Index into nodes, the root (the path without steps) is at 0. */
+            uint32_t step;   /**< Index into steps. */
+        };
+        std::vector<block_t> blocks;
+        std::vector<uint8_t> deltas;
+        std::vector<node_t> nodes{{0, 0}};
+        std::vector<uint32_t> slots; /**< Open addressing table of the nodes other than the root. */
+        std::vector<std::string> steps;
+        std::unordered_map<std::string, uint32_t> stepIndex;
+        std::string lastPath; /**< The path of the last line added. */
+        entry_t last{};       /**< The last line added. */
+        uint32_t size{0};     /**< The number of lines added. */
+
+        uint32_t intern(const std::string& path);
+        uint32_t child(uint32_t parent, uint32_t step);
+        std::string getPath(uint32_t node) const;
+        void encode(const entry_t& entry);
+        static void step(const uint8_t*& next, entry_t& entry);
+        line_t decode(const entry_t& entry) const { return {entry.position, entry.offset, entry.line, getPath(entry.path)}; }
 
     public:
         /** Add information about a line to the container. */
-        void add(uint32_t position, uint32_t offset, uint32_t line, std::string path);
+        void add(uint32_t position, uint32_t offset, uint32_t line, const std::string& path);
 
         /**
          * Retrieves information about the line containing the given
          * position. The last line in the container is considered to
          * extend to inifinity (until another line is added).
          */
-        const line_t& find(uint32_t position) const;
+        line_t find(uint32_t position) const;
+
+        /** Returns all lines in the order they were added. */
+        std::vector<line_t> getLines() const;
+
+        /** Returns the number of lines added. */
+        uint32_t getSize() const { return size; }
+
+        /** Returns the (approximate) number of bytes allocated by the container. */
+        size_t getMemoryUsage() const;
 
         /** Dump table to stdout. */
         void dump();
@@ -108,6 +163,8 @@ namespace UTAP
             start{std::move(start)}, end{std::move(end)}, position{pos}, msg{std::move(msg)}, context{std::move(ctx)}
         {}
         std::string toString() const;
+        /** Returns the key of the message, e.g. "$Unknown_identifier", or an empty view if it has none. */
+        std::string_view getCode() const;
     };
 }  // namespace UTAP
 
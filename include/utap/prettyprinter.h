@@ -27,18 +27,48 @@
 #include <iosfwd>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cstdint>
 
 namespace UTAP
 {
+    /**
+     * Prints the parsed model as XTA text.  Expressions and the bodies
+     * of compound statements are fragments of one growing buffer: a
+     * fragment is a chain of pieces of the buffer, so wrapping an
+     * expression in an operator or a statement in a loop appends the
+     * new text and links the pieces instead of copying what was printed
+     * so far.  Top level text is collected and written to the stream in
+     * large blocks, at the latest when parsing is done or the printer is
+     * destroyed.
+     */
     class PrettyPrinter : public AbstractBuilder
     {
     private:
-        std::vector<std::string> st;
+        struct piece_t
+        {
+            uint32_t offset;  // in chars
+            uint32_t length;
+            uint32_t next;  // the following piece of the fragment, npos at the end
+        };
+        struct fragment_t
+        {
+            uint32_t first;
+            uint32_t last;
+        };
+        static constexpr uint32_t npos = UINT32_MAX;
+
+        std::ostream& stream;
+        std::string buffer;  // top level text not yet written to the stream
+        std::string chars;
+        std::vector<piece_t> pieces;
+        size_t compactAt;              // rebuild chars and pieces when they grow beyond
+        std::vector<fragment_t> st;    // expressions
+        std::vector<fragment_t> body;  // text of the enclosing compound statements, innermost last
         std::stack<std::string> type;
         std::stack<std::string> array;
         std::vector<std::string> fields;
-        std::stack<std::ostream*> o;
         std::set<std::string> types;
         std::string branchpoints;
         std::string urgent;
@@ -50,11 +80,31 @@ namespace UTAP
         bool first;
         uint32_t level;
 
+        fragment_t text(std::string_view s);
+        fragment_t text(char c) { return text(std::string_view{&c, 1}); }
+        fragment_t text(fragment_t f) { return f; }
+        fragment_t join(fragment_t head, fragment_t tail);
+        template <typename... Parts>
+        fragment_t cat(const Parts&... parts);
+        std::string str(fragment_t f) const;
+        void push(fragment_t f);
+        fragment_t pop();
+        /** Pops the last n expressions and joins them in order between open and close. */
+        fragment_t popList(uint32_t n, std::string_view open, std::string_view separator, std::string_view close);
+        void compact();
+
+        void emit(std::string_view s);
+        void emit(char c) { emit(std::string_view{&c, 1}); }
+        void emit(fragment_t f);  // consumes the fragment
+        template <typename... Parts>
+        void write(const Parts&... parts);
+        void flush();
+
         void indent();
-        void indent(std::string& s);
 
     public:
         PrettyPrinter(std::ostream& stream);
+        ~PrettyPrinter() noexcept override;
 
         void addPosition(uint32_t position, uint32_t offset, uint32_t line, const std::string& path) override;
 
@@ -0,0 +1,75 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+
+#ifndef UTAP_QUERYPARSER_H
+#define UTAP_QUERYPARSER_H
+
+#include "utap/document.h"
+#include "utap/typechecker.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace UTAP
+{
+    /** A query parsed and type checked by QueryParser. */
+    struct property_t
+    {
+        query_t query{};
+        expression_t expression{};     /**< The formula, empty if it could not be parsed. */
+        std::vector<error_t> errors{}; /**< Lines count from the start of the formula. */
+        std::vector<error_t> warnings{};
+        /**
+         * The string literals of the formula which are not strings of the
+         * document.  They are numbered from the number of strings of the
+         * document on.
+         */
+        std::vector<std::string> strings{};
+    };
+
+    /**
+     * Parses and type checks queries against the global declarations of
+     * a parsed and type checked document, without reading the model
+     * again.  The document is not changed: the diagnostics are kept with
+     * each query instead.  Thus one parser can be used by any number of
+     * threads at once, as long as the document is not modified
+     * meanwhile.
+     */
+    class QueryParser
+    {
+    public:
+        explicit QueryParser(const Document& doc);
+
+        property_t parse(const query_t& query) const;
+        /** Parses the queries using \a threads worker threads; the result is in the order of the queries. */
+        std::vector<property_t> parse(const std::vector<query_t>& queries, uint32_t threads = 0) const;
+
+    private:
+        Document& doc;
+        TypeChecker checker; /**< Copied by every parse, which then owns its diagnostics. */
+
+        property_t parse(TypeChecker& checker, const query_t& query) const;
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_QUERYPARSER_H */
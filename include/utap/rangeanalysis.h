@@ -0,0 +1,87 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_RANGEANALYSIS_H
+#define UTAP_RANGEANALYSIS_H
+
+#include "utap/range.h"
+#include "utap/symbols.h"
+
+#include <map>
+#include <vector>
+#include <cstdint>
+
+namespace UTAP
+{
+    class Document;
+    struct instance_t;
+
+    /**
+     * Interval analysis of the integer, Boolean and scalar set variables
+     * of a type checked document: the bounds found enclose every value a variable
+     * (or element of an array or record) takes in the reachable states.
+     *
+     * The locals of each process are tracked per location and the global
+     * variables once for the whole system.  Guards and invariants narrow
+     * the values, updates and the bodies of the functions they call are
+     * interpreted with the variables of the edge, and loops and cycles
+     * are widened to the constants compared against and the declared
+     * bounds.  Synchronisations, clocks and priorities are ignored, which
+     * only adds values.  A process set stands for all its instances, and
+     * a dynamic template for all the processes it may spawn.
+     *
+     * Arrays and records take one element per scalar, in the order of
+     * their declaration (as in the state vector of BytecodeCompiler).
+     * Variables of other types, e.g. clocks, doubles and channels, are
+     * not analysed and read as any value.
+     */
+    class RangeAnalysis
+    {
+    public:
+        using range_type = range_t<int32_t>;
+        using elements_t = std::vector<range_type>;
+
+        /**
+         * Analyses the document, which must be free of errors.  Unless
+         * reachable is set, the bounds are the declared ranges (and the
+         * values of constants), which takes no iteration.
+         */
+        explicit RangeAnalysis(Document& doc, bool reachable = true);
+
+        /** Returns the bounds of the elements of a global variable or constant, nullptr if it is not analysed. */
+        const elements_t* getElements(const symbol_t& variable) const;
+        /**
+         * Returns the bounds of the elements of a variable, constant or
+         * parameter of the process (or dynamic template), nullptr if it
+         * is not analysed.
+         */
+        const elements_t* getElements(const instance_t& process, const symbol_t& variable) const;
+        /** Returns the union of the bounds of the elements, empty if the variable is not analysed. */
+        range_type getRange(const symbol_t& variable) const;
+        range_type getRange(const instance_t& process, const symbol_t& variable) const;
+
+    private:
+        std::map<symbol_t, elements_t> globals;
+        std::map<const instance_t*, std::map<symbol_t, elements_t>> locals;
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_RANGEANALYSIS_H */
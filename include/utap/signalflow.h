@@ -30,8 +30,13 @@
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
+#include <limits>
 #include <stack>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
 
 namespace UTAP
 {
@@ -48,13 +53,12 @@ namespace UTAP
      *
      * The document must be built by TypeChecker/DocumentBuilder before
      * SignalFlow.  Simply create using constructor and then use
-     * print* methods.  The rest of methods are used internally by
-     * visitor pattern.  Feel free to add new print* methods or
-     * inheriting classes.
+     * print* methods or getGraph().  Feel free to add new print*
+     * methods or inheriting classes.
      *
      * Author: Marius Mikucionis <marius@cs.aau.dk>
      */
-    class SignalFlow : public StatementVisitor
+    class SignalFlow
     {
     public:
         using strset_t = std::set<std::string>;                // string set
@@ -74,33 +78,50 @@ namespace UTAP
         using str2procset_t = std::map<const std::string, procset_t>;
         using exprref_t = std::map<const symbol_t, expression_t>;  // fn-params
 
+        /** Compressed adjacency lists: the targets of node i are targets[offsets[i]..offsets[i+1]). */
+        struct adjacency_t
+        {
+            std::vector<uint32_t> offsets{0};
+            std::vector<uint32_t> targets;
+
+            uint32_t nodes() const { return static_cast<uint32_t>(offsets.size() - 1); }
+            uint32_t size(uint32_t i) const { return offsets[i + 1] - offsets[i]; }
+            const uint32_t* begin(uint32_t i) const { return targets.data() + offsets[i]; }
+            const uint32_t* end(uint32_t i) const { return targets.data() + offsets[i + 1]; }
+        };
+
+        /**
+         * The I/O information as a graph over dense identifiers.  Processes
+         * are numbered in system order, channels and variables in the order
+         * of their names.  All adjacency lists are sorted and free of
+         * duplicates.
+         */
+        struct graph_t
+        {
+            static constexpr uint32_t noChannel = std::numeric_limits<uint32_t>::max();
+            std::vector<std::string> processes, channels, variables;  // names by identifier
+            adjacency_t inputs, outputs;  // process -> channels received/sent on
+            adjacency_t reads, writes;    // process -> variables read/written
+            /**
+             * Channels synchronised on while accessing the variables,
+             * indexed by position in reads.targets (writes.targets): e.g.
+             * readChannels.begin(reads.offsets[p] + i) lists the channels
+             * of the ith variable read by p, with noChannel (last) for
+             * accesses without synchronisation.
+             */
+            adjacency_t readChannels, writeChannels;
+            adjacency_t receivers, transmitters;  // channel -> processes receiving/sending on it
+            adjacency_t readers, writers;         // variable -> processes reading/writing it
+        };
+
     protected:
         int verbosity{0};                       // 0 - silent, 1 - errors, 2 - warnings, 3 - diagnostics
         const std::string title;                // title of the Uppaal TA document
-        procset_t procs;                        // list of all processes in the system
+        graph_t graph;                          // the I/O information extracted from the document
+        std::vector<std::unique_ptr<proc_t>> procList;  // processes in system order
+        procset_t procs;                        // list of all processes in the system, by address
         str2procset_t receivers, transmitters;  // processes sorted by vars/chans
         strset_t processes, channels, variables;
-        proc_t* cTA{nullptr};     // current automaton in traversal
-        instance_t* cP{nullptr};  // current process in traversal
-        std::string cChan;        // channel on current transition in traversal
-        std::string chanString;
-        bool inp{false}, out{false}, sync{false}, paramsExpanded{false};  // current expression state
-        std::stack<std::pair<bool, bool> > ioStack;                       // remember I/O state
-        std::stack<exprref_t> refparams;                                  // parameter passed by reference
-        std::stack<exprref_t> valparams;                                  // parameter passed by value
-
-        bool checkParams(const symbol_t& s);  // maps parameter to global symbol
-        void addChan(const std::string&, strset_t&, str2procset_t&);
-        void addVar(const symbol_t&, str2strset_t&, str2procset_t&);
-        void visitProcess(instance_t&);
-        void visitExpression(const expression_t&);
-        void pushIO() { ioStack.push(std::make_pair(inp, out)); }
-        void popIO()
-        {
-            inp = ioStack.top().first;
-            out = ioStack.top().second;
-            ioStack.pop();
-        }
 
         /* prints list of processes with their look-attributes */
         virtual void printProcsForDot(std::ostream& os, bool erd);
@@ -117,9 +138,11 @@ namespace UTAP
 
     public:
         /**
-         * Analyse the document and extract I/O information:
+         * Analyse the document and extract I/O information.  If threads
+         * is positive, then the processes are analysed by that many
+         * worker threads; the result does not depend on it.
          */
-        SignalFlow(const std::string& title, Document& doc);
+        SignalFlow(const std::string& title, Document& doc, uint32_t threads = 0);
 
         void setVerbose(int verbose) { verbosity = verbose; }
         /**
@@ -127,6 +150,9 @@ namespace UTAP
          */
         virtual ~SignalFlow();
 
+        /** Returns the I/O information as a graph. */
+        const graph_t& getGraph() const { return graph; }
+
         /**
          * Print I/O information in TRON format into given output stream.
          */
@@ -139,26 +165,6 @@ namespace UTAP
          * cEdged -- channels are printed on edges rather than separate nodes.
          */
         virtual void printForDot(std::ostream& os, bool ranked, bool erd, bool cEdged);
-
-        /**
-         * System visitor pattern extracts read/write information from UCode.
-         * This is actually "const" visitor and should contain "const Statement *stat".
-         */
-        int32_t visitEmptyStatement(EmptyStatement* stat) override;
-        int32_t visitExprStatement(ExprStatement* stat) override;
-        int32_t visitForStatement(ForStatement* stat) override;
-        int32_t visitIterationStatement(IterationStatement* stat) override;
-        int32_t visitWhileStatement(WhileStatement* stat) override;
-        int32_t visitDoWhileStatement(DoWhileStatement* stat) override;
-        int32_t visitBlockStatement(BlockStatement* stat) override;
-        int32_t visitSwitchStatement(SwitchStatement* stat) override;
-        int32_t visitCaseStatement(CaseStatement* stat) override;
-        int32_t visitDefaultStatement(DefaultStatement* stat) override;
-        int32_t visitIfStatement(IfStatement* stat) override;
-        int32_t visitBreakStatement(BreakStatement* stat) override;
-        int32_t visitContinueStatement(ContinueStatement* stat) override;
-        int32_t visitReturnStatement(ReturnStatement* stat) override;
-        int32_t visitAssertStatement(UTAP::AssertStatement* stat) override;
     };
 
     /**
@@ -233,6 +239,7 @@ namespace UTAP
      *    only during observable input/output channel synchronization.
      * 5) process belongs to environment (IUT) if accesses environment (IUT)
      *    variable (respectively) without observable channel synchronization.
+     * An entity reached by the rules from both sides is inconsistent.
      * Returns:
      *  0 if partitioning was consistent and complete,
      *  1 if partitioning was consistent but incomplete (some proc/chan is free)
@@ -240,6 +247,15 @@ namespace UTAP
      */
     class Partitioner : public SignalFlow
     {
+    public:
+        /** The side of each process, channel and variable of the graph, by identifier. */
+        struct partition_t
+        {
+            enum side_t : uint8_t { FREE, ENV, IUT, BAD };
+            std::vector<side_t> processes, channels, variables;
+            int status{0};  // the result of partition()
+        };
+
     protected:
         procset_t procsEnv, procsIUT, procsBad;
         strset_t chansIntEnv, chansIntIUT, observable, chansBad;
@@ -247,16 +263,28 @@ namespace UTAP
         strset_t chansInp, chansOut;
         std::string rule;
 
-        void addProcs(const strset_t& chans, const str2procset_t& index, procset_t& result, procset_t& exclude);
-        void addIntChans(const procset_t& procs, strset_t& result, strset_t& exclude);
-        void addIntVars(const procset_t& procs, strset_t& result, strset_t& exclude);
-        void addProcsByVars(const strset_t& vars, procset_t& procs, procset_t& exclude);
+        /*
+         * Applies the rules from the observable channels over the
+         * internal channels and accesses and reports additions and
+         * violations to cerr if trace is set.
+         */
+        partition_t analyse(const strset_t& inputs, const strset_t& outputs, bool trace) const;
 
     public:
-        Partitioner(const std::string& title, Document& doc): SignalFlow{title, doc} {}
+        Partitioner(const std::string& title, Document& doc, uint32_t threads = 0);
 
         int partition(const strset_t& inputs, const strset_t& outputs);
         int partition(std::istream& ioinfo);
+        /** Partitions without changing the partitioner (may be called concurrently). */
+        partition_t getPartition(const strset_t& inputs, const strset_t& outputs) const
+        {
+            return analyse(inputs, outputs, false);
+        }
+        /** Partitions for each of the input/output rule sets, using the given number of worker threads. */
+        std::vector<partition_t> getPartitions(const std::vector<std::pair<strset_t, strset_t>>& ioinfos,
+                                               uint32_t threads = 0) const;
+        /** Reads the input and output channels of a TRON I/O specification. */
+        static void readIOInfo(std::istream& ioinfo, strset_t& inputs, strset_t& outputs);
         void printForDot(std::ostream& os, bool ranked, bool erd, bool cEdged) override;
         void printViolation(const proc_t* process, const std::string& variable);
         void fillWithEnvProcs(strset_t& procs);
@@ -273,10 +301,10 @@ namespace UTAP
      */
     class DistanceCalculator : public SignalFlow
     {
-        strset_t varNeedles;   // set of variables of interest
-        strset_t procNeedles;  // set of processes of interest
-        bool distancesUpToDate;
+    public:
+        static constexpr auto unreachable = std::numeric_limits<uint32_t>::max();
 
+    private:
         struct dist_t  // distance structure
         {
             static constexpr auto maximum = std::numeric_limits<int32_t>::max();
@@ -285,13 +313,19 @@ namespace UTAP
             uint32_t distance{0};    // accumulated complexity|hops to closest needle
         };
 
-        using str2dist_t = std::map<std::string, dist_t>;
-
-        str2dist_t distances;
+        /*
+         * Nodes are the processes of the graph followed by its variables.
+         * A process depends on the processes sending on the channels it
+         * receives on and on the variables it reads; a variable on the
+         * processes writing it.
+         */
+        adjacency_t successors;                            // node -> nodes it depends on
+        std::unordered_map<std::string, uint32_t> nodeIds;  // node by process or variable name
+        std::vector<dist_t> distances;                     // by node
+        std::vector<bool> needles;                         // nodes of interest
+        bool distancesUpToDate;
 
-        void updateDistancesFromVariable(const std::string& name, const dist_t* distance);
-        void updateDistancesFromProcess(const std::string& name, const dist_t* distance);
-        uint32_t calcComplexity(const std::string& process);
+        void addNeedle(uint32_t node);
 
     protected:
         Document& doc;
@@ -301,9 +335,7 @@ namespace UTAP
         void printVarsForDot(std::ostream& os, bool ranked, bool erd) override;
 
     public:
-        DistanceCalculator(const std::string& title, Document& doc):
-            SignalFlow{title, doc}, distancesUpToDate{false}, doc{doc}
-        {}
+        DistanceCalculator(const std::string& title, Document& doc, uint32_t threads = 0);
         /** adds a variable needle to I/O map */
         void addVariableNeedle(const std::string& var);
         /** adds a variable needle to I/O map */
@@ -313,6 +345,24 @@ namespace UTAP
         /** Finds a distance measure for given element */
         uint32_t getDistance(const std::string& element);
 
+        /** Returns the node of a process or variable, or unreachable if there is none. */
+        uint32_t getNode(const std::string& name) const;
+        /** Returns the number of nodes: processes, followed by variables. */
+        uint32_t getNodeCount() const { return successors.nodes(); }
+        /**
+         * Computes the number of hops from each source node to every node
+         * (unreachable if there is no path) by breadth-first search over
+         * frontier bitsets.  Row i holds the hops from sources[i], rows
+         * are computed by the given number of worker threads.
+         */
+        std::vector<std::vector<uint32_t>> getHops(const std::vector<uint32_t>& sources, uint32_t threads = 0) const;
+        /**
+         * Same as above, from the named processes or variables, e.g. the
+         * IUT processes found by Partitioner::fillWithIUTProcs.  Rows
+         * follow the order of the names, unknown names are skipped.
+         */
+        std::vector<std::vector<uint32_t>> getHops(const strset_t& sources, uint32_t threads = 0) const;
+
         /* overwritten to update the distances on demand. */
         void printForDot(std::ostream& os, bool ranked, bool erd, bool cEdged) override;
     };
@@ -0,0 +1,87 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_SIMPLIFIER_H
+#define UTAP_SIMPLIFIER_H
+
+#include "utap/expression.h"
+#include "utap/typechecker.h"
+
+#include <vector>
+#include <cstddef>
+
+namespace UTAP
+{
+    class Document;
+    struct function_t;
+
+    /**
+     * Constant folding and inlining of small functions in the
+     * expressions of a type checked document.
+     *
+     * Integer and Boolean subexpressions which only read constants with
+     * an initialiser (see CompileTimeComputableValues) are replaced by
+     * their value, and conjunctions, disjunctions and conditionals with
+     * a constant operand by the operand taken.  Calls of non-recursive
+     * functions without local variables are inlined when the body is a
+     * single return statement without side effects or, in updates, when
+     * the function returns nothing and its body has at most
+     * maxStatements expression statements.  Arguments are substituted
+     * for the parameters, so they must be free of side effects and, when
+     * the body has side effects, of reads of what it changes; the ranges
+     * of value parameters are not checked on inlined calls.
+     *
+     * Folded constants take the position of the subexpression they
+     * replace; inlined code keeps the positions in the body of the
+     * function and the arguments those of the call.
+     */
+    class Simplifier
+    {
+    public:
+        explicit Simplifier(Document& doc, size_t maxStatements = 4);
+
+        /** Returns the expression simplified, or the expression itself if nothing changed. */
+        expression_t simplify(const expression_t& expr);
+        /** Simplifies an expression whose value is ignored, e.g. an update; empty if nothing is left. */
+        expression_t simplifyUpdate(const expression_t& expr);
+        /** Simplifies the invariants, rates, guards, synchronisations, updates and probabilities of all templates. */
+        void simplifyTemplates();
+
+        /** Returns the number of subexpressions replaced by constants. */
+        size_t getFolded() const { return folded; }
+        /** Returns the number of calls inlined. */
+        size_t getInlined() const { return inlined; }
+
+    private:
+        Document& doc;
+        CompileTimeComputableValues computable;
+        size_t maxStatements;
+        std::vector<const function_t*> inlining; /**< The functions being inlined, innermost last. */
+        size_t folded{0};
+        size_t inlined{0};
+
+        bool fold(const expression_t& expr, int32_t& value) const;
+        expression_t simplifyOperands(const expression_t& expr);
+        bool inlineCall(const expression_t& call, bool update, expression_t& result);
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_SIMPLIFIER_H */
@@ -0,0 +1,107 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+
+#ifndef UTAP_SOURCEINDEX_H
+#define UTAP_SOURCEINDEX_H
+
+#include "utap/expression.h"
+#include "utap/position.h"
+#include "utap/symbols.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace UTAP
+{
+    /**
+     * Index from positions to the expressions and symbols parsed at
+     * them, for answering "what is at this position" and "where is this
+     * symbol used" without visiting the document.  The builders created
+     * after Document::enableSourceIndex() fill it while parsing: every
+     * expression on the expression stack, and every symbol declared in a
+     * frame when the frame is closed.
+     *
+     * Positions are the absolute positions of position_t, which
+     * Document::findPosition() relates to the XML elements and lines.
+     * Both kinds of lookups take logarithmic time.  Elements re-parsed
+     * in place (see reparseXMLElement) are indexed again, their old
+     * expressions are not removed.  Builders may add to the index from
+     * several threads at once.
+     */
+    class SourceIndex
+    {
+    public:
+        /** Records an expression; identifiers are also recorded as uses of their symbol. */
+        void addExpression(const expression_t& expr);
+
+        /** Records the declaration of a symbol. */
+        void addDeclaration(const symbol_t& symbol);
+
+        /** Returns the innermost expression containing the position, or an empty expression. */
+        expression_t findExpression(uint32_t position) const;
+
+        /** Returns the symbol declared or referred to by an identifier at the position, or an empty symbol. */
+        symbol_t findSymbol(uint32_t position) const;
+
+        /** Returns the identifiers referring to the symbol, in parse order. */
+        const std::vector<expression_t>& getUses(const symbol_t& symbol) const;
+
+    private:
+        /**
+         * An interval tree over the positions: a list sorted by start
+         * (and by end in decreasing order) and an implicit binary tree of
+         * the maximal ends.  The innermost interval containing a position
+         * is the last one starting before the position and ending after
+         * it, which a single descent of the tree finds.  Sorted lazily.
+         */
+        template <typename T>
+        class Intervals
+        {
+        public:
+            void add(const position_t& position, T value);
+            T find(uint32_t position) const;
+
+        private:
+            struct entry_t
+            {
+                position_t position;
+                T value;
+            };
+            mutable std::vector<entry_t> entries;
+            mutable std::vector<uint32_t> ends; /**< The maximal end of every subtree, root at 1. */
+            mutable size_t leaves{0};
+            mutable bool sorted{true};
+            mutable std::mutex mutex;
+
+            void sort() const;
+            int64_t rightmost(size_t node, size_t first, size_t last, size_t count, uint32_t position) const;
+        };
+
+        Intervals<expression_t> expressions;
+        Intervals<symbol_t> symbols;
+        std::unordered_map<symbol_t, std::vector<expression_t>> uses;
+        mutable std::mutex mutex; /**< Guards uses. */
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_SOURCEINDEX_H */
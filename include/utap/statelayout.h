@@ -0,0 +1,107 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_STATELAYOUT_H
+#define UTAP_STATELAYOUT_H
+
+#include "utap/range.h"
+#include "utap/symbols.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace UTAP
+{
+    class Document;
+    class RangeAnalysis;
+    struct instance_t;
+
+    /**
+     * A bit-packed layout of the discrete state of a document: every
+     * global variable and every variable and value parameter of the
+     * processes that RangeAnalysis covers (integers, Booleans, scalar
+     * sets and arrays and records of them) is given one field per
+     * element, just wide enough for the values of the element.
+     *
+     * The state is a sequence of 64-bit words.  Fields are packed with
+     * the widest first into the fullest word they fit in, so no field
+     * straddles a word and each is read with a single load, shift and
+     * mask.  A field holds the value minus its lower bound; elements
+     * taking a single value take no bits.  Constants, reference
+     * parameters and variables with other elements (e.g. clocks and
+     * doubles) are left out.  A process set holds the fields of each of
+     * its instances in turn, in the order of its unbound parameters.
+     */
+    class StateLayout
+    {
+    public:
+        static constexpr uint32_t wordBits = 64;
+
+        struct field_t
+        {
+            int32_t lower{0};   /**< The value stored as 0 */
+            uint32_t offset{0}; /**< The first bit from the start of the state */
+            uint32_t width{0};  /**< The number of bits, at most 32 */
+        };
+        struct variable_layout_t
+        {
+            const instance_t* process; /**< The owner, nullptr for globals */
+            symbol_t uid;
+            uint32_t instances; /**< The instances of the process set, 1 otherwise */
+            std::vector<field_t> fields; /**< The elements of each instance */
+        };
+
+        /** Lays out the bounds found by the analysis of the document. */
+        StateLayout(Document& doc, const RangeAnalysis& analysis);
+        /** Lays out the declared ranges of the variables of the document. */
+        explicit StateLayout(Document& doc);
+
+        /** Returns the variables, globals first, in the order of declaration. */
+        const std::vector<variable_layout_t>& getVariables() const { return variables; }
+        /** Returns the layout of a global variable, nullptr if it is not part of the state. */
+        const variable_layout_t* find(const symbol_t& variable) const;
+        /** Returns the layout of a variable or parameter of the process, nullptr if it is not part of the state. */
+        const variable_layout_t* find(const instance_t& process, const symbol_t& variable) const;
+        /** Returns the bits used, i.e. the sum of the widths. */
+        size_t getBits() const { return bits; }
+        size_t getWords() const { return words; }
+        size_t getBytes() const { return words * sizeof(uint64_t); }
+
+        static int32_t get(const uint64_t* state, const field_t& field);
+        /** Stores the value, which must be within the bounds of the field. */
+        static void set(uint64_t* state, const field_t& field, int32_t value);
+
+    private:
+        std::vector<variable_layout_t> variables;
+        size_t bits{0};
+        size_t words{0};
+        std::map<std::pair<const instance_t*, symbol_t>, size_t> index;
+
+        void add(const instance_t* process, const symbol_t& uid, uint32_t instances,
+                 const std::vector<range_t<int32_t>>& elements);
+        void pack();
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_STATELAYOUT_H */
@@ -0,0 +1,161 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_STATISTICS_H
+#define UTAP_STATISTICS_H
+
+#include <chrono>
+#include <iosfwd>
+#include <cstdint>
+
+namespace UTAP
+{
+    class Document;
+
+    /**
+     * Where the parsing entry points spend their time and allocations,
+     * collected only when enabled (see Document::getStatistics()).
+     *
+     * A phase is timed from entering to leaving it, minus the phases
+     * nested in it: the semantic actions of the parser calling the
+     * builder count for the builder (from the first call until the next
+     * token), the labels parsed while reading XML count for the parser
+     * and so on.  Only the thread calling the entry point is measured,
+     * i.e. the templates parsed by worker threads are not.
+     */
+    class Statistics
+    {
+    public:
+        enum phase_t {
+            XML,         /**< Reading XML with libxml2. */
+            PARSER,      /**< Lexing and parsing with Flex and Bison. */
+            BUILDER,     /**< Building the document from the parsed text. */
+            BUILTINS,    /**< Adding the builtin declarations. */
+            LIBRARIES,   /**< Loading external libraries. */
+            TYPECHECKER, /**< Type checking. */
+            FEATURES,    /**< Finding the supported methods. */
+            PHASES
+        };
+        enum count_t { EXPRESSIONS, TYPES, SYMBOLS, FRAMES, TEMPLATES, EDGES, INSTANCES, COUNTS };
+
+        struct phase_statistics_t
+        {
+            std::chrono::nanoseconds time{0};
+            uint64_t entries{0};     /**< How many times the phase was entered. */
+            uint64_t nodes{0};       /**< Expression, type, symbol and frame nodes created. */
+            uint64_t allocations{0}; /**< Heap allocations, if counted (see setAllocationCounter). */
+        };
+
+        /** Returns the name of the phase or count as used by operator<<. */
+        static const char* getName(phase_t);
+        static const char* getName(count_t);
+
+        bool isEnabled() const { return enabled; }
+        /** Collects statistics in the following parses of the document. */
+        void setEnabled(bool enable) { enabled = enable; }
+        /** Forgets what was collected so far. */
+        void clear();
+
+        const phase_statistics_t& operator[](phase_t phase) const { return phases[phase]; }
+        /** Returns the nodes created (expressions, types, symbols, frames) or the size of the document. */
+        uint64_t operator[](count_t count) const { return counts[count]; }
+
+        /**
+         * Sets a function returning the number of heap allocations made
+         * so far, e.g. by a replaced operator new of the program, to be
+         * used by all documents.  Allocations are not counted without it.
+         */
+        static void setAllocationCounter(uint64_t (*counter)()) noexcept;
+
+        /** Returns the statistics collecting on this thread, or nullptr. */
+        static Statistics* current() noexcept;
+
+        /** Counts a node created on this thread. */
+        static void created(count_t count) noexcept
+        {
+            if (auto* stats = current())
+                ++stats->counts[count];
+        }
+
+        /**
+         * Collects the statistics of the document on this thread, if they
+         * are enabled, and records the size of the document when the
+         * outermost scope ends.
+         */
+        class Scope
+        {
+        public:
+            explicit Scope(Document& doc);
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            ~Scope() noexcept;
+
+        private:
+            Document& doc;
+            Statistics* previous;
+        };
+
+        /** Accounts the time until destroyed to the phase, if statistics are collecting on this thread. */
+        class Phase
+        {
+        public:
+            explicit Phase(phase_t phase) noexcept: stats{current()}, phase{phase}
+            {
+                if (stats != nullptr)
+                    enter();
+            }
+            Phase(const Phase&) = delete;
+            Phase& operator=(const Phase&) = delete;
+            ~Phase() noexcept
+            {
+                if (stats != nullptr)
+                    leave();
+            }
+
+        private:
+            void enter() noexcept;
+            void leave() noexcept;
+
+            Statistics* stats;
+            phase_t phase;
+            Phase* parent{nullptr};
+            std::chrono::steady_clock::time_point start;
+            uint64_t nodes{0};
+            uint64_t allocations{0};
+            std::chrono::nanoseconds nestedTime{0};
+            uint64_t nestedNodes{0};
+            uint64_t nestedAllocations{0};
+        };
+
+    private:
+        uint64_t createdNodes() const;
+
+        phase_statistics_t phases[PHASES];
+        uint64_t counts[COUNTS]{};
+        Phase* top{nullptr};
+        bool enabled{false};
+    };
+
+    /** Writes the statistics as one JSON object. */
+    std::ostream& operator<<(std::ostream& os, const Statistics& stats);
+}  // namespace UTAP
+
+#endif /* UTAP_STATISTICS_H */
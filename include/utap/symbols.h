@@ -24,16 +24,21 @@
 #define UTAP_SYMBOLS_HH
 
 #include "utap/common.h"
+#include "utap/node.h"
 #include "utap/position.h"
 #include "utap/type.h"
 
 #include <exception>
+#include <set>
+#include <string_view>
+#include <vector>
 #include <cstdint>
 
 namespace UTAP
 {
     class frame_t;
     class expression_t;
+    class MemoryReport;
 
     class NoParentException : public std::exception
     {};
@@ -61,11 +66,16 @@ namespace UTAP
     {
     private:
         struct symbol_data;
-        std::shared_ptr<symbol_data> data{nullptr};  // pImpl pattern
+        node_ptr<symbol_data> data{nullptr};  // pImpl pattern
+        friend struct std::hash<symbol_t>;
 
     protected:
         friend class frame_t;
+        friend class BinaryReader;
+        friend class BinaryWriter;
         symbol_t(frame_t* frame, type_t type, std::string name, position_t position, void* user);
+        /** Returns true if the symbol points back to the given frame (without touching the frame it points to). */
+        bool isDeclaredIn(const frame_t&) const;
 
     public:
         /** Default constructor */
@@ -105,11 +115,84 @@ namespace UTAP
         /** Return the user data of this symbol */
         const void* getData() const;
 
+        /** Alters the user data of this symbol */
+        void setData(void*);
+
         /** Returns the name (identifier) of this symbol */
         const std::string& getName() const;
 
         /** Alters the name of this symbol */
         void setName(const std::string&);
+
+        /**
+         * Returns the dense identifier of the symbol, 0 for the empty
+         * symbol.  The symbols created in the frames of one document
+         * (the frames sharing a root, see frame_t::createRoot()) are
+         * numbered from 1 in the order they are created, and released
+         * identifiers are not handed out again.  Thus identifiers only
+         * tell apart the symbols of one document.
+         */
+        uint32_t getId() const;
+
+        /** Adds the node and the nodes it refers to, those not counted yet, to the report. */
+        void measure(MemoryReport& report) const;
+    };
+
+    /**
+       A set of symbols represented as a bitset over the dense symbol
+       identifiers (see symbol_t::getId()).
+
+       Union, intersection and subset tests work a word at a time and
+       membership is a single bit test, unlike std::set<symbol_t> which
+       allocates a node per element.  The set does not keep its
+       symbols alive and only tells apart the symbols of one document,
+       whose identifiers are not reused.
+    */
+    class symbol_set_t
+    {
+    public:
+        symbol_set_t() = default;
+        explicit symbol_set_t(const std::set<symbol_t>&);
+
+        /** Adds the symbol; returns true if it was not in the set. */
+        bool insert(const symbol_t&);
+        /** Adds all the symbols of the given set. */
+        void insert(const std::set<symbol_t>&);
+        /** Removes the symbol; returns true if it was in the set. */
+        bool erase(const symbol_t&);
+        bool contains(const symbol_t& symbol) const { return contains(symbol.getId()); }
+        /** Returns true if the symbol with the given identifier is in the set. */
+        bool contains(uint32_t id) const { return id / 64 < words.size() && (words[id / 64] >> id % 64 & 1u); }
+        bool empty() const;
+        /** Returns the number of symbols in the set. */
+        size_t size() const;
+        void clear() { words.clear(); }
+
+        /** Returns true if the two sets have a symbol in common. */
+        bool intersects(const symbol_set_t&) const;
+        /** Returns true if every symbol of this set is in the given set. */
+        bool isSubsetOf(const symbol_set_t&) const;
+
+        /** Union */
+        symbol_set_t& operator|=(const symbol_set_t&);
+        /** Intersection */
+        symbol_set_t& operator&=(const symbol_set_t&);
+        /** Difference */
+        symbol_set_t& operator-=(const symbol_set_t&);
+        bool operator==(const symbol_set_t&) const;
+        bool operator!=(const symbol_set_t& other) const { return !(*this == other); }
+
+        /** Calls fn with the identifier of each symbol in the set in increasing order. */
+        template <typename Fn>
+        void forEachId(Fn&& fn) const
+        {
+            for (size_t w = 0; w < words.size(); ++w)
+                for (auto bits = words[w]; bits != 0; bits &= bits - 1)
+                    fn(static_cast<uint32_t>(w * 64 + __builtin_ctzll(bits)));
+        }
+
+    private:
+        std::vector<uint64_t> words;  // may have trailing zero words
     };
 
     /**
@@ -137,15 +220,30 @@ namespace UTAP
     {
     private:
         struct frame_data;
-        std::shared_ptr<frame_data> data{nullptr};  // pImpl pattern
+        node_ptr<frame_data> data{nullptr};  // pImpl pattern
 
     protected:
         friend class symbol_t;
+        friend class BinaryWriter;
         explicit frame_t(frame_data*);
 
     public:
         using iterator = std::vector<symbol_t>::iterator;
         using const_iterator = std::vector<symbol_t>::const_iterator;
+
+        /**
+         * A name interned by the frames of a document and the number of
+         * changes to the symbols of that name so far (added to or removed
+         * from any frame of the document, renamed or retyped). An answer
+         * found by resolving the name in a frame holds as long as the
+         * version does not change.
+         */
+        struct version_t
+        {
+            uint32_t atom;  /**< UINT32_MAX if no symbol was ever given the name */
+            uint32_t version;
+        };
+
         /** Default constructors and operators due to pImpl */
         frame_t() = default;
         frame_t(const frame_t&) = default;
@@ -205,6 +303,15 @@ namespace UTAP
         /** Resolves a name in this frame or a parent frame. */
         bool resolve(const std::string& name, symbol_t& symbol) const;
 
+        /** Returns the version of a name in the frames of the document, for caching the answers of resolve. */
+        version_t getVersion(std::string_view name) const;
+
+        /** Resolves a name as returned by getVersion, without looking its text up again. */
+        bool resolve(const version_t& name, symbol_t& symbol) const;
+
+        /** Adds the frame, its symbol table and its symbols, those not counted yet, to the report. */
+        void measure(MemoryReport& report) const;
+
         /** Returns the parent frame */
         frame_t getParent() const;
 
@@ -216,10 +323,27 @@ namespace UTAP
 
         /** Creates and returns a new sub-frame. */
         static frame_t createFrame(const frame_t& parent);
+
+        /**
+         * Creates and returns a new root-frame whose symbols are numbered
+         * together with those of the given frame (see symbol_t::getId()),
+         * e.g. for the parameters of a template of the same document.
+         */
+        static frame_t createRoot(const frame_t& sibling);
     };
 }  // namespace UTAP
 
 std::ostream& operator<<(std::ostream& o, const UTAP::symbol_t& t);
 std::ostream& operator<<(std::ostream& o, const UTAP::frame_t& t);
 
+/** Hashes the identity of the symbol, consistent with operator==. */
+template <>
+struct std::hash<UTAP::symbol_t>
+{
+    size_t operator()(const UTAP::symbol_t& symbol) const noexcept
+    {
+        return std::hash<const void*>{}(symbol.data.get());
+    }
+};
+
 #endif /* UTAP_SYMBOLS_HH */
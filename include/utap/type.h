@@ -24,10 +24,13 @@
 #define UTAP_TYPE_HH
 
 #include "utap/common.h"
+#include "utap/node.h"
 #include "utap/position.h"
 
-#include <memory>  // shared_ptr
+#include <functional>  // hash
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <cstdint>
 
 namespace UTAP
@@ -35,6 +38,7 @@ namespace UTAP
     class expression_t;
     class frame_t;
     class symbol_t;
+    class MemoryReport;
 
     /**
        A reference to a type.
@@ -91,12 +95,22 @@ namespace UTAP
        - REF; a reference - the first child is the type from which the
          reference type is formed.
     */
+    class TypeTable;
+
     class type_t
     {
     private:
         struct child_t;
         struct type_data;
-        std::shared_ptr<type_data> data;
+        node_ptr<type_data> data;
+        friend struct std::hash<type_t>;
+        friend class TypeTable;
+        friend class BinaryReader;
+        friend class BinaryWriter;
+        static type_t intern(type_t);
+        /** Creates a type from all of its fields without interning it. */
+        static type_t createNode(Constants::kind_t, position_t, expression_t, const std::vector<type_t>& children,
+                                 const std::vector<std::string>& labels);
 
     public:
         explicit type_t(Constants::kind_t kind, const position_t& pos, size_t size);
@@ -186,6 +200,9 @@ namespace UTAP
 
         std::string toDeclarationString() const;
 
+        /** Adds the node and the nodes it refers to, those not counted yet, to the report. */
+        void measure(MemoryReport& report) const;
+
         /** Shortcut for is(RANGE). */
         bool isRange() const { return is(Constants::RANGE); }
 
@@ -387,8 +404,60 @@ namespace UTAP
         /** Creates a new lsc instance type */
         static type_t createLscInstance(frame_t, position_t = position_t());
     };
+
+    /**
+     * Interning table for types. While a Scope for the table is active on
+     * the current thread, the factories of type_t return one shared
+     * object for all types with the same kind, position, labels and
+     * children, i.e. with the same prefixes, ranges and labels, so
+     * equivalence checks can short-circuit on identity and labels are
+     * stored once. The position is part of the key because errors are
+     * reported at the position of the type, so in practice the types
+     * shared are the position-less ones created by the type checker and
+     * the expression factories. Only types whose expressions are integer
+     * constants (such as the bounds of int[0,3]) are interned.
+     */
+    class TypeTable
+    {
+    public:
+        TypeTable() = default;
+        TypeTable(const TypeTable&) = delete;
+        TypeTable& operator=(const TypeTable&) = delete;
+
+        /** Returns the shared type equal to type, adding type if there is none and it can be interned. */
+        type_t intern(type_t type);
+
+        /** Returns the number of distinct types in the table. */
+        size_t size() const { return types.size(); }
+
+        /** Makes the factories of type_t use the table on this thread until destroyed. */
+        class Scope
+        {
+        public:
+            explicit Scope(TypeTable& table);
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            ~Scope() noexcept;
+
+        private:
+            TypeTable* previous;
+        };
+
+        /** Returns the table of the innermost active scope on this thread, or nullptr. */
+        static TypeTable* current();
+
+    private:
+        std::unordered_multimap<size_t, type_t> types;
+    };
 }  // namespace UTAP
 
 std::ostream& operator<<(std::ostream& o, const UTAP::type_t& t);
 
+/** Hashes the identity of the type object, consistent with operator==. */
+template <>
+struct std::hash<UTAP::type_t>
+{
+    size_t operator()(const UTAP::type_t& type) const noexcept { return std::hash<const void*>{}(type.data.get()); }
+};
+
 #endif
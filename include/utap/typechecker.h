@@ -28,6 +28,8 @@
 #include "utap/statement.h"
 
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 namespace UTAP
 {
@@ -40,7 +42,7 @@ namespace UTAP
     class CompileTimeComputableValues : public SystemVisitor
     {
     private:
-        std::set<symbol_t> variables;
+        symbol_set_t variables;
 
     public:
         void visitVariable(variable_t&) override;
@@ -57,8 +59,37 @@ namespace UTAP
     class TypeChecker : public SystemVisitor, public AbstractStatementVisitor
     {
     private:
+        friend class IncrementalTypeChecker;
+        friend class QueryParser;
+
+        /** Diagnostics and feature flags kept away from the document, e.g. by a worker thread. */
+        struct diagnostics_t
+        {
+            std::vector<error_t> errors;
+            std::vector<error_t> warnings;
+            std::vector<void (Document::*)()> features; /**< The document flags to set. */
+            const Positions* positions{nullptr}; /**< Resolves the positions instead of the document if set. */
+        };
+
+        /** The outcome of checking the bounds of a range type shared by several units. */
+        struct range_check_t
+        {
+            diagnostics_t diagnostics;
+            std::set<symbol_t> reads;
+        };
+        using range_checks_t = std::unordered_map<type_t, range_check_t>;
+
         Document& doc;
         CompileTimeComputableValues compileTimeComputableValues;
+        std::set<symbol_t>* reads{nullptr}; /**< Collects the symbols of checked identifiers if set. */
+        diagnostics_t* diagnostics{nullptr}; /**< Collects the diagnostics instead of the document if set. */
+        /**
+         * Ranges (of global type definitions) whose bounds are not
+         * checked again but whose recorded outcome is reported instead,
+         * such that concurrent checkers do not type the same bounds.
+         */
+        range_checks_t* sharedRanges{nullptr};
+        bool recordRanges{false}; /**< Checks and adds the ranges missing in sharedRanges. */
         function_t* function; /**< Current function being type checked. */
         bool refinementWarnings;
 
@@ -66,6 +97,8 @@ namespace UTAP
         void handleError(T, const std::string&);
         template <class T>
         void handleWarning(T, const std::string&);
+        void record(void (Document::*feature)());
+        void report(const range_check_t& check);
 
         expression_t checkInitialiser(type_t type, expression_t init);
         bool areAssignmentCompatible(type_t lvalue, type_t rvalue, bool init = false) const;
@@ -84,6 +117,8 @@ namespace UTAP
 
         bool isCompileTimeComputable(expression_t expr) const;
         void checkType(type_t, bool initialisable = false, bool inStruct = false);
+        void checkRange(type_t);
+        void checkBounds(type_t);
 
     public:
         explicit TypeChecker(Document& doc, bool refinement = false);
@@ -138,6 +173,9 @@ namespace UTAP
         bool checkMonitoredExpr(const expression_t& expr);
         bool checkPathQuant(const expression_t& expr);
         bool checkAggregationOp(const expression_t& expr);
+
+        /** Creates a checker of a document that has been checked already, which is not visited again. */
+        TypeChecker(Document& doc, CompileTimeComputableValues values);
     };
 }  // namespace UTAP
 
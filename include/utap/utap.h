@@ -23,24 +23,76 @@
 #ifndef UTAP_HH
 #define UTAP_HH
 
+#include "utap/binarydocument.h"
+#include "utap/cancellation.h"
 #include "utap/common.h"
 #include "utap/document.h"
 #include "utap/expression.h"
+#include "utap/incrementaltypechecker.h"
 #include "utap/statement.h"
 #include "utap/symbols.h"
 
 #include <filesystem>
+#include <future>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
 bool parseXTA(FILE*, UTAP::Document*, bool newxta);
 bool parseXTA(const char* buffer, UTAP::Document*, bool newxta);
-int32_t parseXMLBuffer(const char* buffer, UTAP::Document*, bool newxta,
-                       const std::vector<std::filesystem::path>& libpaths = {});
+/** Parses and type checks the XTA file, scanning it in place where it can be memory mapped. */
+bool parseXTAFile(const char* filename, UTAP::Document*, bool newxta);
+int32_t parseXMLBuffer(std::string_view buffer, UTAP::Document*, bool newxta,
+                       const std::vector<std::filesystem::path>& libpaths = {}, uint32_t threads = 0);
 int32_t parseXMLFile(const char* buffer, UTAP::Document*, bool newxta,
-                     const std::vector<std::filesystem::path>& libpaths = {});
+                     const std::vector<std::filesystem::path>& libpaths = {}, uint32_t threads = 0);
 int32_t parseXMLFd(int fd, UTAP::Document*, bool newxta, const std::vector<std::filesystem::path>& libpaths = {});
+
+namespace UTAP
+{
+    /** The outcome of an asynchronous parse. */
+    struct parse_result_t
+    {
+        std::unique_ptr<Document> document; /**< The parsed document, nullptr if the parse was cancelled */
+        int32_t status{0};                  /**< As returned by parseXMLFile, e.g. -1 if it cannot be read */
+    };
+}  // namespace UTAP
+
+/** Parses and type checks the file as parseXMLFile does, on a thread of its own watched by \a monitor:
+ * the progress callback is called on that thread, and cancelling the token of the monitor makes the
+ * parse stop at the next template, function or token (see UTAP::ParseMonitor). */
+std::future<UTAP::parse_result_t> parseXMLFileAsync(std::string file, bool newxta, UTAP::ParseMonitor monitor,
+                                                    std::vector<std::filesystem::path> libpaths = {},
+                                                    uint32_t threads = 0);
+/** Same as above for the XML text in \a buffer, which the parse owns. */
+std::future<UTAP::parse_result_t> parseXMLBufferAsync(std::string buffer, bool newxta, UTAP::ParseMonitor monitor,
+                                                      std::vector<std::filesystem::path> libpaths = {},
+                                                      uint32_t threads = 0);
+/** Re-parses the template or query at \a xpath of a document parsed from XML, given the new text of
+ * that element (see parseXMLElement), and re-checks what it affects with \a checker.  The element is
+ * replaced in place; a template must keep its name and parameters, and the processes of the template
+ * have its new local declarations as fields.  Returns 1 if the element cannot be replaced in place,
+ * in which case the document should be parsed again: it is unchanged, unless the system declarations
+ * refer to a field of a process that the new template no longer declares. */
+int32_t reparseXMLElement(std::string_view element, const std::string& xpath, UTAP::Document*,
+                          UTAP::IncrementalTypeChecker& checker, bool newxta,
+                          const std::vector<std::filesystem::path>& libpaths = {});
 UTAP::expression_t parseExpression(const char* buffer, UTAP::Document*, bool);
 int32_t writeXMLFile(const char* filename, UTAP::Document* doc);
+/** Writes the document as writeXMLFile does, appending the text to \a buffer. */
+int32_t writeXMLBuffer(std::string& buffer, UTAP::Document* doc);
+/** Writes the document as writeXMLFile does, streaming the text into \a os. */
+int32_t writeXML(std::ostream& os, UTAP::Document* doc);
+/** Streams the built document into \a os as CBOR, or JSON if \a json is true (see CBORWriter). */
+int32_t writeCBOR(std::ostream& os, UTAP::Document* doc, bool json = false);
+/** Stores a type checked document so that loadBinaryDocument can restore it without parsing.
+ * Throws BinaryDocumentError on failure. */
+int32_t writeBinaryDocument(const char* filename, UTAP::Document* doc);
+/** Restores a document stored by writeBinaryDocument into an empty document.
+ * Throws BinaryDocumentError if the file cannot be read or was written by another version. */
+int32_t loadBinaryDocument(const char* filename, UTAP::Document* doc);
 
 /** returns a string representation of built-in types and constants (see parser.y) */
 const char* utap_builtin_declarations();
@@ -0,0 +1,78 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_XMLELEMENTS_H
+#define UTAP_XMLELEMENTS_H
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct _xmlDoc;
+struct _xmlXPathContext;
+
+/** Returns the text of the element of the libxml2 document at the XPath, empty if there is none. */
+std::string getXMLElement(_xmlDoc* doc, const std::string& path);
+
+namespace UTAP
+{
+    /**
+     * Returns the text of many elements of an XML document at once, as
+     * getXMLElement does for one, e.g. for showing the source of every
+     * error and query.  The paths in the form the XML reader generates
+     * (like /nta/template[2]/transition[3]/label[1]) are resolved in a
+     * single walk over the parts of the document they lead to; other
+     * XPaths are evaluated in one context shared by all lookups.
+     */
+    class XMLElements
+    {
+    public:
+        /** Looks up the elements of \a doc, which must outlive this object. */
+        explicit XMLElements(_xmlDoc* doc): doc{doc} {}
+        /** Looks up the elements of the XML text, which is parsed and kept by this object, see isValid(). */
+        explicit XMLElements(std::string_view xml);
+        XMLElements(const XMLElements&) = delete;
+        XMLElements& operator=(const XMLElements&) = delete;
+        ~XMLElements() noexcept;
+
+        /** Returns false if the XML text could not be parsed. */
+        bool isValid() const { return doc != nullptr; }
+
+        /**
+         * Returns the texts of the elements at the paths, in order, with
+         * an empty text for a path that leads nowhere.  The texts are
+         * kept by this object until it is destroyed or cleared.
+         */
+        std::vector<std::string_view> get(const std::vector<std::string>& paths);
+
+        /** Releases the texts returned so far. */
+        void clear() { texts.clear(); }
+
+    private:
+        _xmlDoc* doc;
+        bool owned{false};
+        _xmlXPathContext* context{nullptr}; /**< Created for the first path not in the generated form */
+        std::deque<std::string> texts;      /**< The texts of each lookup, never moved */
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_XMLELEMENTS_H */
@@ -30,6 +30,7 @@
 #include <libxml/xmlwriter.h>
 
 #include <stdexcept>
+#include <string>
 
 namespace UTAP
 {
@@ -48,6 +49,7 @@ namespace UTAP
         xmlTextWriterPtr writer; /**< The underlying xmlTextWriter */
         Document* doc;           /**< The document to write */
         std::map<int, int> selfLoops;
+        std::string text; /**< Reused for printing the labels */
 
         void startDocument();
         void endDocument();
@@ -66,7 +68,7 @@ namespace UTAP
         void transition(const edge_t& edge);
         void nail(int x, int y);
 
-        void label(const char* kind, std::string data, int x, int y);
+        void label(const char* kind, const std::string& data, int x, int y);
         int source(const edge_t& edge);
         int target(const edge_t& edge);
         void selfLoop(int loc, double initialAngle, const edge_t& edge);
@@ -173,7 +173,7 @@ void DocumentBuilder::procBegin(const char* name, const bool isTA, const string&
     }
 
     pushFrame(currentTemplate->frame);
-    params = frame_t::createFrame();
+    params = frame_t::createRoot(document.getGlobals().frame);
 }
 
 void DocumentBuilder::procEnd()  // 1 ProcBody
@@ -182,6 +182,11 @@ void DocumentBuilder::procEnd()  // 1 ProcBody
     popFrame();
 }
 
+void DocumentBuilder::procSkipped(const char* name, const std::string& xpath, const std::string& text)
+{
+    document.addSkippedTemplate({name, xpath, text});
+}
+
 /**
  * Add a state to the current template. An invariant expression is
  * expected on and popped from the expression stack if \a hasInvariant
@@ -330,7 +335,7 @@ void DocumentBuilder::instantiationBegin(const char* name, size_t parameters, co
     frame_t frame = frame_t::createFrame(frames.top());
     frame.add(params);
     pushFrame(frame);
-    params = frame_t::createFrame();
+    params = frame_t::createRoot(document.getGlobals().frame);
 }
 
 void DocumentBuilder::instantiationEnd(const char* name, size_t parameters, const char* templ_name, size_t arguments)
@@ -378,10 +383,9 @@ void DocumentBuilder::instantiationEnd(const char* name, size_t parameters, cons
              *
              * REVISIT: Move to document.cpp?
              */
-            std::set<symbol_t>& restricted = old_instance->restricted;
             for (size_t i = 0; i < expected; i++) {
-                if (restricted.find(old_instance->parameters[i]) != restricted.end()) {
-                    collectDependencies(new_instance.restricted, exprs[i]);
+                if (old_instance->restrictedSet.contains(old_instance->parameters[i])) {
+                    collectDependencies(new_instance, exprs[i]);
                 }
             }
         }
@@ -395,11 +399,13 @@ void DocumentBuilder::process(const char* name)
 {
     symbol_t symbol;
     if (!resolve(name, symbol)) {
-        throw NoSuchProcessError(name);
+        handleError(NoSuchProcessError(name));
+        return;
     }
     type_t type = symbol.getType();
     if (type.getKind() != INSTANCE) {
-        throw NotATemplateError(symbol.getName());
+        handleError(NotATemplateError(symbol.getName()));
+        return;
     }
     if (type.size() > 0) {
         // FIXME: Check type of unbound parameters
@@ -410,7 +416,12 @@ void DocumentBuilder::process(const char* name)
 
 void DocumentBuilder::processListEnd() {}
 
-void DocumentBuilder::done() {}
+void DocumentBuilder::done()
+{
+    if (auto* index = document.getSourceIndex())
+        for (const auto& symbol : document.getGlobals().frame)
+            index->addDeclaration(symbol);
+}
 
 void DocumentBuilder::beforeUpdate()
 {
@@ -495,7 +506,7 @@ void DocumentBuilder::instanceNameBegin(const char* name)
     frame_t frame = frame_t::createFrame(frames.top());
     frame.add(params);
     pushFrame(frame);
-    params = frame_t::createFrame();
+    params = frame_t::createRoot(document.getGlobals().frame);
 }
 
 void DocumentBuilder::instanceNameEnd(const char* name, size_t arguments)
@@ -551,10 +562,9 @@ void DocumentBuilder::instanceNameEnd(const char* name, size_t arguments)
              *
              * REVISIT: Move to document.cpp?
              */
-            std::set<symbol_t>& restricted = old_instance->restricted;
             for (size_t i = 0; i < expected; i++) {
-                if (restricted.find(old_instance->parameters[i]) != restricted.end()) {
-                    collectDependencies(currentInstanceLine->restricted, exprs[i]);
+                if (old_instance->restrictedSet.contains(old_instance->parameters[i])) {
+                    collectDependencies(*currentInstanceLine, exprs[i]);
                 }
             }
         }
@@ -661,7 +671,7 @@ void DocumentBuilder::declDynamicTemplate(const std::string& name)
 
     document.addDynamicTemplate(name, params, position);
 
-    params = frame_t::createFrame();  // reset params
+    params = frame_t::createRoot(document.getGlobals().frame);  // reset params
 }
 
 void DocumentBuilder::queryBegin() { currentQuery = std::make_unique<query_t>(); }
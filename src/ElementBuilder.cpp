@@ -0,0 +1,85 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "ElementBuilder.hpp"
+
+#include <algorithm>
+
+using namespace UTAP;
+
+ElementBuilder::ElementBuilder(Document& doc, std::vector<std::filesystem::path> paths):
+    DocumentBuilder{doc, std::move(paths)}
+{}
+
+static bool sameParameters(const frame_t& a, const frame_t& b)
+{
+    if (a.getSize() != b.getSize())
+        return false;
+    for (uint32_t i = 0; i < a.getSize(); ++i)
+        if (a[i].getName() != b[i].getName() || a[i].getType().toString() != b[i].getType().toString())
+            return false;
+    return true;
+}
+
+void ElementBuilder::procBegin(const char* name, const bool isTA, const std::string&, const std::string&)
+{
+    auto* templ = document.getTemplateIndex().find(name);
+    if (isTA && templ != nullptr && templ->isTA && !templ->dynamic &&
+        sameParameters(templ->parameters, params)) {
+        /* The parameters are kept since instances map them to their arguments. */
+        templ->frame = frame_t::createFrame(document.getGlobals().frame);
+        templ->frame.add(templ->parameters);
+        templ->variables.clear();
+        templ->functions.clear();
+        templ->progress.clear();
+        templ->iodecl.clear();
+        templ->ganttChart.clear();
+        templ->init = symbol_t{};
+        templ->states.clear();
+        templ->branchpoints.clear();
+        templ->edges.clear();
+        templ->dynamicEvals.clear();
+        replacedTemplate = currentTemplate = templ;
+    } else {
+        scratch = std::make_unique<template_t>();
+        scratch->frame = frame_t::createFrame(document.getGlobals().frame);
+        scratch->frame.add(params);
+        scratch->parameters = params;
+        scratch->templ = scratch.get();
+        scratch->isTA = isTA;
+        scratch->dynamic = false;
+        currentTemplate = scratch.get();
+    }
+    pushFrame(currentTemplate->frame);
+    params = frame_t::createRoot(document.getGlobals().frame);
+}
+
+void ElementBuilder::queryEnd()
+{
+    auto& queries = document.getQueries();
+    auto query = std::find_if(queries.begin(), queries.end(),
+                              [this](const query_t& q) { return q.location == currentQuery->location; });
+    if (!currentQuery->location.empty() && query != queries.end()) {
+        *query = std::move(*currentQuery);
+        replacedQuery = true;
+    }
+    currentQuery.reset();
+}
@@ -0,0 +1,64 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_ELEMENTBUILDER_HPP
+#define UTAP_ELEMENTBUILDER_HPP
+
+#include "utap/DocumentBuilder.hpp"
+
+#include <memory>
+
+namespace UTAP
+{
+    /**
+     * A document builder which re-builds one template or query of an
+     * existing document in place, as reported by parseXMLElement.
+     *
+     * A template keeps its address, symbol and parameters, so the
+     * instances and processes referring to it stay valid; its frame,
+     * declarations, locations and edges are replaced.  A query replaces
+     * the query with the same formula location.  If the element does not
+     * match the document (an unknown or renamed template, other
+     * parameters, a dynamic or LSC template, an unknown query), it is
+     * built into a scratch template thrown away with the builder, the
+     * document is left as it was, and isReplaced() returns false.
+     */
+    class ElementBuilder : public DocumentBuilder
+    {
+        std::unique_ptr<template_t> scratch;
+        template_t* replacedTemplate{nullptr};
+        bool replacedQuery{false};
+
+    public:
+        explicit ElementBuilder(Document&, std::vector<std::filesystem::path> paths = {});
+
+        void procBegin(const char* name, const bool isTA = true, const std::string& type = "",
+                       const std::string& mode = "") override;
+        void queryEnd() override;
+
+        /** Returns true if the element parsed replaced a template or a query of the document. */
+        bool isReplaced() const { return replacedTemplate != nullptr || replacedQuery; }
+        /** Returns the template which was re-built, if any. */
+        template_t* getReplacedTemplate() const { return replacedTemplate; }
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_ELEMENTBUILDER_HPP */
@@ -21,6 +21,7 @@
 
 #include "utap/ExpressionBuilder.hpp"
 
+#include <iterator>
 #include <vector>
 #include <cassert>
 #include <cinttypes>
@@ -46,11 +47,18 @@ inline static expression_t toMITLAtom(const expression_t& e) { return expression
 void ExpressionBuilder::ExpressionFragments::pop(uint32_t n)
 {
     assert(n <= size());
-    while (n--)
-        pop();
+    data.erase(data.end() - n, data.end());
 }
 
-ExpressionBuilder::ExpressionBuilder(Document& doc): document{doc}
+vector<expression_t> ExpressionBuilder::ExpressionFragments::take(uint32_t n)
+{
+    assert(n <= size());
+    auto res = vector<expression_t>(std::make_move_iterator(data.end() - n), std::make_move_iterator(data.end()));
+    data.erase(data.end() - n, data.end());
+    return res;
+}
+
+ExpressionBuilder::ExpressionBuilder(Document& doc): fragments{doc.getSourceIndex()}, document{doc}
 {
     pushFrame(document.getGlobals().frame);
     scalar_count = 0;
@@ -65,9 +73,20 @@ void ExpressionBuilder::handleError(const TypeException& ex) { document.addError
 
 void ExpressionBuilder::handleWarning(const TypeException& ex) { document.addWarning(position, ex.what()); }
 
-void ExpressionBuilder::pushFrame(frame_t frame) { frames.push(std::move(frame)); }
+void ExpressionBuilder::pushFrame(frame_t frame)
+{
+    frames.push(std::move(frame));
+    scopes.push_back(++scopeCount);
+}
 
-void ExpressionBuilder::popFrame() { frames.pop(); }
+void ExpressionBuilder::popFrame()
+{
+    if (auto* index = fragments.getIndex())
+        for (const auto& symbol : frames.top())
+            index->addDeclaration(symbol);
+    frames.pop();
+    scopes.pop_back();
+}
 
 bool ExpressionBuilder::resolve(const std::string& name, symbol_t& uid) const
 {
@@ -79,11 +98,19 @@ ExpressionBuilder::ExpressionFragments& ExpressionBuilder::getExpressions() { re
 
 bool ExpressionBuilder::isType(const char* name)
 {
-    symbol_t uid;
-    if (!resolve(name, uid)) {
-        return false;
+    // Called by the lexer for every identifier, thus the answer is kept until the scope or the name changes
+    const auto& frame = frames.top();
+    const auto interned = frame.getVersion(name);  // the only lookup of the text
+    if (interned.atom == UINT32_MAX)
+        return false;  // no symbol of the document has the name
+    if (interned.atom >= typeNames.size())
+        typeNames.resize(interned.atom + 1);  // atoms are dense in the document
+    auto& answer = typeNames[interned.atom];
+    if (answer.scope != scopes.back() || answer.version != interned.version) {
+        symbol_t uid;
+        answer = {scopes.back(), interned.version, frame.resolve(interned, uid) && uid.getType().getKind() == TYPEDEF};
     }
-    return uid.getType().getKind() == TYPEDEF;
+    return answer.type;
 }
 
 expression_t ExpressionBuilder::makeConstant(int value) const { return expression_t::createConstant(value, position); }
@@ -129,7 +156,8 @@ void ExpressionBuilder::typeString(PREFIX prefix)
 {
     if (prefix != PREFIX_CONST) {
         typeFragments.push(type_t::createPrimitive(VOID_TYPE));
-        throw TypeException("$Strings_should_always_be_const");
+        handleError(TypeException{"$Strings_should_always_be_const"});
+        return;
     }
     type_t type = type_t::createPrimitive(Constants::STRING, position);
     typeFragments.push(applyPrefix(prefix, type));
@@ -167,15 +195,16 @@ void ExpressionBuilder::typeVoid()
     typeFragments.push(type);
 }
 
-static void collectDependencies(std::set<symbol_t>& dependencies, expression_t expr)
+/** Marks the symbols the expression depends on as restricted in the instance. */
+static void collectDependencies(instance_t& instance, expression_t expr)
 {
     std::set<symbol_t> symbols;
     expr.collectPossibleReads(symbols);
     while (!symbols.empty()) {
         symbol_t s = *symbols.begin();
         symbols.erase(s);
-        if (dependencies.find(s) == dependencies.end()) {
-            dependencies.insert(s);
+        if (instance.restricted.insert(s).second) {
+            instance.restrictedSet.insert(s);
             if (auto* data = s.getData(); data) {
                 variable_t* v = static_cast<variable_t*>(data);
                 v->expr.collectPossibleReads(symbols);
@@ -216,7 +245,7 @@ void ExpressionBuilder::typeScalar(PREFIX prefix)
          * Therefore mark all symbols in upper and those that they
          * depend on as restricted.
          */
-        collectDependencies(currentTemplate->restricted, upper);
+        collectDependencies(*currentTemplate, upper);
     }
     typeFragments.push(type);
 }
@@ -228,7 +257,8 @@ void ExpressionBuilder::typeName(PREFIX prefix, const char* name)
 
     if (!resolve(name, uid) || uid.getType().getKind() != TYPEDEF) {
         typeFragments.push(type_t::createPrimitive(VOID_TYPE));
-        throw TypeException("$Identifier_is_undeclared_or_not_a_type_name");
+        handleError(TypeException{"$Identifier_is_undeclared_or_not_a_type_name"});
+        return;
     }
 
     type_t type = uid.getType()[0];
@@ -280,7 +310,8 @@ void ExpressionBuilder::exprId(const char* name)
 
     if (!resolve(name, uid)) {
         exprFalse();
-        throw UnknownIdentifierError(name);
+        handleError(UnknownIdentifierError(name));
+        return;
     }
 
     fragments.push(expression_t::createIdentifier(uid, position));
@@ -307,11 +338,7 @@ void ExpressionBuilder::exprCallEnd(uint32_t n)
      * evaluates to the function or processset. The remaining
      * expressions are the arguments.
      */
-    vector<expression_t> expr;
-    for (int i = n; i >= 0; i--) {
-        expr.push_back(fragments[i]);
-    }
-    fragments.pop(n + 1);
+    vector<expression_t> expr = fragments.take(n + 1);
 
     /* The expression we create depends on whether id is a
      * function or a processset.
@@ -365,8 +392,8 @@ void ExpressionBuilder::exprCallEnd(uint32_t n)
 void ExpressionBuilder::exprArray()
 {
     // Pop sub-expressions
-    expression_t var = fragments[1];
-    expression_t index = fragments[0];
+    expression_t var = std::move(fragments[1]);
+    expression_t index = std::move(fragments[0]);
     fragments.pop(2);
 
     type_t element;
@@ -377,58 +404,64 @@ void ExpressionBuilder::exprArray()
         element = type_t();
     }
 
-    fragments.push(expression_t::createBinary(ARRAY, var, index, position, element));
+    fragments.push(expression_t::createBinary(ARRAY, std::move(var), std::move(index), position, std::move(element)));
 }
 
 // 1 expr
 void ExpressionBuilder::exprPostIncrement()
 {
-    fragments[0] = expression_t::createUnary(POSTINCREMENT, fragments[0], position);
+    fragments.replace(expression_t::createUnary(POSTINCREMENT, std::move(fragments[0]), position));
 }
 
 void ExpressionBuilder::exprPreIncrement()
 {
-    fragments[0] = expression_t::createUnary(PREINCREMENT, fragments[0], position, fragments[0].getType());
+    auto type = fragments[0].getType();
+    fragments.replace(expression_t::createUnary(PREINCREMENT, std::move(fragments[0]), position, std::move(type)));
 }
 
 void ExpressionBuilder::exprPostDecrement()  // 1 expr
 {
-    fragments[0] = expression_t::createUnary(POSTDECREMENT, fragments[0], position);
+    fragments.replace(expression_t::createUnary(POSTDECREMENT, std::move(fragments[0]), position));
 }
 
 void ExpressionBuilder::exprPreDecrement()
 {
-    fragments[0] = expression_t::createUnary(PREDECREMENT, fragments[0], position, fragments[0].getType());
+    auto type = fragments[0].getType();
+    fragments.replace(expression_t::createUnary(PREDECREMENT, std::move(fragments[0]), position, std::move(type)));
 }
 
 void ExpressionBuilder::exprBuiltinFunction1(kind_t kind)
 {
-    fragments[0] = expression_t::createUnary(kind, fragments[0], position);
+    fragments.replace(expression_t::createUnary(kind, std::move(fragments[0]), position));
 }
 
 void ExpressionBuilder::exprBuiltinFunction2(kind_t kind)
 {
-    expression_t lvalue = fragments[1];
-    expression_t rvalue = fragments[0];
+    expression_t lvalue = std::move(fragments[1]);
+    expression_t rvalue = std::move(fragments[0]);
     fragments.pop(1);
-    fragments[0] = expression_t::createBinary(kind, lvalue, rvalue, position, lvalue.getType());
+    auto type = lvalue.getType();
+    fragments.replace(expression_t::createBinary(kind, std::move(lvalue), std::move(rvalue), position, std::move(type)));
 }
 
 void ExpressionBuilder::exprBuiltinFunction3(kind_t kind)
 {
-    expression_t value1 = fragments[2];
-    expression_t value2 = fragments[1];
-    expression_t value3 = fragments[0];
+    expression_t value1 = std::move(fragments[2]);
+    expression_t value2 = std::move(fragments[1]);
+    expression_t value3 = std::move(fragments[0]);
     fragments.pop(2);
-    fragments[0] = expression_t::createTernary(kind, value1, value2, value3, position, value1.getType());
+    auto type = value1.getType();
+    fragments.replace(expression_t::createTernary(kind, std::move(value1), std::move(value2), std::move(value3),
+                                                  position, std::move(type)));
 }
 
 void ExpressionBuilder::exprAssignment(kind_t op)  // 2 expr
 {
-    expression_t lvalue = fragments[1];
-    expression_t rvalue = fragments[0];
+    expression_t lvalue = std::move(fragments[1]);
+    expression_t rvalue = std::move(fragments[0]);
     fragments.pop(2);
-    fragments.push(expression_t::createBinary(op, lvalue, rvalue, position, lvalue.getType()));
+    auto type = lvalue.getType();
+    fragments.push(expression_t::createBinary(op, std::move(lvalue), std::move(rvalue), position, std::move(type)));
 }
 
 void ExpressionBuilder::exprUnary(kind_t unaryop)  // 1 expr
@@ -440,7 +473,7 @@ void ExpressionBuilder::exprUnary(kind_t unaryop)  // 1 expr
     case MINUS:
         unaryop = UNARY_MINUS;
         /* Fall through! */
-    default: fragments[0] = expression_t::createUnary(unaryop, fragments[0], position);
+    default: fragments.replace(expression_t::createUnary(unaryop, std::move(fragments[0]), position));
     }
 }
 
@@ -448,8 +481,8 @@ void ExpressionBuilder::exprBinary(kind_t binaryop)  // 2 expr
 {
     kind_t mitlop = (binaryop == AND ? MITLCONJ : MITLDISJ);
     kind_t op = binaryop;
-    expression_t left = fragments[1];
-    expression_t right = fragments[0];
+    expression_t left = std::move(fragments[1]);
+    expression_t right = std::move(fragments[0]);
     if (isMITL(left) || isMITL(right)) {
         op = mitlop;
         if (!(isMITL(left) && isMITL(right))) {
@@ -463,20 +496,13 @@ void ExpressionBuilder::exprBinary(kind_t binaryop)  // 2 expr
         }
     }
     fragments.pop(2);
-    fragments.push(expression_t::createBinary(op, left, right, position));
+    fragments.push(expression_t::createBinary(op, std::move(left), std::move(right), position));
 }
 
 void ExpressionBuilder::exprNary(kind_t kind, uint32_t num)
 {
-    // Pop fields
-    vector<expression_t> fields(num);
-    for (uint32_t i = 0; i < num; i++) {
-        fields[i] = fragments[num - 1 - i];
-    }
-    fragments.pop(num);
-
-    // Create N-ary expression
-    fragments.push(expression_t::createNary(kind, fields, position));
+    // Create N-ary expression from the fields
+    fragments.push(expression_t::createNary(kind, fragments.take(num), position));
 }
 
 void ExpressionBuilder::exprScenario(const char* name)
@@ -510,28 +536,30 @@ expression_t ExpressionBuilder::exprScenario()
 
 void ExpressionBuilder::exprTernary(kind_t ternaryop, bool firstMissing)  // 3 expr
 {
-    expression_t first = firstMissing ? makeConstant(1) : fragments[2];
-    expression_t second = fragments[1];
-    expression_t third = fragments[0];
+    expression_t first = firstMissing ? makeConstant(1) : std::move(fragments[2]);
+    expression_t second = std::move(fragments[1]);
+    expression_t third = std::move(fragments[0]);
     fragments.pop(firstMissing ? 2 : 3);
-    fragments.push(expression_t::createTernary(ternaryop, first, second, third, position));
+    fragments.push(expression_t::createTernary(ternaryop, std::move(first), std::move(second), std::move(third), position));
 }
 
 void ExpressionBuilder::exprInlineIf()
 {
-    expression_t c = fragments[2];
-    expression_t t = fragments[1];
-    expression_t e = fragments[0];
+    expression_t c = std::move(fragments[2]);
+    expression_t t = std::move(fragments[1]);
+    expression_t e = std::move(fragments[0]);
     fragments.pop(3);
-    fragments.push(expression_t::createTernary(INLINEIF, c, t, e, position, t.getType()));
+    auto type = t.getType();
+    fragments.push(expression_t::createTernary(INLINEIF, std::move(c), std::move(t), std::move(e), position, std::move(type)));
 }
 
 void ExpressionBuilder::exprComma()
 {
-    expression_t e1 = fragments[1];
-    expression_t e2 = fragments[0];
+    expression_t e1 = std::move(fragments[1]);
+    expression_t e2 = std::move(fragments[0]);
     fragments.pop(2);
-    fragments.push(expression_t::createBinary(COMMA, e1, e2, position, e2.getType()));
+    auto type = e2.getType();
+    fragments.push(expression_t::createBinary(COMMA, std::move(e1), std::move(e2), position, std::move(type)));
 }
 
 void ExpressionBuilder::exprLocation()
@@ -546,7 +574,7 @@ void ExpressionBuilder::exprLocation()
     } else {
         handleError(NotAProcessError(expr.toString(true)));
     }
-    fragments[0] = expr;
+    fragments.replace(expr);
 }
 
 void ExpressionBuilder::exprDot(const char* id)
@@ -578,13 +606,17 @@ void ExpressionBuilder::exprDot(const char* id)
         symbol_t uid;
         // temporarily set the frame to that of its associated template
         if (dynamicFrames.find(expr.getSymbol().getName()) == dynamicFrames.end()) {
-            throw UnknownIdentifierError(expr.getSymbol().getName());
+            handleError(UnknownIdentifierError(expr.getSymbol().getName()));
+            return;
         }
         pushFrame(dynamicFrames[expr.getSymbol().getName()]);
 
         if (!resolve(id, uid)) {
+            popFrame();
+            handleError(UnknownIdentifierError(id));
+            fragments.pop();
             exprFalse();
-            throw UnknownIdentifierError(id);
+            return;
         }
         popFrame();  // Remove that frame again
         expression_t identifier = expression_t::createIdentifier(uid, position);
@@ -597,7 +629,7 @@ void ExpressionBuilder::exprDot(const char* id)
     } else {
         handleError(IsNotAStructError(expr.toString(true)));
     }
-    fragments[0] = expr;
+    fragments.replace(expr);
 }
 
 void ExpressionBuilder::exprForAllBegin(const char* name)
@@ -624,8 +656,8 @@ void ExpressionBuilder::exprForAllEnd(const char* name)
      * but the identifier expression will maintain a reference to the
      * symbol so it will not be deallocated.
      */
-    fragments[0] = expression_t::createBinary(FORALL, expression_t::createIdentifier(frames.top()[0], position),
-                                              fragments[0], position);
+    fragments.replace(expression_t::createBinary(FORALL, expression_t::createIdentifier(frames.top()[0], position),
+                                                 fragments[0], position));
     popFrame();
 }
 
@@ -638,8 +670,8 @@ void ExpressionBuilder::exprExistsEnd(const char* name)
      * but the identifier expression will maintain a reference to the
      * symbol so it will not be deallocated.
      */
-    fragments[0] = expression_t::createBinary(EXISTS, expression_t::createIdentifier(frames.top()[0], position),
-                                              fragments[0], position);
+    fragments.replace(expression_t::createBinary(EXISTS, expression_t::createIdentifier(frames.top()[0], position),
+                                                 fragments[0], position));
     popFrame();
 }
 
@@ -652,8 +684,8 @@ void ExpressionBuilder::exprSumEnd(const char* name)
      * but the identifier expression will maintain a reference to the
      * symbol so it will not be deallocated.
      */
-    fragments[0] = expression_t::createBinary(SUM, expression_t::createIdentifier(frames.top()[0], position),
-                                              fragments[0], position);
+    fragments.replace(expression_t::createBinary(SUM, expression_t::createIdentifier(frames.top()[0], position),
+                                                 fragments[0], position));
     popFrame();
 }
 
@@ -730,7 +762,7 @@ void ExpressionBuilder::exprLoadStrategy()
 
 void ExpressionBuilder::exprSaveStrategy()
 {
-    fragments[0] = expression_t::createUnary(SAVE_STRAT, fragments[0], position);
+    fragments.replace(expression_t::createUnary(SAVE_STRAT, fragments[0], position));
 }
 
 void ExpressionBuilder::exprProbaQuantitative(Constants::kind_t pathType)
@@ -758,8 +790,10 @@ void ExpressionBuilder::exprProbaCompare(Constants::kind_t pathType1, Constants:
     auto& runs2 = fragments[1];
     auto& predicate2 = fragments[0];
 
-    if (runs1.getValue() != -1 || runs2.getValue() != -1)
-        throw TypeException("The number of runs is not supported in probability comparison");
+    if (runs1.getValue() != -1 || runs2.getValue() != -1) {
+        handleError(TypeException{"The number of runs is not supported in probability comparison"});
+        return;
+    }
 
     auto args = std::vector<expression_t>{boundTypeOrBoundedExpr1, bound1, makeConstant(pathType1), predicate1,
                                           boundTypeOrBoundedExpr2, bound2, makeConstant(pathType2), predicate2};
@@ -780,8 +814,10 @@ void ExpressionBuilder::exprProbaExpected(const char* aggregatingOp)
         aggOpId = 0;
     else if (strcmp("max", aggregatingOp) == 0)
         aggOpId = 1;
-    else
-        throw TypeException("min or max expected");
+    else {
+        handleError(TypeException{"min or max expected"});
+        return;
+    }
     // TODO: add "acc" when the semantics is defined.
 
     auto args = std::vector<expression_t>{runs, boundTypeOrBoundedExpr, bound, makeConstant(aggOpId), expression};
@@ -956,8 +992,10 @@ void ExpressionBuilder::exprForAllDynamicBegin(const char* name, const char* tem
     pushFrame(frame_t::createFrame(frames.top()));
     frames.top().addSymbol(name, type_t::createPrimitive(PROCESSVAR, position), position);
     template_t* templ = document.getDynamicTemplate(temp);
-    if (!templ)
-        throw UnknownDynamicTemplateError(temp);
+    if (!templ) {
+        handleError(UnknownDynamicTemplateError(temp));
+        return;
+    }
     // dynamicFrames[name]=templ->frame;
     pushDynamicFrameOf(templ, name);
 }
@@ -990,7 +1028,8 @@ void ExpressionBuilder::exprExistsDynamicBegin(const char* name, const char* tem
     frames.top().addSymbol(name, type_t::createPrimitive(Constants::PROCESSVAR, position), position);
     template_t* templ = document.getDynamicTemplate(temp);
     if (!templ) {
-        throw UnknownDynamicTemplateError(temp);
+        handleError(UnknownDynamicTemplateError(temp));
+        return;
     }
     // dynamicFrames [name]=templ->frame;
     pushDynamicFrameOf(templ, name);
@@ -1022,7 +1061,8 @@ void ExpressionBuilder::exprSumDynamicBegin(const char* name, const char* temp)
     frames.top().addSymbol(name, type_t::createPrimitive(Constants::PROCESSVAR, position), position);
     template_t* templ = document.getDynamicTemplate(temp);
     if (!templ) {
-        throw UnknownDynamicTemplateError(temp);
+        handleError(UnknownDynamicTemplateError(temp));
+        return;
     }
     // dynamicFrames [name]=templ->frame;
     pushDynamicFrameOf(templ, name);
@@ -1045,7 +1085,8 @@ void ExpressionBuilder::exprForeachDynamicBegin(const char* name, const char* te
     pushFrame(frame_t::createFrame(frames.top()));
     frames.top().addSymbol(name, type_t::createPrimitive(Constants::PROCESSVAR, position), position);
     if (!document.getDynamicTemplate(temp)) {
-        throw UnknownDynamicTemplateError(temp);
+        handleError(UnknownDynamicTemplateError(temp));
+        return;
     }
     // dynamicFrames [name]=document->getDynamicTemplate(temp)->frame;
     pushDynamicFrameOf(document.getDynamicTemplate(temp), name);
@@ -1067,7 +1108,8 @@ void ExpressionBuilder::exprForeachDynamicEnd(const char* name)
 void ExpressionBuilder::pushDynamicFrameOf(template_t* t, string name)
 {
     if (!t->isDefined) {
-        throw TypeException("Template referenced before used");
+        handleError(TypeException{"Template referenced before used"});
+        return;
     }
     dynamicFrames[name] = t->frame;
 }
@@ -0,0 +1,79 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "MappedFile.hpp"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace UTAP;
+
+#if defined(__linux__) || defined(__APPLE__)
+
+MappedFile::MappedFile(const char* filename) { map(filename, false); }
+
+MappedFile::MappedFile(const char* filename, bool scannable) { map(filename, scannable); }
+
+void MappedFile::map(const char* filename, bool scan)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        const auto bytes = static_cast<size_t>(info.st_size);
+        const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        // The rest of the last page reads as zeros, beyond it would fault
+        const auto padding = size_t{scan ? 2u : 0u};
+        if (bytes % page == 0 ? padding == 0 : page - bytes % page >= padding) {
+            const auto protection = scan ? PROT_READ | PROT_WRITE : PROT_READ;
+            void* p = mmap(nullptr, bytes + padding, protection, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, bytes + padding, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(p);
+                size = bytes;
+                length = bytes + padding;
+                scannable = scan;
+            }
+        }
+    }
+    close(fd);  // the mapping stays valid
+}
+
+MappedFile::~MappedFile() noexcept
+{
+    if (data != nullptr)
+        munmap(const_cast<char*>(data), length);
+}
+
+#else
+
+MappedFile::MappedFile(const char*) {}
+
+MappedFile::MappedFile(const char*, bool) {}
+
+MappedFile::~MappedFile() noexcept = default;
+
+#endif
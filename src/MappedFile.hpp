@@ -0,0 +1,67 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_MAPPEDFILE_HPP
+#define UTAP_MAPPEDFILE_HPP
+
+#include <string_view>
+#include <cstddef>
+
+namespace UTAP
+{
+    /**
+     * Read-only view of the whole contents of a file, memory mapped so
+     * that it can be parsed in place without being copied. Mapping fails
+     * (and view() is empty) for empty or non-regular files and on
+     * platforms without mmap, in which case the caller reads the file by
+     * other means.
+     */
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const char* filename);
+        /**
+         * Maps the file copy-on-write followed by two NUL characters, so
+         * that flex can scan it in place (see scanBuffer()).  Mapping also
+         * fails when the NUL characters would not fall in the last page of
+         * the file, i.e. for sizes just below a multiple of the page size.
+         */
+        MappedFile(const char* filename, bool scannable);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile() noexcept;
+
+        bool isMapped() const { return data != nullptr; }
+        std::string_view view() const { return {data, size}; }
+        /** Returns the writable contents followed by two NUL characters if mapped as scannable, else nullptr. */
+        char* scanBuffer() const { return scannable ? const_cast<char*>(data) : nullptr; }
+
+    private:
+        const char* data{nullptr};
+        size_t size{0};
+        size_t length{0}; /**< Of the mapping */
+        bool scannable{false};
+
+        void map(const char* filename, bool scannable);
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_MAPPEDFILE_HPP */
@@ -0,0 +1,1011 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "RecordingBuilder.hpp"
+
+using namespace UTAP;
+
+RecordingBuilder::RecordingBuilder(std::shared_ptr<names_t> types, std::shared_ptr<const names_t> globals, bool keep):
+    types{std::move(types)}, globals{std::move(globals)}, keep{keep}
+{}
+
+RecordingBuilder::RecordingBuilder(ParserBuilder& target, size_t skip): target{&target}, skip{skip} {}
+
+size_t RecordingBuilder::replay(ParserBuilder& builder, uint32_t shift) const
+{
+    for (size_t i = 0; i < entries.size(); ++i) {
+        try {
+            if (!entries[i](builder, shift))
+                return i;
+        } catch (TypeException& te) {
+            builder.handleError(te);
+        }
+    }
+    return entries.size();
+}
+
+void RecordingBuilder::addPosition(uint32_t position, uint32_t offset, uint32_t line, const std::string& path)
+{
+    if (target) {
+        if (count++ >= skip)
+            target->addPosition(position, offset, line, path);
+    } else if (keep) {
+        entries.emplace_back([=](ParserBuilder& b, uint32_t shift) {
+            b.addPosition(position + shift, offset, line, path);
+            return true;
+        });
+    }
+}
+
+void RecordingBuilder::setPosition(uint32_t a, uint32_t b)
+{
+    if (target) {
+        if (count++ >= skip)
+            target->setPosition(a, b);
+    } else if (keep) {
+        entries.emplace_back([=](ParserBuilder& builder, uint32_t shift) {
+            builder.setPosition(a + shift, b + shift);
+            return true;
+        });
+    }
+}
+
+bool RecordingBuilder::isType(const char* name)
+{
+    if (target) {
+        ++count;
+        return target->isType(name);
+    }
+    const bool answer = types->count(name) > 0 || (globals && globals->count(name) > 0);
+    if (keep) {
+        entries.emplace_back([name = std::string{name}, answer](ParserBuilder& b, uint32_t) {
+            return b.isType(name.c_str()) == answer;
+        });
+    }
+    return answer;
+}
+
+void RecordingBuilder::declTypeDef(const char* name)
+{
+    if (!target)
+        types->insert(name);
+    call([name = str_t{name}](ParserBuilder& b) { b.declTypeDef(name.get()); });
+}
+
+void RecordingBuilder::handleError(const TypeException& error)
+{
+    call([error](ParserBuilder& b) { b.handleError(error); });
+}
+
+void RecordingBuilder::handleWarning(const TypeException& error)
+{
+    call([error](ParserBuilder& b) { b.handleWarning(error); });
+}
+
+void RecordingBuilder::typeDuplicate()
+{
+    call([](ParserBuilder& b) { b.typeDuplicate(); });
+}
+
+void RecordingBuilder::typePop()
+{
+    call([](ParserBuilder& b) { b.typePop(); });
+}
+
+void RecordingBuilder::typeBool(PREFIX arg)
+{
+    call([arg](ParserBuilder& b) { b.typeBool(arg); });
+}
+
+void RecordingBuilder::typeInt(PREFIX arg)
+{
+    call([arg](ParserBuilder& b) { b.typeInt(arg); });
+}
+
+void RecordingBuilder::typeString(PREFIX arg)
+{
+    call([arg](ParserBuilder& b) { b.typeString(arg); });
+}
+
+void RecordingBuilder::typeDouble(PREFIX arg)
+{
+    call([arg](ParserBuilder& b) { b.typeDouble(arg); });
+}
+
+void RecordingBuilder::typeBoundedInt(PREFIX arg)
+{
+    call([arg](ParserBuilder& b) { b.typeBoundedInt(arg); });
+}
+
+void RecordingBuilder::typeChannel(PREFIX arg)
+{
+    call([arg](ParserBuilder& b) { b.typeChannel(arg); });
+}
+
+void RecordingBuilder::typeClock(PREFIX arg)
+{
+    call([arg](ParserBuilder& b) { b.typeClock(arg); });
+}
+
+void RecordingBuilder::typeVoid()
+{
+    call([](ParserBuilder& b) { b.typeVoid(); });
+}
+
+void RecordingBuilder::typeArrayOfSize(size_t arg)
+{
+    call([arg](ParserBuilder& b) { b.typeArrayOfSize(arg); });
+}
+
+void RecordingBuilder::typeArrayOfType(size_t arg)
+{
+    call([arg](ParserBuilder& b) { b.typeArrayOfType(arg); });
+}
+
+void RecordingBuilder::typeScalar(PREFIX arg)
+{
+    call([arg](ParserBuilder& b) { b.typeScalar(arg); });
+}
+
+void RecordingBuilder::typeName(PREFIX arg1, const char* name)
+{
+    call([arg1, name = str_t{name}](ParserBuilder& b) { b.typeName(arg1, name.get()); });
+}
+
+void RecordingBuilder::typeStruct(PREFIX arg1, uint32_t fields)
+{
+    call([arg1, fields](ParserBuilder& b) { b.typeStruct(arg1, fields); });
+}
+
+void RecordingBuilder::structField(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.structField(name.get()); });
+}
+
+void RecordingBuilder::declVar(const char* name, bool init)
+{
+    call([name = str_t{name}, init](ParserBuilder& b) { b.declVar(name.get(), init); });
+}
+
+void RecordingBuilder::declInitialiserList(uint32_t num)
+{
+    call([num](ParserBuilder& b) { b.declInitialiserList(num); });
+}
+
+void RecordingBuilder::declFieldInit(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.declFieldInit(name.get()); });
+}
+
+void RecordingBuilder::declProgress(bool hasGuard)
+{
+    call([hasGuard](ParserBuilder& b) { b.declProgress(hasGuard); });
+}
+
+void RecordingBuilder::ganttDeclStart(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.ganttDeclStart(name.get()); });
+}
+
+void RecordingBuilder::ganttDeclSelect(const char* id)
+{
+    call([id = str_t{id}](ParserBuilder& b) { b.ganttDeclSelect(id.get()); });
+}
+
+void RecordingBuilder::ganttDeclEnd()
+{
+    call([](ParserBuilder& b) { b.ganttDeclEnd(); });
+}
+
+void RecordingBuilder::ganttEntryStart()
+{
+    call([](ParserBuilder& b) { b.ganttEntryStart(); });
+}
+
+void RecordingBuilder::ganttEntrySelect(const char* id)
+{
+    call([id = str_t{id}](ParserBuilder& b) { b.ganttEntrySelect(id.get()); });
+}
+
+void RecordingBuilder::ganttEntryEnd()
+{
+    call([](ParserBuilder& b) { b.ganttEntryEnd(); });
+}
+
+void RecordingBuilder::declParameter(const char* name, bool ref)
+{
+    call([name = str_t{name}, ref](ParserBuilder& b) { b.declParameter(name.get(), ref); });
+}
+
+void RecordingBuilder::declFuncBegin(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.declFuncBegin(name.get()); });
+}
+
+void RecordingBuilder::declFuncEnd()
+{
+    call([](ParserBuilder& b) { b.declFuncEnd(); });
+}
+
+void RecordingBuilder::dynamicLoadLib(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.dynamicLoadLib(name.get()); });
+}
+
+void RecordingBuilder::declExternalFunc(const char* name, const char* alias)
+{
+    call([name = str_t{name}, alias = str_t{alias}](ParserBuilder& b) { b.declExternalFunc(name.get(), alias.get()); });
+}
+
+void RecordingBuilder::procBegin(const char* name, const bool isTA, const std::string& type, const std::string& mode)
+{
+    call([name = str_t{name}, isTA, type, mode](ParserBuilder& b) { b.procBegin(name.get(), isTA, type, mode); });
+}
+
+void RecordingBuilder::procEnd()
+{
+    call([](ParserBuilder& b) { b.procEnd(); });
+}
+
+void RecordingBuilder::procSkipped(const char* name, const std::string& xpath, const std::string& text)
+{
+    call([name = str_t{name}, xpath, text](ParserBuilder& b) { b.procSkipped(name.get(), xpath, text); });
+}
+
+void RecordingBuilder::procState(const char* name, bool hasInvariant, bool hasER)
+{
+    call([name = str_t{name}, hasInvariant, hasER](ParserBuilder& b) { b.procState(name.get(), hasInvariant, hasER); });
+}
+
+void RecordingBuilder::procStateCommit(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.procStateCommit(name.get()); });
+}
+
+void RecordingBuilder::procStateUrgent(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.procStateUrgent(name.get()); });
+}
+
+void RecordingBuilder::procStateInit(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.procStateInit(name.get()); });
+}
+
+void RecordingBuilder::procEdgeBegin(const char* from, const char* to, const bool control, const char* actname)
+{
+    call([from = str_t{from}, to = str_t{to}, control, actname = str_t{actname}](ParserBuilder& b) { b.procEdgeBegin(from.get(), to.get(), control, actname.get()); });
+}
+
+void RecordingBuilder::procEdgeEnd(const char* from, const char* to)
+{
+    call([from = str_t{from}, to = str_t{to}](ParserBuilder& b) { b.procEdgeEnd(from.get(), to.get()); });
+}
+
+void RecordingBuilder::procSelect(const char* id)
+{
+    call([id = str_t{id}](ParserBuilder& b) { b.procSelect(id.get()); });
+}
+
+void RecordingBuilder::procGuard()
+{
+    call([](ParserBuilder& b) { b.procGuard(); });
+}
+
+void RecordingBuilder::procSync(Constants::synchronisation_t type)
+{
+    call([type](ParserBuilder& b) { b.procSync(type); });
+}
+
+void RecordingBuilder::procUpdate()
+{
+    call([](ParserBuilder& b) { b.procUpdate(); });
+}
+
+void RecordingBuilder::procProb()
+{
+    call([](ParserBuilder& b) { b.procProb(); });
+}
+
+void RecordingBuilder::procBranchpoint(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.procBranchpoint(name.get()); });
+}
+
+void RecordingBuilder::procInstanceLine()
+{
+    call([](ParserBuilder& b) { b.procInstanceLine(); });
+}
+
+void RecordingBuilder::instanceName(const char* name, bool templ)
+{
+    call([name = str_t{name}, templ](ParserBuilder& b) { b.instanceName(name.get(), templ); });
+}
+
+void RecordingBuilder::instanceNameBegin(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.instanceNameBegin(name.get()); });
+}
+
+void RecordingBuilder::instanceNameEnd(const char* name, size_t arguments)
+{
+    call([name = str_t{name}, arguments](ParserBuilder& b) { b.instanceNameEnd(name.get(), arguments); });
+}
+
+void RecordingBuilder::procMessage(const char* from, const char* to, const int loc, const bool pch)
+{
+    call([from = str_t{from}, to = str_t{to}, loc, pch](ParserBuilder& b) { b.procMessage(from.get(), to.get(), loc, pch); });
+}
+
+void RecordingBuilder::procMessage(Constants::synchronisation_t type)
+{
+    call([type](ParserBuilder& b) { b.procMessage(type); });
+}
+
+void RecordingBuilder::procCondition(const std::vector<std::string>& anchors, const int loc, const bool pch, const bool hot)
+{
+    call([anchors, loc, pch, hot](ParserBuilder& b) { b.procCondition(anchors, loc, pch, hot); });
+}
+
+void RecordingBuilder::procCondition()
+{
+    call([](ParserBuilder& b) { b.procCondition(); });
+}
+
+void RecordingBuilder::procLscUpdate(const char* anchor, const int loc, const bool pch)
+{
+    call([anchor = str_t{anchor}, loc, pch](ParserBuilder& b) { b.procLscUpdate(anchor.get(), loc, pch); });
+}
+
+void RecordingBuilder::procLscUpdate()
+{
+    call([](ParserBuilder& b) { b.procLscUpdate(); });
+}
+
+void RecordingBuilder::hasPrechart(const bool pch)
+{
+    call([pch](ParserBuilder& b) { b.hasPrechart(pch); });
+}
+
+void RecordingBuilder::blockBegin()
+{
+    call([](ParserBuilder& b) { b.blockBegin(); });
+}
+
+void RecordingBuilder::blockEnd()
+{
+    call([](ParserBuilder& b) { b.blockEnd(); });
+}
+
+void RecordingBuilder::emptyStatement()
+{
+    call([](ParserBuilder& b) { b.emptyStatement(); });
+}
+
+void RecordingBuilder::forBegin()
+{
+    call([](ParserBuilder& b) { b.forBegin(); });
+}
+
+void RecordingBuilder::forEnd()
+{
+    call([](ParserBuilder& b) { b.forEnd(); });
+}
+
+void RecordingBuilder::iterationBegin(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.iterationBegin(name.get()); });
+}
+
+void RecordingBuilder::iterationEnd(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.iterationEnd(name.get()); });
+}
+
+void RecordingBuilder::whileBegin()
+{
+    call([](ParserBuilder& b) { b.whileBegin(); });
+}
+
+void RecordingBuilder::whileEnd()
+{
+    call([](ParserBuilder& b) { b.whileEnd(); });
+}
+
+void RecordingBuilder::doWhileBegin()
+{
+    call([](ParserBuilder& b) { b.doWhileBegin(); });
+}
+
+void RecordingBuilder::doWhileEnd()
+{
+    call([](ParserBuilder& b) { b.doWhileEnd(); });
+}
+
+void RecordingBuilder::ifBegin()
+{
+    call([](ParserBuilder& b) { b.ifBegin(); });
+}
+
+void RecordingBuilder::ifCondition()
+{
+    call([](ParserBuilder& b) { b.ifCondition(); });
+}
+
+void RecordingBuilder::ifThen()
+{
+    call([](ParserBuilder& b) { b.ifThen(); });
+}
+
+void RecordingBuilder::ifEnd(bool elsePart)
+{
+    call([elsePart](ParserBuilder& b) { b.ifEnd(elsePart); });
+}
+
+void RecordingBuilder::breakStatement()
+{
+    call([](ParserBuilder& b) { b.breakStatement(); });
+}
+
+void RecordingBuilder::continueStatement()
+{
+    call([](ParserBuilder& b) { b.continueStatement(); });
+}
+
+void RecordingBuilder::switchBegin()
+{
+    call([](ParserBuilder& b) { b.switchBegin(); });
+}
+
+void RecordingBuilder::switchEnd()
+{
+    call([](ParserBuilder& b) { b.switchEnd(); });
+}
+
+void RecordingBuilder::caseBegin()
+{
+    call([](ParserBuilder& b) { b.caseBegin(); });
+}
+
+void RecordingBuilder::caseEnd()
+{
+    call([](ParserBuilder& b) { b.caseEnd(); });
+}
+
+void RecordingBuilder::defaultBegin()
+{
+    call([](ParserBuilder& b) { b.defaultBegin(); });
+}
+
+void RecordingBuilder::defaultEnd()
+{
+    call([](ParserBuilder& b) { b.defaultEnd(); });
+}
+
+void RecordingBuilder::exprStatement()
+{
+    call([](ParserBuilder& b) { b.exprStatement(); });
+}
+
+void RecordingBuilder::returnStatement(bool arg)
+{
+    call([arg](ParserBuilder& b) { b.returnStatement(arg); });
+}
+
+void RecordingBuilder::assertStatement()
+{
+    call([](ParserBuilder& b) { b.assertStatement(); });
+}
+
+void RecordingBuilder::exprFalse()
+{
+    call([](ParserBuilder& b) { b.exprFalse(); });
+}
+
+void RecordingBuilder::exprTrue()
+{
+    call([](ParserBuilder& b) { b.exprTrue(); });
+}
+
+void RecordingBuilder::exprDouble(double arg)
+{
+    call([arg](ParserBuilder& b) { b.exprDouble(arg); });
+}
+
+void RecordingBuilder::exprString(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprString(name.get()); });
+}
+
+void RecordingBuilder::exprId(const char* varName)
+{
+    call([varName = str_t{varName}](ParserBuilder& b) { b.exprId(varName.get()); });
+}
+
+void RecordingBuilder::exprLocation()
+{
+    call([](ParserBuilder& b) { b.exprLocation(); });
+}
+
+void RecordingBuilder::exprNat(int32_t arg)
+{
+    call([arg](ParserBuilder& b) { b.exprNat(arg); });
+}
+
+void RecordingBuilder::exprCallBegin()
+{
+    call([](ParserBuilder& b) { b.exprCallBegin(); });
+}
+
+void RecordingBuilder::exprCallEnd(uint32_t n)
+{
+    call([n](ParserBuilder& b) { b.exprCallEnd(n); });
+}
+
+void RecordingBuilder::exprArray()
+{
+    call([](ParserBuilder& b) { b.exprArray(); });
+}
+
+void RecordingBuilder::exprPostIncrement()
+{
+    call([](ParserBuilder& b) { b.exprPostIncrement(); });
+}
+
+void RecordingBuilder::exprPreIncrement()
+{
+    call([](ParserBuilder& b) { b.exprPreIncrement(); });
+}
+
+void RecordingBuilder::exprPostDecrement()
+{
+    call([](ParserBuilder& b) { b.exprPostDecrement(); });
+}
+
+void RecordingBuilder::exprPreDecrement()
+{
+    call([](ParserBuilder& b) { b.exprPreDecrement(); });
+}
+
+void RecordingBuilder::exprAssignment(Constants::kind_t op)
+{
+    call([op](ParserBuilder& b) { b.exprAssignment(op); });
+}
+
+void RecordingBuilder::exprUnary(Constants::kind_t unaryop)
+{
+    call([unaryop](ParserBuilder& b) { b.exprUnary(unaryop); });
+}
+
+void RecordingBuilder::exprBinary(Constants::kind_t binaryop)
+{
+    call([binaryop](ParserBuilder& b) { b.exprBinary(binaryop); });
+}
+
+void RecordingBuilder::exprNary(Constants::kind_t arg1, uint32_t num)
+{
+    call([arg1, num](ParserBuilder& b) { b.exprNary(arg1, num); });
+}
+
+void RecordingBuilder::exprScenario(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprScenario(name.get()); });
+}
+
+void RecordingBuilder::exprTernary(Constants::kind_t ternaryop, bool firstMissing)
+{
+    call([ternaryop, firstMissing](ParserBuilder& b) { b.exprTernary(ternaryop, firstMissing); });
+}
+
+void RecordingBuilder::exprInlineIf()
+{
+    call([](ParserBuilder& b) { b.exprInlineIf(); });
+}
+
+void RecordingBuilder::exprComma()
+{
+    call([](ParserBuilder& b) { b.exprComma(); });
+}
+
+void RecordingBuilder::exprDot(const char* arg)
+{
+    call([arg = str_t{arg}](ParserBuilder& b) { b.exprDot(arg.get()); });
+}
+
+void RecordingBuilder::exprDeadlock()
+{
+    call([](ParserBuilder& b) { b.exprDeadlock(); });
+}
+
+void RecordingBuilder::exprForAllBegin(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprForAllBegin(name.get()); });
+}
+
+void RecordingBuilder::exprForAllEnd(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprForAllEnd(name.get()); });
+}
+
+void RecordingBuilder::exprExistsBegin(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprExistsBegin(name.get()); });
+}
+
+void RecordingBuilder::exprExistsEnd(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprExistsEnd(name.get()); });
+}
+
+void RecordingBuilder::exprSumBegin(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprSumBegin(name.get()); });
+}
+
+void RecordingBuilder::exprSumEnd(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprSumEnd(name.get()); });
+}
+
+void RecordingBuilder::exprProbaQualitative(Constants::kind_t arg1, Constants::kind_t arg2, double arg3)
+{
+    call([arg1, arg2, arg3](ParserBuilder& b) { b.exprProbaQualitative(arg1, arg2, arg3); });
+}
+
+void RecordingBuilder::exprProbaQuantitative(Constants::kind_t arg)
+{
+    call([arg](ParserBuilder& b) { b.exprProbaQuantitative(arg); });
+}
+
+void RecordingBuilder::exprProbaCompare(Constants::kind_t arg1, Constants::kind_t arg2)
+{
+    call([arg1, arg2](ParserBuilder& b) { b.exprProbaCompare(arg1, arg2); });
+}
+
+void RecordingBuilder::exprProbaExpected(const char* identifier)
+{
+    call([identifier = str_t{identifier}](ParserBuilder& b) { b.exprProbaExpected(identifier.get()); });
+}
+
+void RecordingBuilder::exprSimulate(int nb_of_exprs, bool filter_prop, int max_accepting_runs)
+{
+    call([nb_of_exprs, filter_prop, max_accepting_runs](ParserBuilder& b) { b.exprSimulate(nb_of_exprs, filter_prop, max_accepting_runs); });
+}
+
+void RecordingBuilder::exprBuiltinFunction1(Constants::kind_t arg)
+{
+    call([arg](ParserBuilder& b) { b.exprBuiltinFunction1(arg); });
+}
+
+void RecordingBuilder::exprBuiltinFunction2(Constants::kind_t arg)
+{
+    call([arg](ParserBuilder& b) { b.exprBuiltinFunction2(arg); });
+}
+
+void RecordingBuilder::exprBuiltinFunction3(Constants::kind_t arg)
+{
+    call([arg](ParserBuilder& b) { b.exprBuiltinFunction3(arg); });
+}
+
+void RecordingBuilder::exprMinMaxExp(Constants::kind_t arg1, PRICETYPE arg2, Constants::kind_t arg3)
+{
+    call([arg1, arg2, arg3](ParserBuilder& b) { b.exprMinMaxExp(arg1, arg2, arg3); });
+}
+
+void RecordingBuilder::exprLoadStrategy()
+{
+    call([](ParserBuilder& b) { b.exprLoadStrategy(); });
+}
+
+void RecordingBuilder::exprSaveStrategy()
+{
+    call([](ParserBuilder& b) { b.exprSaveStrategy(); });
+}
+
+void RecordingBuilder::exprMitlFormula()
+{
+    call([](ParserBuilder& b) { b.exprMitlFormula(); });
+}
+
+void RecordingBuilder::exprMitlUntil(int arg1, int arg2)
+{
+    call([arg1, arg2](ParserBuilder& b) { b.exprMitlUntil(arg1, arg2); });
+}
+
+void RecordingBuilder::exprMitlRelease(int arg1, int arg2)
+{
+    call([arg1, arg2](ParserBuilder& b) { b.exprMitlRelease(arg1, arg2); });
+}
+
+void RecordingBuilder::exprMitlDisj()
+{
+    call([](ParserBuilder& b) { b.exprMitlDisj(); });
+}
+
+void RecordingBuilder::exprMitlConj()
+{
+    call([](ParserBuilder& b) { b.exprMitlConj(); });
+}
+
+void RecordingBuilder::exprMitlNext()
+{
+    call([](ParserBuilder& b) { b.exprMitlNext(); });
+}
+
+void RecordingBuilder::exprMitlAtom()
+{
+    call([](ParserBuilder& b) { b.exprMitlAtom(); });
+}
+
+void RecordingBuilder::exprMitlDiamond(int arg1, int arg2)
+{
+    call([arg1, arg2](ParserBuilder& b) { b.exprMitlDiamond(arg1, arg2); });
+}
+
+void RecordingBuilder::exprMitlBox(int arg1, int arg2)
+{
+    call([arg1, arg2](ParserBuilder& b) { b.exprMitlBox(arg1, arg2); });
+}
+
+void RecordingBuilder::exprOptimize(int arg1, int arg2, int arg3, int arg4)
+{
+    call([arg1, arg2, arg3, arg4](ParserBuilder& b) { b.exprOptimize(arg1, arg2, arg3, arg4); });
+}
+
+void RecordingBuilder::instantiationBegin(const char* id, size_t parameters, const char* templ)
+{
+    call([id = str_t{id}, parameters, templ = str_t{templ}](ParserBuilder& b) { b.instantiationBegin(id.get(), parameters, templ.get()); });
+}
+
+void RecordingBuilder::instantiationEnd(const char* id, size_t parameters, const char* templ, size_t arguments)
+{
+    call([id = str_t{id}, parameters, templ = str_t{templ}, arguments](ParserBuilder& b) { b.instantiationEnd(id.get(), parameters, templ.get(), arguments); });
+}
+
+void RecordingBuilder::process(const char* arg)
+{
+    call([arg = str_t{arg}](ParserBuilder& b) { b.process(arg.get()); });
+}
+
+void RecordingBuilder::processListEnd()
+{
+    call([](ParserBuilder& b) { b.processListEnd(); });
+}
+
+void RecordingBuilder::done()
+{
+    call([](ParserBuilder& b) { b.done(); });
+}
+
+void RecordingBuilder::handleExpect(const char* text)
+{
+    call([text = str_t{text}](ParserBuilder& b) { b.handleExpect(text.get()); });
+}
+
+void RecordingBuilder::property()
+{
+    call([](ParserBuilder& b) { b.property(); });
+}
+
+void RecordingBuilder::scenario(const char* arg)
+{
+    call([arg = str_t{arg}](ParserBuilder& b) { b.scenario(arg.get()); });
+}
+
+void RecordingBuilder::parse(const char* arg)
+{
+    call([arg = str_t{arg}](ParserBuilder& b) { b.parse(arg.get()); });
+}
+
+void RecordingBuilder::strategyDeclaration(const char* arg)
+{
+    call([arg = str_t{arg}](ParserBuilder& b) { b.strategyDeclaration(arg.get()); });
+}
+
+void RecordingBuilder::subjection(const char* arg)
+{
+    call([arg = str_t{arg}](ParserBuilder& b) { b.subjection(arg.get()); });
+}
+
+void RecordingBuilder::imitation(const char* arg)
+{
+    call([arg = str_t{arg}](ParserBuilder& b) { b.imitation(arg.get()); });
+}
+
+void RecordingBuilder::beforeUpdate()
+{
+    call([](ParserBuilder& b) { b.beforeUpdate(); });
+}
+
+void RecordingBuilder::afterUpdate()
+{
+    call([](ParserBuilder& b) { b.afterUpdate(); });
+}
+
+void RecordingBuilder::beginChanPriority()
+{
+    call([](ParserBuilder& b) { b.beginChanPriority(); });
+}
+
+void RecordingBuilder::addChanPriority(char separator)
+{
+    call([separator](ParserBuilder& b) { b.addChanPriority(separator); });
+}
+
+void RecordingBuilder::defaultChanPriority()
+{
+    call([](ParserBuilder& b) { b.defaultChanPriority(); });
+}
+
+void RecordingBuilder::incProcPriority()
+{
+    call([](ParserBuilder& b) { b.incProcPriority(); });
+}
+
+void RecordingBuilder::procPriority(const std::string& arg)
+{
+    call([arg](ParserBuilder& b) { b.procPriority(arg); });
+}
+
+void RecordingBuilder::declDynamicTemplate(const std::string& name)
+{
+    call([name](ParserBuilder& b) { b.declDynamicTemplate(name); });
+}
+
+void RecordingBuilder::exprSpawn(int arg)
+{
+    call([arg](ParserBuilder& b) { b.exprSpawn(arg); });
+}
+
+void RecordingBuilder::exprExit()
+{
+    call([](ParserBuilder& b) { b.exprExit(); });
+}
+
+void RecordingBuilder::exprNumOf()
+{
+    call([](ParserBuilder& b) { b.exprNumOf(); });
+}
+
+void RecordingBuilder::exprForAllDynamicBegin(const char* arg1, const char* arg2)
+{
+    call([arg1 = str_t{arg1}, arg2 = str_t{arg2}](ParserBuilder& b) { b.exprForAllDynamicBegin(arg1.get(), arg2.get()); });
+}
+
+void RecordingBuilder::exprForAllDynamicEnd(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprForAllDynamicEnd(name.get()); });
+}
+
+void RecordingBuilder::exprExistsDynamicBegin(const char* arg1, const char* arg2)
+{
+    call([arg1 = str_t{arg1}, arg2 = str_t{arg2}](ParserBuilder& b) { b.exprExistsDynamicBegin(arg1.get(), arg2.get()); });
+}
+
+void RecordingBuilder::exprExistsDynamicEnd(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprExistsDynamicEnd(name.get()); });
+}
+
+void RecordingBuilder::exprSumDynamicBegin(const char* arg1, const char* arg2)
+{
+    call([arg1 = str_t{arg1}, arg2 = str_t{arg2}](ParserBuilder& b) { b.exprSumDynamicBegin(arg1.get(), arg2.get()); });
+}
+
+void RecordingBuilder::exprSumDynamicEnd(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprSumDynamicEnd(name.get()); });
+}
+
+void RecordingBuilder::exprForeachDynamicBegin(const char* arg1, const char* arg2)
+{
+    call([arg1 = str_t{arg1}, arg2 = str_t{arg2}](ParserBuilder& b) { b.exprForeachDynamicBegin(arg1.get(), arg2.get()); });
+}
+
+void RecordingBuilder::exprForeachDynamicEnd(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprForeachDynamicEnd(name.get()); });
+}
+
+void RecordingBuilder::exprMITLForAllDynamicBegin(const char* arg1, const char* arg2)
+{
+    call([arg1 = str_t{arg1}, arg2 = str_t{arg2}](ParserBuilder& b) { b.exprMITLForAllDynamicBegin(arg1.get(), arg2.get()); });
+}
+
+void RecordingBuilder::exprMITLForAllDynamicEnd(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprMITLForAllDynamicEnd(name.get()); });
+}
+
+void RecordingBuilder::exprMITLExistsDynamicBegin(const char* arg1, const char* arg2)
+{
+    call([arg1 = str_t{arg1}, arg2 = str_t{arg2}](ParserBuilder& b) { b.exprMITLExistsDynamicBegin(arg1.get(), arg2.get()); });
+}
+
+void RecordingBuilder::exprMITLExistsDynamicEnd(const char* name)
+{
+    call([name = str_t{name}](ParserBuilder& b) { b.exprMITLExistsDynamicEnd(name.get()); });
+}
+
+void RecordingBuilder::exprDynamicProcessExpr(const char* arg)
+{
+    call([arg = str_t{arg}](ParserBuilder& b) { b.exprDynamicProcessExpr(arg.get()); });
+}
+
+void RecordingBuilder::modelOption(const char* key, const char* value)
+{
+    call([key = str_t{key}, value = str_t{value}](ParserBuilder& b) { b.modelOption(key.get(), value.get()); });
+}
+
+void RecordingBuilder::queryBegin()
+{
+    call([](ParserBuilder& b) { b.queryBegin(); });
+}
+
+void RecordingBuilder::queryFormula(const char* formula, const char* location)
+{
+    call([formula = str_t{formula}, location = str_t{location}](ParserBuilder& b) { b.queryFormula(formula.get(), location.get()); });
+}
+
+void RecordingBuilder::queryComment(const char* comment)
+{
+    call([comment = str_t{comment}](ParserBuilder& b) { b.queryComment(comment.get()); });
+}
+
+void RecordingBuilder::queryOptions(const char* option, const char* arg2)
+{
+    call([option = str_t{option}, arg2 = str_t{arg2}](ParserBuilder& b) { b.queryOptions(option.get(), arg2.get()); });
+}
+
+void RecordingBuilder::expectationBegin()
+{
+    call([](ParserBuilder& b) { b.expectationBegin(); });
+}
+
+void RecordingBuilder::expectationEnd()
+{
+    call([](ParserBuilder& b) { b.expectationEnd(); });
+}
+
+void RecordingBuilder::expectationValue(const char* res, const char* type, const char* value)
+{
+    call([res = str_t{res}, type = str_t{type}, value = str_t{value}](ParserBuilder& b) { b.expectationValue(res.get(), type.get(), value.get()); });
+}
+
+void RecordingBuilder::expectResource(const char* type, const char* value, const char* unit)
+{
+    call([type = str_t{type}, value = str_t{value}, unit = str_t{unit}](ParserBuilder& b) { b.expectResource(type.get(), value.get(), unit.get()); });
+}
+
+void RecordingBuilder::queryResultsBegin()
+{
+    call([](ParserBuilder& b) { b.queryResultsBegin(); });
+}
+
+void RecordingBuilder::queryResultsEnd()
+{
+    call([](ParserBuilder& b) { b.queryResultsEnd(); });
+}
+
+void RecordingBuilder::queryEnd()
+{
+    call([](ParserBuilder& b) { b.queryEnd(); });
+}
@@ -0,0 +1,303 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#ifndef UTAP_RECORDINGBUILDER_HPP
+#define UTAP_RECORDINGBUILDER_HPP
+
+#include "utap/builder.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace UTAP
+{
+    /**
+     * A parser builder which records the calls made by the parser, so
+     * that a text can be parsed on one thread and replayed into the
+     * real builder on another (later and in document order).
+     *
+     * The only information flowing from the builder to the parser is
+     * the answer of isType(). While recording, the answers are guessed
+     * from the type names declared so far (in the recording itself or
+     * in the given set of global type names), and each answer is
+     * recorded as a check: replay() stops at the first check that the
+     * real builder answers differently. The caller can then parse the
+     * text again with a forwarding RecordingBuilder, which skips the
+     * calls that were already replayed and passes the rest on to the
+     * real builder.
+     */
+    class RecordingBuilder : public ParserBuilder
+    {
+    public:
+        using names_t = std::unordered_set<std::string>;
+
+        /**
+         * Records the calls. Type names are guessed from the ones
+         * declared in \a types (which is extended by declTypeDef) and
+         * \a globals (may be null). Unless \a keep is true the calls
+         * are only used to collect the type names and are not stored.
+         */
+        RecordingBuilder(std::shared_ptr<names_t> types, std::shared_ptr<const names_t> globals, bool keep = true);
+
+        /** Forwards the calls to \a target, except for the first \a skip ones. */
+        RecordingBuilder(ParserBuilder& target, size_t skip);
+
+        /** The number of recorded calls and checks. */
+        size_t size() const { return entries.size(); }
+
+        /**
+         * Replays the recorded calls into \a builder adding \a shift
+         * to all positions. Type exceptions are reported to the builder
+         * like the parser does. Returns the number of replayed entries,
+         * which is less than size() if a check failed.
+         */
+        size_t replay(ParserBuilder& builder, uint32_t shift) const;
+
+        void addPosition(uint32_t position, uint32_t offset, uint32_t line, const std::string& path) override;
+        void setPosition(uint32_t a, uint32_t b) override;
+        void handleError(const TypeException&) override;
+        void handleWarning(const TypeException&) override;
+        bool isType(const char*) override;
+        void typeDuplicate() override;
+        void typePop() override;
+        void typeBool(PREFIX) override;
+        void typeInt(PREFIX) override;
+        void typeString(PREFIX) override;
+        void typeDouble(PREFIX) override;
+        void typeBoundedInt(PREFIX) override;
+        void typeChannel(PREFIX) override;
+        void typeClock(PREFIX) override;
+        void typeVoid() override;
+        void typeArrayOfSize(size_t) override;
+        void typeArrayOfType(size_t) override;
+        void typeScalar(PREFIX) override;
+        void typeName(PREFIX, const char* name) override;
+        void typeStruct(PREFIX, uint32_t fields) override;
+        void structField(const char* name) override;
+        void declTypeDef(const char* name) override;
+        void declVar(const char* name, bool init) override;
+        void declInitialiserList(uint32_t num) override;
+        void declFieldInit(const char* name) override;
+        void declProgress(bool hasGuard) override;
+        void ganttDeclStart(const char* name) override;
+        void ganttDeclSelect(const char* id) override;
+        void ganttDeclEnd() override;
+        void ganttEntryStart() override;
+        void ganttEntrySelect(const char* id) override;
+        void ganttEntryEnd() override;
+        void declParameter(const char* name, bool ref) override;
+        void declFuncBegin(const char* name) override;
+        void declFuncEnd() override;
+        void dynamicLoadLib(const char* name) override;
+        void declExternalFunc(const char* name, const char* alias) override;
+        void procBegin(const char* name, const bool isTA, const std::string& type, const std::string& mode) override;
+        void procEnd() override;
+        void procSkipped(const char* name, const std::string& xpath, const std::string& text) override;
+        void procState(const char* name, bool hasInvariant, bool hasER) override;
+        void procStateCommit(const char* name) override;
+        void procStateUrgent(const char* name) override;
+        void procStateInit(const char* name) override;
+        void procEdgeBegin(const char* from, const char* to, const bool control, const char* actname) override;
+        void procEdgeEnd(const char* from, const char* to) override;
+        void procSelect(const char* id) override;
+        void procGuard() override;
+        void procSync(Constants::synchronisation_t type) override;
+        void procUpdate() override;
+        void procProb() override;
+        void procBranchpoint(const char* name) override;
+        void procInstanceLine() override;
+        void instanceName(const char* name, bool templ) override;
+        void instanceNameBegin(const char* name) override;
+        void instanceNameEnd(const char* name, size_t arguments) override;
+        void procMessage(const char* from, const char* to, const int loc, const bool pch) override;
+        void procMessage(Constants::synchronisation_t type) override;
+        void procCondition(const std::vector<std::string>& anchors, const int loc, const bool pch, const bool hot) override;
+        void procCondition() override;
+        void procLscUpdate(const char* anchor, const int loc, const bool pch) override;
+        void procLscUpdate() override;
+        void hasPrechart(const bool pch) override;
+        void blockBegin() override;
+        void blockEnd() override;
+        void emptyStatement() override;
+        void forBegin() override;
+        void forEnd() override;
+        void iterationBegin(const char* name) override;
+        void iterationEnd(const char* name) override;
+        void whileBegin() override;
+        void whileEnd() override;
+        void doWhileBegin() override;
+        void doWhileEnd() override;
+        void ifBegin() override;
+        void ifCondition() override;
+        void ifThen() override;
+        void ifEnd(bool elsePart) override;
+        void breakStatement() override;
+        void continueStatement() override;
+        void switchBegin() override;
+        void switchEnd() override;
+        void caseBegin() override;
+        void caseEnd() override;
+        void defaultBegin() override;
+        void defaultEnd() override;
+        void exprStatement() override;
+        void returnStatement(bool) override;
+        void assertStatement() override;
+        void exprFalse() override;
+        void exprTrue() override;
+        void exprDouble(double) override;
+        void exprString(const char* name) override;
+        void exprId(const char* varName) override;
+        void exprLocation() override;
+        void exprNat(int32_t) override;
+        void exprCallBegin() override;
+        void exprCallEnd(uint32_t n) override;
+        void exprArray() override;
+        void exprPostIncrement() override;
+        void exprPreIncrement() override;
+        void exprPostDecrement() override;
+        void exprPreDecrement() override;
+        void exprAssignment(Constants::kind_t op) override;
+        void exprUnary(Constants::kind_t unaryop) override;
+        void exprBinary(Constants::kind_t binaryop) override;
+        void exprNary(Constants::kind_t, uint32_t num) override;
+        void exprScenario(const char* name) override;
+        void exprTernary(Constants::kind_t ternaryop, bool firstMissing) override;
+        void exprInlineIf() override;
+        void exprComma() override;
+        void exprDot(const char*) override;
+        void exprDeadlock() override;
+        void exprForAllBegin(const char* name) override;
+        void exprForAllEnd(const char* name) override;
+        void exprExistsBegin(const char* name) override;
+        void exprExistsEnd(const char* name) override;
+        void exprSumBegin(const char* name) override;
+        void exprSumEnd(const char* name) override;
+        void exprProbaQualitative(Constants::kind_t, Constants::kind_t, double) override;
+        void exprProbaQuantitative(Constants::kind_t) override;
+        void exprProbaCompare(Constants::kind_t, Constants::kind_t) override;
+        void exprProbaExpected(const char* identifier) override;
+        void exprSimulate(int nb_of_exprs, bool filter_prop, int max_accepting_runs) override;
+        void exprBuiltinFunction1(Constants::kind_t) override;
+        void exprBuiltinFunction2(Constants::kind_t) override;
+        void exprBuiltinFunction3(Constants::kind_t) override;
+        void exprMinMaxExp(Constants::kind_t, PRICETYPE, Constants::kind_t) override;
+        void exprLoadStrategy() override;
+        void exprSaveStrategy() override;
+        void exprMitlFormula() override;
+        void exprMitlUntil(int, int) override;
+        void exprMitlRelease(int, int) override;
+        void exprMitlDisj() override;
+        void exprMitlConj() override;
+        void exprMitlNext() override;
+        void exprMitlAtom() override;
+        void exprMitlDiamond(int, int) override;
+        void exprMitlBox(int, int) override;
+        void exprOptimize(int, int, int, int) override;
+        void instantiationBegin(const char* id, size_t parameters, const char* templ) override;
+        void instantiationEnd(const char* id, size_t parameters, const char* templ, size_t arguments) override;
+        void process(const char*) override;
+        void processListEnd() override;
+        void done() override;
+        void handleExpect(const char* text) override;
+        void property() override;
+        void scenario(const char*) override;
+        void parse(const char*) override;
+        void strategyDeclaration(const char*) override;
+        void subjection(const char*) override;
+        void imitation(const char*) override;
+        void beforeUpdate() override;
+        void afterUpdate() override;
+        void beginChanPriority() override;
+        void addChanPriority(char separator) override;
+        void defaultChanPriority() override;
+        void incProcPriority() override;
+        void procPriority(const std::string&) override;
+        void declDynamicTemplate(const std::string& name) override;
+        void exprSpawn(int) override;
+        void exprExit() override;
+        void exprNumOf() override;
+        void exprForAllDynamicBegin(const char*, const char*) override;
+        void exprForAllDynamicEnd(const char* name) override;
+        void exprExistsDynamicBegin(const char*, const char*) override;
+        void exprExistsDynamicEnd(const char* name) override;
+        void exprSumDynamicBegin(const char*, const char*) override;
+        void exprSumDynamicEnd(const char* name) override;
+        void exprForeachDynamicBegin(const char*, const char*) override;
+        void exprForeachDynamicEnd(const char* name) override;
+        void exprMITLForAllDynamicBegin(const char*, const char*) override;
+        void exprMITLForAllDynamicEnd(const char* name) override;
+        void exprMITLExistsDynamicBegin(const char*, const char*) override;
+        void exprMITLExistsDynamicEnd(const char* name) override;
+        void exprDynamicProcessExpr(const char*) override;
+        void modelOption(const char* key, const char* value) override;
+        void queryBegin() override;
+        void queryFormula(const char* formula, const char* location) override;
+        void queryComment(const char* comment) override;
+        void queryOptions(const char* option, const char*) override;
+        void expectationBegin() override;
+        void expectationEnd() override;
+        void expectationValue(const char* res, const char* type, const char* value) override;
+        void expectResource(const char* type, const char* value, const char* unit) override;
+        void queryResultsBegin() override;
+        void queryResultsEnd() override;
+        void queryEnd() override;
+
+    private:
+        /** A copy of a (possibly null) string argument. */
+        struct str_t
+        {
+            std::string value;
+            bool null;
+            explicit str_t(const char* s): value{s ? s : ""}, null{s == nullptr} {}
+            const char* get() const { return null ? nullptr : value.c_str(); }
+        };
+        /** Returns false if the replay must stop (failed check). */
+        using entry_t = std::function<bool(ParserBuilder&, uint32_t shift)>;
+
+        std::vector<entry_t> entries;
+        std::shared_ptr<names_t> types;
+        std::shared_ptr<const names_t> globals;
+        bool keep{true};
+        ParserBuilder* target{nullptr};
+        size_t skip{0};
+        size_t count{0};
+
+        /** Forwards, records or drops a call depending on the mode. */
+        template <typename Fn>
+        void call(Fn&& fn)
+        {
+            if (target) {
+                if (count++ >= skip)
+                    fn(*target);
+            } else if (keep) {
+                entries.emplace_back([fn = std::forward<Fn>(fn)](ParserBuilder& b, uint32_t) {
+                    fn(b);
+                    return true;
+                });
+            }
+        }
+    };
+}  // namespace UTAP
+
+#endif /* UTAP_RECORDINGBUILDER_HPP */
@@ -21,6 +21,8 @@
 
 #include "utap/StatementBuilder.hpp"
 
+#include "utap/statistics.h"
+
 #include <filesystem>
 #include <stdexcept>
 #include <vector>
@@ -28,12 +30,6 @@
 #include <cinttypes>
 #include <cstring>
 
-#ifdef __MINGW32__
-#include <windows.h>
-#elif defined(__linux__) || defined(__APPLE__)
-#include <dlfcn.h>
-#endif
-
 using namespace UTAP;
 using namespace Constants;
 
@@ -52,15 +48,15 @@ StatementBuilder::~StatementBuilder() noexcept
         delete b;
 }
 
-void StatementBuilder::collectDependencies(std::set<symbol_t>& dependencies, expression_t expr)
+void StatementBuilder::collectDependencies(instance_t& instance, expression_t expr)
 {
     std::set<symbol_t> symbols;
     expr.collectPossibleReads(symbols);
     while (!symbols.empty()) {
         symbol_t s = *symbols.begin();
         symbols.erase(s);
-        if (dependencies.find(s) == dependencies.end()) {
-            dependencies.insert(s);
+        if (instance.restricted.insert(s).second) {
+            instance.restrictedSet.insert(s);
             if (auto d = s.getData(); d) {
                 if (auto t = s.getType(); !(t.isFunction() || t.isExternalFunction())) {
                     // assume is its variable, which is not always true
@@ -74,16 +70,16 @@ void StatementBuilder::collectDependencies(std::set<symbol_t>& dependencies, exp
     }
 }
 
-void StatementBuilder::collectDependencies(std::set<symbol_t>& dependencies, type_t type)
+void StatementBuilder::collectDependencies(instance_t& instance, type_t type)
 {
     if (type.getKind() == RANGE) {
         auto [lower, upper] = type.getRange();
-        collectDependencies(dependencies, lower);
-        collectDependencies(dependencies, upper);
-        collectDependencies(dependencies, type[0]);
+        collectDependencies(instance, lower);
+        collectDependencies(instance, upper);
+        collectDependencies(instance, type[0]);
     } else {
         for (size_t i = 0; i < type.size(); i++) {
-            collectDependencies(dependencies, type[i]);
+            collectDependencies(instance, type[i]);
         }
     }
 }
@@ -117,7 +113,7 @@ void StatementBuilder::typeArrayOfType(size_t n)
      * processes.
      */
     if (currentTemplate) {
-        collectDependencies(currentTemplate->restricted, size);
+        collectDependencies(*currentTemplate, size);
     }
 
     if ((!size.isInteger() && !size.isScalar()) || !size.is(RANGE)) {
@@ -180,7 +176,8 @@ void StatementBuilder::declTypeDef(const char* name)
     type_t type = type_t::createTypeDef(name, typeFragments[0], position);
     typeFragments.pop();
     if (duplicate) {
-        throw DuplicateDefinitionError(name);
+        handleError(DuplicateDefinitionError(name));
+        return;
     }
 
     frames.top().addSymbol(name, type, position);
@@ -431,51 +428,12 @@ void StatementBuilder::dynamicLoadLib(const char* lib)
     std::string name(lib + 1);
     name.erase(name.length() - 1);
 
-    void* loaded = nullptr;
-    // append ending if we are loading local file only.
-#ifdef __MINGW32__
-    auto path = std::filesystem::path(name + ".dll");
-#elif defined(__linux__) || defined(__APPLE__)
-    auto path = std::filesystem::path(name + ".so");
-#else
-    auto path = std::filesystem::path(name + ".so");
-#endif
-    if (std::filesystem::exists(path)) {
-#ifdef __MINGW32__
-        loaded = LoadLibrary(path.string().c_str());
-#elif defined(__linux__)
-        loaded = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
-#elif defined(__APPLE__)
-        loaded = dlopen(path.string().c_str(), RTLD_NOW | RTLD_LOCAL);
-#endif
-    } else {
-        for (const auto& prefix : libpaths) {
-            std::filesystem::path fullpath = prefix / name;
-            for (size_t i = 0; i < 2; ++i) {
-#ifdef __MINGW32__
-                if (i == 1)
-                    fullpath.concat(".dll");
-                loaded = LoadLibrary(fullpath.string().c_str());  // c_str() alone uses wchar_t(!)
-#elif defined(__linux__)
-                if (i == 1)
-                    fullpath.concat(".so");
-                loaded = dlopen(fullpath.c_str(), RTLD_NOW | RTLD_LOCAL);
-#elif defined(__APPLE__)
-                if (i == 1)
-                    fullpath.append(".so");
-                loaded = dlopen(fullpath.c_str(), RTLD_NOW | RTLD_LOCAL);
-#endif
-                if (loaded != nullptr)
-                    break;
-            }
-            if (loaded != nullptr)
-                break;
-        }
-    }
-    if (loaded == nullptr) {
+    auto phase = Statistics::Phase{Statistics::LIBRARIES};
+    auto loaded = LibraryCache::instance().load(name, libpaths);
+    if (!loaded) {
         handleError(CouldNotLoadLibraryError(name));
     }
-    document.addLibrary(loaded);
+    document.addLibrary(std::move(loaded));
 }
 
 void StatementBuilder::declExternalFunc(const char* name, const char* alias)
@@ -492,13 +450,7 @@ void StatementBuilder::declExternalFunc(const char* name, const char* alias)
         labels.push_back(params[i].getName());
     }
 
-    void* fp = nullptr;
-#ifdef __MINGW32__
-    fp = (void*)GetProcAddress((HMODULE)document.lastLibrary(), name);
-#elif __linux__
-    fp = dlsym(document.lastLibrary(), name);
-#endif
-
+    void* fp = document.lastLibrary().getFunction(name);
     if (fp == nullptr) {
         handleError(CouldNotLoadFunctionError(name));
     }
@@ -152,6 +152,11 @@ void AbstractBuilder::procBegin(const char* name, const bool isTA, const std::st
 
 void AbstractBuilder::procEnd() { throw NotSupportedException("procEnd is not supported"); }
 
+void AbstractBuilder::procSkipped(const char* name, const std::string& xpath, const std::string& text)
+{
+    throw NotSupportedException("procSkipped is not supported");
+}
+
 void AbstractBuilder::procState(const char* name, bool hasInvariant, bool hasER)
 {
     throw NotSupportedException("procState is not supported");
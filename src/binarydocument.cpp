@@ -0,0 +1,1323 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/binarydocument.h"
+
+#include "MappedFile.hpp"
+#include "utap/builder.h"
+#include "utap/node.h"
+#include "utap/statement.h"
+#include "utap/typechecker.h"
+#include "utap/utap.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <cstring>
+
+/*
+ * The file starts with a header (magic, format version and the number of
+ * expression kinds, which changes whenever Constants::kind_t does),
+ * followed by the tables of frames, symbols and type/expression nodes
+ * and finally the document itself, which refers to the tables by index.
+ * Integers are LEB128 varints (zigzag encoded if signed), doubles are
+ * stored as their 8 bytes in host order, and index 0 is the null object.
+ *
+ * Symbols point back to the object they declare (variable_t, state_t,
+ * instance_t, ...). These objects are numbered in the order they occur
+ * in the document and the user data of the symbols is set once the
+ * whole document has been read.
+ */
+
+using namespace UTAP;
+using namespace Constants;
+
+namespace
+{
+    constexpr char magic[8] = {'U', 'T', 'A', 'P', 'D', 'O', 'C', '\n'};
+    constexpr uint64_t version = 1;
+    constexpr uint64_t kinds = DOUBLEINVGUARD + 1;
+    constexpr uint64_t littleEndian = 1;
+
+    enum node_tag_t : uint8_t { TYPE_NODE, EXPRESSION_NODE };
+
+    enum statement_tag_t : uint8_t {
+        EMPTY_STATEMENT,
+        EXPR_STATEMENT,
+        ASSERT_STATEMENT,
+        FOR_STATEMENT,
+        ITERATION_STATEMENT,
+        WHILE_STATEMENT,
+        DOWHILE_STATEMENT,
+        BLOCK_STATEMENT,
+        SWITCH_STATEMENT,
+        CASE_STATEMENT,
+        DEFAULT_STATEMENT,
+        IF_STATEMENT,
+        BREAK_STATEMENT,
+        CONTINUE_STATEMENT,
+        RETURN_STATEMENT
+    };
+
+    bool isLittleEndian()
+    {
+        const uint16_t probe = 1;
+        auto first = uint8_t{};
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    class Output
+    {
+    public:
+        std::string buffer;
+
+        void u(uint64_t value)
+        {
+            while (value >= 0x80) {
+                buffer.push_back(static_cast<char>(value | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back(static_cast<char>(value));
+        }
+        void i(int64_t value) { u((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63)); }
+        void b(bool value) { buffer.push_back(value ? 1 : 0); }
+        void d(double value)
+        {
+            char bytes[sizeof(double)];
+            std::memcpy(bytes, &value, sizeof(double));
+            buffer.append(bytes, sizeof(double));
+        }
+        void s(std::string_view value)
+        {
+            u(value.size());
+            buffer.append(value);
+        }
+        void pos(const position_t& position)
+        {
+            u(position.start);
+            u(position.end);
+        }
+        void line(const Positions::line_t& line)
+        {
+            u(line.position);
+            u(line.offset);
+            u(line.line);
+            s(line.path);
+        }
+    };
+
+    class Input
+    {
+    public:
+        explicit Input(std::string_view text): next{text.data()}, end{text.data() + text.size()} {}
+
+        uint64_t u()
+        {
+            auto value = uint64_t{0};
+            for (auto shift = 0u; shift < 64; shift += 7) {
+                const auto byte = static_cast<uint8_t>(take(1)[0]);
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0)
+                    return value;
+            }
+            throw BinaryDocumentError("Corrupt binary document");
+        }
+        int64_t i()
+        {
+            const auto value = u();
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+        uint32_t u32()
+        {
+            const auto value = u();
+            if (value > UINT32_MAX)
+                throw BinaryDocumentError("Corrupt binary document");
+            return static_cast<uint32_t>(value);
+        }
+        int32_t i32() { return static_cast<int32_t>(i()); }
+        bool b() { return take(1)[0] != 0; }
+        double d()
+        {
+            auto value = 0.0;
+            std::memcpy(&value, take(sizeof(double)), sizeof(double));
+            return value;
+        }
+        std::string s()
+        {
+            const auto size = u();
+            if (size > static_cast<uint64_t>(end - next))
+                throw BinaryDocumentError("Truncated binary document");
+            return std::string{take(size), size};
+        }
+        std::string_view raw(size_t size) { return {take(size), size}; }
+        position_t pos()
+        {
+            const auto start = u32();
+            return {start, u32()};
+        }
+        Positions::line_t line()
+        {
+            const auto position = u32();
+            const auto offset = u32();
+            const auto number = u32();
+            return {position, offset, number, s()};
+        }
+        /** Returns the number of elements of a sequence, which cannot take less than a byte each. */
+        size_t count()
+        {
+            const auto size = u();
+            if (size > static_cast<uint64_t>(end - next))
+                throw BinaryDocumentError("Corrupt binary document");
+            return size;
+        }
+        bool atEnd() const { return next == end; }
+
+    private:
+        const char* next;
+        const char* end;
+
+        const char* take(size_t size)
+        {
+            if (size > static_cast<size_t>(end - next))
+                throw BinaryDocumentError("Truncated binary document");
+            const auto* res = next;
+            next += size;
+            return res;
+        }
+    };
+}  // namespace
+
+namespace UTAP
+{
+    /** Encodes a document. Declared a friend of the classes it needs to look into. */
+    class BinaryWriter : private StatementVisitor
+    {
+    public:
+        explicit BinaryWriter(const Document& doc): doc{doc} {}
+
+        std::string write()
+        {
+            if (!doc.libraries.empty())
+                throw BinaryDocumentError("Documents with external functions cannot be stored");
+            document();
+            // Symbols are added while their types are encoded, so this loop also closes the node table.
+            auto types = std::vector<uint32_t>{};
+            for (size_t i = 0; i < symbols.size(); ++i)
+                types.push_back(type(symbols[i].getType()));
+            auto homes = std::unordered_map<symbol_t, uint32_t>{};
+            for (size_t f = 0; f < frames.size(); ++f)
+                for (const auto& symbol : frames[f])
+                    if (symbol.isDeclaredIn(frames[f]))
+                        homes.emplace(symbol, f + 1);
+
+            auto out = Output{};
+            out.buffer.append(magic, sizeof(magic));
+            out.u(version);
+            out.u(kinds);
+            out.u(isLittleEndian() ? littleEndian : 0);
+            out.u(frames.size());
+            for (const auto& frame : frames)
+                out.u(frame.hasParent() ? frameIds.at(frame.getParent().data.get()) : 0);
+            out.u(symbols.size());
+            for (const auto& symbol : symbols) {
+                out.s(symbol.getName());
+                out.pos(symbol.getPosition());
+                auto home = homes.find(symbol);
+                out.u(home != homes.end() ? home->second : 0);
+                out.u(object(symbol.getData()));
+            }
+            out.u(nodeCount);
+            out.buffer += nodes.buffer;
+            for (auto type : types)
+                out.u(type);
+            for (const auto& frame : frames) {
+                out.u(frame.getSize());
+                for (const auto& symbol : frame)
+                    out.u(symbolIds.at(symbol));
+            }
+            out.buffer += body.buffer;
+            return std::move(out.buffer);
+        }
+
+    private:
+        const Document& doc;
+        Output body;  /**< The document, referring to the tables below. */
+        Output nodes; /**< Types and expressions, each after the nodes it refers to. */
+        uint32_t nodeCount{0};
+        std::unordered_map<const void*, uint32_t> nodeIds;
+        std::unordered_set<const void*> visiting;
+        std::vector<symbol_t> symbols;
+        std::unordered_map<symbol_t, uint32_t> symbolIds;
+        std::vector<frame_t> frames;
+        std::unordered_map<const void*, uint32_t> frameIds;
+        std::unordered_map<const void*, uint32_t> objects; /**< The objects symbols may point to. */
+        std::unordered_map<const template_t*, uint32_t> templates;
+
+        /** Numbers the next object of the document; must be called in the order used by the reader. */
+        void declare(const void* object)
+        {
+            const auto id = objects.size() + 1;
+            objects.emplace(object, id);
+        }
+
+        uint32_t object(const void* data) const
+        {
+            if (data == nullptr)
+                return 0;
+            auto it = objects.find(data);
+            if (it == objects.end())
+                throw BinaryDocumentError("Symbol refers to data outside of the document");
+            return it->second;
+        }
+
+        uint32_t symbol(const symbol_t& symbol)
+        {
+            if (symbol.data == nullptr)
+                return 0;
+            auto [it, added] = symbolIds.emplace(symbol, symbols.size() + 1);
+            if (added)
+                symbols.push_back(symbol);
+            return it->second;
+        }
+
+        uint32_t frame(const frame_t& frame)
+        {
+            if (frame.data == nullptr)
+                return 0;
+            if (auto it = frameIds.find(frame.data.get()); it != frameIds.end())
+                return it->second;
+            if (frame.hasParent())
+                this->frame(frame.getParent());  // parents are numbered first
+            frames.push_back(frame);
+            const auto id = static_cast<uint32_t>(frames.size());
+            frameIds.emplace(frame.data.get(), id);
+            for (const auto& s : frame)
+                symbol(s);
+            return id;
+        }
+
+        void enter(const void* node)
+        {
+            if (!visiting.insert(node).second)
+                throw BinaryDocumentError("Cyclic expression cannot be stored");
+        }
+
+        uint32_t leave(const void* node)
+        {
+            visiting.erase(node);
+            nodeIds.emplace(node, ++nodeCount);
+            return nodeCount;
+        }
+
+        uint32_t type(const type_t& type)
+        {
+            const auto* node = type.data.get();
+            if (node == nullptr)
+                return 0;
+            if (auto it = nodeIds.find(node); it != nodeIds.end())
+                return it->second;
+            enter(node);
+            const auto e = expr(type.getExpression());
+            auto children = std::vector<uint32_t>{};
+            for (size_t i = 0; i < type.size(); ++i)
+                children.push_back(this->type(type[i]));
+            nodes.u(TYPE_NODE);
+            nodes.u(type.getKind());
+            nodes.pos(type.getPosition());
+            nodes.u(e);
+            nodes.u(children.size());
+            for (size_t i = 0; i < children.size(); ++i) {
+                nodes.s(type.getLabel(i));
+                nodes.u(children[i]);
+            }
+            return leave(node);
+        }
+
+        uint32_t expr(const expression_t& expr)
+        {
+            const auto* node = expr.data.get();
+            if (node == nullptr)
+                return 0;
+            if (auto it = nodeIds.find(node); it != nodeIds.end())
+                return it->second;
+            enter(node);
+            const auto t = type(expr.getType());
+            const auto s = expr.getKind() == IDENTIFIER ? symbol(expr.getSymbol()) : 0;
+            auto sub = std::vector<uint32_t>{};
+            for (size_t i = 0; i < expr.getSize(); ++i)
+                sub.push_back(this->expr(expr.get(i)));
+            nodes.u(EXPRESSION_NODE);
+            nodes.u(expr.getKind());
+            nodes.pos(expr.getPosition());
+            nodes.u(t);
+            nodes.u(s);
+            if (expr.getKind() == CONSTANT && expr.getType().isDouble())
+                nodes.d(expr.getDoubleValue());
+            else
+                nodes.i(expr.getRawValue());
+            nodes.u(sub.size());
+            for (auto e : sub)
+                nodes.u(e);
+            return leave(node);
+        }
+
+        void symbols_(const std::set<symbol_t>& set)
+        {
+            body.u(set.size());
+            for (const auto& s : set)
+                body.u(symbol(s));
+        }
+
+        template <typename Container>
+        void exprs(const Container& container)
+        {
+            body.u(container.size());
+            for (const auto& e : container)
+                body.u(expr(e));
+        }
+
+        void templateRef(const template_t* templ)
+        {
+            auto it = templates.find(templ);
+            body.u(it != templates.end() ? it->second : 0);
+        }
+
+        void document()
+        {
+            for (const auto& t : doc.templates)
+                templates.emplace(&t, templates.size() + 1);
+            for (const auto& t : doc.dynamicTemplates)
+                templates.emplace(&t, templates.size() + 1);
+            body.u(doc.templates.size());
+            body.u(doc.dynamicTemplates.size());
+
+            declarations(doc.global);
+            for (const auto& t : doc.templates)
+                templ(t);
+            for (const auto& t : doc.dynamicTemplates)
+                templ(t);
+            body.u(doc.dynamicTemplatesVec.size());
+            for (const auto* t : doc.dynamicTemplatesVec)
+                templateRef(t);
+            for (const auto* list : {&doc.instances, &doc.lscInstances, &doc.processes}) {
+                body.u(list->size());
+                for (const auto& i : *list) {
+                    declare(&i);
+                    instance(i);
+                }
+            }
+
+            body.b(doc.hasUrgentTrans);
+            body.b(doc.hasPriorities);
+            body.b(doc.hasStrictInv);
+            body.b(doc.stopsClock);
+            body.b(doc.hasStrictLowControlledGuards);
+            body.b(doc.hasGuardOnRecvBroadcast);
+            body.b(doc.modified);
+            body.i(doc.defaultChanPriority);
+            body.i(doc.syncUsed);
+            body.u(doc.chanPriorities.size());
+            for (const auto& priority : doc.chanPriorities) {
+                body.u(expr(priority.head));
+                body.u(priority.tail.size());
+                for (const auto& [separator, chan] : priority.tail) {
+                    body.i(separator);
+                    body.u(expr(chan));
+                }
+            }
+            body.u(doc.procPriority.size());
+            for (const auto& [name, priority] : doc.procPriority) {
+                body.s(name);
+                body.i(priority);
+            }
+            body.u(expr(doc.beforeUpdate));
+            body.u(expr(doc.afterUpdate));
+            options(doc.modelOptions);
+            body.u(doc.queries.size());
+            for (const auto& query : doc.queries) {
+                body.s(query.formula);
+                body.s(query.comment);
+                options(query.options);
+                body.u(static_cast<uint64_t>(query.expectation.value_type));
+                body.u(static_cast<uint64_t>(query.expectation.status));
+                body.s(query.expectation.value);
+                body.u(query.expectation.resources.size());
+                for (const auto& resource : query.expectation.resources) {
+                    body.s(resource.name);
+                    body.s(resource.value);
+                    body.b(resource.unit.has_value());
+                    if (resource.unit)
+                        body.s(*resource.unit);
+                }
+                body.s(query.location);
+            }
+            body.s(doc.obsTA);
+            body.s(doc.location);
+            body.u(doc.strings.size());
+            for (const auto& s : doc.strings)
+                body.s(s);
+            body.b(doc.supportedMethods.symbolic);
+            body.b(doc.supportedMethods.stochastic);
+            body.b(doc.supportedMethods.concrete);
+            for (const auto* list : {&doc.errors, &doc.warnings}) {
+                body.u(list->size());
+                for (const auto& error : *list) {
+                    body.line(error.start);
+                    body.line(error.end);
+                    body.pos(error.position);
+                    body.s(error.msg);
+                    body.s(error.context);
+                }
+            }
+            const auto lines = doc.positions.getLines();
+            body.u(lines.size());
+            for (const auto& line : lines)
+                body.line(line);
+        }
+
+        void options(const options_t& options)
+        {
+            body.u(options.size());
+            for (const auto& option : options) {
+                body.s(option.name);
+                body.s(option.value);
+            }
+        }
+
+        void variables(const std::list<variable_t>& variables)
+        {
+            body.u(variables.size());
+            for (const auto& variable : variables) {
+                declare(&variable);
+                body.u(symbol(variable.uid));
+                body.u(expr(variable.expr));
+            }
+        }
+
+        void declarations(const declarations_t& decls)
+        {
+            body.u(frame(decls.frame));
+            variables(decls.variables);
+            body.u(decls.functions.size());
+            for (const auto& function : decls.functions) {
+                declare(&function);
+                body.u(symbol(function.uid));
+                symbols_(function.changes);
+                symbols_(function.depends);
+                variables(function.variables);
+                body.b(function.body != nullptr);
+                if (function.body)
+                    function.body->accept(this);
+            }
+            body.u(decls.progress.size());
+            for (const auto& progress : decls.progress) {
+                body.u(expr(progress.guard));
+                body.u(expr(progress.measure));
+            }
+            body.u(decls.iodecl.size());
+            for (const auto& io : decls.iodecl) {
+                body.s(io.instanceName);
+                exprs(io.param);
+                exprs(io.inputs);
+                exprs(io.outputs);
+                exprs(io.csp);
+            }
+            body.u(decls.ganttChart.size());
+            for (const auto& gantt : decls.ganttChart) {
+                body.s(gantt.name);
+                body.u(frame(gantt.parameters));
+                body.u(gantt.mapping.size());
+                for (const auto& map : gantt.mapping) {
+                    body.u(frame(map.parameters));
+                    body.u(expr(map.predicate));
+                    body.u(expr(map.mapping));
+                }
+            }
+        }
+
+        void instance(const instance_t& instance)
+        {
+            body.u(symbol(instance.uid));
+            body.u(frame(instance.parameters));
+            body.u(instance.mapping.size());
+            for (const auto& [parameter, argument] : instance.mapping) {
+                body.u(symbol(parameter));
+                body.u(expr(argument));
+            }
+            body.u(instance.arguments);
+            body.u(instance.unbound);
+            templateRef(instance.templ);
+            symbols_(instance.restricted);
+        }
+
+        template <typename T>
+        static std::unordered_map<const T*, uint32_t> indices(const std::deque<T>& elements)
+        {
+            auto res = std::unordered_map<const T*, uint32_t>{};
+            for (const auto& element : elements)
+                res.emplace(&element, res.size() + 1);
+            return res;
+        }
+
+        template <typename T>
+        void ref(const std::unordered_map<const T*, uint32_t>& indices, const T* element)
+        {
+            auto it = indices.find(element);
+            body.u(it != indices.end() ? it->second : 0);
+        }
+
+        void templ(const template_t& templ)
+        {
+            declare(static_cast<const instance_t*>(&templ));
+            instance(templ);
+            declarations(templ);
+            body.u(symbol(templ.init));
+            body.u(frame(templ.templateset));
+            body.u(templ.states.size());
+            for (const auto& state : templ.states) {
+                declare(&state);
+                body.u(symbol(state.uid));
+                body.u(expr(state.name));
+                body.u(expr(state.invariant));
+                body.u(expr(state.exponentialRate));
+                body.u(expr(state.costRate));
+                body.i(state.locNr);
+            }
+            body.u(templ.branchpoints.size());
+            for (const auto& branchpoint : templ.branchpoints) {
+                declare(&branchpoint);
+                body.u(symbol(branchpoint.uid));
+                body.i(branchpoint.bpNr);
+            }
+            const auto states = indices(templ.states);
+            const auto branchpoints = indices(templ.branchpoints);
+            body.u(templ.edges.size());
+            for (const auto& edge : templ.edges) {
+                body.i(edge.nr);
+                body.b(edge.control);
+                body.s(edge.actname);
+                ref(states, edge.src);
+                ref(branchpoints, edge.srcb);
+                ref(states, edge.dst);
+                ref(branchpoints, edge.dstb);
+                body.u(frame(edge.select));
+                body.u(expr(edge.guard));
+                body.u(expr(edge.assign));
+                body.u(expr(edge.sync));
+                body.u(expr(edge.prob));
+                body.u(edge.selectValues.size());
+                for (auto value : edge.selectValues)
+                    body.i(value);
+            }
+            exprs(templ.dynamicEvals);
+            body.b(templ.isTA);
+            body.u(templ.instances.size());
+            for (const auto& line : templ.instances) {
+                declare(static_cast<const void*>(&line));
+                instance(line);
+                body.i(line.instanceNr);
+            }
+            const auto lines = indices(templ.instances);
+            body.u(templ.messages.size());
+            for (const auto& message : templ.messages) {
+                body.i(message.nr);
+                body.i(message.location);
+                ref(lines, static_cast<const instanceLine_t*>(message.src));
+                ref(lines, static_cast<const instanceLine_t*>(message.dst));
+                body.u(expr(message.label));
+                body.b(message.isInPrechart);
+            }
+            body.u(templ.updates.size());
+            for (const auto& update : templ.updates) {
+                body.i(update.nr);
+                body.i(update.location);
+                ref(lines, static_cast<const instanceLine_t*>(update.anchor));
+                body.u(expr(update.label));
+                body.b(update.isInPrechart);
+            }
+            body.u(templ.conditions.size());
+            for (const auto& condition : templ.conditions) {
+                body.i(condition.nr);
+                body.i(condition.location);
+                body.u(condition.anchors.size());
+                for (const auto* anchor : condition.anchors)
+                    ref(lines, static_cast<const instanceLine_t*>(anchor));
+                body.u(expr(condition.label));
+                body.b(condition.isInPrechart);
+                body.b(condition.isHot);
+            }
+            body.s(templ.type);
+            body.s(templ.mode);
+            body.b(templ.hasPrechart);
+            body.b(templ.dynamic);
+            body.i(templ.dynindex);
+            body.b(templ.isDefined);
+        }
+
+        void statement(Statement* stat)
+        {
+            body.b(stat != nullptr);
+            if (stat != nullptr)
+                stat->accept(this);
+        }
+
+        void block(BlockStatement* block)
+        {
+            declarations(*block);
+            body.u(std::distance(block->begin(), block->end()));
+            for (auto& stat : *block)
+                stat->accept(this);
+        }
+
+        int32_t visitEmptyStatement(EmptyStatement*) override
+        {
+            body.u(EMPTY_STATEMENT);
+            return 0;
+        }
+        int32_t visitExprStatement(ExprStatement* stat) override
+        {
+            body.u(EXPR_STATEMENT);
+            body.u(expr(stat->expr));
+            return 0;
+        }
+        int32_t visitAssertStatement(AssertStatement* stat) override
+        {
+            body.u(ASSERT_STATEMENT);
+            body.u(expr(stat->expr));
+            return 0;
+        }
+        int32_t visitForStatement(ForStatement* stat) override
+        {
+            body.u(FOR_STATEMENT);
+            body.u(expr(stat->init));
+            body.u(expr(stat->cond));
+            body.u(expr(stat->step));
+            statement(stat->stat.get());
+            return 0;
+        }
+        int32_t visitIterationStatement(IterationStatement* stat) override
+        {
+            body.u(ITERATION_STATEMENT);
+            body.u(symbol(stat->symbol));
+            body.u(frame(stat->getFrame()));
+            statement(stat->stat.get());
+            return 0;
+        }
+        int32_t visitWhileStatement(WhileStatement* stat) override
+        {
+            body.u(WHILE_STATEMENT);
+            body.u(expr(stat->cond));
+            statement(stat->stat.get());
+            return 0;
+        }
+        int32_t visitDoWhileStatement(DoWhileStatement* stat) override
+        {
+            body.u(DOWHILE_STATEMENT);
+            statement(stat->stat.get());
+            body.u(expr(stat->cond));
+            return 0;
+        }
+        int32_t visitBlockStatement(BlockStatement* stat) override
+        {
+            if (dynamic_cast<ExternalBlockStatement*>(stat) != nullptr)
+                throw BinaryDocumentError("Documents with external functions cannot be stored");
+            body.u(BLOCK_STATEMENT);
+            body.u(frame(stat->getFrame()));
+            block(stat);
+            return 0;
+        }
+        int32_t visitSwitchStatement(SwitchStatement* stat) override
+        {
+            body.u(SWITCH_STATEMENT);
+            body.u(frame(stat->getFrame()));
+            body.u(expr(stat->cond));
+            block(stat);
+            return 0;
+        }
+        int32_t visitCaseStatement(CaseStatement* stat) override
+        {
+            body.u(CASE_STATEMENT);
+            body.u(frame(stat->getFrame()));
+            body.u(expr(stat->cond));
+            block(stat);
+            return 0;
+        }
+        int32_t visitDefaultStatement(DefaultStatement* stat) override
+        {
+            body.u(DEFAULT_STATEMENT);
+            body.u(frame(stat->getFrame()));
+            block(stat);
+            return 0;
+        }
+        int32_t visitIfStatement(IfStatement* stat) override
+        {
+            body.u(IF_STATEMENT);
+            body.u(expr(stat->cond));
+            statement(stat->trueCase.get());
+            statement(stat->falseCase.get());
+            return 0;
+        }
+        int32_t visitBreakStatement(BreakStatement*) override
+        {
+            body.u(BREAK_STATEMENT);
+            return 0;
+        }
+        int32_t visitContinueStatement(ContinueStatement*) override
+        {
+            body.u(CONTINUE_STATEMENT);
+            return 0;
+        }
+        int32_t visitReturnStatement(ReturnStatement* stat) override
+        {
+            body.u(RETURN_STATEMENT);
+            body.u(expr(stat->value));
+            return 0;
+        }
+    };
+
+    /** Decodes a document in the order it was encoded by BinaryWriter. */
+    class BinaryReader
+    {
+    public:
+        BinaryReader(std::string_view text, Document& doc): in{text}, doc{doc} {}
+
+        void read()
+        {
+            if (in.raw(sizeof(magic)) != std::string_view{magic, sizeof(magic)})
+                throw BinaryDocumentError("Not a binary document");
+            if (in.u() != version || in.u() != kinds || in.u() != (isLittleEndian() ? littleEndian : 0))
+                throw BinaryDocumentError("Binary document written by another version of the library");
+
+            frames.resize(in.count());
+            for (auto& frame : frames) {
+                const auto parent = in.u();
+                if (parent > static_cast<uint64_t>(&frame - frames.data()))
+                    throw BinaryDocumentError("Corrupt binary document");
+                frame = parent == 0 ? frame_t::createRoot(doc.getGlobals().frame)
+                                    : frame_t::createFrame(frames[parent - 1]);
+            }
+            auto orphans = frame_t::createRoot(doc.getGlobals().frame);  // for symbols whose frame is gone
+            symbols.resize(in.count());
+            auto users = std::vector<uint32_t>(symbols.size());
+            for (size_t i = 0; i < symbols.size(); ++i) {
+                auto name = in.s();
+                const auto position = in.pos();
+                const auto home = index(frames.size());
+                symbols[i] = symbol_t{home == 0 ? &orphans : &frames[home - 1], type_t{}, std::move(name), position,
+                                      nullptr};
+                users[i] = in.u32();
+            }
+            nodes.resize(in.count());
+            for (size_t i = 0; i < nodes.size(); ++i)
+                node(i);
+            for (auto& symbol : symbols)
+                symbol.setType(type());
+            for (auto& frame : frames)
+                for (auto n = in.count(); n > 0; --n)
+                    frame.add(symbol());
+
+            document();
+            if (!in.atEnd())
+                throw BinaryDocumentError("Corrupt binary document");
+            for (size_t i = 0; i < symbols.size(); ++i) {
+                if (users[i] > objects.size())
+                    throw BinaryDocumentError("Corrupt binary document");
+                symbols[i].setData(users[i] == 0 ? nullptr : objects[users[i] - 1]);
+            }
+        }
+
+    private:
+        Input in;
+        Document& doc;
+        std::vector<frame_t> frames;
+        std::vector<symbol_t> symbols;
+        /** Nodes are either a type or an expression. */
+        struct node_t
+        {
+            type_t type;
+            expression_t expr;
+        };
+        std::vector<node_t> nodes;
+        std::vector<void*> objects;
+        std::vector<template_t*> templates;
+
+        /** Reads a 1-based index which may refer to one of the first \a size elements. */
+        uint32_t index(size_t size)
+        {
+            const auto i = in.u32();
+            if (i > size)
+                throw BinaryDocumentError("Corrupt binary document");
+            return i;
+        }
+
+        void declare(void* object) { objects.push_back(object); }
+
+        const node_t& at(size_t size)
+        {
+            static const auto null = node_t{};
+            const auto i = index(size);
+            return i == 0 ? null : nodes[i - 1];
+        }
+
+        void node(size_t i)
+        {
+            const auto tag = in.u();
+            const auto kind = static_cast<kind_t>(in.u32());
+            const auto position = in.pos();
+            if (tag == TYPE_NODE) {
+                auto e = at(i).expr;
+                auto children = std::vector<type_t>(in.count());
+                auto labels = std::vector<std::string>(children.size());
+                for (size_t c = 0; c < children.size(); ++c) {
+                    labels[c] = in.s();
+                    children[c] = at(i).type;
+                }
+                nodes[i].type = type_t::createNode(kind, position, std::move(e), children, labels);
+            } else if (tag == EXPRESSION_NODE) {
+                auto t = at(i).type;
+                auto s = symbol();
+                auto value = int32_t{0};
+                auto doubleValue = 0.0;
+                if (kind == CONSTANT && t.isDouble())
+                    doubleValue = in.d();
+                else
+                    value = in.i32();
+                auto sub = std::vector<expression_t>(in.count());
+                for (auto& e : sub)
+                    e = at(i).expr;
+                nodes[i].expr =
+                    expression_t::createNode(kind, position, value, doubleValue, std::move(s), std::move(t), std::move(sub));
+            } else {
+                throw BinaryDocumentError("Corrupt binary document");
+            }
+        }
+
+        type_t type() { return at(nodes.size()).type; }
+        expression_t expr() { return at(nodes.size()).expr; }
+
+        symbol_t symbol()
+        {
+            const auto i = index(symbols.size());
+            return i == 0 ? symbol_t{} : symbols[i - 1];
+        }
+
+        frame_t frame()
+        {
+            const auto i = index(frames.size());
+            return i == 0 ? frame_t{} : frames[i - 1];
+        }
+
+        template_t* templateRef()
+        {
+            const auto i = index(templates.size());
+            return i == 0 ? nullptr : templates[i - 1];
+        }
+
+        std::set<symbol_t> symbols_()
+        {
+            auto res = std::set<symbol_t>{};
+            for (auto n = in.count(); n > 0; --n)
+                res.insert(symbol());
+            return res;
+        }
+
+        template <typename Container>
+        void exprs(Container& container)
+        {
+            for (auto n = in.count(); n > 0; --n)
+                container.push_back(expr());
+        }
+
+        void document()
+        {
+            const auto count = in.count();
+            const auto dynamic = in.count();
+            for (auto n = count; n > 0; --n)
+                templates.push_back(&doc.templates.emplace_back());
+            for (auto n = dynamic; n > 0; --n)
+                templates.push_back(&doc.dynamicTemplates.emplace_back());
+
+            declarations(doc.global);
+            for (auto* t : templates)
+                templ(*t);
+            doc.dynamicTemplatesVec.clear();
+            for (auto n = in.count(); n > 0; --n)
+                doc.dynamicTemplatesVec.push_back(templateRef());
+            for (auto* list : {&doc.instances, &doc.lscInstances, &doc.processes}) {
+                for (auto n = in.count(); n > 0; --n) {
+                    auto& i = list->emplace_back();
+                    declare(&i);
+                    instance(i);
+                }
+            }
+            doc.reindex();
+
+            doc.hasUrgentTrans = in.b();
+            doc.hasPriorities = in.b();
+            doc.hasStrictInv = in.b();
+            doc.stopsClock = in.b();
+            doc.hasStrictLowControlledGuards = in.b();
+            doc.hasGuardOnRecvBroadcast = in.b();
+            doc.modified = in.b();
+            doc.defaultChanPriority = in.i32();
+            doc.syncUsed = in.i32();
+            for (auto n = in.count(); n > 0; --n) {
+                auto& priority = doc.chanPriorities.emplace_back();
+                priority.head = expr();
+                for (auto m = in.count(); m > 0; --m) {
+                    const auto separator = static_cast<char>(in.i());
+                    priority.tail.emplace_back(separator, expr());
+                }
+            }
+            for (auto n = in.count(); n > 0; --n) {
+                auto name = in.s();
+                doc.procPriority[std::move(name)] = in.i32();
+            }
+            doc.beforeUpdate = expr();
+            doc.afterUpdate = expr();
+            options(doc.modelOptions);
+            for (auto n = in.count(); n > 0; --n) {
+                auto& query = doc.queries.emplace_back();
+                query.formula = in.s();
+                query.comment = in.s();
+                options(query.options);
+                query.expectation.value_type = static_cast<expectation_type>(in.u32());
+                query.expectation.status = static_cast<query_status_t>(in.u32());
+                query.expectation.value = in.s();
+                for (auto m = in.count(); m > 0; --m) {
+                    auto& resource = query.expectation.resources.emplace_back();
+                    resource.name = in.s();
+                    resource.value = in.s();
+                    if (in.b())
+                        resource.unit = in.s();
+                }
+                query.location = in.s();
+            }
+            doc.obsTA = in.s();
+            doc.location = in.s();
+            for (auto n = in.count(); n > 0; --n)
+                doc.strings.push_back(in.s());
+            doc.supportedMethods.symbolic = in.b();
+            doc.supportedMethods.stochastic = in.b();
+            doc.supportedMethods.concrete = in.b();
+            for (auto* list : {&doc.errors, &doc.warnings}) {
+                for (auto n = in.count(); n > 0; --n) {
+                    auto start = in.line();
+                    auto end = in.line();
+                    const auto position = in.pos();
+                    auto msg = in.s();
+                    list->emplace_back(std::move(start), std::move(end), position, std::move(msg), in.s());
+                }
+            }
+            for (auto n = in.count(); n > 0; --n) {
+                auto line = in.line();
+                doc.positions.add(line.position, line.offset, line.line, line.path);
+            }
+        }
+
+        void options(options_t& options)
+        {
+            for (auto n = in.count(); n > 0; --n) {
+                auto name = in.s();
+                options.emplace_back(std::move(name), in.s());
+            }
+        }
+
+        void variables(std::list<variable_t>& variables)
+        {
+            for (auto n = in.count(); n > 0; --n) {
+                auto& variable = variables.emplace_back();
+                declare(&variable);
+                variable.uid = symbol();
+                variable.expr = expr();
+            }
+        }
+
+        void declarations(declarations_t& decls)
+        {
+            decls.frame = frame();
+            variables(decls.variables);
+            for (auto n = in.count(); n > 0; --n) {
+                auto& function = decls.functions.emplace_back();
+                declare(&function);
+                function.uid = symbol();
+                function.changes = symbols_();
+                function.depends = symbols_();
+                function.changeSet = symbol_set_t{function.changes};
+                function.dependSet = symbol_set_t{function.depends};
+                variables(function.variables);
+                if (in.b()) {
+                    auto body = statement();
+                    if (dynamic_cast<BlockStatement*>(body.get()) == nullptr)
+                        throw BinaryDocumentError("Corrupt binary document");
+                    function.body.reset(static_cast<BlockStatement*>(body.release()));
+                }
+            }
+            for (auto n = in.count(); n > 0; --n) {
+                auto guard = expr();
+                decls.progress.emplace_back(std::move(guard), expr());
+            }
+            for (auto n = in.count(); n > 0; --n) {
+                auto& io = decls.iodecl.emplace_back();
+                io.instanceName = in.s();
+                exprs(io.param);
+                exprs(io.inputs);
+                exprs(io.outputs);
+                exprs(io.csp);
+            }
+            for (auto n = in.count(); n > 0; --n) {
+                auto& gantt = decls.ganttChart.emplace_back(in.s());
+                gantt.parameters = frame();
+                for (auto m = in.count(); m > 0; --m) {
+                    auto& map = gantt.mapping.emplace_back();
+                    map.parameters = frame();
+                    map.predicate = expr();
+                    map.mapping = expr();
+                }
+            }
+        }
+
+        void instance(instance_t& instance)
+        {
+            instance.uid = symbol();
+            instance.parameters = frame();
+            for (auto n = in.count(); n > 0; --n) {
+                auto parameter = symbol();
+                instance.mapping[parameter] = expr();
+            }
+            instance.arguments = in.u();
+            instance.unbound = in.u();
+            instance.templ = templateRef();
+            instance.restricted = symbols_();
+            instance.restrictedSet = symbol_set_t{instance.restricted};
+        }
+
+        template <typename T>
+        static T* ref(std::deque<T>& elements, uint32_t i)
+        {
+            return i == 0 ? nullptr : &elements[i - 1];
+        }
+
+        void templ(template_t& templ)
+        {
+            declare(static_cast<instance_t*>(&templ));
+            instance(templ);
+            declarations(templ);
+            templ.init = symbol();
+            templ.templateset = frame();
+            for (auto n = in.count(); n > 0; --n) {
+                auto& state = templ.states.emplace_back();
+                declare(&state);
+                state.uid = symbol();
+                state.name = expr();
+                state.invariant = expr();
+                state.exponentialRate = expr();
+                state.costRate = expr();
+                state.locNr = in.i32();
+            }
+            for (auto n = in.count(); n > 0; --n) {
+                auto& branchpoint = templ.branchpoints.emplace_back();
+                declare(&branchpoint);
+                branchpoint.uid = symbol();
+                branchpoint.bpNr = in.i32();
+            }
+            for (auto n = in.count(); n > 0; --n) {
+                auto& edge = templ.edges.emplace_back();
+                edge.nr = in.i32();
+                edge.control = in.b();
+                edge.actname = in.s();
+                edge.src = ref(templ.states, index(templ.states.size()));
+                edge.srcb = ref(templ.branchpoints, index(templ.branchpoints.size()));
+                edge.dst = ref(templ.states, index(templ.states.size()));
+                edge.dstb = ref(templ.branchpoints, index(templ.branchpoints.size()));
+                edge.select = frame();
+                edge.guard = expr();
+                edge.assign = expr();
+                edge.sync = expr();
+                edge.prob = expr();
+                for (auto m = in.count(); m > 0; --m)
+                    edge.selectValues.push_back(in.i32());
+            }
+            exprs(templ.dynamicEvals);
+            templ.isTA = in.b();
+            for (auto n = in.count(); n > 0; --n) {
+                auto& line = templ.instances.emplace_back();
+                declare(static_cast<void*>(&line));
+                instance(line);
+                line.instanceNr = in.i32();
+            }
+            auto line = [&] { return ref(templ.instances, index(templ.instances.size())); };
+            for (auto n = in.count(); n > 0; --n) {
+                auto& message = templ.messages.emplace_back();
+                message.nr = in.i32();
+                message.location = in.i32();
+                message.src = line();
+                message.dst = line();
+                message.label = expr();
+                message.isInPrechart = in.b();
+            }
+            for (auto n = in.count(); n > 0; --n) {
+                auto& update = templ.updates.emplace_back();
+                update.nr = in.i32();
+                update.location = in.i32();
+                update.anchor = line();
+                update.label = expr();
+                update.isInPrechart = in.b();
+            }
+            for (auto n = in.count(); n > 0; --n) {
+                auto& condition = templ.conditions.emplace_back();
+                condition.nr = in.i32();
+                condition.location = in.i32();
+                for (auto m = in.count(); m > 0; --m)
+                    condition.anchors.push_back(line());
+                condition.label = expr();
+                condition.isInPrechart = in.b();
+                condition.isHot = in.b();
+            }
+            templ.type = in.s();
+            templ.mode = in.s();
+            templ.hasPrechart = in.b();
+            templ.dynamic = in.b();
+            templ.dynindex = in.i32();
+            templ.isDefined = in.b();
+        }
+
+        std::unique_ptr<Statement> optionalStatement() { return in.b() ? statement() : nullptr; }
+
+        template <typename Block>
+        std::unique_ptr<Statement> block(std::unique_ptr<Block> block)
+        {
+            declarations(*block);
+            for (auto n = in.count(); n > 0; --n)
+                block->push_stat(statement());
+            return block;
+        }
+
+        std::unique_ptr<Statement> statement()
+        {
+            switch (in.u()) {
+            case EMPTY_STATEMENT: return std::make_unique<EmptyStatement>();
+            case EXPR_STATEMENT: return std::make_unique<ExprStatement>(expr());
+            case ASSERT_STATEMENT: return std::make_unique<AssertStatement>(expr());
+            case FOR_STATEMENT: {
+                auto init = expr();
+                auto cond = expr();
+                auto step = expr();
+                return std::make_unique<ForStatement>(init, cond, step, optionalStatement());
+            }
+            case ITERATION_STATEMENT: {
+                auto s = symbol();
+                auto f = frame();
+                return std::make_unique<IterationStatement>(s, f, optionalStatement());
+            }
+            case WHILE_STATEMENT: {
+                auto cond = expr();
+                return std::make_unique<WhileStatement>(cond, optionalStatement());
+            }
+            case DOWHILE_STATEMENT: {
+                auto stat = optionalStatement();
+                return std::make_unique<DoWhileStatement>(std::move(stat), expr());
+            }
+            case BLOCK_STATEMENT: return block(std::make_unique<BlockStatement>(frame()));
+            case SWITCH_STATEMENT: {
+                auto f = frame();
+                return block(std::make_unique<SwitchStatement>(f, expr()));
+            }
+            case CASE_STATEMENT: {
+                auto f = frame();
+                return block(std::make_unique<CaseStatement>(f, expr()));
+            }
+            case DEFAULT_STATEMENT: return block(std::make_unique<DefaultStatement>(frame()));
+            case IF_STATEMENT: {
+                auto cond = expr();
+                auto trueCase = optionalStatement();
+                return std::make_unique<IfStatement>(cond, std::move(trueCase), optionalStatement());
+            }
+            case BREAK_STATEMENT: return std::make_unique<BreakStatement>();
+            case CONTINUE_STATEMENT: return std::make_unique<ContinueStatement>();
+            case RETURN_STATEMENT: return std::make_unique<ReturnStatement>(expr());
+            default: throw BinaryDocumentError("Corrupt binary document");
+            }
+        }
+    };
+}  // namespace UTAP
+
+DocumentSnapshot::DocumentSnapshot(const Document& doc): binary{BinaryWriter{doc}.write()} {}
+
+void DocumentSnapshot::fork(Document& fork, const std::map<std::string, int32_t>& constants) const
+{
+    {
+        auto scope = fork.createNodes();
+        BinaryReader{binary, fork}.read();
+    }
+    if (constants.empty())
+        return;
+
+    auto replaced = std::vector<symbol_t>{};
+    for (const auto& [name, value] : constants) {
+        auto& variables = fork.getGlobals().variables;
+        auto var = std::find_if(variables.begin(), variables.end(),
+                                [&name](const variable_t& var) { return var.uid.getName() == name; });
+        if (var == variables.end() || !var->uid.getType().isConstant() || !var->uid.getType().isIntegral())
+            throw TypeException(name + " is not a global integer constant");
+        const auto position = var->expr.empty() ? var->uid.getPosition() : var->expr.getPosition();
+        var->expr = expression_t::createConstant(value, position);
+        replaced.push_back(var->uid);
+    }
+    auto scope = fork.createNodes();
+    auto types = TypeTable::Scope{fork.getTypeTable()};
+    auto checker = TypeChecker{fork};
+    for (const auto& symbol : replaced)
+        Document::acceptDeclaration(checker, symbol);
+}
+
+int32_t writeBinaryDocument(const char* filename, Document* doc)
+{
+    const auto text = BinaryWriter{*doc}.write();
+    auto out = std::ofstream{filename, std::ios::binary | std::ios::trunc};
+    out.write(text.data(), text.size());
+    out.close();
+    if (!out)
+        throw BinaryDocumentError(std::string{"Cannot write "} + filename);
+    return 0;
+}
+
+int32_t loadBinaryDocument(const char* filename, Document* doc)
+{
+    auto scope = doc->createNodes();
+    const auto file = MappedFile{filename};
+    if (file.isMapped()) {
+        BinaryReader{file.view(), *doc}.read();
+        return 0;
+    }
+    auto in = std::ifstream{filename, std::ios::binary};
+    if (!in)
+        throw BinaryDocumentError(std::string{"Cannot read "} + filename);
+    const auto text = std::string{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    BinaryReader{text, *doc}.read();
+    return 0;
+}
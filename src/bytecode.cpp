@@ -0,0 +1,944 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/bytecode.h"
+
+#include "utap/statement.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace UTAP;
+using namespace Constants;
+
+using op = opcode_t;
+
+static bool isScalar(const type_t& type) { return type.isInteger() || type.isBoolean(); }
+
+/** Returns the instruction of a binary operator or an assignment operator. */
+static bool getOperator(kind_t kind, opcode_t& code)
+{
+    switch (kind) {
+    case PLUS:
+    case ASSPLUS: code = op::ADD; return true;
+    case MINUS:
+    case ASSMINUS: code = op::SUB; return true;
+    case MULT:
+    case ASSMULT: code = op::MUL; return true;
+    case DIV:
+    case ASSDIV: code = op::DIV; return true;
+    case MOD:
+    case ASSMOD: code = op::MOD; return true;
+    case BIT_AND:
+    case ASSAND: code = op::BIT_AND; return true;
+    case BIT_OR:
+    case ASSOR: code = op::BIT_OR; return true;
+    case BIT_XOR:
+    case ASSXOR: code = op::BIT_XOR; return true;
+    case BIT_LSHIFT:
+    case ASSLSHIFT: code = op::SHL; return true;
+    case BIT_RSHIFT:
+    case ASSRSHIFT: code = op::SHR; return true;
+    case MIN: code = op::MIN; return true;
+    case MAX: code = op::MAX; return true;
+    case LT: code = op::LT; return true;
+    case LE: code = op::LE; return true;
+    case EQ: code = op::EQ; return true;
+    case NEQ: code = op::NE; return true;
+    case GE: code = op::GE; return true;
+    case GT: code = op::GT; return true;
+    case XOR: code = op::XOR; return true;
+    default: return false;
+    }
+}
+
+static BytecodeError unsupported(const expression_t& expr)
+{
+    return BytecodeError{"Cannot compile " + expr.toString()};
+}
+
+/** Compiles function bodies; the value of a visit is unused. */
+class BytecodeCompiler::StatementCompiler : public StatementVisitor
+{
+    BytecodeCompiler& c;
+
+    void jump(std::vector<size_t> loop_t::*list)
+    {
+        if (c.context.loops.empty())
+            throw BytecodeError{"Break or continue outside of a loop"};
+        (c.context.loops.back().*list).push_back(c.emit(op::JUMP));
+    }
+
+    /** Closes the innermost loop: continues go to next, breaks to the current end. */
+    void endLoop(size_t next)
+    {
+        auto loop = std::move(c.context.loops.back());
+        c.context.loops.pop_back();
+        for (auto at : loop.continues)
+            c.program.code[at].a = static_cast<int32_t>(next);
+        for (auto at : loop.breaks)
+            c.patch(at);
+    }
+
+    void expression(const expression_t& expr)
+    {
+        if (!expr.empty()) {
+            c.compileValue(expr);
+            c.emit(op::POP);
+        }
+    }
+
+public:
+    explicit StatementCompiler(BytecodeCompiler& compiler): c{compiler} {}
+
+    int32_t visitEmptyStatement(EmptyStatement*) override { return 0; }
+
+    int32_t visitExprStatement(ExprStatement* stat) override
+    {
+        expression(stat->expr);
+        return 0;
+    }
+
+    int32_t visitAssertStatement(AssertStatement* stat) override
+    {
+        c.compileValue(stat->expr);
+        c.emit(op::ASSERT);
+        return 0;
+    }
+
+    int32_t visitForStatement(ForStatement* stat) override
+    {
+        expression(stat->init);
+        const auto start = c.program.code.size();
+        c.context.loops.emplace_back();
+        if (!stat->cond.empty()) {
+            c.compileValue(stat->cond);
+            c.context.loops.back().breaks.push_back(c.emit(op::JUMP_IF_ZERO));
+        }
+        stat->stat->accept(this);
+        const auto next = c.program.code.size();
+        expression(stat->step);
+        c.emit(op::JUMP, static_cast<int32_t>(start));
+        endLoop(next);
+        return 0;
+    }
+
+    int32_t visitIterationStatement(IterationStatement* stat) override
+    {
+        auto lower = 0, upper = 0;
+        if (!c.getBounds(stat->symbol.getType(), lower, upper))
+            throw BytecodeError{"Cannot iterate over " + stat->symbol.getType().toString()};
+        const auto slot = c.allocateLocal(stat->symbol, 1);
+        c.emit(op::PUSH, lower);
+        c.emit(op::STORE_LOCAL, slot);
+        c.emit(op::POP);
+        const auto start = c.program.code.size();
+        c.emit(op::LOAD_LOCAL, slot);
+        c.emit(op::PUSH, upper);
+        c.emit(op::LE);
+        c.context.loops.emplace_back();
+        c.context.loops.back().breaks.push_back(c.emit(op::JUMP_IF_ZERO));
+        stat->stat->accept(this);
+        const auto next = c.program.code.size();
+        c.emit(op::LOAD_LOCAL, slot);
+        c.emit(op::PUSH, 1);
+        c.emit(op::ADD);
+        c.emit(op::STORE_LOCAL, slot);
+        c.emit(op::POP);
+        c.emit(op::JUMP, static_cast<int32_t>(start));
+        endLoop(next);
+        return 0;
+    }
+
+    int32_t visitWhileStatement(WhileStatement* stat) override
+    {
+        const auto start = c.program.code.size();
+        c.compileValue(stat->cond);
+        c.context.loops.emplace_back();
+        c.context.loops.back().breaks.push_back(c.emit(op::JUMP_IF_ZERO));
+        stat->stat->accept(this);
+        c.emit(op::JUMP, static_cast<int32_t>(start));
+        endLoop(start);
+        return 0;
+    }
+
+    int32_t visitDoWhileStatement(DoWhileStatement* stat) override
+    {
+        const auto start = c.program.code.size();
+        c.context.loops.emplace_back();
+        stat->stat->accept(this);
+        const auto next = c.program.code.size();
+        c.compileValue(stat->cond);
+        c.emit(op::JUMP_IF_NOT_ZERO, static_cast<int32_t>(start));
+        endLoop(next);
+        return 0;
+    }
+
+    int32_t visitBlockStatement(BlockStatement* stat) override
+    {
+        // Local variables are initialised when the block is entered; parameters already have slots
+        for (const auto& symbol : stat->getFrame()) {
+            const auto* var = static_cast<const variable_t*>(symbol.getData());
+            if (c.context.locals.count(symbol) || var == nullptr || var->uid != symbol ||
+                symbol.getType().is(TYPEDEF) || symbol.getType().isFunction())
+                continue;
+            const auto slot = c.allocateLocal(symbol, c.sizeOf(symbol.getType()));
+            c.initialise({false, true, slot}, symbol.getType(), var->expr);
+        }
+        for (auto& s : *stat)
+            s->accept(this);
+        return 0;
+    }
+
+    int32_t visitSwitchStatement(SwitchStatement*) override { throw BytecodeError{"Cannot compile switch statements"}; }
+    int32_t visitCaseStatement(CaseStatement*) override { throw BytecodeError{"Cannot compile switch statements"}; }
+    int32_t visitDefaultStatement(DefaultStatement*) override
+    {
+        throw BytecodeError{"Cannot compile switch statements"};
+    }
+
+    int32_t visitIfStatement(IfStatement* stat) override
+    {
+        c.compileValue(stat->cond);
+        const auto skip = c.emit(op::JUMP_IF_ZERO);
+        stat->trueCase->accept(this);
+        if (stat->falseCase) {
+            const auto end = c.emit(op::JUMP);
+            c.patch(skip);
+            stat->falseCase->accept(this);
+            c.patch(end);
+        } else {
+            c.patch(skip);
+        }
+        return 0;
+    }
+
+    int32_t visitBreakStatement(BreakStatement*) override
+    {
+        jump(&loop_t::breaks);
+        return 0;
+    }
+
+    int32_t visitContinueStatement(ContinueStatement*) override
+    {
+        jump(&loop_t::continues);
+        return 0;
+    }
+
+    int32_t visitReturnStatement(ReturnStatement* stat) override
+    {
+        if (stat->value.empty()) {
+            c.emit(op::PUSH, 0);
+        } else if (isScalar(stat->value.getType())) {
+            c.compileValue(stat->value);
+        } else {
+            throw BytecodeError{"Cannot return " + stat->value.getType().toString()};
+        }
+        c.emit(op::RETURN);
+        return 0;
+    }
+};
+
+size_t BytecodeCompiler::emit(opcode_t code, int32_t a, int32_t b)
+{
+    switch (code) {
+    case op::LOAD_STATE:
+    case op::STORE_STATE:
+    case op::LOAD:
+    case op::STORE:
+    case op::COPY:
+    case op::CALL: context.usesState = true; break;
+    default: break;
+    }
+    program.code.push_back({code, a, b});
+    return program.code.size() - 1;
+}
+
+int32_t BytecodeCompiler::allocateLocal(const symbol_t& symbol, uint32_t size)
+{
+    const auto slot = reserveLocal(size);
+    context.locals[symbol] = slot;
+    return slot;
+}
+
+int32_t BytecodeCompiler::addVariable(const symbol_t& symbol)
+{
+    if (auto it = slots.find(symbol); it != slots.end())
+        return it->second;
+    const auto size = sizeOf(symbol.getType());
+    const auto slot = static_cast<int32_t>(program.stateSize);
+    program.stateSize += size;
+    slots.emplace(symbol, slot);
+    variables.push_back(symbol);
+    return slot;
+}
+
+void BytecodeCompiler::addVariables(const std::list<variable_t>& vars)
+{
+    for (const auto& var : vars) {
+        const auto type = var.uid.getType();
+        if (type.isConstant() && isScalar(type))
+            continue;
+        try {
+            addVariable(var.uid);
+        } catch (const BytecodeError&) {
+            // clocks and the like are left to the caller
+        }
+    }
+}
+
+int32_t BytecodeCompiler::getSlot(const symbol_t& symbol) const
+{
+    auto it = slots.find(symbol);
+    return it != slots.end() ? it->second : -1;
+}
+
+uint32_t BytecodeCompiler::sizeOf(const type_t& type)
+{
+    if (type.isArray()) {
+        auto lower = 0, upper = 0;
+        if (!getBounds(type.getArraySize(), lower, upper))
+            throw BytecodeError{"Cannot lay out " + type.toString()};
+        return static_cast<uint32_t>(std::max(upper - lower + 1, 0)) * sizeOf(type.getSub());
+    }
+    if (type.isRecord()) {
+        auto size = 0u;
+        for (size_t i = 0; i < type.getRecordSize(); ++i)
+            size += sizeOf(type.getSub(i));
+        return size;
+    }
+    if (isScalar(type))
+        return 1;
+    throw BytecodeError{"Cannot lay out " + type.toString()};
+}
+
+int32_t BytecodeCompiler::evaluate(const expression_t& expr)
+{
+    // Compile into a scratch routine at the end of the code, which is removed again
+    auto saved = std::exchange(context, context_t{});
+    const auto size = program.code.size();
+    try {
+        compileValue(expr);
+    } catch (...) {
+        program.code.resize(size);
+        context = std::move(saved);
+        throw;
+    }
+    emit(op::RETURN);
+    const auto usesState = context.usesState;
+    program.routines.push_back({static_cast<uint32_t>(size), context.frameSize, 0});
+    context = std::move(saved);
+    auto value = 0;
+    try {
+        if (!usesState)
+            value = BytecodeInterpreter{program}.run(program.routines.size() - 1, nullptr);
+    } catch (...) {
+        program.routines.pop_back();
+        program.code.resize(size);
+        throw;
+    }
+    program.routines.pop_back();
+    program.code.resize(size);
+    if (usesState)
+        throw BytecodeError{expr.toString() + " is not a constant"};
+    return value;
+}
+
+bool BytecodeCompiler::getBounds(const type_t& type, int32_t& lower, int32_t& upper)
+{
+    if (!type.is(RANGE) || !type.isInteger())
+        return false;
+    const auto [low, high] = type.getRange();
+    try {
+        lower = evaluate(low);
+        upper = evaluate(high);
+    } catch (const BytecodeError&) {
+        return false;
+    } catch (const EvaluationError&) {
+        return false;
+    }
+    return true;
+}
+
+void BytecodeCompiler::makeDynamic(address_t& address)
+{
+    if (!address.dynamic) {
+        emit(address.local ? op::ADDRESS_LOCAL : op::PUSH, address.base);
+        address.dynamic = true;
+    }
+}
+
+void BytecodeCompiler::load(const address_t& address)
+{
+    if (address.dynamic)
+        emit(op::LOAD);
+    else
+        emit(address.local ? op::LOAD_LOCAL : op::LOAD_STATE, address.base);
+}
+
+void BytecodeCompiler::store(const address_t& address, const type_t& type)
+{
+    if (auto lower = 0, upper = 0; getBounds(type, lower, upper))
+        emit(op::CHECK_RANGE, lower, upper);
+    if (address.dynamic)
+        emit(op::STORE);
+    else
+        emit(address.local ? op::STORE_LOCAL : op::STORE_STATE, address.base);
+}
+
+BytecodeCompiler::address_t BytecodeCompiler::compileAddress(const expression_t& expr)
+{
+    switch (expr.getKind()) {
+    case IDENTIFIER: {
+        const auto symbol = expr.getSymbol();
+        if (auto it = context.locals.find(symbol); it != context.locals.end()) {
+            if (context.references.count(symbol) == 0)
+                return {false, true, it->second};
+            emit(op::LOAD_LOCAL, it->second);
+            return {true, false, 0};
+        }
+        if (auto it = slots.find(symbol); it != slots.end())
+            return {false, false, it->second};
+        throw BytecodeError{"No slot for " + symbol.getName()};
+    }
+    case ARRAY: {
+        auto address = compileAddress(expr[0]);
+        const auto type = expr[0].getType();
+        auto lower = 0, upper = 0;
+        if (!getBounds(type.getArraySize(), lower, upper))
+            throw unsupported(expr);
+        const auto size = static_cast<int32_t>(sizeOf(type.getSub()));
+        const auto index = expr[1];
+        if (!address.dynamic && index.getKind() == CONSTANT && index.getValue() >= lower &&
+            index.getValue() <= upper) {
+            address.base += (index.getValue() - lower) * size;
+            return address;
+        }
+        makeDynamic(address);
+        compileValue(index);
+        if (lower != 0) {
+            emit(op::PUSH, lower);
+            emit(op::SUB);
+        }
+        emit(op::CHECK_INDEX, upper - lower + 1);
+        if (size != 1) {
+            emit(op::PUSH, size);
+            emit(op::MUL);
+        }
+        emit(op::ADD);
+        return address;
+    }
+    case DOT: {
+        const auto type = expr[0].getType();
+        if (!type.isRecord())
+            throw unsupported(expr);
+        auto address = compileAddress(expr[0]);
+        auto offset = 0;
+        for (auto i = 0; i < expr.getIndex(); ++i)
+            offset += sizeOf(type.getSub(i));
+        if (!address.dynamic) {
+            address.base += offset;
+        } else if (offset != 0) {
+            emit(op::PUSH, offset);
+            emit(op::ADD);
+        }
+        return address;
+    }
+    default: throw BytecodeError{"Not a variable: " + expr.toString()};
+    }
+}
+
+void BytecodeCompiler::compileValue(const expression_t& expr)
+{
+    auto code = op::ADD;
+    switch (expr.getKind()) {
+    case CONSTANT:
+        if (!expr.getType().isIntegral())
+            throw unsupported(expr);
+        emit(op::PUSH, expr.getValue());
+        return;
+
+    case IDENTIFIER: {
+        const auto symbol = expr.getSymbol();
+        const auto type = symbol.getType();
+        if (!isScalar(type))
+            throw unsupported(expr);
+        if (context.locals.count(symbol) == 0 && slots.count(symbol) == 0) {
+            // Constants which are not in the state are compiled in place
+            const auto* var = static_cast<const variable_t*>(symbol.getData());
+            if (!type.isConstant() || var == nullptr || var->uid != symbol || var->expr.empty())
+                throw BytecodeError{"No slot for " + symbol.getName()};
+            compileValue(var->expr);
+            return;
+        }
+        load(compileAddress(expr));
+        return;
+    }
+
+    case ARRAY:
+    case DOT:
+        if (!isScalar(expr.getType()))
+            throw unsupported(expr);
+        load(compileAddress(expr));
+        return;
+
+    case AND:
+    case OR: {
+        compileValue(expr[0]);
+        const auto shortcut = emit(expr.getKind() == AND ? op::JUMP_IF_ZERO : op::JUMP_IF_NOT_ZERO);
+        compileValue(expr[1]);
+        emit(op::BOOL);
+        const auto end = emit(op::JUMP);
+        patch(shortcut);
+        emit(op::PUSH, expr.getKind() == AND ? 0 : 1);
+        patch(end);
+        return;
+    }
+
+    case NOT:
+        compileValue(expr[0]);
+        emit(op::NOT);
+        return;
+
+    case UNARY_MINUS:
+        compileValue(expr[0]);
+        emit(op::NEG);
+        return;
+
+    case ABS_F:
+        if (!expr[0].getType().isIntegral())
+            throw unsupported(expr);
+        compileValue(expr[0]);
+        emit(op::ABS);
+        return;
+
+    case INLINEIF: {
+        if (!isScalar(expr.getType()))
+            throw unsupported(expr);
+        compileValue(expr[0]);
+        const auto otherwise = emit(op::JUMP_IF_ZERO);
+        compileValue(expr[1]);
+        const auto end = emit(op::JUMP);
+        patch(otherwise);
+        compileValue(expr[2]);
+        patch(end);
+        return;
+    }
+
+    case COMMA:
+        compileValue(expr[0]);
+        emit(op::POP);
+        compileValue(expr[1]);
+        return;
+
+    case ASSIGN:
+    case ASSPLUS:
+    case ASSMINUS:
+    case ASSMULT:
+    case ASSDIV:
+    case ASSMOD:
+    case ASSAND:
+    case ASSOR:
+    case ASSXOR:
+    case ASSLSHIFT:
+    case ASSRSHIFT: compileAssignment(expr); return;
+
+    case PREINCREMENT:
+    case POSTINCREMENT:
+    case PREDECREMENT:
+    case POSTDECREMENT: compileIncrement(expr); return;
+
+    case FUNCALL: compileCall(expr); return;
+
+    case FORALL:
+    case EXISTS:
+    case SUM: compileQuantifier(expr); return;
+
+    default:
+        if (!getOperator(expr.getKind(), code) || expr.getSize() != 2 || !expr[0].getType().isIntegral() ||
+            !expr[1].getType().isIntegral())
+            throw unsupported(expr);
+        compileValue(expr[0]);
+        compileValue(expr[1]);
+        emit(code);
+        return;
+    }
+}
+
+void BytecodeCompiler::compileAssignment(const expression_t& expr)
+{
+    const auto type = expr[0].getType();
+    if (!isScalar(type)) {
+        // Arrays and records are copied from another variable
+        if (expr.getKind() != ASSIGN)
+            throw unsupported(expr);
+        auto target = compileAddress(expr[0]);
+        makeDynamic(target);
+        auto source = compileAddress(expr[1]);
+        makeDynamic(source);
+        emit(op::COPY, static_cast<int32_t>(sizeOf(type)));
+        emit(op::PUSH, 0);
+        return;
+    }
+    const auto address = compileAddress(expr[0]);
+    if (expr.getKind() == ASSIGN) {
+        compileValue(expr[1]);
+    } else {
+        auto code = op::ADD;
+        getOperator(expr.getKind(), code);
+        if (address.dynamic) {
+            emit(op::DUP);
+            emit(op::LOAD);
+        } else {
+            load(address);
+        }
+        compileValue(expr[1]);
+        emit(code);
+    }
+    store(address, type);
+}
+
+void BytecodeCompiler::compileIncrement(const expression_t& expr)
+{
+    const auto kind = expr.getKind();
+    const auto increment = kind == PREINCREMENT || kind == POSTINCREMENT;
+    const auto address = compileAddress(expr[0]);
+    if (address.dynamic) {
+        emit(op::DUP);
+        emit(op::LOAD);
+    } else {
+        load(address);
+    }
+    emit(op::PUSH, 1);
+    emit(increment ? op::ADD : op::SUB);
+    store(address, expr[0].getType());
+    if (kind == POSTINCREMENT || kind == POSTDECREMENT) {
+        // The old value is recovered from the stored one
+        emit(op::PUSH, 1);
+        emit(increment ? op::SUB : op::ADD);
+    }
+}
+
+void BytecodeCompiler::compileCall(const expression_t& expr)
+{
+    const auto symbol = expr[0].getSymbol();
+    const auto type = symbol.getType();
+    const auto* fun = static_cast<const function_t*>(symbol.getData());
+    if (!type.isFunction() || fun == nullptr || fun->body == nullptr)
+        throw unsupported(expr);
+    if (!isScalar(type[0]) && !type[0].isVoid())
+        throw unsupported(expr);
+    const auto parameters = static_cast<uint32_t>(type.size() - 1);
+    for (uint32_t i = 1; i <= parameters; ++i) {
+        if (type[i].is(REF)) {
+            auto address = compileAddress(expr[i]);
+            makeDynamic(address);
+        } else if (isScalar(type[i])) {
+            compileValue(expr[i]);
+            if (auto lower = 0, upper = 0; getBounds(type[i], lower, upper))
+                emit(op::CHECK_RANGE, lower, upper);
+        } else {
+            throw BytecodeError{"Arrays and records can only be passed by reference: " + expr.toString()};
+        }
+    }
+    auto it = functionIndex.find(fun);
+    if (it == functionIndex.end()) {
+        const auto index = static_cast<int32_t>(program.functions.size());
+        program.functions.push_back({0, 0, parameters});
+        it = functionIndex.emplace(fun, index).first;
+        pending.emplace_back(fun, index);
+    }
+    emit(op::CALL, it->second);
+}
+
+void BytecodeCompiler::compileQuantifier(const expression_t& expr)
+{
+    const auto kind = expr.getKind();
+    const auto symbol = expr[0].getSymbol();
+    auto lower = 0, upper = 0;
+    if (!getBounds(symbol.getType(), lower, upper))
+        throw unsupported(expr);
+    const auto slot = allocateLocal(symbol, 1);
+    const auto sum = kind == SUM ? reserveLocal(1) : 0;
+    if (kind == SUM) {
+        emit(op::PUSH, 0);
+        emit(op::STORE_LOCAL, sum);
+        emit(op::POP);
+    }
+    emit(op::PUSH, lower);
+    emit(op::STORE_LOCAL, slot);
+    emit(op::POP);
+    const auto start = program.code.size();
+    emit(op::LOAD_LOCAL, slot);
+    emit(op::PUSH, upper);
+    emit(op::LE);
+    const auto done = emit(op::JUMP_IF_ZERO);
+    compileValue(expr[1]);
+    auto decided = size_t{0};
+    if (kind == SUM) {
+        emit(op::LOAD_LOCAL, sum);
+        emit(op::ADD);
+        emit(op::STORE_LOCAL, sum);
+        emit(op::POP);
+    } else {
+        decided = emit(kind == FORALL ? op::JUMP_IF_ZERO : op::JUMP_IF_NOT_ZERO);
+    }
+    emit(op::LOAD_LOCAL, slot);
+    emit(op::PUSH, 1);
+    emit(op::ADD);
+    emit(op::STORE_LOCAL, slot);
+    emit(op::POP);
+    emit(op::JUMP, static_cast<int32_t>(start));
+    patch(done);
+    if (kind == SUM) {
+        emit(op::LOAD_LOCAL, sum);
+        return;
+    }
+    emit(op::PUSH, kind == FORALL ? 1 : 0);
+    const auto end = emit(op::JUMP);
+    patch(decided);
+    emit(op::PUSH, kind == FORALL ? 0 : 1);
+    patch(end);
+}
+
+void BytecodeCompiler::initialise(const address_t& address, const type_t& type, const expression_t& init)
+{
+    const auto storeAt = [this, &address](int32_t offset) {
+        emit(address.local ? op::STORE_LOCAL : op::STORE_STATE, address.base + offset);
+        emit(op::POP);
+    };
+    if (init.empty()) {
+        for (auto i = 0u; i < sizeOf(type); ++i) {
+            emit(op::PUSH, 0);
+            storeAt(i);
+        }
+    } else if (isScalar(type)) {
+        compileValue(init);
+        store(address, type);
+        emit(op::POP);
+    } else if (init.getKind() == LIST && type.isArray()) {
+        const auto size = static_cast<int32_t>(sizeOf(type.getSub()));
+        for (uint32_t i = 0; i < init.getSize(); ++i)
+            initialise({false, address.local, address.base + static_cast<int32_t>(i) * size}, type.getSub(), init[i]);
+    } else if (init.getKind() == LIST && type.isRecord()) {
+        auto offset = 0;
+        for (uint32_t i = 0; i < init.getSize() && i < type.getRecordSize(); ++i) {
+            initialise({false, address.local, address.base + offset}, type.getSub(i), init[i]);
+            offset += sizeOf(type.getSub(i));
+        }
+    } else {
+        auto target = address;
+        makeDynamic(target);
+        auto source = compileAddress(init);
+        makeDynamic(source);
+        emit(op::COPY, static_cast<int32_t>(sizeOf(type)));
+    }
+}
+
+void BytecodeCompiler::compileFunction(const function_t& fun, int32_t index)
+{
+    context = context_t{};
+    const auto entry = static_cast<uint32_t>(program.code.size());
+    const auto type = fun.uid.getType();
+    const auto parameters = type.size() - 1;
+    auto frame = fun.body->getFrame();
+    for (size_t i = 0; i < parameters; ++i) {
+        allocateLocal(frame[i], 1);
+        if (type[i + 1].is(REF))
+            context.references.insert(frame[i]);
+    }
+    auto compiler = StatementCompiler{*this};
+    fun.body->accept(&compiler);
+    emit(op::PUSH, 0);
+    emit(op::RETURN);
+    program.functions[index] = {entry, context.frameSize, static_cast<uint32_t>(parameters)};
+}
+
+void BytecodeCompiler::compilePending()
+{
+    while (!pending.empty()) {
+        const auto [fun, index] = pending.back();
+        pending.pop_back();
+        compileFunction(*fun, index);
+    }
+}
+
+uint32_t BytecodeCompiler::compile(const expression_t& expr)
+{
+    context = context_t{};
+    const auto entry = static_cast<uint32_t>(program.code.size());
+    compileValue(expr);
+    emit(op::RETURN);
+    program.routines.push_back({entry, context.frameSize, 0});
+    compilePending();
+    return program.routines.size() - 1;
+}
+
+uint32_t BytecodeCompiler::compileInitialiser()
+{
+    context = context_t{};
+    const auto entry = static_cast<uint32_t>(program.code.size());
+    for (const auto& symbol : variables) {
+        const auto* var = static_cast<const variable_t*>(symbol.getData());
+        const auto init = var != nullptr && var->uid == symbol ? var->expr : expression_t{};
+        initialise({false, false, slots[symbol]}, symbol.getType(), init);
+    }
+    emit(op::PUSH, 0);
+    emit(op::RETURN);
+    program.routines.push_back({entry, context.frameSize, 0});
+    compilePending();
+    return program.routines.size() - 1;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Arithmetic on unsigned values wraps around instead of overflowing. */
+static int32_t wrap(uint32_t value) { return static_cast<int32_t>(value); }
+
+int32_t BytecodeInterpreter::run(uint32_t routine, int32_t* state)
+{
+    static constexpr size_t maxCalls = 100000;
+    const auto& entry = program.routines.at(routine);
+    const auto* code = program.code.data();
+    stack.clear();
+    calls.clear();
+    locals.assign(entry.frameSize, 0);
+    auto pc = entry.entry;
+    auto frame = uint32_t{0};
+    const auto at = [&](int32_t address) -> int32_t& {
+        return address & Program::LOCAL_ADDRESS ? locals[address & ~Program::LOCAL_ADDRESS] : state[address];
+    };
+    const auto pop = [this] {
+        const auto value = stack.back();
+        stack.pop_back();
+        return value;
+    };
+    for (;;) {
+        const auto& ins = code[pc++];
+        switch (ins.op) {
+        case op::PUSH: stack.push_back(ins.a); break;
+        case op::POP: stack.pop_back(); break;
+        case op::DUP: stack.push_back(stack.back()); break;
+        case op::LOAD_STATE: stack.push_back(state[ins.a]); break;
+        case op::STORE_STATE: state[ins.a] = stack.back(); break;
+        case op::LOAD_LOCAL: stack.push_back(locals[frame + ins.a]); break;
+        case op::STORE_LOCAL: locals[frame + ins.a] = stack.back(); break;
+        case op::ADDRESS_LOCAL: stack.push_back(static_cast<int32_t>(frame + ins.a) | Program::LOCAL_ADDRESS); break;
+        case op::LOAD: stack.back() = at(stack.back()); break;
+        case op::STORE: {
+            const auto value = pop();
+            at(stack.back()) = value;
+            stack.back() = value;
+            break;
+        }
+        case op::COPY: {
+            const auto source = pop();
+            const auto target = pop();
+            for (auto i = 0; i < ins.a; ++i)
+                at(target + i) = at(source + i);
+            break;
+        }
+        case op::NEG: stack.back() = wrap(0u - static_cast<uint32_t>(stack.back())); break;
+        case op::ABS:
+            stack.back() = stack.back() < 0 ? wrap(0u - static_cast<uint32_t>(stack.back())) : stack.back();
+            break;
+        case op::NOT: stack.back() = stack.back() == 0; break;
+        case op::BOOL: stack.back() = stack.back() != 0; break;
+        case op::JUMP: pc = ins.a; break;
+        case op::JUMP_IF_ZERO:
+            if (pop() == 0)
+                pc = ins.a;
+            break;
+        case op::JUMP_IF_NOT_ZERO:
+            if (pop() != 0)
+                pc = ins.a;
+            break;
+        case op::CHECK_INDEX:
+            if (stack.back() < 0 || stack.back() >= ins.a)
+                throw EvaluationError{"Array index out of range"};
+            break;
+        case op::CHECK_RANGE:
+            if (stack.back() < ins.a || stack.back() > ins.b)
+                throw EvaluationError{"Value out of range"};
+            break;
+        case op::ASSERT:
+            if (pop() == 0)
+                throw EvaluationError{"Assertion failed"};
+            break;
+        case op::CALL: {
+            const auto& fun = program.functions[ins.a];
+            if (calls.size() == maxCalls)
+                throw EvaluationError{"Too deep recursion"};
+            calls.push_back({pc, frame});
+            frame = static_cast<uint32_t>(locals.size());
+            locals.resize(frame + fun.frameSize, 0);
+            std::copy(stack.end() - fun.parameters, stack.end(), locals.begin() + frame);
+            stack.resize(stack.size() - fun.parameters);
+            pc = fun.entry;
+            break;
+        }
+        case op::RETURN: {
+            if (calls.empty())
+                return stack.back();
+            locals.resize(frame);
+            pc = calls.back().pc;
+            frame = calls.back().frame;
+            calls.pop_back();
+            break;
+        }
+        default: {
+            const auto b = pop();
+            auto& a = stack.back();
+            const auto ua = static_cast<uint32_t>(a), ub = static_cast<uint32_t>(b);
+            switch (ins.op) {
+            case op::ADD: a = wrap(ua + ub); break;
+            case op::SUB: a = wrap(ua - ub); break;
+            case op::MUL: a = wrap(ua * ub); break;
+            case op::DIV:
+                if (b == 0)
+                    throw EvaluationError{"Division by zero"};
+                a = b == -1 ? wrap(0u - ua) : a / b;
+                break;
+            case op::MOD:
+                if (b == 0)
+                    throw EvaluationError{"Division by zero"};
+                a = b == -1 ? 0 : a % b;
+                break;
+            case op::BIT_AND: a &= b; break;
+            case op::BIT_OR: a |= b; break;
+            case op::BIT_XOR: a ^= b; break;
+            case op::SHL: a = wrap(ua << (ub & 31)); break;
+            case op::SHR: a >>= (b & 31); break;
+            case op::MIN: a = std::min(a, b); break;
+            case op::MAX: a = std::max(a, b); break;
+            case op::LT: a = a < b; break;
+            case op::LE: a = a <= b; break;
+            case op::EQ: a = a == b; break;
+            case op::NE: a = a != b; break;
+            case op::GE: a = a >= b; break;
+            case op::GT: a = a > b; break;
+            case op::XOR: a = (a != 0) != (b != 0); break;
+            default: throw EvaluationError{"Invalid instruction"};
+            }
+        }
+        }
+    }
+}
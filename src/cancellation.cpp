@@ -0,0 +1,44 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/cancellation.h"
+
+using namespace UTAP;
+
+namespace
+{
+    thread_local ParseMonitor* monitor = nullptr;
+}  // namespace
+
+void ParseMonitor::templateRead(const std::string& name)
+{
+    ++templates;
+    if (progress)
+        progress(name, templates);
+    if (isCancelled())
+        throw CancelledError{};
+}
+
+ParseMonitor* ParseMonitor::current() noexcept { return monitor; }
+
+ParseMonitor::Scope::Scope(ParseMonitor& current) noexcept: previous{monitor} { monitor = &current; }
+
+ParseMonitor::Scope::~Scope() noexcept { monitor = previous; }
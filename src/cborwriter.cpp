@@ -0,0 +1,776 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/cborwriter.h"
+
+#include "utap/document.h"
+#include "utap/flatexpression.h"
+#include "utap/statement.h"
+#include "utap/utap.h"
+
+#include <charconv>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+using namespace UTAP;
+using namespace Constants;
+
+namespace
+{
+    constexpr int64_t version = 1;
+
+    /** Buffers the encoded output and passes it to the sink in chunks. */
+    class Encoder
+    {
+    public:
+        Encoder(const CBORWriter::sink_t& sink, size_t chunk): sink{sink}, chunk{chunk} { buffer.reserve(chunk); }
+        virtual ~Encoder() = default;
+
+        virtual void beginDocument() = 0;
+        virtual void endDocument() = 0;
+        /** Begins an array of unknown size. */
+        virtual void beginArray() = 0;
+        virtual void beginArray(size_t size) = 0;
+        /** Begins a map of unknown size. */
+        virtual void beginMap() = 0;
+        /** Ends the innermost array or map. */
+        virtual void end() = 0;
+        virtual void key(std::string_view key) = 0;
+        virtual void integer(int64_t value) = 0;
+        virtual void real(double value) = 0;
+        virtual void boolean(bool value) = 0;
+        virtual void string(std::string_view value) = 0;
+        virtual void null() = 0;
+
+        void flush()
+        {
+            if (!buffer.empty()) {
+                sink(buffer);
+                buffer.clear();
+            }
+        }
+
+    protected:
+        void put(char c)
+        {
+            buffer.push_back(c);
+            if (buffer.size() >= chunk)
+                flush();
+        }
+        void put(std::string_view s)
+        {
+            buffer.append(s);
+            if (buffer.size() >= chunk)
+                flush();
+        }
+
+    private:
+        const CBORWriter::sink_t& sink;
+        size_t chunk;
+        std::string buffer;
+    };
+
+    class CBOREncoder final : public Encoder
+    {
+    public:
+        using Encoder::Encoder;
+
+        void beginDocument() override
+        {
+            head(6, 55799);  // the self-described CBOR tag
+            beginArray();
+        }
+        void endDocument() override { end(); }
+        void beginArray() override
+        {
+            put('\x9f');
+            indefinite.push_back(true);
+        }
+        void beginArray(size_t size) override
+        {
+            head(4, size);
+            indefinite.push_back(false);
+        }
+        void beginMap() override
+        {
+            put('\xbf');
+            indefinite.push_back(true);
+        }
+        void end() override
+        {
+            if (indefinite.back())
+                put('\xff');
+            indefinite.pop_back();
+        }
+        void key(std::string_view key) override { string(key); }
+        void integer(int64_t value) override
+        {
+            if (value >= 0)
+                head(0, static_cast<uint64_t>(value));
+            else
+                head(1, static_cast<uint64_t>(-(value + 1)));
+        }
+        void real(double value) override
+        {
+            auto bits = uint64_t{};
+            std::memcpy(&bits, &value, sizeof(bits));
+            char bytes[9] = {'\xfb'};
+            for (int i = 1; i < 9; ++i)
+                bytes[i] = static_cast<char>(bits >> (8 * (8 - i)));
+            put(std::string_view{bytes, sizeof(bytes)});
+        }
+        void boolean(bool value) override { put(value ? '\xf5' : '\xf4'); }
+        void string(std::string_view value) override
+        {
+            head(3, value.size());
+            put(value);
+        }
+        void null() override { put('\xf6'); }
+
+    private:
+        std::vector<bool> indefinite; /**< Whether the open arrays and maps end with a break */
+
+        /** Writes the initial byte of the major type with the argument in as few bytes as possible. */
+        void head(uint8_t major, uint64_t value)
+        {
+            char bytes[9];
+            auto size = size_t{1};
+            auto info = uint8_t{};
+            if (value < 24) {
+                info = static_cast<uint8_t>(value);
+            } else if (value <= 0xff) {
+                info = 24;
+                size = 2;
+            } else if (value <= 0xffff) {
+                info = 25;
+                size = 3;
+            } else if (value <= 0xffffffff) {
+                info = 26;
+                size = 5;
+            } else {
+                info = 27;
+                size = 9;
+            }
+            bytes[0] = static_cast<char>(major << 5 | info);
+            for (size_t i = 1; i < size; ++i)
+                bytes[i] = static_cast<char>(value >> (8 * (size - 1 - i)));
+            put(std::string_view{bytes, size});
+        }
+    };
+
+    class JSONEncoder final : public Encoder
+    {
+    public:
+        using Encoder::Encoder;
+
+        void beginDocument() override { beginArray(); }
+        void endDocument() override
+        {
+            end();
+            put('\n');
+        }
+        void beginArray() override { open('[', ']'); }
+        void beginArray(size_t) override { beginArray(); }
+        void beginMap() override { open('{', '}'); }
+        void end() override
+        {
+            put(levels.back().closing);
+            levels.pop_back();
+        }
+        void key(std::string_view key) override
+        {
+            separate();
+            quoted(key);
+            put(':');
+            keyed = true;
+        }
+        void integer(int64_t value) override
+        {
+            separate();
+            char text[24];
+            auto [end, ec] = std::to_chars(std::begin(text), std::end(text), value);
+            put(std::string_view(text, end - text));
+        }
+        void real(double value) override
+        {
+            if (!std::isfinite(value))
+                return null();
+            separate();
+            char text[32];
+            auto [end, ec] = std::to_chars(std::begin(text), std::end(text), value);
+            put(std::string_view(text, end - text));
+        }
+        void boolean(bool value) override
+        {
+            separate();
+            put(value ? "true" : "false");
+        }
+        void string(std::string_view value) override
+        {
+            separate();
+            quoted(value);
+        }
+        void null() override
+        {
+            separate();
+            put("null");
+        }
+
+    private:
+        struct level_t
+        {
+            char closing;
+            bool empty;
+        };
+        std::vector<level_t> levels;
+        bool keyed{false}; /**< True if the next value is that of a key */
+
+        void open(char opening, char closing)
+        {
+            separate();
+            put(opening);
+            levels.push_back({closing, true});
+        }
+        /** Writes the separator before the next value, a line break between the records. */
+        void separate()
+        {
+            if (keyed) {
+                keyed = false;
+                return;
+            }
+            if (levels.empty())
+                return;
+            if (!levels.back().empty)
+                put(levels.size() == 1 ? ",\n" : ",");
+            levels.back().empty = false;
+        }
+        void quoted(std::string_view s)
+        {
+            static constexpr auto hex = "0123456789abcdef";
+            put('"');
+            for (auto c : s) {
+                switch (c) {
+                case '"': put("\\\""); break;
+                case '\\': put("\\\\"); break;
+                case '\n': put("\\n"); break;
+                case '\r': put("\\r"); break;
+                case '\t': put("\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        put("\\u00");
+                        put(hex[c >> 4]);
+                        put(hex[c & 0xf]);
+                    } else {
+                        put(c);
+                    }
+                }
+            }
+            put('"');
+        }
+    };
+
+    /**
+     * Writes the records of a document. Each record is visited twice:
+     * first to write the types and symbols it refers to that were not
+     * written yet, then to write the record itself.
+     */
+    class Exporter : private StatementVisitor
+    {
+    public:
+        explicit Exporter(Encoder& out): out{out} {}
+
+        void document(Document& doc)
+        {
+            out.beginDocument();
+            record("document", [&] {
+                entry("version", version);
+                entry("kinds", DOUBLEINVGUARD + 1);
+                entry("errors", doc.getErrors().size());
+                entry("warnings", doc.getWarnings().size());
+            });
+            declarations(doc.getGlobals(), symbol_t{});
+            for (auto& templ : doc.getTemplates())
+                this->templ(templ);
+            for (auto* templ : doc.getDynamicTemplates())
+                this->templ(*templ);
+            for (const auto* instance : doc.getInstanceIndex().getTable())
+                this->instance("instance", *instance);
+            for (const auto& process : doc.getProcesses())
+                instance("process", process);
+            for (const auto& query : doc.getQueries()) {
+                record("query", [&] {
+                    entry("formula", query.formula);
+                    entry("comment", query.comment);
+                    entry("location", query.location);
+                    key("options");
+                    beginMap();
+                    for (const auto& option : query.options)
+                        entry(option.name, option.value);
+                    end();
+                });
+            }
+            out.endDocument();
+        }
+
+    private:
+        Encoder& out;
+        bool defining{false}; /**< True while writing the definitions a record refers to */
+        std::unordered_map<type_t, uint32_t> types;
+        std::unordered_map<std::string, uint32_t> shapes; /**< Types without expressions by kind and parts */
+        uint32_t written{0};                              /**< The number of type records */
+        symbol_set_t symbols;
+
+        template <typename Fn>
+        void record(std::string_view kind, Fn&& fn)
+        {
+            const auto outer = std::exchange(defining, true);
+            fn();
+            defining = false;
+            out.beginMap();
+            entry("record", kind);
+            fn();
+            out.end();
+            defining = outer;
+        }
+
+        /* The structure of a record, left out while defining. */
+        void beginArray()
+        {
+            if (!defining)
+                out.beginArray();
+        }
+        void beginMap()
+        {
+            if (!defining)
+                out.beginMap();
+        }
+        void end()
+        {
+            if (!defining)
+                out.end();
+        }
+        void key(std::string_view key)
+        {
+            if (!defining)
+                out.key(key);
+        }
+        void string(std::string_view value)
+        {
+            if (!defining)
+                out.string(value);
+        }
+        void null()
+        {
+            if (!defining)
+                out.null();
+        }
+        void entry(std::string_view key, int64_t value)
+        {
+            if (!defining) {
+                out.key(key);
+                out.integer(value);
+            }
+        }
+        void entry(std::string_view key, std::string_view value)
+        {
+            if (!defining) {
+                out.key(key);
+                out.string(value);
+            }
+        }
+        void flag(std::string_view key, bool value)
+        {
+            if (!defining) {
+                out.key(key);
+                out.boolean(value);
+            }
+        }
+
+        /* References, which are defined first. */
+        void type(const type_t& type)
+        {
+            if (defining) {
+                define(type);
+            } else {
+                auto it = types.find(type);
+                out.integer(it != types.end() ? it->second : 0);
+            }
+        }
+        void symbol(const symbol_t& symbol)
+        {
+            if (defining)
+                define(symbol);
+            else
+                out.integer(symbol.getId());
+        }
+        void symbols_(const frame_t& frame)
+        {
+            beginArray();
+            for (const auto& symbol : frame)
+                this->symbol(symbol);
+            end();
+        }
+        void expr(const expression_t& expr)
+        {
+            if (expr.empty()) {
+                null();
+                return;
+            }
+            const auto flat = flat_expression_t{expr};
+            if (defining) {
+                for (uint32_t node = 0; node < flat.size(); ++node) {
+                    define(flat.getExpression(node).getType());
+                    if (flat.getKind(node) == IDENTIFIER)
+                        define(flat.getSymbol(node));
+                }
+                return;
+            }
+            out.beginArray(4 * flat.size());
+            for (uint32_t node = 0; node < flat.size(); ++node) {
+                const auto& e = flat.getExpression(node);
+                out.integer(flat.getKind(node));
+                out.integer(flat.getSize(node));
+                type(e.getType());
+                if (flat.getKind(node) == IDENTIFIER)
+                    out.integer(flat.getSymbolId(node));
+                else if (flat.getKind(node) == CONSTANT && e.getType().isDouble())
+                    out.real(e.getDoubleValue());
+                else
+                    out.integer(flat.getValue(node));
+            }
+            out.end();
+        }
+
+        void define(const type_t& type)
+        {
+            if (type == type_t{} || types.count(type) != 0)
+                return;
+            types.emplace(type, 0);  // until written, in case its parts refer back to it
+            for (uint32_t i = 0; i < type.size(); ++i)
+                define(type[i]);
+            /* Few type nodes are shared, thus those alike but for their identity are written once. */
+            auto shape = std::string{};
+            if (type.getExpression().empty()) {
+                shape = std::to_string(type.getKind());
+                for (uint32_t i = 0; i < type.size(); ++i)
+                    shape.append(1, ' ').append(std::to_string(types[type[i]])).append(1, ':').append(type.getLabel(i));
+                if (auto it = shapes.find(shape); it != shapes.end()) {
+                    types[type] = it->second;
+                    return;
+                }
+            }
+            const auto number = static_cast<int64_t>(++written);
+            record("type", [&, number] {
+                entry("id", number);
+                entry("kind", type.getKind());
+                entry("text", type.toString());
+                key("children");
+                beginArray();
+                for (uint32_t i = 0; i < type.size(); ++i)
+                    this->type(type[i]);
+                end();
+                key("labels");
+                beginArray();
+                for (uint32_t i = 0; i < type.size(); ++i)
+                    string(type.getLabel(i));
+                end();
+                key("expression");
+                expr(type.getExpression());
+            });
+            types[type] = number;
+            if (!shape.empty())
+                shapes.emplace(std::move(shape), number);
+        }
+        void define(const symbol_t& symbol)
+        {
+            if (symbol.getId() == 0 || !symbols.insert(symbol))
+                return;
+            record("symbol", [&] {
+                entry("id", symbol.getId());
+                entry("name", symbol.getName());
+                key("type");
+                type(symbol.getType());
+                key("position");
+                beginArray();
+                if (!defining) {
+                    out.integer(symbol.getPosition().start);
+                    out.integer(symbol.getPosition().end);
+                }
+                end();
+            });
+        }
+
+        void variables(const std::list<variable_t>& variables)
+        {
+            beginArray();
+            for (const auto& variable : variables) {
+                beginArray();
+                symbol(variable.uid);
+                expr(variable.expr);
+                end();
+            }
+            end();
+        }
+
+        void declarations(declarations_t& decls, const symbol_t& scope)
+        {
+            for (const auto& variable : decls.variables) {
+                record("variable", [&] {
+                    key("scope");
+                    symbol(scope);
+                    key("symbol");
+                    symbol(variable.uid);
+                    key("initialiser");
+                    expr(variable.expr);
+                });
+            }
+            for (auto& function : decls.functions) {
+                record("function", [&] {
+                    key("scope");
+                    symbol(scope);
+                    key("symbol");
+                    symbol(function.uid);
+                    key("variables");
+                    variables(function.variables);
+                    key("body");
+                    statement(function.body.get());
+                });
+            }
+        }
+
+        void templ(template_t& templ)
+        {
+            record("template", [&] {
+                key("symbol");
+                symbol(templ.uid);
+                key("parameters");
+                symbols_(templ.parameters);
+                key("init");
+                symbol(templ.init);
+                flag("isTA", templ.isTA);
+                flag("dynamic", templ.dynamic);
+                entry("type", templ.type);
+                entry("mode", templ.mode);
+            });
+            declarations(templ, templ.uid);
+            for (const auto& state : templ.states) {
+                record("location", [&] {
+                    key("template");
+                    symbol(templ.uid);
+                    key("symbol");
+                    symbol(state.uid);
+                    entry("number", state.locNr);
+                    key("invariant");
+                    expr(state.invariant);
+                    key("exponentialRate");
+                    expr(state.exponentialRate);
+                    key("costRate");
+                    expr(state.costRate);
+                });
+            }
+            for (const auto& branchpoint : templ.branchpoints) {
+                record("branchpoint", [&] {
+                    key("template");
+                    symbol(templ.uid);
+                    key("symbol");
+                    symbol(branchpoint.uid);
+                    entry("number", branchpoint.bpNr);
+                });
+            }
+            for (const auto& edge : templ.edges) {
+                record("edge", [&] {
+                    key("template");
+                    symbol(templ.uid);
+                    entry("number", edge.nr);
+                    key("source");
+                    symbol(edge.src != nullptr ? edge.src->uid : edge.srcb != nullptr ? edge.srcb->uid : symbol_t{});
+                    key("target");
+                    symbol(edge.dst != nullptr ? edge.dst->uid : edge.dstb != nullptr ? edge.dstb->uid : symbol_t{});
+                    flag("controllable", edge.control);
+                    entry("action", edge.actname);
+                    key("select");
+                    symbols_(edge.select);
+                    key("guard");
+                    expr(edge.guard);
+                    key("sync");
+                    expr(edge.sync);
+                    key("assign");
+                    expr(edge.assign);
+                    key("probability");
+                    expr(edge.prob);
+                });
+            }
+        }
+
+        void instance(std::string_view kind, const instance_t& instance)
+        {
+            record(kind, [&] {
+                key("symbol");
+                symbol(instance.uid);
+                key("template");
+                symbol(instance.templ != nullptr ? instance.templ->uid : symbol_t{});
+                key("parameters");
+                symbols_(instance.parameters);
+                key("arguments");
+                beginArray();
+                for (const auto& [parameter, argument] : instance.mapping) {
+                    beginArray();
+                    symbol(parameter);
+                    expr(argument);
+                    end();
+                }
+                end();
+                entry("unbound", instance.unbound);
+            });
+        }
+
+        void statement(Statement* stat)
+        {
+            if (stat != nullptr)
+                stat->accept(this);
+            else
+                null();
+        }
+        void block(std::string_view name, BlockStatement* block, const expression_t* cond = nullptr)
+        {
+            beginArray();
+            string(name);
+            if (cond != nullptr)
+                expr(*cond);
+            variables(block->variables);
+            beginArray();
+            for (auto& stat : *block)
+                stat->accept(this);
+            end();
+            end();
+        }
+        int32_t simple(std::string_view name, const expression_t* e = nullptr)
+        {
+            beginArray();
+            string(name);
+            if (e != nullptr)
+                expr(*e);
+            end();
+            return 0;
+        }
+
+        int32_t visitEmptyStatement(EmptyStatement*) override { return simple("empty"); }
+        int32_t visitExprStatement(ExprStatement* stat) override { return simple("expr", &stat->expr); }
+        int32_t visitAssertStatement(AssertStatement* stat) override { return simple("assert", &stat->expr); }
+        int32_t visitForStatement(ForStatement* stat) override
+        {
+            beginArray();
+            string("for");
+            expr(stat->init);
+            expr(stat->cond);
+            expr(stat->step);
+            statement(stat->stat.get());
+            end();
+            return 0;
+        }
+        int32_t visitIterationStatement(IterationStatement* stat) override
+        {
+            beginArray();
+            string("iterate");
+            symbol(stat->symbol);
+            statement(stat->stat.get());
+            end();
+            return 0;
+        }
+        int32_t visitWhileStatement(WhileStatement* stat) override
+        {
+            beginArray();
+            string("while");
+            expr(stat->cond);
+            statement(stat->stat.get());
+            end();
+            return 0;
+        }
+        int32_t visitDoWhileStatement(DoWhileStatement* stat) override
+        {
+            beginArray();
+            string("do");
+            statement(stat->stat.get());
+            expr(stat->cond);
+            end();
+            return 0;
+        }
+        int32_t visitBlockStatement(BlockStatement* stat) override
+        {
+            if (dynamic_cast<ExternalBlockStatement*>(stat) != nullptr)
+                return simple("external");
+            block("block", stat);
+            return 0;
+        }
+        int32_t visitSwitchStatement(SwitchStatement* stat) override
+        {
+            block("switch", stat, &stat->cond);
+            return 0;
+        }
+        int32_t visitCaseStatement(CaseStatement* stat) override
+        {
+            block("case", stat, &stat->cond);
+            return 0;
+        }
+        int32_t visitDefaultStatement(DefaultStatement* stat) override
+        {
+            block("default", stat);
+            return 0;
+        }
+        int32_t visitIfStatement(IfStatement* stat) override
+        {
+            beginArray();
+            string("if");
+            expr(stat->cond);
+            statement(stat->trueCase.get());
+            statement(stat->falseCase.get());
+            end();
+            return 0;
+        }
+        int32_t visitBreakStatement(BreakStatement*) override { return simple("break"); }
+        int32_t visitContinueStatement(ContinueStatement*) override { return simple("continue"); }
+        int32_t visitReturnStatement(ReturnStatement* stat) override { return simple("return", &stat->value); }
+    };
+}  // namespace
+
+void CBORWriter::write(Document& doc)
+{
+    auto encoder = std::unique_ptr<Encoder>{};
+    if (format == JSON)
+        encoder = std::make_unique<JSONEncoder>(sink, chunk);
+    else
+        encoder = std::make_unique<CBOREncoder>(sink, chunk);
+    Exporter{*encoder}.document(doc);
+    encoder->flush();
+}
+
+int32_t writeCBOR(std::ostream& os, Document* doc, bool json)
+{
+    auto writer = CBORWriter{[&os](std::string_view chunk) { os.write(chunk.data(), chunk.size()); },
+                             json ? CBORWriter::JSON : CBORWriter::CBOR};
+    writer.write(*doc);
+    return os ? 0 : -1;
+}
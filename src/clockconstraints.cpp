@@ -0,0 +1,150 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/clockconstraints.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace UTAP;
+using namespace Constants;
+
+namespace
+{
+    /** Returns the comparison with its operands swapped, e.g. GT for LT. */
+    kind_t mirror(kind_t kind)
+    {
+        switch (kind) {
+        case LT: return GT;
+        case LE: return GE;
+        case GE: return LE;
+        case GT: return LT;
+        default: return kind;
+        }
+    }
+
+    expression_t negate(const expression_t& bound)
+    {
+        if (bound.getKind() == CONSTANT && bound.getValue() != std::numeric_limits<int32_t>::min()) {
+            auto constant = expression_t::createConstant(-bound.getValue(), bound.getPosition()).clone();
+            constant.setType(bound.getType());
+            return constant;
+        }
+        return expression_t::createUnary(UNARY_MINUS, bound, bound.getPosition(), bound.getType());
+    }
+
+    class Splitter
+    {
+    public:
+        explicit Splitter(constraint_form_t& form): form{form} {}
+
+        void conjunct(const expression_t& expr)
+        {
+            if (expr.getKind() == AND) {
+                conjunct(expr[0]);
+                conjunct(expr[1]);
+            } else if (!expr.usesClock()) {
+                if (!(expr.getKind() == CONSTANT && expr.getValue() != 0))
+                    data.push_back(expr);
+            } else if (!constraint(expr)) {
+                form.others.push_back(expr);
+            }
+        }
+
+        expression_t conjunction() const
+        {
+            if (data.empty()) {
+                auto constant = expression_t::createConstant(1, form.source.getPosition()).clone();
+                constant.setType(type_t::createPrimitive(BOOL));
+                return constant;
+            }
+            auto result = data.front();
+            for (auto it = data.begin() + 1; it != data.end(); ++it)
+                result = expression_t::createBinary(AND, result, *it, it->getPosition(), result.getType());
+            return result;
+        }
+
+    private:
+        constraint_form_t& form;
+        std::vector<expression_t> data;
+
+        uint32_t indexOf(const expression_t& clock)
+        {
+            auto it = std::find_if(form.clocks.begin() + 1, form.clocks.end(),
+                                   [&](const expression_t& c) { return c.equal(clock); });
+            if (it != form.clocks.end())
+                return static_cast<uint32_t>(it - form.clocks.begin());
+            form.clocks.push_back(clock);
+            return static_cast<uint32_t>(form.clocks.size() - 1);
+        }
+
+        /** Recognises a clock, e.g. x or c[i], but not x - 3 which also has a clock type. */
+        static bool isClock(const expression_t& expr)
+        {
+            const auto kind = expr.getKind();
+            return expr.getType().isClock() && (kind == IDENTIFIER || kind == ARRAY || kind == DOT);
+        }
+
+        /** Recognises x and x - y, returning false for anything else. */
+        static bool isDifference(const expression_t& expr)
+        {
+            return isClock(expr) || (expr.getKind() == MINUS && isClock(expr[0]) && isClock(expr[1]));
+        }
+
+        static bool isBound(const expression_t& expr) { return expr.getType().isIntegral() && !expr.usesClock(); }
+
+        bool constraint(const expression_t& expr)
+        {
+            auto kind = expr.getKind();
+            if (kind != LT && kind != LE && kind != GE && kind != GT && kind != EQ)
+                return false;
+            auto difference = expr[0];
+            auto bound = expr[1];
+            if (isDifference(bound) && isBound(difference)) {
+                std::swap(difference, bound);
+                kind = mirror(kind);
+            } else if (!isDifference(difference) || !isBound(bound)) {
+                return false;
+            }
+            const auto single = isClock(difference);
+            const auto i = indexOf(single ? difference : difference[0]);
+            const auto j = single ? 0 : indexOf(difference[1]);
+            // x - y >= c is y - x <= -c
+            if (kind == LT || kind == LE || kind == EQ)
+                form.constraints.push_back({i, j, bound, kind == LT});
+            if (kind == GT || kind == GE || kind == EQ)
+                form.constraints.push_back({j, i, negate(bound), kind == GT});
+            return true;
+        }
+    };
+}  // namespace
+
+constraint_form_t constraint_form_t::split(const expression_t& expr)
+{
+    auto form = constraint_form_t{};
+    form.source = expr;
+    form.clocks.emplace_back();  // the reference clock
+    auto splitter = Splitter{form};
+    if (!expr.empty())
+        splitter.conjunct(expr);
+    form.data = splitter.conjunction();
+    return form;
+}
@@ -22,20 +22,17 @@
 #include "utap/document.h"
 
 #include "utap/builder.h"
+#include "utap/clockconstraints.h"
 #include "utap/statement.h"
 
 #include <functional>  // std::bind
+#include <limits>
 #include <sstream>
 #include <stack>
+#include <stdexcept>
 #include <cassert>
 #include <cstring>
 
-#ifdef __MINGW32__
-#include <windows.h>
-#elif defined(__linux__) || defined(__APPLE__)
-#include <dlfcn.h>
-#endif
-
 using namespace UTAP;
 using namespace Constants;
 
@@ -72,6 +69,20 @@ string edge_t::toString() const
     return str;
 }
 
+namespace
+{
+    const constraint_form_t& formOf(const expression_t& expr, std::shared_ptr<const constraint_form_t>& cache)
+    {
+        if (!cache || !(cache->source == expr))
+            cache = std::make_shared<const constraint_form_t>(constraint_form_t::split(expr));
+        return *cache;
+    }
+}  // namespace
+
+const constraint_form_t& state_t::getInvariantForm() const { return formOf(invariant, invariantForm); }
+
+const constraint_form_t& edge_t::getGuardForm() const { return formOf(guard, guardForm); }
+
 string function_t::toString() const
 {
     string str = "";
@@ -214,6 +225,21 @@ string declarations_t::getFunctions() const
     return str;
 }
 
+expression_t instance_t::getArgument(symbol_t parameter) const
+{
+    auto it = mapping.find(parameter);
+    return it != mapping.end() ? it->second : expression_t{};
+}
+
+expression_t instance_t::resolve(const expression_t& expr) const
+{
+    if (!expr.empty() && expr.getKind() == IDENTIFIER) {
+        if (auto it = mapping.find(expr.getSymbol()); it != mapping.end())
+            return instantiate(it->second);
+    }
+    return expr;
+}
+
 std::string instance_t::writeMapping() const
 {
     std::string str = "";
@@ -794,16 +820,7 @@ Document::Document(const Document& ta)
     throw TypeException("TODO");
 }
 
-Document::~Document() noexcept
-{
-    for (auto lib : libraries) {
-#if defined(__MINGW32__)  // Microsoft compiler
-        FreeLibrary((HINSTANCE)lib);
-#elif defined(__linux__) || defined(__APPLE__)
-        dlclose(lib);
-#endif
-    }
-}
+Document::~Document() noexcept = default;
 
 list<template_t>& Document::getTemplates() { return templates; }
 
@@ -811,9 +828,9 @@ list<instance_t>& Document::getProcesses() { return processes; }
 
 declarations_t& Document::getGlobals() { return global; }
 
-void Document::addLibrary(void* lib) { libraries.push_back(lib); }
+void Document::addLibrary(LibraryCache::Handle lib) { libraries.push_back(std::move(lib)); }
 
-void* Document::lastLibrary() { return libraries.back(); }
+const LibraryCache::Handle& Document::lastLibrary() { return libraries.back(); }
 /** Creates and returns a new template. The template is created with
  *  the given name and parameters and added to the global frame. The
  *  method does not check for duplicate declarations. An instance with
@@ -822,6 +839,7 @@ void* Document::lastLibrary() { return libraries.back(); }
 template_t& Document::addTemplate(const string& name, frame_t params, position_t position, const bool isTA,
                                   const string& typeLSC, const string& mode)
 {
+    checkNotFrozen();
     type_t type = (isTA) ? type_t::createInstance(params) : type_t::createLscInstance(params);
     template_t& templ = templates.emplace_back();
     templ.parameters = params;
@@ -836,11 +854,13 @@ template_t& Document::addTemplate(const string& name, frame_t params, position_t
     // LSC
     templ.type = typeLSC;
     templ.mode = mode;
+    templateIndex.add(templ);
     return templ;
 }
 
 template_t& Document::addDynamicTemplate(const std::string& name, frame_t params, position_t pos)
 {
+    checkNotFrozen();
     type_t type = type_t::createInstance(params);
     dynamicTemplates.emplace_back();
     template_t& templ = dynamicTemplates.back();
@@ -855,6 +875,7 @@ template_t& Document::addDynamicTemplate(const std::string& name, frame_t params
     templ.dynamic = true;
     templ.dynindex = dynamicTemplates.size() - 1;
     templ.isDefined = false;
+    dynamicTemplateIndex.add(templ);
     return templ;
 }
 
@@ -869,34 +890,40 @@ std::vector<template_t*>& Document::getDynamicTemplates()
     return dynamicTemplatesVec;
 }
 
-auto equal_name(const std::string& name)
+const template_t* Document::findTemplate(const std::string& name) const
 {
-    return [&name](const auto& e) { return (e.uid.getName() == name); };
+    if (const auto* templ = templateIndex.find(name))
+        return templ;
+    return dynamicTemplateIndex.find(name);
 }
 
-const template_t* Document::findTemplate(const std::string& name) const
+template_t* Document::getDynamicTemplate(const std::string& name) { return dynamicTemplateIndex.find(name); }
+
+void Document::reindex()
 {
-    auto has_name = equal_name(name);
-    auto it = std::find_if(std::begin(templates), std::end(templates), has_name);
-    if (it == std::end(templates)) {
-        it = std::find_if(std::begin(dynamicTemplates), std::end(dynamicTemplates), has_name);
-        if (it == std::end(dynamicTemplates))
-            return nullptr;
-    }
-    return &(*it);
+    templateIndex.assign(templates);
+    dynamicTemplateIndex.assign(dynamicTemplates);
+    instanceIndex.assign(instances);
+    processIndex.assign(processes);
 }
 
-template_t* Document::getDynamicTemplate(const std::string& name)
+void Document::checkNotFrozen() const
 {
-    auto it = std::find_if(std::begin(dynamicTemplates), std::end(dynamicTemplates), equal_name(name));
-    if (it == std::end(dynamicTemplates))
-        return nullptr;
-    return &(*it);
+    if (frozen)
+        throw TypeException("The document is frozen");
+}
+
+void Document::freeze()
+{
+    reindex();
+    getDynamicTemplates();
+    frozen = true;
 }
 
 instance_t& Document::addInstance(const string& name, instance_t& inst, frame_t params,
                                   const vector<expression_t>& arguments, position_t pos)
 {
+    checkNotFrozen();
     type_t type = type_t::createInstance(params);
     instance_t& instance = instances.emplace_back();
     instance.uid = global.frame.addSymbol(name, type, pos, &instance);
@@ -908,12 +935,14 @@ instance_t& Document::addInstance(const string& name, instance_t& inst, frame_t
     instance.templ = inst.templ;
     for (size_t i = 0; i < arguments.size(); ++i)
         instance.mapping[inst.parameters[i]] = arguments[i];
+    instanceIndex.add(instance);
     return instance;
 }
 
 instance_t& Document::addLscInstance(const string& name, instance_t& inst, frame_t params,
                                      const vector<expression_t>& arguments, position_t pos)
 {
+    checkNotFrozen();
     type_t type = type_t::createLscInstance(params);
     instance_t& instance = lscInstances.emplace_back();
     instance.uid = global.frame.addSymbol(name, type, pos, &instance);
@@ -930,6 +959,7 @@ instance_t& Document::addLscInstance(const string& name, instance_t& inst, frame
 
 void Document::removeProcess(instance_t& instance)
 {
+    checkNotFrozen();
     getGlobals().frame.remove(instance.uid);
     for (auto itr = processes.cbegin(); itr != processes.cend(); ++itr) {
         if (itr->uid == instance.uid) {
@@ -937,10 +967,12 @@ void Document::removeProcess(instance_t& instance)
             break;
         }
     }
+    processIndex.assign(processes);
 }
 
 void Document::addProcess(instance_t& instance, position_t pos)
 {
+    checkNotFrozen();
     type_t type;
     instance_t& process = processes.emplace_back(instance);
     if (process.unbound == 0)
@@ -948,6 +980,95 @@ void Document::addProcess(instance_t& instance, position_t pos)
     else
         type = type_t::createProcessSet(instance.uid.getType());
     process.uid = global.frame.addSymbol(instance.uid.getName(), type, pos, &process);
+    processIndex.add(process);
+}
+
+namespace
+{
+    /** Returns the process (set access) of the template in expr typed by the current frame of the template. */
+    expression_t retypeProcess(const expression_t& expr, const template_t& templ)
+    {
+        if (expr.getKind() == ARRAY) {
+            auto array = retypeProcess(expr[0], templ);
+            return expression_t::createBinary(ARRAY, array, expr[1], expr.getPosition(), array.getType().getSub());
+        }
+        const auto symbol = expr.getSymbol();
+        if (symbol.getType().getKind() == PROCESS)
+            return expression_t::createIdentifier(symbol, expr.getPosition());
+        // As ExpressionBuilder::exprCallEnd types the process set lookups
+        const auto* instance = static_cast<const instance_t*>(symbol.getData());
+        auto type = type_t::createProcess(templ.frame);
+        for (size_t i = 0; i < instance->unbound; ++i)
+            type = type_t::createArray(type, instance->parameters[instance->unbound - i - 1].getType());
+        auto id = expr.clone();
+        id.setType(type);
+        return id;
+    }
+
+    /**
+     * Returns the expression with the fields of the processes of the
+     * template looked up again by name, as ExpressionBuilder::exprDot
+     * does, or an empty expression if a field is gone.
+     */
+    expression_t rebindFields(const expression_t& expr, const template_t& templ)
+    {
+        if (expr.empty())
+            return expr;
+        auto result = expression_t{};
+        for (uint32_t i = 0; i < expr.getSize(); ++i) {
+            const auto sub = rebindFields(expr[i], templ);
+            if (sub.empty() && !expr[i].empty())
+                return sub;
+            if (sub == expr[i])
+                continue;
+            if (result.empty())
+                result = expr.clone();
+            result[i] = sub;
+        }
+        if (result.empty())
+            result = expr;
+        if (expr.getKind() != DOT || !expr[0].getType().isProcess())
+            return result;
+        const auto symbol = expr[0].getSymbol();
+        const auto* process = static_cast<const instance_t*>(symbol.getData());
+        if (process == nullptr || process->templ != &templ)
+            return result;
+        const auto object = retypeProcess(result[0], templ);
+        const auto type = object.getType();
+        if (expr.getIndex() == std::numeric_limits<int32_t>::max())  // the location of the process
+            return expression_t::createDot(object, expr.getIndex(), expr.getPosition(), expr.getType());
+        const auto i = type.findIndexOf(expr[0].getType().getLabel(expr.getIndex()));
+        if (i == -1)
+            return {};
+        if (type.getSub(i).isLocation())
+            return expression_t::createDot(object, i, expr.getPosition(), type_t::createPrimitive(BOOL));
+        auto field = type.getSub(i).rename(templ.uid.getName() + "::", symbol.getName() + "::");
+        for (const auto& [parameter, argument] : process->mapping)
+            field = field.subst(parameter, argument);
+        return expression_t::createDot(object, i, expr.getPosition(), field);
+    }
+}  // namespace
+
+bool Document::updateProcesses(const template_t& templ)
+{
+    for (auto& process : processes)
+        if (process.templ == &templ && process.uid.getType().getKind() == PROCESS)
+            process.uid.setType(type_t::createProcess(templ.frame));
+    const auto rebind = [&templ](expression_t& expr) {
+        auto rebound = rebindFields(expr, templ);
+        if (rebound.empty() && !expr.empty())
+            return false;
+        expr = std::move(rebound);
+        return true;
+    };
+    for (auto& progress : global.progress)
+        if (!rebind(progress.guard) || !rebind(progress.measure))
+            return false;
+    for (auto& gantt : global.ganttChart)
+        for (auto& map : gantt.mapping)
+            if (!rebind(map.predicate) || !rebind(map.mapping))
+                return false;
+    return true;
 }
 
 void Document::addGantt(declarations_t* context, gantt_t g) { context->ganttChart.push_back(std::move(g)); }
@@ -1011,78 +1132,71 @@ void Document::addProgressMeasure(declarations_t* context, expression_t guard, e
     context->progress.emplace_back(guard, measure);
 }
 
-static void visit(SystemVisitor& visitor, frame_t frame)
+void Document::acceptDeclaration(SystemVisitor& visitor, symbol_t symbol)
 {
-    for (size_t i = 0; i < frame.getSize(); ++i) {
-        type_t type = frame[i].getType();
+    type_t type = symbol.getType();
 
-        if (type.getKind() == TYPEDEF) {
-            visitor.visitTypeDef(frame[i]);
-            continue;
-        }
+    if (type.getKind() == TYPEDEF) {
+        visitor.visitTypeDef(symbol);
+        return;
+    }
 
-        void* data = frame[i].getData();
-        type = type.stripArray();
-
-        if ((type.is(Constants::INT) || type.is(Constants::STRING) || type.is(Constants::DOUBLE) ||
-             type.is(Constants::BOOL) || type.is(CLOCK) || type.is(CHANNEL) || type.is(SCALAR) ||
-             type.getKind() == RECORD) &&
-            data != nullptr)  // <--- ignore parameters
-        {
-            visitor.visitVariable(*static_cast<variable_t*>(data));
-        } else if (type.is(LOCATION)) {
-            visitor.visitState(*static_cast<state_t*>(data));
-        } else if (type.is(LOCATION_EXPR)) {
-            visitor.visitState(*static_cast<state_t*>(data));
-        } else if (type.is(FUNCTION)) {
-            visitor.visitFunction(*static_cast<function_t*>(data));
-        } else if (type.is(EXTERNAL_FUNCTION)) {
-            // we cannot look inside a external function, skip.
-        } else if (type.is(INSTANCELINE)) {
-            visitor.visitInstanceLine(*static_cast<instanceLine_t*>(data));
-        }
+    void* data = symbol.getData();
+    type = type.stripArray();
+
+    if ((type.is(Constants::INT) || type.is(Constants::STRING) || type.is(Constants::DOUBLE) ||
+         type.is(Constants::BOOL) || type.is(CLOCK) || type.is(CHANNEL) || type.is(SCALAR) ||
+         type.getKind() == RECORD) &&
+        data != nullptr)  // <--- ignore parameters
+    {
+        visitor.visitVariable(*static_cast<variable_t*>(data));
+    } else if (type.is(LOCATION)) {
+        visitor.visitState(*static_cast<state_t*>(data));
+    } else if (type.is(LOCATION_EXPR)) {
+        visitor.visitState(*static_cast<state_t*>(data));
+    } else if (type.is(FUNCTION)) {
+        visitor.visitFunction(*static_cast<function_t*>(data));
+    } else if (type.is(EXTERNAL_FUNCTION)) {
+        // we cannot look inside a external function, skip.
+    } else if (type.is(INSTANCELINE)) {
+        visitor.visitInstanceLine(*static_cast<instanceLine_t*>(data));
     }
 }
 
-void Document::accept(SystemVisitor& visitor)
+static void visit(SystemVisitor& visitor, frame_t frame)
 {
-    visitor.visitSystemBefore(this);
-    visit(visitor, global.frame);
-    for (auto t = templates.begin(); t != templates.end(); ++t) {
-        if (visitor.visitTemplateBefore(*t)) {
-            visit(visitor, t->frame);
-            for_each(t->edges.begin(), t->edges.end(), bind(&SystemVisitor::visitEdge, &visitor, _1));
-            for_each(t->messages.begin(), t->messages.end(), bind(&SystemVisitor::visitMessage, &visitor, _1));
-            for_each(t->updates.begin(), t->updates.end(), bind(&SystemVisitor::visitUpdate, &visitor, _1));
-            for_each(t->conditions.begin(), t->conditions.end(), bind(&SystemVisitor::visitCondition, &visitor, _1));
-            visitor.visitTemplateAfter(*t);
-        }
-    }
+    for (size_t i = 0; i < frame.getSize(); ++i)
+        Document::acceptDeclaration(visitor, frame[i]);
+}
 
-    for (auto t = dynamicTemplates.begin(); t != dynamicTemplates.end(); ++t) {
-        if (visitor.visitTemplateBefore(*t)) {
-            visit(visitor, t->frame);
-            for_each(t->edges.begin(), t->edges.end(), bind(&SystemVisitor::visitEdge, &visitor, _1));
-            for_each(t->messages.begin(), t->messages.end(), bind(&SystemVisitor::visitMessage, &visitor, _1));
-            for_each(t->updates.begin(), t->updates.end(), bind(&SystemVisitor::visitUpdate, &visitor, _1));
-            for_each(t->conditions.begin(), t->conditions.end(), bind(&SystemVisitor::visitCondition, &visitor, _1));
-            visitor.visitTemplateAfter(*t);
-        }
+void Document::acceptTemplate(SystemVisitor& visitor, template_t& t)
+{
+    if (visitor.visitTemplateBefore(t)) {
+        visit(visitor, t.frame);
+        for_each(t.edges.begin(), t.edges.end(), bind(&SystemVisitor::visitEdge, &visitor, _1));
+        for_each(t.messages.begin(), t.messages.end(), bind(&SystemVisitor::visitMessage, &visitor, _1));
+        for_each(t.updates.begin(), t.updates.end(), bind(&SystemVisitor::visitUpdate, &visitor, _1));
+        for_each(t.conditions.begin(), t.conditions.end(), bind(&SystemVisitor::visitCondition, &visitor, _1));
+        visitor.visitTemplateAfter(t);
     }
+}
 
-    for (size_t i = 0; i < global.frame.getSize(); ++i) {
-        type_t type = global.frame[i].getType();
-        void* data = global.frame[i].getData();
-        type = type.stripArray();
-        if (type.is(PROCESS) || type.is(PROCESSSET)) {
-            visitor.visitProcess(*static_cast<instance_t*>(data));
-        } else if (type.is(INSTANCE)) {
-            visitor.visitInstance(*static_cast<instance_t*>(data));
-        } else if (type.is(LSCINSTANCE)) {
-            visitor.visitInstance(*static_cast<instance_t*>(data));
-        }
+void Document::acceptInstance(SystemVisitor& visitor, symbol_t symbol)
+{
+    type_t type = symbol.getType();
+    void* data = symbol.getData();
+    type = type.stripArray();
+    if (type.is(PROCESS) || type.is(PROCESSSET)) {
+        visitor.visitProcess(*static_cast<instance_t*>(data));
+    } else if (type.is(INSTANCE)) {
+        visitor.visitInstance(*static_cast<instance_t*>(data));
+    } else if (type.is(LSCINSTANCE)) {
+        visitor.visitInstance(*static_cast<instance_t*>(data));
     }
+}
 
+void Document::acceptSystem(SystemVisitor& visitor)
+{
     for (auto&& decl : global.iodecl)
         visitor.visitIODecl(decl);
 
@@ -1096,6 +1210,145 @@ void Document::accept(SystemVisitor& visitor)
     visitor.visitSystemAfter(this);
 }
 
+void Document::accept(SystemVisitor& visitor)
+{
+    visitor.visitSystemBefore(this);
+    visit(visitor, global.frame);
+    for (auto& t : templates)
+        acceptTemplate(visitor, t);
+    for (auto& t : dynamicTemplates)
+        acceptTemplate(visitor, t);
+    for (size_t i = 0; i < global.frame.getSize(); ++i)
+        acceptInstance(visitor, global.frame[i]);
+    acceptSystem(visitor);
+}
+
+void Document::accept(std::initializer_list<SystemVisitor*> visitors)
+{
+    auto composite = CompositeVisitor{visitors};
+    accept(composite);
+}
+
+CompositeVisitor::CompositeVisitor(std::vector<SystemVisitor*> visitors):
+    visitors{std::move(visitors)}, active{this->visitors}
+{}
+
+void CompositeVisitor::visitSystemBefore(Document* doc)
+{
+    for (auto* visitor : active)
+        visitor->visitSystemBefore(doc);
+}
+
+void CompositeVisitor::visitSystemAfter(Document* doc)
+{
+    for (auto* visitor : active)
+        visitor->visitSystemAfter(doc);
+}
+
+void CompositeVisitor::visitVariable(variable_t& variable)
+{
+    for (auto* visitor : active)
+        visitor->visitVariable(variable);
+}
+
+bool CompositeVisitor::visitTemplateBefore(template_t& templ)
+{
+    active.clear();
+    for (auto* visitor : visitors)
+        if (visitor->visitTemplateBefore(templ))
+            active.push_back(visitor);
+    if (active.empty()) {
+        active = visitors;  // visitTemplateAfter() is not called
+        return false;
+    }
+    return true;
+}
+
+void CompositeVisitor::visitTemplateAfter(template_t& templ)
+{
+    for (auto* visitor : active)
+        visitor->visitTemplateAfter(templ);
+    active = visitors;
+}
+
+void CompositeVisitor::visitState(state_t& state)
+{
+    for (auto* visitor : active)
+        visitor->visitState(state);
+}
+
+void CompositeVisitor::visitEdge(edge_t& edge)
+{
+    for (auto* visitor : active)
+        visitor->visitEdge(edge);
+}
+
+void CompositeVisitor::visitInstance(instance_t& instance)
+{
+    for (auto* visitor : active)
+        visitor->visitInstance(instance);
+}
+
+void CompositeVisitor::visitProcess(instance_t& process)
+{
+    for (auto* visitor : active)
+        visitor->visitProcess(process);
+}
+
+void CompositeVisitor::visitFunction(function_t& function)
+{
+    for (auto* visitor : active)
+        visitor->visitFunction(function);
+}
+
+void CompositeVisitor::visitTypeDef(symbol_t symbol)
+{
+    for (auto* visitor : active)
+        visitor->visitTypeDef(symbol);
+}
+
+void CompositeVisitor::visitIODecl(iodecl_t& iodecl)
+{
+    for (auto* visitor : active)
+        visitor->visitIODecl(iodecl);
+}
+
+void CompositeVisitor::visitProgressMeasure(progress_t& progress)
+{
+    for (auto* visitor : active)
+        visitor->visitProgressMeasure(progress);
+}
+
+void CompositeVisitor::visitGanttChart(gantt_t& gantt)
+{
+    for (auto* visitor : active)
+        visitor->visitGanttChart(gantt);
+}
+
+void CompositeVisitor::visitInstanceLine(instanceLine_t& instance)
+{
+    for (auto* visitor : active)
+        visitor->visitInstanceLine(instance);
+}
+
+void CompositeVisitor::visitMessage(message_t& message)
+{
+    for (auto* visitor : active)
+        visitor->visitMessage(message);
+}
+
+void CompositeVisitor::visitCondition(condition_t& condition)
+{
+    for (auto* visitor : active)
+        visitor->visitCondition(condition);
+}
+
+void CompositeVisitor::visitUpdate(update_t& update)
+{
+    for (auto* visitor : active)
+        visitor->visitUpdate(update);
+}
+
 void Document::setBeforeUpdate(expression_t e) { beforeUpdate = e; }
 
 expression_t Document::getBeforeUpdate() { return beforeUpdate; }
@@ -1154,7 +1407,13 @@ void Document::addPosition(uint32_t position, uint32_t offset, uint32_t line, co
     positions.add(position, offset, line, path);
 }
 
-const Positions::line_t& Document::findPosition(uint32_t position) const { return positions.find(position); }
+Positions::line_t Document::findPosition(uint32_t position) const { return positions.find(position); }
+
+void Document::enableSourceIndex()
+{
+    if (!sourceIndex)
+        sourceIndex = std::make_unique<SourceIndex>();
+}
 
 void Document::addError(position_t position, std::string msg, std::string context)
 {
@@ -1169,8 +1428,20 @@ void Document::addWarning(position_t position, const std::string& msg, const std
 
 void Document::clearErrors() const { errors.clear(); }
 
+void Document::reserveDiagnostics(size_t errors, size_t warnings) const
+{
+    this->errors.reserve(errors);
+    this->warnings.reserve(warnings);
+}
+
 void Document::clearWarnings() const { warnings.clear(); }
 
+void Document::setDiagnostics(std::vector<error_t> errors, std::vector<error_t> warnings) const
+{
+    this->errors = std::move(errors);
+    this->warnings = std::move(warnings);
+}
+
 bool Document::isModified() const { return modified; }
 
 void Document::setModified(bool mod) { modified = mod; }
@@ -1186,4 +1457,11 @@ void Document::setSupportedMethods(const SupportedMethods& supportedMethods)
     this->supportedMethods = supportedMethods;
 }
 
+void Document::setLocal(bool local)
+{
+    if (local != this->local && hasNodes)
+        throw std::logic_error{"The nodes of the document have been created already"};
+    this->local = local;
+}
+
 const SupportedMethods& Document::getSupportedMethods() const { return supportedMethods; }
@@ -22,9 +22,19 @@
 #include "utap/expression.h"
 
 #include "utap/document.h"
+#include "utap/memoryreport.h"
+#include "utap/node.h"
+#include "utap/statistics.h"
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <ostream>
 #include <stdexcept>
+#include <string_view>
+#include <utility>
 #include <cassert>
 #include <cstring>
 
@@ -40,7 +50,103 @@ using std::pair;
 using std::set;
 using std::vector;
 
-struct expression_t::expression_data : public std::enable_shared_from_this<expression_t::expression_data>
+/**
+ * The subexpressions of a node. Up to three are stored in the node
+ * itself, so that unary, binary and ternary nodes need no allocation of
+ * their own.
+ */
+class subexpressions_t
+{
+public:
+    static constexpr uint32_t local = 3;
+
+    subexpressions_t() noexcept {}
+    subexpressions_t(const subexpressions_t&) = delete;
+    subexpressions_t& operator=(const subexpressions_t&) = delete;
+    ~subexpressions_t() noexcept
+    {
+        clear();
+        if (capacity > local)
+            ::operator delete(heap);
+    }
+    subexpressions_t& operator=(vector<expression_t>&& sub)
+    {
+        clear();
+        reserve(sub.size());
+        for (auto& e : sub)
+            push_back(std::move(e));
+        return *this;
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    /** Returns the bytes of the buffer of the subexpressions, 0 if they are kept in place. */
+    size_t bufferBytes() const { return capacity > local ? capacity * sizeof(expression_t) : 0; }
+    expression_t* begin() { return items(); }
+    expression_t* end() { return items() + count; }
+    const expression_t* begin() const { return items(); }
+    const expression_t* end() const { return items() + count; }
+    expression_t& operator[](size_t i) { return items()[i]; }
+    const expression_t& operator[](size_t i) const { return items()[i]; }
+
+    void reserve(size_t n)
+    {
+        if (n <= capacity)
+            return;
+        auto* moved = static_cast<expression_t*>(::operator new(n * sizeof(expression_t)));
+        for (uint32_t i = 0; i < count; ++i) {
+            new (moved + i) expression_t(std::move(items()[i]));
+            items()[i].~expression_t();
+        }
+        if (capacity > local)
+            ::operator delete(heap);
+        heap = moved;
+        capacity = static_cast<uint32_t>(n);
+    }
+    void push_back(expression_t e)
+    {
+        if (count == capacity)
+            reserve(2 * capacity);
+        new (items() + count) expression_t(std::move(e));
+        ++count;
+    }
+    template <typename It>
+    void assign(It first, It last)
+    {
+        clear();
+        reserve(std::distance(first, last));
+        for (; first != last; ++first)
+            push_back(*first);
+    }
+    void clear() noexcept
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            items()[i].~expression_t();
+        count = 0;
+    }
+
+    friend bool operator==(const subexpressions_t& a, const subexpressions_t& b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    }
+
+private:
+    union
+    {
+        alignas(expression_t) unsigned char inplace[local * sizeof(expression_t)];
+        expression_t* heap;
+    };
+    uint32_t count{0};
+    uint32_t capacity{local};
+
+    expression_t* items() { return capacity > local ? heap : std::launder(reinterpret_cast<expression_t*>(inplace)); }
+    const expression_t* items() const
+    {
+        return capacity > local ? heap : std::launder(reinterpret_cast<const expression_t*>(inplace));
+    }
+};
+
+struct expression_t::expression_data
 {
     position_t position; /**< The position of the expression */
     kind_t kind;         /**< The kind of the node */
@@ -53,14 +159,44 @@ struct expression_t::expression_data : public std::enable_shared_from_this<expre
     };
     symbol_t symbol;                 /**< The symbol of the node */
     type_t type;                     /**< The type of the expression */
-    std::vector<expression_t> sub{}; /**< Subexpressions */
+    subexpressions_t sub;            /**< Subexpressions */
+    const ExpressionTable* table{nullptr}; /**< The table this node is interned in */
+    /** The cached footprint of the expression (set once, possibly by concurrent readers). */
+    mutable std::atomic<const footprint_t*> footprint{nullptr};
+    /** The cached rendering of toStringCached(), like the footprint. */
+    mutable std::atomic<const std::string*> text{nullptr};
     expression_data(const position_t& p, kind_t kind, int32_t value): position{p}, kind{kind}, value{value} {}
-    ~expression_data() noexcept = default;
+    ~expression_data() noexcept;
 };
 
+/**
+ * The symbols an expression reads and writes (sorted and without
+ * duplicates), and the functions it calls: the symbols those read and
+ * write are added when the footprint is used.
+ */
+struct expression_t::footprint_t
+{
+    std::vector<symbol_t> reads;
+    std::vector<symbol_t> writes;
+    std::vector<const function_t*> readCalls;  /**< Functions whose depends are read. */
+    std::vector<const function_t*> writeCalls; /**< Functions whose changes are written. */
+
+    bool empty() const { return reads.empty() && writes.empty() && readCalls.empty() && writeCalls.empty(); }
+};
+
+const expression_t::footprint_t expression_t::noFootprint{};
+
+expression_t::expression_data::~expression_data() noexcept
+{
+    if (const auto* cached = footprint.load(std::memory_order_relaxed); cached != &noFootprint)
+        delete cached;
+    delete text.load(std::memory_order_relaxed);
+}
+
 expression_t::expression_t(kind_t kind, const position_t& pos)
 {
-    data = std::make_shared<expression_data>(pos, kind, 0);
+    data = make_node<expression_data>(pos, kind, 0);
+    Statistics::created(Statistics::EXPRESSIONS);
 }
 
 expression_t expression_t::clone() const
@@ -85,7 +221,7 @@ expression_t expression_t::deeperClone() const
         for (const auto& s : data->sub)
             expr.data->sub.push_back(s.deeperClone());
     }
-    return expr;
+    return intern(expr);
 }
 
 expression_t expression_t::deeperClone(symbol_t from, symbol_t to) const
@@ -100,7 +236,7 @@ expression_t expression_t::deeperClone(symbol_t from, symbol_t to) const
         for (const auto& s : data->sub)
             expr.data->sub.push_back(s.deeperClone(from, to));
     }
-    return expr;
+    return intern(expr);
 }
 
 expression_t expression_t::deeperClone(frame_t frame, frame_t select) const
@@ -125,7 +261,7 @@ expression_t expression_t::deeperClone(frame_t frame, frame_t select) const
         for (const auto& s : data->sub)
             expr.data->sub.push_back(s.deeperClone(frame, select));
     }
-    return expr;
+    return intern(expr);
 }
 
 expression_t expression_t::subst(symbol_t symbol, expression_t expr) const
@@ -141,8 +277,29 @@ expression_t expression_t::subst(symbol_t symbol, expression_t expr) const
         for (size_t i = 0; i < getSize(); i++) {
             e[i] = e[i].subst(symbol, expr);
         }
-        return e;
+        return intern(e);
+    }
+}
+
+expression_t expression_t::subst(const std::map<symbol_t, expression_t>& mapping) const
+{
+    if (empty() || mapping.empty()) {
+        return *this;
+    } else if (getKind() == IDENTIFIER) {
+        auto it = mapping.find(getSymbol());
+        return it != mapping.end() ? it->second.subst(mapping) : *this;
+    }
+    expression_t e;
+    for (size_t i = 0; i < getSize(); i++) {
+        const auto& sub = data->sub[i];
+        auto s = sub.subst(mapping);
+        if (s.data == sub.data)
+            continue;
+        if (e.empty())
+            e = clone();  // copy on the first replaced subexpression
+        e[i] = std::move(s);
     }
+    return e.empty() ? *this : intern(e);
 }
 
 kind_t expression_t::getKind() const
@@ -505,6 +662,7 @@ type_t expression_t::getType() const
 void expression_t::setType(type_t type)
 {
     assert(data);
+    discardCaches();
     data->type = type;
 }
 
@@ -546,6 +704,7 @@ synchronisation_t expression_t::getSync() const
 expression_t& expression_t::operator[](uint32_t i)
 {
     assert(i < getSize());
+    discardCaches();
     return data->sub[i];
 }
 
@@ -558,6 +717,7 @@ const expression_t expression_t::operator[](uint32_t i) const
 expression_t& expression_t::get(uint32_t i)
 {
     assert(i < getSize());
+    discardCaches();
     return data->sub[i];
 }
 
@@ -577,12 +737,24 @@ bool expression_t::isTrue() const
 /** Two expressions are identical iff all the sub expressions
     are identical and if the kind, value and symbol of the
     root are identical. */
+/** Primitive types are created anew each time, so compare them by kind. */
+static bool isPrimitive(const type_t& type) { return !type.unknown() && type.size() == 0 && type.getExpression().empty(); }
+
+static bool sameType(const type_t& a, const type_t& b)
+{
+    return a == b || (isPrimitive(a) && isPrimitive(b) && a.getKind() == b.getKind());
+}
+
 bool expression_t::equal(const expression_t& e) const
 {
     if (data == e.data) {
         return true;
     }
 
+    if (data->table != nullptr && data->table == e.data->table && sameType(data->type, e.data->type)) {
+        return false;
+    }
+
     if (getSize() != e.getSize() || data->kind != e.data->kind || data->value != e.data->value ||
         data->symbol != e.data->symbol) {
         return false;
@@ -699,6 +871,13 @@ bool expression_t::isReferenceTo(const std::set<symbol_t>& symbols) const
     return find_first_of(symbols.begin(), symbols.end(), s.begin(), s.end()) != symbols.end();
 }
 
+bool expression_t::isReferenceTo(const symbol_set_t& symbols) const
+{
+    std::set<symbol_t> s;
+    getSymbols(s);
+    return std::any_of(s.begin(), s.end(), [&symbols](const symbol_t& symbol) { return symbols.contains(symbol); });
+}
+
 bool expression_t::contains_deadlock() const
 {
     if (getKind() == UTAP::Constants::DEADLOCK)
@@ -710,25 +889,56 @@ bool expression_t::contains_deadlock() const
     return false;
 }
 
+static bool contains(const std::set<symbol_t>& symbols, const symbol_t& symbol) { return symbols.count(symbol) > 0; }
+static bool contains(const symbol_set_t& symbols, const symbol_t& symbol) { return symbols.contains(symbol); }
+
+/** Returns true if a symbol of the sorted range is in the set. */
+template <typename Symbols, typename Set>
+static bool intersects(const Symbols& sorted, const Set& symbols)
+{
+    if (sorted.empty() || symbols.empty())
+        return false;
+    return std::any_of(sorted.begin(), sorted.end(), [&symbols](const symbol_t& s) { return contains(symbols, s); });
+}
+
 bool expression_t::changesVariable(const std::set<symbol_t>& symbols) const
 {
-    std::set<symbol_t> changes;
-    collectPossibleWrites(changes);
-    return find_first_of(symbols.begin(), symbols.end(), changes.begin(), changes.end()) != symbols.end();
+    const auto& footprint = getFootprint();
+    return intersects(footprint.writes, symbols) ||
+           std::any_of(footprint.writeCalls.begin(), footprint.writeCalls.end(),
+                       [&symbols](const function_t* fun) { return intersects(fun->changes, symbols); });
+}
+
+bool expression_t::changesVariable(const symbol_set_t& symbols) const
+{
+    const auto& footprint = getFootprint();
+    return intersects(footprint.writes, symbols) ||
+           std::any_of(footprint.writeCalls.begin(), footprint.writeCalls.end(),
+                       [&symbols](const function_t* fun) { return fun->changeSet.intersects(symbols); });
 }
 
 bool expression_t::changesAnyVariable() const
 {
-    std::set<symbol_t> changes;
-    collectPossibleWrites(changes);
-    return !changes.empty();
+    const auto& footprint = getFootprint();
+    return !footprint.writes.empty() ||
+           std::any_of(footprint.writeCalls.begin(), footprint.writeCalls.end(),
+                       [](const function_t* fun) { return !fun->changes.empty(); });
 }
 
 bool expression_t::dependsOn(const std::set<symbol_t>& symbols) const
 {
-    std::set<symbol_t> dependencies;
-    collectPossibleReads(dependencies);
-    return find_first_of(symbols.begin(), symbols.end(), dependencies.begin(), dependencies.end()) != symbols.end();
+    const auto& footprint = getFootprint();
+    return intersects(footprint.reads, symbols) ||
+           std::any_of(footprint.readCalls.begin(), footprint.readCalls.end(),
+                       [&symbols](const function_t* fun) { return intersects(fun->depends, symbols); });
+}
+
+bool expression_t::dependsOn(const symbol_set_t& symbols) const
+{
+    const auto& footprint = getFootprint();
+    return intersects(footprint.reads, symbols) ||
+           std::any_of(footprint.readCalls.begin(), footprint.readCalls.end(),
+                       [&symbols](const function_t* fun) { return fun->dependSet.intersects(symbols); });
 }
 
 int expression_t::getPrecedence() const { return getPrecedence(data->kind); }
@@ -929,56 +1139,18 @@ int expression_t::getPrecedence(kind_t kind)
     return 0;
 }
 
-static void ensure(char*& str, char*& end, int& size, int len)
-{
-    while (size <= len) {
-        size *= 2;
-    }
-
-    char* nstr = new char[size];
-    strncpy(nstr, str, end - str);
-    end = nstr + (end - str);
-    *end = 0;
-    delete[] str;
-    str = nstr;
-}
-
-static void append(char*& str, char*& end, int& size, const char* s)
-{
-    while (end < str + size && *s) {
-        *(end++) = *(s++);
-    }
-
-    if (end == str + size) {
-        ensure(str, end, size, 2 * size);
-        append(str, end, size, s);
-    } else {
-        *end = 0;
-    }
-}
-
-static void append(char*& str, char*& end, int& size, char c)
-{
-    if (size - (end - str) < 2) {
-        ensure(str, end, size, size + 2);
-    }
-    *end = c;
-    ++end;
-    *end = 0;
-}
-
-void expression_t::appendBoundType(char*& str, char*& end, int& size, expression_t e) const
+void expression_t::appendBoundType(std::string& str, const expression_t& e) const
 {
     if (e.getKind() == CONSTANT) {
         assert(e.getType().is(Constants::INT));  // Encoding used here.
 
         if (e.getValue() == 0) {
-            append(str, end, size, "#");
+            str += "#";
         }
     } else {
-        e.toString(false, str, end, size);
+        e.toString(str, false);
     }
-    append(str, end, size, "<=");
+    str += "<=";
 }
 
 static const char* getBuiltinFunName(kind_t kind)
@@ -1051,7 +1223,7 @@ static const char* getBuiltinFunName(kind_t kind)
     return funNames[kind - ABS_F];
 }
 
-void expression_t::toString(bool old, char*& str, char*& end, int& size) const
+void expression_t::print(std::string& str, bool old) const
 {
     char s[64];
     int precedence = getPrecedence();
@@ -1061,52 +1233,52 @@ void expression_t::toString(bool old, char*& str, char*& end, int& size) const
     switch (data->kind) {
     case PROBAMINBOX: flag = true; [[fallthrough]];
     case PROBAMINDIAMOND:
-        append(str, end, size, "Pr[");
-        appendBoundType(str, end, size, get(0));
-        get(1).toString(old, str, end, size);
-        append(str, end, size, flag ? "]([] " : "](<> ");
-        get(2).toString(old, str, end, size);
-        append(str, end, size, ") >= ");
+        str += "Pr[";
+        appendBoundType(str, get(0));
+        get(1).toString(str, old);
+        str += flag ? "]([] " : "](<> ";
+        get(2).toString(str, old);
+        str += ") >= ";
         snprintf(s, sizeof(s), "%f", get(3).getDoubleValue());
-        append(str, end, size, s);
+        str += s;
         break;
 
     case PROBABOX: flag = true; [[fallthrough]];
     case PROBADIAMOND:
-        append(str, end, size, "Pr[");
-        appendBoundType(str, end, size, get(0));
-        get(1).toString(old, str, end, size);
-        append(str, end, size, flag ? "]([] " : "](<> ");
-        get(2).toString(old, str, end, size);
-        append(str, end, size, ") ?");
+        str += "Pr[";
+        appendBoundType(str, get(0));
+        get(1).toString(str, old);
+        str += flag ? "]([] " : "](<> ";
+        get(2).toString(str, old);
+        str += ") ?";
         break;
 
     case PROBAEXP:
-        append(str, end, size, "E[");
-        appendBoundType(str, end, size, get(0));
-        get(1).toString(old, str, end, size);
-        append(str, end, size, "; ");
-        get(2).toString(old, str, end, size);
-        append(str, end, size, "] (");
-        append(str, end, size, get(4).getValue() ? "max: " : "min: ");
-        get(3).toString(old, str, end, size);
-        append(str, end, size, ")");
+        str += "E[";
+        appendBoundType(str, get(0));
+        get(1).toString(str, old);
+        str += "; ";
+        get(2).toString(str, old);
+        str += "] (";
+        str += get(4).getValue() ? "max: " : "min: ";
+        get(3).toString(str, old);
+        str += ")";
         break;
 
     case SIMULATE:
-        append(str, end, size, "simulate[");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, "x ");
-        appendBoundType(str, end, size, get(1));
-        get(2).toString(old, str, end, size);
-        append(str, end, size, "]{");
+        str += "simulate[";
+        get(0).toString(str, old);
+        str += "x ";
+        appendBoundType(str, get(1));
+        get(2).toString(str, old);
+        str += "]{";
         nb = getValue() - 3;
         for (int i = 0; i < nb; ++i) {
             if (i > 0)
-                append(str, end, size, ", ");
-            get(3 + i).toString(old, str, end, size);
+                str += ", ";
+            get(3 + i).toString(str, old);
         }
-        append(str, end, size, "}");
+        str += "}";
         break;
 
     case PLUS:
@@ -1144,116 +1316,116 @@ void expression_t::toString(bool old, char*& str, char*& end, int& size) const
     case FRACTION:
 
         if (precedence > get(0).getPrecedence()) {
-            append(str, end, size, '(');
+            str += '(';
         }
-        get(0).toString(old, str, end, size);
+        get(0).toString(str, old);
         if (precedence > get(0).getPrecedence()) {
-            append(str, end, size, ')');
+            str += ')';
         }
 
         switch (data->kind) {
-        case FRACTION: append(str, end, size, " : "); break;
-        case PLUS: append(str, end, size, " + "); break;
-        case MINUS: append(str, end, size, " - "); break;
-        case MULT: append(str, end, size, " * "); break;
-        case DIV: append(str, end, size, " / "); break;
-        case MOD: append(str, end, size, " % "); break;
-        case POW: append(str, end, size, " ** "); break;
-        case BIT_AND: append(str, end, size, " & "); break;
-        case BIT_OR: append(str, end, size, " | "); break;
-        case BIT_XOR: append(str, end, size, " ^ "); break;
-        case BIT_LSHIFT: append(str, end, size, " << "); break;
-        case BIT_RSHIFT: append(str, end, size, " >> "); break;
-        case AND: append(str, end, size, " && "); break;
-        case OR: append(str, end, size, " || "); break;
-        case LT: append(str, end, size, " < "); break;
-        case LE: append(str, end, size, " <= "); break;
-        case EQ: append(str, end, size, " == "); break;
-        case NEQ: append(str, end, size, " != "); break;
-        case GE: append(str, end, size, " >= "); break;
-        case GT: append(str, end, size, " > "); break;
+        case FRACTION: str += " : "; break;
+        case PLUS: str += " + "; break;
+        case MINUS: str += " - "; break;
+        case MULT: str += " * "; break;
+        case DIV: str += " / "; break;
+        case MOD: str += " % "; break;
+        case POW: str += " ** "; break;
+        case BIT_AND: str += " & "; break;
+        case BIT_OR: str += " | "; break;
+        case BIT_XOR: str += " ^ "; break;
+        case BIT_LSHIFT: str += " << "; break;
+        case BIT_RSHIFT: str += " >> "; break;
+        case AND: str += " && "; break;
+        case OR: str += " || "; break;
+        case LT: str += " < "; break;
+        case LE: str += " <= "; break;
+        case EQ: str += " == "; break;
+        case NEQ: str += " != "; break;
+        case GE: str += " >= "; break;
+        case GT: str += " > "; break;
         case ASSIGN:
             if (old) {
-                append(str, end, size, " := ");
+                str += " := ";
             } else {
-                append(str, end, size, " = ");
+                str += " = ";
             }
             break;
-        case ASSPLUS: append(str, end, size, " += "); break;
-        case ASSMINUS: append(str, end, size, " -= "); break;
-        case ASSDIV: append(str, end, size, " /= "); break;
-        case ASSMOD: append(str, end, size, " %= "); break;
-        case ASSMULT: append(str, end, size, " *= "); break;
-        case ASSAND: append(str, end, size, " &= "); break;
-        case ASSOR: append(str, end, size, " |= "); break;
-        case ASSXOR: append(str, end, size, " ^= "); break;
-        case ASSLSHIFT: append(str, end, size, " <<= "); break;
-        case ASSRSHIFT: append(str, end, size, " >>= "); break;
-        case MIN: append(str, end, size, " <? "); break;
-        case MAX: append(str, end, size, " >? "); break;
+        case ASSPLUS: str += " += "; break;
+        case ASSMINUS: str += " -= "; break;
+        case ASSDIV: str += " /= "; break;
+        case ASSMOD: str += " %= "; break;
+        case ASSMULT: str += " *= "; break;
+        case ASSAND: str += " &= "; break;
+        case ASSOR: str += " |= "; break;
+        case ASSXOR: str += " ^= "; break;
+        case ASSLSHIFT: str += " <<= "; break;
+        case ASSRSHIFT: str += " >>= "; break;
+        case MIN: str += " <? "; break;
+        case MAX: str += " >? "; break;
         default: assert(0);
         }
 
         if (precedence >= get(1).getPrecedence()) {
-            append(str, end, size, '(');
+            str += '(';
         }
-        get(1).toString(old, str, end, size);
+        get(1).toString(str, old);
         if (precedence >= get(1).getPrecedence()) {
-            append(str, end, size, ')');
+            str += ')';
         }
         break;
 
-    case IDENTIFIER: append(str, end, size, data->symbol.getName().c_str()); break;
+    case IDENTIFIER: str += data->symbol.getName(); break;
 
     case VARINDEX:
     case CONSTANT:
-        if (getType().is(Constants::DOUBLE)) {
+        if (data->type.is(Constants::DOUBLE)) {
             snprintf(s, sizeof(s), "%f", getDoubleValue());
-        } else if (getType().isString()) {
+        } else if (data->type.isString()) {
             snprintf(s, sizeof(s), "string#%d", data->value);
-        } else if (getType().is(Constants::INT)) {
+        } else if (data->type.is(Constants::INT)) {
             snprintf(s, sizeof(s), "%d", data->value);
         } else {
-            assert(getType().is(Constants::BOOL));
+            assert(data->type.is(Constants::BOOL));
             snprintf(s, sizeof(s), "%s", data->value ? "true" : "false");
         }
-        append(str, end, size, s);
+        str += s;
         break;
 
     case ARRAY:
         if (precedence > get(0).getPrecedence()) {
-            append(str, end, size, '(');
-            get(0).toString(old, str, end, size);
-            append(str, end, size, ')');
+            str += '(';
+            get(0).toString(str, old);
+            str += ')';
         } else {
-            get(0).toString(old, str, end, size);
+            get(0).toString(str, old);
         }
-        append(str, end, size, '[');
-        get(1).toString(old, str, end, size);
-        append(str, end, size, ']');
+        str += '[';
+        get(1).toString(str, old);
+        str += ']';
         break;
 
     case UNARY_MINUS:
-        append(str, end, size, '-');
+        str += '-';
         if (precedence > get(0).getPrecedence()) {
-            append(str, end, size, '(');
-            get(0).toString(old, str, end, size);
-            append(str, end, size, ')');
+            str += '(';
+            get(0).toString(str, old);
+            str += ')';
         } else {
-            get(0).toString(old, str, end, size);
+            get(0).toString(str, old);
         }
         break;
 
     case POSTDECREMENT:
     case POSTINCREMENT:
         if (precedence > get(0).getPrecedence()) {
-            append(str, end, size, '(');
-            get(0).toString(old, str, end, size);
-            append(str, end, size, ')');
+            str += '(';
+            get(0).toString(str, old);
+            str += ')';
         } else {
-            get(0).toString(old, str, end, size);
+            get(0).toString(str, old);
         }
-        append(str, end, size, getKind() == POSTDECREMENT ? "--" : "++");
+        str += getKind() == POSTDECREMENT ? "--" : "++";
         break;
 
     case ABS_F:
@@ -1300,10 +1472,10 @@ void expression_t::toString(bool old, char*& str, char*& end, int& size) const
     case ISUNORDERED_F:
     case RANDOM_F:
     case RANDOM_POISSON_F:
-        append(str, end, size, getBuiltinFunName(data->kind));
-        append(str, end, size, "(");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, ')');
+        str += getBuiltinFunName(data->kind);
+        str += "(";
+        get(0).toString(str, old);
+        str += ')';
         break;
 
     case FMOD_F:
@@ -1321,54 +1493,54 @@ void expression_t::toString(bool old, char*& str, char*& end, int& size) const
     case RANDOM_GAMMA_F:
     case RANDOM_NORMAL_F:
     case RANDOM_WEIBULL_F:
-        append(str, end, size, getBuiltinFunName(data->kind));
-        append(str, end, size, "(");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, ',');
-        get(1).toString(old, str, end, size);
-        append(str, end, size, ')');
+        str += getBuiltinFunName(data->kind);
+        str += "(";
+        get(0).toString(str, old);
+        str += ',';
+        get(1).toString(str, old);
+        str += ')';
         break;
 
     case FMA_F:
     case RANDOM_TRI_F:
-        append(str, end, size, getBuiltinFunName(data->kind));
-        append(str, end, size, "(");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, ',');
-        get(1).toString(old, str, end, size);
-        append(str, end, size, ',');
-        get(2).toString(old, str, end, size);
-        append(str, end, size, ')');
+        str += getBuiltinFunName(data->kind);
+        str += "(";
+        get(0).toString(str, old);
+        str += ',';
+        get(1).toString(str, old);
+        str += ',';
+        get(2).toString(str, old);
+        str += ')';
         break;
 
     case XOR:
-        append(str, end, size, '(');
-        get(0).toString(old, str, end, size);
-        append(str, end, size, ") xor (");
-        get(1).toString(old, str, end, size);
-        append(str, end, size, ')');
+        str += '(';
+        get(0).toString(str, old);
+        str += ") xor (";
+        get(1).toString(str, old);
+        str += ')';
         break;
 
     case PREDECREMENT:
     case PREINCREMENT:
-        append(str, end, size, getKind() == PREDECREMENT ? "--" : "++");
+        str += getKind() == PREDECREMENT ? "--" : "++";
         if (precedence > get(0).getPrecedence()) {
-            append(str, end, size, '(');
-            get(0).toString(old, str, end, size);
-            append(str, end, size, ')');
+            str += '(';
+            get(0).toString(str, old);
+            str += ')';
         } else {
-            get(0).toString(old, str, end, size);
+            get(0).toString(str, old);
         }
         break;
 
     case NOT:
-        append(str, end, size, '!');
+        str += '!';
         if (precedence > get(0).getPrecedence()) {
-            append(str, end, size, '(');
-            get(0).toString(old, str, end, size);
-            append(str, end, size, ')');
+            str += '(';
+            get(0).toString(str, old);
+            str += ')';
         } else {
-            get(0).toString(old, str, end, size);
+            get(0).toString(str, old);
         }
         break;
 
@@ -1376,14 +1548,14 @@ void expression_t::toString(bool old, char*& str, char*& end, int& size) const
         type_t type = get(0).getType();
         if (type.isProcess() || type.isRecord()) {
             if (precedence > get(0).getPrecedence()) {
-                append(str, end, size, '(');
-                get(0).toString(old, str, end, size);
-                append(str, end, size, ')');
+                str += '(';
+                get(0).toString(str, old);
+                str += ')';
             } else {
-                get(0).toString(old, str, end, size);
+                get(0).toString(str, old);
             }
-            append(str, end, size, '.');
-            append(str, end, size, type.getRecordLabel(data->value).c_str());
+            str += '.';
+            str += type.getRecordLabel(data->value);
         } else {
             assert(0);
         }
@@ -1392,355 +1564,438 @@ void expression_t::toString(bool old, char*& str, char*& end, int& size) const
 
     case INLINEIF:
         if (precedence >= get(0).getPrecedence()) {
-            append(str, end, size, '(');
-            get(0).toString(old, str, end, size);
-            append(str, end, size, ')');
+            str += '(';
+            get(0).toString(str, old);
+            str += ')';
         } else {
-            get(0).toString(old, str, end, size);
+            get(0).toString(str, old);
         }
 
-        append(str, end, size, " ? ");
+        str += " ? ";
 
         if (precedence >= get(1).getPrecedence()) {
-            append(str, end, size, '(');
-            get(1).toString(old, str, end, size);
-            append(str, end, size, ')');
+            str += '(';
+            get(1).toString(str, old);
+            str += ')';
         } else {
-            get(1).toString(old, str, end, size);
+            get(1).toString(str, old);
         }
 
-        append(str, end, size, " : ");
+        str += " : ";
 
         if (precedence >= get(2).getPrecedence()) {
-            append(str, end, size, '(');
-            get(2).toString(old, str, end, size);
-            append(str, end, size, ')');
+            str += '(';
+            get(2).toString(str, old);
+            str += ')';
         } else {
-            get(2).toString(old, str, end, size);
+            get(2).toString(str, old);
         }
 
         break;
 
     case COMMA:
-        get(0).toString(old, str, end, size);
-        append(str, end, size, ", ");
-        get(1).toString(old, str, end, size);
+        get(0).toString(str, old);
+        str += ", ";
+        get(1).toString(str, old);
         break;
 
     case SYNC:
-        get(0).toString(old, str, end, size);
+        get(0).toString(str, old);
         switch (data->sync) {
-        case SYNC_QUE: append(str, end, size, '?'); break;
-        case SYNC_BANG: append(str, end, size, '!'); break;
+        case SYNC_QUE: str += '?'; break;
+        case SYNC_BANG: str += '!'; break;
         case SYNC_CSP:
             // no append
             break;
         }
         break;
 
-    case DEADLOCK: append(str, end, size, "deadlock"); break;
+    case DEADLOCK: str += "deadlock"; break;
 
     case LIST:
-        get(0).toString(old, str, end, size);
+        get(0).toString(str, old);
         for (uint32_t i = 1; i < getSize(); i++) {
-            append(str, end, size, ", ");
-            get(i).toString(old, str, end, size);
+            str += ", ";
+            get(i).toString(str, old);
         }
         break;
 
     case FUNCALL:
     case EFUNCALL:
-        get(0).toString(old, str, end, size);
-        append(str, end, size, '(');
+        get(0).toString(str, old);
+        str += '(';
         if (getSize() > 1) {
-            get(1).toString(old, str, end, size);
+            get(1).toString(str, old);
             for (uint32_t i = 2; i < getSize(); i++) {
-                append(str, end, size, ", ");
-                get(i).toString(old, str, end, size);
+                str += ", ";
+                get(i).toString(str, old);
             }
         }
-        append(str, end, size, ')');
+        str += ')';
         break;
 
     case RATE:
-        get(0).toString(old, str, end, size);
-        append(str, end, size, "'");
+        get(0).toString(str, old);
+        str += "'";
         break;
 
     case EF:
-        append(str, end, size, "E<> ");
-        get(0).toString(old, str, end, size);
+        str += "E<> ";
+        get(0).toString(str, old);
         break;
 
     case EG:
-        append(str, end, size, "E[] ");
-        get(0).toString(old, str, end, size);
+        str += "E[] ";
+        get(0).toString(str, old);
         break;
 
     case AF:
-        append(str, end, size, "A<> ");
-        get(0).toString(old, str, end, size);
+        str += "A<> ";
+        get(0).toString(str, old);
         break;
 
     case AG:
-        append(str, end, size, "A[] ");
-        get(0).toString(old, str, end, size);
+        str += "A[] ";
+        get(0).toString(str, old);
         break;
 
     case LEADSTO:
-        get(0).toString(old, str, end, size);
-        append(str, end, size, " --> ");
-        get(1).toString(old, str, end, size);
+        get(0).toString(str, old);
+        str += " --> ";
+        get(1).toString(str, old);
         break;
 
     case A_UNTIL:
-        append(str, end, size, "A[");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, " U ");
-        get(1).toString(old, str, end, size);
-        append(str, end, size, "] ");
+        str += "A[";
+        get(0).toString(str, old);
+        str += " U ";
+        get(1).toString(str, old);
+        str += "] ";
         break;
 
     case A_WEAKUNTIL:
-        append(str, end, size, "A[");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, " W ");
-        get(1).toString(old, str, end, size);
-        append(str, end, size, "] ");
+        str += "A[";
+        get(0).toString(str, old);
+        str += " W ";
+        get(1).toString(str, old);
+        str += "] ";
         break;
 
     case A_BUCHI:
-        append(str, end, size, "A[] ((");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, ") and A<> ");
-        get(1).toString(old, str, end, size);
-        append(str, end, size, ") ");
+        str += "A[] ((";
+        get(0).toString(str, old);
+        str += ") and A<> ";
+        get(1).toString(str, old);
+        str += ") ";
         break;
 
     case FORALL:
-        append(str, end, size, "forall (");
-        append(str, end, size, get(0).getSymbol().getName().c_str());
-        append(str, end, size, ":");
-        append(str, end, size, get(0).getSymbol().getType().toString().c_str());
-        append(str, end, size, ") ");
-        get(1).toString(old, str, end, size);
+        str += "forall (";
+        str += get(0).getSymbol().getName();
+        str += ":";
+        str += get(0).getSymbol().getType().toString();
+        str += ") ";
+        get(1).toString(str, old);
         break;
 
     case EXISTS:
-        append(str, end, size, "exists (");
-        append(str, end, size, get(0).getSymbol().getName().c_str());
-        append(str, end, size, ":");
-        append(str, end, size, get(0).getSymbol().getType().toString().c_str());
-        append(str, end, size, ") ");
-        get(1).toString(old, str, end, size);
+        str += "exists (";
+        str += get(0).getSymbol().getName();
+        str += ":";
+        str += get(0).getSymbol().getType().toString();
+        str += ") ";
+        get(1).toString(str, old);
         break;
 
     case SUM:
-        append(str, end, size, "sum (");
-        append(str, end, size, get(0).getSymbol().getName().c_str());
-        append(str, end, size, ":");
-        append(str, end, size, get(0).getSymbol().getType().toString().c_str());
-        append(str, end, size, ") ");
-        get(1).toString(old, str, end, size);
+        str += "sum (";
+        str += get(0).getSymbol().getName();
+        str += ":";
+        str += get(0).getSymbol().getType().toString();
+        str += ") ";
+        get(1).toString(str, old);
         break;
 
     case SMC_CONTROL:
         assert(false);
-        append(str, end, size, "control[");
-        appendBoundType(str, end, size, get(0));
-        get(1).toString(old, str, end, size);
-        append(str, end, size, "]: ");
-        get(2).toString(old, str, end, size);
+        str += "control[";
+        appendBoundType(str, get(0));
+        get(1).toString(str, old);
+        str += "]: ";
+        get(2).toString(str, old);
         break;
 
     case PO_CONTROL:
-        append(str, end, size, "{ ");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, "} control: ");
-        get(1).toString(old, str, end, size);
+        str += "{ ";
+        get(0).toString(str, old);
+        str += "} control: ";
+        get(1).toString(str, old);
         break;
 
-    case EF_CONTROL: append(str, end, size, "E<> "); [[fallthrough]];
+    case EF_CONTROL: str += "E<> "; [[fallthrough]];
     case CONTROL:
-        append(str, end, size, "control: ");
-        get(0).toString(old, str, end, size);
+        str += "control: ";
+        get(0).toString(str, old);
         break;
 
     case CONTROL_TOPT:
-        append(str, end, size, "control_t*(");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, ",");
-        get(1).toString(old, str, end, size);
-        append(str, end, size, "): ");
-        get(2).toString(old, str, end, size);
+        str += "control_t*(";
+        get(0).toString(str, old);
+        str += ",";
+        get(1).toString(str, old);
+        str += "): ";
+        get(2).toString(str, old);
         break;
 
     case CONTROL_TOPT_DEF1:
-        append(str, end, size, "control_t*(");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, "): ");
-        get(1).toString(old, str, end, size);
+        str += "control_t*(";
+        get(0).toString(str, old);
+        str += "): ";
+        get(1).toString(str, old);
         break;
 
     case CONTROL_TOPT_DEF2:
-        append(str, end, size, "control_t*: ");
-        get(0).toString(old, str, end, size);
+        str += "control_t*: ";
+        get(0).toString(str, old);
         break;
 
     case SUP_VAR:
-        append(str, end, size, "sup{");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, "}: ");
-        get(1).toString(old, str, end, size);
+        str += "sup{";
+        get(0).toString(str, old);
+        str += "}: ";
+        get(1).toString(str, old);
         break;
 
     case INF_VAR:
-        append(str, end, size, "inf{");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, "}: ");
-        get(1).toString(old, str, end, size);
+        str += "inf{";
+        get(0).toString(str, old);
+        str += "}: ";
+        get(1).toString(str, old);
         break;
 
     case MITLFORMULA:
-        append(str, end, size, "MITL: ");
-        get(0).toString(old, str, end, size);
+        str += "MITL: ";
+        get(0).toString(str, old);
         break;
     case MITLRELEASE:
     case MITLUNTIL:
-        get(0).toString(old, str, end, size);
-        append(str, end, size, "U[");
-        get(1).toString(old, str, end, size);
-        append(str, end, size, ";");
-        get(2).toString(old, str, end, size);
-        append(str, end, size, "]");
-        get(3).toString(old, str, end, size);
+        get(0).toString(str, old);
+        str += "U[";
+        get(1).toString(str, old);
+        str += ";";
+        get(2).toString(str, old);
+        str += "]";
+        get(3).toString(str, old);
         break;
 
     case MITLDISJ:
-        get(0).toString(old, str, end, size);
-        append(str, end, size, "\\/");
-        get(1).toString(old, str, end, size);
+        get(0).toString(str, old);
+        str += "\\/";
+        get(1).toString(str, old);
         break;
     case MITLCONJ:
-        get(0).toString(old, str, end, size);
-        append(str, end, size, "/\\");
-        get(1).toString(old, str, end, size);
+        get(0).toString(str, old);
+        str += "/\\";
+        get(1).toString(str, old);
         break;
-    case MITLATOM: get(0).toString(old, str, end, size); break;
+    case MITLATOM: get(0).toString(str, old); break;
     case MITLNEXT:
-        append(str, end, size, "X(");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, ")");
+        str += "X(";
+        get(0).toString(str, old);
+        str += ")";
         break;
-    case SPAWN: append(str, end, size, "SPAWN"); break;
-    case EXIT: append(str, end, size, "EXIT"); break;
+    case SPAWN: str += "SPAWN"; break;
+    case EXIT: str += "EXIT"; break;
     case NUMOF:
 
-        append(str, end, size, "numof(");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, ")");
+        str += "numof(";
+        get(0).toString(str, old);
+        str += ")";
         break;
     case FORALLDYNAMIC:
-        append(str, end, size, "forall (");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, " : ");
-        get(1).toString(old, str, end, size);
-        append(str, end, size, " )( ");
-        get(2).toString(old, str, end, size);
-        append(str, end, size, ")");
+        str += "forall (";
+        get(0).toString(str, old);
+        str += " : ";
+        get(1).toString(str, old);
+        str += " )( ";
+        get(2).toString(str, old);
+        str += ")";
         break;
     case SUMDYNAMIC:
-        append(str, end, size, "sum (");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, " : ");
-        get(1).toString(old, str, end, size);
-        append(str, end, size, " )( ");
-        get(2).toString(old, str, end, size);
-        append(str, end, size, ")");
+        str += "sum (";
+        get(0).toString(str, old);
+        str += " : ";
+        get(1).toString(str, old);
+        str += " )( ";
+        get(2).toString(str, old);
+        str += ")";
         break;
     case FOREACHDYNAMIC:
-        append(str, end, size, "foreach (");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, " : ");
-        get(1).toString(old, str, end, size);
-        append(str, end, size, " )( ");
-        get(2).toString(old, str, end, size);
-        append(str, end, size, ")");
+        str += "foreach (";
+        get(0).toString(str, old);
+        str += " : ";
+        get(1).toString(str, old);
+        str += " )( ";
+        get(2).toString(str, old);
+        str += ")";
         break;
     case DYNAMICEVAL:
-        get(1).toString(old, str, end, size);
-        append(str, end, size, ".");
-        get(0).toString(old, str, end, size);
+        get(1).toString(str, old);
+        str += ".";
+        get(0).toString(str, old);
         break;
-    case PROCESSVAR: get(0).toString(old, str, end, size); break;
+    case PROCESSVAR: get(0).toString(str, old); break;
     case MITLEXISTS:
     case EXISTSDYNAMIC:
-        append(str, end, size, "exists (");
-        get(0).toString(old, str, end, size);
-        append(str, end, size, " : ");
-        get(1).toString(old, str, end, size);
-        append(str, end, size, " )( ");
-        get(2).toString(old, str, end, size);
-        append(str, end, size, ")");
+        str += "exists (";
+        get(0).toString(str, old);
+        str += " : ";
+        get(1).toString(str, old);
+        str += " )( ";
+        get(2).toString(str, old);
+        str += ")";
         break;
-    case SAVE_STRAT: append(str, end, size, "saveStrategy (...)"); break;
+    case SAVE_STRAT: str += "saveStrategy (...)"; break;
     case LOAD_STRAT:
-        append(str, end, size, "loadStrategy (");
-        get(0).toString(old, str, end, size);
+        str += "loadStrategy (";
+        get(0).toString(str, old);
         if (!get(1).isTrue() && !get(2).isTrue()) {
-            append(str, end, size, ", {");
-            get(2).toString(old, str, end, size);
-            append(str, end, size, "} -> {");
-            get(3).toString(old, str, end, size);
-            append(str, end, size, "}");
+            str += ", {";
+            get(2).toString(str, old);
+            str += "} -> {";
+            get(3).toString(str, old);
+            str += "}";
         }
-        append(str, end, size, ")");
+        str += ")";
         break;
     default: throw std::logic_error("Support is not implemented for the given expression type");
     }
 }
 
-bool expression_t::operator<(const expression_t e) const
+bool expression_t::operator<(const expression_t& e) const
 {
     return data != nullptr && e.data != nullptr && data < e.data;
 }
 
-bool expression_t::operator==(const expression_t e) const { return data == e.data; }
+bool expression_t::operator==(const expression_t& e) const { return data == e.data; }
 
-/** Returns a string representation of the expression. The string
-    returned must be deallocated with delete[]. Returns NULL is the
-    expression is empty. */
 std::string expression_t::toString(bool old) const
 {
-    if (empty()) {
-        return std::string();
-    } else {
-        int size = 16;
-        char *s, *end;
-        s = end = new char[size];
-        *s = 0;
-        toString(old, s, end, size);
-        std::string result(s);
-        delete[] s;
-        return result;
+    auto str = std::string{};
+    toString(str, old);
+    return str;
+}
+
+void expression_t::toString(std::string& str, bool old) const
+{
+    if (!empty())
+        print(str, old);
+}
+
+void expression_t::measure(MemoryReport& report) const
+{
+    // Iterative, as expressions such as long comma lists can be deep
+    auto pending = std::vector<const expression_data*>{};
+    if (data)
+        pending.push_back(data.get());
+    while (!pending.empty()) {
+        const auto* node = pending.back();
+        pending.pop_back();
+        if (!report.enter(node))
+            continue;
+        auto bytes = MemoryReport::nodeBytes(sizeof(expression_data)) + node->sub.bufferBytes();
+        if (const auto* fp = node->footprint.load(std::memory_order_acquire); fp != nullptr && fp != &noFootprint) {
+            bytes += sizeof(footprint_t) + (fp->reads.capacity() + fp->writes.capacity()) * sizeof(symbol_t) +
+                     (fp->readCalls.capacity() + fp->writeCalls.capacity()) * sizeof(const function_t*);
+        }
+        if (const auto* text = node->text.load(std::memory_order_acquire); text != nullptr)
+            bytes += MemoryReport::stringBytes(*text);
+        report.addExpression(node->kind, bytes);
+        node->symbol.measure(report);
+        node->type.measure(report);
+        for (const auto& e : node->sub)
+            if (e.data)
+                pending.push_back(e.data.get());
     }
 }
 
-void expression_t::collectPossibleWrites(set<symbol_t>& symbols) const
+std::string expression_t::toStringCached() const
 {
-    function_t* fun;
-    symbol_t symbol;
-    type_t type;
+    if (empty())
+        return {};
+    if (const auto* cached = data->text.load(std::memory_order_acquire))
+        return *cached;
+    auto text = std::make_unique<std::string>();
+    print(*text, false);
+    const std::string* expected = nullptr;
+    if (!data->text.compare_exchange_strong(expected, text.get(), std::memory_order_acq_rel))
+        return *expected;  // rendered by another thread in the meantime
+    return *text.release();
+}
 
-    if (empty()) {
-        return;
+namespace UTAP
+{
+    std::ostream& operator<<(std::ostream& o, const expression_t& e)
+    {
+        static thread_local auto buffer = std::string{};
+        auto str = std::move(buffer);  // printing an expression may print others
+        str.clear();
+        e.toString(str);
+        o << std::string_view{str};
+        buffer = std::move(str);
+        return o;
     }
+}  // namespace UTAP
 
-    for (uint32_t i = 0; i < getSize(); i++) {
-        get(i).collectPossibleWrites(symbols);
+template <typename T>
+static void sortUnique(std::vector<T>& values)
+{
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+}
+
+const expression_t::footprint_t& expression_t::getFootprint() const
+{
+    if (empty())
+        return noFootprint;
+    if (const auto* cached = data->footprint.load(std::memory_order_acquire))
+        return *cached;
+    auto footprint = std::make_unique<footprint_t>();
+    collectFootprint(*footprint);
+    sortUnique(footprint->reads);
+    sortUnique(footprint->writes);
+    sortUnique(footprint->readCalls);
+    sortUnique(footprint->writeCalls);
+    const footprint_t* computed = footprint->empty() ? &noFootprint : footprint.get();
+    const footprint_t* expected = nullptr;
+    if (!data->footprint.compare_exchange_strong(expected, computed, std::memory_order_acq_rel))
+        return *expected;  // computed by another thread in the meantime
+    if (computed != &noFootprint)
+        footprint.release();
+    return *computed;
+}
+
+/** Adds the reads and writes of the expression, using the cached footprints of subexpressions. */
+void expression_t::collectFootprint(footprint_t& footprint) const
+{
+    for (const auto& sub : data->sub) {
+        if (sub.empty())
+            continue;
+        if (const auto* cached = sub.data->footprint.load(std::memory_order_acquire)) {
+            footprint.reads.insert(footprint.reads.end(), cached->reads.begin(), cached->reads.end());
+            footprint.writes.insert(footprint.writes.end(), cached->writes.begin(), cached->writes.end());
+            footprint.readCalls.insert(footprint.readCalls.end(), cached->readCalls.begin(), cached->readCalls.end());
+            footprint.writeCalls.insert(footprint.writeCalls.end(), cached->writeCalls.begin(),
+                                        cached->writeCalls.end());
+        } else {
+            sub.collectFootprint(footprint);
+        }
     }
 
+    std::set<symbol_t> written;
     switch (getKind()) {
+    case IDENTIFIER: footprint.reads.push_back(getSymbol()); break;
+
     case ASSIGN:
     case ASSPLUS:
     case ASSMINUS:
@@ -1755,89 +2010,105 @@ void expression_t::collectPossibleWrites(set<symbol_t>& symbols) const
     case POSTINCREMENT:
     case POSTDECREMENT:
     case PREINCREMENT:
-    case PREDECREMENT: get(0).getSymbols(symbols); break;
+    case PREDECREMENT: get(0).getSymbols(written); break;
 
     case EFUNCALL:
-    case FUNCALL:
-        // Add all symbols which are changed by the function
-        symbol = get(0).getSymbol();
+    case FUNCALL: {
+        // Add the function, whose changes (and dependencies) are added when used
+        auto symbol = get(0).getSymbol();
         if ((symbol.getType().isFunction() || symbol.getType().isExternalFunction()) && symbol.getData()) {
-            fun = (function_t*)symbol.getData();
-
-            symbols.insert(fun->changes.begin(), fun->changes.end());
+            const auto* fun = static_cast<const function_t*>(symbol.getData());
+            footprint.writeCalls.push_back(fun);
+            if (getKind() == FUNCALL)
+                footprint.readCalls.push_back(fun);
 
             // Add arguments to non-constant reference parameters
-            type = fun->uid.getType();
+            auto type = fun->uid.getType();
             for (uint32_t i = 1; i < min(getSize(), type.size()); i++) {
                 if (type[i].is(REF) && !type[i].isConstant()) {
-                    get(i).getSymbols(symbols);
+                    get(i).getSymbols(written);
                 }
             }
         }
         break;
-
+    }
     default: break;
     }
+    footprint.writes.insert(footprint.writes.end(), written.begin(), written.end());
 }
 
-void expression_t::collectPossibleReads(set<symbol_t>& symbols, bool collectRandom) const
+void expression_t::discardCaches()
 {
-    if (empty()) {
-        return;
-    }
+    // Most nodes changed have no caches, thus a load avoids writing the shared cache line
+    if (data->footprint.load(std::memory_order_relaxed) != nullptr)
+        if (const auto* cached = data->footprint.exchange(nullptr, std::memory_order_acq_rel); cached != &noFootprint)
+            delete cached;
+    if (data->text.load(std::memory_order_relaxed) != nullptr)
+        delete data->text.exchange(nullptr, std::memory_order_acq_rel);
+}
 
-    for (uint32_t i = 0; i < getSize(); i++) {
-        get(i).collectPossibleReads(symbols);
-    }
+void expression_t::collectPossibleWrites(set<symbol_t>& symbols) const
+{
+    const auto& footprint = getFootprint();
+    symbols.insert(footprint.writes.begin(), footprint.writes.end());
+    for (const auto* fun : footprint.writeCalls)
+        symbols.insert(fun->changes.begin(), fun->changes.end());
+}
 
-    switch (getKind()) {
-    case IDENTIFIER: symbols.insert(getSymbol()); break;
+void expression_t::collectPossibleWrites(symbol_set_t& symbols) const
+{
+    const auto& footprint = getFootprint();
+    for (const auto& symbol : footprint.writes)
+        symbols.insert(symbol);
+    for (const auto* fun : footprint.writeCalls)
+        symbols |= fun->changeSet;
+}
 
-    case FUNCALL: {
-        // Add all symbols which are used by the function
-        auto symbol = get(0).getSymbol();
-        if (auto type = symbol.getType(); type.isFunction() || type.isExternalFunction()) {
-            if (auto* data = symbol.getData(); data) {
-                auto fun = static_cast<function_t*>(data);
-                symbols.insert(fun->depends.begin(), fun->depends.end());
-            }
-        }
-        break;
-    }
+/** Random draws of the expression itself (not of its subexpressions) count as reads. */
+static bool isRandomDraw(kind_t kind)
+{
+    switch (kind) {
     case RANDOM_F:
     case RANDOM_POISSON_F:
-        if (collectRandom) {
-            symbols.insert(symbol_t());  // TODO: revisit, should register the argument?
-        }
-        break;
     case RANDOM_ARCSINE_F:
     case RANDOM_BETA_F:
     case RANDOM_GAMMA_F:
     case RANDOM_NORMAL_F:
     case RANDOM_WEIBULL_F:
-        if (collectRandom) {
-            symbols.insert(symbol_t());  // TODO: revisit, should register the arguments?
-            symbols.insert(symbol_t());
-        }
-        break;
-
-    case RANDOM_TRI_F:
-        if (collectRandom) {
-            symbols.insert(symbol_t());  // TODO: revisit, should register the argument?
-            symbols.insert(symbol_t());
-            symbols.insert(symbol_t());
-        }
-        break;
-    default: break;
+    case RANDOM_TRI_F: return true;
+    default: return false;
     }
 }
 
+void expression_t::collectPossibleReads(set<symbol_t>& symbols, bool collectRandom) const
+{
+    const auto& footprint = getFootprint();
+    symbols.insert(footprint.reads.begin(), footprint.reads.end());
+    for (const auto* fun : footprint.readCalls)
+        symbols.insert(fun->depends.begin(), fun->depends.end());
+
+    if (collectRandom && !empty() && isRandomDraw(getKind()))
+        symbols.insert(symbol_t());  // TODO: revisit, should register the arguments?
+}
+
+void expression_t::collectPossibleReads(symbol_set_t& symbols, bool collectRandom) const
+{
+    const auto& footprint = getFootprint();
+    for (const auto& symbol : footprint.reads)
+        symbols.insert(symbol);
+    for (const auto* fun : footprint.readCalls)
+        symbols |= fun->dependSet;
+
+    if (collectRandom && !empty() && isRandomDraw(getKind()))
+        symbols.insert(symbol_t());
+}
+
 expression_t expression_t::createConstant(int32_t value, position_t pos)
 {
     expression_t expr(CONSTANT, pos);
     expr.data->value = value;
     expr.data->type = type_t::createPrimitive(Constants::INT);
-    return expr;
+    return intern(expr);
 }
 
 expression_t expression_t::createVarIndex(int32_t value, position_t pos)
@@ -1845,7 +2116,7 @@ expression_t expression_t::createVarIndex(int32_t value, position_t pos)
     expression_t expr(VARINDEX, pos);
     expr.data->value = value;
     expr.data->type = type_t::createPrimitive(Constants::INT);
-    return expr;
+    return intern(expr);
 }
 
 expression_t expression_t::createExit(position_t pos)
@@ -1853,7 +2124,7 @@ expression_t expression_t::createExit(position_t pos)
     expression_t expr(EXIT, pos);
     expr.data->value = 0;
     expr.data->type = type_t::createPrimitive(Constants::VOID_TYPE);
-    return expr;
+    return intern(expr);
 }
 
 expression_t expression_t::createDouble(double value, position_t pos)
@@ -1861,7 +2132,7 @@ expression_t expression_t::createDouble(double value, position_t pos)
     expression_t expr(CONSTANT, pos);
     expr.data->doubleValue = value;
     expr.data->type = type_t::createPrimitive(Constants::DOUBLE);
-    return expr;
+    return intern(expr);
 }
 
 expression_t expression_t::createIdentifier(symbol_t symbol, position_t pos)
@@ -1873,7 +2144,7 @@ expression_t expression_t::createIdentifier(symbol_t symbol, position_t pos)
     } else {
         expr.data->type = type_t();
     }
-    return expr;
+    return intern(expr);
 }
 
 expression_t expression_t::createNary(kind_t kind, vector<expression_t> sub, position_t pos, type_t type)
@@ -1881,47 +2152,45 @@ expression_t expression_t::createNary(kind_t kind, vector<expression_t> sub, pos
     expression_t expr(kind, pos);
     expr.data->value = sub.size();
     expr.data->sub = std::move(sub);
-    expr.data->type = type;
-    return expr;
+    expr.data->type = std::move(type);
+    return intern(std::move(expr));
 }
 
 expression_t expression_t::createUnary(kind_t kind, expression_t sub, position_t pos, type_t type)
 {
     expression_t expr(kind, pos);
-    expr.data->sub.push_back(sub);
-    expr.data->type = type;
-    return expr;
+    expr.data->sub.push_back(std::move(sub));
+    expr.data->type = std::move(type);
+    return intern(std::move(expr));
 }
 
 expression_t expression_t::createBinary(kind_t kind, expression_t left, expression_t right, position_t pos, type_t type)
 {
     expression_t expr(kind, pos);
-    expr.data->sub.reserve(2);
-    expr.data->sub.push_back(left);
-    expr.data->sub.push_back(right);
-    expr.data->type = type;
-    return expr;
+    expr.data->sub.push_back(std::move(left));
+    expr.data->sub.push_back(std::move(right));
+    expr.data->type = std::move(type);
+    return intern(std::move(expr));
 }
 
 expression_t expression_t::createTernary(kind_t kind, expression_t e1, expression_t e2, expression_t e3, position_t pos,
                                          type_t type)
 {
     expression_t expr(kind, pos);
-    expr.data->sub.reserve(3);
-    expr.data->sub.push_back(e1);
-    expr.data->sub.push_back(e2);
-    expr.data->sub.push_back(e3);
-    expr.data->type = type;
-    return expr;
+    expr.data->sub.push_back(std::move(e1));
+    expr.data->sub.push_back(std::move(e2));
+    expr.data->sub.push_back(std::move(e3));
+    expr.data->type = std::move(type);
+    return intern(std::move(expr));
 }
 
 expression_t expression_t::createDot(expression_t e, int32_t idx, position_t pos, type_t type)
 {
     expression_t expr(DOT, pos);
     expr.data->index = idx;
-    expr.data->sub.push_back(e);
-    expr.data->type = type;
-    return expr;
+    expr.data->sub.push_back(std::move(e));
+    expr.data->type = std::move(type);
+    return intern(std::move(expr));
 }
 
 expression_t expression_t::createSync(expression_t e, synchronisation_t s, position_t pos)
@@ -1929,12 +2198,90 @@ expression_t expression_t::createSync(expression_t e, synchronisation_t s, posit
     expression_t expr(SYNC, pos);
     expr.data->sync = s;
     expr.data->sub.push_back(std::move(e));
-    return expr;
+    return intern(expr);
 }
 
 expression_t expression_t::createDeadlock(position_t pos)
 {
     expression_t expr(DEADLOCK, pos);
     expr.data->type = type_t::createPrimitive(CONSTRAINT);
+    return intern(expr);
+}
+
+expression_t expression_t::createNode(kind_t kind, position_t pos, int32_t value, double doubleValue, symbol_t symbol,
+                                      type_t type, vector<expression_t> sub)
+{
+    expression_t expr(kind, pos);
+    expr.data->value = value;
+    if (kind == CONSTANT && type.isDouble())
+        expr.data->doubleValue = doubleValue;
+    expr.data->symbol = std::move(symbol);
+    expr.data->type = std::move(type);
+    expr.data->sub = std::move(sub);
+    return expr;
+}
+
+int32_t expression_t::getRawValue() const
+{
+    assert(data && !(data->kind == CONSTANT && data->type.isDouble()));
+    return data->value;
+}
+
+expression_t expression_t::intern(expression_t expr)
+{
+    auto* table = ExpressionTable::current();
+    return table != nullptr ? table->intern(std::move(expr)) : expr;
+}
+
+static ExpressionTable*& activeTable()
+{
+    static thread_local ExpressionTable* table = nullptr;
+    return table;
+}
+
+ExpressionTable::Scope::Scope(ExpressionTable& table): previous{std::exchange(activeTable(), &table)} {}
+
+ExpressionTable::Scope::~Scope() noexcept { activeTable() = previous; }
+
+ExpressionTable* ExpressionTable::current() { return activeTable(); }
+
+expression_t ExpressionTable::intern(expression_t expr)
+{
+    if (expr.empty() || expr.data->table == this) {
+        return expr;
+    }
+
+    // Children are interned first so that nodes can be compared by the identity of their children.
+    auto cloned = false;
+    for (size_t i = 0; i < expr.data->sub.size(); ++i) {
+        auto e = intern(expr.data->sub[i]);
+        if (e == expr.data->sub[i])
+            continue;
+        if (!std::exchange(cloned, true))
+            expr = expr.clone();
+        expr.data->sub[i] = std::move(e);
+    }
+
+    const auto& data = *expr.data;
+    const bool isDouble = data.kind == CONSTANT && data.type.isDouble();
+    auto hash = std::hash<int>{}(data.kind);
+    auto combine = [&hash](size_t h) { hash ^= h + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+    combine(isDouble ? std::hash<double>{}(data.doubleValue) : std::hash<int32_t>{}(data.value));
+    combine(std::hash<symbol_t>{}(data.symbol));
+    combine(isPrimitive(data.type) ? std::hash<int>{}(data.type.getKind()) : std::hash<type_t>{}(data.type));
+    for (const auto& e : data.sub)
+        combine(std::hash<const void*>{}(e.data.get()));
+
+    auto [first, last] = nodes.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        const auto& other = *it->second.data;
+        if (other.kind == data.kind && sameType(other.type, data.type) &&
+            (isDouble ? other.doubleValue == data.doubleValue : other.value == data.value) &&
+            other.symbol == data.symbol && other.sub == data.sub) {
+            return it->second;
+        }
+    }
+    expr.data->table = this;
+    nodes.emplace(hash, expr);
     return expr;
 }
@@ -0,0 +1,72 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/flatexpression.h"
+
+#include <utility>
+
+using namespace UTAP;
+using namespace Constants;
+
+static int32_t valueOf(const expression_t& expr)
+{
+    switch (expr.getKind()) {
+    case CONSTANT: return expr.getType().isDouble() ? 0 : expr.getValue();
+    case DOT: return expr.getIndex();
+    case SYNC: return expr.getSync();
+    default: return 0;
+    }
+}
+
+uint32_t flat_expression_t::add(const expression_t& expr)
+{
+    // Iterative, as expressions such as long comma lists can be deep
+    struct pending_t
+    {
+        expression_t expr;
+        uint32_t next;
+    };
+    auto stack = std::vector<pending_t>{{expr, 0}};
+    auto done = std::vector<uint32_t>{};  // roots of the finished subtrees of the pending nodes
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        const auto arity = top.expr.empty() ? 0 : top.expr.getSize();
+        if (top.next < arity) {
+            auto child = std::as_const(top.expr)[top.next++];
+            stack.push_back({std::move(child), 0});
+            continue;
+        }
+        const auto node = size();
+        const auto& e = top.expr;
+        kinds.push_back(e.empty() ? UNKNOWN : e.getKind());
+        values.push_back(e.empty() ? 0 : valueOf(e));
+        symbolIds.push_back(!e.empty() && e.getKind() == IDENTIFIER ? e.getSymbol().getId() : 0);
+        first.push_back(arity > 0 ? first[done[done.size() - arity]] : node);
+        children.insert(children.end(), done.end() - arity, done.end());
+        childStart.push_back(static_cast<uint32_t>(children.size()));
+        nodes.push_back(e);
+        done.resize(done.size() - arity);
+        done.push_back(node);
+        stack.pop_back();
+    }
+    roots.push_back(done.back());
+    return done.back();
+}
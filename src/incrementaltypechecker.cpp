@@ -0,0 +1,319 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/incrementaltypechecker.h"
+
+#include "utap/typechecker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace UTAP;
+
+IncrementalTypeChecker::IncrementalTypeChecker(Document& doc, bool refinement):
+    doc{doc}, refinement{refinement}, errors{doc.getErrors()}, warnings{doc.getWarnings()},
+    publishedErrors{errors.size()}, publishedWarnings{warnings.size()}
+{}
+
+/** Returns the units of the document in the order Document::accept visits them. */
+std::vector<IncrementalTypeChecker::unit_t> IncrementalTypeChecker::layout() const
+{
+    auto res = std::vector<unit_t>{};
+    const auto& global = doc.getGlobals().frame;
+    for (const auto& symbol : global)
+        res.push_back({DECLARATION, symbol, nullptr});
+    for (auto& templ : doc.getTemplates())
+        res.push_back({TEMPLATE, templ.uid, &templ});
+    for (auto* templ : doc.getDynamicTemplates())
+        res.push_back({TEMPLATE, templ->uid, templ});
+    for (const auto& symbol : global)
+        res.push_back({INSTANCE, symbol, nullptr});
+    res.push_back({SYSTEM, symbol_t{}, nullptr});
+    return res;
+}
+
+bool IncrementalTypeChecker::sameLayout() const
+{
+    const auto current = layout();
+    return std::equal(current.begin(), current.end(), units.begin(), units.end(), [](const auto& a, const auto& b) {
+        return a.kind == b.kind && a.symbol == b.symbol && a.templ == b.templ;
+    });
+}
+
+/**
+ * Brings the compile time computable values up to date with the dirty
+ * units.  An \a invalidated constant may no longer be one, so then, or when
+ * the layout changed, the values are collected from the whole document.
+ * Otherwise the dirty units only add the constants they declare.
+ */
+void IncrementalTypeChecker::collect(const std::set<symbol_t>& invalidated)
+{
+    const auto stale = std::any_of(invalidated.begin(), invalidated.end(),
+                                   [this](const symbol_t& symbol) { return computable.contains(symbol); });
+    if (!collected || stale) {
+        computable = CompileTimeComputableValues{};
+        doc.accept(computable);
+        collected = true;
+        return;
+    }
+    for (auto& unit : units) {
+        if (!unit.dirty)
+            continue;
+        switch (unit.kind) {
+        case DECLARATION: Document::acceptDeclaration(computable, unit.symbol); break;
+        case TEMPLATE: Document::acceptTemplate(computable, *unit.templ); break;
+        case INSTANCE: Document::acceptInstance(computable, unit.symbol); break;
+        case SYSTEM: break;
+        }
+    }
+}
+
+void IncrementalTypeChecker::check(uint32_t threads)
+{
+    collected = false;
+    units = layout();
+    for (auto& unit : units)
+        unit.dirty = true;
+    recheck(threads);
+}
+
+void IncrementalTypeChecker::invalidate(symbol_t symbol)
+{
+    changed.insert(symbol);
+    for (auto& unit : units)
+        if (unit.symbol == symbol)
+            unit.dirty = true;
+}
+
+void IncrementalTypeChecker::invalidate(template_t& templ)
+{
+    for (auto& unit : units)
+        if (unit.templ == &templ)
+            unit.dirty = true;
+}
+
+void IncrementalTypeChecker::invalidateSystem()
+{
+    for (auto& unit : units)
+        if (unit.kind == SYSTEM)
+            unit.dirty = true;
+}
+
+/**
+ * Returns whether the diagnostics of a unit still hold when the kinds of
+ * synchronisation used before it are \a sync, and if so updates \a sync
+ * to the kinds used after it.  Checked after no synchronisation, a unit
+ * only differs from one checked after some if it synchronises and the
+ * first kind it uses is not the one used before, since the check is the
+ * same from the first synchronisation on.
+ */
+template <typename Unit>
+static bool holds(const Unit& unit, int& sync)
+{
+    if (unit.syncBefore == sync) {
+        sync = unit.syncAfter;
+        return true;
+    }
+    if (unit.syncBefore == 0 && unit.syncAfter == 0)
+        return true;
+    if (unit.syncBefore == 0 && unit.syncAfter == sync && sync != -1)
+        return true;
+    return false;
+}
+
+size_t IncrementalTypeChecker::recheck(uint32_t threads)
+{
+    if (!sameLayout()) {
+        collected = false;
+        units = layout();
+        for (auto& unit : units)
+            unit.dirty = true;
+    }
+
+    /* A unit is affected if it reads a symbol declared by an affected
+     * unit, since e.g. the side effects of a function or the constness
+     * of a variable may have changed.
+     */
+    auto affected = std::move(changed);
+    changed.clear();
+    for (const auto& unit : units)
+        if (unit.dirty && unit.symbol != symbol_t{})
+            affected.insert(unit.symbol);
+    collect(affected);
+    for (auto grown = true; grown;) {
+        grown = false;
+        for (auto& unit : units) {
+            if (unit.dirty)
+                continue;
+            const auto reads = std::any_of(unit.reads.begin(), unit.reads.end(),
+                                           [&](const symbol_t& symbol) { return affected.count(symbol) > 0; });
+            if (reads) {
+                unit.dirty = true;
+                if (unit.symbol != symbol_t{})
+                    grown |= affected.insert(unit.symbol).second;
+            }
+        }
+    }
+
+    doc.setDiagnostics({}, {});
+    auto checker = TypeChecker{doc, computable};
+    checker.refinementWarnings = refinement;
+    checker.checkExpression(doc.getBeforeUpdate());
+    checker.checkExpression(doc.getAfterUpdate());
+    prologueErrors = doc.getErrors();
+    prologueWarnings = doc.getWarnings();
+    doc.setDiagnostics({}, {});
+    checker.visitSystemBefore(&doc);
+
+    auto count = size_t{0};
+    auto sync = 0;
+    for (size_t i = 0; i < units.size(); ++i) {
+        auto& unit = units[i];
+        if (threads > 0 && unit.kind == TEMPLATE && (i == 0 || units[i - 1].kind != TEMPLATE))
+            count += runTemplates(checker, i, threads);
+        // The kinds of synchronisation used by earlier edges decide whether an edge mixes them.
+        if (unit.dirty || !holds(unit, sync)) {
+            run(checker, unit, sync);
+            ++count;
+        }
+    }
+    publish();
+    return count;
+}
+
+bool IncrementalTypeChecker::reparsed(const std::string& xpath)
+{
+    const auto inside = [&xpath](const error_t& diagnostic) {
+        const auto& path = diagnostic.start.path;
+        return path.compare(0, xpath.size(), xpath) == 0 && (path.size() == xpath.size() || path[xpath.size()] == '/');
+    };
+    const auto replace = [&inside](std::vector<error_t>& kept, const std::vector<error_t>& current, size_t published) {
+        kept.erase(std::remove_if(kept.begin(), kept.end(), inside), kept.end());
+        kept.insert(kept.end(), current.begin() + std::min(published, current.size()), current.end());
+    };
+    replace(errors, doc.getErrors(), publishedErrors);
+    replace(warnings, doc.getWarnings(), publishedWarnings);
+    if (errors.empty()) {
+        publish();
+        return true;
+    }
+    doc.setDiagnostics(errors, warnings);
+    publishedErrors = errors.size();
+    publishedWarnings = warnings.size();
+    return false;
+}
+
+void IncrementalTypeChecker::run(TypeChecker& checker, unit_t& unit, int& sync)
+{
+    unit.reads.clear();
+    unit.syncBefore = sync;
+    checker.reads = &unit.reads;
+    checker.syncUsed = sync;
+    switch (unit.kind) {
+    case DECLARATION: Document::acceptDeclaration(checker, unit.symbol); break;
+    case TEMPLATE: Document::acceptTemplate(checker, *unit.templ); break;
+    case INSTANCE: Document::acceptInstance(checker, unit.symbol); break;
+    case SYSTEM: doc.acceptSystem(checker); break;
+    }
+    checker.reads = nullptr;
+    sync = unit.syncAfter = checker.syncUsed;
+    unit.errors = doc.getErrors();
+    unit.warnings = doc.getWarnings();
+    unit.dirty = false;
+    doc.setDiagnostics({}, {});
+}
+
+/**
+ * Checks the dirty templates from units[first] on concurrently, as if no
+ * synchronisation was used before them, and returns the number checked.
+ * The bounds of the ranges of global type definitions, which several
+ * templates may use, are checked once up front.
+ */
+size_t IncrementalTypeChecker::runTemplates(const TypeChecker& checker, size_t first, uint32_t threads)
+{
+    auto pending = std::vector<unit_t*>{};
+    for (auto i = first; i < units.size() && units[i].kind == TEMPLATE; ++i)
+        if (units[i].dirty)
+            pending.push_back(&units[i]);
+    if (pending.size() < 2 || doc.isLocal())
+        return 0;
+
+    auto ranges = TypeChecker::range_checks_t{};
+    auto ignored = TypeChecker::diagnostics_t{};
+    auto recorder = checker;
+    recorder.reads = nullptr;
+    recorder.diagnostics = &ignored;
+    recorder.sharedRanges = &ranges;
+    recorder.recordRanges = true;
+    for (const auto& symbol : doc.getGlobals().frame)
+        if (symbol.getType().getKind() == Constants::TYPEDEF)
+            recorder.checkType(symbol.getType()[0]);
+
+    auto found = std::vector<TypeChecker::diagnostics_t>(pending.size());
+    auto runOne = [&](size_t i) {
+        auto& unit = *pending[i];
+        auto worker = checker;
+        unit.reads.clear();
+        worker.reads = &unit.reads;
+        worker.diagnostics = &found[i];
+        worker.sharedRanges = &ranges;
+        worker.syncUsed = 0;
+        Document::acceptTemplate(worker, *unit.templ);
+        unit.syncBefore = 0;
+        unit.syncAfter = worker.syncUsed;
+    };
+    threads = std::min<size_t>(threads, pending.size());
+    auto next = std::atomic<size_t>{0};
+    auto workers = std::vector<std::thread>{};
+    for (uint32_t i = 0; i < threads; ++i)
+        workers.emplace_back([&] {
+            for (auto p = next++; p < pending.size(); p = next++)
+                runOne(p);
+        });
+    for (auto& worker : workers)
+        worker.join();
+
+    for (size_t i = 0; i < pending.size(); ++i) {
+        auto& unit = *pending[i];
+        unit.errors = std::move(found[i].errors);
+        unit.warnings = std::move(found[i].warnings);
+        unit.dirty = false;
+        for (auto feature : found[i].features)
+            (doc.*feature)();
+    }
+    return pending.size();
+}
+
+void IncrementalTypeChecker::publish()
+{
+    auto allErrors = errors;
+    auto allWarnings = warnings;
+    allErrors.insert(allErrors.end(), prologueErrors.begin(), prologueErrors.end());
+    allWarnings.insert(allWarnings.end(), prologueWarnings.begin(), prologueWarnings.end());
+    for (const auto& unit : units) {
+        allErrors.insert(allErrors.end(), unit.errors.begin(), unit.errors.end());
+        allWarnings.insert(allWarnings.end(), unit.warnings.begin(), unit.warnings.end());
+    }
+    publishedErrors = allErrors.size();
+    publishedWarnings = allWarnings.size();
+    doc.setDiagnostics(std::move(allErrors), std::move(allWarnings));
+}
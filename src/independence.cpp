@@ -0,0 +1,151 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/independence.h"
+
+#include "utap/document.h"
+
+using namespace UTAP;
+using namespace Constants;
+
+namespace
+{
+    /** Adds the channel synchronised on, the whole array for an element, or all it reads if it is computed. */
+    void addChannel(expression_t channel, symbol_set_t& channels)
+    {
+        while (channel.getKind() == ARRAY || channel.getKind() == DOT)
+            channel = channel[0];
+        if (channel.getKind() == IDENTIFIER)
+            channels.insert(channel.getSymbol());
+        else
+            channel.collectPossibleReads(channels);
+    }
+
+    /** The edges accessing a symbol, by symbol identifier. */
+    struct accesses_t
+    {
+        std::vector<std::vector<uint32_t>> edges;
+
+        void add(const symbol_set_t& symbols, uint32_t edge)
+        {
+            symbols.forEachId([&](uint32_t id) {
+                if (id >= edges.size())
+                    edges.resize(id + 1);
+                edges[id].push_back(edge);
+            });
+        }
+        const std::vector<uint32_t>& operator[](uint32_t id) const
+        {
+            static const auto none = std::vector<uint32_t>{};
+            return id < edges.size() ? edges[id] : none;
+        }
+    };
+}  // namespace
+
+Independence::Independence(Document& doc)
+{
+    auto globals = symbol_set_t{};
+    const auto& frame = doc.getGlobals().frame;
+    for (uint32_t i = 0; i < frame.getSize(); ++i)
+        globals.insert(frame[i]);
+
+    auto processNr = uint32_t{0};
+    for (const auto& process : doc.getProcesses()) {
+        for (const auto& edge : process.templ->edges) {
+            auto& ref = edges.emplace_back(edge_ref_t{&process, &edge, processNr, {}, {}, {}});
+            const auto assign = process.instantiate(edge.assign);
+            process.instantiate(edge.guard).collectPossibleReads(ref.reads);
+            assign.collectPossibleReads(ref.reads);
+            assign.collectPossibleWrites(ref.writes);
+            if (edge.dst != nullptr)
+                process.instantiate(edge.dst->invariant).collectPossibleReads(ref.reads);
+            if (const auto sync = process.instantiate(edge.sync); !sync.empty() && sync.getKind() == SYNC) {
+                sync.collectPossibleReads(ref.reads);
+                addChannel(sync[0], ref.channels);
+            }
+            ref.reads &= globals;
+            ref.writes &= globals;
+            ref.channels &= globals;
+            index.emplace(std::make_pair(&process, &edge), static_cast<uint32_t>(edges.size() - 1));
+        }
+        ++processNr;
+    }
+
+    const auto count = static_cast<uint32_t>(edges.size());
+    dependent.assign((pairOf(count, 0) + 63) / 64, 0);
+    auto writers = accesses_t{};
+    auto accessors = accesses_t{};
+    auto synchronisers = accesses_t{};
+    for (uint32_t e = 0; e < count; ++e) {
+        writers.add(edges[e].writes, e);
+        accessors.add(edges[e].reads, e);
+        accessors.add(edges[e].writes, e);
+        synchronisers.add(edges[e].channels, e);
+    }
+    for (uint32_t first = 0; first < count;) {
+        auto last = first;
+        while (last < count && edges[last].processNr == edges[first].processNr)
+            ++last;
+        for (auto a = first; a < last; ++a)
+            for (auto b = first; b < a; ++b)
+                markDependent(a, b);
+        first = last;
+    }
+    for (uint32_t id = 0; id < writers.edges.size(); ++id)
+        for (auto w : writers[id])
+            for (auto a : accessors[id])
+                markDependent(w, a);
+    for (const auto& sharing : synchronisers.edges)
+        for (auto a : sharing)
+            for (auto b : sharing)
+                markDependent(a, b);
+}
+
+void Independence::markDependent(uint32_t a, uint32_t b)
+{
+    if (a == b)
+        return;
+    const auto bit = a < b ? pairOf(b, a) : pairOf(a, b);
+    dependent[bit / 64] |= uint64_t{1} << bit % 64;
+}
+
+uint32_t Independence::getEdgeNr(const instance_t& process, const edge_t& edge) const
+{
+    auto it = index.find({&process, &edge});
+    return it != index.end() ? it->second : static_cast<uint32_t>(edges.size());
+}
+
+std::vector<uint32_t> Independence::getDependent(uint32_t edge) const
+{
+    auto result = std::vector<uint32_t>{};
+    for (uint32_t e = 0; e < edges.size(); ++e)
+        if (e != edge && !isIndependent(edge, e))
+            result.push_back(e);
+    return result;
+}
+
+size_t Independence::getDependentPairs() const
+{
+    auto pairs = size_t{0};
+    for (auto word : dependent)
+        pairs += __builtin_popcountll(word);
+    return pairs;
+}
@@ -2,170 +2,293 @@
 
 #include "parser.hpp"  // all the tokens
 
-#include <string>
-#include <unordered_map>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
 namespace UTAP
 {
-    // clang-format off
-    static const auto keyword_map = std::unordered_map<std::string_view, const Keyword>{
-            {"const",         Keyword{T_CONST, syntax_t::OLD_NEW}},
-            {"select",        Keyword{T_SELECT, syntax_t::NEW}},
-            {"guard",         Keyword{T_GUARD, syntax_t::OLD_NEW}},
-            {"sync",          Keyword{T_SYNC, syntax_t::OLD_NEW}},
-            {"assign",        Keyword{T_ASSIGN, syntax_t::OLD_NEW}},
-            {"probability",   Keyword{T_PROBABILITY, syntax_t::OLD_NEW}},
-            {"process",       Keyword{T_PROCESS, syntax_t::OLD_NEW}},
-            {"state",         Keyword{T_STATE, syntax_t::OLD_NEW}},
-            {"branchpoint",   Keyword{T_BRANCHPOINT, syntax_t::OLD_NEW}},
-            {"init",          Keyword{T_INIT, syntax_t::OLD_NEW}},
-            {"trans",         Keyword{T_TRANS, syntax_t::OLD_NEW}},
-            {"urgent",        Keyword{T_URGENT, syntax_t::OLD_NEW}},
-            {"commit",        Keyword{T_COMMIT, syntax_t::OLD_NEW}},
-            {"broadcast",     Keyword{T_BROADCAST, syntax_t::OLD_NEW}},
-            {"system",        Keyword{T_SYSTEM, syntax_t::OLD_NEW_PROPERTY}},
-            {"true",          Keyword{T_TRUE, syntax_t::OLD_NEW_PROPERTY}},
-            {"false",         Keyword{T_FALSE, syntax_t::OLD_NEW_PROPERTY}},
-            {"and",           Keyword{T_KW_AND, syntax_t::OLD_NEW_PROPERTY}},
-            {"or",            Keyword{T_KW_OR, syntax_t::OLD_NEW_PROPERTY}},
-            {"xor",           Keyword{T_KW_XOR, syntax_t::NEW}},
-            {"not",           Keyword{T_KW_NOT, syntax_t::OLD_NEW_PROPERTY}},
-            {"imply",         Keyword{T_KW_IMPLY, syntax_t::OLD_NEW_PROPERTY}},
-            {"for",           Keyword{T_FOR, syntax_t::NEW}},
-            {"while",         Keyword{T_WHILE, syntax_t::NEW}},
-            {"do",            Keyword{T_DO, syntax_t::NEW}},
-            {"if",            Keyword{T_IF, syntax_t::NEW}},
-            {"else",          Keyword{T_ELSE, syntax_t::NEW}},
-            {"default",       Keyword{T_DEFAULT, syntax_t::NEW}},
-            {"return",        Keyword{T_RETURN, syntax_t::NEW}},
-            {"typedef",       Keyword{T_TYPEDEF, syntax_t::NEW}},
-            {"struct",        Keyword{T_STRUCT, syntax_t::NEW}},
-            {"import",        Keyword{T_IMPORT, syntax_t::NEW}},
-            {"meta",          Keyword{T_META, syntax_t::NEW}},
-            {"before_update", Keyword{T_BEFORE, syntax_t::NEW}},
-            {"after_update",  Keyword{T_AFTER, syntax_t::NEW}},
-            {"progress",      Keyword{T_PROGRESS, syntax_t::NEW}},
-            {"gantt",         Keyword{T_GANTT, syntax_t::NEW}},
-            {"assert",        Keyword{T_ASSERT, syntax_t::NEW}},
-            {"IO",            Keyword{T_IO, syntax_t::NEW}},
-            {"forall",        Keyword{T_FORALL, syntax_t::NEW_PROPERTY}},
-            {"exists",        Keyword{T_EXISTS, syntax_t::NEW_PROPERTY}},
-            {"sum",           Keyword{T_SUM, syntax_t::NEW_PROPERTY}},
-            {"deadlock",      Keyword{T_DEADLOCK, syntax_t::PROPERTY}},
-            {"priority",      Keyword{T_PRIORITY, syntax_t::OLD_NEW}},
-            {"bool",          Keyword{T_BOOL, syntax_t::OLD_NEW}},
-            {"int",           Keyword{T_INT, syntax_t::OLD_NEW_PROPERTY}},
-            {"double",        Keyword{T_DOUBLE, syntax_t::OLD_NEW}},
-            {"string",        Keyword{T_STRING, syntax_t::NEW}},
-            {"chan",          Keyword{T_CHAN, syntax_t::OLD_NEW}},
-            {"clock",         Keyword{T_CLOCK, syntax_t::OLD_NEW}},
-            {"void",          Keyword{T_VOID, syntax_t::OLD_NEW}},
-            {"scalar",        Keyword{T_SCALAR, syntax_t::OLD_NEW_PROPERTY}},
-            {"control",       Keyword{T_CONTROL, syntax_t::PROPERTY_TIGA}},
-            {"control_t",     Keyword{T_CONTROL_T, syntax_t::PROPERTY_TIGA}},
-            {"simulation",    Keyword{T_SIMULATION, syntax_t::PROPERTY_TIGA}},
-            {"minE",          Keyword{T_MINEXP, syntax_t::PROPERTY_TIGA}},
-            {"loadStrategy",  Keyword{T_LOAD_STRAT, syntax_t::PROPERTY_TIGA}},
-            {"saveStrategy",  Keyword{T_SAVE_STRAT, syntax_t::PROPERTY_TIGA}},
-            {"maxE",          Keyword{T_MAXEXP, syntax_t::PROPERTY_TIGA}},
-            {"minPr",         Keyword{T_MINPR, syntax_t::PROPERTY_TIGA}},
-            {"maxPr",         Keyword{T_MAXPR, syntax_t::PROPERTY_TIGA}},
-            {"under",         Keyword{T_SUBJECT, syntax_t::PROPERTY_TIGA}},
-            {"imitate",       Keyword{T_IMITATE, syntax_t::PROPERTY_TIGA}},
-            {"strategy",      Keyword{T_STRATEGY, syntax_t::PROPERTY_TIGA}},
-            {"simulate",      Keyword{T_SIMULATE, syntax_t::PROPERTY}},
-            {"sat",           Keyword{T_SCENARIO, syntax_t::PROPERTY}},
-            {"inf",           Keyword{T_INF, syntax_t::PROPERTY}},
-            {"sup",           Keyword{T_SUP, syntax_t::PROPERTY}},
-            {"Pmax",          Keyword{T_PMAX, syntax_t::PROPERTY_PROB}},
-            {"Pr",            Keyword{T_PROBA, syntax_t::PROPERTY}},
-            {"X",             Keyword{T_MITL_NEXT, syntax_t::PROPERTY}},
-            {"abs",           Keyword{T_ABS, syntax_t::NEW_PROPERTY}},
-            {"fabs",          Keyword{T_FABS, syntax_t::NEW_PROPERTY}},
-            {"fmod",          Keyword{T_FMOD, syntax_t::NEW_PROPERTY}},
-            {"fma",           Keyword{T_FMA, syntax_t::NEW_PROPERTY}},
-            {"fmax",          Keyword{T_FMAX, syntax_t::NEW_PROPERTY}},
-            {"fmin",          Keyword{T_FMIN, syntax_t::NEW_PROPERTY}},
-            {"fdim",          Keyword{T_FDIM, syntax_t::NEW_PROPERTY}},
-            {"exp",           Keyword{T_EXP, syntax_t::NEW_PROPERTY}},
-            {"exp2",          Keyword{T_EXP2, syntax_t::NEW_PROPERTY}},
-            {"expm1",         Keyword{T_EXPM1, syntax_t::NEW_PROPERTY}},
-            {"ln",            Keyword{T_LN, syntax_t::NEW_PROPERTY}},
-            {"log",           Keyword{T_LOG, syntax_t::NEW_PROPERTY}},
-            {"log10",         Keyword{T_LOG10, syntax_t::NEW_PROPERTY}},
-            {"log2",          Keyword{T_LOG2, syntax_t::NEW_PROPERTY}},
-            {"log1p",         Keyword{T_LOG1P, syntax_t::NEW_PROPERTY}},
-            {"pow",           Keyword{T_POW, syntax_t::NEW_PROPERTY}},
-            {"sqrt",          Keyword{T_SQRT, syntax_t::NEW_PROPERTY}},
-            {"cbrt",          Keyword{T_CBRT, syntax_t::NEW_PROPERTY}},
-            {"hypot",         Keyword{T_HYPOT, syntax_t::NEW_PROPERTY}},
-            {"sin",           Keyword{T_SIN, syntax_t::NEW_PROPERTY}},
-            {"cos",           Keyword{T_COS, syntax_t::NEW_PROPERTY}},
-            {"tan",           Keyword{T_TAN, syntax_t::NEW_PROPERTY}},
-            {"asin",          Keyword{T_ASIN, syntax_t::NEW_PROPERTY}},
-            {"acos",          Keyword{T_ACOS, syntax_t::NEW_PROPERTY}},
-            {"atan",          Keyword{T_ATAN, syntax_t::NEW_PROPERTY}},
-            {"atan2",         Keyword{T_ATAN2, syntax_t::NEW_PROPERTY}},
-            {"sinh",          Keyword{T_SINH, syntax_t::NEW_PROPERTY}},
-            {"cosh",          Keyword{T_COSH, syntax_t::NEW_PROPERTY}},
-            {"tanh",          Keyword{T_TANH, syntax_t::NEW_PROPERTY}},
-            {"asinh",         Keyword{T_ASINH, syntax_t::NEW_PROPERTY}},
-            {"acosh",         Keyword{T_ACOSH, syntax_t::NEW_PROPERTY}},
-            {"atanh",         Keyword{T_ATANH, syntax_t::NEW_PROPERTY}},
-            {"erf",           Keyword{T_ERF, syntax_t::NEW_PROPERTY}},
-            {"erfc",          Keyword{T_ERFC, syntax_t::NEW_PROPERTY}},
-            {"tgamma",        Keyword{T_TGAMMA, syntax_t::NEW_PROPERTY}},
-            {"lgamma",        Keyword{T_LGAMMA, syntax_t::NEW_PROPERTY}},
-            {"ceil",          Keyword{T_CEIL, syntax_t::NEW_PROPERTY}},
-            {"floor",         Keyword{T_FLOOR, syntax_t::NEW_PROPERTY}},
-            {"trunc",         Keyword{T_TRUNC, syntax_t::NEW_PROPERTY}},
-            {"round",         Keyword{T_ROUND, syntax_t::NEW_PROPERTY}},
-            {"fint",          Keyword{T_FINT, syntax_t::NEW_PROPERTY}},
-            {"ldexp",         Keyword{T_LDEXP, syntax_t::NEW_PROPERTY}},
-            {"ilogb",         Keyword{T_ILOGB, syntax_t::NEW_PROPERTY}},
-            {"logb",          Keyword{T_LOGB, syntax_t::NEW_PROPERTY}},
-            {"nextafter",     Keyword{T_NEXTAFTER, syntax_t::NEW_PROPERTY}},
-            {"copysign",      Keyword{T_COPYSIGN, syntax_t::NEW_PROPERTY}},
-            {"fpclassify",    Keyword{T_FPCLASSIFY, syntax_t::NEW_PROPERTY}},
-            {"isfinite",      Keyword{T_ISFINITE, syntax_t::NEW_PROPERTY}},
-            {"isinf",         Keyword{T_ISINF, syntax_t::NEW_PROPERTY}},
-            {"isnan",         Keyword{T_ISNAN, syntax_t::NEW_PROPERTY}},
-            {"isnormal",      Keyword{T_ISNORMAL, syntax_t::NEW_PROPERTY}},
-            {"signbit",       Keyword{T_SIGNBIT, syntax_t::NEW_PROPERTY}},
-            {"isunordered",   Keyword{T_ISUNORDERED, syntax_t::NEW_PROPERTY}},
-            {"random",        Keyword{T_RANDOM, syntax_t::NEW_PROPERTY}},
-			{"random_arcsine",Keyword{T_RANDOM_ARCSINE, syntax_t::NEW_PROPERTY}},
-			{"random_beta",   Keyword{T_RANDOM_BETA, syntax_t::NEW_PROPERTY}},
-			{"random_gamma",  Keyword{T_RANDOM_GAMMA, syntax_t::NEW_PROPERTY}},
-			{"random_normal", Keyword{T_RANDOM_NORMAL, syntax_t::NEW_PROPERTY}},
-			{"random_poisson",Keyword{T_RANDOM_POISSON, syntax_t::NEW_PROPERTY}},
-			{"random_tri",    Keyword{T_RANDOM_TRI, syntax_t::NEW_PROPERTY}},
-			{"random_weibull",Keyword{T_RANDOM_WEIBULL, syntax_t::NEW_PROPERTY}},
-            {"hybrid",        Keyword{T_HYBRID, syntax_t::NEW}},
-            {"dynamic",       Keyword{T_DYNAMIC, syntax_t::NEW}},
-            {"spawn",         Keyword{T_SPAWN, syntax_t::NEW}},
-            {"exit",          Keyword{T_EXIT, syntax_t::NEW}},
-            {"numOf",         Keyword{T_NUMOF, syntax_t::PROPERTY}},
-            {"foreach",       Keyword{T_FOREACH, syntax_t::PROPERTY}},
-            {"query",         Keyword{T_QUERY, syntax_t::NEW}},
-            {"location",      Keyword{T_LOCATION, syntax_t::NEW}},
-    };
-    // clang-format on
+    namespace
+    {
+        struct entry_t
+        {
+            std::string_view word;
+            Keyword keyword;
+        };
+
+        /** Returns the syntax in which the lexer accepts a keyword: none for the probabilistic ones unless enabled. */
+        constexpr syntax_t accepted(syntax_t syntax)
+        {
+#ifndef ENABLE_PROB
+            if (syntax & syntax_t::PROB)
+                return syntax_t::NONE;
+#endif
+            return syntax;
+        }
+
+        // clang-format off
+        constexpr entry_t keywords[] = {
+            {"const",          Keyword{T_CONST, accepted(syntax_t::OLD_NEW)}},
+            {"select",         Keyword{T_SELECT, accepted(syntax_t::NEW)}},
+            {"guard",          Keyword{T_GUARD, accepted(syntax_t::OLD_NEW)}},
+            {"sync",           Keyword{T_SYNC, accepted(syntax_t::OLD_NEW)}},
+            {"assign",         Keyword{T_ASSIGN, accepted(syntax_t::OLD_NEW)}},
+            {"probability",    Keyword{T_PROBABILITY, accepted(syntax_t::OLD_NEW)}},
+            {"process",        Keyword{T_PROCESS, accepted(syntax_t::OLD_NEW)}},
+            {"state",          Keyword{T_STATE, accepted(syntax_t::OLD_NEW)}},
+            {"branchpoint",    Keyword{T_BRANCHPOINT, accepted(syntax_t::OLD_NEW)}},
+            {"init",           Keyword{T_INIT, accepted(syntax_t::OLD_NEW)}},
+            {"trans",          Keyword{T_TRANS, accepted(syntax_t::OLD_NEW)}},
+            {"urgent",         Keyword{T_URGENT, accepted(syntax_t::OLD_NEW)}},
+            {"commit",         Keyword{T_COMMIT, accepted(syntax_t::OLD_NEW)}},
+            {"broadcast",      Keyword{T_BROADCAST, accepted(syntax_t::OLD_NEW)}},
+            {"system",         Keyword{T_SYSTEM, accepted(syntax_t::OLD_NEW_PROPERTY)}},
+            {"true",           Keyword{T_TRUE, accepted(syntax_t::OLD_NEW_PROPERTY)}},
+            {"false",          Keyword{T_FALSE, accepted(syntax_t::OLD_NEW_PROPERTY)}},
+            {"and",            Keyword{T_KW_AND, accepted(syntax_t::OLD_NEW_PROPERTY)}},
+            {"or",             Keyword{T_KW_OR, accepted(syntax_t::OLD_NEW_PROPERTY)}},
+            {"xor",            Keyword{T_KW_XOR, accepted(syntax_t::NEW)}},
+            {"not",            Keyword{T_KW_NOT, accepted(syntax_t::OLD_NEW_PROPERTY)}},
+            {"imply",          Keyword{T_KW_IMPLY, accepted(syntax_t::OLD_NEW_PROPERTY)}},
+            {"for",            Keyword{T_FOR, accepted(syntax_t::NEW)}},
+            {"while",          Keyword{T_WHILE, accepted(syntax_t::NEW)}},
+            {"do",             Keyword{T_DO, accepted(syntax_t::NEW)}},
+            {"if",             Keyword{T_IF, accepted(syntax_t::NEW)}},
+            {"else",           Keyword{T_ELSE, accepted(syntax_t::NEW)}},
+            {"default",        Keyword{T_DEFAULT, accepted(syntax_t::NEW)}},
+            {"return",         Keyword{T_RETURN, accepted(syntax_t::NEW)}},
+            {"typedef",        Keyword{T_TYPEDEF, accepted(syntax_t::NEW)}},
+            {"struct",         Keyword{T_STRUCT, accepted(syntax_t::NEW)}},
+            {"import",         Keyword{T_IMPORT, accepted(syntax_t::NEW)}},
+            {"meta",           Keyword{T_META, accepted(syntax_t::NEW)}},
+            {"before_update",  Keyword{T_BEFORE, accepted(syntax_t::NEW)}},
+            {"after_update",   Keyword{T_AFTER, accepted(syntax_t::NEW)}},
+            {"progress",       Keyword{T_PROGRESS, accepted(syntax_t::NEW)}},
+            {"gantt",          Keyword{T_GANTT, accepted(syntax_t::NEW)}},
+            {"assert",         Keyword{T_ASSERT, accepted(syntax_t::NEW)}},
+            {"IO",             Keyword{T_IO, accepted(syntax_t::NEW)}},
+            {"forall",         Keyword{T_FORALL, accepted(syntax_t::NEW_PROPERTY)}},
+            {"exists",         Keyword{T_EXISTS, accepted(syntax_t::NEW_PROPERTY)}},
+            {"sum",            Keyword{T_SUM, accepted(syntax_t::NEW_PROPERTY)}},
+            {"deadlock",       Keyword{T_DEADLOCK, accepted(syntax_t::PROPERTY)}},
+            {"priority",       Keyword{T_PRIORITY, accepted(syntax_t::OLD_NEW)}},
+            {"bool",           Keyword{T_BOOL, accepted(syntax_t::OLD_NEW)}},
+            {"int",            Keyword{T_INT, accepted(syntax_t::OLD_NEW_PROPERTY)}},
+            {"double",         Keyword{T_DOUBLE, accepted(syntax_t::OLD_NEW)}},
+            {"string",         Keyword{T_STRING, accepted(syntax_t::NEW)}},
+            {"chan",           Keyword{T_CHAN, accepted(syntax_t::OLD_NEW)}},
+            {"clock",          Keyword{T_CLOCK, accepted(syntax_t::OLD_NEW)}},
+            {"void",           Keyword{T_VOID, accepted(syntax_t::OLD_NEW)}},
+            {"scalar",         Keyword{T_SCALAR, accepted(syntax_t::OLD_NEW_PROPERTY)}},
+            {"control",        Keyword{T_CONTROL, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"control_t",      Keyword{T_CONTROL_T, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"simulation",     Keyword{T_SIMULATION, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"minE",           Keyword{T_MINEXP, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"loadStrategy",   Keyword{T_LOAD_STRAT, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"saveStrategy",   Keyword{T_SAVE_STRAT, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"maxE",           Keyword{T_MAXEXP, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"minPr",          Keyword{T_MINPR, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"maxPr",          Keyword{T_MAXPR, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"under",          Keyword{T_SUBJECT, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"imitate",        Keyword{T_IMITATE, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"strategy",       Keyword{T_STRATEGY, accepted(syntax_t::PROPERTY_TIGA)}},
+            {"simulate",       Keyword{T_SIMULATE, accepted(syntax_t::PROPERTY)}},
+            {"sat",            Keyword{T_SCENARIO, accepted(syntax_t::PROPERTY)}},
+            {"inf",            Keyword{T_INF, accepted(syntax_t::PROPERTY)}},
+            {"sup",            Keyword{T_SUP, accepted(syntax_t::PROPERTY)}},
+            {"Pmax",           Keyword{T_PMAX, accepted(syntax_t::PROPERTY_PROB)}},
+            {"Pr",             Keyword{T_PROBA, accepted(syntax_t::PROPERTY)}},
+            {"X",              Keyword{T_MITL_NEXT, accepted(syntax_t::PROPERTY)}},
+            {"abs",            Keyword{T_ABS, accepted(syntax_t::NEW_PROPERTY)}},
+            {"fabs",           Keyword{T_FABS, accepted(syntax_t::NEW_PROPERTY)}},
+            {"fmod",           Keyword{T_FMOD, accepted(syntax_t::NEW_PROPERTY)}},
+            {"fma",            Keyword{T_FMA, accepted(syntax_t::NEW_PROPERTY)}},
+            {"fmax",           Keyword{T_FMAX, accepted(syntax_t::NEW_PROPERTY)}},
+            {"fmin",           Keyword{T_FMIN, accepted(syntax_t::NEW_PROPERTY)}},
+            {"fdim",           Keyword{T_FDIM, accepted(syntax_t::NEW_PROPERTY)}},
+            {"exp",            Keyword{T_EXP, accepted(syntax_t::NEW_PROPERTY)}},
+            {"exp2",           Keyword{T_EXP2, accepted(syntax_t::NEW_PROPERTY)}},
+            {"expm1",          Keyword{T_EXPM1, accepted(syntax_t::NEW_PROPERTY)}},
+            {"ln",             Keyword{T_LN, accepted(syntax_t::NEW_PROPERTY)}},
+            {"log",            Keyword{T_LOG, accepted(syntax_t::NEW_PROPERTY)}},
+            {"log10",          Keyword{T_LOG10, accepted(syntax_t::NEW_PROPERTY)}},
+            {"log2",           Keyword{T_LOG2, accepted(syntax_t::NEW_PROPERTY)}},
+            {"log1p",          Keyword{T_LOG1P, accepted(syntax_t::NEW_PROPERTY)}},
+            {"pow",            Keyword{T_POW, accepted(syntax_t::NEW_PROPERTY)}},
+            {"sqrt",           Keyword{T_SQRT, accepted(syntax_t::NEW_PROPERTY)}},
+            {"cbrt",           Keyword{T_CBRT, accepted(syntax_t::NEW_PROPERTY)}},
+            {"hypot",          Keyword{T_HYPOT, accepted(syntax_t::NEW_PROPERTY)}},
+            {"sin",            Keyword{T_SIN, accepted(syntax_t::NEW_PROPERTY)}},
+            {"cos",            Keyword{T_COS, accepted(syntax_t::NEW_PROPERTY)}},
+            {"tan",            Keyword{T_TAN, accepted(syntax_t::NEW_PROPERTY)}},
+            {"asin",           Keyword{T_ASIN, accepted(syntax_t::NEW_PROPERTY)}},
+            {"acos",           Keyword{T_ACOS, accepted(syntax_t::NEW_PROPERTY)}},
+            {"atan",           Keyword{T_ATAN, accepted(syntax_t::NEW_PROPERTY)}},
+            {"atan2",          Keyword{T_ATAN2, accepted(syntax_t::NEW_PROPERTY)}},
+            {"sinh",           Keyword{T_SINH, accepted(syntax_t::NEW_PROPERTY)}},
+            {"cosh",           Keyword{T_COSH, accepted(syntax_t::NEW_PROPERTY)}},
+            {"tanh",           Keyword{T_TANH, accepted(syntax_t::NEW_PROPERTY)}},
+            {"asinh",          Keyword{T_ASINH, accepted(syntax_t::NEW_PROPERTY)}},
+            {"acosh",          Keyword{T_ACOSH, accepted(syntax_t::NEW_PROPERTY)}},
+            {"atanh",          Keyword{T_ATANH, accepted(syntax_t::NEW_PROPERTY)}},
+            {"erf",            Keyword{T_ERF, accepted(syntax_t::NEW_PROPERTY)}},
+            {"erfc",           Keyword{T_ERFC, accepted(syntax_t::NEW_PROPERTY)}},
+            {"tgamma",         Keyword{T_TGAMMA, accepted(syntax_t::NEW_PROPERTY)}},
+            {"lgamma",         Keyword{T_LGAMMA, accepted(syntax_t::NEW_PROPERTY)}},
+            {"ceil",           Keyword{T_CEIL, accepted(syntax_t::NEW_PROPERTY)}},
+            {"floor",          Keyword{T_FLOOR, accepted(syntax_t::NEW_PROPERTY)}},
+            {"trunc",          Keyword{T_TRUNC, accepted(syntax_t::NEW_PROPERTY)}},
+            {"round",          Keyword{T_ROUND, accepted(syntax_t::NEW_PROPERTY)}},
+            {"fint",           Keyword{T_FINT, accepted(syntax_t::NEW_PROPERTY)}},
+            {"ldexp",          Keyword{T_LDEXP, accepted(syntax_t::NEW_PROPERTY)}},
+            {"ilogb",          Keyword{T_ILOGB, accepted(syntax_t::NEW_PROPERTY)}},
+            {"logb",           Keyword{T_LOGB, accepted(syntax_t::NEW_PROPERTY)}},
+            {"nextafter",      Keyword{T_NEXTAFTER, accepted(syntax_t::NEW_PROPERTY)}},
+            {"copysign",       Keyword{T_COPYSIGN, accepted(syntax_t::NEW_PROPERTY)}},
+            {"fpclassify",     Keyword{T_FPCLASSIFY, accepted(syntax_t::NEW_PROPERTY)}},
+            {"isfinite",       Keyword{T_ISFINITE, accepted(syntax_t::NEW_PROPERTY)}},
+            {"isinf",          Keyword{T_ISINF, accepted(syntax_t::NEW_PROPERTY)}},
+            {"isnan",          Keyword{T_ISNAN, accepted(syntax_t::NEW_PROPERTY)}},
+            {"isnormal",       Keyword{T_ISNORMAL, accepted(syntax_t::NEW_PROPERTY)}},
+            {"signbit",        Keyword{T_SIGNBIT, accepted(syntax_t::NEW_PROPERTY)}},
+            {"isunordered",    Keyword{T_ISUNORDERED, accepted(syntax_t::NEW_PROPERTY)}},
+            {"random",         Keyword{T_RANDOM, accepted(syntax_t::NEW_PROPERTY)}},
+            {"random_arcsine", Keyword{T_RANDOM_ARCSINE, accepted(syntax_t::NEW_PROPERTY)}},
+            {"random_beta",    Keyword{T_RANDOM_BETA, accepted(syntax_t::NEW_PROPERTY)}},
+            {"random_gamma",   Keyword{T_RANDOM_GAMMA, accepted(syntax_t::NEW_PROPERTY)}},
+            {"random_normal",  Keyword{T_RANDOM_NORMAL, accepted(syntax_t::NEW_PROPERTY)}},
+            {"random_poisson", Keyword{T_RANDOM_POISSON, accepted(syntax_t::NEW_PROPERTY)}},
+            {"random_tri",     Keyword{T_RANDOM_TRI, accepted(syntax_t::NEW_PROPERTY)}},
+            {"random_weibull", Keyword{T_RANDOM_WEIBULL, accepted(syntax_t::NEW_PROPERTY)}},
+            {"hybrid",         Keyword{T_HYBRID, accepted(syntax_t::NEW)}},
+            {"dynamic",        Keyword{T_DYNAMIC, accepted(syntax_t::NEW)}},
+            {"spawn",          Keyword{T_SPAWN, accepted(syntax_t::NEW)}},
+            {"exit",           Keyword{T_EXIT, accepted(syntax_t::NEW)}},
+            {"numOf",          Keyword{T_NUMOF, accepted(syntax_t::PROPERTY)}},
+            {"foreach",        Keyword{T_FOREACH, accepted(syntax_t::PROPERTY)}},
+            {"query",          Keyword{T_QUERY, accepted(syntax_t::NEW)}},
+            {"location",       Keyword{T_LOCATION, accepted(syntax_t::NEW)}},
+        };
+        // clang-format on
+
+        constexpr auto count = std::size(keywords);
+        constexpr auto bucketCount = size_t{64};
+        constexpr auto slotBits = 9u;  // 512 slots, so that every bucket finds room after a few displacements
+        constexpr auto none = uint8_t{0xff};
+        static_assert(count < none, "a slot refers to a keyword by a byte");
+
+        /** FNV-1a, computed once per lookup; the bucket and the slot are derived from it. */
+        constexpr uint64_t hash(std::string_view word)
+        {
+            auto h = uint64_t{14695981039346656037u};
+            for (auto c : word) {
+                h ^= static_cast<unsigned char>(c);
+                h *= 1099511628211u;
+            }
+            return h;
+        }
+
+        /** The finalizer of MurmurHash3, spreading every bit of the hash over the others. */
+        constexpr uint64_t mix(uint64_t h)
+        {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdu;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53u;
+            h ^= h >> 33;
+            return h;
+        }
+
+        constexpr size_t bucketOf(uint64_t h) { return mix(h) % bucketCount; }
+
+        constexpr size_t slotOf(uint64_t h, uint32_t displacement)
+        {
+            return mix(h + displacement * uint64_t{0x9e3779b97f4a7c15u}) >> (64 - slotBits);
+        }
+
+        /**
+         * A perfect hash of the keywords (hash and displace): the keywords
+         * are grouped in buckets and each bucket gets the displacement
+         * that puts all its keywords in free slots of their own, so a
+         * lookup probes exactly one slot.
+         */
+        struct table_t
+        {
+            std::array<uint16_t, bucketCount> displacements{};
+            std::array<uint8_t, size_t{1} << slotBits> slots{};
+            bool complete{false};  // false if some bucket did not fit, e.g. because of a repeated keyword
+        };
+
+        constexpr table_t makeTable()
+        {
+            auto table = table_t{};
+            for (auto& slot : table.slots)
+                slot = none;
+            auto hashes = std::array<uint64_t, count>{};
+            auto buckets = std::array<size_t, count>{};
+            auto sizes = std::array<size_t, bucketCount>{};
+            for (size_t i = 0; i < count; ++i) {
+                hashes[i] = hash(keywords[i].word);
+                buckets[i] = bucketOf(hashes[i]);
+                ++sizes[buckets[i]];
+            }
+            // The largest buckets are placed first, while the table is still empty
+            auto order = std::array<size_t, bucketCount>{};
+            for (size_t b = 0; b < bucketCount; ++b)
+                order[b] = b;
+            for (size_t i = 1; i < bucketCount; ++i) {
+                for (size_t j = i; j > 0 && sizes[order[j - 1]] < sizes[order[j]]; --j) {
+                    const auto b = order[j];
+                    order[j] = order[j - 1];
+                    order[j - 1] = b;
+                }
+            }
+            for (auto b : order) {
+                auto members = std::array<size_t, count>{};
+                auto size = size_t{0};
+                for (size_t i = 0; i < count; ++i)
+                    if (buckets[i] == b)
+                        members[size++] = i;
+                if (size == 0)
+                    break;
+                auto displacement = uint32_t{0};
+                for (;; ++displacement) {
+                    if (displacement > UINT16_MAX)
+                        return table;
+                    auto fits = true;
+                    for (size_t k = 0; k < size && fits; ++k) {
+                        const auto slot = slotOf(hashes[members[k]], displacement);
+                        fits = table.slots[slot] == none;
+                        for (size_t m = 0; m < k && fits; ++m)
+                            fits = slotOf(hashes[members[m]], displacement) != slot;
+                    }
+                    if (fits)
+                        break;
+                }
+                table.displacements[b] = static_cast<uint16_t>(displacement);
+                for (size_t k = 0; k < size; ++k)
+                    table.slots[slotOf(hashes[members[k]], displacement)] = static_cast<uint8_t>(members[k]);
+            }
+            table.complete = true;
+            return table;
+        }
+
+        constexpr auto table = makeTable();
+        static_assert(table.complete, "the keywords must be distinct");
+    }  // namespace
 
     const Keyword* find_keyword(std::string_view word)
     {
-        const auto keyword = keyword_map.find(word);
-        if (keyword == std::end(keyword_map))
+        const auto h = hash(word);
+        const auto index = table.slots[slotOf(h, table.displacements[bucketOf(h)])];
+        if (index == none || keywords[index].word != word)
             return nullptr;
-        return &keyword->second;
+        return &keywords[index].keyword;
     }
 
     bool is_keyword(std::string_view word, syntax_t syntax)
     {
         const auto* keyword = find_keyword(word);
-        if (keyword)
-            return keyword->syntax & syntax;
-        else
-            return false;
+        return keyword != nullptr && (keyword->syntax & syntax);
     }
 }  // namespace UTAP
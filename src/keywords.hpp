@@ -32,7 +32,7 @@ namespace UTAP
     struct Keyword
     {
         int token{};
-        syntax_t syntax{};
+        syntax_t syntax{}; /**< The syntax accepting the keyword, none if it is not enabled in this build */
     };
 
     /**
@@ -45,6 +45,7 @@ namespace UTAP
 
     /**
      * Searches for the text among the keywords and returns address if found.
+     * The keywords (and builtin functions) are found by a perfect hash computed at compile time.
      * @param text the string to search for
      * @return the keyword struct if found and nullptr otherwise
      */
@@ -24,6 +24,10 @@
 #define UTAP_LIBPARSER_HH
 
 #include "utap/builder.h"
+#include "utap/statistics.h"
+
+#include <atomic>
+#include <optional>
 
 // The maximum length is 4000 (see error message) + 1 for the
 // terminating \0.
@@ -62,12 +66,34 @@ namespace UTAP
      */
     class PositionTracker
     {
+        /** The largest position handed out by any tracker so far. */
+        static inline std::atomic<uint32_t> published{0};
+
     public:
-        uint32_t line;
-        uint32_t offset;
+        uint32_t line{1};
+        uint32_t offset{0};
         uint32_t position;
         std::string path;
 
+        /**
+         * Continues after the positions used by previously destroyed
+         * trackers, such that positions added to a builder by
+         * consecutive parses remain monotonically increasing.
+         */
+        PositionTracker(): position{published.load()} {}
+        /** Starts counting from the given position. */
+        explicit PositionTracker(uint32_t position): position{position} {}
+        PositionTracker(const PositionTracker&) = delete;
+        PositionTracker& operator=(const PositionTracker&) = delete;
+
+        /** Publishes the current position for the trackers created later. */
+        ~PositionTracker() noexcept
+        {
+            auto last = published.load();
+            while (last < position && !published.compare_exchange_weak(last, position))
+                ;
+        }
+
         /**
          * Sets the current path to \a s, offset to 0 and line to 1.
          * Sets the position of \a builder to [position, position + 1)
@@ -113,7 +139,30 @@ namespace UTAP
         }
     };
 
-    extern PositionTracker tracker;
+    /**
+     * The state of a single parse shared by the (reentrant) lexer and
+     * the (pure) parser: nothing is kept in global variables, thus
+     * different builders can be fed from different threads at the same
+     * time.
+     */
+    struct ParserState
+    {
+        ParserBuilder* builder;    /**< The builder receiving the parsed elements. */
+        PositionTracker& tracker;  /**< Position tracking of the current input. */
+        syntax_t syntax;           /**< The syntax (keywords) currently accepted. */
+        int syntax_token{0};       /**< The start token to be returned first by the lexer. */
+        int types{0};              /**< Counter used during array parsing. */
+        char rootTransId[MAXLEN];  /**< The source of the transition being parsed (old syntax). */
+        void* scanner{nullptr};    /**< The flex scanner (yyscan_t). */
+        /** Times the semantic actions calling the builder until the next token is lexed, see parse(). */
+        std::optional<Statistics::Phase>* actions{nullptr};
+
+        ParserState(ParserBuilder* builder, PositionTracker& tracker, syntax_t syntax):
+            builder{builder}, tracker{tracker}, syntax{syntax}
+        {
+            rootTransId[0] = '\0';
+        }
+    };
 
     /** Errors from underlying XML reading operations (most likely OS issues) */
     class XMLReaderError : public std::runtime_error
@@ -129,4 +178,20 @@ namespace UTAP
     };
 }  // namespace UTAP
 
+/**
+ * Adds the builtin declarations of utap_builtin_declarations() to \a
+ * builder as if they were parsed at the current position of \a tracker
+ * with the given xpath. The text is only parsed once per process.
+ */
+int32_t parseBuiltins(UTAP::ParserBuilder*, UTAP::PositionTracker& tracker, const std::string& xpath);
+
+/**
+ * Same as parseXTA(std::string_view, ParserBuilder*, bool, xta_part_t,
+ * std::string) but the positions are numbered by the given \a
+ * tracker, which allows the caller to interleave several parses with
+ * its own position bookkeeping (like the XML reader does).
+ */
+int32_t parseXTA(std::string_view, UTAP::ParserBuilder*, UTAP::PositionTracker& tracker, bool newxta,
+                 UTAP::xta_part_t part, const std::string& xpath);
+
 #endif /* UTAP_LIBPARSER_HH */
@@ -0,0 +1,179 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/librarycache.h"
+
+#ifdef __MINGW32__
+#include <windows.h>
+#elif defined(__linux__) || defined(__APPLE__)
+#include <dlfcn.h>
+#endif
+
+using namespace UTAP;
+
+namespace
+{
+#ifdef __MINGW32__
+    constexpr auto extension = ".dll";
+#else
+    constexpr auto extension = ".so";
+#endif
+
+    void* openLibrary(const std::filesystem::path& path)
+    {
+#ifdef __MINGW32__
+        return LoadLibrary(path.string().c_str());  // c_str() alone uses wchar_t(!)
+#elif defined(__linux__) || defined(__APPLE__)
+        return dlopen(path.string().c_str(), RTLD_NOW | RTLD_LOCAL);
+#else
+        return nullptr;
+#endif
+    }
+
+    void closeLibrary(void* handle)
+    {
+#ifdef __MINGW32__
+        FreeLibrary((HINSTANCE)handle);
+#elif defined(__linux__) || defined(__APPLE__)
+        dlclose(handle);
+#endif
+    }
+
+    void* findFunction(void* handle, const std::string& name)
+    {
+#ifdef __MINGW32__
+        return (void*)GetProcAddress((HMODULE)handle, name.c_str());
+#elif defined(__linux__) || defined(__APPLE__)
+        return dlsym(handle, name.c_str());
+#else
+        return nullptr;
+#endif
+    }
+
+    /** Returns the key of a path for telling libraries apart: canonical if it exists, as is for the system search. */
+    bool resolve(const std::filesystem::path& path, std::string& key)
+    {
+        auto error = std::error_code{};
+        if (std::filesystem::exists(path, error)) {
+            key = std::filesystem::weakly_canonical(path, error).string();
+            if (error)
+                key = path.string();
+            return true;
+        }
+        key = path.string();
+        return !path.has_parent_path();  // left to the system search
+    }
+}  // namespace
+
+LibraryCache::library_t::~library_t() noexcept { closeLibrary(handle); }
+
+const std::string& LibraryCache::Handle::getPath() const
+{
+    static const auto none = std::string{};
+    return library != nullptr ? library->path : none;
+}
+
+void* LibraryCache::Handle::getFunction(const std::string& name) const
+{
+    if (library == nullptr)
+        return nullptr;
+    auto lock = std::lock_guard{library->cache.mutex};
+    auto [it, added] = library->functions.emplace(name, nullptr);
+    if (added)
+        it->second = findFunction(library->handle, name);
+    return it->second;
+}
+
+LibraryCache& LibraryCache::instance()
+{
+    static auto cache = LibraryCache{};
+    return cache;
+}
+
+std::shared_ptr<LibraryCache::library_t> LibraryCache::open(const std::string& path)
+{
+    if (auto it = libraries.find(path); it != libraries.end())
+        return it->second;
+    auto* handle = openLibrary(path);
+    if (handle == nullptr)
+        return nullptr;
+    auto library = std::make_shared<library_t>(path, handle, *this);
+    libraries.emplace(path, library);
+    return library;
+}
+
+LibraryCache::Handle LibraryCache::load(const std::string& name, const std::vector<std::filesystem::path>& paths)
+{
+    // the file in the working directory and relative search paths depend on the working directory
+    auto error = std::error_code{};
+    auto lookup = std::filesystem::current_path(error).string().append(1, '\0').append(name);
+    for (const auto& path : paths)
+        lookup.append(1, '\0').append(path.string());
+
+    auto lock = std::lock_guard{mutex};
+    if (auto it = lookups.find(lookup); it != lookups.end())
+        if (auto library = libraries.find(it->second); library != libraries.end())
+            return Handle{library->second};
+
+    // A file in the working directory comes first, then the paths with and without the extension
+    auto candidates = std::vector<std::filesystem::path>{};
+    if (auto local = std::filesystem::path{name + extension}; std::filesystem::exists(local)) {
+        candidates.push_back(std::move(local));
+    } else {
+        for (const auto& prefix : paths) {
+            auto fullpath = prefix / name;
+            candidates.push_back(fullpath);
+            candidates.push_back(fullpath.concat(extension));
+        }
+    }
+    for (const auto& candidate : candidates) {
+        auto key = std::string{};
+        if (!resolve(candidate, key))
+            continue;
+        if (auto library = open(key)) {
+            lookups[lookup] = key;
+            return Handle{std::move(library)};
+        }
+    }
+    return Handle{};
+}
+
+size_t LibraryCache::purge()
+{
+    auto unused = std::vector<std::shared_ptr<library_t>>{};
+    auto lock = std::lock_guard{mutex};
+    lookups.clear();
+    for (auto it = libraries.begin(); it != libraries.end();) {
+        if (it->second.use_count() == 1) {
+            unused.push_back(std::move(it->second));
+            it = libraries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return unused.size();
+}
+
+size_t LibraryCache::size() const
+{
+    auto lock = std::lock_guard{mutex};
+    return libraries.size();
+}
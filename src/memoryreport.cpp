@@ -0,0 +1,225 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/memoryreport.h"
+
+#include "utap/document.h"
+#include "utap/node.h"
+#include "utap/statement.h"
+
+#include <ostream>
+
+using namespace UTAP;
+
+namespace
+{
+    /** Measures what is reachable from the declarations and statements of a document. */
+    class Walker : public ExpressionVisitor
+    {
+    public:
+        explicit Walker(MemoryReport& report): report{report} {}
+
+        void expression(const expression_t& expr) { expr.measure(report); }
+
+        void declarations(declarations_t& decls)
+        {
+            decls.frame.measure(report);
+            variables(decls.variables);
+            for (auto& fun : decls.functions) {
+                fun.uid.measure(report);
+                variables(fun.variables);
+                if (fun.body)
+                    fun.body->accept(this);
+            }
+            for (const auto& progress : decls.progress) {
+                expression(progress.guard);
+                expression(progress.measure);
+            }
+            for (const auto& io : decls.iodecl) {
+                for (const auto& e : io.param)
+                    expression(e);
+                for (const auto* exprs : {&io.inputs, &io.outputs, &io.csp})
+                    for (const auto& e : *exprs)
+                        expression(e);
+            }
+            for (const auto& gantt : decls.ganttChart) {
+                gantt.parameters.measure(report);
+                for (const auto& map : gantt.mapping) {
+                    map.parameters.measure(report);
+                    expression(map.predicate);
+                    expression(map.mapping);
+                }
+            }
+        }
+
+        void instance(const instance_t& inst)
+        {
+            inst.uid.measure(report);
+            inst.parameters.measure(report);
+            for (const auto& [param, arg] : inst.mapping) {
+                param.measure(report);
+                expression(arg);
+            }
+        }
+
+        void templ(template_t& t)
+        {
+            instance(t);
+            declarations(t);
+            t.init.measure(report);
+            t.templateset.measure(report);
+            for (const auto& state : t.states) {
+                state.uid.measure(report);
+                expression(state.name);
+                expression(state.invariant);
+                expression(state.exponentialRate);
+                expression(state.costRate);
+            }
+            for (const auto& bp : t.branchpoints)
+                bp.uid.measure(report);
+            for (const auto& edge : t.edges) {
+                edge.select.measure(report);
+                expression(edge.guard);
+                expression(edge.assign);
+                expression(edge.sync);
+                expression(edge.prob);
+            }
+            for (const auto& e : t.dynamicEvals)
+                expression(e);
+        }
+
+        int32_t visitBlockStatement(BlockStatement* stat) override
+        {
+            declarations(*stat);
+            return ExpressionVisitor::visitBlockStatement(stat);
+        }
+
+        int32_t visitIterationStatement(IterationStatement* stat) override
+        {
+            stat->getFrame().measure(report);
+            stat->symbol.measure(report);
+            return ExpressionVisitor::visitIterationStatement(stat);
+        }
+
+    protected:
+        void visitExpression(expression_t expr) override { expression(expr); }
+
+    private:
+        MemoryReport& report;
+
+        void variables(const std::list<variable_t>& vars)
+        {
+            for (const auto& var : vars) {
+                var.uid.measure(report);
+                expression(var.expr);
+            }
+        }
+    };
+
+    /** The bytes of the elements of the container, without slack. */
+    template <typename Container>
+    size_t elementBytes(const Container& items)
+    {
+        return items.size() * sizeof(typename Container::value_type);
+    }
+}  // namespace
+
+MemoryReport::MemoryReport(Document& doc)
+{
+    auto walker = Walker{*this};
+    walker.declarations(doc.getGlobals());
+    const auto templ = [&](template_t& t) {
+        auto edges = elementBytes(t.edges);
+        for (const auto& edge : t.edges)
+            edges += bufferBytes(edge.actname);
+        templates.push_back({t.uid.getName(), {t.states.size(), elementBytes(t.states)}, {t.edges.size(), edges}});
+        walker.templ(t);
+    };
+    for (auto& t : doc.getTemplates())
+        templ(t);
+    for (auto* t : doc.getDynamicTemplates())
+        templ(*t);
+    for (const auto* inst : doc.getInstanceIndex().getTable())
+        walker.instance(*inst);
+    for (const auto& process : doc.getProcesses())
+        walker.instance(process);
+    for (const auto& priority : doc.getChanPriorities()) {
+        walker.expression(priority.head);
+        for (const auto& [separator, chan] : priority.tail)
+            walker.expression(chan);
+    }
+    walker.expression(doc.getBeforeUpdate());
+    walker.expression(doc.getAfterUpdate());
+
+    const auto& positions = doc.getPositions();
+    add(POSITIONS, positions.getMemoryUsage(), positions.getSize());
+    for (const auto& str : doc.get_strings())
+        add(STRINGS, stringBytes(str));
+}
+
+size_t MemoryReport::getTotal() const
+{
+    auto total = size_t{0};
+    for (const auto& [kind, item] : expressions)
+        total += item.bytes;
+    for (const auto& item : categories)
+        total += item.bytes;
+    for (const auto& t : templates)
+        total += t.states.bytes + t.edges.bytes;
+    return total;
+}
+
+void MemoryReport::addExpression(Constants::kind_t kind, size_t bytes) { expressions[kind] += item_t{1, bytes}; }
+
+void MemoryReport::add(category_t category, size_t bytes, size_t count) { categories[category] += item_t{count, bytes}; }
+
+size_t MemoryReport::nodeBytes(size_t size)
+{
+    return (node_offset + size + node_alignment - 1) / node_alignment * node_alignment;
+}
+
+size_t MemoryReport::stringBytes(const std::string& str) { return sizeof(std::string) + bufferBytes(str); }
+
+size_t MemoryReport::bufferBytes(const std::string& str)
+{
+    const auto* begin = reinterpret_cast<const char*>(&str);
+    const auto inplace = str.data() >= begin && str.data() < begin + sizeof(std::string);
+    return inplace ? 0 : str.capacity() + 1;
+}
+
+std::ostream& UTAP::operator<<(std::ostream& os, const MemoryReport& report)
+{
+    const auto line = [&os](const auto& name, const MemoryReport::item_t& item) {
+        os << name << '\t' << item.count << '\t' << item.bytes << '\n';
+    };
+    for (const auto& [kind, item] : report.getExpressions())
+        line("expression." + std::to_string(kind), item);
+    line("types", report[MemoryReport::TYPES]);
+    line("symbols", report[MemoryReport::SYMBOLS]);
+    line("frames", report[MemoryReport::FRAMES]);
+    line("positions", report[MemoryReport::POSITIONS]);
+    line("strings", report[MemoryReport::STRINGS]);
+    for (const auto& t : report.getTemplates()) {
+        line("template." + t.name + ".states", t.states);
+        line("template." + t.name + ".edges", t.edges);
+    }
+    return os << "total\t\t" << report.getTotal() << '\n';
+}
@@ -0,0 +1,508 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/modelreduction.h"
+
+#include "utap/bytecode.h"
+#include "utap/document.h"
+#include "utap/statement.h"
+#include "utap/typechecker.h"
+
+#include <limits>
+#include <cassert>
+#include <cctype>
+
+using namespace UTAP;
+using namespace Constants;
+
+namespace
+{
+    /** Returns true if the values of the type can be dropped from the state, i.e. it holds no channels. */
+    bool isData(const type_t& type)
+    {
+        if (type.isArray())
+            return isData(type.getSub());
+        if (type.isRecord()) {
+            for (auto i = size_t{0}; i < type.getRecordSize(); ++i)
+                if (!isData(type.getSub(i)))
+                    return false;
+            return true;
+        }
+        return type.isIntegral() || type.isScalar() || type.isDouble() || type.isClock();
+    }
+
+    /** Returns the variable an lvalue of identifiers, fields and elements refers to, or an empty symbol. */
+    symbol_t baseOf(const expression_t& expr)
+    {
+        switch (expr.getKind()) {
+        case IDENTIFIER: return expr.getSymbol();
+        case DOT:
+        case ARRAY: return baseOf(expr[0]);
+        default: return {};
+        }
+    }
+
+    bool isUpdate(kind_t kind)
+    {
+        switch (kind) {
+        case ASSIGN:
+        case ASSPLUS:
+        case ASSMINUS:
+        case ASSDIV:
+        case ASSMOD:
+        case ASSMULT:
+        case ASSAND:
+        case ASSOR:
+        case ASSXOR:
+        case ASSLSHIFT:
+        case ASSRSHIFT:
+        case POSTINCREMENT:
+        case PREINCREMENT:
+        case POSTDECREMENT:
+        case PREDECREMENT: return true;
+        default: return false;
+        }
+    }
+
+    bool hasCall(const expression_t& expr)
+    {
+        if (expr.empty())
+            return false;
+        if (expr.getKind() == FUNCALL || expr.getKind() == EFUNCALL)
+            return true;
+        for (auto i = size_t{0}; i < expr.getSize(); ++i)
+            if (hasCall(expr[i]))
+                return true;
+        return false;
+    }
+
+    /** Returns the identifiers found in the formulas of the queries. */
+    std::set<std::string> queriedNames(Document& doc)
+    {
+        auto names = std::set<std::string>{};
+        for (const auto& query : doc.getQueries()) {
+            const auto& text = query.formula;
+            for (auto i = size_t{0}; i < text.size();) {
+                const auto c = static_cast<unsigned char>(text[i]);
+                if (!std::isalpha(c) && c != '_') {
+                    ++i;
+                    continue;
+                }
+                auto j = i;
+                while (j < text.size() && (std::isalnum(static_cast<unsigned char>(text[j])) || text[j] == '_'))
+                    ++j;
+                names.insert(text.substr(i, j - i));
+                i = j;
+            }
+        }
+        return names;
+    }
+
+    class Reducer
+    {
+    public:
+        Reducer(Document& doc, std::vector<ModelReduction::removal_t>& removals):
+            doc{doc}, queried{queriedNames(doc)}, removals{removals}
+        {
+            doc.accept(computable);
+        }
+
+        void run()
+        {
+            forEachTemplate([this](template_t& templ) { removeEdges(templ); });
+            forEachDeclarations([this](declarations_t& decls, const template_t*) {
+                for (const auto& var : decls.variables) {
+                    const auto type = var.uid.getType();
+                    if (!type.isConstant() && isData(type) && queried.count(var.uid.getName()) == 0)
+                        candidates.insert(var.uid);
+                }
+            });
+            // The variables assumed unread shrink until the reads outside their updates agree
+            for (auto size = candidates.size() + 1; size != candidates.size();) {
+                size = candidates.size();
+                collect();
+                for (const auto& symbol : mentioned)
+                    candidates.erase(symbol);
+            }
+            apply();
+        }
+
+    private:
+        class Collector;
+        class Rewriter;
+
+        Document& doc;
+        CompileTimeComputableValues computable;
+        std::set<std::string> queried;
+        std::vector<ModelReduction::removal_t>& removals;
+        std::set<symbol_t> candidates; /**< Variables assumed unread. */
+        std::set<symbol_t> mentioned;  /**< Identifiers outside the updates of candidates. */
+        std::vector<function_t*> pending;
+
+        template <typename F>
+        void forEachDeclarations(F&& f)
+        {
+            f(doc.getGlobals(), nullptr);
+            for (auto& templ : doc.getTemplates())
+                f(templ, &templ);
+            for (auto* templ : doc.getDynamicTemplates())
+                f(*templ, templ);
+        }
+
+        template <typename F>
+        void forEachTemplate(F&& f)
+        {
+            for (auto& templ : doc.getTemplates())
+                f(templ);
+            for (auto* templ : doc.getDynamicTemplates())
+                f(*templ);
+        }
+
+        static std::string qualified(const template_t* templ, const symbol_t& symbol)
+        {
+            return templ != nullptr ? templ->uid.getName() + "." + symbol.getName() : symbol.getName();
+        }
+
+        /** Returns true if the guard evaluates to false with the constant arguments of the process. */
+        bool isFalse(const expression_t& guard, const std::vector<const instance_t*>& processes) const
+        {
+            if (guard.empty())
+                return false;
+            if (guard.getKind() == AND)
+                return isFalse(guard[0], processes) || isFalse(guard[1], processes);
+            auto reads = std::set<symbol_t>{};
+            guard.collectPossibleReads(reads, true);
+            for (const auto& symbol : reads)
+                if (!computable.contains(symbol))
+                    return false;
+            const auto evaluate = [](const expression_t& expr) {
+                auto compiler = BytecodeCompiler{};
+                const auto routine = compiler.compile(expr);
+                return BytecodeInterpreter{compiler.getProgram()}.run(routine, nullptr);
+            };
+            try {
+                if (processes.empty())
+                    return evaluate(guard) == 0;
+                for (const auto* process : processes) {
+                    auto mapping = std::map<symbol_t, expression_t>{};
+                    for (const auto& [parameter, argument] : process->mapping)
+                        if (computable.contains(parameter))
+                            mapping.emplace(parameter, argument);
+                    if (evaluate(guard.subst(mapping)) != 0)
+                        return false;
+                }
+                return true;
+            } catch (const BytecodeError&) {
+                return false;
+            } catch (const EvaluationError&) {
+                return false;
+            }
+        }
+
+        void removeEdges(template_t& templ)
+        {
+            auto processes = std::vector<const instance_t*>{};
+            for (const auto& process : doc.getProcesses())
+                if (process.templ == &templ)
+                    processes.push_back(&process);
+            const auto name = [](const state_t* state, const branchpoint_t* branchpoint) {
+                return state != nullptr ? state->uid.getName() : branchpoint->uid.getName();
+            };
+            for (auto it = templ.edges.begin(); it != templ.edges.end();) {
+                if (!isFalse(it->guard, processes)) {
+                    ++it;
+                    continue;
+                }
+                removals.push_back({ModelReduction::EDGE,
+                                    templ.uid.getName() + ": " + name(it->src, it->srcb) + " -> " +
+                                        name(it->dst, it->dstb),
+                                    it->guard.getPosition()});
+                it = templ.edges.erase(it);
+            }
+        }
+
+        /** Returns true if the expression only assigns a candidate, which can thus be dropped. */
+        bool isRemovable(const expression_t& expr) const
+        {
+            if (!isUpdate(expr.getKind()))
+                return false;
+            const auto base = baseOf(expr[0]);
+            if (base == symbol_t{} || candidates.count(base) == 0 || hasCall(expr))
+                return false;
+            auto writes = std::set<symbol_t>{};
+            expr.collectPossibleWrites(writes);
+            return writes.size() == 1 && *writes.begin() == base;
+        }
+
+        void mention(symbol_t symbol)
+        {
+            if (mentioned.insert(symbol).second &&
+                (symbol.getType().isFunction() || symbol.getType().isExternalFunction()))
+                if (auto* fun = static_cast<function_t*>(symbol.getData()); fun != nullptr)
+                    pending.push_back(fun);
+        }
+
+        void expression(const expression_t& expr)
+        {
+            if (expr.empty())
+                return;
+            if (expr.getKind() == IDENTIFIER) {
+                mention(expr.getSymbol());
+                return;
+            }
+            // A field of a process reads the local of its template, e.g. in gantt charts
+            if (expr.getKind() == DOT && expr[0].getType().isProcess() &&
+                expr.getIndex() != std::numeric_limits<int32_t>::max()) {
+                const auto* process = static_cast<const instance_t*>(expr[0].getSymbol().getData());
+                if (process != nullptr && static_cast<uint32_t>(expr.getIndex()) < process->templ->frame.getSize())
+                    mention(process->templ->frame[expr.getIndex()]);
+            }
+            for (auto i = size_t{0}; i < expr.getSize(); ++i)
+                expression(expr[i]);
+        }
+
+        /** Visits an expression whose value is ignored, skipping the updates that can be dropped. */
+        void update(const expression_t& expr)
+        {
+            if (expr.empty())
+                return;
+            if (expr.getKind() == COMMA) {
+                update(expr[0]);
+                update(expr[1]);
+            } else if (!isRemovable(expr)) {
+                expression(expr);
+            }
+        }
+
+        void declarations(declarations_t& decls)
+        {
+            for (const auto& var : decls.variables)
+                if (candidates.count(var.uid) == 0)
+                    expression(var.expr);
+            for (auto& fun : decls.functions)
+                if (queried.count(fun.uid.getName()) != 0)
+                    expression(expression_t::createIdentifier(fun.uid));
+            for (const auto& progress : decls.progress) {
+                expression(progress.guard);
+                expression(progress.measure);
+            }
+            for (const auto& io : decls.iodecl) {
+                for (const auto& e : io.param)
+                    expression(e);
+                for (const auto* exprs : {&io.inputs, &io.outputs, &io.csp})
+                    for (const auto& e : *exprs)
+                        expression(e);
+            }
+            for (const auto& gantt : decls.ganttChart)
+                for (const auto& map : gantt.mapping) {
+                    expression(map.predicate);
+                    expression(map.mapping);
+                }
+        }
+
+        void instance(const instance_t& inst)
+        {
+            for (const auto& [parameter, argument] : inst.mapping)
+                expression(argument);
+        }
+
+        void collect();
+        void apply();
+        expression_t strip(const expression_t& expr) const;
+    };
+
+    /** Visits the bodies of functions, skipping the updates that can be dropped. */
+    class Reducer::Collector : public ExpressionVisitor
+    {
+    public:
+        explicit Collector(Reducer& reducer): reducer{reducer} {}
+
+        int32_t visitExprStatement(ExprStatement* stat) override
+        {
+            reducer.update(stat->expr);
+            return 0;
+        }
+
+    protected:
+        void visitExpression(expression_t expr) override { reducer.expression(expr); }
+
+    private:
+        Reducer& reducer;
+    };
+
+    /** Drops the updates of removed variables from function bodies. */
+    class Reducer::Rewriter : public AbstractStatementVisitor
+    {
+    public:
+        explicit Rewriter(const Reducer& reducer): reducer{reducer} {}
+
+        int32_t visitForStatement(ForStatement* stat) override { return rewrite(stat->stat); }
+        int32_t visitIterationStatement(IterationStatement* stat) override { return rewrite(stat->stat); }
+        int32_t visitWhileStatement(WhileStatement* stat) override { return rewrite(stat->stat); }
+        int32_t visitDoWhileStatement(DoWhileStatement* stat) override { return rewrite(stat->stat); }
+
+        int32_t visitBlockStatement(BlockStatement* stat) override
+        {
+            for (auto& s : *stat)
+                rewrite(s);
+            return 0;
+        }
+
+        int32_t visitIfStatement(IfStatement* stat) override
+        {
+            rewrite(stat->trueCase);
+            if (stat->falseCase)
+                rewrite(stat->falseCase);
+            return 0;
+        }
+
+    private:
+        const Reducer& reducer;
+
+        int32_t rewrite(std::unique_ptr<Statement>& stat)
+        {
+            auto* expr = dynamic_cast<ExprStatement*>(stat.get());
+            if (expr == nullptr)
+                return stat->accept(this);
+            expr->expr = reducer.strip(expr->expr);
+            if (expr->expr.empty())
+                stat = std::make_unique<EmptyStatement>();
+            return 0;
+        }
+    };
+
+    void Reducer::collect()
+    {
+        mentioned.clear();
+        forEachDeclarations([this](declarations_t& decls, const template_t*) { declarations(decls); });
+        forEachTemplate([this](template_t& templ) {
+            instance(templ);
+            for (const auto& state : templ.states) {
+                expression(state.invariant);
+                expression(state.exponentialRate);
+                expression(state.costRate);
+            }
+            for (const auto& edge : templ.edges) {
+                expression(edge.guard);
+                update(edge.assign);
+                expression(edge.sync);
+                expression(edge.prob);
+            }
+            for (const auto& e : templ.dynamicEvals)
+                expression(e);
+            for (const auto& line : templ.instances)
+                instance(line);
+            for (const auto& message : templ.messages)
+                expression(message.label);
+            for (const auto& update : templ.updates)
+                expression(update.label);
+            for (const auto& condition : templ.conditions)
+                expression(condition.label);
+        });
+        for (const auto* inst : doc.getInstanceIndex().getTable())
+            instance(*inst);
+        for (const auto& process : doc.getProcesses())
+            instance(process);
+        for (const auto& priority : doc.getChanPriorities()) {
+            expression(priority.head);
+            for (const auto& [separator, chan] : priority.tail)
+                expression(chan);
+        }
+        expression(doc.getBeforeUpdate());
+        expression(doc.getAfterUpdate());
+        auto collector = Collector{*this};
+        while (!pending.empty()) {
+            auto* fun = pending.back();
+            pending.pop_back();
+            if (fun->body)
+                fun->body->accept(&collector);
+        }
+    }
+
+    expression_t Reducer::strip(const expression_t& expr) const
+    {
+        if (expr.empty())
+            return expr;
+        if (expr.getKind() != COMMA)
+            return isRemovable(expr) ? expression_t{} : expr;
+        auto first = strip(expr[0]);
+        auto second = strip(expr[1]);
+        if (first.empty() || second.empty())
+            return first.empty() ? second : first;
+        if (first == expr[0] && second == expr[1])
+            return expr;
+        auto type = second.getType();
+        return expression_t::createBinary(COMMA, std::move(first), std::move(second), expr.getPosition(),
+                                          std::move(type));
+    }
+
+    void Reducer::apply()
+    {
+        forEachTemplate([this](template_t& templ) {
+            for (auto& edge : templ.edges)
+                if (auto assign = strip(edge.assign); !(assign == edge.assign))
+                    edge.assign = assign.empty() ? expression_t::createConstant(1, edge.assign.getPosition()) : assign;
+        });
+        auto rewriter = Rewriter{*this};
+        forEachDeclarations([&](declarations_t& decls, const template_t*) {
+            for (auto& fun : decls.functions)
+                if (fun.body && mentioned.count(fun.uid) != 0)
+                    fun.body->accept(&rewriter);
+        });
+        forEachDeclarations([this](declarations_t& decls, const template_t* templ) {
+            for (auto it = decls.variables.begin(); it != decls.variables.end();) {
+                if (candidates.count(it->uid) == 0) {
+                    ++it;
+                    continue;
+                }
+                removals.push_back({ModelReduction::VARIABLE, qualified(templ, it->uid), it->uid.getPosition()});
+                decls.frame.remove(it->uid);
+                it->uid.setData(nullptr);
+                it = decls.variables.erase(it);
+            }
+        });
+        forEachDeclarations([this](declarations_t& decls, const template_t* templ) {
+            for (auto it = decls.functions.begin(); it != decls.functions.end();) {
+                if (mentioned.count(it->uid) != 0) {
+                    for (const auto& symbol : candidates) {
+                        it->changes.erase(symbol);
+                        it->depends.erase(symbol);
+                        it->changeSet.erase(symbol);
+                        it->dependSet.erase(symbol);
+                    }
+                    ++it;
+                    continue;
+                }
+                removals.push_back({ModelReduction::FUNCTION, qualified(templ, it->uid), it->uid.getPosition()});
+                decls.frame.remove(it->uid);
+                it->uid.setData(nullptr);
+                it = decls.functions.erase(it);
+            }
+        });
+        // The fields of the processes are the symbols left in the frames of their templates
+        forEachTemplate([this](template_t& templ) {
+            const bool kept [[maybe_unused]] = doc.updateProcesses(templ);
+            assert(kept);  // the fields referred to are read, thus kept
+        });
+    }
+}  // namespace
+
+ModelReduction::ModelReduction(Document& doc) { Reducer{doc, removals}.run(); }
@@ -42,9 +42,19 @@
 
 #include "parser.hpp"
 #include "libparser.h"
+#include "MappedFile.hpp"
+#include "RecordingBuilder.hpp"
+#include "utap/cancellation.h"
 #include "utap/position.h"
+#include "utap/statistics.h"
 
+#include <algorithm>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
 #include <cstring> // strlen
 
 using namespace UTAP;
@@ -68,31 +78,26 @@ using namespace Constants;
 }
 
 %code {
-static ParserBuilder *ch;
-static syntax_t syntax;
-static int syntax_token = 0;
+static void utap_error(YYLTYPE* loc, ParserState& state, const char* msg);
 
-static void utap_error(const char* msg);
+static int lexer_flex(YYSTYPE* yylval_param, YYLTYPE* yylloc_param, void* yyscanner);
 
-static int lexer_flex();
-
-static int utap_lex()
+static int utap_lex(YYSTYPE* lval, YYLTYPE* lloc, ParserState& state)
 {
    int old;
-   if (syntax_token) {
-	 old = syntax_token;
-	 syntax_token = 0;
+   if (state.syntax_token) {
+	 old = state.syntax_token;
+	 state.syntax_token = 0;
 	 return old;
    }
-   return lexer_flex();
+   if (ParseMonitor::cancelled())
+	 return 0; // end the input early
+   if (state.actions != nullptr)
+	 state.actions->reset(); // the actions reduced on the previous token are done
+   return lexer_flex(lval, lloc, state.scanner);
 }
 
-static char rootTransId[MAXLEN];
-
-/* Counter used during array parsing. */
-static int types = 0;
-
-#define CALL(first,last,call) do { ch->setPosition(first.start, last.end); try { ch->call; } catch (TypeException &te) { ch->handleError(te); } } while (0)
+#define CALL(first,last,call) do { if (state.actions != nullptr && !*state.actions) state.actions->emplace(Statistics::BUILDER); state.builder->setPosition(first.start, last.end); try { state.builder->call; } catch (TypeException &te) { state.builder->handleError(te); } } while (0)
 
 #define YY_(msg) utap_msg(msg)
 
@@ -168,6 +173,9 @@ const char* utap_msg(const char *msg)
 
 %require "3.6.0"
 %define parse.error detailed
+%define api.pure full
+%locations
+%param {UTAP::ParserState& state}
 
 /* Assignments: */
 %token T_ASSIGNMENT T_ASSPLUS
@@ -638,12 +646,12 @@ FieldInit:
         ;
 
 ArrayDecl:
-        { types = 0; } ArrayDecl2;
+        { state.types = 0; } ArrayDecl2;
 
 ArrayDecl2:
         /* empty */
-        | '[' Expression ']'        ArrayDecl2 { CALL(@1, @3, typeArrayOfSize(types)); }
-        | '[' Type ']' { types++; } ArrayDecl2 { CALL(@1, @3, typeArrayOfType(types--)); }
+        | '[' Expression ']'        ArrayDecl2 { CALL(@1, @3, typeArrayOfSize(state.types)); }
+        | '[' Type ']' { state.types++; } ArrayDecl2 { CALL(@1, @3, typeArrayOfType(state.types--)); }
         | '[' error ']' ArrayDecl2
         ;
 
@@ -881,27 +889,27 @@ Transition:
         NonTypeId T_ARROW NonTypeId '{' {
             CALL(@1, @3, procEdgeBegin($1, $3, true));
         } Select Guard Sync Assign Probability '}' {
-          strcpy(rootTransId, $1);
+          strcpy(state.rootTransId, $1);
           CALL(@1, @9, procEdgeEnd($1, $3));
         }
         | NonTypeId T_UNCONTROL_ARROW NonTypeId '{' {
             CALL(@1, @3, procEdgeBegin($1, $3, false));
         } Select Guard Sync Assign Probability '}' {
-          strcpy(rootTransId, $1);
+          strcpy(state.rootTransId, $1);
           CALL(@1, @9, procEdgeEnd($1, $3));
         }
         ;
 
 TransitionOpt:
         T_ARROW NonTypeId '{' {
-            CALL(@1, @2, procEdgeBegin(rootTransId, $2, true));
+            CALL(@1, @2, procEdgeBegin(state.rootTransId, $2, true));
         } Select Guard Sync Assign '}' {
-            CALL(@1, @7, procEdgeEnd(rootTransId, $2));
+            CALL(@1, @7, procEdgeEnd(state.rootTransId, $2));
         }
         | T_UNCONTROL_ARROW NonTypeId '{' {
-            CALL(@1, @2, procEdgeBegin(rootTransId, $2, false));
+            CALL(@1, @2, procEdgeBegin(state.rootTransId, $2, false));
         } Select Guard Sync Assign '}' {
-            CALL(@1, @7, procEdgeEnd(rootTransId, $2));
+            CALL(@1, @7, procEdgeEnd(state.rootTransId, $2));
         }
         | Transition
         ;
@@ -1653,7 +1661,7 @@ OldTransition:
         NonTypeId T_ARROW NonTypeId '{' {
             CALL(@1, @3, procEdgeBegin($1, $3, true));
         } OldGuard Sync Assign '}' {
-            strcpy(rootTransId, $1);
+            strcpy(state.rootTransId, $1);
             CALL(@1, @8, procEdgeEnd($1, $3));
         }
         ;
@@ -1661,9 +1669,9 @@ OldTransition:
 
 OldTransitionOpt:
         T_ARROW NonTypeId '{' {
-            CALL(@1, @2, procEdgeBegin(rootTransId, $2, true));
+            CALL(@1, @2, procEdgeBegin(state.rootTransId, $2, true));
         } OldGuard Sync Assign '}' {
-            CALL(@1, @7, procEdgeEnd(rootTransId, $2));
+            CALL(@1, @7, procEdgeEnd(state.rootTransId, $2));
         }
         | OldTransition
         ;
@@ -1981,130 +1989,191 @@ Property:
 
 #include "lexer.cc"
 
-static void utap_error(const char* msg)
+static void utap_error(YYLTYPE* loc, ParserState& state, const char* msg)
 {
-    ch->setPosition(yylloc.start, yylloc.end);
-    ch->handleError(TypeException{msg});
+    state.builder->setPosition(loc->start, loc->end);
+    state.builder->handleError(TypeException{msg});
 }
 
-static void setStartToken(xta_part_t part, bool newxta)
+static void setStartToken(ParserState& state, xta_part_t part, bool newxta)
 {
     switch (part)
     {
     case S_XTA:
-        syntax_token = newxta ? T_NEW : T_OLD;
+        state.syntax_token = newxta ? T_NEW : T_OLD;
         break;
     case S_DECLARATION:
-        syntax_token = newxta ? T_NEW_DECLARATION : T_OLD_DECLARATION;
+        state.syntax_token = newxta ? T_NEW_DECLARATION : T_OLD_DECLARATION;
         break;
     case S_LOCAL_DECL:
-        syntax_token = newxta ? T_NEW_LOCAL_DECL : T_OLD_LOCAL_DECL;
+        state.syntax_token = newxta ? T_NEW_LOCAL_DECL : T_OLD_LOCAL_DECL;
         break;
     case S_INST:
-        syntax_token = newxta ? T_NEW_INST : T_OLD_INST;
+        state.syntax_token = newxta ? T_NEW_INST : T_OLD_INST;
         break;
     case S_SYSTEM:
-        syntax_token = T_NEW_SYSTEM;
+        state.syntax_token = T_NEW_SYSTEM;
         break;
     case S_PARAMETERS:
-        syntax_token = newxta ? T_NEW_PARAMETERS : T_OLD_PARAMETERS;
+        state.syntax_token = newxta ? T_NEW_PARAMETERS : T_OLD_PARAMETERS;
         break;
     case S_INVARIANT:
-        syntax_token = newxta ? T_NEW_INVARIANT : T_OLD_INVARIANT;
+        state.syntax_token = newxta ? T_NEW_INVARIANT : T_OLD_INVARIANT;
         break;
     case S_EXPONENTIALRATE:
-	syntax_token = T_EXPONENTIALRATE;
+	state.syntax_token = T_EXPONENTIALRATE;
 	break;
     case S_SELECT:
-        syntax_token = T_NEW_SELECT;
+        state.syntax_token = T_NEW_SELECT;
         break;
     case S_GUARD:
-        syntax_token = newxta ? T_NEW_GUARD : T_OLD_GUARD;
+        state.syntax_token = newxta ? T_NEW_GUARD : T_OLD_GUARD;
         break;
     case S_SYNC:
-        syntax_token = T_NEW_SYNC;
+        state.syntax_token = T_NEW_SYNC;
         break;
     case S_ASSIGN:
-        syntax_token = newxta ? T_NEW_ASSIGN : T_OLD_ASSIGN;
+        state.syntax_token = newxta ? T_NEW_ASSIGN : T_OLD_ASSIGN;
         break;
     case S_EXPRESSION:
-        syntax_token = T_EXPRESSION;
+        state.syntax_token = T_EXPRESSION;
         break;
     case S_EXPRESSION_LIST:
-        syntax_token = T_EXPRESSION_LIST;
+        state.syntax_token = T_EXPRESSION_LIST;
         break;
     case S_PROPERTY:
-        syntax_token = T_PROPERTY;
+        state.syntax_token = T_PROPERTY;
         break;
     case S_XTA_PROCESS:
-        syntax_token = T_XTA_PROCESS;
+        state.syntax_token = T_XTA_PROCESS;
         break;
     case S_PROBABILITY:
-        syntax_token = T_PROBABILITY;
+        state.syntax_token = T_PROBABILITY;
         break;
     // LSC
     case S_INSTANCELINE:
-        syntax_token = T_INSTANCELINE;
+        state.syntax_token = T_INSTANCELINE;
         break;
     case S_MESSAGE:
-        syntax_token = T_MESSAGE;
+        state.syntax_token = T_MESSAGE;
         break;
     case S_UPDATE:
-        syntax_token = T_UPDATE;
+        state.syntax_token = T_UPDATE;
         break;
     case S_CONDITION:
-        syntax_token = T_CONDITION;
+        state.syntax_token = T_CONDITION;
         break;
     }
 }
 
-static int32_t parseXTA(ParserBuilder *aParserBuilder,
-        		bool newxta, xta_part_t part, std::string xpath)
+/**
+ * Parses the input of an already initialized scanner: the lexer and the
+ * parser keep all their state in \a state so that independent parses
+ * may run concurrently.
+ */
+static int32_t parse(ParserState& state, xta_part_t part, bool newxta, const std::string& xpath)
 {
-    // Select syntax
-    syntax = newxta ? syntax_t::NEW_GUIDING : syntax_t::OLD_GUIDING;
-    setStartToken(part, newxta);
-
-    // Set parser builder
-    ch = aParserBuilder;
+    auto phase = Statistics::Phase{Statistics::PARSER};
+    // Rather than two clock readings per builder call, the semantic actions reduced on a token are timed
+    // together from their first builder call until the next token is lexed
+    auto actions = std::optional<Statistics::Phase>{};
+    state.actions = &actions;
+    setStartToken(state, part, newxta);
 
     // Reset position tracking
-    tracker.setPath(ch, xpath);
-
-    // Parse string
-    int res = 0;
+    state.tracker.setPath(state.builder, xpath);
 
-    if (utap_parse())
-    {
-        res = -1;
-    }
-
-    ch = NULL;
+    const auto res = utap_parse(state) ? -1 : 0;
+    state.actions = nullptr;
     return res;
 }
 
-static int32_t parseProperty(ParserBuilder *aParserBuilder, const std::string& xpath)
+/**
+ * Flex scans its buffer in place and needs two terminating NUL
+ * characters, so the text is copied once into a buffer owned by the
+ * thread and reused between parses, instead of into a fresh allocation
+ * per parse as yy_scan_string does. A nested parse on the same thread
+ * (e.g. from a builder callback) gets a buffer of its own. The texts of
+ * XML documents are const buffers of libxml, thus need this copy, while
+ * parseXTAFile scans a copy-on-write mapping of the file instead.
+ */
+class ScanBuffer
 {
-    // Select syntax
-    syntax = syntax_t::PROPERTY;
-    setStartToken(S_PROPERTY, false);
+    static inline thread_local std::vector<char> shared;
+    static inline thread_local bool busy = false;
+    static constexpr size_t keep = 1 << 20;  // do not hold on to larger buffers
+    std::vector<char> own;
+    std::vector<char>& buffer;
+    bool owner;
+public:
+    explicit ScanBuffer(std::string_view text): buffer{busy ? own : shared}, owner{!busy}
+    {
+        busy = true;
+        buffer.resize(text.size() + 2);
+        std::copy(text.begin(), text.end(), buffer.begin());
+        buffer[text.size()] = buffer[text.size() + 1] = '\0';
+    }
+    ScanBuffer(const ScanBuffer&) = delete;
+    ScanBuffer& operator=(const ScanBuffer&) = delete;
+    ~ScanBuffer() noexcept
+    {
+        if (owner) {
+            busy = false;
+            if (buffer.capacity() > keep)
+                std::vector<char>{}.swap(buffer);
+        }
+    }
+    char* data() { return buffer.data(); }
+    size_t size() const { return buffer.size(); }
+};
 
-    // Set parser builder
-    ch = aParserBuilder;
+/** Owns the flex scanner of a parser state for the duration of a parse. */
+class Scanner
+{
+    ParserState& state;
+    std::optional<ScanBuffer> text;
+public:
+    explicit Scanner(ParserState& state): state{state}
+    {
+        if (utap_lex_init_extra(&state, &state.scanner) != 0)
+            throw std::runtime_error("Failed to initialize the lexer");
+    }
+    Scanner(const Scanner&) = delete;
+    Scanner& operator=(const Scanner&) = delete;
+    ~Scanner() noexcept
+    {
+        utap_lex_destroy(state.scanner);
+        state.scanner = nullptr;
+    }
+    void scan(std::string_view str)
+    {
+        text.emplace(str);
+        utap__scan_buffer(text->data(), text->size(), state.scanner);
+    }
+    /** Scans the buffer in place; it ends with two NUL characters, which \a size includes. */
+    void scan(char* buffer, size_t size) { utap__scan_buffer(buffer, size, state.scanner); }
+    void scan(FILE* file) { utap_set_in(file, state.scanner); }
+};
 
-    // Reset position tracking
-    tracker.setPath(ch, xpath);
+static syntax_t selectSyntax(bool newxta)
+{
+    return newxta ? syntax_t::NEW_GUIDING : syntax_t::OLD_GUIDING;
+}
 
-    return utap_parse() ? -1 : 0;
+int32_t parseXTA(std::string_view str, ParserBuilder *builder, PositionTracker& tracker,
+                 bool newxta, xta_part_t part, const std::string& xpath)
+{
+    auto state = ParserState{builder, tracker, selectSyntax(newxta)};
+    auto scanner = Scanner{state};
+    scanner.scan(str);
+    return parse(state, part, newxta, xpath);
 }
 
-int32_t parseXTA(const char *str, ParserBuilder *builder,
+int32_t parseXTA(std::string_view str, ParserBuilder *builder,
         	 bool newxta, xta_part_t part, std::string xpath)
 {
-    utap__scan_string(str);
-    int32_t res = parseXTA(builder, newxta, part, xpath);
-    utap__delete_buffer(YY_CURRENT_BUFFER);
-    return res;
+    auto tracker = PositionTracker{};
+    return parseXTA(str, builder, tracker, newxta, part, xpath);
 }
 
 const char* utap_builtin_declarations() {
@@ -2142,35 +2211,114 @@ return
 ;
 }
 
+/**
+ * The builtin declarations are the same for every document, so they are
+ * lexed and parsed once per process and the recorded builder calls are
+ * replayed into the builder of each document.
+ */
+struct Builtins
+{
+    RecordingBuilder calls{std::make_shared<RecordingBuilder::names_t>(), nullptr};
+    uint32_t position{0};
+    uint32_t offset{0};
+    uint32_t line{1};
+};
+
+/** Parses the builtin declarations with the tracker already at the start of the text. */
+static int32_t parseBuiltinText(ParserBuilder* builder, PositionTracker& tracker)
+{
+    auto state = ParserState{builder, tracker, syntax_t::NEW_GUIDING};
+    auto scanner = Scanner{state};
+    scanner.scan(utap_builtin_declarations());
+    setStartToken(state, S_DECLARATION, true);
+    return utap_parse(state) ? -1 : 0;
+}
+
+static const Builtins& builtins()
+{
+    static const auto recorded = [] {
+        auto res = std::make_unique<Builtins>();
+        auto tracker = PositionTracker{0};
+        parseBuiltinText(&res->calls, tracker);
+        res->position = tracker.position;
+        res->offset = tracker.offset;
+        res->line = tracker.line;
+        return res;
+    }();
+    return *recorded;
+}
+
+int32_t parseBuiltins(ParserBuilder* builder, PositionTracker& tracker, const std::string& xpath)
+{
+    auto phase = Statistics::Phase{Statistics::BUILTINS};
+    const auto& recorded = builtins();
+    tracker.setPath(builder, xpath);
+    const auto shift = tracker.position;
+    const auto replayed = recorded.calls.replay(*builder, shift);
+    if (replayed < recorded.calls.size()) {
+        /* The builder already knows some of the names: parse again skipping the calls already replayed. */
+        auto rest = RecordingBuilder{*builder, replayed};
+        return parseBuiltinText(&rest, tracker);
+    }
+    tracker.position = shift + recorded.position;
+    tracker.offset = recorded.offset;
+    tracker.line = recorded.line;
+    return 0;
+}
+
 int32_t parseXTA(const char *str, ParserBuilder *builder, bool newxta)
 {
+    auto tracker = PositionTracker{};
     if (newxta)
-        parseXTA(utap_builtin_declarations(), builder, newxta, S_DECLARATION, "");
-    return parseXTA(str, builder, newxta, S_XTA, "");
+        parseBuiltins(builder, tracker, "");
+    return parseXTA(str, builder, tracker, newxta, S_XTA, "");
 }
 
 int32_t parseXTA(FILE *file, ParserBuilder *builder, bool newxta)
 {
+    auto tracker = PositionTracker{};
     if (newxta)
-        parseXTA(utap_builtin_declarations(), builder, newxta, S_DECLARATION, "");
-    utap__switch_to_buffer(utap__create_buffer(file, YY_BUF_SIZE));
-    int res = parseXTA(builder, newxta, S_XTA, "");
-    utap__delete_buffer(YY_CURRENT_BUFFER);
-    return res;
+        parseBuiltins(builder, tracker, "");
+    auto state = ParserState{builder, tracker, selectSyntax(newxta)};
+    auto scanner = Scanner{state};
+    scanner.scan(file);
+    return parse(state, S_XTA, newxta, "");
+}
+
+int32_t parseXTAFile(const char* filename, ParserBuilder* builder, bool newxta)
+{
+    const auto file = MappedFile{filename, true};
+    if (!file.isMapped()) {
+        auto* stream = std::fopen(filename, "r");
+        if (stream == nullptr)
+            return -1;
+        const auto res = parseXTA(stream, builder, newxta);
+        std::fclose(stream);
+        return res;
+    }
+    auto tracker = PositionTracker{};
+    if (newxta)
+        parseBuiltins(builder, tracker, "");
+    auto state = ParserState{builder, tracker, selectSyntax(newxta)};
+    auto scanner = Scanner{state};
+    scanner.scan(file.scanBuffer(), file.view().size() + 2);
+    return parse(state, S_XTA, newxta, "");
 }
 
 int32_t parseProperty(const char *str, ParserBuilder *aParserBuilder, const std::string& xpath)
 {
-    utap__scan_string(str);
-    int32_t res = parseProperty(aParserBuilder, xpath);
-    utap__delete_buffer(YY_CURRENT_BUFFER);
-    return res;
+    auto tracker = PositionTracker{};
+    auto state = ParserState{aParserBuilder, tracker, syntax_t::PROPERTY};
+    auto scanner = Scanner{state};
+    scanner.scan(str);
+    return parse(state, S_PROPERTY, false, xpath);
 }
 
 int32_t parseProperty(FILE *file, ParserBuilder *aParserBuilder)
 {
-    utap__switch_to_buffer(utap__create_buffer(file, YY_BUF_SIZE));
-    int32_t res = parseProperty(aParserBuilder, "");
-    utap__delete_buffer(YY_CURRENT_BUFFER);
-    return res;
+    auto tracker = PositionTracker{};
+    auto state = ParserState{aParserBuilder, tracker, syntax_t::PROPERTY};
+    auto scanner = Scanner{state};
+    scanner.scan(file);
+    return parse(state, S_PROPERTY, false, "");
 }
@@ -22,6 +22,7 @@
 
 #include "utap/position.h"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 
@@ -30,41 +31,226 @@ using std::vector;
 
 using namespace UTAP;
 
-void Positions::add(uint32_t position, uint32_t offset, uint32_t line, string path)
+namespace
 {
-    if (!elements.empty() && position < elements.back().position) {
-        throw std::logic_error("Positions must be monotonically increasing");
+    /** How a line is encoded relative to its predecessor. */
+    enum delta_kind_t : uint64_t {
+        NEXT_LINE,   // same path, the offset grows with the position, the line number by one
+        NEXT_LINES,  // same as above, followed by the line number delta
+        NEW_PATH,    // followed by the path, the offset is 0 and the line number 1
+        EXPLICIT     // followed by the path, the offset and the line number
+    };
+
+    void writeVarint(vector<uint8_t>& out, uint64_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    uint64_t readVarint(const uint8_t*& next)
+    {
+        auto value = uint64_t{0};
+        auto shift = 0u;
+        uint8_t byte;
+        do {
+            byte = *next++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return value;
+    }
+
+    size_t heapSize(const string& s)
+    {
+        const auto* self = reinterpret_cast<const char*>(&s);
+        const bool inlined = self <= s.data() && s.data() < self + sizeof(s);
+        return inlined ? 0 : s.capacity() + 1;
+    }
+}  // namespace
+
+uint32_t Positions::intern(const string& path)
+{
+    if (size > 0 && path == lastPath)
+        return last.path;
+    auto node = uint32_t{0};
+    for (size_t begin = 0;;) {
+        const auto end = std::min(path.find('/', begin), path.size());
+        auto [it, inserted] = stepIndex.try_emplace(path.substr(begin, end - begin), steps.size());
+        if (inserted)
+            steps.push_back(it->first);
+        node = child(node, it->second);
+        if (end == path.size())
+            break;
+        begin = end + 1;
+    }
+    lastPath = path;
+    return node;
+}
+
+static size_t hash(uint32_t parent, uint32_t step)
+{
+    return (static_cast<uint64_t>(parent) * 0x9E3779B97F4A7C15ull) ^ (static_cast<uint64_t>(step) * 0xC2B2AE3D27D4EB4Full);
+}
+
+uint32_t Positions::child(uint32_t parent, uint32_t step)
+{
+    if (2 * nodes.size() >= slots.size()) {
+        slots.assign(std::max<size_t>(16, 2 * slots.size()), 0);
+        for (uint32_t n = 1; n < nodes.size(); ++n) {
+            auto i = hash(nodes[n].parent, nodes[n].step) & (slots.size() - 1);
+            while (slots[i] != 0)
+                i = (i + 1) & (slots.size() - 1);
+            slots[i] = n;
+        }
+    }
+    for (auto i = hash(parent, step) & (slots.size() - 1);; i = (i + 1) & (slots.size() - 1)) {
+        if (slots[i] == 0) {
+            slots[i] = static_cast<uint32_t>(nodes.size());
+            nodes.push_back({parent, step});
+            return slots[i];
+        }
+        if (const auto& node = nodes[slots[i]]; node.parent == parent && node.step == step)
+            return slots[i];
+    }
+}
+
+string Positions::getPath(uint32_t node) const
+{
+    auto path = string{};
+    for (; node != 0; node = nodes[node].parent) {
+        path.insert(0, steps[nodes[node].step]);
+        if (nodes[node].parent != 0)
+            path.insert(0, 1, '/');
     }
-    elements.emplace_back(position, offset, line, std::move(path));
+    return path;
 }
 
-const Positions::line_t& Positions::find(uint32_t position, uint32_t first, uint32_t last) const
+void Positions::encode(const entry_t& entry)
 {
-    while (first + 1 < last) {
-        uint32_t i = (first + last) / 2;
-        if (position < elements[i].position) {
-            last = i;
+    const auto delta = static_cast<uint64_t>(entry.position - last.position);
+    if (entry.path == last.path && last.offset + delta == entry.offset && entry.line > last.line) {
+        if (entry.line == last.line + 1) {
+            writeVarint(deltas, delta << 2 | NEXT_LINE);
         } else {
-            first = i;
+            writeVarint(deltas, delta << 2 | NEXT_LINES);
+            writeVarint(deltas, entry.line - last.line);
         }
+    } else if (entry.offset == 0 && entry.line == 1) {
+        writeVarint(deltas, delta << 2 | NEW_PATH);
+        writeVarint(deltas, entry.path);
+    } else {
+        writeVarint(deltas, delta << 2 | EXPLICIT);
+        writeVarint(deltas, entry.path);
+        writeVarint(deltas, entry.offset);
+        writeVarint(deltas, entry.line);
+    }
+}
+
+/** Advances \a entry to the line encoded at \a next. */
+void Positions::step(const uint8_t*& next, entry_t& entry)
+{
+    auto& [position, offset, line, path] = entry;
+    const auto head = readVarint(next);
+    const auto delta = static_cast<uint32_t>(head >> 2);
+    position += delta;
+    switch (static_cast<delta_kind_t>(head & 3)) {
+    case NEXT_LINE:
+        offset += delta;
+        line += 1;
+        break;
+    case NEXT_LINES:
+        offset += delta;
+        line += static_cast<uint32_t>(readVarint(next));
+        break;
+    case NEW_PATH:
+        path = static_cast<uint32_t>(readVarint(next));
+        offset = 0;
+        line = 1;
+        break;
+    case EXPLICIT:
+        path = static_cast<uint32_t>(readVarint(next));
+        offset = static_cast<uint32_t>(readVarint(next));
+        line = static_cast<uint32_t>(readVarint(next));
+        break;
+    }
+}
+
+void Positions::add(uint32_t position, uint32_t offset, uint32_t line, const string& path)
+{
+    if (size > 0 && position < last.position) {
+        throw std::logic_error("Positions must be monotonically increasing");
+    }
+    const auto entry = entry_t{position, offset, line, intern(path)};
+    if (size % block_size == 0) {
+        blocks.push_back({entry, static_cast<uint32_t>(deltas.size())});
+    } else {
+        encode(entry);
     }
-    return elements[first];
+    last = entry;
+    ++size;
 }
 
-const Positions::line_t& Positions::find(uint32_t position) const
+Positions::line_t Positions::find(uint32_t position) const
 {
-    if (elements.size() == 0) {
+    if (size == 0) {
         throw std::logic_error("No positions have been added");
     }
-    return find(position, 0, elements.size());
+    // The last block starting at or before position (or the first block).
+    auto block = std::upper_bound(blocks.begin(), blocks.end(), position,
+                                  [](uint32_t position, const block_t& block) { return position < block.first.position; });
+    if (block != blocks.begin())
+        --block;
+    const auto index = static_cast<uint32_t>(block - blocks.begin());
+    const auto count = std::min(block_size, size - index * block_size);
+    auto entry = block->first;
+    const auto* next = deltas.data() + block->deltas;
+    for (uint32_t i = 1; i < count; ++i) {
+        auto following = entry;
+        step(next, following);
+        if (position < following.position)
+            break;
+        entry = following;
+    }
+    return decode(entry);
+}
+
+vector<Positions::line_t> Positions::getLines() const
+{
+    auto res = vector<line_t>{};
+    res.reserve(size);
+    for (uint32_t b = 0; b < blocks.size(); ++b) {
+        auto entry = blocks[b].first;
+        const auto* next = deltas.data() + blocks[b].deltas;
+        res.push_back(decode(entry));
+        for (uint32_t i = 1; i < std::min(block_size, size - b * block_size); ++i) {
+            step(next, entry);
+            res.push_back(decode(entry));
+        }
+    }
+    return res;
+}
+
+size_t Positions::getMemoryUsage() const
+{
+    auto res = blocks.capacity() * sizeof(block_t) + deltas.capacity() + nodes.capacity() * sizeof(node_t) +
+               slots.capacity() * sizeof(uint32_t) + steps.capacity() * sizeof(string) + heapSize(lastPath);
+    for (const auto& step : steps)
+        res += heapSize(step);
+    // the nodes of the index: the key, the value, the next pointer and the cached hash
+    res += stepIndex.bucket_count() * sizeof(void*);
+    for (const auto& [step, index] : stepIndex)
+        res += sizeof(step) + sizeof(index) + 2 * sizeof(void*) + heapSize(step);
+    return res;
 }
 
 /** Dump table to stdout. */
 void Positions::dump()
 {
-    for (size_t i = 0; i < elements.size(); i++) {
-        std::cout << elements[i].position << " " << elements[i].offset << " " << elements[i].line << " "
-                  << elements[i].path << std::endl;
+    for (const auto& line : getLines()) {
+        std::cout << line.position << " " << line.offset << " " << line.line << " " << line.path << std::endl;
     }
 }
 
@@ -95,3 +281,15 @@ std::string UTAP::error_t::toString() const
                std::to_string(position.end - end.position);
     }
 }
+
+std::string_view UTAP::error_t::getCode() const
+{
+    // The key is the first word starting with $, most often the first word
+    auto begin = msg.rfind('$', 0) == 0 ? size_t{0} : msg.find(" $");
+    if (begin == std::string::npos)
+        return {};
+    if (msg[begin] == ' ')
+        ++begin;
+    const auto end = msg.find_first_of(" :", begin);
+    return std::string_view{msg}.substr(begin, end == std::string::npos ? end : end - begin);
+}
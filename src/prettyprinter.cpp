@@ -19,12 +19,13 @@
    USA
 */
 
+
 #include "utap/prettyprinter.h"
 
+#include <algorithm>
 #include <array>
 #include <iostream>
 #include <sstream>
-#include <stack>
 #include <stdexcept>
 #include <cassert>
 #include <charconv>
@@ -33,39 +34,166 @@
 using namespace UTAP;
 using namespace UTAP::Constants;
 
-using std::stack;
 using std::string;
 using std::ostream;
-using std::endl;
-using std::ostringstream;
 using std::stringstream;
 
 static const char* const prefix_label[] = {"", "const ", "urgent ", "", "broadcast ", "", "urgent broadcast ",
                                            "", "meta "};
 
-void PrettyPrinter::indent()
+static constexpr size_t flushSize = 64 * 1024;     // top level text written at once
+static constexpr size_t compactSize = 1024 * 1024;  // least size of the fragment buffer before it is rebuilt
+
+PrettyPrinter::fragment_t PrettyPrinter::text(std::string_view s)
+{
+    const auto index = static_cast<uint32_t>(pieces.size());
+    pieces.push_back({static_cast<uint32_t>(chars.size()), static_cast<uint32_t>(s.size()), npos});
+    chars.append(s);
+    return {index, index};
+}
+
+PrettyPrinter::fragment_t PrettyPrinter::join(fragment_t head, fragment_t tail)
+{
+    pieces[head.last].next = tail.first;
+    return {head.first, tail.last};
+}
+
+template <typename... Parts>
+PrettyPrinter::fragment_t PrettyPrinter::cat(const Parts&... parts)
+{
+    const fragment_t fragments[] = {text(parts)...};
+    auto res = fragments[0];
+    for (size_t i = 1; i < sizeof...(parts); ++i)
+        res = join(res, fragments[i]);
+    return res;
+}
+
+string PrettyPrinter::str(fragment_t f) const
+{
+    auto res = string{};
+    for (auto i = f.first;; i = pieces[i].next) {
+        res.append(chars, pieces[i].offset, pieces[i].length);
+        if (i == f.last)
+            break;
+    }
+    return res;
+}
+
+void PrettyPrinter::push(fragment_t f)
 {
-    for (uint32_t i = 0; i < level; i++) {
-        *o.top() << '\t';
+    st.push_back(f);
+    if (chars.size() + pieces.size() * sizeof(piece_t) > compactAt)
+        compact();
+}
+
+PrettyPrinter::fragment_t PrettyPrinter::pop()
+{
+    assert(!st.empty());
+    auto f = st.back();
+    st.pop_back();
+    return f;
+}
+
+PrettyPrinter::fragment_t PrettyPrinter::popList(uint32_t n, std::string_view open, std::string_view separator,
+                                                 std::string_view close)
+{
+    assert(st.size() >= n);
+    const auto begin = st.size() - n;
+    auto res = text(open);
+    for (auto i = begin; i < st.size(); ++i) {
+        if (i > begin)
+            res = join(res, text(separator));
+        res = join(res, st[i]);
+    }
+    st.resize(begin);
+    return join(res, text(close));
+}
+
+/**
+ * Fragments that were popped leave their text behind, so once the
+ * buffer has grown enough, the text of the live fragments (pending
+ * expressions and statement bodies) is copied into a new one.
+ */
+void PrettyPrinter::compact()
+{
+    auto oldChars = std::move(chars);
+    auto oldPieces = std::move(pieces);
+    chars.clear();
+    pieces.clear();
+    auto copy = [&](fragment_t f) {
+        const auto start = chars.size();
+        for (auto i = f.first;; i = oldPieces[i].next) {
+            chars.append(oldChars, oldPieces[i].offset, oldPieces[i].length);
+            if (i == f.last)
+                break;
+        }
+        const auto index = static_cast<uint32_t>(pieces.size());
+        pieces.push_back({static_cast<uint32_t>(start), static_cast<uint32_t>(chars.size() - start), npos});
+        return fragment_t{index, index};
+    };
+    for (auto& f : st)
+        f = copy(f);
+    for (auto& f : body)
+        f = copy(f);
+    compactAt = std::max(compactSize, 2 * (chars.size() + pieces.size() * sizeof(piece_t)));
+}
+
+void PrettyPrinter::emit(std::string_view s)
+{
+    if (body.empty()) {
+        buffer.append(s);
+        if (buffer.size() >= flushSize)
+            flush();
+    } else {
+        body.back() = join(body.back(), text(s));
     }
 }
 
-void PrettyPrinter::indent(string& s)
+void PrettyPrinter::emit(fragment_t f)
 {
-    for (uint32_t i = 0; i < level; i++) {
-        s += '\t';
+    if (body.empty()) {
+        for (auto i = f.first;; i = pieces[i].next) {
+            buffer.append(chars, pieces[i].offset, pieces[i].length);
+            if (i == f.last)
+                break;
+        }
+        if (buffer.size() >= flushSize)
+            flush();
+    } else {
+        body.back() = join(body.back(), f);
     }
 }
 
-PrettyPrinter::PrettyPrinter(ostream& stream)
+template <typename... Parts>
+void PrettyPrinter::write(const Parts&... parts)
+{
+    (emit(parts), ...);
+}
+
+void PrettyPrinter::flush()
 {
-    o.push(&stream);
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+}
+
+void PrettyPrinter::indent() { emit(string(level, '\t')); }
 
+PrettyPrinter::PrettyPrinter(ostream& stream): stream{stream}, compactAt{compactSize}
+{
     first = true;
     level = 0;
     select = guard = sync = update = probability = -1;
 }
 
+PrettyPrinter::~PrettyPrinter() noexcept
+{
+    // keep what was printed before an error
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
 void PrettyPrinter::addPosition(uint32_t position, uint32_t offset, uint32_t line, const std::string& path) {}
 
 void PrettyPrinter::handleError(const TypeException& msg) { throw msg; }
@@ -114,10 +242,8 @@ void PrettyPrinter::typeDouble(PREFIX prefix)
 void PrettyPrinter::typeBoundedInt(PREFIX prefix)
 {
     string l, u;
-    u = st.back();
-    st.pop_back();
-    l = st.back();
-    st.pop_back();
+    u = str(pop());
+    l = str(pop());
 
     string res;
     res += prefix_label[prefix];
@@ -133,8 +259,7 @@ void PrettyPrinter::typeVoid() { type.push("void"); }
 
 void PrettyPrinter::typeScalar(PREFIX prefix)
 {
-    string size = st.back();
-    st.pop_back();
+    string size = str(pop());
     string res;
     res += prefix_label[prefix];
     res += "scalar[" + size + "]";
@@ -149,11 +274,7 @@ void PrettyPrinter::typeName(PREFIX prefix, const char* name)
     type.push(res);
 }
 
-void PrettyPrinter::typeArrayOfSize(size_t n)
-{
-    array.push(st.back());
-    st.pop_back();
-}
+void PrettyPrinter::typeArrayOfSize(size_t n) { array.push(str(pop())); }
 
 void PrettyPrinter::typeArrayOfType(size_t n)
 {
@@ -189,61 +310,46 @@ void PrettyPrinter::structField(const char* name)
 void PrettyPrinter::declTypeDef(const char* name)
 {
     indent();
-    *o.top() << "typedef " << type.top() << " " << name;
+    write("typedef ", type.top(), " ", name);
     type.pop();
 
     while (!array.empty()) {
-        *o.top() << '[' << array.top() << ']';
+        write('[', array.top(), ']');
         array.pop();
     }
 
-    *o.top() << ';' << endl;
+    write(";\n");
 
     types.insert(name);
 }
 
 void PrettyPrinter::declVar(const char* id, bool init)
 {
-    string i;
+    fragment_t i{};
 
     if (init) {
-        i = st.back();
-        st.pop_back();
+        i = pop();
     }
 
     indent();
-    *o.top() << type.top() << ' ' << id;
+    write(type.top(), ' ', id);
     type.pop();
 
     while (!array.empty()) {
-        *o.top() << '[' << array.top() << ']';
+        write('[', array.top(), ']');
         array.pop();
     }
 
     if (init) {
-        *o.top() << " = " << i;
+        write(" = ", i);
     }
 
-    *o.top() << ';' << endl;
+    write(";\n");
 }
 
-void PrettyPrinter::declInitialiserList(uint32_t num)
-{
-    string s = st.back();
-    st.pop_back();
-    while (--num) {
-        s = st.back() + ", " + s;
-        st.pop_back();
-    }
-    st.push_back("{ " + s + " }");
-}
+void PrettyPrinter::declInitialiserList(uint32_t num) { push(popList(num, "{ ", ", ", " }")); }
 
-void PrettyPrinter::exprScenario(const char* name)
-{
-    string s = "scenario:";
-    s += name;
-    st.push_back(s);
-}
+void PrettyPrinter::exprScenario(const char* name) { push(cat("scenario:", name)); }
 
 void PrettyPrinter::exprNary(kind_t kind, uint32_t num)
 {
@@ -253,19 +359,13 @@ void PrettyPrinter::exprNary(kind_t kind, uint32_t num)
     default: throw TypeException("Invalid operator");
     }
 
-    string s = st.back();
-    st.pop_back();
-    while (--num) {
-        s = st.back() + opString + s;
-        st.pop_back();
-    }
-    st.push_back("{ " + s + " }");
+    push(popList(num, "{ ", opString, " }"));
 }
 
 void PrettyPrinter::declFieldInit(const char* name)
 {
     if (name && strlen(name)) {
-        st.back() = string(name) + ": " + st.back();
+        st.back() = cat(name, ": ", st.back());
     }
 }
 
@@ -289,9 +389,9 @@ void PrettyPrinter::declParameter(const char* name, bool ref)
 void PrettyPrinter::declFuncBegin(const char* name)
 {
     indent();
-    *o.top() << type.top() << " " << name << "(" << param << ")" << endl;
+    write(type.top(), " ", name, "(", param, ")\n");
     indent();
-    *o.top() << "{" << endl;
+    write("{\n");
     param.clear();
     level++;
     type.pop();
@@ -301,7 +401,7 @@ void PrettyPrinter::declFuncEnd()
 {
     level--;
     indent();
-    *o.top() << "}" << endl;
+    write("}\n");
 }
 
 void PrettyPrinter::dynamicLoadLib(const char* name) {}
@@ -312,7 +412,7 @@ void PrettyPrinter::blockBegin()
 {
     level--;
     indent();
-    *o.top() << "{" << endl;
+    write("{\n");
     level++;
 }
 
@@ -321,70 +421,64 @@ void PrettyPrinter::blockEnd()
     level--;  // The level delimiters are indented one level less
     indent();
     level++;
-    *o.top() << "}" << endl;
+    write("}\n");
 }
 
 void PrettyPrinter::emptyStatement()
 {
     indent();
-    *o.top() << ';' << endl;
+    write(";\n");
 }
 
 void PrettyPrinter::iterationBegin(const char* id)
 {
     indent();
-    *o.top() << "for ( " << id << " : " << type.top() << " )" << endl;
+    write("for ( ", id, " : ", type.top(), " )\n");
     level++;
     type.pop();
 }
 
 void PrettyPrinter::iterationEnd(const char* id)
 {
-    *o.top() << endl;
+    write('\n');
     level--;
 }
 
 void PrettyPrinter::forBegin()
 {
     level++;
-    o.push(new ostringstream());
+    body.push_back(text(""));
 }
 
 void PrettyPrinter::forEnd()  // 3 expr, 1 stat
 {
-    string expr3 = st.back();
-    st.pop_back();
-    string expr2 = st.back();
-    st.pop_back();
-    string expr1 = st.back();
-    st.pop_back();
-    ostringstream* s = (ostringstream*)o.top();
-    o.pop();
+    auto expr3 = pop();
+    auto expr2 = pop();
+    auto expr1 = pop();
+    auto s = body.back();
+    body.pop_back();
 
     level--;
     indent();
-    *o.top() << "for ( " << expr1 << "; " << expr2 << "; " << expr3 << ")" << endl << s->str() << endl;
-    delete s;
+    write("for ( ", expr1, "; ", expr2, "; ", expr3, ")\n", s, '\n');
 }
 
 void PrettyPrinter::whileBegin()
 {
     level++;
-    o.push(new ostringstream());
+    body.push_back(text(""));
 }
 
 void PrettyPrinter::whileEnd()  // 1 expr, 1 stat
 {
-    string expr = st.back();
-    st.pop_back();
-    ostringstream* s = (ostringstream*)o.top();
-    o.pop();
+    auto expr = pop();
+    auto s = body.back();
+    body.pop_back();
 
     level--;
     indent();
 
-    *o.top() << "while (" << expr << ")" << endl << s->str() << endl;
-    delete s;
+    write("while (", expr, ")\n", s, '\n');
 }
 
 void PrettyPrinter::doWhileBegin() {}
@@ -394,70 +488,64 @@ void PrettyPrinter::doWhileEnd() {}
 void PrettyPrinter::ifBegin()
 {
     level++;
-    o.push(new ostringstream());  // prepare for THEN statement
+    body.push_back(text(""));  // prepare for THEN statement
 }
 
 void PrettyPrinter::ifCondition() {}
 
 void PrettyPrinter::ifThen()
 {
-    o.push(new ostringstream());  // prepare for ELSE statement
+    body.push_back(text(""));  // prepare for ELSE statement
 }
 
 void PrettyPrinter::ifEnd(bool hasElse)  // 1 expr, 1 or 2 statements
 {
-    auto e = static_cast<ostringstream*>(o.top());
-    o.pop();  // ELSE
-    auto t = static_cast<ostringstream*>(o.top());
-    o.pop();  // THEN
-    auto c = st.back();
-    st.pop_back();  // COND
+    auto e = body.back();
+    body.pop_back();  // ELSE
+    auto t = body.back();
+    body.pop_back();  // THEN
+    auto c = pop();   // COND
 
     level--;
     indent();
-    *o.top() << "if (" << c << ")" << endl << t->str();
-    delete t;
+    write("if (", c, ")\n", t);
     if (hasElse) {
         indent();
-        *o.top() << "else" << endl;
-        *o.top() << e->str();
+        write("else\n", e);
     }
-    delete e;
 }
 
 void PrettyPrinter::breakStatement()
 {
     indent();
-    *o.top() << "break;" << endl;
+    write("break;\n");
 }
 
 void PrettyPrinter::continueStatement()
 {
     indent();
-    *o.top() << "continue;" << endl;
+    write("continue;\n");
 }
 
 void PrettyPrinter::exprStatement()
 {
     indent();
-    *o.top() << st.back() << ';' << endl;
-    st.pop_back();
+    write(pop(), ";\n");
 }
 
 void PrettyPrinter::returnStatement(bool hasValue)
 {
     indent();
     if (hasValue) {
-        *o.top() << "return " << st.back() << ";" << endl;
-        st.pop_back();
+        write("return ", pop(), ";\n");
     } else {
-        *o.top() << "return;" << endl;
+        write("return;\n");
     }
 }
 
 void PrettyPrinter::procBegin(const char* id, const bool isTA, const string& type, const string& mode)
 {
-    *o.top() << "process " << (id ? id : "") << templateset << '(' << param << ")" << endl << "{" << endl;
+    write("process ", (id ? id : ""), templateset, '(', param, ")\n{\n");
     param.clear();
     templateset = "";
 
@@ -469,29 +557,27 @@ void PrettyPrinter::procState(const char* id, bool hasInvariant, bool hasExpRate
     if (first) {
         first = false;
         indent();
-        *o.top() << "state\n";
+        write("state\n");
     } else {
-        *o.top() << ",\n";
+        write(",\n");
     }
 
     level++;
     indent();
     level--;
 
-    *o.top() << id;
-    string expRate;  // pop expressions from stack in reverse order
+    write(id);
+    fragment_t expRate{};  // pop expressions from stack in reverse order
     if (hasExpRate) {
-        expRate = st.back();
-        st.pop_back();
+        expRate = pop();
     }
     if (hasInvariant) {
-        *o.top() << " {" << st.back();
-        st.pop_back();
+        write(" {", pop());
         if (hasExpRate)
-            *o.top() << " ; " << expRate;
-        *o.top() << "}";
+            write(" ; ", expRate);
+        write("}");
     } else if (hasExpRate) {
-        *o.top() << " { ; " << expRate << "}";
+        write(" { ; ", expRate, "}");
     }
 }
 
@@ -519,28 +605,28 @@ void PrettyPrinter::procStateCommit(const char* id)
 void PrettyPrinter::procStateInit(const char* id)
 {
     first = true;
-    *o.top() << ";" << endl;  // end of states
+    write(";\n");  // end of states
 
     if (!branchpoints.empty()) {
         indent();
-        *o.top() << "branchpoint " << branchpoints << ';' << endl;
+        write("branchpoint ", branchpoints, ";\n");
         branchpoints.clear();
     }
 
     if (!committed.empty()) {
         indent();
-        *o.top() << "commit " << committed << ';' << endl;
+        write("commit ", committed, ";\n");
         committed.clear();
     }
 
     if (!urgent.empty()) {
         indent();
-        *o.top() << "urgent " << urgent << ';' << endl;
+        write("urgent ", urgent, ";\n");
         urgent.clear();
     }
 
     indent();
-    *o.top() << "init " << id << ';' << endl;
+    write("init ", id, ";\n");
 }
 
 void PrettyPrinter::procSelect(const char* id)
@@ -548,10 +634,10 @@ void PrettyPrinter::procSelect(const char* id)
     string t = type.top();
     type.pop();
     if (select == -1) {
-        st.push_back(string(id) + ":" + t);
+        push(cat(id, ":", t));
         select = st.size();
     } else {
-        st.back() += string(", ") + id + ":" + t;
+        st.back() = cat(st.back(), ", ", id, ":", t);
     }
 }
 
@@ -560,8 +646,8 @@ void PrettyPrinter::procGuard() { guard = st.size(); }
 void PrettyPrinter::procSync(synchronisation_t type)
 {
     switch (type) {
-    case SYNC_QUE: st.back() += '?'; break;
-    case SYNC_BANG: st.back() += '!'; break;
+    case SYNC_QUE: st.back() = cat(st.back(), '?'); break;
+    case SYNC_BANG: st.back() = cat(st.back(), '!'); break;
     case SYNC_CSP:
         // no append
         break;
@@ -586,19 +672,19 @@ void PrettyPrinter::procEdgeBegin(const char* source, const char* target, const
         first = false;
 
         indent();
-        *o.top() << "trans" << endl;
+        write("trans\n");
 
         level++;
     } else {
-        *o.top() << ',' << endl;
+        write(",\n");
     }
     indent();
 
-    *o.top() << source << (control ? " -> " : " -u-> ") << target << " {" << endl;
+    write(source, (control ? " -> " : " -u-> "), target, " {\n");
     if (actname != NULL) {
         level++;
         indent();
-        *o.top() << "action " << actname << ";" << endl;
+        write("action ", actname, ";\n");
         level--;
     }
 }
@@ -609,27 +695,27 @@ void PrettyPrinter::procEdgeEnd(const char* source, const char* target)
 
     if (select > -1) {
         indent();
-        *o.top() << "select " << st[select - 1] << ';' << endl;
+        write("select ", st[select - 1], ";\n");
     }
 
     if (guard > -1) {
         indent();
-        *o.top() << "guard " << st[guard - 1] << ';' << endl;
+        write("guard ", st[guard - 1], ";\n");
     }
 
     if (sync > -1) {
         indent();
-        *o.top() << "sync " << st[sync - 1] << ';' << endl;
+        write("sync ", st[sync - 1], ";\n");
     }
 
     if (update > -1) {
         indent();
-        *o.top() << "assign " << st[update - 1] << ';' << endl;
+        write("assign ", st[update - 1], ";\n");
     }
 
     if (probability > -1) {
         indent();
-        *o.top() << "probability " << st[probability - 1] << ';' << endl;
+        write("probability ", st[probability - 1], ";\n");
     }
 
     level--;
@@ -648,21 +734,21 @@ void PrettyPrinter::procEdgeEnd(const char* source, const char* target)
     probability = update = sync = guard = select = -1;
 
     indent();
-    *o.top() << '}';
+    write('}');
 }
 
 void PrettyPrinter::procEnd()
 {
     if (!first) {
-        *o.top() << ';' << endl;
+        write(";\n");
         level--;
         first = true;
     }
     level--;
-    *o.top() << '}' << endl << endl;
+    write("}\n\n");
 }
 
-void PrettyPrinter::exprId(const char* id) { st.push_back(id); }
+void PrettyPrinter::exprId(const char* id) { push(text(id)); }
 
 void PrettyPrinter::exprNat(int32_t n)
 {
@@ -670,12 +756,12 @@ void PrettyPrinter::exprNat(int32_t n)
     if (20 <= snprintf(s, 20, "%d", n)) {
         fprintf(stderr, "Error: the integer number was truncated\n");
     }
-    st.push_back(s);
+    push(text(s));
 }
 
-void PrettyPrinter::exprTrue() { st.push_back("true"); }
+void PrettyPrinter::exprTrue() { push(text("true")); }
 
-void PrettyPrinter::exprFalse() { st.push_back("false"); }
+void PrettyPrinter::exprFalse() { push(text("false")); }
 
 void PrettyPrinter::exprDouble(double d)
 {
@@ -688,40 +774,32 @@ void PrettyPrinter::exprDouble(double d)
     if (auto [_, ec] = std::to_chars(s.begin(), s.end(), d, std::chars_format::general, 52); ec != std::errc{})
         throw std::runtime_error{std::make_error_code(ec).message()};
 #endif
-    st.emplace_back(s.data());
+    push(text(s.data()));
 }
 
-void PrettyPrinter::exprString(const char* val) { st.emplace_back(val); }
+void PrettyPrinter::exprString(const char* val) { push(text(val)); }
 
-void PrettyPrinter::exprCallBegin() { st.back() += "("; }
+void PrettyPrinter::exprCallBegin() { st.back() = cat(st.back(), '('); }
 
 void PrettyPrinter::exprCallEnd(uint32_t n)
 {
-    string s = ")";
-    while (n--) {
-        s = st.back() + s;
-        st.pop_back();
-        if (n > 0) {
-            s = ", " + s;
-        }
-    }
-    st.back() += s;
+    auto args = popList(n, "", ", ", ")");
+    st.back() = join(st.back(), args);
 }
 
 void PrettyPrinter::exprArray()
 {
-    string f = st.back();
-    st.pop_back();
-    st.back() += '[' + f + ']';
+    auto f = pop();
+    st.back() = cat(st.back(), '[', f, ']');
 }
 
-void PrettyPrinter::exprPostIncrement() { st.back() += "++"; }
+void PrettyPrinter::exprPostIncrement() { st.back() = cat(st.back(), "++"); }
 
-void PrettyPrinter::exprPreIncrement() { st.back() = "++" + st.back(); }
+void PrettyPrinter::exprPreIncrement() { st.back() = cat("++", st.back()); }
 
-void PrettyPrinter::exprPostDecrement() { st.back() += "--"; }
+void PrettyPrinter::exprPostDecrement() { st.back() = cat(st.back(), "--"); }
 
-void PrettyPrinter::exprPreDecrement() { st.back() = "--" + st.back(); }
+void PrettyPrinter::exprPreDecrement() { st.back() = cat("--", st.back()); }
 
 static const char* getBuiltinFunName(kind_t kind)
 {
@@ -795,213 +873,185 @@ static const char* getBuiltinFunName(kind_t kind)
 
 void PrettyPrinter::exprBuiltinFunction1(kind_t kind)
 {
-    st.back() = string(getBuiltinFunName(kind)) + '(' + st.back() + ')';
+    st.back() = cat(getBuiltinFunName(kind), '(', st.back(), ')');
 }
 
 void PrettyPrinter::exprBuiltinFunction2(kind_t kind)
 {
-    auto arg2 = st.back();
-    st.pop_back();
-    st.back() = string(getBuiltinFunName(kind)) + '(' + st.back() + ',' + arg2 + ')';
+    auto arg2 = pop();
+    st.back() = cat(getBuiltinFunName(kind), '(', st.back(), ',', arg2, ')');
 }
 
 void PrettyPrinter::exprBuiltinFunction3(kind_t kind)
 {
-    auto arg3 = st.back();
-    st.pop_back();
-    auto arg2 = st.back();
-    st.pop_back();
-    st.back() = string(getBuiltinFunName(kind)) + '(' + st.back() + ',' + arg2 + ',' + arg3 + ')';
+    auto arg3 = pop();
+    auto arg2 = pop();
+    st.back() = cat(getBuiltinFunName(kind), '(', st.back(), ',', arg2, ',', arg3, ')');
 }
 
 void PrettyPrinter::exprAssignment(kind_t op)
 {
-    string rhs = st.back();
-    st.pop_back();
-    string lhs = st.back();
-    st.pop_back();
+    auto rhs = pop();
+    auto lhs = pop();
 
-    st.push_back(string());
+    const char* opString = NULL;
     switch (op) {
-    case ASSIGN: st.back() = '(' + lhs + " = " + rhs + ')'; break;
-    case ASSPLUS: st.back() = '(' + lhs + " += " + rhs + ')'; break;
-    case ASSMINUS: st.back() = '(' + lhs + " -= " + rhs + ')'; break;
-    case ASSMULT: st.back() = '(' + lhs + " *= " + rhs + ')'; break;
-    case ASSDIV: st.back() = '(' + lhs + " /= " + rhs + ')'; break;
-    case ASSMOD: st.back() = '(' + lhs + " %= " + rhs + ')'; break;
-    case ASSOR: st.back() = '(' + lhs + " |= " + rhs + ')'; break;
-    case ASSAND: st.back() = '(' + lhs + " &= " + rhs + ')'; break;
-    case ASSXOR: st.back() = '(' + lhs + " ^= " + rhs + ')'; break;
-    case ASSLSHIFT: st.back() = '(' + lhs + " <<= " + rhs + ')'; break;
-    case ASSRSHIFT: st.back() = '(' + lhs + " >>= " + rhs + ')'; break;
+    case ASSIGN: opString = " = "; break;
+    case ASSPLUS: opString = " += "; break;
+    case ASSMINUS: opString = " -= "; break;
+    case ASSMULT: opString = " *= "; break;
+    case ASSDIV: opString = " /= "; break;
+    case ASSMOD: opString = " %= "; break;
+    case ASSOR: opString = " |= "; break;
+    case ASSAND: opString = " &= "; break;
+    case ASSXOR: opString = " ^= "; break;
+    case ASSLSHIFT: opString = " <<= "; break;
+    case ASSRSHIFT: opString = " >>= "; break;
     default: throw TypeException("Invalid assignment operator");
     }
+    push(cat('(', lhs, opString, rhs, ')'));
 }
 
 void PrettyPrinter::exprUnary(kind_t op)
 {
-    string exp = st.back();
-    st.pop_back();
+    auto exp = pop();
 
-    st.push_back(string());
     switch (op) {
-    case MINUS: st.back() = '-' + exp; break;
-    case NOT: st.back() = '!' + exp; break;
-    case PLUS: st.back() = '+' + exp; break;
-    case RATE: st.back() = exp + '\''; break;
-    case CONTROL_TOPT_DEF2: st.back() = "control_t*: " + exp; break;
-    case CONTROL: st.back() = "control: " + exp; break;
-    case EF_CONTROL: st.back() = "E<> control: " + exp; break;
+    case MINUS: push(cat('-', exp)); break;
+    case NOT: push(cat('!', exp)); break;
+    case PLUS: push(cat('+', exp)); break;
+    case RATE: push(cat(exp, '\'')); break;
+    case CONTROL_TOPT_DEF2: push(cat("control_t*: ", exp)); break;
+    case CONTROL: push(cat("control: ", exp)); break;
+    case EF_CONTROL: push(cat("E<> control: ", exp)); break;
     default: throw TypeException("Invalid operator");
     }
 }
 
 void PrettyPrinter::exprBinary(kind_t op)
 {
-    string exp2 = st.back();
-    st.pop_back();
-    string exp1 = st.back();
-    st.pop_back();
+    auto exp2 = pop();
+    auto exp1 = pop();
 
-    st.push_back(string());
+    const char* opString = NULL;
     switch (op) {
-    case PO_CONTROL: st.back() = exp1 + " control: " + exp2; break;
-    case CONTROL_TOPT_DEF1: st.back() = "control_t*(" + exp1 + "): " + exp2; break;
-    case PLUS: st.back() = '(' + exp1 + " + " + exp2 + ')'; break;
-    case MINUS: st.back() = '(' + exp1 + " - " + exp2 + ')'; break;
-    case MULT: st.back() = '(' + exp1 + " * " + exp2 + ')'; break;
-    case DIV: st.back() = '(' + exp1 + " / " + exp2 + ')'; break;
-    case MOD: st.back() = '(' + exp1 + " % " + exp2 + ')'; break;
-    case POW: st.back() = '(' + exp1 + " ** " + exp2 + ')'; break;
-    case FRACTION: st.back() = '(' + exp1 + " : " + exp2 + ')'; break;
-    case MIN: st.back() = '(' + exp1 + " <? " + exp2 + ')'; break;
-    case MAX: st.back() = '(' + exp1 + " >? " + exp2 + ')'; break;
-    case LT: st.back() = '(' + exp1 + " < " + exp2 + ')'; break;
-    case LE: st.back() = '(' + exp1 + " <= " + exp2 + ')'; break;
-    case EQ: st.back() = '(' + exp1 + " == " + exp2 + ')'; break;
-    case NEQ: st.back() = '(' + exp1 + " != " + exp2 + ')'; break;
-    case GE: st.back() = '(' + exp1 + " >= " + exp2 + ')'; break;
-    case GT: st.back() = '(' + exp1 + " > " + exp2 + ')'; break;
-    case AND: st.back() = '(' + exp1 + " && " + exp2 + ')'; break;
-    case OR: st.back() = '(' + exp1 + " || " + exp2 + ')'; break;
-    case BIT_AND: st.back() = '(' + exp1 + " & " + exp2 + ')'; break;
-    case BIT_OR: st.back() = '(' + exp1 + " | " + exp2 + ')'; break;
-    case BIT_XOR: st.back() = '(' + exp1 + " ^ " + exp2 + ')'; break;
-    case BIT_LSHIFT: st.back() = '(' + exp1 + " << " + exp2 + ')'; break;
-    case BIT_RSHIFT: st.back() = '(' + exp1 + " >> " + exp2 + ')'; break;
+    case PO_CONTROL: push(cat(exp1, " control: ", exp2)); return;
+    case CONTROL_TOPT_DEF1: push(cat("control_t*(", exp1, "): ", exp2)); return;
+    case PLUS: opString = " + "; break;
+    case MINUS: opString = " - "; break;
+    case MULT: opString = " * "; break;
+    case DIV: opString = " / "; break;
+    case MOD: opString = " % "; break;
+    case POW: opString = " ** "; break;
+    case FRACTION: opString = " : "; break;
+    case MIN: opString = " <? "; break;
+    case MAX: opString = " >? "; break;
+    case LT: opString = " < "; break;
+    case LE: opString = " <= "; break;
+    case EQ: opString = " == "; break;
+    case NEQ: opString = " != "; break;
+    case GE: opString = " >= "; break;
+    case GT: opString = " > "; break;
+    case AND: opString = " && "; break;
+    case OR: opString = " || "; break;
+    case BIT_AND: opString = " & "; break;
+    case BIT_OR: opString = " | "; break;
+    case BIT_XOR: opString = " ^ "; break;
+    case BIT_LSHIFT: opString = " << "; break;
+    case BIT_RSHIFT: opString = " >> "; break;
     default: throw TypeException("Invalid operator");
     }
+    push(cat('(', exp1, opString, exp2, ')'));
 }
 
 void PrettyPrinter::exprTernary(kind_t op, bool firstMissing)
 {
-    string exp3 = st.back();
-    st.pop_back();
-    string exp2 = st.back();
-    st.pop_back();
-    string exp1;
-    if (firstMissing)
-        exp1 = "1";
-    else {
-        exp1 = st.back();
-        st.pop_back();
-    }
+    auto exp3 = pop();
+    auto exp2 = pop();
+    auto exp1 = firstMissing ? text("1") : pop();
 
-    st.push_back(string());
     switch (op) {
-    case CONTROL_TOPT: st.back() = "control_t*(" + exp1 + "," + exp2 + "): " + exp3; break;
-    case SMC_CONTROL: st.back() = "control[" + exp1 + "<=" + exp2 + "]: " + exp3; break;
+    case CONTROL_TOPT: push(cat("control_t*(", exp1, ",", exp2, "): ", exp3)); break;
+    case SMC_CONTROL: push(cat("control[", exp1, "<=", exp2, "]: ", exp3)); break;
     default: throw TypeException("Invalid operator");
     }
 }
 
 void PrettyPrinter::exprInlineIf()
 {
-    string expr3 = st.back();
-    st.pop_back();
-    string expr2 = st.back();
-    st.pop_back();
-    string expr1 = st.back();
-    st.pop_back();
+    auto expr3 = pop();
+    auto expr2 = pop();
+    auto expr1 = pop();
 
-    st.push_back(string());
-    st.back() = expr1 + " ? " + expr2 + " : " + expr3;
+    push(cat(expr1, " ? ", expr2, " : ", expr3));
 }
 
 void PrettyPrinter::exprComma()
 {
-    string expr2 = st.back();
-    st.pop_back();
-    string expr1 = st.back();
-    st.pop_back();
+    auto expr2 = pop();
+    auto expr1 = pop();
 
-    st.push_back(string());
-    st.back() = expr1 + ", " + expr2;
+    push(cat(expr1, ", ", expr2));
 }
 
-void PrettyPrinter::exprDot(const char* field) { st.back() = st.back() + "." + field; }
+void PrettyPrinter::exprDot(const char* field) { st.back() = cat(st.back(), ".", field); }
 
-void PrettyPrinter::exprLocation() { st.back() = st.back() + ".location"; }
+void PrettyPrinter::exprLocation() { st.back() = cat(st.back(), ".location"); }
 
-void PrettyPrinter::exprDeadlock() { st.push_back("deadlock"); }
+void PrettyPrinter::exprDeadlock() { push(text("deadlock")); }
 
 void PrettyPrinter::exprForAllBegin(const char* name)
 {
-    st.push_back(string("forall (") + name + ":" + type.top() + ") ");
+    push(cat("forall (", name, ":", type.top(), ") "));
     type.pop();
 }
 
 void PrettyPrinter::exprForAllEnd(const char* name)
 {
-    string expr = st.back();
-    st.pop_back();
-    st.back() += expr;
+    auto expr = pop();
+    st.back() = join(st.back(), expr);
 }
 
 void PrettyPrinter::exprExistsBegin(const char* name)
 {
-    st.push_back(string("exists (") + name + ":" + type.top() + ") ");
+    push(cat("exists (", name, ":", type.top(), ") "));
     type.pop();
 }
 
 void PrettyPrinter::exprExistsEnd(const char* name)
 {
-    string expr = st.back();
-    st.pop_back();
-    st.back() += expr;
+    auto expr = pop();
+    st.back() = join(st.back(), expr);
 }
 
 void PrettyPrinter::exprSumBegin(const char* name)
 {
-    st.push_back(string("sum (") + name + ":" + type.top() + ") ");
+    push(cat("sum (", name, ":", type.top(), ") "));
     type.pop();
 }
 
 void PrettyPrinter::exprSumEnd(const char* name)
 {
-    string expr = st.back();
-    st.pop_back();
-    st.back() += expr;
+    auto expr = pop();
+    st.back() = join(st.back(), expr);
 }
 
 void PrettyPrinter::beforeUpdate()
 {
-    *o.top() << "{" << endl;
+    write("{\n");
     level++;
     indent();
     level--;
-    *o.top() << st.back() << endl;
-    *o.top() << "}" << endl;
+    write(str(st.back()), "\n}\n");  // the update stays on the stack
 }
 
 void PrettyPrinter::afterUpdate()
 {
-    *o.top() << "{" << endl;
+    write("{\n");
     level++;
     indent();
     level--;
-    *o.top() << st.back() << endl;
-    *o.top() << "}" << endl;
+    write(str(st.back()), "\n}\n");
 }
 
 void PrettyPrinter::instantiationBegin(const char* id, size_t, const char* templ)
@@ -1011,36 +1061,27 @@ void PrettyPrinter::instantiationBegin(const char* id, size_t, const char* templ
 
 void PrettyPrinter::instantiationEnd(const char* id, size_t parameters, const char* templ, size_t arguments)
 {
-    stack<string> s;
-    while (arguments--) {
-        s.push(st.back());
-        st.pop_back();
-    }
-
-    *o.top() << id << " = " << templ << '(';
-    while (!s.empty()) {
-        *o.top() << s.top();
-        s.pop();
-        if (!s.empty()) {
-            *o.top() << ", ";
-        }
-    }
-    *o.top() << ");" << endl;
+    auto args = popList(arguments, "(", ", ", ");\n");
+    write(id, " = ", templ, args);
 }
 
 void PrettyPrinter::process(const char* id)
 {
     if (first) {
-        *o.top() << "system " << id;
+        write("system ", id);
         first = false;
     } else {
-        *o.top() << ", " << id;
+        write(", ", id);
     }
 }
 
-void PrettyPrinter::processListEnd() { *o.top() << ';' << endl; }
+void PrettyPrinter::processListEnd() { write(";\n"); }
 
-void PrettyPrinter::done() {}
+void PrettyPrinter::done()
+{
+    flush();
+    stream.flush();
+}
 /*
 void PrettyPrinter::exprProba(bool isTimedBound, int type, double proba, int ineq)
 {
@@ -1066,15 +1107,8 @@ void PrettyPrinter::exprProba2(bool isTimedBound, int type)
 */
 void PrettyPrinter::exprProbaQuantitative(Constants::kind_t type)
 {
-    stringstream ss;
-    string pred2 = st.back();
-    st.pop_back();
-    string pred1 = st.back();
-    st.pop_back();
-    string bound = st.back();
-    st.pop_back();
-    string bounded = st.back();
-    st.pop_back();
+    // pred2, pred1, bound and bounded
+    st.resize(st.size() - 4);
     /* FIXME
         ss << "Pr[" << (isTimedBound ? "time" : "steps") << "<=" << bound << "](" << (type == BOX ? "[] " : "<> ");
         if (usesUntil)
@@ -1088,77 +1122,51 @@ void PrettyPrinter::exprProbaQuantitative(Constants::kind_t type)
 
 void PrettyPrinter::exprMitlDiamond(int low, int high)
 {
-    stringstream ss;
-    string expr = st.back();
-    st.pop_back();
-
-    ss << "(<>[" << low << "," << high << "] " << expr << ")";
-    st.push_back(ss.str());
+    auto expr = pop();
+    push(cat("(<>[", std::to_string(low), ",", std::to_string(high), "] ", expr, ")"));
 }
 
 void PrettyPrinter::exprMitlBox(int low, int high)
 {
-    stringstream ss;
-    string expr = st.back();
-    st.pop_back();
-
-    ss << "([][" << low << "," << high << "] " << expr << ")";
-    st.push_back(ss.str());
+    auto expr = pop();
+    push(cat("([][", std::to_string(low), ",", std::to_string(high), "] ", expr, ")"));
 }
 
 void PrettyPrinter::exprSimulate(int nbExpr, bool hasReach, int nbOfAcceptingRuns)
 {
-    stringstream ss;
-    string reachExpr = st.back();
+    fragment_t reachExpr{};
     if (hasReach)
-        st.pop_back();
+        reachExpr = pop();
 
-    stack<string> exprs;
-    for (int i = 0; i < nbExpr; i++) {
-        exprs.push(st.back());
-        st.pop_back();
-    }
-    string nbRuns = st.back();
-    st.pop_back();
-    string bound = st.back();
-    st.pop_back();
-    string boundedExpr = st.back();
-    st.pop_back();
+    auto exprs = popList(nbExpr, "{", ", ", "}");
+    auto nbRuns = pop();
+    auto bound = pop();
+    string boundedExpr = str(pop());
     if (boundedExpr == "0")
         boundedExpr = "#";
     else if (boundedExpr == "1")
         boundedExpr = " ";
 
-    ss << "simulate"
-       << " [" << boundedExpr << "<=" << bound << "; " << nbRuns << "] {";
-    if (!exprs.empty()) {
-        ss << exprs.top();
-        exprs.pop();
-        while (!exprs.empty()) {
-            ss << ", " << exprs.top();
-            exprs.pop();
-        }
-    }
-    ss << "}";
+    auto res = cat("simulate [", boundedExpr, "<=", bound, "; ", nbRuns, "] ", exprs);
     if (hasReach) {
         if (nbOfAcceptingRuns > 0) {
-            ss << " : " << nbOfAcceptingRuns;
+            res = cat(res, " : ", std::to_string(nbOfAcceptingRuns));
         }
-        ss << " : " << reachExpr;
+        res = cat(res, " : ", reachExpr);
     }
-    st.push_back(ss.str());
+    push(res);
 }
 
 /** Built-in verification queries if any */
-void PrettyPrinter::queryBegin() { *o.top() << "\n/** Query begin: */" << endl; }
+void PrettyPrinter::queryBegin() { write("\n/** Query begin: */\n"); }
 void PrettyPrinter::queryFormula(const char* formula, const char* location)
 {
     if (formula)
-        *o.top() << "/* Formula: " << formula << " */" << endl;
+        write("/* Formula: ", formula, " */\n");
 }
 void PrettyPrinter::queryComment(const char* comment)
 {
     if (comment)
-        *o.top() << "/* Comment: " << comment << " */" << endl;
+        write("/* Comment: ", comment, " */\n");
 }
-void PrettyPrinter::queryEnd() { *o.top() << "/** Query end. */" << endl; }
+void PrettyPrinter::queryEnd() { write("/** Query end. */\n"); }
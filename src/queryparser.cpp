@@ -0,0 +1,171 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+
+#include "utap/queryparser.h"
+
+#include "utap/StatementBuilder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace UTAP;
+
+namespace
+{
+    /**
+     * Builds the formula of a query in the scope of the global
+     * declarations, keeping positions, diagnostics and new string
+     * literals in the property instead of the document.
+     */
+    class QueryBuilder : public StatementBuilder
+    {
+    public:
+        QueryBuilder(Document& doc, property_t& result, Positions& positions):
+            StatementBuilder{doc}, result{result}, positions{positions}
+        {
+            fragments = ExpressionFragments{};  // the document's source index is not updated
+        }
+
+        void addPosition(uint32_t position, uint32_t offset, uint32_t line, const std::string& path) override
+        {
+            positions.add(position, offset, line, path);
+        }
+
+        void handleError(const TypeException& ex) override
+        {
+            result.errors.emplace_back(positions.find(position.start), positions.find(position.end), position,
+                                         ex.what());
+        }
+
+        void handleWarning(const TypeException& ex) override
+        {
+            result.warnings.emplace_back(positions.find(position.start), positions.find(position.end), position,
+                                           ex.what());
+        }
+
+        void exprString(const char* name) override
+        {
+            auto string = std::string{name};
+            string.pop_back();  // remove quotes
+            string.erase(0, 1);
+            const auto& known = document.get_strings();
+            auto index = std::find(known.begin(), known.end(), string) - known.begin();
+            if (index == static_cast<std::ptrdiff_t>(known.size())) {
+                auto& added = result.strings;
+                index += std::find(added.begin(), added.end(), string) - added.begin();
+                if (index == static_cast<std::ptrdiff_t>(known.size() + added.size()))
+                    added.push_back(std::move(string));
+            }
+            auto expr = makeConstant(static_cast<int>(index));
+            expr.setType(type_t::createPrimitive(Constants::STRING));
+            fragments.push(expr);
+        }
+
+        void property() override
+        {
+            if (result.expression.empty())
+                result.expression = fragments[0];
+            fragments.pop();
+        }
+
+        variable_t* addVariable(type_t, const std::string&, expression_t, position_t) override
+        {
+            throw NotSupportedException("addVariable is not supported");
+        }
+
+        bool addFunction(type_t, const std::string&, position_t) override
+        {
+            throw NotSupportedException("addFunction is not supported");
+        }
+
+    private:
+        property_t& result;
+        Positions& positions;
+    };
+
+    CompileTimeComputableValues computableValues(Document& doc)
+    {
+        auto values = CompileTimeComputableValues{};
+        doc.accept(values);
+        return values;
+    }
+}  // namespace
+
+// The document is only read, the builders and the checker just lack const interfaces.
+QueryParser::QueryParser(const Document& doc):
+    doc{const_cast<Document&>(doc)}, checker{this->doc, computableValues(this->doc)}
+{}
+
+property_t QueryParser::parse(const query_t& query) const
+{
+    auto copy = checker;
+    return parse(copy, query);
+}
+
+std::vector<property_t> QueryParser::parse(const std::vector<query_t>& queries, uint32_t threads) const
+{
+    auto res = std::vector<property_t>(queries.size());
+    threads = doc.isLocal() ? 0 : std::min<size_t>(threads, queries.size());
+    if (threads == 0) {
+        auto copy = checker;
+        for (size_t i = 0; i < queries.size(); ++i)
+            res[i] = parse(copy, queries[i]);
+    } else {
+        auto next = std::atomic<size_t>{0};
+        auto workers = std::vector<std::thread>{};
+        for (uint32_t i = 0; i < threads; ++i)
+            workers.emplace_back([&] {
+                auto copy = checker;
+                for (auto q = next++; q < queries.size(); q = next++)
+                    res[q] = parse(copy, queries[q]);
+            });
+        for (auto& worker : workers)
+            worker.join();
+    }
+    return res;
+}
+
+property_t QueryParser::parse(TypeChecker& checker, const query_t& query) const
+{
+    auto res = property_t{query};
+    auto positions = Positions{};
+    {
+        auto builder = QueryBuilder{doc, res, positions};
+        try {
+            parseProperty(query.formula.c_str(), &builder, query.location);
+        } catch (const NotSupportedException& ex) {  // e.g. strategies, which are not part of the document
+            builder.handleError(TypeException{ex.what()});
+            res.expression = expression_t{};
+        }
+    }
+    if (res.expression.empty() || !res.errors.empty())
+        return res;
+    auto found = TypeChecker::diagnostics_t{};
+    found.positions = &positions;
+    checker.diagnostics = &found;
+    checker.visitProperty(res.expression);
+    checker.diagnostics = nullptr;
+    res.errors = std::move(found.errors);
+    res.warnings.insert(res.warnings.end(), found.warnings.begin(), found.warnings.end());
+    return res;
+}
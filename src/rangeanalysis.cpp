@@ -0,0 +1,1454 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/rangeanalysis.h"
+
+#include "utap/document.h"
+#include "utap/statement.h"
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+using namespace UTAP;
+using namespace Constants;
+
+namespace
+{
+    /** Bounds are computed with 64 bits, thus products of 32 bit values cannot overflow. */
+    using interval_t = range_t<int64_t>;
+    using cells_t = std::vector<interval_t>;
+
+    constexpr int64_t min32 = std::numeric_limits<int32_t>::min();
+    constexpr int64_t max32 = std::numeric_limits<int32_t>::max();
+
+    /** How many times a location or loop may grow before it is widened. */
+    constexpr int widenAfter = 3;
+    /** Calls nested deeper than this, e.g. by recursion, return their declared range. */
+    constexpr size_t maxCallDepth = 16;
+    /** Iterations over ranges of at most this many values are unrolled. */
+    constexpr int64_t maxUnrolled = 256;
+    /** Arrays with more elements are not analysed. */
+    constexpr size_t maxCells = 1 << 16;
+
+    interval_t top() { return {min32, max32}; }
+    interval_t bottom() { return interval_t::make_empty(); }
+    interval_t constant(int64_t value) { return interval_t{value, value}; }
+
+    interval_t join(const interval_t& a, const interval_t& b)
+    {
+        if (a.empty())
+            return b;
+        if (b.empty())
+            return a;
+        return a | b;
+    }
+
+    /** Values beyond 32 bits may have overflown, thus they stand for any value. */
+    interval_t fit(const interval_t& value)
+    {
+        if (value.empty() || (value.first() >= min32 && value.last() <= max32))
+            return value;
+        return top();
+    }
+
+    bool isSingleton(const interval_t& value) { return !value.empty() && value.first() == value.last(); }
+    bool mayBeTrue(const interval_t& value) { return !value.empty() && !(value == 0); }
+    bool mayBeFalse(const interval_t& value) { return value.contains(0); }
+
+    /** Returns the Boolean values that are possible. */
+    interval_t truth(bool canBeFalse, bool canBeTrue)
+    {
+        if (!canBeFalse && !canBeTrue)
+            return bottom();
+        return {canBeFalse ? 0 : 1, canBeTrue ? 1 : 0};
+    }
+
+    bool isDiscrete(const type_t& type) { return type.isInteger() || type.isBoolean() || type.isScalar(); }
+
+    bool isVariable(const expression_t& expr)
+    {
+        const auto kind = expr.getKind();
+        return kind == IDENTIFIER || kind == ARRAY || kind == DOT;
+    }
+
+    kind_t negate(kind_t kind)
+    {
+        switch (kind) {
+        case LT: return GE;
+        case LE: return GT;
+        case GT: return LE;
+        case GE: return LT;
+        case EQ: return NEQ;
+        default: return EQ;
+        }
+    }
+
+    interval_t compare(kind_t kind, const interval_t& a, const interval_t& b)
+    {
+        if (a.empty() || b.empty())
+            return bottom();
+        switch (kind) {
+        case LT: return truth(a.last() >= b.first(), a.first() < b.last());
+        case LE: return truth(a.last() > b.first(), a.first() <= b.last());
+        case GT: return compare(LT, b, a);
+        case GE: return compare(LE, b, a);
+        case EQ: return truth(!(isSingleton(a) && a == b), a.intersects(b));
+        case NEQ: {
+            const auto equal = compare(EQ, a, b);
+            return truth(mayBeTrue(equal), mayBeFalse(equal));
+        }
+        default: return truth(true, true);
+        }
+    }
+
+    /** Truncating division, which fails on division by zero. */
+    interval_t divide(const interval_t& a, const interval_t& b)
+    {
+        auto result = bottom();
+        const auto part = [&](int64_t low, int64_t high) {
+            if (low > high)
+                return;
+            const auto q = {a.first() / low, a.first() / high, a.last() / low, a.last() / high};
+            result = join(result, {std::min(q), std::max(q)});
+        };
+        part(b.first(), std::min<int64_t>(b.last(), -1));
+        part(std::max<int64_t>(b.first(), 1), b.last());
+        return fit(result);
+    }
+
+    /** The remainder of truncating division, which takes the sign of the dividend. */
+    interval_t remainder(const interval_t& a, const interval_t& b)
+    {
+        if (b == 0)
+            return bottom();
+        const auto largest = std::max(-b.first(), b.last()) - 1;
+        const auto smallest = b.first() > 0 ? b.first() : (b.last() < 0 ? -b.last() : 1);
+        if (a.first() >= 0 && a.last() < smallest)
+            return a;
+        if (a.last() <= 0 && a.first() > -smallest)
+            return a;
+        // Some dividend reaches a divisor, so the remainder may be anything from 0 up to the divisor
+        return {a.first() < 0 ? std::max(a.first(), -largest) : 0, a.last() > 0 ? std::min(a.last(), largest) : 0};
+    }
+
+    interval_t absolute(const interval_t& a)
+    {
+        if (a.first() >= 0)
+            return a;
+        if (a.last() <= 0)
+            return fit({-a.last(), -a.first()});
+        return fit({0, std::max(-a.first(), a.last())});
+    }
+
+    /** Returns the smallest 2^n - 1 not below the non-negative value. */
+    int64_t mask(int64_t value)
+    {
+        auto result = int64_t{0};
+        while (result < value)
+            result = result * 2 + 1;
+        return result;
+    }
+
+    interval_t bitwise(kind_t kind, const interval_t& a, const interval_t& b)
+    {
+        if (a.first() < 0 || b.first() < 0) {
+            if (kind == BIT_AND && (a.first() >= 0 || b.first() >= 0))
+                return {0, a.first() >= 0 ? a.last() : b.last()};
+            return top();
+        }
+        switch (kind) {
+        case BIT_AND: return {0, std::min(a.last(), b.last())};
+        case BIT_OR: return {std::max(a.first(), b.first()), mask(std::max(a.last(), b.last()))};
+        default: return {0, mask(std::max(a.last(), b.last()))};
+        }
+    }
+
+    interval_t shift(kind_t kind, const interval_t& a, const interval_t& b)
+    {
+        if (b.first() < 0 || b.last() > 31)
+            return top();
+        if (kind == BIT_LSHIFT) {
+            if (a.first() < 0)
+                return top();
+            return fit({a.first() << b.first(), a.last() << b.last()});
+        }
+        return {a.first() >> (a.first() < 0 ? b.first() : b.last()), a.last() >> (a.last() < 0 ? b.last() : b.first())};
+    }
+
+    /** A variable: the values of its scalars in layout order, and their declared ranges. */
+    struct object_t
+    {
+        cells_t values;
+        std::shared_ptr<const cells_t> bounds;
+    };
+    using store_t = std::map<symbol_t, object_t>;
+    /** How many times each scalar of the variables grew. */
+    using growth_t = std::map<symbol_t, std::vector<int>>;
+
+    /** The values which may reach a point of the model. */
+    struct env_t
+    {
+        store_t globals;
+        store_t locals;              /**< Of the process, with the variables bound by edges and quantifiers. */
+        std::vector<store_t> frames; /**< Of the functions being called, innermost last. */
+        bool dead{false};            /**< No state reaches the point. */
+    };
+
+    env_t unreachable()
+    {
+        auto env = env_t{};
+        env.dead = true;
+        return env;
+    }
+
+    enum scope_t { GLOBAL, LOCAL, FRAME };
+
+    /** Designates some scalars of a variable: those of the part starting at one of the offsets. */
+    struct place_t
+    {
+        scope_t scope{GLOBAL};
+        size_t frame{0};
+        symbol_t symbol;
+        std::vector<size_t> offsets; /**< The possible first scalars of the part, one if known. */
+        size_t size{0};              /**< Number of scalars of the part. */
+    };
+
+    class Engine
+    {
+    public:
+        explicit Engine(Document& doc);
+
+        void run();
+        const store_t& getGlobals() const { return globals; }
+        /** Calls the function with each process and the join of its locals over its locations. */
+        template <typename F>
+        void forEachProcess(F&& f) const;
+
+    private:
+        class Executor;
+        friend class Executor;
+
+        struct process_t
+        {
+            const instance_t* instance;
+            template_t* templ;
+            std::map<symbol_t, place_t> aliases; /**< The bound reference parameters. */
+            std::unordered_map<const void*, store_t> nodes;
+            std::unordered_map<const void*, growth_t> growth;
+        };
+        struct loop_t
+        {
+            env_t breaks{unreachable()};
+            env_t continues{unreachable()};
+            bool isSwitch{false};
+        };
+        struct call_t
+        {
+            std::map<symbol_t, place_t> aliases;
+            std::set<symbol_t> parameters;
+            env_t returned{unreachable()};
+            interval_t value{bottom()};
+            std::vector<loop_t> loops;
+        };
+
+        store_t globals;
+        growth_t globalGrowth;
+        std::list<process_t> processes;
+        process_t* current{nullptr};
+        std::vector<call_t> calls;
+        std::set<int64_t> thresholds{-1, 0, 1};
+
+        void addProcess(const instance_t& instance, template_t& templ);
+        void edge(process_t& process, const edge_t& edge, bool& changed);
+
+        void threshold(const interval_t& value);
+        interval_t widen(const interval_t& from, const interval_t& to) const;
+        bool joinStore(store_t& into, const store_t& from, bool widening,
+                       growth_t* growth = nullptr) const;
+        bool joinEnv(env_t& into, const env_t& from, bool widening = false) const;
+
+        interval_t declared(const type_t& type, env_t& env);
+        bool getBounds(const type_t& type, env_t& env, int64_t& lower, int64_t& upper);
+        bool layout(const type_t& type, env_t& env, cells_t& bounds);
+        size_t sizeOf(const type_t& type, env_t& env);
+        void declare(store_t& store, const symbol_t& symbol, const expression_t& init, env_t& env);
+        void initialise(cells_t& values, size_t offset, const type_t& type, const expression_t& init, env_t& env);
+
+        object_t* resolve(const place_t& place, env_t& env);
+        bool locate(const expression_t& expr, env_t& env, place_t& place);
+        interval_t read(const place_t& place, env_t& env);
+        cells_t readCells(const place_t& place, env_t& env);
+        void write(const place_t& place, const cells_t& values, env_t& env);
+        void havoc(const place_t& place, env_t& env);
+        void havoc(const function_t& fun, env_t& env);
+
+        interval_t operand(const expression_t& expr, env_t& env, place_t& place, bool& located);
+        interval_t eval(const expression_t& expr, env_t& env);
+        interval_t evalAssignment(const expression_t& expr, env_t& env);
+        interval_t evalIncrement(const expression_t& expr, env_t& env);
+        interval_t evalQuantifier(const expression_t& expr, env_t& env);
+        interval_t call(const expression_t& expr, env_t& env);
+        void assume(const expression_t& expr, bool truth, env_t& env);
+        void assumeComparison(const expression_t& expr, bool truth, env_t& env);
+        void bind(const symbol_t& symbol, env_t& env);
+        void unbind(const symbol_t& symbol, env_t& env);
+    };
+
+    /** Interprets function bodies on the values reaching the call; returns collect the values in the call. */
+    class Engine::Executor : public StatementVisitor
+    {
+        Engine& e;
+        env_t& env;
+
+        void exec(Statement* stat)
+        {
+            if (!env.dead)
+                stat->accept(this);
+        }
+
+        std::vector<loop_t>& loops() { return e.calls.back().loops; }
+
+        /**
+         * Iterates the loop until the values at its head are stable.  The
+         * condition is tested before the body if testFirst is set and
+         * after it otherwise, while a bounded loop may end before any
+         * iteration.
+         */
+        void loop(const expression_t& cond, Statement* body, const expression_t& step, bool testFirst,
+                  bool bounded = false)
+        {
+            const auto entry = std::move(env);
+            auto head = entry;
+            auto exit = unreachable();
+            for (auto iteration = 0;; ++iteration) {
+                env = head;
+                auto leave = unreachable();
+                if (bounded) {
+                    leave = env;
+                } else if (testFirst && !cond.empty()) {
+                    leave = env;
+                    e.assume(cond, false, leave);
+                    e.assume(cond, true, env);
+                }
+                loops().emplace_back();
+                exec(body);
+                auto jumps = std::move(loops().back());
+                loops().pop_back();
+                e.joinEnv(env, jumps.continues);
+                if (!testFirst) {
+                    leave = env;
+                    e.assume(cond, false, leave);
+                    e.assume(cond, true, env);
+                } else if (!env.dead && !step.empty()) {
+                    e.eval(step, env);
+                }
+                e.joinEnv(leave, jumps.breaks);
+                exit = std::move(leave);
+                auto next = entry;
+                e.joinEnv(next, env);
+                if (!e.joinEnv(head, next, iteration >= widenAfter))
+                    break;
+            }
+            env = std::move(exit);
+        }
+
+    public:
+        Executor(Engine& engine, env_t& env): e{engine}, env{env} {}
+
+        int32_t visitEmptyStatement(EmptyStatement*) override { return 0; }
+
+        int32_t visitExprStatement(ExprStatement* stat) override
+        {
+            if (!stat->expr.empty())
+                e.eval(stat->expr, env);
+            return 0;
+        }
+
+        int32_t visitAssertStatement(AssertStatement* stat) override
+        {
+            e.assume(stat->expr, true, env);
+            return 0;
+        }
+
+        int32_t visitForStatement(ForStatement* stat) override
+        {
+            if (!stat->init.empty())
+                e.eval(stat->init, env);
+            if (!env.dead)
+                loop(stat->cond, stat->stat.get(), stat->step, true);
+            return 0;
+        }
+
+        int32_t visitIterationStatement(IterationStatement* stat) override
+        {
+            e.bind(stat->symbol, env);
+            const auto& frame = env.frames.back();
+            const auto it = frame.find(stat->symbol);
+            const auto range = it != frame.end() && it->second.values.size() == 1 ? it->second.values.front() : bottom();
+            if (!range.empty() && range.last() - range.first() < maxUnrolled) {
+                // Small ranges are iterated value by value
+                auto exit = unreachable();
+                for (auto i = range.first(); i <= range.last() && !env.dead; ++i) {
+                    env.frames.back()[stat->symbol].values = {constant(i)};
+                    loops().emplace_back();
+                    exec(stat->stat.get());
+                    auto jumps = std::move(loops().back());
+                    loops().pop_back();
+                    e.joinEnv(env, jumps.continues);
+                    e.joinEnv(exit, jumps.breaks);
+                }
+                e.joinEnv(env, exit);
+            } else {
+                loop({}, stat->stat.get(), {}, true, true);
+            }
+            e.unbind(stat->symbol, env);
+            return 0;
+        }
+
+        int32_t visitWhileStatement(WhileStatement* stat) override
+        {
+            loop(stat->cond, stat->stat.get(), {}, true);
+            return 0;
+        }
+
+        int32_t visitDoWhileStatement(DoWhileStatement* stat) override
+        {
+            loop(stat->cond, stat->stat.get(), {}, false);
+            return 0;
+        }
+
+        int32_t visitBlockStatement(BlockStatement* stat) override
+        {
+            // Local variables are initialised when the block is entered; parameters are bound by the call
+            for (const auto& symbol : stat->getFrame()) {
+                const auto* var = static_cast<const variable_t*>(symbol.getData());
+                if (env.dead || var == nullptr || var->uid != symbol || symbol.getType().is(TYPEDEF) ||
+                    symbol.getType().isFunction() || e.calls.back().parameters.count(symbol))
+                    continue;
+                e.declare(env.frames.back(), symbol, var->expr, env);
+            }
+            for (auto& s : *stat)
+                exec(s.get());
+            return 0;
+        }
+
+        int32_t visitSwitchStatement(SwitchStatement* stat) override
+        {
+            e.eval(stat->cond, env);
+            const auto entry = std::move(env);
+            env = unreachable();
+            auto hasDefault = false;
+            loops().push_back({unreachable(), unreachable(), true});
+            for (auto& s : *stat) {
+                // Any case may be taken, or fallen into from the previous one
+                hasDefault = hasDefault || dynamic_cast<DefaultStatement*>(s.get()) != nullptr;
+                e.joinEnv(env, entry);
+                exec(s.get());
+            }
+            auto jumps = std::move(loops().back());
+            loops().pop_back();
+            e.joinEnv(env, jumps.breaks);
+            if (!hasDefault)
+                e.joinEnv(env, entry);
+            for (auto it = loops().rbegin(); it != loops().rend(); ++it) {
+                if (!it->isSwitch) {
+                    e.joinEnv(it->continues, jumps.continues);
+                    break;
+                }
+            }
+            return 0;
+        }
+
+        int32_t visitCaseStatement(CaseStatement* stat) override { return visitBlockStatement(stat); }
+        int32_t visitDefaultStatement(DefaultStatement* stat) override { return visitBlockStatement(stat); }
+
+        int32_t visitIfStatement(IfStatement* stat) override
+        {
+            auto otherwise = env;
+            e.assume(stat->cond, true, env);
+            e.assume(stat->cond, false, otherwise);
+            exec(stat->trueCase.get());
+            if (stat->falseCase) {
+                auto saved = std::exchange(env, std::move(otherwise));
+                exec(stat->falseCase.get());
+                e.joinEnv(env, saved);
+            } else {
+                e.joinEnv(env, otherwise);
+            }
+            return 0;
+        }
+
+        int32_t visitBreakStatement(BreakStatement*) override
+        {
+            if (!loops().empty())
+                e.joinEnv(loops().back().breaks, env);
+            env.dead = true;
+            return 0;
+        }
+
+        int32_t visitContinueStatement(ContinueStatement*) override
+        {
+            // Continues in a switch are passed on to the enclosing loop by the switch
+            if (!loops().empty())
+                e.joinEnv(loops().back().continues, env);
+            env.dead = true;
+            return 0;
+        }
+
+        int32_t visitReturnStatement(ReturnStatement* stat) override
+        {
+            if (!stat->value.empty()) {
+                const auto value = e.eval(stat->value, env);
+                if (env.dead)
+                    return 0;
+                e.calls.back().value = join(e.calls.back().value, value);
+            }
+            e.joinEnv(e.calls.back().returned, env);
+            env.dead = true;
+            return 0;
+        }
+    };
+
+    Engine::Engine(Document& doc)
+    {
+        auto env = env_t{};
+        for (const auto& var : doc.getGlobals().variables)
+            declare(env.globals, var.uid, var.expr, env);
+        globals = std::move(env.globals);
+        for (const auto& process : doc.getProcesses())
+            addProcess(process, *process.templ);
+        for (auto* templ : doc.getDynamicTemplates())
+            addProcess(*templ, *templ);
+    }
+
+    void Engine::addProcess(const instance_t& instance, template_t& templ)
+    {
+        auto& process = processes.emplace_back();
+        process.instance = &instance;
+        process.templ = &templ;
+        current = &process;
+        auto env = env_t{};
+        env.globals = globals;
+        // Unbound parameters, e.g. of process sets, take any value of their type
+        for (auto i = size_t{0}; i < instance.unbound; ++i)
+            if (!instance.parameters[i].getType().is(REF))
+                bind(instance.parameters[i], env);
+        for (const auto& [parameter, argument] : instance.mapping) {
+            auto place = place_t{};
+            if (parameter.getType().is(REF) && isVariable(argument) && locate(argument, env, place))
+                process.aliases.emplace(parameter, std::move(place));
+            else
+                declare(env.locals, parameter, argument, env);
+        }
+        for (const auto& var : templ.variables)
+            declare(env.locals, var.uid, var.expr, env);
+        const auto* init = static_cast<const state_t*>(templ.init.getData());
+        if (init == nullptr)
+            return;
+        if (!init->invariant.empty())
+            assume(init->invariant, true, env);
+        if (!env.dead)
+            process.nodes.emplace(init, std::move(env.locals));
+    }
+
+    void Engine::run()
+    {
+        auto changed = true;
+        while (changed) {
+            changed = false;
+            for (auto& process : processes) {
+                current = &process;
+                for (const auto& e : process.templ->edges)
+                    edge(process, e, changed);
+            }
+        }
+    }
+
+    void Engine::edge(process_t& process, const edge_t& edge, bool& changed)
+    {
+        const auto* src = edge.src != nullptr ? static_cast<const void*>(edge.src) : edge.srcb;
+        const auto* dst = edge.dst != nullptr ? static_cast<const void*>(edge.dst) : edge.dstb;
+        const auto it = process.nodes.find(src);
+        if (it == process.nodes.end())
+            return;
+        auto env = env_t{};
+        env.globals = globals;
+        env.locals = it->second;
+        for (const auto& symbol : edge.select)
+            bind(symbol, env);
+        if (!edge.guard.empty())
+            assume(edge.guard, true, env);
+        if (!env.dead && !edge.assign.empty())
+            eval(edge.assign, env);
+        if (edge.dst != nullptr && !edge.dst->invariant.empty())
+            assume(edge.dst->invariant, true, env);
+        if (env.dead)
+            return;
+        for (const auto& symbol : edge.select)
+            env.locals.erase(symbol);
+        auto [node, inserted] = process.nodes.emplace(dst, env.locals);
+        if (inserted || joinStore(node->second, env.locals, false, &process.growth[dst]))
+            changed = true;
+        if (joinStore(globals, env.globals, false, &globalGrowth))
+            changed = true;
+    }
+
+    template <typename F>
+    void Engine::forEachProcess(F&& f) const
+    {
+        for (const auto& process : processes) {
+            auto locals = store_t{};
+            for (const auto& [node, store] : process.nodes)
+                joinStore(locals, store, false);
+            f(*process.instance, locals);
+        }
+    }
+
+    void Engine::threshold(const interval_t& value)
+    {
+        if (isSingleton(value) && value.first() >= min32 && value.last() <= max32) {
+            thresholds.insert(value.first() - 1);
+            thresholds.insert(value.first());
+            thresholds.insert(value.first() + 1);
+        }
+    }
+
+    interval_t Engine::widen(const interval_t& from, const interval_t& to) const
+    {
+        if (from.empty())
+            return to;
+        auto lower = to.first();
+        auto upper = to.last();
+        if (lower < from.first()) {
+            const auto it = thresholds.upper_bound(lower);
+            lower = it == thresholds.begin() ? min32 : *std::prev(it);
+        }
+        if (upper > from.last()) {
+            const auto it = thresholds.lower_bound(upper);
+            upper = it == thresholds.end() ? max32 : *it;
+        }
+        return {lower, upper};
+    }
+
+    bool Engine::joinStore(store_t& into, const store_t& from, bool widening, growth_t* growth) const
+    {
+        auto changed = false;
+        for (const auto& [symbol, object] : from) {
+            auto [it, inserted] = into.emplace(symbol, object);
+            if (inserted) {
+                changed = true;
+                continue;
+            }
+            auto& values = it->second.values;
+            const auto& bounds = *it->second.bounds;
+            auto* counts = growth != nullptr ? &(*growth)[symbol] : nullptr;
+            if (counts != nullptr)
+                counts->resize(values.size());
+            for (size_t i = 0; i < values.size() && i < object.values.size(); ++i) {
+                auto joined = join(values[i], object.values[i]);
+                if (joined == values[i])
+                    continue;
+                if (widening || (counts != nullptr && (*counts)[i]++ >= widenAfter))
+                    joined = widen(values[i], joined) & bounds[i];
+                values[i] = joined;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    bool Engine::joinEnv(env_t& into, const env_t& from, bool widening) const
+    {
+        if (from.dead)
+            return false;
+        if (into.dead) {
+            into = from;
+            return true;
+        }
+        auto changed = joinStore(into.globals, from.globals, widening);
+        changed = joinStore(into.locals, from.locals, widening) || changed;
+        for (size_t i = 0; i < into.frames.size() && i < from.frames.size(); ++i)
+            changed = joinStore(into.frames[i], from.frames[i], widening) || changed;
+        return changed;
+    }
+
+    interval_t Engine::declared(const type_t& type, env_t& env)
+    {
+        if (type.isBoolean())
+            return {0, 1};
+        if (!type.is(RANGE) || !(type.isInteger() || type.isScalar()))
+            return top();
+        // The bounds are constant, thus evaluating them changes nothing but may fail
+        const auto dead = std::exchange(env.dead, false);
+        const auto [low, high] = type.getRange();
+        const auto lower = eval(low, env);
+        const auto upper = eval(high, env);
+        env.dead = dead;
+        if (lower.empty() || upper.empty())
+            return top();
+        return interval_t{std::max(lower.first(), min32), std::min(upper.last(), max32)};
+    }
+
+    bool Engine::getBounds(const type_t& type, env_t& env, int64_t& lower, int64_t& upper)
+    {
+        if (!type.is(RANGE) || !(type.isInteger() || type.isScalar()))
+            return false;
+        const auto dead = std::exchange(env.dead, false);
+        const auto [low, high] = type.getRange();
+        const auto first = eval(low, env);
+        const auto last = eval(high, env);
+        env.dead = dead;
+        if (!isSingleton(first) || !isSingleton(last))
+            return false;
+        lower = first.first();
+        upper = last.first();
+        return true;
+    }
+
+    bool Engine::layout(const type_t& type, env_t& env, cells_t& bounds)
+    {
+        if (type.isArray()) {
+            auto lower = int64_t{0}, upper = int64_t{0};
+            auto element = cells_t{};
+            if (!getBounds(type.getArraySize(), env, lower, upper) || !layout(type.getSub(), env, element))
+                return false;
+            const auto count = upper >= lower ? static_cast<size_t>(upper - lower + 1) : 0;
+            if (count * element.size() + bounds.size() > maxCells)
+                return false;
+            for (size_t i = 0; i < count; ++i)
+                bounds.insert(bounds.end(), element.begin(), element.end());
+            return true;
+        }
+        if (type.isRecord()) {
+            for (size_t i = 0; i < type.getRecordSize(); ++i)
+                if (!layout(type.getSub(i), env, bounds))
+                    return false;
+            return true;
+        }
+        if (!isDiscrete(type))
+            return false;
+        const auto range = declared(type, env);
+        thresholds.insert(range.first());
+        thresholds.insert(range.last());
+        bounds.push_back(range);
+        return true;
+    }
+
+    size_t Engine::sizeOf(const type_t& type, env_t& env)
+    {
+        auto bounds = cells_t{};
+        return layout(type, env, bounds) ? bounds.size() : 0;
+    }
+
+    void Engine::declare(store_t& store, const symbol_t& symbol, const expression_t& init, env_t& env)
+    {
+        const auto type = symbol.getType();
+        auto bounds = cells_t{};
+        if (!layout(type, env, bounds))
+            return;
+        auto values = bounds;
+        initialise(values, 0, type, init, env);
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] &= bounds[i];
+            if (values[i].empty())
+                values[i] = bounds[i];
+        }
+        store[symbol] = object_t{std::move(values), std::make_shared<const cells_t>(std::move(bounds))};
+    }
+
+    void Engine::initialise(cells_t& values, size_t offset, const type_t& type, const expression_t& init,
+                            env_t& env)
+    {
+        if (init.empty()) {
+            const auto size = sizeOf(type, env);
+            for (size_t i = 0; i < size && offset + i < values.size(); ++i)
+                values[offset + i] = constant(0);
+        } else if (isDiscrete(type)) {
+            if (offset < values.size())
+                values[offset] = eval(init, env);
+        } else if (init.getKind() == LIST && type.isArray()) {
+            const auto size = sizeOf(type.getSub(), env);
+            for (uint32_t i = 0; i < init.getSize(); ++i)
+                initialise(values, offset + i * size, type.getSub(), init[i], env);
+        } else if (init.getKind() == LIST && type.isRecord()) {
+            for (uint32_t i = 0; i < init.getSize() && i < type.getRecordSize(); ++i) {
+                initialise(values, offset, type.getSub(i), init[i], env);
+                offset += sizeOf(type.getSub(i), env);
+            }
+        } else if (auto place = place_t{}; isVariable(init) && locate(init, env, place)) {
+            const auto cells = readCells(place, env);
+            std::copy_n(cells.begin(), std::min(cells.size(), values.size() - std::min(offset, values.size())),
+                        values.begin() + std::min(offset, values.size()));
+        }
+    }
+
+    object_t* Engine::resolve(const place_t& place, env_t& env)
+    {
+        auto& store = place.scope == GLOBAL ? env.globals : place.scope == LOCAL ? env.locals : env.frames[place.frame];
+        const auto it = store.find(place.symbol);
+        return it != store.end() ? &it->second : nullptr;
+    }
+
+    bool Engine::locate(const expression_t& expr, env_t& env, place_t& place)
+    {
+        switch (expr.getKind()) {
+        case IDENTIFIER: {
+            const auto symbol = expr.getSymbol();
+            const auto found = [&](scope_t scope, store_t& store, size_t frame = 0) {
+                const auto it = store.find(symbol);
+                if (it == store.end())
+                    return false;
+                place = place_t{scope, frame, symbol, {0}, it->second.values.size()};
+                return true;
+            };
+            if (!calls.empty()) {
+                if (found(FRAME, env.frames.back(), env.frames.size() - 1))
+                    return true;
+                if (const auto it = calls.back().aliases.find(symbol); it != calls.back().aliases.end()) {
+                    place = it->second;
+                    return true;
+                }
+            }
+            if (found(LOCAL, env.locals))
+                return true;
+            if (current != nullptr) {
+                if (const auto it = current->aliases.find(symbol); it != current->aliases.end()) {
+                    place = it->second;
+                    return true;
+                }
+            }
+            return found(GLOBAL, env.globals);
+        }
+        case ARRAY: {
+            const auto base = locate(expr[0], env, place);
+            const auto index = eval(expr[1], env);
+            const auto type = expr[0].getType();
+            auto lower = int64_t{0}, upper = int64_t{0};
+            if (!base || env.dead || !getBounds(type.getArraySize(), env, lower, upper))
+                return false;
+            const auto indices = index & interval_t{lower, upper};
+            if (indices.empty()) {
+                env.dead = true;  // out of range
+                return false;
+            }
+            const auto size = sizeOf(type.getSub(), env);
+            if (size == 0)
+                return false;
+            auto offsets = std::vector<size_t>{};
+            for (const auto offset : place.offsets)
+                for (auto i = indices.first(); i <= indices.last(); ++i)
+                    offsets.push_back(offset + static_cast<size_t>(i - lower) * size);
+            place.offsets = std::move(offsets);
+            place.size = size;
+            return true;
+        }
+        case DOT: {
+            const auto type = expr[0].getType();
+            if (!type.isRecord() || !locate(expr[0], env, place))
+                return false;
+            auto offset = size_t{0};
+            for (auto i = 0; i < expr.getIndex(); ++i)
+                offset += sizeOf(type.getSub(i), env);
+            for (auto& o : place.offsets)
+                o += offset;
+            place.size = sizeOf(type.getSub(expr.getIndex()), env);
+            return place.size != 0;
+        }
+        default: return false;
+        }
+    }
+
+    interval_t Engine::read(const place_t& place, env_t& env)
+    {
+        const auto* object = resolve(place, env);
+        auto value = bottom();
+        if (object == nullptr)
+            return top();
+        for (const auto offset : place.offsets)
+            if (offset < object->values.size())
+                value = join(value, object->values[offset]);
+        return value;
+    }
+
+    cells_t Engine::readCells(const place_t& place, env_t& env)
+    {
+        const auto* object = resolve(place, env);
+        auto cells = cells_t(place.size, bottom());
+        if (object == nullptr)
+            return cells_t(place.size, top());
+        for (const auto offset : place.offsets)
+            for (size_t i = 0; i < place.size && offset + i < object->values.size(); ++i)
+                cells[i] = join(cells[i], object->values[offset + i]);
+        return cells;
+    }
+
+    void Engine::write(const place_t& place, const cells_t& values, env_t& env)
+    {
+        auto* object = resolve(place, env);
+        if (object == nullptr)
+            return;
+        const auto strong = place.offsets.size() == 1;
+        const auto& bounds = *object->bounds;
+        for (const auto offset : place.offsets) {
+            for (size_t i = 0; i < values.size() && offset + i < object->values.size(); ++i) {
+                // values out of range are errors, thus they do not reach any state
+                const auto value = values[i] & bounds[offset + i];
+                if (strong && value.empty())
+                    env.dead = true;
+                else if (strong)
+                    object->values[offset + i] = value;
+                else
+                    object->values[offset + i] = join(object->values[offset + i], value);
+            }
+        }
+    }
+
+    void Engine::havoc(const place_t& place, env_t& env)
+    {
+        if (auto* object = resolve(place, env))
+            for (const auto offset : place.offsets)
+                for (size_t i = 0; i < place.size && offset + i < object->values.size(); ++i)
+                    object->values[offset + i] = (*object->bounds)[offset + i];
+    }
+
+    void Engine::havoc(const function_t& fun, env_t& env)
+    {
+        for (const auto& symbol : fun.changes) {
+            for (auto* store : {&env.globals, &env.locals}) {
+                if (auto it = store->find(symbol); it != store->end())
+                    it->second.values = *it->second.bounds;
+            }
+        }
+    }
+
+    interval_t Engine::operand(const expression_t& expr, env_t& env, place_t& place, bool& located)
+    {
+        located = false;
+        if (!isVariable(expr))
+            return eval(expr, env);
+        located = locate(expr, env, place) && place.size == 1;
+        if (env.dead)
+            return bottom();
+        if (located)
+            return read(place, env);
+        return declared(expr.getType(), env);
+    }
+
+    interval_t Engine::eval(const expression_t& expr, env_t& env)
+    {
+        if (env.dead)
+            return bottom();
+        if (expr.empty())
+            return top();
+        const auto kind = expr.getKind();
+        switch (kind) {
+        case CONSTANT: return expr.getType().isIntegral() ? constant(expr.getValue()) : top();
+
+        case IDENTIFIER:
+        case ARRAY:
+        case DOT: {
+            auto place = place_t{};
+            auto located = false;
+            return operand(expr, env, place, located);
+        }
+
+        case PLUS:
+        case MINUS:
+        case MULT:
+        case DIV:
+        case MOD:
+        case BIT_AND:
+        case BIT_OR:
+        case BIT_XOR:
+        case BIT_LSHIFT:
+        case BIT_RSHIFT:
+        case MIN:
+        case MAX:
+        case LT:
+        case LE:
+        case EQ:
+        case NEQ:
+        case GE:
+        case GT: {
+            const auto a = eval(expr[0], env);
+            const auto b = eval(expr[1], env);
+            if (a.empty() || b.empty())
+                return bottom();
+            if (!isDiscrete(expr[0].getType()) || !isDiscrete(expr[1].getType()))
+                return declared(expr.getType(), env);
+            switch (kind) {
+            case PLUS: return fit(a + b);
+            case MINUS: return fit(a - b);
+            case MULT: return fit(a * b);
+            case DIV: return divide(a, b);
+            case MOD: return remainder(a, b);
+            case BIT_AND:
+            case BIT_OR:
+            case BIT_XOR: return bitwise(kind, a, b);
+            case BIT_LSHIFT:
+            case BIT_RSHIFT: return shift(kind, a, b);
+            case MIN: return {std::min(a.first(), b.first()), std::min(a.last(), b.last())};
+            case MAX: return {std::max(a.first(), b.first()), std::max(a.last(), b.last())};
+            default: return compare(kind, a, b);
+            }
+        }
+
+        case UNARY_MINUS: {
+            const auto a = eval(expr[0], env);
+            return a.empty() ? a : fit(constant(0) - a);
+        }
+
+        case ABS_F: {
+            const auto a = eval(expr[0], env);
+            if (a.empty() || !isDiscrete(expr[0].getType()))
+                return a.empty() ? a : top();
+            return absolute(a);
+        }
+
+        case NOT: {
+            const auto a = eval(expr[0], env);
+            return a.empty() ? a : truth(mayBeTrue(a), mayBeFalse(a));
+        }
+
+        case XOR: {
+            const auto a = eval(expr[0], env);
+            const auto b = eval(expr[1], env);
+            if (a.empty() || b.empty())
+                return bottom();
+            return truth((mayBeTrue(a) && mayBeTrue(b)) || (mayBeFalse(a) && mayBeFalse(b)),
+                         (mayBeTrue(a) && mayBeFalse(b)) || (mayBeFalse(a) && mayBeTrue(b)));
+        }
+
+        case AND:
+        case OR: {
+            // The right operand is evaluated only if the left one does not decide
+            auto decided = env;
+            assume(expr[0], kind == OR, decided);
+            assume(expr[0], kind == AND, env);
+            const auto value = eval(expr[1], env);
+            auto result = env.dead ? bottom() : truth(mayBeFalse(value), mayBeTrue(value));
+            if (!decided.dead)
+                result = join(result, constant(kind == OR ? 1 : 0));
+            joinEnv(env, decided);
+            return result;
+        }
+
+        case INLINEIF: {
+            auto otherwise = env;
+            assume(expr[0], true, env);
+            assume(expr[0], false, otherwise);
+            const auto value = eval(expr[1], env);
+            const auto other = eval(expr[2], otherwise);
+            joinEnv(env, otherwise);
+            return join(value, other);
+        }
+
+        case COMMA:
+            eval(expr[0], env);
+            return eval(expr[1], env);
+
+        case ASSIGN:
+        case ASSPLUS:
+        case ASSMINUS:
+        case ASSMULT:
+        case ASSDIV:
+        case ASSMOD:
+        case ASSAND:
+        case ASSOR:
+        case ASSXOR:
+        case ASSLSHIFT:
+        case ASSRSHIFT: return evalAssignment(expr, env);
+
+        case PREINCREMENT:
+        case POSTINCREMENT:
+        case PREDECREMENT:
+        case POSTDECREMENT: return evalIncrement(expr, env);
+
+        case FUNCALL: return call(expr, env);
+
+        case FORALL:
+        case EXISTS:
+        case SUM: return evalQuantifier(expr, env);
+
+        default:
+            // Clocks, doubles and the like: only the side effects matter
+            for (uint32_t i = 0; i < expr.getSize(); ++i)
+                eval(expr[i], env);
+            return env.dead ? bottom() : declared(expr.getType(), env);
+        }
+    }
+
+    interval_t Engine::evalAssignment(const expression_t& expr, env_t& env)
+    {
+        const auto kind = expr.getKind();
+        auto place = place_t{};
+        const auto located = isVariable(expr[0]) && locate(expr[0], env, place);
+        if (!isDiscrete(expr[0].getType())) {
+            // Arrays and records are copied from another variable
+            auto source = place_t{};
+            if (located && kind == ASSIGN && isVariable(expr[1]) && locate(expr[1], env, source) &&
+                source.size == place.size)
+                write(place, readCells(source, env), env);
+            else if (located)
+                havoc(place, env);
+            else
+                eval(expr[1], env);
+            return env.dead ? bottom() : constant(0);
+        }
+        auto value = eval(expr[1], env);
+        if (env.dead || value.empty())
+            return bottom();
+        if (kind != ASSIGN) {
+            const auto old = located ? read(place, env) : declared(expr[0].getType(), env);
+            switch (kind) {
+            case ASSPLUS: value = fit(old + value); break;
+            case ASSMINUS: value = fit(old - value); break;
+            case ASSMULT: value = fit(old * value); break;
+            case ASSDIV: value = divide(old, value); break;
+            case ASSMOD: value = remainder(old, value); break;
+            case ASSAND: value = bitwise(BIT_AND, old, value); break;
+            case ASSOR: value = bitwise(BIT_OR, old, value); break;
+            case ASSXOR: value = bitwise(BIT_XOR, old, value); break;
+            case ASSLSHIFT: value = shift(BIT_LSHIFT, old, value); break;
+            default: value = shift(BIT_RSHIFT, old, value); break;
+            }
+        }
+        if (!located)
+            return value;
+        if (value.empty()) {
+            env.dead = true;
+            return value;
+        }
+        write(place, {value}, env);
+        return env.dead ? bottom() : value;
+    }
+
+    interval_t Engine::evalIncrement(const expression_t& expr, env_t& env)
+    {
+        const auto kind = expr.getKind();
+        const auto delta = kind == PREINCREMENT || kind == POSTINCREMENT ? 1 : -1;
+        auto place = place_t{};
+        auto located = false;
+        const auto old = operand(expr[0], env, place, located);
+        if (old.empty())
+            return old;
+        const auto value = fit(old + int64_t{delta});
+        if (located)
+            write(place, {value}, env);
+        if (env.dead)
+            return bottom();
+        return kind == PREINCREMENT || kind == PREDECREMENT ? value : old;
+    }
+
+    interval_t Engine::evalQuantifier(const expression_t& expr, env_t& env)
+    {
+        // Quantified expressions are free of side effects, thus the body is evaluated once for all values
+        const auto symbol = expr[0].getSymbol();
+        bind(symbol, env);
+        const auto range = declared(symbol.getType(), env);
+        const auto value = eval(expr[1], env);
+        unbind(symbol, env);
+        if (value.empty())
+            return expr.getKind() == SUM ? constant(0) : constant(expr.getKind() == FORALL ? 1 : 0);
+        const auto count = range.empty() ? 0 : range.last() - range.first() + 1;
+        switch (expr.getKind()) {
+        case SUM: return count == 0 ? constant(0) : fit(value * count);
+        case FORALL: return truth(mayBeFalse(value), mayBeTrue(value) || range.empty());
+        default: return truth(mayBeFalse(value) || range.empty(), mayBeTrue(value));
+        }
+    }
+
+    interval_t Engine::call(const expression_t& expr, env_t& env)
+    {
+        const auto symbol = expr[0].getSymbol();
+        const auto type = symbol.getType();
+        const auto* fun = static_cast<const function_t*>(symbol.getData());
+        const auto parameters = type.size() > 0 ? type.size() - 1 : 0;
+        const auto result = [&] {
+            if (env.dead)
+                return bottom();
+            return type.size() == 0 || type[0].isVoid() ? constant(0) : declared(type[0], env);
+        };
+        if (!type.isFunction() || fun == nullptr || fun->body == nullptr ||
+            dynamic_cast<const ExternalBlockStatement*>(fun->body.get()) != nullptr || calls.size() >= maxCallDepth ||
+            fun->body->getFrame().getSize() < parameters || expr.getSize() < parameters + 1) {
+            // Any value may be returned, and anything the function changes may take any value
+            for (uint32_t i = 1; i < expr.getSize(); ++i) {
+                auto place = place_t{};
+                if (i <= parameters && type[i].is(REF) && !type[i].isConstant() && isVariable(expr[i])) {
+                    if (locate(expr[i], env, place))
+                        havoc(place, env);
+                } else {
+                    eval(expr[i], env);
+                }
+            }
+            if (fun != nullptr && !env.dead)
+                havoc(*fun, env);
+            return result();
+        }
+        auto frame = call_t{};
+        auto locals = store_t{};
+        const auto formals = fun->body->getFrame();
+        for (uint32_t i = 0; i < parameters; ++i) {
+            auto place = place_t{};
+            frame.parameters.insert(formals[i]);
+            if (type[i + 1].is(REF) && isVariable(expr[i + 1]) && locate(expr[i + 1], env, place))
+                frame.aliases.emplace(formals[i], std::move(place));
+            else
+                declare(locals, formals[i], expr[i + 1], env);
+        }
+        if (env.dead)
+            return bottom();
+        env.frames.push_back(std::move(locals));
+        calls.push_back(std::move(frame));
+        auto executor = Executor{*this, env};
+        fun->body->accept(&executor);
+        auto done = std::move(calls.back());
+        calls.pop_back();
+        joinEnv(env, done.returned);
+        env.frames.pop_back();
+        if (env.dead)
+            return bottom();
+        if (type[0].isVoid())
+            return constant(0);
+        const auto range = declared(type[0], env);
+        const auto value = done.value & range;
+        return value.empty() ? range : value;
+    }
+
+    void Engine::assume(const expression_t& expr, bool truth, env_t& env)
+    {
+        if (env.dead || expr.empty())
+            return;
+        switch (expr.getKind()) {
+        case NOT: assume(expr[0], !truth, env); return;
+
+        case AND:
+        case OR:
+            if ((expr.getKind() == AND) == truth) {
+                assume(expr[0], truth, env);
+                assume(expr[1], truth, env);
+            } else {
+                auto other = env;
+                assume(expr[0], truth, env);
+                assume(expr[0], !truth, other);
+                assume(expr[1], truth, other);
+                joinEnv(env, other);
+            }
+            return;
+
+        case INLINEIF: {
+            auto otherwise = env;
+            assume(expr[0], true, env);
+            assume(expr[1], truth, env);
+            assume(expr[0], false, otherwise);
+            assume(expr[2], truth, otherwise);
+            joinEnv(env, otherwise);
+            return;
+        }
+
+        case COMMA:
+            eval(expr[0], env);
+            assume(expr[1], truth, env);
+            return;
+
+        case LT:
+        case LE:
+        case EQ:
+        case NEQ:
+        case GE:
+        case GT:
+            if (isDiscrete(expr[0].getType()) && isDiscrete(expr[1].getType())) {
+                assumeComparison(expr, truth, env);
+                return;
+            }
+            break;
+
+        default: break;
+        }
+        auto place = place_t{};
+        auto located = false;
+        const auto value = operand(expr, env, place, located);
+        if (env.dead)
+            return;
+        if (truth ? !mayBeTrue(value) : !mayBeFalse(value)) {
+            env.dead = true;
+        } else if (located && place.offsets.size() == 1 && isDiscrete(expr.getType())) {
+            auto refined = value;
+            if (!truth)
+                refined = constant(0);
+            else if (refined.first() == 0)
+                refined = {1, refined.last()};
+            else if (refined.last() == 0)
+                refined = {refined.first(), -1};
+            resolve(place, env)->values[place.offsets.front()] = refined;
+        }
+    }
+
+    void Engine::assumeComparison(const expression_t& expr, bool truth, env_t& env)
+    {
+        const auto kind = truth ? expr.getKind() : negate(expr.getKind());
+        auto left = place_t{}, right = place_t{};
+        auto leftLocated = false, rightLocated = false;
+        const auto a = operand(expr[0], env, left, leftLocated);
+        const auto b = operand(expr[1], env, right, rightLocated);
+        if (env.dead)
+            return;
+        if (a.empty() || b.empty()) {
+            env.dead = true;
+            return;
+        }
+        threshold(a);
+        threshold(b);
+        auto na = a, nb = b;
+        switch (kind) {
+        case LT:
+            na &= interval_t{min32, b.last() - 1};
+            nb &= interval_t{a.first() + 1, max32};
+            break;
+        case LE:
+            na &= interval_t{min32, b.last()};
+            nb &= interval_t{a.first(), max32};
+            break;
+        case GT:
+            na &= interval_t{b.first() + 1, max32};
+            nb &= interval_t{min32, a.last() - 1};
+            break;
+        case GE:
+            na &= interval_t{b.first(), max32};
+            nb &= interval_t{min32, a.last()};
+            break;
+        case EQ:
+            na &= b;
+            nb &= a;
+            break;
+        default:
+            if (isSingleton(a) && a == b) {
+                na = nb = bottom();
+            } else if (isSingleton(b)) {
+                na = a.first() == b.first() ? interval_t{a.first() + 1, a.last()}
+                                            : (a.last() == b.first() ? interval_t{a.first(), a.last() - 1} : a);
+            } else if (isSingleton(a)) {
+                nb = b.first() == a.first() ? interval_t{b.first() + 1, b.last()}
+                                            : (b.last() == a.first() ? interval_t{b.first(), b.last() - 1} : b);
+            }
+            break;
+        }
+        if (na.empty() || nb.empty()) {
+            env.dead = true;
+            return;
+        }
+        // Only variables known exactly are narrowed, e.g. not a[i] with several possible i
+        if (leftLocated && left.offsets.size() == 1)
+            resolve(left, env)->values[left.offsets.front()] = na;
+        if (rightLocated && right.offsets.size() == 1)
+            resolve(right, env)->values[right.offsets.front()] = nb;
+    }
+
+    /** Binds the symbol to any value of its type in the innermost scope. */
+    void Engine::bind(const symbol_t& symbol, env_t& env)
+    {
+        auto bounds = cells_t{};
+        if (!layout(symbol.getType(), env, bounds))
+            return;
+        auto& store = calls.empty() ? env.locals : env.frames.back();
+        store[symbol] = object_t{bounds, std::make_shared<const cells_t>(bounds)};
+    }
+
+    void Engine::unbind(const symbol_t& symbol, env_t& env)
+    {
+        auto& store = calls.empty() ? env.locals : env.frames.back();
+        store.erase(symbol);
+    }
+
+    RangeAnalysis::elements_t convert(const cells_t& cells)
+    {
+        auto elements = RangeAnalysis::elements_t{};
+        elements.reserve(cells.size());
+        for (const auto& cell : cells) {
+            if (cell.empty())
+                elements.push_back(RangeAnalysis::range_type::make_empty());
+            else
+                elements.emplace_back(static_cast<int32_t>(cell.first()), static_cast<int32_t>(cell.last()));
+        }
+        return elements;
+    }
+}  // namespace
+
+RangeAnalysis::RangeAnalysis(Document& doc, bool reachable)
+{
+    auto engine = Engine{doc};
+    if (reachable)
+        engine.run();
+    const auto bounds = [reachable](const symbol_t& symbol, const object_t& object) {
+        return convert(reachable || symbol.getType().isConstant() ? object.values : *object.bounds);
+    };
+    for (const auto& [symbol, object] : engine.getGlobals())
+        globals.emplace(symbol, bounds(symbol, object));
+    engine.forEachProcess([&](const instance_t& process, const store_t& store) {
+        auto& variables = locals[&process];
+        for (const auto& [symbol, object] : store)
+            variables.emplace(symbol, bounds(symbol, object));
+    });
+}
+
+const RangeAnalysis::elements_t* RangeAnalysis::getElements(const symbol_t& variable) const
+{
+    const auto it = globals.find(variable);
+    return it != globals.end() ? &it->second : nullptr;
+}
+
+const RangeAnalysis::elements_t* RangeAnalysis::getElements(const instance_t& process, const symbol_t& variable) const
+{
+    const auto it = locals.find(&process);
+    if (it == locals.end())
+        return nullptr;
+    const auto var = it->second.find(variable);
+    return var != it->second.end() ? &var->second : nullptr;
+}
+
+static RangeAnalysis::range_type hull(const RangeAnalysis::elements_t* elements)
+{
+    auto range = RangeAnalysis::range_type::make_empty();
+    if (elements != nullptr) {
+        for (const auto& element : *elements) {
+            if (range.empty())
+                range = element;
+            else if (!element.empty())
+                range |= element;
+        }
+    }
+    return range;
+}
+
+RangeAnalysis::range_type RangeAnalysis::getRange(const symbol_t& variable) const
+{
+    return hull(getElements(variable));
+}
+
+RangeAnalysis::range_type RangeAnalysis::getRange(const instance_t& process, const symbol_t& variable) const
+{
+    return hull(getElements(process, variable));
+}
@@ -24,11 +24,18 @@
 
 #include "utap/common.h"
 
+#include <algorithm>
 #include <iomanip>  // std::quoted
 #include <iostream>
 #include <iterator>  // ostream_iterator
+#include <queue>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <atomic>
 #include <cassert>
 
 using std::cerr;
@@ -37,17 +44,250 @@ using UTAP::DistanceCalculator;
 using UTAP::SignalFlow;
 using UTAP::Partitioner;
 using UTAP::Document;
+using namespace UTAP;
 using namespace UTAP::Constants;
 
-SignalFlow::SignalFlow(const std::string& title, Document& doc): title{title}
+namespace
+{
+    /** The raw I/O information of one process, named by process-local identifiers. */
+    struct flow_t
+    {
+        std::vector<std::string> names;  // channel and variable names by local identifier
+        std::unordered_map<std::string, uint32_t> ids;
+        std::vector<uint32_t> inputs, outputs;                     // channels
+        std::vector<std::pair<uint32_t, uint32_t>> reads, writes;  // variables with channels
+    };
+
+    constexpr auto noChannel = SignalFlow::graph_t::noChannel;
+
+    /**
+     * Extracts the read/write information of one process from UCode.
+     * Instances share nothing but the (unchanged) document, so
+     * processes can be visited in parallel.
+     */
+    class FlowCollector : public StatementVisitor
+    {
+    public:
+        using exprref_t = SignalFlow::exprref_t;
+
+        explicit FlowCollector(flow_t& flow): flow{flow} {}
+
+        void visitProcess(instance_t&);
+
+        /**
+         * System visitor pattern extracts read/write information from UCode.
+         * This is actually "const" visitor and should contain "const Statement *stat".
+         */
+        int32_t visitEmptyStatement(EmptyStatement* stat) override;
+        int32_t visitExprStatement(ExprStatement* stat) override;
+        int32_t visitForStatement(ForStatement* stat) override;
+        int32_t visitIterationStatement(IterationStatement* stat) override;
+        int32_t visitWhileStatement(WhileStatement* stat) override;
+        int32_t visitDoWhileStatement(DoWhileStatement* stat) override;
+        int32_t visitBlockStatement(BlockStatement* stat) override;
+        int32_t visitSwitchStatement(SwitchStatement* stat) override;
+        int32_t visitCaseStatement(CaseStatement* stat) override;
+        int32_t visitDefaultStatement(DefaultStatement* stat) override;
+        int32_t visitIfStatement(IfStatement* stat) override;
+        int32_t visitBreakStatement(BreakStatement* stat) override;
+        int32_t visitContinueStatement(ContinueStatement* stat) override;
+        int32_t visitReturnStatement(ReturnStatement* stat) override;
+        int32_t visitAssertStatement(UTAP::AssertStatement* stat) override;
+
+    private:
+        flow_t& flow;
+        instance_t* cP{nullptr};    // current process in traversal
+        uint32_t cChan{noChannel};  // channel on current transition in traversal
+        std::string chanString;
+        bool inp{false}, out{false}, sync{false}, paramsExpanded{false};  // current expression state
+        std::stack<std::pair<bool, bool>> ioStack;                        // remember I/O state
+        std::stack<exprref_t> refparams;                                  // parameter passed by reference
+        std::stack<exprref_t> valparams;                                  // parameter passed by value
+
+        bool checkParams(const symbol_t& s);  // maps parameter to global symbol
+        uint32_t intern(const std::string& name);
+        void addChan(const std::string&, std::vector<uint32_t>&);
+        void addVar(const symbol_t&, std::vector<std::pair<uint32_t, uint32_t>>&);
+        void visitExpression(const expression_t&);
+        void pushIO() { ioStack.push(std::make_pair(inp, out)); }
+        void popIO()
+        {
+            inp = ioStack.top().first;
+            out = ioStack.top().second;
+            ioStack.pop();
+        }
+    };
+
+    /** Turns edge lists into adjacency lists over the given number of nodes. */
+    SignalFlow::adjacency_t transpose(const SignalFlow::adjacency_t& adjacency, uint32_t nodes)
+    {
+        auto result = SignalFlow::adjacency_t{};
+        result.offsets.assign(nodes + 1, 0);
+        for (auto t : adjacency.targets)
+            ++result.offsets[t + 1];
+        for (uint32_t i = 0; i < nodes; ++i)
+            result.offsets[i + 1] += result.offsets[i];
+        result.targets.resize(adjacency.targets.size());
+        auto fill = std::vector<uint32_t>(result.offsets.begin(), result.offsets.end() - 1);
+        for (uint32_t i = 0; i < adjacency.nodes(); ++i)
+            for (auto* t = adjacency.begin(i); t != adjacency.end(i); ++t)
+                result.targets[fill[*t]++] = i;
+        return result;
+    }
+
+    /** Names the local identifiers used by the flows in the given way in a common, sorted order. */
+    template <typename Used>
+    std::vector<std::string> sortedNames(const std::vector<flow_t>& flows, Used&& used)
+    {
+        auto names = std::vector<std::string>{};
+        for (const auto& flow : flows)
+            used(flow, [&](uint32_t id) { names.push_back(flow.names[id]); });
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+        return names;
+    }
+
+    std::vector<uint32_t> globalIds(const flow_t& flow, const std::vector<std::string>& names)
+    {
+        auto ids = std::vector<uint32_t>(flow.names.size(), noChannel);
+        for (uint32_t i = 0; i < flow.names.size(); ++i) {
+            auto it = std::lower_bound(names.begin(), names.end(), flow.names[i]);
+            if (it != names.end() && *it == flow.names[i])
+                ids[i] = static_cast<uint32_t>(it - names.begin());
+        }
+        return ids;
+    }
+
+    void appendChannels(SignalFlow::adjacency_t& adjacency, const std::vector<uint32_t>& local,
+                        const std::vector<uint32_t>& ids)
+    {
+        const auto start = adjacency.targets.size();
+        for (auto c : local)
+            adjacency.targets.push_back(ids[c]);
+        std::sort(adjacency.targets.begin() + start, adjacency.targets.end());
+        adjacency.targets.erase(std::unique(adjacency.targets.begin() + start, adjacency.targets.end()),
+                                adjacency.targets.end());
+        adjacency.offsets.push_back(static_cast<uint32_t>(adjacency.targets.size()));
+    }
+
+    void appendVariables(SignalFlow::adjacency_t& variables, SignalFlow::adjacency_t& channels,
+                         const std::vector<std::pair<uint32_t, uint32_t>>& local,
+                         const std::vector<uint32_t>& varIds, const std::vector<uint32_t>& chanIds)
+    {
+        auto accesses = std::vector<std::pair<uint32_t, uint32_t>>{};
+        accesses.reserve(local.size());
+        for (auto [v, c] : local)
+            accesses.emplace_back(varIds[v], c == noChannel ? noChannel : chanIds[c]);
+        std::sort(accesses.begin(), accesses.end());
+        accesses.erase(std::unique(accesses.begin(), accesses.end()), accesses.end());
+        for (size_t i = 0; i < accesses.size(); ++i) {
+            channels.targets.push_back(accesses[i].second);
+            if (i + 1 == accesses.size() || accesses[i + 1].first != accesses[i].first) {
+                variables.targets.push_back(accesses[i].first);
+                channels.offsets.push_back(static_cast<uint32_t>(channels.targets.size()));
+            }
+        }
+        variables.offsets.push_back(static_cast<uint32_t>(variables.targets.size()));
+    }
+
+    /** Merges the flows of the processes into a graph over global identifiers. */
+    void buildGraph(SignalFlow::graph_t& graph, const std::vector<flow_t>& flows)
+    {
+        graph.channels = sortedNames(flows, [](const flow_t& flow, auto&& use) {
+            for (auto c : flow.inputs)
+                use(c);
+            for (auto c : flow.outputs)
+                use(c);
+        });
+        graph.variables = sortedNames(flows, [](const flow_t& flow, auto&& use) {
+            for (const auto& access : flow.reads)
+                use(access.first);
+            for (const auto& access : flow.writes)
+                use(access.first);
+        });
+        for (const auto& flow : flows) {
+            const auto chanIds = globalIds(flow, graph.channels);
+            const auto varIds = globalIds(flow, graph.variables);
+            appendChannels(graph.inputs, flow.inputs, chanIds);
+            appendChannels(graph.outputs, flow.outputs, chanIds);
+            appendVariables(graph.reads, graph.readChannels, flow.reads, varIds, chanIds);
+            appendVariables(graph.writes, graph.writeChannels, flow.writes, varIds, chanIds);
+        }
+        const auto channelCount = static_cast<uint32_t>(graph.channels.size());
+        const auto variableCount = static_cast<uint32_t>(graph.variables.size());
+        graph.receivers = transpose(graph.inputs, channelCount);
+        graph.transmitters = transpose(graph.outputs, channelCount);
+        graph.readers = transpose(graph.reads, variableCount);
+        graph.writers = transpose(graph.writes, variableCount);
+    }
+}  // namespace
+
+static const char* noChan = "-";
+
+SignalFlow::SignalFlow(const std::string& title, Document& doc, uint32_t threads): title{title}
 {
     /*
      * Visit all processes in the document.
      * FIXME: it does not take care of autocompleted parameters,
      *        unfolding is intricate and is done outside UTAP.
      */
+    auto instances = std::vector<instance_t*>{};
     for (auto& proc : doc.getProcesses())
-        visitProcess(proc);
+        instances.push_back(&proc);
+    auto flows = std::vector<flow_t>(instances.size());
+    auto collect = [&](size_t i) { FlowCollector{flows[i]}.visitProcess(*instances[i]); };
+    threads = doc.isLocal() ? 0 : std::min<size_t>(threads, instances.size());
+    if (threads == 0) {
+        for (size_t i = 0; i < instances.size(); ++i)
+            collect(i);
+    } else {
+        auto next = std::atomic<size_t>{0};
+        auto workers = std::vector<std::thread>{};
+        for (uint32_t i = 0; i < threads; ++i)
+            workers.emplace_back([&] {
+                for (auto p = next++; p < instances.size(); p = next++)
+                    collect(p);
+            });
+        for (auto& worker : workers)
+            worker.join();
+    }
+    for (const auto* instance : instances)
+        graph.processes.push_back(instance->uid.getName());
+    buildGraph(graph, flows);
+
+    // the string based view used by the printers and the partitioning
+    channels.insert(graph.channels.begin(), graph.channels.end());
+    variables.insert(graph.variables.begin(), graph.variables.end());
+    auto addVars = [this](uint32_t p, proc_t* proc, const adjacency_t& vars, const adjacency_t& chans,
+                          str2strset_t& ids, str2procset_t& index) {
+        for (auto k = vars.offsets[p]; k < vars.offsets[p + 1]; ++k) {
+            const auto& name = graph.variables[vars.targets[k]];
+            auto& labels = ids[name];
+            for (auto* c = chans.begin(k); c != chans.end(k); ++c)
+                labels.insert(*c == noChannel ? noChan : graph.channels[*c]);
+            index[name].insert(proc);
+        }
+    };
+    /* The printers list procs in the order of their addresses, so the
+     * processes are allocated one by one in system order, each followed
+     * by its sets, as they were by the traversal.
+     */
+    procList.reserve(graph.processes.size());
+    for (uint32_t p = 0; p < graph.processes.size(); ++p) {
+        auto* proc = procList.emplace_back(std::make_unique<proc_t>(graph.processes[p])).get();
+        procs.insert(proc);
+        processes.insert(proc->name);
+        for (auto* c = graph.inputs.begin(p); c != graph.inputs.end(p); ++c) {
+            proc->inChans.insert(graph.channels[*c]);
+            receivers[graph.channels[*c]].insert(proc);
+        }
+        for (auto* c = graph.outputs.begin(p); c != graph.outputs.end(p); ++c) {
+            proc->outChans.insert(graph.channels[*c]);
+            transmitters[graph.channels[*c]].insert(proc);
+        }
+        addVars(p, proc, graph.reads, graph.readChannels, proc->rdVars, receivers);
+        addVars(p, proc, graph.writes, graph.writeChannels, proc->wtVars, transmitters);
+    }
 }
 
 void SignalFlow::printForTron(std::ostream& os)
@@ -236,15 +476,14 @@ void SignalFlow::printForDot(std::ostream& os, bool ranked, bool erd, bool cEdge
     os << "}" << endl;
 }
 
-bool SignalFlow::checkParams(const symbol_t& s)
+bool FlowCollector::checkParams(const symbol_t& s)
 {
     if (!paramsExpanded) {
         if (0 <= cP->templ->parameters.getIndexOf(s.getName())) {
             // is it parameter? find the corresponding global symbol(s)
-            auto e = cP->mapping.find(s);
-            if (e != cP->mapping.end()) {
+            if (auto e = cP->getArgument(s); !e.empty()) {
                 paramsExpanded = true;
-                visitExpression(e->second);
+                visitExpression(e);
                 paramsExpanded = false;
             } else {
                 cerr << "mapping param '" << s.getName() << "' failed" << endl;
@@ -264,50 +503,43 @@ bool SignalFlow::checkParams(const symbol_t& s)
     return true;
 }
 
-void SignalFlow::addChan(const std::string& s, strset_t& ids, str2procset_t& index)
+uint32_t FlowCollector::intern(const std::string& name)
 {
-    std::string s2;
-    auto it = channels.find(s.c_str());
-    if (it == channels.end()) {
-        s2 = s;
-        channels.insert(s2);
-    } else
-        s2 = *it;
-    ids.insert(s2);
-    index[s2].insert(cTA);
-    cChan = s2;
+    auto [it, added] = flow.ids.emplace(name, static_cast<uint32_t>(flow.names.size()));
+    if (added)
+        flow.names.push_back(name);
+    return it->second;
 }
 
-void SignalFlow::addVar(const symbol_t& s, str2strset_t& ids, str2procset_t& index)
+void FlowCollector::addChan(const std::string& s, std::vector<uint32_t>& ids)
 {
-    if (checkParams(s)) {
-        ids[s.getName()].insert(cChan);
-        variables.insert(s.getName());
-        index[s.getName()].insert(cTA);
-    }
+    cChan = intern(s);
+    ids.push_back(cChan);
 }
 
-static const char* noChan = "-";
+void FlowCollector::addVar(const symbol_t& s, std::vector<std::pair<uint32_t, uint32_t>>& ids)
+{
+    if (checkParams(s))
+        ids.emplace_back(intern(s.getName()), cChan);
+}
 
-void SignalFlow::visitProcess(instance_t& p)
+void FlowCollector::visitProcess(instance_t& p)
 {
     cP = &p;
-    procs.insert(cTA = new proc_t(p.uid.getName().c_str()));
-    processes.insert(p.uid.getName().c_str());
 
     for (const auto& s : p.templ->states) {
-        cChan = noChan;  // invariants should not use shared
+        cChan = noChannel;  // invariants should not use shared
         visitExpression(s.invariant);
     }
     for (const auto& t : p.templ->edges) {
-        cChan = noChan;  // guards should not use shared
+        cChan = noChannel;  // guards should not use shared
         visitExpression(t.guard);
         visitExpression(t.sync);
         visitExpression(t.assign);
     }
 }
 
-void SignalFlow::visitExpression(const expression_t& e)
+void FlowCollector::visitExpression(const expression_t& e)
 {
     if (e.empty()) {
         return;
@@ -422,9 +654,9 @@ void SignalFlow::visitExpression(const expression_t& e)
                 // else: local function variable but not parameter, don't care
             } else {  // global variable
                 if (inp)
-                    addVar(sym, cTA->rdVars, receivers);
+                    addVar(sym, flow.reads);
                 if (out)
-                    addVar(sym, cTA->wtVars, transmitters);
+                    addVar(sym, flow.writes);
             }
         }
         break;
@@ -516,11 +748,11 @@ void SignalFlow::visitExpression(const expression_t& e)
         chanString.clear();
         visitExpression(e[0]);
         if (inp) {
-            addChan(chanString, cTA->inChans, receivers);
+            addChan(chanString, flow.inputs);
             //            std::cerr << cTA->name << " receives on " << chanString << endl;
         }
         if (out) {
-            addChan(chanString, cTA->outChans, transmitters);
+            addChan(chanString, flow.outputs);
             //            std::cerr << cTA->name << " sends on " << chanString << endl;
         }
         sync = false;
@@ -554,21 +786,21 @@ void SignalFlow::visitExpression(const expression_t& e)
     }
 }
 
-int32_t SignalFlow::visitEmptyStatement(EmptyStatement* stat) { return 0; }
+int32_t FlowCollector::visitEmptyStatement(EmptyStatement* stat) { return 0; }
 
-int32_t SignalFlow::visitExprStatement(ExprStatement* stat)
+int32_t FlowCollector::visitExprStatement(ExprStatement* stat)
 {
     visitExpression(stat->expr);
     return 0;
 }
 
-int32_t SignalFlow::visitIterationStatement(IterationStatement* stat)
+int32_t FlowCollector::visitIterationStatement(IterationStatement* stat)
 {
     // FixMe: there is mysterious field called symbol, do smth about it.
     return stat->stat->accept(this);
 }
 
-int32_t SignalFlow::visitForStatement(ForStatement* stat)
+int32_t FlowCollector::visitForStatement(ForStatement* stat)
 {
     visitExpression(stat->init);
     visitExpression(stat->cond);
@@ -576,20 +808,20 @@ int32_t SignalFlow::visitForStatement(ForStatement* stat)
     return stat->stat->accept(this);
 }
 
-int32_t SignalFlow::visitWhileStatement(WhileStatement* stat)
+int32_t FlowCollector::visitWhileStatement(WhileStatement* stat)
 {
     visitExpression(stat->cond);
     return stat->stat->accept(this);
 }
 
-int32_t SignalFlow::visitDoWhileStatement(DoWhileStatement* stat)
+int32_t FlowCollector::visitDoWhileStatement(DoWhileStatement* stat)
 {
     int32_t res = stat->stat->accept(this);
     visitExpression(stat->cond);
     return res;
 }
 
-int32_t SignalFlow::visitBlockStatement(BlockStatement* stat)
+int32_t FlowCollector::visitBlockStatement(BlockStatement* stat)
 {
     int32_t res = 0;
     BlockStatement::iterator it = stat->begin();
@@ -600,21 +832,21 @@ int32_t SignalFlow::visitBlockStatement(BlockStatement* stat)
     return res;
 }
 
-int32_t SignalFlow::visitSwitchStatement(SwitchStatement* stat)
+int32_t FlowCollector::visitSwitchStatement(SwitchStatement* stat)
 {
     visitExpression(stat->cond);
     return visitBlockStatement(stat);
 }
 
-int32_t SignalFlow::visitCaseStatement(CaseStatement* stat)
+int32_t FlowCollector::visitCaseStatement(CaseStatement* stat)
 {
     visitExpression(stat->cond);
     return visitBlockStatement(stat);
 }
 
-int32_t SignalFlow::visitDefaultStatement(DefaultStatement* stat) { return visitBlockStatement(stat); }
+int32_t FlowCollector::visitDefaultStatement(DefaultStatement* stat) { return visitBlockStatement(stat); }
 
-int32_t SignalFlow::visitIfStatement(IfStatement* stat)
+int32_t FlowCollector::visitIfStatement(IfStatement* stat)
 {
     visitExpression(stat->cond);
     int32_t res = stat->trueCase->accept(this);
@@ -623,23 +855,19 @@ int32_t SignalFlow::visitIfStatement(IfStatement* stat)
     } else
         return res;
 }
-int32_t SignalFlow::visitBreakStatement(BreakStatement* stat) { return 0; }
+int32_t FlowCollector::visitBreakStatement(BreakStatement* stat) { return 0; }
 
-int32_t SignalFlow::visitContinueStatement(ContinueStatement* stat) { return 0; }
+int32_t FlowCollector::visitContinueStatement(ContinueStatement* stat) { return 0; }
 
-int32_t SignalFlow::visitAssertStatement(UTAP::AssertStatement* stat) { return 0; }
+int32_t FlowCollector::visitAssertStatement(UTAP::AssertStatement* stat) { return 0; }
 
-int32_t SignalFlow::visitReturnStatement(ReturnStatement* stat)
+int32_t FlowCollector::visitReturnStatement(ReturnStatement* stat)
 {
     visitExpression(stat->value);
     return 0;
 }
 
-SignalFlow::~SignalFlow()
-{
-    for (auto* p : procs)
-        delete p;
-}
+SignalFlow::~SignalFlow() = default;
 
 inline void Partitioner::printViolation(const proc_t* proc, const std::string& var)
 {
@@ -648,167 +876,234 @@ inline void Partitioner::printViolation(const proc_t* proc, const std::string& v
              << endl;
 }
 
-/**
- * Adds processes to the result which use the channels from chans list
- * according to index. Reports inconsistency if some process happens to be
- * in exclude list.
- */
-void Partitioner::addProcs(const strset_t& chans, const str2procset_t& index, procset_t& result, procset_t& exclude)
-{
-    for (const auto& c : chans) {  // take each channel from the given set
-        auto c2p = index.find(c);  // find processes that use the channel
-        if (c2p != index.end()) {
-            for (auto* p : c2p->second) {
-                if (exclude.erase(p) > 0) {  // if process was excluded
-                    procsBad.insert(p);      // report as inconsistent process
-                    printViolation(p, c);
-                } else if (result.find(p) == result.end() && procsBad.find(p) == procsBad.end()) {
-                    // if process has not been added nor excluded, then add it:
-                    if (verbosity >= 3)
-                        cerr << "Adding \"" << p->name << "\" using \"" << c << "\" by rule \"" << rule << "\"" << endl;
-                    result.insert(p);
-                }
-            }
-        }
-    }
-}
+Partitioner::Partitioner(const std::string& title, Document& doc, uint32_t threads):
+    SignalFlow{title, doc, threads}
+{}
 
-/**
- * Takes the internal channels of each process from procs list and adds
- * them to the result list. Reports inconcistency if channel is in the
- * exclude list.
+namespace
+{
+    enum node_kind_t : uint8_t { PROCESS_NODE, CHANNEL_NODE, VARIABLE_NODE };
+
+    /* the rules by side (Env, IUT) */
+    const char* const channelRules[2] = {"internal channel belongs to Env if it is used by Env",
+                                         "internal channel belongs to IUT if it is used by IUT"};
+    const char* const transmitterRules[2] = {"process belongs to Env if it shouts on internal Env channel",
+                                             "process belongs to IUT if it shouts on internal IUT channel"};
+    const char* const receiverRules[2] = {"process belongs to Env if it listens to internal Env channel",
+                                          "process belongs to IUT if it listens to internal IUT channel"};
+    const char* const variableRules[2] = {"variable belongs to Env if accessed by Env without observable sync",
+                                          "variable belongs to IUT if accessed by IUT without observable sync"};
+    const char* const accessorRules[2] = {
+        "process belongs to Env if it access Env variable without observable synchronization",
+        "process belongs to IUT if it access IUT variable without observable synchronization"};
+}  // namespace
+
+/*
+ * The rules are applied in rounds in the order they always were, until
+ * a round adds no process: per side the observable channels, then the
+ * internal channels of the side's processes and the processes using
+ * them, then the variables accessed and the processes accessing them.
+ * An entity reached from both sides is in conflict and propagates both
+ * sides, so the result does not depend on the order of the rules.
+ * Since applying a rule again to an entity changes nothing, each rule
+ * only takes the entities that were added to its side since it was last
+ * applied, so every rule visits every entity once.  Traces follow the order of the sets the
+ * rules used to iterate: processes by address, the rest by name.
  */
-void Partitioner::addIntChans(const procset_t& procs, strset_t& result, strset_t& exclude)
+Partitioner::partition_t Partitioner::analyse(const strset_t& inputs, const strset_t& outputs, bool trace) const
 {
-    for (const auto* p : procs) {                          // take each process from the list
-        for (const auto& c : p->inChans) {                 // consider the input channels used by the process
-            if (observable.find(c) == observable.end()) {  // if not observed
-                if (exclude.erase(c) > 0) {                // if it's excluded
-                    chansBad.insert(c);                    // report inconsistency
-                    printViolation(p, c);
-                } else if (result.find(c) == result.end() && chansBad.find(c) == chansBad.end()) {
-                    if (verbosity >= 3)
-                        cerr << "Adding \"" << c << "\" because of \"" << p->name << "\" by rule \"" << rule << "\""
-                             << endl;
-                    result.insert(c);
-                }
-            }
+    const auto find = [](const std::vector<std::string>& names, const std::string& name) {
+        auto it = std::lower_bound(names.begin(), names.end(), name);
+        return it != names.end() && *it == name ? static_cast<uint32_t>(it - names.begin()) : graph_t::noChannel;
+    };
+    auto observed = std::vector<bool>(graph.channels.size());
+    for (const auto* names : {&inputs, &outputs})
+        for (const auto& name : *names)
+            if (auto c = find(graph.channels, name); c != graph_t::noChannel)
+                observed[c] = true;
+    /* an access is internal unless it only happens while synchronising on observable channels */
+    const auto internals = [&observed](const adjacency_t& channels) {
+        auto internal = std::vector<bool>(channels.nodes());
+        for (uint32_t k = 0; k < internal.size(); ++k)
+            for (auto* c = channels.begin(k); c != channels.end(k) && !internal[k]; ++c)
+                internal[k] = *c == graph_t::noChannel || !observed[*c];
+        return internal;
+    };
+    const auto readInternal = internals(graph.readChannels);
+    const auto writeInternal = internals(graph.writeChannels);
+    /* whether process p accesses variable v internally, given the accesses of one kind */
+    const auto accessesInternally = [](const adjacency_t& accesses, const std::vector<bool>& internal, uint32_t p,
+                                       uint32_t v) {
+        auto* k = std::lower_bound(accesses.begin(p), accesses.end(p), v);
+        return k != accesses.end(p) && *k == v && internal[k - accesses.targets.data()];
+    };
+
+    auto result = partition_t{};
+    result.processes.resize(graph.processes.size(), partition_t::FREE);
+    result.channels.resize(graph.channels.size(), partition_t::FREE);
+    result.variables.resize(graph.variables.size(), partition_t::FREE);
+    partition_t::side_t* sides[3] = {result.processes.data(), result.channels.data(), result.variables.data()};
+    const std::vector<std::string>* names[3] = {&graph.processes, &graph.channels, &graph.variables};
+
+    /* the entities added to each side, in the order they were added */
+    std::vector<uint32_t> added[2][3];
+    auto progress = false;
+    /* adds a node reached by the rule from (or by) a process using the entity */
+    const auto reach = [&](uint32_t side, node_kind_t kind, uint32_t node, const char* rule, uint32_t process,
+                           const std::string& entity) {
+        const auto mine = static_cast<partition_t::side_t>(1u << side);
+        auto& state = sides[kind][node];
+        if (state & mine)
+            return;  // already on this side or in conflict
+        state = static_cast<partition_t::side_t>(state | mine);
+        added[side][kind].push_back(node);
+        progress |= kind == PROCESS_NODE;
+        if (state == partition_t::BAD) {
+            if (trace && verbosity >= 1)
+                cerr << "Violated rule \"" << rule << "\" for process \"" << graph.processes[process]
+                     << "\" accessing \"" << entity << "\"" << endl;
+        } else if (trace && verbosity >= 3) {
+            const auto& name = (*names[kind])[node];
+            if (kind == PROCESS_NODE)
+                cerr << "Adding \"" << name << "\" using \"" << entity << "\" by rule \"" << rule << "\"" << endl;
+            else
+                cerr << "Adding \"" << name << "\" because of \"" << graph.processes[process] << "\" by rule \""
+                     << rule << "\"" << endl;
         }
-        for (const auto& c : p->outChans) {                // conside the output channels used by p
-            if (observable.find(c) == observable.end()) {  // if not observed
-                if (exclude.erase(c) > 0) {                // if it's excluded
-                    chansBad.insert(c);                    // report inconsistency
-                    printViolation(p, c);
-                } else if (result.find(c) == result.end() && chansBad.find(c) == chansBad.end()) {
-                    if (verbosity >= 3)
-                        cerr << "Adding \"" << c << "\" because of \"" << p->name << "\" by rule \"" << rule << "\""
-                             << endl;
-                    result.insert(c);
+    };
+    const auto byAddress = [this](uint32_t a, uint32_t b) {
+        return std::less<const proc_t*>{}(procList[a].get(), procList[b].get());
+    };
+    /* the processes of the adjacency list, in the order of the traces */
+    const auto processes = [&](const adjacency_t& index, uint32_t node) {
+        auto res = std::vector<uint32_t>(index.begin(node), index.end(node));
+        if (trace)
+            std::sort(res.begin(), res.end(), byAddress);
+        return res;
+    };
+    /* the entities added to the side since the cursor (or all if again), moving the cursor */
+    const auto fresh = [&](uint32_t side, node_kind_t kind, size_t& cursor, bool again = false) {
+        const auto& log = added[side][kind];
+        auto res = std::vector<uint32_t>{};
+        for (cursor = again ? 0 : cursor; cursor < log.size(); ++cursor)
+            if (sides[kind][log[cursor]] & (1u << side))
+                res.push_back(log[cursor]);
+        if (trace && kind == PROCESS_NODE)
+            std::sort(res.begin(), res.end(), byAddress);
+        else if (trace)
+            std::sort(res.begin(), res.end());
+        return res;
+    };
+
+    size_t channelCursor[2] = {}, variableCursor[2] = {}, chanUserCursor[2] = {}, accessorCursor[2] = {};
+    for (auto first = true; first || progress; first = false) {
+        progress = false;
+        /* Environment processes shout on inputs and listens to outputs, while IUT
+         * processes shout on outputs and listen to inputs.  Seeding once is
+         * enough, as applying these rules again adds nothing. */
+        if (first) {
+            const auto seed = [&](uint32_t side, const strset_t& chans, const adjacency_t& byChannel,
+                                  const adjacency_t& byVariable, const char* rule) {
+                for (const auto& name : chans) {  // the names are looked up among the variables as well
+                    const auto c = find(graph.channels, name);
+                    const auto v = c == graph_t::noChannel ? find(graph.variables, name) : graph_t::noChannel;
+                    if (c != graph_t::noChannel || v != graph_t::noChannel)
+                        for (auto p : c != graph_t::noChannel ? processes(byChannel, c) : processes(byVariable, v))
+                            reach(side, PROCESS_NODE, p, rule, p, name);
                 }
-            }
+            };
+            seed(0, inputs, graph.transmitters, graph.writers, "transmitters on input channels belong to Env");
+            seed(0, outputs, graph.receivers, graph.readers, "receivers on output channels belong to Env");
+            seed(1, inputs, graph.receivers, graph.readers, "receivers on input channels belong IUT");
+            seed(1, outputs, graph.transmitters, graph.writers, "transmitters on output channels belong IUT");
         }
-    }
-}
 
-/**
- * Takes the variables of each process from procs list and adds them to
- * the result list. Reports inconcistency if variable is in the exclude list.
- */
-void Partitioner::addIntVars(const procset_t& procs, strset_t& result, strset_t& exclude)
-{
-    for (const auto* p : procs) {  // take each process p
-        assert(p);
-        for (const auto& v2c : p->rdVars) {  // consider the variables being read
-            if (!includes(observable.begin(), observable.end(), v2c.second.begin(),
-                          v2c.second.end())) {  // contains non-observable channels
-                if (exclude.erase(v2c.first) > 0) {
-                    varsBad.insert(v2c.first);
-                    printViolation(p, v2c.first);
-                } else if (result.find(v2c.first) == result.end() && varsBad.find(v2c.first) == varsBad.end()) {
-                    if (verbosity >= 3)
-                        cerr << "Adding \"" << v2c.first << "\" because of \"" << p->name << "\" by rule \"" << rule
-                             << "\"" << endl;
-                    result.insert(v2c.first);
-                }
-            }  // else used only observably
+        /* 2) internal channel belongs to environment (IUT) if it is used by
+         *    environment (IUT) process (respectively). */
+        for (uint32_t side = 0; side < 2; ++side)
+            for (auto p : fresh(side, PROCESS_NODE, channelCursor[side]))
+                for (const auto* index : {&graph.inputs, &graph.outputs})
+                    for (auto* c = index->begin(p); c != index->end(p); ++c)
+                        if (!observed[*c])
+                            reach(side, CHANNEL_NODE, *c, channelRules[side], p, graph.channels[*c]);
+
+        /* 3) process belongs to environment (IUT) if it uses the internal environment
+         *    (IUT) channel (respectively). */
+        for (uint32_t side = 0; side < 2; ++side) {
+            const auto chans = fresh(side, CHANNEL_NODE, chanUserCursor[side]);
+            for (auto c : chans)
+                for (auto p : processes(graph.transmitters, c))
+                    reach(side, PROCESS_NODE, p, transmitterRules[side], p, graph.channels[c]);
+            for (auto c : chans)
+                for (auto p : processes(graph.receivers, c))
+                    reach(side, PROCESS_NODE, p, receiverRules[side], p, graph.channels[c]);
         }
-        for (const auto& v2c : p->wtVars) {  // consider the variables being written to by p
-            if (!includes(observable.begin(), observable.end(), v2c.second.begin(),
-                          v2c.second.end())) {  // contains non-observable channels
-                if (exclude.erase(v2c.first) > 0) {
-                    varsBad.insert(v2c.first);
-                    printViolation(p, v2c.first);
-                } else if (result.find(v2c.first) == result.end() && varsBad.find(v2c.first) == varsBad.end()) {
-                    if (verbosity >= 3)
-                        cerr << "Adding \"" << v2c.first << "\" because of \"" << p->name << "\" by rule \"" << rule
-                             << "\"" << endl;
-                    result.insert(v2c.first);
+
+        /* 4) variable belongs to environment (IUT) if it is accessed by environment
+         *    (IUT) process without observable input/output channel synchronization.
+         *    Variable is not cathegorized (can be either) if accessed consistently
+         *    only during observable input/output channel synchronization. */
+        for (uint32_t side = 0; side < 2; ++side)
+            for (auto p : fresh(side, PROCESS_NODE, variableCursor[side]))
+                for (const auto* accesses : {&graph.reads, &graph.writes}) {
+                    const auto& internal = accesses == &graph.reads ? readInternal : writeInternal;
+                    for (auto k = accesses->offsets[p]; k < accesses->offsets[p + 1]; ++k)
+                        if (internal[k])
+                            reach(side, VARIABLE_NODE, accesses->targets[k], variableRules[side], p,
+                                  graph.variables[accesses->targets[k]]);
                 }
-            }  // else used only observably
-        }
+
+        /* 5) process belongs to environment (IUT) if it accesses environment (IUT)
+         *    variable (respectively) without observable channel synchronization.
+         *    Variables nobody reads or writes are reported in every round. */
+        for (uint32_t side = 0; side < 2; ++side)
+            for (auto v : fresh(side, VARIABLE_NODE, accessorCursor[side], trace && verbosity >= 1)) {
+                const auto& name = graph.variables[v];
+                if (trace && verbosity >= 1 && graph.readers.size(v) == 0)
+                    cerr << "addProcsByVars could not find readers" << endl;
+                for (auto p : processes(graph.readers, v))
+                    if (accessesInternally(graph.reads, readInternal, p, v))
+                        reach(side, PROCESS_NODE, p, accessorRules[side], p, name);
+                if (trace && verbosity >= 1 && graph.writers.size(v) == 0)
+                    cerr << "addProcsByVars could not find writers for " << name << endl;
+                for (auto p : processes(graph.writers, v))
+                    if (accessesInternally(graph.writes, writeInternal, p, v))
+                        reach(side, PROCESS_NODE, p, accessorRules[side], p, name);
+            }
     }
+
+    const auto bad = [](const std::vector<partition_t::side_t>& sides) {
+        return std::find(sides.begin(), sides.end(), partition_t::BAD) != sides.end();
+    };
+    if (bad(result.processes) || bad(result.channels) || bad(result.variables))
+        result.status = 2;
+    else if (std::find(result.processes.begin(), result.processes.end(), partition_t::FREE) == result.processes.end())
+        result.status = 0;  // all procs are partitioned
+    else
+        result.status = 1;  // some left unpartitioned
+    return result;
 }
 
-/**
- * Take all variables and add all accessing processes to the list.
- * Report inconcistencies if process happens to be in exclude list.
- */
-void Partitioner::addProcsByVars(const strset_t& vars, procset_t& procs, procset_t& exclude)
+std::vector<Partitioner::partition_t> Partitioner::getPartitions(
+    const std::vector<std::pair<strset_t, strset_t>>& ioinfos, uint32_t threads) const
 {
-    for (const auto& v : vars) {       // take every variable v from the vars list
-        auto v2p = receivers.find(v);  // find list of processes that read from v
-        if (v2p != receivers.end()) {
-            for (auto* p : v2p->second) {  // take each process reading the value of v
-                auto v2c = p->rdVars.find(v);
-                if (v2c != p->rdVars.end()) {
-                    if (!includes(observable.begin(), observable.end(), v2c->second.begin(),
-                                  v2c->second.end())) {  // has unobservable synchronizations
-                        if (exclude.erase(p) > 0) {
-                            procsBad.insert(p);
-                            printViolation(p, v);
-                        } else if (procs.find(p) == procs.end() && procsBad.find(p) == procsBad.end()) {
-                            if (verbosity >= 3)
-                                cerr << "Adding \"" << p->name << "\" using \"" << v << "\" by rule \"" << rule << "\""
-                                     << endl;
-                            procs.insert(p);
-                        }
-                    }  // else used observably
-                } else {
-                    if (verbosity >= 1)
-                        cerr << "addProcsByVars could not find in rdVars" << endl;
-                }
-            }
-        } else {
-            if (verbosity >= 1)
-                cerr << "addProcsByVars could not find readers" << endl;
-        }
-        v2p = transmitters.find(v);
-        if (v2p != transmitters.end()) {
-            for (auto* p : v2p->second) {  // consider the process p which writes to v
-                auto v2c = p->wtVars.find(v);
-                if (v2c != p->wtVars.end()) {
-                    if (!includes(observable.begin(), observable.end(), v2c->second.begin(),
-                                  v2c->second.end())) {  // has unobservable synchronizations
-                        if (exclude.erase(p) > 0) {
-                            procsBad.insert(p);
-                            printViolation(p, v);
-                        } else if (procs.find(p) == procs.end() && procsBad.find(p) == procsBad.end()) {
-                            if (verbosity >= 3)
-                                cerr << "Adding \"" << p->name << "\" using \"" << v << "\" by rule \"" << rule << "\""
-                                     << endl;
-                            procs.insert(p);
-                        }
-                    }  // else used observably
-                } else {
-                    if (verbosity >= 1)
-                        cerr << "addProcsByVars could not find in wtVars" << endl;
-                }
-            }
-        } else {
-            if (verbosity >= 1)
-                cerr << "addProcsByVars could not find writers for " << v << endl;
-        }
+    auto results = std::vector<partition_t>(ioinfos.size());
+    auto next = std::atomic<size_t>{0};
+    const auto work = [&] {
+        for (auto i = next++; i < ioinfos.size(); i = next++)
+            results[i] = getPartition(ioinfos[i].first, ioinfos[i].second);
+    };
+    threads = std::min<size_t>(threads, ioinfos.size());
+    if (threads == 0) {
+        work();
+    } else {
+        auto workers = std::vector<std::thread>{};
+        for (uint32_t i = 0; i < threads; ++i)
+            workers.emplace_back(work);
+        for (auto& worker : workers)
+            worker.join();
     }
+    return results;
 }
 
 static std::istream& get_token(std::istream& in, std::string& token)
@@ -826,16 +1121,17 @@ static std::istream& get_token(std::istream& in, std::string& token)
                 return in;
         }
     }
+    if (token.length() > 0)
+        in.clear(std::ios::eofbit);  // the last token ends at the end of the input
     return in;
 }
 
-int Partitioner::partition(std::istream& ioinfo)
+void Partitioner::readIOInfo(std::istream& ioinfo, strset_t& inputs, strset_t& outputs)
 {
     std::string token;
-    strset_t inputs, outputs;
     std::ios::fmtflags flags = ioinfo.flags();
     ioinfo.unsetf(std::ios::skipws);
-    if (get_token(ioinfo, token) && token.empty()) {
+    if (get_token(ioinfo, token) && !token.empty()) {
         if (token != "input") {
             cerr << "\"input\" is expected instead of \"" << token << "\"" << endl;
             exit(EXIT_FAILURE);
@@ -850,6 +1146,12 @@ int Partitioner::partition(std::istream& ioinfo)
             outputs.insert(token);
     }
     ioinfo.flags(flags);
+}
+
+int Partitioner::partition(std::istream& ioinfo)
+{
+    strset_t inputs, outputs;
+    readIOInfo(ioinfo, inputs, outputs);
     return partition(inputs, outputs);
 }
 
@@ -857,10 +1159,13 @@ int Partitioner::partition(const strset_t& inputs, const strset_t& outputs)
 {
     procsEnv.clear();
     procsIUT.clear();
+    procsBad.clear();
     chansIntEnv.clear();
     chansIntIUT.clear();
+    chansBad.clear();
     varsEnv.clear();
     varsIUT.clear();
+    varsBad.clear();
     chansInp.clear();
     chansOut.clear();
 
@@ -876,60 +1181,29 @@ int Partitioner::partition(const strset_t& inputs, const strset_t& outputs)
         cerr << "Outputs: " << infix_print{chansOut, ","} << endl;
     }
 
-    size_t oldProgress = 0, progress = 0;
-    do {
-        oldProgress = progress;
-        /* Environment processes shout on inputs and listens to outputs, while IUT
-         * processes shout on outputs and listen to inputs. */
-        rule = "transmitters on input channels belong to Env";
-        addProcs(inputs, transmitters, procsEnv, procsIUT);
-        rule = "receivers on output channels belong to Env";
-        addProcs(outputs, receivers, procsEnv, procsIUT);
-        rule = "receivers on input channels belong IUT";
-        addProcs(inputs, receivers, procsIUT, procsEnv);
-        rule = "transmitters on output channels belong IUT";
-        addProcs(outputs, transmitters, procsIUT, procsEnv);
-
-        /* 1) channels, that are not declared as inputs/outputs, are non-observable,
-         *    called internal.*/
-
-        /* 2) internal channel belongs to environment (IUT) if it is used by
-         *    environment (IUT) process (respectively). Model is inconsistent and
-         *    cannot be partitioned if the internal channel is used by both environment
-         *    and IUT. */
-        rule = "internal channel belongs to Env if it is used by Env";
-        addIntChans(procsEnv, chansIntEnv, chansIntIUT);
-        rule = "internal channel belongs to IUT if it is used by IUT";
-        addIntChans(procsIUT, chansIntIUT, chansIntEnv);
-
-        /* 3) process belongs to environment (IUT) if it uses the internal environment
-         *    (IUT) channel (respectively). */
-        rule = "process belongs to Env if it shouts on internal Env channel";
-        addProcs(chansIntEnv, transmitters, procsEnv, procsIUT);
-        rule = "process belongs to Env if it listens to internal Env channel";
-        addProcs(chansIntEnv, receivers, procsEnv, procsIUT);
-        rule = "process belongs to IUT if it shouts on internal IUT channel";
-        addProcs(chansIntIUT, transmitters, procsIUT, procsEnv);
-        rule = "process belongs to IUT if it listens to internal IUT channel";
-        addProcs(chansIntIUT, receivers, procsIUT, procsEnv);
-
-        /* 4) variable belongs to environment (IUT) if it is accessed by environment
-         *    (IUT) process without observable input/output channel synchronization.
-         *    Variable is not cathegorized (can be either) if accessed consistently
-         *    only during observable input/output channel synchronization. */
-        rule = "variable belongs to Env if accessed by Env without observable sync";
-        addIntVars(procsEnv, varsEnv, varsIUT);
-        rule = "variable belongs to IUT if accessed by IUT without observable sync";
-        addIntVars(procsIUT, varsIUT, varsEnv);
-
-        /* 5) process belongs to environment (IUT) if it accesses environment (IUT)
-         *    variable (respectively) without observable channel synchronization. */
-        rule = "process belongs to Env if it access Env variable without observable synchronization";
-        addProcsByVars(varsEnv, procsEnv, procsIUT);
-        rule = "process belongs to IUT if it access IUT variable without observable synchronization";
-        addProcsByVars(varsIUT, procsIUT, procsEnv);
-        progress = procsEnv.size() + procsIUT.size() + procsBad.size();
-    } while (progress > oldProgress);
+    const auto result = analyse(inputs, outputs, true);
+    for (uint32_t p = 0; p < result.processes.size(); ++p) {
+        auto* proc = procList[p].get();
+        switch (result.processes[p]) {
+        case partition_t::ENV: procsEnv.insert(proc); break;
+        case partition_t::IUT: procsIUT.insert(proc); break;
+        case partition_t::BAD: procsBad.insert(proc); break;
+        default: break;
+        }
+    }
+    const auto fill = [](const std::vector<partition_t::side_t>& sides, const std::vector<std::string>& names,
+                         strset_t& env, strset_t& iut, strset_t& bad) {
+        for (size_t i = 0; i < sides.size(); ++i) {
+            switch (sides[i]) {
+            case partition_t::ENV: env.insert(names[i]); break;
+            case partition_t::IUT: iut.insert(names[i]); break;
+            case partition_t::BAD: bad.insert(names[i]); break;
+            default: break;
+            }
+        }
+    };
+    fill(result.channels, graph.channels, chansIntEnv, chansIntIUT, chansBad);
+    fill(result.variables, graph.variables, varsEnv, varsIUT, varsBad);
 
     if (verbosity >= 3) {
         cerr << "==== Partitioned =========================================\n";
@@ -961,14 +1235,10 @@ int Partitioner::partition(const strset_t& inputs, const strset_t& outputs)
         }
     }
 
-    if (!procsBad.empty() || !chansBad.empty() || !varsBad.empty())
-        return 2;
-    if (progress == procs.size())
-        return 0;  // all procs are partitioned
-    else
-        return 1;  // some left unpartitioned
+    return result.status;
 }
 
+
 #define BADSTYLE "style=filled,fillcolor=\"#FF8080\""
 #define IUTSTYLE "style=filled,fillcolor=\"#B8C0FF\""
 #define ENVSTYLE "style=filled,fillcolor=\"#C8FFC8\""
@@ -1232,150 +1502,117 @@ void Partitioner::fillWithIUTProcs(strset_t& procs)
         procs.insert(p->name);
 }
 
-void DistanceCalculator::addVariableNeedle(const std::string& var)
+namespace
 {
-    /* FIXME: find global variable if the variable is local process parameter*/
-    distancesUpToDate = false;
-    auto name = var.substr(0, var.find('.'));
+    /** Fills the rows of the sources taken from next with hops, see DistanceCalculator::getHops. */
+    void computeHops(const SignalFlow::adjacency_t& successors, const std::vector<uint32_t>& sources,
+                     std::vector<std::vector<uint32_t>>& rows, std::atomic<size_t>& next)
+    {
+        const auto nodes = successors.nodes();
+        const auto words = (nodes + 63) / 64;
+        auto visited = std::vector<uint64_t>(words), frontier = std::vector<uint64_t>(words),
+             reached = std::vector<uint64_t>(words);
+        for (auto i = next++; i < sources.size(); i = next++) {
+            const auto source = sources[i];
+            assert(source < nodes);
+            auto& row = rows[i];
+            row.assign(nodes, DistanceCalculator::unreachable);
+            std::fill(visited.begin(), visited.end(), 0);
+            std::fill(frontier.begin(), frontier.end(), 0);
+            visited[source / 64] = frontier[source / 64] = uint64_t{1} << (source % 64);
+            row[source] = 0;
+            for (uint32_t hops = 1, size = 1; size > 0; ++hops) {
+                std::fill(reached.begin(), reached.end(), 0);
+                size = 0;
+                for (uint32_t w = 0; w < words; ++w) {
+                    for (auto bits = frontier[w]; bits != 0; bits &= bits - 1) {
+                        const auto node = w * 64 + __builtin_ctzll(bits);
+                        for (auto* s = successors.begin(node); s != successors.end(node); ++s) {
+                            const auto bit = uint64_t{1} << (*s % 64);
+                            if ((visited[*s / 64] & bit) == 0) {
+                                visited[*s / 64] |= bit;
+                                reached[*s / 64] |= bit;
+                                row[*s] = hops;
+                                ++size;
+                            }
+                        }
+                    }
+                }
+                frontier.swap(reached);
+            }
+        }
+    }
+}  // namespace
 
-    if (variables.find(name) == variables.end()) {
-        cerr << "Variable not found: " << var << endl;
-        return;
+DistanceCalculator::DistanceCalculator(const std::string& title, Document& doc, uint32_t threads):
+    SignalFlow{title, doc, threads}, distancesUpToDate{false}, doc{doc}
+{
+    const auto procCount = static_cast<uint32_t>(graph.processes.size());
+    const auto nodes = procCount + static_cast<uint32_t>(graph.variables.size());
+    distances.resize(nodes);
+    needles.resize(nodes);
+    auto p = 0u;
+    for (const auto& instance : doc.getProcesses())  // in the order of graph.processes
+        distances[p++].complexity = instance.templ->edges.size();
+    for (uint32_t i = 0; i < procCount; ++i)
+        nodeIds.emplace(graph.processes[i], i);
+    for (uint32_t v = 0; v < graph.variables.size(); ++v)
+        nodeIds.emplace(graph.variables[v], procCount + v);
+
+    auto targets = std::vector<uint32_t>{};
+    for (uint32_t i = 0; i < procCount; ++i) {
+        targets.clear();
+        for (auto* c = graph.inputs.begin(i); c != graph.inputs.end(i); ++c)
+            targets.insert(targets.end(), graph.transmitters.begin(*c), graph.transmitters.end(*c));
+        for (auto* v = graph.reads.begin(i); v != graph.reads.end(i); ++v)
+            targets.push_back(procCount + *v);
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+        successors.targets.insert(successors.targets.end(), targets.begin(), targets.end());
+        successors.offsets.push_back(static_cast<uint32_t>(successors.targets.size()));
     }
-    dist_t* distance = nullptr;
-    str2dist_t::iterator i = distances.find(name);
-    if (i == distances.end()) {
-        varNeedles.insert(name);
-        distances[name] = dist_t{0, 1, 0};
-        // distance = &distances[name]; // FIXME: work-in-progress.
-    } else {
-        distance = &(i->second);
-        if (distance->hops == 0 && distance->distance == 0) {
-            /* double the complexity if mentioned several times */
-            distance->complexity = 2 * distance->complexity;
-        } else {
-            distance->hops = 0;
-            distance->distance = 0;
-        }
+    for (uint32_t v = 0; v < graph.variables.size(); ++v) {
+        successors.targets.insert(successors.targets.end(), graph.writers.begin(v), graph.writers.end(v));
+        successors.offsets.push_back(static_cast<uint32_t>(successors.targets.size()));
     }
 }
 
-void DistanceCalculator::addProcessNeedle(const std::string& proc)
+uint32_t DistanceCalculator::getNode(const std::string& name) const
 {
-    distancesUpToDate = false;
-    auto name = proc.substr(0, proc.find('.'));
-
-    if (processes.find(name) == processes.end()) {
-        cerr << "AddNeedle: Process not found: " << proc << endl;
-        return;
-    }
+    auto i = nodeIds.find(name);
+    return i == nodeIds.end() ? unreachable : i->second;
+}
 
-    dist_t* distance = nullptr;
-    str2dist_t::iterator i = distances.find(name);
-    if (i == distances.end()) {
-        procNeedles.insert(name);
-        distances[name] = dist_t{0u, calcComplexity(name), 0u};
-        // distance = &distances[name]; // FIXME: work-in-progress.
+void DistanceCalculator::addNeedle(uint32_t node)
+{
+    distancesUpToDate = false;
+    if (needles[node]) {
+        /* double the complexity if mentioned several times */
+        distances[node].complexity = 2 * distances[node].complexity;
     } else {
-        distance = &(i->second);
-        if (distance->hops == 0 && distance->distance == 0) {
-            /* double the complexity if mentioned several times */
-            distance->complexity = 2 * distance->complexity;
-        } else {
-            distance->hops = 0;
-            distance->distance = 0;
-        }
+        needles[node] = true;
     }
 }
 
-void DistanceCalculator::updateDistancesFromVariable(const std::string& name, const dist_t* d)
+void DistanceCalculator::addVariableNeedle(const std::string& var)
 {
-    // find all processes that transmit/write on this variable:
-    str2procset_t::const_iterator t = transmitters.find(name);
-    if (t == transmitters.end())
+    /* FIXME: find global variable if the variable is local process parameter*/
+    auto node = getNode(var.substr(0, var.find('.')));
+    if (node == unreachable || node < graph.processes.size()) {
+        cerr << "Variable not found: " << var << endl;
         return;
-    for (const auto* p : t->second) {
-        dist_t* distance = nullptr;
-        str2dist_t::iterator i = distances.find(p->name);
-        if (i == distances.end()) {
-            procNeedles.insert(p->name);
-            distances[p->name] = dist_t{d->hops + 1, calcComplexity(p->name), d->distance + d->complexity};
-            distance = &distances[p->name];
-        } else {
-            distance = &(i->second);
-            if (distance->distance <= d->distance + d->complexity)
-                continue;  // old distance is shorter, no changes to propagate
-            else {
-                distance->hops = d->hops + 1;
-                distance->distance = d->distance + d->complexity;
-            }
-        }
-        updateDistancesFromProcess(p->name, distance);
     }
+    addNeedle(node);
 }
 
-void DistanceCalculator::updateDistancesFromProcess(const std::string& name, const dist_t* d)
+void DistanceCalculator::addProcessNeedle(const std::string& proc)
 {
-    /* find the process structure representing this process */
-    auto s = std::find_if(procs.begin(), procs.end(), [&name](proc_t* p) { return p->name == name; });
-    if (s == procs.end()) {
-        cerr << "UpdateDistancesFromProcess: Process not found: " << name << endl;
+    auto node = getNode(proc.substr(0, proc.find('.')));
+    if (node == unreachable || node >= graph.processes.size()) {
+        cerr << "AddNeedle: Process not found: " << proc << endl;
         return;
     }
-    /* for each channel the process listens to: */
-    for (const auto& c : (*s)->inChans) {
-        /* find all processes that send on this channel: */
-        str2procset_t::const_iterator t = transmitters.find(c);
-        if (t == transmitters.end())
-            continue;
-        /* update the distances for each transmitting process */
-        for (const auto* p : t->second) {
-            dist_t* distance = nullptr;
-            str2dist_t::iterator i = distances.find(p->name);
-            if (i == distances.end()) {
-                procNeedles.insert(p->name);
-                distances[p->name] = dist_t{d->hops + 1, calcComplexity(p->name), d->distance + d->complexity};
-                distance = &distances[p->name];
-            } else {
-                distance = &(i->second);
-                if (distance->distance <= d->distance + d->complexity)
-                    continue;  // old distance is shorter no changes to propagate
-                else {
-                    distance->hops = d->hops + 1;
-                    distance->distance = d->distance + d->complexity;
-                }
-            }
-            updateDistancesFromProcess(p->name, distance);
-        }
-    }
-    /* for each variable the process reads from: */
-    for (const auto& v : (*s)->rdVars) {
-        dist_t* distance = nullptr;
-        str2dist_t::iterator i = distances.find(v.first);
-        if (i == distances.end()) {
-            varNeedles.insert(v.first);
-            distances[v.first] = dist_t{d->hops + 1, 1, d->distance + d->complexity};
-            distance = &distances[v.first];
-        } else {
-            distance = &(i->second);
-            if (distance->distance <= d->distance + d->complexity)
-                continue;  // old distance is shorter, no changes to propagate
-            else {
-                distance->hops = d->hops + 1;
-                distance->distance = d->distance + d->complexity;
-            }
-        }
-        updateDistancesFromVariable(v.first, distance);
-    }
-}
-
-uint32_t DistanceCalculator::calcComplexity(const std::string& process)
-{
-    uint32_t result = 0;
-    for (const auto& i : doc.getProcesses())
-        if (i.uid.getName() == process)
-            result += i.templ->edges.size();
-    return result;
+    addNeedle(node);
 }
 
 void DistanceCalculator::printProcsForDot(std::ostream& os, bool erd)
@@ -1390,11 +1627,11 @@ void DistanceCalculator::printProcsForDot(std::ostream& os, bool erd)
     os << "    ";
 
     for (const auto* p : procs) {
-        str2dist_t::const_iterator d = distances.find(p->name);
-        if (d == distances.end()) {
+        const auto& d = distances[getNode(p->name)];
+        if (d.distance == dist_t::maximum) {
             os << p->name << "[label=\"\\N\\n(( ?, ?))\"]; ";
         } else {
-            os << p->name << "[label=\"\\N\\n((" << d->second.hops << ", " << d->second.distance << "))\"]; ";
+            os << p->name << "[label=\"\\N\\n((" << d.hops << ", " << d.distance << "))\"]; ";
         }
     }
     os << "\n  }\n";
@@ -1415,11 +1652,11 @@ void DistanceCalculator::printVarsForDot(std::ostream& os, bool ranked, bool erd
         os << "    node [shape=rectangle,color=blue];\n    ";
     }
     for (const auto& i : variables) {
-        str2dist_t::const_iterator d = distances.find(i);
-        if (d == distances.end())
+        const auto& d = distances[getNode(i)];
+        if (d.distance == dist_t::maximum)
             os << i << "[label=\"\\N\\n(( ?, ?))\"";
         else
-            os << i << "[label=\"\\N\\n((" << d->second.hops << ", " << d->second.distance << "))\"";
+            os << i << "[label=\"\\N\\n((" << d.hops << ", " << d.distance << "))\"";
         if (transmitters.find(i) == transmitters.end())
             os << "]; ";  // const
         else
@@ -1433,12 +1670,12 @@ uint32_t DistanceCalculator::getDistance(const std::string& element)
     if (!distancesUpToDate)
         updateDistances();
 
-    str2dist_t::iterator f = distances.find(element);
-    if (f == distances.end()) {
+    auto node = getNode(element);
+    if (node == unreachable) {
         // cerr << "GetDistance: Process not found: " << element << endl;
         return dist_t::maximum;
     }
-    return f->second.distance;
+    return distances[node].distance;
 }
 
 void DistanceCalculator::printForDot(std::ostream& os, bool ranked, bool erd, bool cEdged)
@@ -1451,29 +1688,64 @@ void DistanceCalculator::printForDot(std::ostream& os, bool ranked, bool erd, bo
 
 void DistanceCalculator::updateDistances()
 {
-    /* cleanup the old stuff: put all distances at infinity=INT_MAX: */
-    for (auto& i : distances)
-        if (i.second.hops > 0) {
-            i.second.hops = dist_t::maximum;
-            i.second.distance = dist_t::maximum;
-        }
-    /* calculate distances from variable needles: */
-    for (const auto& i : varNeedles) {
-        str2dist_t::iterator f = distances.find(i);
-        if (f == distances.end()) {
-            cerr << "Variable not found: " << i << endl;
-            exit(EXIT_FAILURE);
+    /*
+     * Shortest paths from the needles (Dijkstra): leaving a node costs its
+     * complexity, ties in distance are broken by the number of hops.
+     */
+    using entry_t = std::tuple<uint32_t, uint32_t, uint32_t>;  // distance, hops, node
+    auto queue = std::priority_queue<entry_t, std::vector<entry_t>, std::greater<>>{};
+    for (uint32_t n = 0; n < distances.size(); ++n) {
+        auto& d = distances[n];
+        if (needles[n]) {
+            d.hops = d.distance = 0;
+            queue.emplace(0, 0, n);
+        } else {
+            d.hops = d.distance = dist_t::maximum;
         }
-        updateDistancesFromVariable(i, &(f->second));
     }
-    /* calculate distances from process needles: */
-    for (const auto& i : procNeedles) {
-        str2dist_t::iterator f = distances.find(i);
-        if (f == distances.end()) {
-            cerr << "Process not found: " << i << endl;
-            exit(EXIT_FAILURE);
+    while (!queue.empty()) {
+        auto [distance, hops, node] = queue.top();
+        queue.pop();
+        const auto& d = distances[node];
+        if (distance != d.distance || hops != d.hops)
+            continue;  // superseded by a shorter path
+        distance += d.complexity;
+        ++hops;
+        for (auto* s = successors.begin(node); s != successors.end(node); ++s) {
+            auto& next = distances[*s];
+            if (distance < next.distance || (distance == next.distance && hops < next.hops)) {
+                next.distance = distance;
+                next.hops = hops;
+                queue.emplace(distance, hops, *s);
+            }
         }
-        updateDistancesFromProcess(i, &(f->second));
     }
     distancesUpToDate = true;
 }
+
+std::vector<std::vector<uint32_t>> DistanceCalculator::getHops(const std::vector<uint32_t>& sources,
+                                                               uint32_t threads) const
+{
+    auto rows = std::vector<std::vector<uint32_t>>(sources.size());
+    auto next = std::atomic<size_t>{0};
+    threads = std::min<size_t>(threads, sources.size());
+    if (threads == 0) {
+        computeHops(successors, sources, rows, next);
+    } else {
+        auto workers = std::vector<std::thread>{};
+        for (uint32_t i = 0; i < threads; ++i)
+            workers.emplace_back([&] { computeHops(successors, sources, rows, next); });
+        for (auto& worker : workers)
+            worker.join();
+    }
+    return rows;
+}
+
+std::vector<std::vector<uint32_t>> DistanceCalculator::getHops(const strset_t& sources, uint32_t threads) const
+{
+    auto nodes = std::vector<uint32_t>{};
+    for (const auto& name : sources)
+        if (auto node = getNode(name); node != unreachable)
+            nodes.push_back(node);
+    return getHops(nodes, threads);
+}
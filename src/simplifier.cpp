@@ -0,0 +1,262 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/simplifier.h"
+
+#include "utap/bytecode.h"
+#include "utap/document.h"
+#include "utap/statement.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+using namespace UTAP;
+using namespace Constants;
+
+namespace
+{
+    bool isPure(const expression_t& expr)
+    {
+        auto writes = std::set<symbol_t>{};
+        expr.collectPossibleWrites(writes);
+        return writes.empty();
+    }
+
+    bool isConstant(const expression_t& expr) { return expr.getKind() == CONSTANT && expr.getType().isIntegral(); }
+
+    /** Returns the operand deciding a conjunction or disjunction of the type, an integer converted to 0 or 1. */
+    expression_t truthOf(const expression_t& operand, const type_t& type)
+    {
+        if (!operand.getType().isIntegral() || operand.getType().is(BOOL))
+            return operand;  // booleans, and the constraints of guards and invariants
+        const auto& position = operand.getPosition();
+        if (isConstant(operand)) {
+            auto constant = expression_t::createConstant(operand.getValue() != 0, position).clone();
+            constant.setType(type);
+            return constant;
+        }
+        return expression_t::createBinary(NEQ, operand, expression_t::createConstant(0, position), position, type);
+    }
+
+    expression_t join(expression_t first, expression_t second, const position_t& position)
+    {
+        if (first.empty() || second.empty())
+            return first.empty() ? second : first;
+        auto type = second.getType();
+        return expression_t::createBinary(COMMA, std::move(first), std::move(second), position, std::move(type));
+    }
+}  // namespace
+
+Simplifier::Simplifier(Document& doc, size_t maxStatements): doc{doc}, maxStatements{maxStatements}
+{
+    doc.accept(computable);
+}
+
+bool Simplifier::fold(const expression_t& expr, int32_t& value) const
+{
+    if (expr.getKind() == CONSTANT || !expr.getType().isIntegral() || !isPure(expr))
+        return false;
+    auto reads = std::set<symbol_t>{};
+    expr.collectPossibleReads(reads, true);
+    for (const auto& symbol : reads)
+        if (!computable.contains(symbol))
+            return false;
+    try {
+        auto compiler = BytecodeCompiler{};
+        const auto routine = compiler.compile(expr);
+        value = BytecodeInterpreter{compiler.getProgram()}.run(routine, nullptr);
+        return true;
+    } catch (const BytecodeError&) {
+        return false;  // e.g. a template parameter, which is only known per process
+    } catch (const EvaluationError&) {
+        return false;
+    }
+}
+
+expression_t Simplifier::simplify(const expression_t& expr)
+{
+    if (expr.empty() || expr.getKind() == CONSTANT)
+        return expr;
+    if (auto value = int32_t{0}; fold(expr, value)) {
+        ++folded;
+        auto constant = expression_t::createConstant(value, expr.getPosition()).clone();
+        constant.setType(expr.getType());
+        return constant;
+    }
+    if (auto result = expression_t{}; inlineCall(expr, false, result))
+        return result;
+    auto simplified = simplifyOperands(expr);
+    switch (simplified.getKind()) {
+    case AND:
+    case OR: {
+        // The constant deciding the value by itself: false for conjunctions, true for disjunctions
+        const auto decisive = simplified.getKind() == AND ? 0 : 1;
+        const auto first = simplified[0];
+        const auto second = simplified[1];
+        const auto type = simplified.getType();
+        if (isConstant(first))
+            return truthOf((first.getValue() != 0) == (decisive != 0) ? first : second, type);
+        if (isConstant(second) && (second.getValue() != 0) != (decisive != 0))
+            return truthOf(first, type);
+        if (isConstant(second) && isPure(first))
+            return truthOf(second, type);
+        return simplified;
+    }
+    case INLINEIF:
+        if (isConstant(simplified[0]))
+            return simplified[0].getValue() != 0 ? simplified[1] : simplified[2];
+        return simplified;
+    default: return simplified;
+    }
+}
+
+expression_t Simplifier::simplifyOperands(const expression_t& expr)
+{
+    const function_t* fun = nullptr;
+    if (expr.getKind() == FUNCALL && expr[0].getKind() == IDENTIFIER && expr[0].getType().isFunction())
+        fun = static_cast<const function_t*>(expr[0].getSymbol().getData());
+    auto result = expression_t{};
+    for (auto i = uint32_t{0}; i < expr.getSize(); ++i) {
+        const auto sub = expr[i];
+        // Arguments of reference parameters stay lvalues
+        const auto reference = fun != nullptr && fun->body && i > 0 &&
+                               fun->body->getFrame()[i - 1].getType().is(REF);
+        auto simplified = reference ? simplifyOperands(sub) : simplify(sub);
+        if (simplified == sub)
+            continue;
+        if (result.empty())
+            result = expr.clone();
+        result[i] = std::move(simplified);
+    }
+    return result.empty() ? expr : result;
+}
+
+bool Simplifier::inlineCall(const expression_t& call, bool update, expression_t& result)
+{
+    if (call.getKind() != FUNCALL || call[0].getKind() != IDENTIFIER || !call[0].getType().isFunction())
+        return false;
+    const auto* fun = static_cast<const function_t*>(call[0].getSymbol().getData());
+    if (fun == nullptr || !fun->body || !fun->variables.empty() ||
+        std::find(inlining.begin(), inlining.end(), fun) != inlining.end())
+        return false;
+    auto frame = fun->body->getFrame();
+    if (frame.getSize() != call.getSize() - 1)
+        return false;
+
+    // The body is a single return, or in updates a few expression statements
+    const auto returnOf = [](const std::unique_ptr<Statement>& stat) {
+        return dynamic_cast<const ReturnStatement*>(stat.get());
+    };
+    auto begin = fun->body->begin();
+    auto end = fun->body->end();
+    if (update && begin != end && returnOf(end[-1]) != nullptr && returnOf(end[-1])->value.empty())
+        --end;
+    auto statements = std::vector<expression_t>{};
+    auto value = expression_t{};
+    if (end - begin == 1 && returnOf(*begin) != nullptr) {
+        value = returnOf(*begin)->value;
+        if (value.empty() || !isPure(value))
+            return false;
+    } else if (update && static_cast<size_t>(end - begin) <= maxStatements) {
+        for (auto it = begin; it != end; ++it) {
+            const auto* stat = dynamic_cast<const ExprStatement*>(it->get());
+            if (stat == nullptr)
+                return false;
+            statements.push_back(stat->expr);
+        }
+    } else {
+        return false;
+    }
+
+    auto writes = std::set<symbol_t>{};
+    for (const auto& e : statements)
+        e.collectPossibleWrites(writes);
+    auto mapping = std::map<symbol_t, expression_t>{};
+    auto reads = std::vector<std::set<symbol_t>>(frame.getSize());
+    for (auto i = uint32_t{0}; i < frame.getSize(); ++i) {
+        const auto& parameter = frame[i];
+        const auto argument = call[i + 1];
+        if (!isPure(argument) || (!parameter.getType().is(REF) && writes.count(parameter) != 0))
+            return false;
+        argument.collectPossibleReads(reads[i]);
+        mapping.emplace(parameter, argument);
+    }
+    // The arguments are evaluated before the body in a call, so the body must not change what they read
+    for (auto i = uint32_t{0}; i < frame.getSize(); ++i)
+        for (const auto& symbol : writes) {
+            auto j = frame.getIndexOf(symbol);
+            const auto& changed = j >= 0 ? reads[j] : std::set<symbol_t>{symbol};
+            if (static_cast<uint32_t>(j) != i &&
+                std::any_of(changed.begin(), changed.end(), [&](const auto& s) { return reads[i].count(s) != 0; }))
+                return false;
+        }
+
+    inlining.push_back(fun);
+    if (!value.empty()) {
+        result = simplify(value.subst(mapping));
+    } else {
+        result = expression_t{};
+        for (const auto& e : statements)
+            result = join(std::move(result), simplifyUpdate(e.subst(mapping)), call.getPosition());
+    }
+    inlining.pop_back();
+    ++inlined;
+    return true;
+}
+
+expression_t Simplifier::simplifyUpdate(const expression_t& expr)
+{
+    if (expr.empty())
+        return expr;
+    if (expr.getKind() == COMMA) {
+        auto first = simplifyUpdate(expr[0]);
+        auto second = simplifyUpdate(expr[1]);
+        if (first == expr[0] && second == expr[1])
+            return expr;
+        return join(std::move(first), std::move(second), expr.getPosition());
+    }
+    if (auto result = expression_t{}; inlineCall(expr, true, result))
+        return result;
+    return simplify(expr);
+}
+
+void Simplifier::simplifyTemplates()
+{
+    const auto templ = [this](template_t& t) {
+        for (auto& state : t.states) {
+            state.invariant = simplify(state.invariant);
+            state.exponentialRate = simplify(state.exponentialRate);
+            state.costRate = simplify(state.costRate);
+        }
+        for (auto& edge : t.edges) {
+            edge.guard = simplify(edge.guard);
+            edge.sync = simplify(edge.sync);
+            edge.prob = simplify(edge.prob);
+            if (auto assign = simplifyUpdate(edge.assign); !(assign == edge.assign))
+                edge.assign = assign.empty() ? expression_t::createConstant(1, edge.assign.getPosition()) : assign;
+        }
+    };
+    for (auto& t : doc.getTemplates())
+        templ(t);
+    for (auto* t : doc.getDynamicTemplates())
+        templ(*t);
+}
@@ -0,0 +1,118 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/sourceindex.h"
+
+#include <algorithm>
+
+using namespace UTAP;
+
+static bool isKnown(const position_t& position)
+{
+    return position.start != position_t::unknown_pos && position.start < position.end;
+}
+
+template <typename T>
+void SourceIndex::Intervals<T>::add(const position_t& position, T value)
+{
+    auto lock = std::lock_guard{mutex};
+    entries.push_back({position, std::move(value)});
+    sorted = false;
+}
+
+template <typename T>
+void SourceIndex::Intervals<T>::sort() const
+{
+    std::sort(entries.begin(), entries.end(), [](const entry_t& a, const entry_t& b) {
+        return a.position.start < b.position.start || (a.position.start == b.position.start && a.position.end > b.position.end);
+    });
+    // the same node may have been recorded several times, e.g. a frame which was opened twice
+    auto same = [](const entry_t& a, const entry_t& b) {
+        return a.position.start == b.position.start && a.position.end == b.position.end && a.value == b.value;
+    };
+    entries.erase(std::unique(entries.begin(), entries.end(), same), entries.end());
+    leaves = 1;
+    while (leaves < entries.size())
+        leaves *= 2;
+    ends.assign(2 * leaves, 0);
+    for (size_t i = 0; i < entries.size(); ++i)
+        ends[leaves + i] = entries[i].position.end;
+    for (auto node = leaves - 1; node > 0; --node)
+        ends[node] = std::max(ends[2 * node], ends[2 * node + 1]);
+    sorted = true;
+}
+
+/** Returns the last of the first \a count entries in [first, last) ending after the position, or -1. */
+template <typename T>
+int64_t SourceIndex::Intervals<T>::rightmost(size_t node, size_t first, size_t last, size_t count,
+                                             uint32_t position) const
+{
+    if (first >= count || ends[node] <= position)
+        return -1;
+    if (last - first == 1)
+        return first;
+    const auto middle = (first + last) / 2;
+    const auto right = rightmost(2 * node + 1, middle, last, count, position);
+    return right >= 0 ? right : rightmost(2 * node, first, middle, count, position);
+}
+
+template <typename T>
+T SourceIndex::Intervals<T>::find(uint32_t position) const
+{
+    auto lock = std::lock_guard{mutex};
+    if (!sorted)
+        sort();
+    const auto starting = std::upper_bound(entries.begin(), entries.end(), position,
+                                           [](uint32_t position, const entry_t& e) { return position < e.position.start; });
+    const auto count = static_cast<size_t>(starting - entries.begin());
+    const auto index = rightmost(1, 0, leaves, count, position);
+    return index >= 0 ? entries[index].value : T{};
+}
+
+void SourceIndex::addExpression(const expression_t& expr)
+{
+    if (expr.empty() || !isKnown(expr.getPosition()))
+        return;
+    expressions.add(expr.getPosition(), expr);
+    if (expr.getKind() == Constants::IDENTIFIER) {
+        symbols.add(expr.getPosition(), expr.getSymbol());
+        auto lock = std::lock_guard{mutex};
+        uses[expr.getSymbol()].push_back(expr);
+    }
+}
+
+void SourceIndex::addDeclaration(const symbol_t& symbol)
+{
+    if (isKnown(symbol.getPosition()))
+        symbols.add(symbol.getPosition(), symbol);
+}
+
+expression_t SourceIndex::findExpression(uint32_t position) const { return expressions.find(position); }
+
+symbol_t SourceIndex::findSymbol(uint32_t position) const { return symbols.find(position); }
+
+const std::vector<expression_t>& SourceIndex::getUses(const symbol_t& symbol) const
+{
+    static const auto none = std::vector<expression_t>{};
+    auto lock = std::lock_guard{mutex};
+    auto it = uses.find(symbol);
+    return it != uses.end() ? it->second : none;
+}
@@ -0,0 +1,147 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/statelayout.h"
+
+#include "utap/document.h"
+#include "utap/rangeanalysis.h"
+
+#include <algorithm>
+#include <tuple>
+#include <cassert>
+
+using namespace UTAP;
+using namespace Constants;
+
+namespace
+{
+    /** Returns the bits needed for the values of the range above its lower bound. */
+    uint32_t widthOf(const range_t<int32_t>& range)
+    {
+        if (range.empty())
+            return 0;
+        auto span = static_cast<uint64_t>(int64_t{range.last()} - range.first());
+        auto width = uint32_t{0};
+        for (; span != 0; span >>= 1)
+            ++width;
+        return width;
+    }
+
+    /** Returns true if the symbol is a variable whose value is part of the state. */
+    bool isState(const symbol_t& symbol) { return !symbol.getType().isConstant() && !symbol.getType().is(REF); }
+}  // namespace
+
+StateLayout::StateLayout(Document& doc, const RangeAnalysis& analysis)
+{
+    for (const auto& var : doc.getGlobals().variables)
+        if (const auto* elements = analysis.getElements(var.uid); elements != nullptr && isState(var.uid))
+            add(nullptr, var.uid, 1, *elements);
+    for (const auto& process : doc.getProcesses()) {
+        auto instances = uint32_t{1};
+        for (auto i = size_t{0}; i < process.unbound; ++i) {
+            const auto range = analysis.getRange(process, process.parameters[i]);
+            if (!range.empty())
+                instances *= static_cast<uint32_t>(int64_t{range.last()} - range.first() + 1);
+        }
+        const auto local = [&](const symbol_t& symbol) {
+            if (const auto* elements = analysis.getElements(process, symbol); elements != nullptr && isState(symbol))
+                add(&process, symbol, instances, *elements);
+        };
+        for (const auto& parameter : process.templ->parameters)
+            local(parameter);
+        for (const auto& var : process.templ->variables)
+            local(var.uid);
+    }
+    pack();
+}
+
+StateLayout::StateLayout(Document& doc): StateLayout{doc, RangeAnalysis{doc, false}} {}
+
+void StateLayout::add(const instance_t* process, const symbol_t& uid, uint32_t instances,
+                      const std::vector<range_t<int32_t>>& elements)
+{
+    auto& variable = variables.emplace_back(variable_layout_t{process, uid, instances, {}});
+    variable.fields.reserve(elements.size() * instances);
+    for (auto i = uint32_t{0}; i < instances; ++i)
+        for (const auto& element : elements)
+            variable.fields.push_back({element.empty() ? 0 : element.first(), 0, widthOf(element)});
+    index.emplace(std::make_pair(process, uid), variables.size() - 1);
+}
+
+void StateLayout::pack()
+{
+    auto fields = std::vector<field_t*>{};
+    for (auto& variable : variables)
+        for (auto& field : variable.fields)
+            if (field.width > 0)
+                fields.push_back(&field);
+    std::stable_sort(fields.begin(), fields.end(),
+                     [](const field_t* a, const field_t* b) { return a->width > b->width; });
+    // The words by their free bits, so that the first with room is the fullest
+    auto room = std::multimap<uint32_t, size_t>{};
+    for (auto* field : fields) {
+        auto it = room.lower_bound(field->width);
+        auto word = words;
+        auto free = wordBits;
+        if (it != room.end()) {
+            std::tie(free, word) = *it;
+            room.erase(it);
+        } else {
+            ++words;
+        }
+        field->offset = static_cast<uint32_t>(word * wordBits + wordBits - free);
+        if (free > field->width)
+            room.emplace(free - field->width, word);
+        bits += field->width;
+    }
+}
+
+const StateLayout::variable_layout_t* StateLayout::find(const symbol_t& variable) const
+{
+    auto it = index.find({nullptr, variable});
+    return it != index.end() ? &variables[it->second] : nullptr;
+}
+
+const StateLayout::variable_layout_t* StateLayout::find(const instance_t& process, const symbol_t& variable) const
+{
+    auto it = index.find({&process, variable});
+    return it != index.end() ? &variables[it->second] : nullptr;
+}
+
+int32_t StateLayout::get(const uint64_t* state, const field_t& field)
+{
+    if (field.width == 0)
+        return field.lower;
+    const auto word = state[field.offset / wordBits] >> (field.offset % wordBits);
+    const auto mask = (uint64_t{1} << field.width) - 1;
+    return static_cast<int32_t>(field.lower + static_cast<int64_t>(word & mask));
+}
+
+void StateLayout::set(uint64_t* state, const field_t& field, int32_t value)
+{
+    assert(value >= field.lower && int64_t{value} - field.lower < (int64_t{1} << field.width));
+    if (field.width == 0)
+        return;
+    const auto shift = field.offset % wordBits;
+    const auto mask = ((uint64_t{1} << field.width) - 1) << shift;
+    auto& word = state[field.offset / wordBits];
+    word = (word & ~mask) | ((static_cast<uint64_t>(int64_t{value} - field.lower) << shift) & mask);
+}
@@ -0,0 +1,158 @@
+// -*- mode: C++; c-file-style: "stroustrup"; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+
+/* libutap - Uppaal Timed Automata Parser.
+   Copyright (C) 2026 Aalborg University.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+*/
+
+#include "utap/statistics.h"
+
+#include "utap/document.h"
+
+#include <atomic>
+#include <ostream>
+#include <utility>
+
+using namespace UTAP;
+
+static Statistics*& active()
+{
+    static thread_local Statistics* stats = nullptr;
+    return stats;
+}
+
+static std::atomic<uint64_t (*)()> allocationCounter{nullptr};
+
+static uint64_t countAllocations()
+{
+    const auto counter = allocationCounter.load(std::memory_order_relaxed);
+    return counter != nullptr ? counter() : 0;
+}
+
+const char* Statistics::getName(phase_t phase)
+{
+    switch (phase) {
+    case XML: return "xml";
+    case PARSER: return "parser";
+    case BUILDER: return "builder";
+    case BUILTINS: return "builtins";
+    case LIBRARIES: return "libraries";
+    case TYPECHECKER: return "typechecker";
+    case FEATURES: return "features";
+    default: return "unknown";
+    }
+}
+
+const char* Statistics::getName(count_t count)
+{
+    switch (count) {
+    case EXPRESSIONS: return "expressions";
+    case TYPES: return "types";
+    case SYMBOLS: return "symbols";
+    case FRAMES: return "frames";
+    case TEMPLATES: return "templates";
+    case EDGES: return "edges";
+    case INSTANCES: return "instances";
+    default: return "unknown";
+    }
+}
+
+void Statistics::clear()
+{
+    for (auto& phase : phases)
+        phase = phase_statistics_t{};
+    for (auto& count : counts)
+        count = 0;
+}
+
+void Statistics::setAllocationCounter(uint64_t (*counter)()) noexcept
+{
+    allocationCounter.store(counter, std::memory_order_relaxed);
+}
+
+Statistics* Statistics::current() noexcept { return active(); }
+
+uint64_t Statistics::createdNodes() const
+{
+    return counts[EXPRESSIONS] + counts[TYPES] + counts[SYMBOLS] + counts[FRAMES];
+}
+
+Statistics::Scope::Scope(Document& doc): doc{doc}, previous{active()}
+{
+    if (doc.getStatistics().isEnabled())
+        active() = &doc.getStatistics();
+}
+
+Statistics::Scope::~Scope() noexcept
+{
+    auto* stats = active();
+    active() = previous;
+    if (stats == nullptr || stats == previous || stats != &doc.getStatistics())
+        return;
+    stats->counts[TEMPLATES] = doc.getTemplates().size() + doc.getDynamicTemplates().size();
+    auto edges = uint64_t{0};
+    for (const auto& templ : doc.getTemplates())
+        edges += templ.edges.size();
+    for (const auto* templ : doc.getDynamicTemplates())
+        edges += templ->edges.size();
+    stats->counts[EDGES] = edges;
+    stats->counts[INSTANCES] = doc.getProcesses().size();
+}
+
+void Statistics::Phase::enter() noexcept
+{
+    parent = std::exchange(stats->top, this);
+    nodes = stats->createdNodes();
+    allocations = countAllocations();
+    start = std::chrono::steady_clock::now();
+}
+
+void Statistics::Phase::leave() noexcept
+{
+    const auto time = std::chrono::steady_clock::now() - start;
+    const auto created = stats->createdNodes() - nodes;
+    const auto allocated = countAllocations() - allocations;
+    auto& phase = stats->phases[this->phase];
+    phase.time += std::chrono::duration_cast<std::chrono::nanoseconds>(time) - nestedTime;
+    phase.nodes += created - nestedNodes;
+    phase.allocations += allocated - nestedAllocations;
+    ++phase.entries;
+    stats->top = parent;
+    if (parent != nullptr) {
+        parent->nestedTime += std::chrono::duration_cast<std::chrono::nanoseconds>(time);
+        parent->nestedNodes += created;
+        parent->nestedAllocations += allocated;
+    }
+}
+
+std::ostream& UTAP::operator<<(std::ostream& os, const Statistics& stats)
+{
+    os << "{\"phases\": {";
+    for (auto i = 0; i < Statistics::PHASES; ++i) {
+        const auto phase = static_cast<Statistics::phase_t>(i);
+        const auto& s = stats[phase];
+        os << (i ? ", \"" : "\"") << Statistics::getName(phase) << "\": {\"time_ns\": " << s.time.count()
+           << ", \"entries\": " << s.entries << ", \"nodes\": " << s.nodes << ", \"allocations\": " << s.allocations
+           << "}";
+    }
+    os << "}, \"counts\": {";
+    for (auto i = 0; i < Statistics::COUNTS; ++i) {
+        const auto count = static_cast<Statistics::count_t>(i);
+        os << (i ? ", \"" : "\"") << Statistics::getName(count) << "\": " << stats[count];
+    }
+    return os << "}}";
+}
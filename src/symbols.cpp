@@ -22,16 +22,22 @@
 #include "utap/symbols.h"
 
 #include "utap/expression.h"
+#include "utap/memoryreport.h"
+#include "utap/node.h"
 #include "utap/range.h"
+#include "utap/statistics.h"
 
 #include <algorithm>
-#include <map>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string_view>
 #include <vector>
 #include <cstdlib>
 
 using std::vector;
-using std::map;
 using std::ostream;
 using std::string;
 
@@ -42,21 +48,213 @@ using namespace Constants;
 
 //////////////////////////////////////////////////////////////////////////
 
-struct symbol_t::symbol_data : public std::enable_shared_from_this<symbol_t::symbol_data>
+namespace
+{
+    /**
+     * The state shared by a root frame and the frames created from it
+     * (see frame_t::createFrame and frame_t::createRoot), e.g. by the
+     * frames of one document, and kept alive by these frames and their
+     * symbols.  Every distinct name gets a small atom, so frames look
+     * symbols up by integer and symbols share one copy of their name;
+     * the names are released with the table.  Looking a name up takes
+     * no lock, only interning a new name does, as queries are parsed
+     * concurrently against one document.  The symbols created in the
+     * frames are numbered from 1 in the order they are created.
+     */
+    class SymbolTable
+    {
+    public:
+        static constexpr uint32_t none = UINT32_MAX;
+        struct name_t
+        {
+            uint32_t atom;
+            string text;
+            mutable std::atomic<uint32_t> version{0};  // see touch()
+            name_t(uint32_t atom, std::string_view text): atom{atom}, text{text} {}
+        };
+
+        SymbolTable() { current.store(tables.emplace_back(std::make_unique<slots_t>(8)).get()); }
+
+        /** Returns the name, or nullptr if no symbol of the table was ever given the name. */
+        const name_t* find(std::string_view text) const
+        {
+            const auto* table = current.load(std::memory_order_acquire);
+            for (auto i = hash(text) & table->mask;; i = (i + 1) & table->mask)
+                if (const auto* name = table->names[i].load(std::memory_order_acquire);
+                    name == nullptr || name->text == text)
+                    return name;
+        }
+
+        const name_t& intern(std::string_view text)
+        {
+            if (const auto* name = find(text))
+                return *name;
+            auto lock = std::lock_guard{mutex};
+            if (const auto* name = find(text))
+                return *name;
+            const auto& name = names.emplace_back(static_cast<uint32_t>(names.size()), text);
+            if (2 * names.size() > tables.back()->names.size()) {
+                // readers may still probe the old slots, thus they are kept until the table is released
+                auto& table = *tables.emplace_back(std::make_unique<slots_t>(2 * tables.back()->names.size()));
+                for (const auto& known : names)
+                    insert(table, known);
+                current.store(&table, std::memory_order_release);
+            } else {
+                insert(*tables.back(), name);
+            }
+            return name;
+        }
+
+        /** Records that a symbol of the name was added to or removed from a frame, renamed or retyped. */
+        static void touch(const name_t& name) { name.version.fetch_add(1, std::memory_order_relaxed); }
+
+        /** Returns the atom and the version of the name, or none if no symbol was ever given the name. */
+        frame_t::version_t version(std::string_view text) const
+        {
+            const auto* name = find(text);
+            return name ? frame_t::version_t{name->atom, name->version.load(std::memory_order_relaxed)}
+                        : frame_t::version_t{none, 0};
+        }
+
+        /** Returns the identifier of a new symbol; identifiers are not handed out again. */
+        uint32_t nextId() { return symbols.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+        /** Returns the bytes of the names and of the lookup slots. */
+        size_t bufferBytes() const
+        {
+            auto lock = std::lock_guard{mutex};
+            auto res = names.size() * sizeof(name_t);
+            for (const auto& name : names)
+                res += name.text.capacity() > string{}.capacity() ? name.text.capacity() + 1 : 0;
+            for (const auto& table : tables)
+                res += table->names.size() * sizeof(table->names[0]);
+            return res;
+        }
+
+    private:
+        /** Open addressing hash table from texts to names, the size is a power of two. */
+        struct slots_t
+        {
+            explicit slots_t(size_t size): mask{size - 1}, names(size) {}
+            size_t mask;
+            vector<std::atomic<const name_t*>> names;
+        };
+
+        mutable std::mutex mutex;  // serialises interning
+        std::deque<name_t> names;  // by atom, stable storage referenced by the slots and the symbols
+        vector<std::unique_ptr<slots_t>> tables;  // the last one is current, the earlier ones are retired
+        std::atomic<const slots_t*> current{nullptr};
+        std::atomic<uint32_t> symbols{0};  // the symbols created so far, 0 is the identifier of the empty symbol
+
+        static size_t hash(std::string_view text) { return std::hash<std::string_view>{}(text); }
+
+        static void insert(slots_t& table, const name_t& name)
+        {
+            auto i = hash(name.text) & table.mask;
+            while (table.names[i].load(std::memory_order_relaxed) != nullptr)
+                i = (i + 1) & table.mask;
+            table.names[i].store(&name, std::memory_order_release);
+        }
+    };
+
+    /** Returns the name as interned in the table, which differs from its own for symbols of other documents. */
+    const SymbolTable::name_t& nameIn(SymbolTable& table, const SymbolTable& own, const SymbolTable::name_t& name)
+    {
+        return &own == &table ? name : table.intern(name.text);
+    }
+
+    /** Open addressing hash table from atoms to symbol indices in a frame. */
+    class SymbolIndex
+    {
+    public:
+        int32_t find(uint32_t atom) const
+        {
+            if (slots.empty())
+                return -1;
+            for (auto i = hash(atom);; i = (i + 1) & mask()) {
+                if (slots[i].atom == atom)
+                    return slots[i].index;
+                if (slots[i].atom == SymbolTable::none)
+                    return -1;
+            }
+        }
+
+        /** Maps atom to index, replacing an earlier symbol with the same name. */
+        void insert(uint32_t atom, int32_t index)
+        {
+            if (2 * (used + 1) > slots.size())
+                grow();
+            auto i = hash(atom);
+            while (slots[i].atom != SymbolTable::none && slots[i].atom != atom)
+                i = (i + 1) & mask();
+            used += slots[i].atom == SymbolTable::none;
+            slots[i] = {atom, index};
+        }
+
+        void clear()
+        {
+            slots.clear();
+            used = 0;
+        }
+
+        /** Returns the bytes of the slots. */
+        size_t bufferBytes() const { return slots.capacity() * sizeof(slot_t); }
+
+    private:
+        struct slot_t
+        {
+            uint32_t atom{SymbolTable::none};
+            int32_t index{-1};
+        };
+        vector<slot_t> slots;  // the size is a power of two
+        size_t used{0};
+
+        size_t mask() const { return slots.size() - 1; }
+        size_t hash(uint32_t atom) const { return (atom * 2654435769u) & mask(); }
+
+        void grow()
+        {
+            auto old = std::move(slots);
+            slots.assign(old.empty() ? 8 : 2 * old.size(), slot_t{});
+            used = 0;
+            for (const auto& slot : old)
+                if (slot.atom != SymbolTable::none)
+                    insert(slot.atom, slot.index);
+        }
+    };
+}  // namespace
+
+struct frame_t::frame_data
+{
+    // bool hasParent;                // True if there is a parent
+    frame_data* parent;                  // The parent frame data
+    vector<symbol_t> symbols;            // The symbols in the frame
+    SymbolIndex mapping;                 // Mapping from names to indices
+    std::shared_ptr<SymbolTable> table;  // Shared with the parent, the root and the roots created from these
+    frame_data(frame_data* p, std::shared_ptr<SymbolTable> table): parent{p}, table{std::move(table)} {}
+    bool hasParent() const { return parent != nullptr; }
+};
+
+struct symbol_t::symbol_data
 {
     frame_t::frame_data* frame = nullptr;  // Uncounted pointer to containing frame // TODO: consider removing
     type_t type;                           // The type of the symbol
     void* user = nullptr;                  // User data
-    string name;                           // The name of the symbol
+    std::shared_ptr<SymbolTable> table;    // The table of the frame the symbol was created in
+    const SymbolTable::name_t* name;       // The interned name of the symbol
     position_t position;                   // the position of the symbol definition in the original document
-    symbol_data(frame_t::frame_data* frame, type_t type, void* user, string name, position_t position):
-        frame{frame}, type{std::move(type)}, user{user}, name{std::move(name)}, position{position}
+    uint32_t id;                           // dense identifier, see symbol_t::getId()
+    symbol_data(frame_t::frame_data* frame, type_t type, void* user, std::shared_ptr<SymbolTable> table,
+                std::string_view name, position_t position):
+        frame{frame}, type{std::move(type)}, user{user}, table{std::move(table)}, name{&this->table->intern(name)},
+        position{position}, id{this->table->nextId()}
     {}
 };
 
 symbol_t::symbol_t(frame_t* frame, type_t type, string name, position_t position, void* user)
 {
-    data = std::make_shared<symbol_data>(frame->data.get(), std::move(type), user, std::move(name), position);
+    data = make_node<symbol_data>(frame->data.get(), std::move(type), user, frame->data->table, name, position);
+    Statistics::created(Statistics::SYMBOLS);
 }
 
 /* Destructor */
@@ -75,7 +273,11 @@ frame_t symbol_t::getFrame() { return frame_t(data->frame); }
 /* Returns the type of this symbol. */
 type_t symbol_t::getType() const { return data->type; }
 
-void symbol_t::setType(type_t type) { data->type = type; }
+void symbol_t::setType(type_t type)
+{
+    data->type = type;
+    SymbolTable::touch(*data->name);
+}
 
 position_t symbol_t::getPosition() const { return data->position; }
 
@@ -85,26 +287,130 @@ void* symbol_t::getData() { return data->user; }
 /* Returns the user data of this symbol */
 const void* symbol_t::getData() const { return data->user; }
 
+void symbol_t::setData(void* user) { data->user = user; }
+
+bool symbol_t::isDeclaredIn(const frame_t& frame) const { return data->frame == frame.data.get(); }
+
 /* Returns the name (identifier) of this symbol */
-const string& symbol_t::getName() const { return data->name; }
+const string& symbol_t::getName() const { return data->name->text; }
+
+void symbol_t::setName(const string& name)
+{
+    SymbolTable::touch(*data->name);
+    data->name = &data->table->intern(name);
+    SymbolTable::touch(*data->name);
+}
 
-void symbol_t::setName(const string& name) { data->name = name; }
+uint32_t symbol_t::getId() const { return data ? data->id : 0; }
+
+void symbol_t::measure(MemoryReport& report) const
+{
+    if (!data || !report.enter(data.get()))
+        return;
+    report.add(MemoryReport::SYMBOLS, MemoryReport::nodeBytes(sizeof(symbol_data)));
+    data->type.measure(report);
+}
 
 std::ostream& operator<<(std::ostream& o, const UTAP::symbol_t& t) { return o << t.getType() << " " << t.getName(); }
 
 //////////////////////////////////////////////////////////////////////////
 
-struct frame_t::frame_data : public std::enable_shared_from_this<frame_t::frame_data>
+symbol_set_t::symbol_set_t(const std::set<symbol_t>& symbols) { insert(symbols); }
+
+bool symbol_set_t::insert(const symbol_t& symbol)
 {
-    // bool hasParent;                // True if there is a parent
-    frame_data* parent;            // The parent frame data
-    vector<symbol_t> symbols;      // The symbols in the frame
-    map<string, int32_t> mapping;  // Mapping from names to indices
-    explicit frame_data(frame_data* p): parent{p} {}
-    bool hasParent() const { return parent != nullptr; }
-};
+    const auto id = symbol.getId();
+    if (id / 64 >= words.size())
+        words.resize(id / 64 + 1, 0);
+    auto& word = words[id / 64];
+    const auto bit = uint64_t{1} << id % 64;
+    const auto added = (word & bit) == 0;
+    word |= bit;
+    return added;
+}
+
+void symbol_set_t::insert(const std::set<symbol_t>& symbols)
+{
+    for (const auto& symbol : symbols)
+        insert(symbol);
+}
 
-frame_t::frame_t(frame_data* frame) { data = frame->shared_from_this(); }
+bool symbol_set_t::erase(const symbol_t& symbol)
+{
+    if (!contains(symbol))
+        return false;
+    const auto id = symbol.getId();
+    words[id / 64] &= ~(uint64_t{1} << id % 64);
+    return true;
+}
+
+bool symbol_set_t::empty() const
+{
+    return std::all_of(words.begin(), words.end(), [](uint64_t word) { return word == 0; });
+}
+
+size_t symbol_set_t::size() const
+{
+    size_t res = 0;
+    for (auto word : words)
+        res += __builtin_popcountll(word);
+    return res;
+}
+
+bool symbol_set_t::intersects(const symbol_set_t& other) const
+{
+    const auto n = std::min(words.size(), other.words.size());
+    for (size_t i = 0; i < n; ++i)
+        if ((words[i] & other.words[i]) != 0)
+            return true;
+    return false;
+}
+
+bool symbol_set_t::isSubsetOf(const symbol_set_t& other) const
+{
+    for (size_t i = 0; i < words.size(); ++i)
+        if ((words[i] & ~(i < other.words.size() ? other.words[i] : 0)) != 0)
+            return false;
+    return true;
+}
+
+symbol_set_t& symbol_set_t::operator|=(const symbol_set_t& other)
+{
+    if (words.size() < other.words.size())
+        words.resize(other.words.size(), 0);
+    for (size_t i = 0; i < other.words.size(); ++i)
+        words[i] |= other.words[i];
+    return *this;
+}
+
+symbol_set_t& symbol_set_t::operator&=(const symbol_set_t& other)
+{
+    if (words.size() > other.words.size())
+        words.resize(other.words.size());
+    for (size_t i = 0; i < words.size(); ++i)
+        words[i] &= other.words[i];
+    return *this;
+}
+
+symbol_set_t& symbol_set_t::operator-=(const symbol_set_t& other)
+{
+    const auto n = std::min(words.size(), other.words.size());
+    for (size_t i = 0; i < n; ++i)
+        words[i] &= ~other.words[i];
+    return *this;
+}
+
+bool symbol_set_t::operator==(const symbol_set_t& other) const
+{
+    const auto& shorter = words.size() < other.words.size() ? words : other.words;
+    const auto& longer = words.size() < other.words.size() ? other.words : words;
+    return std::equal(shorter.begin(), shorter.end(), longer.begin()) &&
+           std::all_of(longer.begin() + shorter.size(), longer.end(), [](uint64_t word) { return word == 0; });
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+frame_t::frame_t(frame_data* frame): data{frame} {}
 
 /* Destructor */
 frame_t::~frame_t() noexcept = default;
@@ -139,7 +445,8 @@ symbol_t frame_t::addSymbol(const string& name, type_t type, position_t position
     auto symbol = symbol_t{this, type, name, position, user};
     data->symbols.push_back(symbol);
     if (!name.empty()) {
-        data->mapping[symbol.getName()] = data->symbols.size() - 1;
+        data->mapping.insert(symbol.data->name->atom, data->symbols.size() - 1);
+        SymbolTable::touch(*symbol.data->name);
     }
     return symbol;
 }
@@ -152,7 +459,9 @@ void frame_t::add(symbol_t symbol)
 {
     data->symbols.push_back(symbol);
     if (!symbol.getName().empty()) {
-        data->mapping[symbol.getName()] = data->symbols.size() - 1;
+        const auto& name = nameIn(*data->table, *symbol.data->table, *symbol.data->name);
+        data->mapping.insert(name.atom, data->symbols.size() - 1);
+        SymbolTable::touch(name);
     }
 }
 
@@ -184,6 +493,7 @@ void frame_t::moveTo(frame_t frame)
 /** removes the given symbol*/
 void frame_t::remove(symbol_t s)
 {
+    SymbolTable::touch(nameIn(*data->table, *s.data->table, *s.data->name));
     vector<symbol_t> symbols = data->symbols;
     data->symbols.clear();
     data->mapping.clear();
@@ -198,8 +508,8 @@ void frame_t::remove(symbol_t s)
 
 int32_t frame_t::getIndexOf(const string& name) const
 {
-    map<string, int32_t>::const_iterator i = data->mapping.find(name);
-    return (i == data->mapping.end() ? -1 : i->second);
+    const auto* interned = data->table->find(name);
+    return interned == nullptr ? -1 : data->mapping.find(interned->atom);
 }
 
 int32_t frame_t::getIndexOf(const symbol_t& symbol) const
@@ -219,14 +529,35 @@ int32_t frame_t::getIndexOf(const symbol_t& symbol) const
 */
 bool frame_t::resolve(const string& name, symbol_t& symbol) const
 {
-    int32_t idx = getIndexOf(name);
-    if (idx == -1) {
-        return (data->hasParent() ? getParent().resolve(name, symbol) : false);
+    const auto* interned = data->table->find(name);
+    return interned != nullptr && resolve(version_t{interned->atom, 0}, symbol);
+}
+
+bool frame_t::resolve(const version_t& name, symbol_t& symbol) const
+{
+    for (const frame_data* frame = data.get(); frame != nullptr; frame = frame->parent) {
+        if (int32_t idx = frame->mapping.find(name.atom); idx != -1) {
+            symbol = frame->symbols[idx];
+            return true;
+        }
     }
-    symbol = data->symbols[idx];
-    return true;
+    return false;
+}
+
+void frame_t::measure(MemoryReport& report) const
+{
+    if (!data || !report.enter(data.get()))
+        return;
+    report.add(MemoryReport::FRAMES, MemoryReport::nodeBytes(sizeof(frame_data)) +
+                                         data->symbols.capacity() * sizeof(symbol_t) + data->mapping.bufferBytes());
+    if (report.enter(data->table.get()))
+        report.add(MemoryReport::FRAMES, sizeof(SymbolTable) + data->table->bufferBytes(), 0);
+    for (const auto& symbol : data->symbols)
+        symbol.measure(report);
 }
 
+frame_t::version_t frame_t::getVersion(std::string_view name) const { return data->table->version(name); }
+
 /* Returns the parent frame */
 frame_t frame_t::getParent() const
 {
@@ -243,7 +574,8 @@ bool frame_t::hasParent() const { return data->hasParent(); }
 frame_t frame_t::createFrame()
 {
     frame_t f;
-    f.data = std::make_shared<frame_data>(nullptr);
+    f.data = make_node<frame_data>(nullptr, std::make_shared<SymbolTable>());
+    Statistics::created(Statistics::FRAMES);
     return f;
 }
 
@@ -251,7 +583,18 @@ frame_t frame_t::createFrame()
 frame_t frame_t::createFrame(const frame_t& parent)
 {
     frame_t f;
-    f.data = std::make_shared<frame_data>(parent.data.get());
+    f.data = make_node<frame_data>(parent.data.get(), parent.data->table);
+    Statistics::created(Statistics::FRAMES);
+    return f;
+}
+
+frame_t frame_t::createRoot(const frame_t& sibling)
+{
+    if (!sibling.data)
+        return createFrame();
+    frame_t f;
+    f.data = make_node<frame_data>(nullptr, sibling.data->table);
+    Statistics::created(Statistics::FRAMES);
     return f;
 }
 
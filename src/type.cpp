@@ -22,7 +22,13 @@
 #include "utap/type.h"
 
 #include "utap/expression.h"
+#include "utap/memoryreport.h"
+#include "utap/node.h"
+#include "utap/statistics.h"
 
+#include <algorithm>
+#include <functional>
+#include <utility>
 #include <cassert>
 
 using std::string;
@@ -43,13 +49,28 @@ struct type_t::type_data
     position_t position;  // Position in the input file
     expression_t expr;    //
     std::vector<child_t> children;
+    const TypeTable* table{nullptr};  // The table this type is interned in
     type_data(kind_t kind, position_t position): kind{kind}, position{position} {}
 };
 
 type_t::type_t(kind_t kind, const position_t& pos, size_t size)
 {
-    data = std::make_shared<type_data>(kind, pos);
+    data = make_node<type_data>(kind, pos);
     data->children.resize(size);
+    Statistics::created(Statistics::TYPES);
+}
+
+void type_t::measure(MemoryReport& report) const
+{
+    if (!data || !report.enter(data.get()))
+        return;
+    auto bytes = MemoryReport::nodeBytes(sizeof(type_data)) + data->children.capacity() * sizeof(child_t);
+    for (const auto& child : data->children)
+        bytes += MemoryReport::bufferBytes(child.label);
+    report.add(MemoryReport::TYPES, bytes);
+    data->expr.measure(report);
+    for (const auto& child : data->children)
+        child.child.measure(report);
 }
 
 bool type_t::operator==(const type_t& type) const { return data == type.data; }
@@ -260,7 +281,7 @@ type_t type_t::rename(std::string from, std::string to) const
     if (getKind() == LABEL && getLabel(0) == from) {
         type.data->children[0].label = to;
     }
-    return type;
+    return intern(type);
 }
 
 type_t type_t::subst(symbol_t symbol, expression_t expr) const
@@ -273,7 +294,7 @@ type_t type_t::subst(symbol_t symbol, expression_t expr) const
     if (!data->expr.empty()) {
         type.data->expr = data->expr.subst(symbol, expr);
     }
-    return type;
+    return intern(type);
 }
 
 position_t type_t::getPosition() const { return data->position; }
@@ -341,7 +362,7 @@ type_t type_t::createRange(type_t type, expression_t lower, expression_t upper,
     t.data->children[2].child = type_t(UNKNOWN, pos, 0);
     t[1].data->expr = lower;
     t[2].data->expr = upper;
-    return t;
+    return intern(t);
 }
 
 type_t type_t::createRecord(const vector<type_t>& types, const vector<string>& labels, position_t pos)
@@ -352,7 +373,7 @@ type_t type_t::createRecord(const vector<type_t>& types, const vector<string>& l
         type.data->children[i].child = types[i];
         type.data->children[i].label = labels[i];
     }
-    return type;
+    return intern(type);
 }
 
 type_t type_t::createFunction(type_t ret, const std::vector<type_t>& parameters, const std::vector<std::string>& labels,
@@ -365,7 +386,7 @@ type_t type_t::createFunction(type_t ret, const std::vector<type_t>& parameters,
         type.data->children[i + 1].child = parameters[i];
         type.data->children[i + 1].label = labels[i];
     }
-    return type;
+    return intern(type);
 }
 
 type_t type_t::createExternalFunction(type_t ret, const std::vector<type_t>& parameters,
@@ -378,7 +399,7 @@ type_t type_t::createExternalFunction(type_t ret, const std::vector<type_t>& par
         type.data->children[i + 1].child = parameters[i];
         type.data->children[i + 1].label = labels[i];
     }
-    return type;
+    return intern(type);
 }
 
 type_t type_t::createArray(type_t sub, type_t size, position_t pos)
@@ -386,7 +407,7 @@ type_t type_t::createArray(type_t sub, type_t size, position_t pos)
     type_t type(ARRAY, pos, 2);
     type.data->children[0].child = sub;
     type.data->children[1].child = size;
-    return type;
+    return intern(type);
 }
 
 type_t type_t::createTypeDef(std::string label, type_t type, position_t pos)
@@ -394,7 +415,7 @@ type_t type_t::createTypeDef(std::string label, type_t type, position_t pos)
     type_t t(TYPEDEF, pos, 1);
     t.data->children[0].label = label;
     t.data->children[0].child = type;
-    return t;
+    return intern(t);
 }
 
 type_t type_t::createInstance(frame_t parameters, position_t pos)
@@ -404,7 +425,7 @@ type_t type_t::createInstance(frame_t parameters, position_t pos)
         type.data->children[i].child = parameters[i].getType();
         type.data->children[i].label = parameters[i].getName();
     }
-    return type;
+    return intern(type);
 }
 
 type_t type_t::createLscInstance(frame_t parameters, position_t pos)
@@ -414,7 +435,7 @@ type_t type_t::createLscInstance(frame_t parameters, position_t pos)
         type.data->children[i].child = parameters[i].getType();
         type.data->children[i].label = parameters[i].getName();
     }
-    return type;
+    return intern(type);
 }
 
 type_t type_t::createProcess(frame_t frame, position_t pos)
@@ -424,7 +445,7 @@ type_t type_t::createProcess(frame_t frame, position_t pos)
         type.data->children[i].child = frame[i].getType();
         type.data->children[i].label = frame[i].getName();
     }
-    return type;
+    return intern(type);
 }
 
 type_t type_t::createProcessSet(type_t instance, position_t pos)
@@ -434,16 +455,29 @@ type_t type_t::createProcessSet(type_t instance, position_t pos)
         type.data->children[i].child = instance[i];
         type.data->children[i].label = instance.getLabel(i);
     }
-    return type;
+    return intern(type);
 }
 
-type_t type_t::createPrimitive(kind_t kind, position_t pos) { return type_t(kind, pos, 0); }
+type_t type_t::createPrimitive(kind_t kind, position_t pos) { return intern(type_t(kind, pos, 0)); }
+
+type_t type_t::createNode(kind_t kind, position_t pos, expression_t expr, const vector<type_t>& children,
+                          const vector<string>& labels)
+{
+    assert(children.size() == labels.size());
+    type_t type(kind, pos, children.size());
+    type.data->expr = std::move(expr);
+    for (size_t i = 0; i < children.size(); ++i) {
+        type.data->children[i].child = children[i];
+        type.data->children[i].label = labels[i];
+    }
+    return type;
+}
 
 type_t type_t::createPrefix(kind_t kind, position_t pos) const
 {
     type_t type(kind, pos, 1);
     type.data->children[0].child = *this;
-    return type;
+    return intern(type);
 }
 
 type_t type_t::createLabel(string label, position_t pos) const
@@ -451,7 +485,7 @@ type_t type_t::createLabel(string label, position_t pos) const
     type_t type(LABEL, pos, 1);
     type.data->children[0].child = *this;
     type.data->children[0].label = label;
-    return type;
+    return intern(type);
 }
 
 string type_t::toString() const
@@ -651,11 +685,15 @@ string type_t::toDeclarationString() const
 
     if (range) {
         str += get(0).toDeclarationString();
-        if (getRange().first.getValue() != -32768 || getRange().second.getValue() != 32767) {
+        const auto [lower, upper] = getRange();
+        const auto isConstant = [](const expression_t& e, int32_t value) {
+            return e.getKind() == CONSTANT && e.getValue() == value;
+        };
+        if (!isConstant(lower, -32768) || !isConstant(upper, 32767)) {  // bounds may be names, e.g. INT8_MIN
             str += "[";
-            str += getRange().first.toString();
+            lower.toString(str);
             str += ",";
-            str += getRange().second.toString();
+            upper.toString(str);
             str += "]";
             str += get(1).toDeclarationString();
         }
@@ -687,3 +725,87 @@ string type_t::toDeclarationString() const
 }
 
 std::ostream& operator<<(std::ostream& o, const type_t& t) { return o << t.toString(); }
+
+type_t type_t::intern(type_t type)
+{
+    auto* table = TypeTable::current();
+    return table != nullptr ? table->intern(std::move(type)) : type;
+}
+
+static TypeTable*& activeTable()
+{
+    static thread_local TypeTable* table = nullptr;
+    return table;
+}
+
+TypeTable::Scope::Scope(TypeTable& table): previous{std::exchange(activeTable(), &table)} {}
+
+TypeTable::Scope::~Scope() noexcept { activeTable() = previous; }
+
+TypeTable* TypeTable::current() { return activeTable(); }
+
+/** Integer constants are the only expressions that are compared by value when interning types. */
+static bool isIntegerConstant(const expression_t& expr)
+{
+    return expr.getKind() == CONSTANT && expr.getSize() == 0 && expr.getType().isInteger();
+}
+
+type_t TypeTable::intern(type_t type)
+{
+    if (type.data == nullptr || type.data->table == this) {
+        return type;
+    }
+    const auto& expr = type.data->expr;
+    if (!expr.empty() && !isIntegerConstant(expr)) {
+        return type;
+    }
+
+    // Children are interned first so that types can be compared by the identity of their children.
+    auto children = std::vector<type_t>{};
+    children.reserve(type.size());
+    for (const auto& c : type.data->children) {
+        auto child = intern(c.child);
+        if (child.data != nullptr && child.data->table != this) {
+            return type;
+        }
+        children.push_back(std::move(child));
+    }
+    if (!std::equal(children.begin(), children.end(), type.data->children.begin(),
+                    [](const type_t& t, const type_t::child_t& c) { return t == c.child; })) {
+        auto copy = type_t{type.data->kind, type.data->position, children.size()};
+        copy.data->expr = expr;
+        for (size_t i = 0; i < children.size(); ++i) {
+            copy.data->children[i].label = type.data->children[i].label;
+            copy.data->children[i].child = std::move(children[i]);
+        }
+        type = std::move(copy);
+    }
+
+    const auto& data = *type.data;
+    auto hash = std::hash<int>{}(data.kind);
+    auto combine = [&hash](size_t h) { hash ^= h + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+    combine(std::hash<uint32_t>{}(data.position.start));
+    combine(std::hash<uint32_t>{}(data.position.end));
+    combine(data.expr.empty() ? 0 : std::hash<int32_t>{}(data.expr.getValue()));
+    for (const auto& c : data.children) {
+        combine(std::hash<std::string>{}(c.label));
+        combine(std::hash<type_t>{}(c.child));
+    }
+
+    auto [first, last] = types.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        const auto& other = *it->second.data;
+        if (other.kind == data.kind && other.position.start == data.position.start &&
+            other.position.end == data.position.end && other.expr.empty() == data.expr.empty() &&
+            (data.expr.empty() || other.expr.getValue() == data.expr.getValue()) &&
+            std::equal(other.children.begin(), other.children.end(), data.children.begin(), data.children.end(),
+                       [](const type_t::child_t& a, const type_t::child_t& b) {
+                           return a.child == b.child && a.label == b.label;
+                       })) {
+            return it->second;
+        }
+    }
+    type.data->table = this;
+    types.emplace(hash, type);
+    return type;
+}
@@ -21,11 +21,16 @@
 */
 #include "utap/typechecker.h"
 
+#include "ElementBuilder.hpp"
 #include "utap/DocumentBuilder.hpp"
+#include "utap/cancellation.h"
 #include "utap/featurechecker.h"
+#include "utap/statistics.h"
 #include "utap/utap.h"
 
 #include <cassert>
+#include <future>
+#include <utility>
 
 using namespace UTAP;
 using namespace Constants;
@@ -201,10 +206,7 @@ void CompileTimeComputableValues::visitInstance(instance_t& temp)
     }
 }
 
-bool CompileTimeComputableValues::contains(symbol_t symbol) const
-{
-    return (variables.find(symbol) != variables.end());
-}
+bool CompileTimeComputableValues::contains(symbol_t symbol) const { return variables.contains(symbol); }
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -286,16 +288,62 @@ TypeChecker::TypeChecker(Document& doc, bool refinement): doc{doc}, syncUsed(0)
     temp = nullptr;
 }
 
+TypeChecker::TypeChecker(Document& doc, CompileTimeComputableValues values):
+    doc{doc}, compileTimeComputableValues{std::move(values)}, function{nullptr}, refinementWarnings{false},
+    syncUsed{0}, temp{nullptr}
+{}
+
 template <class T>
 void TypeChecker::handleWarning(T expr, const std::string& msg)
 {
-    doc.addWarning(expr.getPosition(), msg, "(typechecking)");
+    if (diagnostics != nullptr) {
+        const auto pos = expr.getPosition();
+        const auto& positions = diagnostics->positions != nullptr ? *diagnostics->positions : doc.getPositions();
+        diagnostics->warnings.emplace_back(positions.find(pos.start), positions.find(pos.end), pos, msg,
+                                           "(typechecking)");
+    } else {
+        doc.addWarning(expr.getPosition(), msg, "(typechecking)");
+    }
 }
 
 template <class T>
 void TypeChecker::handleError(T expr, const std::string& msg)
 {
-    doc.addError(expr.getPosition(), msg, "(typechecking)");
+    if (diagnostics != nullptr) {
+        const auto pos = expr.getPosition();
+        const auto& positions = diagnostics->positions != nullptr ? *diagnostics->positions : doc.getPositions();
+        diagnostics->errors.emplace_back(positions.find(pos.start), positions.find(pos.end), pos, msg,
+                                         "(typechecking)");
+    } else {
+        doc.addError(expr.getPosition(), msg, "(typechecking)");
+    }
+}
+
+void TypeChecker::record(void (Document::*feature)())
+{
+    if (diagnostics != nullptr)
+        diagnostics->features.push_back(feature);
+    else
+        (doc.*feature)();
+}
+
+void TypeChecker::report(const range_check_t& check)
+{
+    if (reads != nullptr)
+        reads->insert(check.reads.begin(), check.reads.end());
+    const auto& found = check.diagnostics;
+    if (diagnostics != nullptr) {
+        diagnostics->errors.insert(diagnostics->errors.end(), found.errors.begin(), found.errors.end());
+        diagnostics->warnings.insert(diagnostics->warnings.end(), found.warnings.begin(), found.warnings.end());
+        diagnostics->features.insert(diagnostics->features.end(), found.features.begin(), found.features.end());
+    } else {
+        for (const auto& error : found.errors)
+            doc.addError(error.position, error.msg, error.context);
+        for (const auto& warning : found.warnings)
+            doc.addWarning(warning.position, warning.msg, warning.context);
+        for (auto feature : found.features)
+            (doc.*feature)();
+    }
 }
 
 /**
@@ -366,7 +414,6 @@ bool TypeChecker::isCompileTimeComputable(expression_t expr) const
  */
 void TypeChecker::checkType(type_t type, bool initialisable, bool inStruct)
 {
-    expression_t l, u;
     type_t size;
     frame_t frame;
 
@@ -427,23 +474,7 @@ void TypeChecker::checkType(type_t type, bool initialisable, bool inStruct)
         if (!type.isInteger() && !type.isScalar()) {
             handleError(type, "$Range_over_this_type_not_allowed");
         }
-        std::tie(l, u) = type.getRange();
-        if (checkExpression(l)) {
-            if (!isInteger(l)) {
-                handleError(l, "$Integer_expected");
-            }
-            if (!isCompileTimeComputable(l)) {
-                handleError(l, "$Must_be_computable_at_compile_time");
-            }
-        }
-        if (checkExpression(u)) {
-            if (!isInteger(u)) {
-                handleError(u, "$Integer_expected");
-            }
-            if (!isCompileTimeComputable(u)) {
-                handleError(u, "$Must_be_computable_at_compile_time");
-            }
-        }
+        checkRange(type);
         break;
 
     case ARRAY:
@@ -477,6 +508,50 @@ void TypeChecker::checkType(type_t type, bool initialisable, bool inStruct)
     }
 }
 
+/** Checks the bounds of a range type, or reports them as recorded in sharedRanges. */
+void TypeChecker::checkRange(type_t type)
+{
+    if (sharedRanges != nullptr) {
+        auto it = sharedRanges->find(type);
+        if (it == sharedRanges->end() && recordRanges) {
+            auto check = range_check_t{};
+            auto* const outerReads = std::exchange(reads, &check.reads);
+            auto* const outerDiagnostics = std::exchange(diagnostics, &check.diagnostics);
+            checkBounds(type);
+            reads = outerReads;
+            diagnostics = outerDiagnostics;
+            it = sharedRanges->emplace(type, std::move(check)).first;
+        }
+        if (it != sharedRanges->end()) {
+            report(it->second);
+            return;
+        }
+    }
+    checkBounds(type);
+}
+
+/** Checks that the bounds of a range type are integers computable at compile time. */
+void TypeChecker::checkBounds(type_t type)
+{
+    auto [l, u] = type.getRange();
+    if (checkExpression(l)) {
+        if (!isInteger(l)) {
+            handleError(l, "$Integer_expected");
+        }
+        if (!isCompileTimeComputable(l)) {
+            handleError(l, "$Must_be_computable_at_compile_time");
+        }
+    }
+    if (checkExpression(u)) {
+        if (!isInteger(u)) {
+            handleError(u, "$Integer_expected");
+        }
+        if (!isCompileTimeComputable(u)) {
+            handleError(u, "$Must_be_computable_at_compile_time");
+        }
+    }
+}
+
 void TypeChecker::visitSystemAfter(Document* doc)
 {
     for (const chan_priority_t& i : doc->getChanPriorities()) {
@@ -642,6 +717,8 @@ bool isDefaultInt(type_t type)
 
 void TypeChecker::visitProcess(instance_t& process)
 {
+    if (reads != nullptr && process.templ != nullptr)
+        reads->insert(process.templ->uid);
     for (size_t i = 0; i < process.unbound; i++) {
         /* Unbound parameters of processes must be either scalars or
          * bounded integers.
@@ -656,7 +733,7 @@ void TypeChecker::visitProcess(instance_t& process)
          * indirectly in any array size declarations. I.e. they must
          * not be restricted.
          */
-        if (process.restricted.find(parameter) != process.restricted.end()) {
+        if (process.restrictedSet.contains(parameter)) {
             handleError(type, "$Free_process_parameters_must_not_be_used_directly_or_indirectly_in_"
                               "an_array_declaration_or_select_expression");
         }
@@ -698,15 +775,16 @@ void TypeChecker::visitState(state_t& state)
                 RateDecomposer decomposer;
                 decomposer.decompose(state.invariant);
                 state.invariant = decomposer.invariant;
-                state.costRate = decomposer.costRate;
+                if (decomposer.countCostRates > 0)  // a re-check sees the invariant without the cost rate
+                    state.costRate = decomposer.costRate;
                 if (decomposer.countCostRates > 1) {
                     handleError(state.invariant, "$Only_one_cost_rate_is_allowed");
                 }
                 if (decomposer.hasClockRates) {
-                    doc.recordStopWatch();
+                    record(&Document::recordStopWatch);
                 }
                 if (decomposer.hasStrictInvariant) {
-                    doc.recordStrictInvariant();
+                    record(&Document::recordStrictInvariant);
                     handleWarning(state.invariant, "$Strict_invariant");
                 }
             }
@@ -750,7 +828,7 @@ void TypeChecker::visitEdge(edge_t& edge)
             }
             if (hasStrictLowerBound(edge.guard)) {
                 if (edge.control) {
-                    doc.recordStrictLowerBoundOnControllableEdges();
+                    record(&Document::recordStrictLowerBoundOnControllableEdges);
                 }
                 strictBound = true;
             }
@@ -774,10 +852,10 @@ void TypeChecker::visitEdge(edge_t& edge)
                 bool receivesBroadcast = channel.is(BROADCAST) && edge.sync.getSync() == SYNC_QUE;
 
                 if (isUrgent && hasClockGuard) {
-                    doc.setUrgentTransition();
+                    record(&Document::setUrgentTransition);
                     handleWarning(edge.sync, "$Clock_guards_are_not_allowed_on_urgent_edges");
                 } else if (receivesBroadcast && hasClockGuard) {
-                    doc.clockGuardRecvBroadcast();
+                    record(&Document::clockGuardRecvBroadcast);
                     /*
                       This is now allowed, though it is expensive.
 
@@ -965,6 +1043,9 @@ void TypeChecker::visitInstance(instance_t& instance)
 {
     SystemVisitor::visitInstance(instance);
 
+    if (reads != nullptr && instance.templ != nullptr)
+        reads->insert(instance.templ->uid);  // the parameters are declared by the template
+
     /* Check the parameters of the instance.
      */
     type_t type = instance.uid.getType();
@@ -976,7 +1057,7 @@ void TypeChecker::visitInstance(instance_t& instance)
      */
     for (size_t i = type.size(); i < type.size() + instance.arguments; i++) {
         symbol_t parameter = instance.parameters[i];
-        expression_t argument = instance.mapping[parameter];
+        expression_t argument = instance.getArgument(parameter);
 
         if (!checkExpression(argument)) {
             continue;
@@ -1220,6 +1301,7 @@ static bool validReturnType(type_t type)
 
 void TypeChecker::visitFunction(function_t& fun)
 {
+    ParseMonitor::checkpoint();
     SystemVisitor::visitFunction(fun);
     /* Check that the return type is consistent and is a valid return
      * type.
@@ -1247,6 +1329,8 @@ void TypeChecker::visitFunction(function_t& fun)
      * nor parameters are considered to be changed or accessed by a
      * function.
      */
+    fun.changes.clear();  // re-checks must not keep what an earlier body changed
+    fun.depends.clear();
     CollectChangesVisitor visitor(fun.changes);
     fun.body->accept(&visitor);
 
@@ -1262,6 +1346,8 @@ void TypeChecker::visitFunction(function_t& fun)
         fun.changes.erase(fun.body->getFrame()[i]);
         fun.depends.erase(fun.body->getFrame()[i]);
     }
+    fun.changeSet = symbol_set_t{fun.changes};
+    fun.dependSet = symbol_set_t{fun.depends};
 }
 
 int32_t TypeChecker::visitEmptyStatement(EmptyStatement* stat) { return 0; }
@@ -1557,6 +1643,9 @@ bool TypeChecker::areEquivalent(type_t a, type_t b) const
     } else if (a.isChannel() && b.isChannel()) {
         return channelCapability(a) == channelCapability(b);
     } else if (a.isRecord() && b.isRecord()) {
+        if (a == b) {
+            return true;  // interned types are shared
+        }
         size_t aSize = a.getRecordSize();
         size_t bSize = b.getRecordSize();
         if (aSize == bSize) {
@@ -1568,6 +1657,9 @@ bool TypeChecker::areEquivalent(type_t a, type_t b) const
             return true;
         }
     } else if (a.isArray() && b.isArray()) {
+        if (a == b) {
+            return true;
+        }
         type_t asize = a.getArraySize();
         type_t bsize = b.getArraySize();
 
@@ -1651,6 +1743,9 @@ bool TypeChecker::checkExpression(expression_t expr)
     if (expr.empty())
         return true;
 
+    if (reads != nullptr && expr.getKind() == IDENTIFIER)
+        reads->insert(expr.getSymbol());
+
     /* CheckExpression sub-expressions.
      */
     bool ok = true;
@@ -2587,11 +2682,43 @@ bool TypeChecker::isUniqueReference(expression_t expr) const
     }
 }
 
+/** Type checks the parsed document, the templates concurrently if given worker threads. */
+static void check(Document& doc, uint32_t threads)
+{
+    auto phase = Statistics::Phase{Statistics::TYPECHECKER};
+    if (threads > 0) {
+        IncrementalTypeChecker{doc}.check(threads);
+    } else {
+        TypeChecker checker(doc);
+        doc.accept(checker);
+    }
+}
+
 bool parseXTA(FILE* file, Document* doc, bool newxta)
 {
+    auto scope = doc->createNodes();
+    auto types = TypeTable::Scope{doc->getTypeTable()};
+    auto stats = Statistics::Scope{*doc};
     DocumentBuilder builder(*doc);
     parseXTA(file, &builder, newxta);
     if (!doc->hasErrors()) {
+        auto phase = Statistics::Phase{Statistics::TYPECHECKER};
+        TypeChecker checker(*doc);
+        doc->accept(checker);
+    }
+    return !doc->hasErrors();
+}
+
+bool parseXTAFile(const char* filename, Document* doc, bool newxta)
+{
+    auto scope = doc->createNodes();
+    auto types = TypeTable::Scope{doc->getTypeTable()};
+    auto stats = Statistics::Scope{*doc};
+    DocumentBuilder builder(*doc);
+    if (parseXTAFile(filename, &builder, newxta) != 0 && !doc->hasErrors())
+        return false;  // the file could not be opened
+    if (!doc->hasErrors()) {
+        auto phase = Statistics::Phase{Statistics::TYPECHECKER};
         TypeChecker checker(*doc);
         doc->accept(checker);
     }
@@ -2600,27 +2727,35 @@ bool parseXTA(FILE* file, Document* doc, bool newxta)
 
 bool parseXTA(const char* buffer, Document* doc, bool newxta)
 {
+    auto scope = doc->createNodes();
+    auto types = TypeTable::Scope{doc->getTypeTable()};
+    auto stats = Statistics::Scope{*doc};
     DocumentBuilder builder(*doc);
     parseXTA(buffer, &builder, newxta);
     if (!doc->hasErrors()) {
+        auto phase = Statistics::Phase{Statistics::TYPECHECKER};
         TypeChecker checker(*doc);
         doc->accept(checker);
     }
     return !doc->hasErrors();
 }
 
-int32_t parseXMLBuffer(const char* buffer, Document* doc, bool newxta, const std::vector<std::filesystem::path>& paths)
+int32_t parseXMLBuffer(std::string_view buffer, Document* doc, bool newxta,
+                       const std::vector<std::filesystem::path>& paths, uint32_t threads)
 {
+    auto scope = doc->createNodes();
+    auto types = TypeTable::Scope{doc->getTypeTable()};
+    auto stats = Statistics::Scope{*doc};
     auto builder = DocumentBuilder{*doc, paths};
-    int err = parseXMLBuffer(buffer, &builder, newxta);
+    int err = parseXMLBuffer(buffer, &builder, newxta, threads, doc->hasLazyTemplates());
 
     if (err) {
         return err;
     }
 
     if (!doc->hasErrors()) {
-        TypeChecker checker(*doc);
-        doc->accept(checker);
+        check(*doc, threads);
+        auto phase = Statistics::Phase{Statistics::FEATURES};
         FeatureChecker fchecker(*doc);
         doc->setSupportedMethods(fchecker.getSupportedMethods());
     }
@@ -2628,17 +2763,51 @@ int32_t parseXMLBuffer(const char* buffer, Document* doc, bool newxta, const std
     return 0;
 }
 
-int32_t parseXMLFile(const char* file, Document* doc, bool newxta, const std::vector<std::filesystem::path>& paths)
+int32_t reparseXMLElement(std::string_view element, const std::string& xpath, Document* doc,
+                          IncrementalTypeChecker& checker, bool newxta, const std::vector<std::filesystem::path>& paths)
 {
+    auto scope = doc->createNodes();
+    auto types = TypeTable::Scope{doc->getTypeTable()};
+    auto stats = Statistics::Scope{*doc};
+    const auto errors = doc->getErrors();
+    const auto warnings = doc->getWarnings();
+    auto builder = ElementBuilder{*doc, paths};
+    if (parseXMLElement(element, xpath, &builder, newxta) != 0 || !builder.isReplaced()) {
+        doc->setDiagnostics(errors, warnings);
+        return 1;
+    }
+    if (auto* templ = builder.getReplacedTemplate()) {
+        // The processes have the fields of the new frame
+        if (!doc->updateProcesses(*templ))
+            return 1;
+        checker.invalidate(*templ);
+        checker.invalidate(templ->uid);
+        for (const auto& process : doc->getProcesses())
+            if (process.templ == templ)
+                checker.invalidate(process.uid);
+        checker.invalidateSystem();
+    }
+    if (checker.reparsed(xpath)) {
+        auto phase = Statistics::Phase{Statistics::TYPECHECKER};
+        checker.recheck();
+    }
+    return 0;
+}
+
+int32_t parseXMLFile(const char* file, Document* doc, bool newxta, const std::vector<std::filesystem::path>& paths,
+                     uint32_t threads)
+{
+    auto scope = doc->createNodes();
+    auto types = TypeTable::Scope{doc->getTypeTable()};
+    auto stats = Statistics::Scope{*doc};
     auto builder = DocumentBuilder{*doc, paths};
-    int err = parseXMLFile(file, &builder, newxta);
+    int err = parseXMLFile(file, &builder, newxta, threads, doc->hasLazyTemplates());
     if (err) {
         return err;
     }
 
     if (!doc->hasErrors()) {
-        TypeChecker checker(*doc);
-        doc->accept(checker);
+        check(*doc, threads);
     }
 
     return 0;
@@ -2646,6 +2815,9 @@ int32_t parseXMLFile(const char* file, Document* doc, bool newxta, const std::ve
 
 int32_t parseXMLFd(int fd, Document* doc, bool newxta, const std::vector<std::filesystem::path>& paths)
 {
+    auto scope = doc->createNodes();
+    auto types = TypeTable::Scope{doc->getTypeTable()};
+    auto stats = Statistics::Scope{*doc};
     auto builder = DocumentBuilder{*doc, paths};
     int err = parseXMLFd(fd, &builder, newxta);
     if (err) {
@@ -2653,6 +2825,7 @@ int32_t parseXMLFd(int fd, Document* doc, bool newxta, const std::vector<std::fi
     }
 
     if (!doc->hasErrors()) {
+        auto phase = Statistics::Phase{Statistics::TYPECHECKER};
         TypeChecker checker(*doc);
         doc->accept(checker);
     }
@@ -2660,12 +2833,55 @@ int32_t parseXMLFd(int fd, Document* doc, bool newxta, const std::vector<std::fi
     return 0;
 }
 
+/** Runs the parse on a thread of its own, watched by the monitor. */
+template <typename Parse>
+static std::future<parse_result_t> parseAsync(ParseMonitor monitor, Parse&& parse)
+{
+    return std::async(std::launch::async, [monitor = std::move(monitor), parse = std::forward<Parse>(parse)]() mutable {
+        auto result = parse_result_t{};
+        auto scope = ParseMonitor::Scope{monitor};
+        try {
+            ParseMonitor::checkpoint();
+            result.document = std::make_unique<Document>();
+            result.status = parse(*result.document);
+        } catch (const CancelledError&) {
+            result.document.reset();
+        }
+        // The lexer ends the input early rather than throwing, which may leave nothing else to stop at
+        if (monitor.isCancelled())
+            result.document.reset();
+        return result;
+    });
+}
+
+std::future<parse_result_t> parseXMLFileAsync(std::string file, bool newxta, ParseMonitor monitor,
+                                              std::vector<std::filesystem::path> paths, uint32_t threads)
+{
+    return parseAsync(std::move(monitor), [file = std::move(file), newxta, paths = std::move(paths),
+                                           threads](Document& doc) {
+        return parseXMLFile(file.c_str(), &doc, newxta, paths, threads);
+    });
+}
+
+std::future<parse_result_t> parseXMLBufferAsync(std::string buffer, bool newxta, ParseMonitor monitor,
+                                                std::vector<std::filesystem::path> paths, uint32_t threads)
+{
+    return parseAsync(std::move(monitor), [buffer = std::move(buffer), newxta, paths = std::move(paths),
+                                           threads](Document& doc) {
+        return parseXMLBuffer(buffer, &doc, newxta, paths, threads);
+    });
+}
+
 expression_t parseExpression(const char* str, Document* doc, bool newxtr)
 {
+    auto scope = doc->createNodes();
+    auto types = TypeTable::Scope{doc->getTypeTable()};
+    auto stats = Statistics::Scope{*doc};
     ExpressionBuilder builder{*doc};
     parseXTA(str, &builder, newxtr, S_EXPRESSION, "");
     expression_t expr = builder.getExpressions()[0];
     if (!doc->hasErrors()) {
+        auto phase = Statistics::Phase{Statistics::TYPECHECKER};
         TypeChecker checker{*doc};
         checker.checkExpression(expr);
     }
@@ -2680,6 +2896,7 @@ void TypeChecker::visitTemplateAfter(template_t& t)
 
 bool TypeChecker::visitTemplateBefore(template_t& t)
 {
+    ParseMonitor::checkpoint();
     assert(!temp);
     temp = &t;
     return true;
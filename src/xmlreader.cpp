@@ -20,10 +20,14 @@
    USA
  */
 
+#include "MappedFile.hpp"
+#include "RecordingBuilder.hpp"
 #include "keywords.hpp"
 #include "libparser.h"
 
+#include "utap/cancellation.h"
 #include "utap/utap.h"
+#include "utap/xmlelements.h"
 
 #include <libxml/parser.h>
 #include <libxml/xmlreader.h>
@@ -31,14 +35,19 @@
 #include <libxml/xpath.h>
 
 #include <algorithm>
+#include <atomic>
+#include <future>
 #include <list>
 #include <map>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <cassert>
 #include <charconv>
@@ -295,6 +304,223 @@ namespace UTAP
 
     using xmlTextReader_ptr = std::unique_ptr<xmlTextReader, decltype(xmlFreeTextReader)&>;
 
+    /**
+     * Parses the parameters, declarations and labels of timed automata
+     * templates on worker threads ahead of the XMLReader.
+     *
+     * First an XMLReader in collecting mode reads the document and adds
+     * the texts found in templates (grouped per template, in document
+     * order) while only the global declarations are parsed, to learn
+     * the global type names. Then start() parses each template on a
+     * worker thread into RecordingBuilders and the XMLReader reading
+     * the document for real replays the recordings in document order
+     * instead of parsing the texts itself.
+     */
+    class TemplatePrefetcher
+    {
+    public:
+        struct job_t
+        {
+            std::string xpath{};
+            xta_part_t part{};
+            std::string text{};
+            std::optional<RecordingBuilder> calls{};
+            int32_t result{0};
+            /* The tracker state after parsing, relative to the start position. */
+            uint32_t position{0};
+            uint32_t offset{0};
+            uint32_t line{0};
+        };
+
+        explicit TemplatePrefetcher(bool newxta): newxta{newxta}, collector{types, nullptr, false} {}
+        TemplatePrefetcher(const TemplatePrefetcher&) = delete;
+        TemplatePrefetcher& operator=(const TemplatePrefetcher&) = delete;
+        ~TemplatePrefetcher() noexcept
+        {
+            cancelled = true;
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        /** The builder to be used by the collecting XMLReader. */
+        ParserBuilder* getCollector() { return &collector; }
+        bool isCollecting() const { return collecting; }
+
+        void beginTemplate() { templates.push_back(std::make_unique<templ_t>()); }
+
+        /** The collecting XMLReader calls this instead of parsing the text. */
+        int collect(bool inTemplate, const char* text, xta_part_t part, const std::string& xpath)
+        {
+            if (inTemplate) {
+                templates.back()->jobs.push_back(job_t{xpath, part, text});
+                return 0;
+            }
+            if (part != S_DECLARATION)
+                return 0;
+            return parseXTA(text, &collector, tracker, newxta, part, xpath);
+        }
+
+        /** Starts parsing the collected templates using \a threads worker threads. */
+        void start(uint32_t threads)
+        {
+            collecting = false;
+            globals = std::make_shared<const RecordingBuilder::names_t>(std::move(*types));
+            threads = std::min<size_t>(threads, templates.size());
+            for (uint32_t i = 0; i < threads; ++i)
+                workers.emplace_back([this] {
+                    for (auto t = next++; t < templates.size() && !cancelled; t = next++)
+                        parse(*templates[t]);
+                });
+        }
+
+        /**
+         * Returns the prefetched result for the given text, waiting for
+         * its template to be parsed, or nullptr if it is not available.
+         */
+        const job_t* take(const std::string& xpath, xta_part_t part, const char* text)
+        {
+            for (auto t = templ; t < templates.size(); ++t) {
+                auto& jobs = templates[t]->jobs;
+                for (auto j = (t == templ ? job : 0); j < jobs.size(); ++j) {
+                    if (jobs[j].part == part && jobs[j].xpath == xpath && jobs[j].text == text) {
+                        templ = t;
+                        job = j + 1;
+                        templates[t]->parsed.wait();
+                        return templates[t]->failed ? nullptr : &jobs[j];
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+    private:
+        struct templ_t
+        {
+            std::vector<job_t> jobs;
+            std::promise<void> done;
+            std::shared_future<void> parsed{done.get_future()};
+            bool failed{false};
+        };
+
+        bool newxta;
+        std::shared_ptr<RecordingBuilder::names_t> types{std::make_shared<RecordingBuilder::names_t>()};
+        std::shared_ptr<const RecordingBuilder::names_t> globals;
+        RecordingBuilder collector;
+        PositionTracker tracker;
+        std::vector<std::unique_ptr<templ_t>> templates;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> next{0};
+        std::atomic<bool> cancelled{false};
+        bool collecting{true};
+        size_t templ{0}; /**< The template of the next job to be taken. */
+        size_t job{0};   /**< The next job to be taken. */
+
+        /** Parses the jobs of one template sharing the template local type names. */
+        void parse(templ_t& t)
+        {
+            auto local = std::make_shared<RecordingBuilder::names_t>();
+            try {
+                for (auto& job : t.jobs) {
+                    job.calls.emplace(local, globals);
+                    auto relative = PositionTracker{0};
+                    job.result = parseXTA(job.text, &*job.calls, relative, newxta, job.part, job.xpath);
+                    job.position = relative.position;
+                    job.offset = relative.offset;
+                    job.line = relative.line;
+                }
+            } catch (...) {
+                t.failed = true;
+            }
+            t.done.set_value();
+        }
+    };
+
+    /** Calls fn with each identifier of the text, e.g. in declarations, labels or comments. */
+    template <typename Fn>
+    static void forEachIdentifier(std::string_view text, Fn&& fn)
+    {
+        const auto* p = text.data();
+        const auto* const end = p + text.size();
+        while (p != end) {
+            if (!is_alpha(*p)) {
+                ++p;
+                continue;
+            }
+            const auto* first = p;
+            while (p != end && is_id_char(*p))
+                ++p;
+            fn(std::string_view(first, std::distance(first, p)));
+        }
+    }
+
+    /**
+     * Returns for each template of the document whether it can be left
+     * unbuilt: a template is used if its name occurs as an identifier
+     * in any text outside the templates (the declarations, the
+     * instantiation, the system and the queries) or in a used template,
+     * such that spawning and partial instances are covered.  This errs
+     * on the safe side, e.g. for a name in a comment.  Takes  reader.
+     */
+    static std::vector<bool> unusedTemplates(xmlTextReaderPtr reader)
+    {
+        auto owner = xmlTextReader_ptr{reader, xmlFreeTextReader};
+        auto names = std::unordered_map<std::string, std::vector<size_t>>{};
+        auto identifiers = std::vector<std::unordered_set<std::string>>{}; /**< Occurring in each template */
+        auto outside = std::unordered_set<std::string>{}; /**< Occurring outside the templates */
+        auto inTemplate = false;
+        auto inName = false;
+        while (xmlTextReaderRead(reader) == 1) {
+            const auto depth = xmlTextReaderDepth(reader);
+            switch (xmlTextReaderNodeType(reader)) {
+            case XML_READER_TYPE_ELEMENT: {
+                const auto tag = std::string_view{(const char*)xmlTextReaderConstLocalName(reader)};
+                if (depth == 1 && tag == "template" && !xmlTextReaderIsEmptyElement(reader)) {
+                    inTemplate = true;
+                    identifiers.emplace_back();
+                }
+                inName = inTemplate && depth == 2 && tag == "name";
+                break;
+            }
+            case XML_READER_TYPE_END_ELEMENT:
+                inTemplate = inTemplate && depth > 1;
+                inName = false;
+                break;
+            case XML_READER_TYPE_TEXT:
+            case XML_READER_TYPE_CDATA: {
+                const auto text = std::string_view{(const char*)xmlTextReaderConstValue(reader)};
+                if (inName) {
+                    forEachIdentifier(text, [&](std::string_view id) {
+                        names[std::string{id}].push_back(identifiers.size() - 1);
+                    });
+                    inName = false;  // the name is the first identifier
+                } else if (inTemplate) {
+                    forEachIdentifier(text, [&](std::string_view id) { identifiers.back().emplace(id); });
+                } else {
+                    forEachIdentifier(text, [&](std::string_view id) { outside.emplace(id); });
+                }
+                break;
+            }
+            default: break;
+            }
+        }
+        auto unused = std::vector<bool>(identifiers.size(), true);
+        auto pending = std::vector<size_t>{};
+        for (const auto& [name, templates] : names)
+            if (outside.count(name) != 0)
+                pending.insert(pending.end(), templates.begin(), templates.end());
+        while (!pending.empty()) {
+            const auto t = pending.back();
+            pending.pop_back();
+            if (!unused[t])
+                continue;
+            unused[t] = false;
+            for (const auto& id : identifiers[t])
+                if (auto it = names.find(id); it != names.end())
+                    pending.insert(pending.end(), it->second.begin(), it->second.end());
+        }
+        return unused;
+    }
+
     /**
      * Implements a recursive descent parser for UPPAAL XML documents.
      * Uses the xmlTextReader API from libxml2.
@@ -309,6 +535,11 @@ namespace UTAP
         ParserBuilder* parser;    /**< The parser builder to which to push the model. */
         bool newxta;              /**< True if we should use new syntax. */
         Path path;
+        PositionTracker tracker; /**< Positions of the parsed elements. */
+        TemplatePrefetcher* prefetcher; /**< Prefetched template texts (optional). */
+        const std::vector<bool>* unused; /**< The templates to skip by number (optional). */
+        size_t templates{0};             /**< The number of templates read so far. */
+        bool inTemplate{false};  /**< True while reading a timed automata template. */
         bool nta;                /**< True if the enclosing tag is "nta" (false if it is "project") */
         int bottomPrechart;      /**< y location of the prechart bottom */
         std::string currentType; /**< type of the current LSC template */
@@ -358,6 +589,8 @@ namespace UTAP
         const std::string& getName(const char* id) const;
         /** Invokes the bison generated parser to parse the given string. */
         int parse(const xmlChar*, xta_part_t syntax);
+        /** Replays the prefetched parse of the given string. */
+        int replay(const TemplatePrefetcher::job_t& job, const char* text, xta_part_t syntax);
         /** Parse optional declaration. */
         bool declaration();
         /** Parse optional label. */
@@ -388,6 +621,8 @@ namespace UTAP
         bool transition();
         /** Parse optional template. */
         bool templ();
+        /** Reports the template at the given path as skipped and reads past it. */
+        void skipTempl(const std::string& t_path);
         /** Parses an optional parameter tag and returns the number of parameters. */
         int parameter();
         /** Parse optional instantiation tag. */
@@ -429,13 +664,17 @@ namespace UTAP
         bool result();
 
     public:
-        XMLReader(xmlTextReaderPtr reader, ParserBuilder* parser, bool newxta):
-            reader(reader, xmlFreeTextReader), parser{parser}, newxta{newxta}
+        XMLReader(xmlTextReaderPtr reader, ParserBuilder* parser, bool newxta,
+                  TemplatePrefetcher* prefetcher = nullptr, const std::vector<bool>* unused = nullptr):
+            reader(reader, xmlFreeTextReader), parser{parser}, newxta{newxta}, prefetcher{prefetcher},
+            unused{unused}
         {
             read();
         }
         /** Parse the project document (either NTA or PROJECT tag). */
         void project();
+        /** Parse the single template or query wrapped by parseXMLElement. */
+        void element();
     };
 
     static const auto non_unique_id = std::string{"$Non-unique_id_attribute_value: "};
@@ -559,7 +798,31 @@ namespace UTAP
 
     int XMLReader::parse(const xmlChar* text, xta_part_t syntax)
     {
-        return parseXTA((const char*)text, parser, newxta, syntax, path.get());
+        if (prefetcher) {
+            if (prefetcher->isCollecting())
+                return prefetcher->collect(inTemplate, (const char*)text, syntax, path.get());
+            if (inTemplate) {
+                if (const auto* job = prefetcher->take(path.get(), syntax, (const char*)text))
+                    return replay(*job, (const char*)text, syntax);
+            }
+        }
+        return parseXTA((const char*)text, parser, tracker, newxta, syntax, path.get());
+    }
+
+    int XMLReader::replay(const TemplatePrefetcher::job_t& job, const char* text, xta_part_t syntax)
+    {
+        const auto shift = tracker.position;
+        const auto replayed = job.calls->replay(*parser, shift);
+        if (replayed < job.calls->size()) {
+            /* A type name was guessed wrong: parse again skipping the calls already replayed. */
+            auto rest = RecordingBuilder{*parser, replayed};
+            return parseXTA(text, &rest, tracker, newxta, syntax, path.get());
+        }
+        tracker.position = shift + job.position;
+        tracker.offset = job.offset;
+        tracker.line = job.line;
+        tracker.path = job.xpath;
+        return job.result;
     }
 
     bool XMLReader::declaration()
@@ -646,23 +909,18 @@ namespace UTAP
     std::string XMLReader::readText(bool instanceLine)
     {
         if (getNodeType() == XML_READER_TYPE_TEXT) {  // text content of a node
-            xmlChar* text = xmlTextReaderValue(reader.get());
-            auto len = text ? std::strlen((const char*)text) : 0;
-            auto text_sv = std::string_view{(const char*)text, len};
+            const auto* text = (const char*)xmlTextReaderConstValue(reader.get());
+            auto text_sv = text ? std::string_view{text} : std::string_view{};
             tracker.setPath(parser, path.get());
             tracker.increment(parser, text_sv.size());
             try {
                 std::string_view id = (instanceLine) ? text_sv : symbol(text_sv);
-                if (!is_keyword(id, syntax_t::OLD_PROPERTY)) {
-                    auto res = std::string{id};
-                    xmlFree(text);
-                    return res;
-                }
+                if (!is_keyword(id, syntax_t::OLD_PROPERTY))
+                    return std::string{id};
                 parser->handleError(TypeException{"$Keywords_are_not_allowed_here"});
             } catch (std::logic_error& str) {
                 parser->handleError(TypeException{str.what()});
             }
-            xmlFree(text);
         }
         return "";
     }
@@ -672,20 +930,17 @@ namespace UTAP
         read();
         if (getNodeType() == XML_READER_TYPE_TEXT) {  // text content of a node
             tracker.setPath(parser, path.get());
-            xmlChar* text = xmlTextReaderValue(reader.get());
-            const char* pc = (const char*)text;
+            const auto* pc = (const char*)xmlTextReaderConstValue(reader.get());
             auto len = std::strlen(pc);
             tracker.increment(parser, len);
             try {
                 int value;
                 if (auto [p, ec] = std::from_chars(pc, pc + len, value); ec != std::errc{})
                     throw std::logic_error{std::make_error_code(ec).category().name()};
-                xmlFree(text);
                 return value;
             } catch (const char* str) {
                 parser->handleError(TypeException{str});
             }
-            xmlFree(text);
         }
         return -1;
     }
@@ -1090,11 +1345,20 @@ namespace UTAP
     bool XMLReader::templ()
     {
         if (begin(tag_t::TEMPLATE)) {
+            ParseMonitor::checkpoint();
             std::string t_path = path.get(tag_t::TEMPLATE);
+            if (const auto t = templates++; unused != nullptr && t < unused->size() && (*unused)[t]) {
+                skipTempl(t_path);
+                return true;
+            }
+            if (prefetcher && prefetcher->isCollecting())
+                prefetcher->beginTemplate();
+            inTemplate = true;
             read();
+            std::string t_name;
             try {
                 /* Get the name and the parameters of the template. */
-                std::string t_name = name();
+                t_name = name();
                 parameter();
 
                 /* Push template start to parser builder. This might
@@ -1123,12 +1387,29 @@ namespace UTAP
             } catch (TypeException& e) {
                 parser->handleError(e);
             }
-
+            inTemplate = false;
+            /* The collecting pass of the prefetcher reads the templates too */
+            if (auto* monitor = ParseMonitor::current(); monitor && !(prefetcher && prefetcher->isCollecting()))
+                monitor->templateRead(t_name);
             return true;
         }
         return false;
     }
 
+    void XMLReader::skipTempl(const std::string& t_path)
+    {
+        xmlChar* text = xmlTextReaderReadOuterXml(reader.get());
+        const auto t_text = std::string{text ? (const char*)text : ""};
+        xmlFree(text);
+        read();
+        const auto t_name = name();
+        while (!end(tag_t::TEMPLATE))
+            read();
+        tracker.setPath(parser, t_path);
+        tracker.increment(parser, 1);
+        parser->procSkipped(t_name.c_str(), t_path, t_text);
+    }
+
     bool XMLReader::lscTempl()
     {
         if (begin(tag_t::LSC)) {
@@ -1331,7 +1612,7 @@ namespace UTAP
         } else {
             nta = begin(tag_t::NTA);  // "nta" or "project"?
             if (newxta)
-                parse((const xmlChar*)utap_builtin_declarations(), S_DECLARATION);
+                parseBuiltins(parser, tracker, path.get());
             read();
             declaration();
             while (templ())
@@ -1346,6 +1627,25 @@ namespace UTAP
         }
     }
 
+    void XMLReader::element()
+    {
+        if (!begin(tag_t::NTA) && !begin(tag_t::PROJECT))
+            throw TypeException{"$Missing_nta_or_project_tag"};
+        nta = begin(tag_t::NTA);
+        read();
+        if (templ())
+            return;
+        if (begin(tag_t::QUERIES, false)) {
+            read();
+            // skip the empty queries standing in for the left siblings
+            while (begin(tag_t::QUERY, false) && isEmpty())
+                read();
+            if (query())
+                return;
+        }
+        throw XMLDocError("Missing element");
+    }
+
     bool XMLReader::model_options()
     {
         while (begin(tag_t::OPTION)) {
@@ -1361,37 +1661,146 @@ namespace UTAP
 
 using namespace UTAP;
 
-int32_t parseXMLFd(int fd, ParserBuilder* pb, bool newxta)
+/**
+ * Reads the document using the readers created by \a open. If \a threads
+ * is positive, the document is read twice: first to collect the texts of
+ * templates to be parsed by the worker threads and then for real. If \a
+ * lazy is true, a pass over the document first finds the templates to skip.
+ */
+template <typename Open>
+static int32_t parseXML(Open&& open, ParserBuilder* pb, bool newxta, uint32_t threads, bool lazy = false)
 {
-    xmlTextReaderPtr reader =
-        xmlReaderForFd(fd, "", "", XML_PARSE_NOCDATA | XML_PARSE_NOBLANKS | XML_PARSE_HUGE | XML_PARSE_RECOVER);
+    auto phase = Statistics::Phase{Statistics::XML};
+    auto unused = std::optional<std::vector<bool>>{};
+    if (lazy) {
+        if (xmlTextReaderPtr reader = open(); reader != nullptr)
+            unused = unusedTemplates(reader);
+    }
+    const auto* skip = unused ? &*unused : nullptr;
+    auto prefetcher = std::unique_ptr<TemplatePrefetcher>{};
+    if (threads > 0) {
+        if (xmlTextReaderPtr reader = open(); reader != nullptr) {
+            prefetcher = std::make_unique<TemplatePrefetcher>(newxta);
+            try {
+                XMLReader(reader, prefetcher->getCollector(), newxta, prefetcher.get(), skip).project();
+                prefetcher->start(threads);
+            } catch (...) {
+                /* Leave it to the real pass to report the problem. */
+                prefetcher.reset();
+            }
+        }
+    }
+    xmlTextReaderPtr reader = open();
     if (reader == nullptr)
         return -1;
-    XMLReader(reader, pb, newxta).project();
+    XMLReader(reader, pb, newxta, prefetcher.get(), skip).project();
     return 0;
 }
 
-int32_t parseXMLFile(const char* filename, ParserBuilder* pb, bool newxta)
+static constexpr auto xml_options = XML_PARSE_NOCDATA | XML_PARSE_NOBLANKS | XML_PARSE_HUGE | XML_PARSE_RECOVER;
+
+int32_t parseXMLFd(int fd, ParserBuilder* pb, bool newxta)
+{
+    /* A file descriptor cannot be read twice, thus no prefetching. */
+    return parseXML([fd] { return xmlReaderForFd(fd, "", "", xml_options); }, pb, newxta, 0);
+}
+
+int32_t parseXMLFile(const char* filename, ParserBuilder* pb, bool newxta, uint32_t threads, bool lazy)
 {
-    xmlTextReaderPtr reader =
-        xmlReaderForFile(filename, "", XML_PARSE_NOCDATA | XML_PARSE_NOBLANKS | XML_PARSE_HUGE | XML_PARSE_RECOVER);
-    if (reader == nullptr)
-        return -1;
-    XMLReader(reader, pb, newxta).project();
-    return 0;
+    /* The reader parses a memory buffer in place, so a mapped file is never copied as a whole. */
+    if (const auto file = MappedFile{filename}; file.isMapped()) {
+        const auto text = file.view();
+        return parseXML(
+            [text, filename] { return xmlReaderForMemory(text.data(), text.size(), filename, "", xml_options); }, pb,
+            newxta, threads, lazy);
+    }
+    return parseXML([filename] { return xmlReaderForFile(filename, "", xml_options); }, pb, newxta, threads, lazy);
+}
+
+int32_t parseXMLBuffer(std::string_view buffer, ParserBuilder* pb, bool newxta, uint32_t threads, bool lazy)
+{
+    return parseXML(
+        [buffer] {
+            return xmlReaderForMemory(buffer.data(), buffer.size(), "", "",
+                                      XML_PARSE_NOCDATA | XML_PARSE_HUGE | XML_PARSE_RECOVER);
+        },
+        pb, newxta, threads, lazy);
+}
+
+int32_t parseXMLBuffer(const char* buffer, ParserBuilder* pb, bool newxta, uint32_t threads, bool lazy)
+{
+    return parseXMLBuffer(std::string_view{buffer}, pb, newxta, threads, lazy);
 }
 
-int32_t parseXMLBuffer(const char* buffer, ParserBuilder* pb, bool newxta)
+/** Splits an XPath like /nta/template[2] into tags and indices (1 if omitted). */
+static bool splitXPath(std::string_view xpath, std::vector<std::pair<std::string_view, size_t>>& steps)
 {
-    size_t length = strlen(buffer);
-    xmlTextReaderPtr reader =
-        xmlReaderForMemory(buffer, length, "", "", XML_PARSE_NOCDATA | XML_PARSE_HUGE | XML_PARSE_RECOVER);
+    while (!xpath.empty()) {
+        if (xpath.front() != '/')
+            return false;
+        xpath.remove_prefix(1);
+        auto step = xpath.substr(0, xpath.find('/'));
+        xpath.remove_prefix(step.size());
+        auto index = size_t{1};
+        if (auto bracket = step.find('['); bracket != std::string_view::npos) {
+            const auto digits = step.substr(bracket + 1);
+            const auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), index);
+            if (ec != std::errc{} || index == 0 || end + 1 != digits.data() + digits.size() || *end != ']')
+                return false;
+            step = step.substr(0, bracket);
+        }
+        if (step.empty())
+            return false;
+        steps.emplace_back(step, index);
+    }
+    return true;
+}
+
+int32_t parseXMLElement(std::string_view element, const std::string& xpath, ParserBuilder* pb, bool newxta)
+{
+    auto steps = std::vector<std::pair<std::string_view, size_t>>{};
+    if (!splitXPath(xpath, steps) || steps.size() < 2 || steps[0].second != 1 ||
+        (steps[0].first != "nta" && steps[0].first != "project"))
+        return -1;
+
+    /* Wrap the element in its ancestors and empty left siblings, such
+     * that the reader computes the same paths as in the whole document.
+     * The empty system tag keeps the reader from running into the end
+     * of the buffer when looking ahead.
+     */
+    auto text = std::string{"<"}.append(steps[0].first).append(">");
+    if (steps.size() == 2 && steps[1].first == "template") {
+        for (size_t i = 1; i < steps[1].second; ++i)
+            text += "<template/>";
+        text += element;
+    } else if (steps.size() == 3 && steps[1] == std::pair{std::string_view{"queries"}, size_t{1}} &&
+               steps[2].first == "query") {
+        text += "<queries>";
+        for (size_t i = 1; i < steps[2].second; ++i)
+            text += "<query/>";
+        text += element;
+        text += "</queries>";
+    } else {
+        return -1;
+    }
+    text.append("<system/></").append(steps[0].first).append(">");
+
+    xmlTextReaderPtr reader = xmlReaderForMemory(text.data(), text.size(), "", "", xml_options);
     if (reader == nullptr)
         return -1;
-    XMLReader(reader, pb, newxta).project();
+    XMLReader(reader, pb, newxta).element();
     return 0;
 }
 
+/** Appends the text of the node (not of its child elements) to \a text. */
+static void appendText(xmlDocPtr docPtr, xmlNodePtr node, std::string& text)
+{
+    xmlChar* s = xmlNodeListGetString(docPtr, node->xmlChildrenNode, 1);
+    if (s)
+        text += (char*)s;
+    xmlFree(s);
+}
+
 /**
  * Get the contents of the XML element with the specified path
  * @param xmlDocPtr - The XML document.
@@ -1412,11 +1821,7 @@ std::string getXMLElement(xmlDocPtr docPtr, const std::string& path)  // used in
         xmlNodeSetPtr nodeset = result->nodesetval;
         if (!xmlXPathNodeSetIsEmpty(nodeset) && nodeset->nodeNr > 0) {
             // The first point of the xml node
-            xmlNodePtr node = nodeset->nodeTab[0];
-            xmlChar* s = xmlNodeListGetString(docPtr, node->xmlChildrenNode, 1);
-            if (s)
-                res = (char*)s;
-            xmlFree(s);
+            appendText(docPtr, nodeset->nodeTab[0], res);
         }
         xmlXPathFreeObject(result);
     }
@@ -1444,3 +1849,94 @@ static std::string getXMLElement(const char *xmlBuffer, const std::string &path)
     }
 }
 */
+
+XMLElements::XMLElements(std::string_view xml):
+    doc{xmlReadMemory(xml.data(), xml.size(), "", nullptr, XML_PARSE_NOCDATA | XML_PARSE_HUGE | XML_PARSE_RECOVER)},
+    owned{true}
+{}
+
+XMLElements::~XMLElements() noexcept
+{
+    if (context != nullptr)
+        xmlXPathFreeContext(context);
+    if (owned && doc != nullptr)
+        xmlFreeDoc(doc);
+}
+
+std::vector<std::string_view> XMLElements::get(const std::vector<std::string>& paths)
+{
+    /* The generated paths form a trie of steps, each step the nth child element with the tag. */
+    struct step_t
+    {
+        std::map<std::pair<std::string_view, size_t>, size_t> next;
+        std::vector<size_t> paths; /**< That end here */
+    };
+    auto trie = std::vector<step_t>(1);
+    auto others = std::vector<size_t>{};
+    auto steps = std::vector<std::pair<std::string_view, size_t>>{};
+    for (size_t i = 0; i < paths.size(); ++i) {
+        steps.clear();
+        if (!splitXPath(paths[i], steps) || steps.empty()) {
+            others.push_back(i);
+            continue;
+        }
+        auto t = size_t{0};
+        for (const auto& step : steps) {
+            auto [it, added] = trie[t].next.emplace(step, trie.size());
+            if (added)
+                trie.emplace_back();
+            t = it->second;
+        }
+        trie[t].paths.push_back(i);
+    }
+
+    auto text = std::string{};
+    auto spans = std::vector<std::pair<size_t, size_t>>(paths.size(), {0, 0});
+    auto found = [&](xmlNodePtr node, const std::vector<size_t>& ends) {
+        const auto start = text.size();
+        appendText(doc, node, text);
+        for (auto i : ends)
+            spans[i] = {start, text.size() - start};
+    };
+    if (doc != nullptr) {
+        auto pending = std::vector<std::pair<xmlNodePtr, size_t>>{{doc->children, 0}};
+        auto counts = std::map<std::string_view, size_t>{};
+        while (!pending.empty()) {
+            const auto [first, t] = pending.back();
+            pending.pop_back();
+            counts.clear();
+            for (auto* node = first; node != nullptr; node = node->next) {
+                if (node->type != XML_ELEMENT_NODE || node->ns != nullptr)
+                    continue;
+                const auto tag = std::string_view{(const char*)node->name};
+                auto it = trie[t].next.find({tag, ++counts[tag]});
+                if (it == trie[t].next.end())
+                    continue;
+                const auto& step = trie[it->second];
+                if (!step.paths.empty())
+                    found(node, step.paths);
+                if (!step.next.empty())
+                    pending.emplace_back(node->children, it->second);
+            }
+        }
+        if (!others.empty() && context == nullptr)
+            context = xmlXPathNewContext(doc);
+        for (auto i : others) {
+            if (context == nullptr)
+                break;
+            xmlXPathObjectPtr result = xmlXPathEvalExpression((const xmlChar*)paths[i].c_str(), context);
+            if (result != nullptr) {
+                if (!xmlXPathNodeSetIsEmpty(result->nodesetval))
+                    found(result->nodesetval->nodeTab[0], {i});
+                xmlXPathFreeObject(result);
+            }
+        }
+    }
+
+    const auto& kept = texts.emplace_back(std::move(text));
+    auto res = std::vector<std::string_view>{};
+    res.reserve(paths.size());
+    for (const auto& [start, length] : spans)
+        res.emplace_back(kept.data() + start, length);
+    return res;
+}
@@ -25,7 +25,9 @@
 
 #include "utap/utap.h"  // writeXMLFile
 
-#include <sstream>
+#include <algorithm>
+#include <charconv>
+#include <ostream>
 #include <string_view>
 #include <cmath>    // M_PI
 #include <cstring>  // strlen
@@ -42,13 +44,19 @@ constexpr auto ERR_STATE_COLOR = "#ff6666";  // pink
 constexpr auto SELF_LOOP_RADIUS = 80;
 constexpr auto STEP = 120;
 
-template <typename T>
-static std::string concat(std::string_view s, T value)
+/* A number as text with an optional prefix, e.g. "id3", formatted on the stack. */
+class number_text
 {
-    std::ostringstream o;
-    o << s << value;
-    return o.str();
-}
+    char text[24];
+
+public:
+    explicit number_text(int32_t value, std::string_view prefix = {})
+    {
+        auto* end = std::copy(prefix.begin(), prefix.end(), text);
+        *std::to_chars(end, text + sizeof(text) - 1, value).ptr = 0;
+    }
+    const char* c_str() const { return text; }
+};
 
 XMLWriter::XMLWriter(xmlTextWriterPtr writer, Document* doc): writer(writer), doc(doc) {}
 
@@ -133,25 +141,28 @@ string XMLWriter::getChanPriority() const
 
 /* writes a "label" element with the "kind", "x" and "y" attributes
  * an with the "data" content. */
-void XMLWriter::label(const char* kind, string data, int x, int y)
+void XMLWriter::label(const char* kind, const string& data, int x, int y)
 {
     if (data == "1") {
         return;
     }
     // TODO: fix the strg conversion instead of manipulating strings
-    if (data.substr(0, 5) == "1 && ") {
-        data = data.substr(5, data.size() - 5);
-    }
-    xmlChar* tmp = ConvertInput(data.c_str(), MY_ENCODING);
-    if (tmp == nullptr) {
-        return;
+    const auto skip = data.compare(0, 5, "1 && ") == 0 ? 5 : 0;
+    const auto* content = reinterpret_cast<const xmlChar*>(data.c_str() + skip);
+    xmlChar* converted = nullptr;
+    if (!xmlCheckUTF8(content)) {  // the labels are UTF-8 already unless a name is not
+        converted = ConvertInput(data.c_str() + skip, MY_ENCODING);
+        if (converted == nullptr) {
+            return;
+        }
+        content = converted;
     }
     startElement("label");
     writeAttribute("kind", kind);
-    writeAttribute("x", std::to_string(x).c_str());
-    writeAttribute("y", std::to_string(y).c_str());
-    xmlwriteString(tmp);
-    xmlFree(tmp);
+    writeAttribute("x", number_text{x}.c_str());
+    writeAttribute("y", number_text{y}.c_str());
+    xmlwriteString(content);
+    xmlFree(converted);
     endElement();
 }
 
@@ -159,8 +170,8 @@ void XMLWriter::name(const state_t& state, int x, int y)
 {
     const char* name = state.uid.getName().c_str();
     startElement("name");
-    writeAttribute("x", std::to_string(x).c_str());
-    writeAttribute("y", std::to_string(y).c_str());
+    writeAttribute("x", number_text{x}.c_str());
+    writeAttribute("y", number_text{y}.c_str());
     writeString(name);
     endElement();
 }
@@ -168,9 +179,9 @@ void XMLWriter::name(const state_t& state, int x, int y)
 void XMLWriter::writeStateAttributes(const state_t& state, int x, int y)
 {
     int32_t id = state.locNr;
-    writeAttribute("id", concat("id", id).c_str());
-    writeAttribute("x", std::to_string(x).c_str());
-    writeAttribute("y", std::to_string(y).c_str());
+    writeAttribute("id", number_text{id, "id"}.c_str());
+    writeAttribute("x", number_text{x}.c_str());
+    writeAttribute("y", number_text{y}.c_str());
 }
 
 /* writes a location */
@@ -188,7 +199,9 @@ void XMLWriter::location(const state_t& state)
     name(state, x + 8, y + 8);
     // invariant
     if (!state.invariant.empty()) {
-        label("invariant", state.invariant.toString(), x + 8, y + 24);
+        text.clear();
+        state.invariant.toString(text);
+        label("invariant", text, x + 8, y + 24);
     }
     // "committed" or "urgent" element
     if (state.uid.getType().is(COMMITTED)) {
@@ -206,7 +219,7 @@ void XMLWriter::init(const template_t& templ)
 {
     int id = static_cast<const state_t*>(templ.init.getData())->locNr;
     startElement("init");
-    writeAttribute("ref", concat("id", id).c_str());
+    writeAttribute("ref", number_text{id, "id"}.c_str());
     endElement();
 }
 
@@ -214,9 +227,8 @@ void XMLWriter::init(const template_t& templ)
 int XMLWriter::source(const edge_t& edge)
 {
     int loc = edge.src->locNr;
-    const auto id = concat("id", loc);
     startElement("source");
-    writeAttribute("ref", id.c_str());
+    writeAttribute("ref", number_text{loc, "id"}.c_str());
     endElement();
     return loc;
 }
@@ -225,9 +237,8 @@ int XMLWriter::source(const edge_t& edge)
 int XMLWriter::target(const edge_t& edge)
 {
     int loc = edge.dst->locNr;
-    const auto id = concat("id", loc);
     startElement("target");
-    writeAttribute("ref", id.c_str());
+    writeAttribute("ref", number_text{loc, "id"}.c_str());
     endElement();
     return loc;
 }
@@ -254,8 +265,8 @@ void XMLWriter::selfLoop(const int loc, const double initialAngle, const edge_t&
 void XMLWriter::nail(int x, int y)
 {
     startElement("nail");
-    writeAttribute("x", concat("", x).c_str());
-    writeAttribute("y", concat("", y).c_str());
+    writeAttribute("x", number_text{x}.c_str());
+    writeAttribute("y", number_text{y}.c_str());
     endElement();
 }
 
@@ -289,15 +300,16 @@ void XMLWriter::labels(int x, int y, const edge_t& edge)
         }  // else ? should not happen
         label("select", str, x, y - 32);
     }
-    if (!edge.guard.empty()) {
-        label("guard", edge.guard.toString(), x, y - 16);
-    }
-    if (!edge.sync.empty()) {
-        label("synchronisation", edge.sync.toString(), x, y);
-    }
-    if (!edge.assign.empty()) {
-        label("assignment", edge.assign.toString(), x, y + 16);
-    }
+    const auto expressionLabel = [&](const char* kind, const expression_t& expr, int y) {
+        if (!expr.empty()) {
+            text.clear();
+            expr.toString(text);
+            label(kind, text, x, y);
+        }
+    };
+    expressionLabel("guard", edge.guard, y - 16);
+    expressionLabel("synchronisation", edge.sync, y);
+    expressionLabel("assignment", edge.assign, y + 16);
 }
 
 /** writes a template */
@@ -435,17 +447,51 @@ xmlChar* UTAP::ConvertInput(const char* in, const char* encoding)
     return out;
 }
 
-int32_t writeXMLFile(const char* filename, Document* doc)
+/* Writes the document through the writer, which it frees. */
+static int32_t writeXML(xmlTextWriterPtr writer, Document* doc)
 {
-    xmlTextWriterPtr writer;
-
-    /* Create a new XmlWriter for filename, with no compression. */
-    writer = xmlNewTextWriterFilename(filename, 0);
     if (writer == nullptr) {
         throw XMLWriterError("construction");
     }
     XMLWriter(writer, doc).project();
-
-    // xmlFreeTextWriter(writer);
     return 0;
 }
+
+/* Writes the document to an output buffer calling back with the text as
+ * it is flushed, without an intermediate file or document tree. */
+static int32_t writeXML(xmlOutputWriteCallback callback, void* context, Document* doc)
+{
+    auto* out = xmlOutputBufferCreateIO(callback, nullptr, context, nullptr);
+    if (out == nullptr) {
+        throw XMLWriterError("construction");
+    }
+    auto* writer = xmlNewTextWriter(out);
+    if (writer == nullptr) {
+        xmlOutputBufferClose(out);
+    }
+    return writeXML(writer, doc);
+}
+
+int32_t writeXMLFile(const char* filename, Document* doc)
+{
+    /* Create a new XmlWriter for filename, with no compression. */
+    return writeXML(xmlNewTextWriterFilename(filename, 0), doc);
+}
+
+int32_t writeXMLBuffer(std::string& buffer, Document* doc)
+{
+    const auto append = [](void* context, const char* data, int length) {
+        static_cast<std::string*>(context)->append(data, length);
+        return length;
+    };
+    return writeXML(append, &buffer, doc);
+}
+
+int32_t writeXML(std::ostream& os, Document* doc)
+{
+    const auto write = [](void* context, const char* data, int length) {
+        auto& os = *static_cast<std::ostream*>(context);
+        return os.write(data, length) ? length : -1;
+    };
+    return writeXML(write, &os, doc);
+}
@@ -21,9 +21,12 @@
 
 #include "utap/utap.h"
 
+#include <atomic>
 #include <iostream>
+#include <new>
 #include <string>
 #include <vector>
+#include <cstdlib>
 
 using UTAP::Document;
 using std::endl;
@@ -31,18 +34,46 @@ using std::cout;
 using std::cerr;
 using std::vector;
 
+/* Counts the heap allocations for --stats. */
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
 int main(int argc, char* argv[])
 {
     using namespace std::literals::string_literals;
     try {
-        if (argc < 2 || argc > 3) {
-            std::cerr << "Synopsis: check [-b] <filename>" << std::endl;
+        auto old = false;
+        auto stats = false;
+        auto arg = 1;
+        for (; arg < argc - 1; ++arg) {
+            if ("-b"s == argv[arg])
+                old = true;
+            else if ("--stats"s == argv[arg])
+                stats = true;
+            else
+                break;
+        }
+        if (arg != argc - 1) {
+            std::cerr << "Synopsis: check [-b] [--stats] <filename>" << std::endl;
             return 1;
         }
-        auto old = ("-b"s == argv[1]);
 
         Document system;
         auto name = std::string{argv[argc - 1]};
+        if (stats) {
+            UTAP::Statistics::setAllocationCounter([] { return allocations.load(std::memory_order_relaxed); });
+            system.getStatistics().setEnabled(true);
+        }
 
         if (name.substr(name.length() - 4) == ".xml") {
             parseXMLFile(name.c_str(), &system, !old);
@@ -55,6 +86,8 @@ int main(int argc, char* argv[])
             parseXTA(file, &system, !old);
             fclose(file);
         }
+        if (stats)
+            cout << system.getStatistics() << endl;
         for (const auto& err : system.getErrors())
             cerr << err << endl;
         for (const auto& warn : system.getWarnings())
@@ -1,4 +1,11 @@
 #include "utap/expression.h"
+#include "utap/flatexpression.h"
+#include "utap/memoryreport.h"
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest/doctest.h>
@@ -149,4 +156,336 @@ TEST_CASE("Expression")
             CHECK(op_d3_2.get(1) == d1_2);
         }
     }
-}
\ No newline at end of file
+}
+TEST_CASE("Hash-consed expressions")
+{
+    using namespace UTAP::Constants;
+    using exp_t = UTAP::expression_t;
+    auto frame = UTAP::frame_t::createFrame();
+    const auto x = frame.addSymbol("x", UTAP::type_t::createPrimitive(INT), {});
+    const auto y = frame.addSymbol("y", UTAP::type_t::createPrimitive(INT), {});
+    const auto guard = [&] {
+        return exp_t::createBinary(LT, exp_t::createIdentifier(x), exp_t::createBinary(PLUS, exp_t::createConstant(1),
+                                                                                       exp_t::createIdentifier(y)));
+    };
+    const auto plain = guard();
+    CHECK(!(guard() == plain));
+    CHECK(guard().equal(plain));
+
+    auto table = UTAP::ExpressionTable{};
+    auto scope = UTAP::ExpressionTable::Scope{table};
+    REQUIRE(UTAP::ExpressionTable::current() == &table);
+    const auto g1 = guard();
+    const auto g2 = guard();
+    CHECK(g1 == g2);
+    CHECK(g1[1] == g2[1]);
+    CHECK(table.size() == 5);
+    CHECK(g1.toString() == plain.toString());
+    CHECK(table.intern(plain) == g1);
+    CHECK(g1.deeperClone() == g1);
+    CHECK(!(g1.subst(y, exp_t::createConstant(2)) == g1));
+    CHECK(g1.subst(y, exp_t::createIdentifier(y)) == g1);
+    CHECK(!exp_t::createConstant(1).equal(exp_t::createConstant(2)));
+    CHECK(exp_t::createDouble(0.5) == exp_t::createDouble(0.5));
+    CHECK(!(exp_t::createDouble(0.5) == exp_t::createDouble(0.25)));
+    CHECK(!(exp_t::createDouble(1.0) == exp_t::createConstant(1)));
+}
+
+TEST_CASE("Subexpressions stored in place and spilled")
+{
+    using namespace UTAP::Constants;
+    using exp_t = UTAP::expression_t;
+    auto fields = std::vector<exp_t>{};
+    for (auto i = 0; i < 7; ++i)
+        fields.push_back(exp_t::createConstant(i));
+    const auto list = exp_t::createNary(LIST, fields);
+    REQUIRE(list.getSize() == 7);
+    CHECK(list[6] == fields[6]);
+    CHECK(list.toString() == "0, 1, 2, 3, 4, 5, 6");
+    const auto copy = list.deeperClone();
+    CHECK(copy.equal(list));
+    CHECK(!(copy[3] == list[3]));
+    auto edited = list.clone();
+    edited[6] = exp_t::createConstant(9);
+    CHECK(list[6].getValue() == 6);
+    CHECK(edited[6].getValue() == 9);
+
+    const auto pair = exp_t::createNary(LIST, {fields[0], fields[1]});
+    CHECK(pair.getSize() == 2);
+    CHECK(pair[1] == fields[1]);
+}
+
+TEST_CASE("Rendering into a buffer and cached rendering")
+{
+    using namespace UTAP::Constants;
+    using exp_t = UTAP::expression_t;
+    auto frame = UTAP::frame_t::createFrame();
+    const auto x = exp_t::createIdentifier(frame.addSymbol("x", UTAP::type_t::createPrimitive(INT), {}));
+    const auto sum = exp_t::createBinary(PLUS, x, exp_t::createConstant(1));
+    auto guard = exp_t::createBinary(LT, exp_t::createBinary(MULT, sum, exp_t::createConstant(2)), x);
+    CHECK(guard.toString() == "(x + 1) * 2 < x");
+
+    auto buffer = std::string{"guard "};
+    guard.toString(buffer);
+    CHECK(buffer == "guard (x + 1) * 2 < x");
+    auto os = std::ostringstream{};
+    os << guard << ';';
+    CHECK(os.str() == "(x + 1) * 2 < x;");
+
+    const auto cached = guard.toStringCached();
+    CHECK(cached == "(x + 1) * 2 < x");
+    CHECK(guard.toStringCached() == cached);
+    CHECK(guard.toString() == cached);
+    CHECK(exp_t::createBinary(AND, guard, guard).toString() == "(x + 1) * 2 < x && (x + 1) * 2 < x");
+    CHECK(sum.toStringCached() == "x + 1");
+    CHECK(guard.toString(true) == "(x + 1) * 2 < x");
+
+    guard.get(1) = exp_t::createConstant(3);
+    CHECK(guard.toStringCached() == "(x + 1) * 2 < 3");
+    CHECK(cached == "(x + 1) * 2 < x");  // a copy, not discarded with the cache
+
+    // a subexpression changed in place is not noticed by the cache of its parent, but by toString
+    auto inner = exp_t::createBinary(PLUS, x, exp_t::createConstant(1));
+    const auto outer = exp_t::createBinary(MULT, inner, exp_t::createConstant(2));
+    CHECK(outer.toStringCached() == "(x + 1) * 2");
+    inner.get(1) = exp_t::createConstant(5);
+    CHECK(outer.toString() == "(x + 5) * 2");
+    CHECK(exp_t::createBinary(LT, outer, x).toString() == "(x + 5) * 2 < x");
+}
+
+TEST_CASE("Interned types")
+{
+    using namespace UTAP::Constants;
+    using UTAP::type_t;
+    using exp_t = UTAP::expression_t;
+    const auto range = [] {
+        return type_t::createRange(type_t::createPrimitive(INT), exp_t::createConstant(0), exp_t::createConstant(3));
+    };
+    CHECK(!(type_t::createPrimitive(INT) == type_t::createPrimitive(INT)));
+
+    auto table = UTAP::TypeTable{};
+    auto scope = UTAP::TypeTable::Scope{table};
+    REQUIRE(UTAP::TypeTable::current() == &table);
+    CHECK(type_t::createPrimitive(INT) == type_t::createPrimitive(INT));
+    CHECK(!(type_t::createPrimitive(INT) == type_t::createPrimitive(BOOL)));
+    CHECK(!(type_t::createPrimitive(INT, {1, 2}) == type_t::createPrimitive(INT)));
+    CHECK(range() == range());
+    CHECK(range().createPrefix(CONSTANT) == range().createPrefix(CONSTANT));
+    CHECK(range().toString() == R"((range (int) "0" "3"))");
+    CHECK(!(range() == type_t::createRange(type_t::createPrimitive(INT), exp_t::createConstant(0),
+                                           exp_t::createConstant(4))));
+    const auto record = [&] {
+        return type_t::createRecord({range(), type_t::createPrimitive(BOOL)}, {"x", "y"});
+    };
+    CHECK(record() == record());
+    CHECK(!(record() == type_t::createRecord({range(), type_t::createPrimitive(BOOL)}, {"x", "z"})));
+    CHECK(type_t::createArray(record(), range()) == type_t::createArray(record(), range()));
+
+    auto frame = UTAP::frame_t::createFrame();
+    const auto n = frame.addSymbol("N", type_t::createPrimitive(INT).createPrefix(CONSTANT), {});
+    const auto bounded = [&] {
+        return type_t::createRange(type_t::createPrimitive(INT), exp_t::createConstant(0), exp_t::createIdentifier(n));
+    };
+    CHECK(!(bounded() == bounded()));  // only integer constants are compared by value
+}
+
+TEST_CASE("Frame lookup")
+{
+    using UTAP::frame_t;
+    using UTAP::symbol_t;
+    auto global = frame_t::createFrame();
+    for (int i = 0; i < 100; ++i)
+        global.addSymbol("v" + std::to_string(i), {}, {});
+    const auto x = global.addSymbol("x", {}, {});
+    auto local = frame_t::createFrame(global);
+    const auto shadow = local.addSymbol("x", {}, {});
+    auto symbol = symbol_t{};
+    REQUIRE(local.resolve("x", symbol));
+    CHECK(symbol == shadow);
+    REQUIRE(global.resolve("x", symbol));
+    CHECK(symbol == x);
+    REQUIRE(local.resolve(local.getVersion("x"), symbol));
+    CHECK(symbol == shadow);
+    REQUIRE(local.resolve("v42", symbol));
+    CHECK(symbol == global[42]);
+    CHECK(global.getIndexOf("v99") == 99);
+    CHECK(global.getIndexOf("x") == 100);
+    CHECK(local.getIndexOf("v1") == -1);
+    CHECK(!local.resolve("never_declared", symbol));
+    const auto again = global.addSymbol("v7", {}, {});
+    CHECK(global.getIndexOf("v7") == 101);  // the last declaration wins
+    REQUIRE(local.resolve("v7", symbol));
+    CHECK(symbol == again);
+    CHECK(&again.getName() == &global[7].getName());  // names are shared
+    global.remove(again);
+    CHECK(global.getIndexOf("v7") == 7);
+    // the names are interned per root: another root knows only the names of the symbols added to it
+    auto other = frame_t::createFrame();
+    CHECK(other.getVersion("v3").atom == UINT32_MAX);
+    other.add(global[3]);
+    CHECK(other.getIndexOf("v3") == 0);
+    CHECK(other.getVersion("v3").atom != UINT32_MAX);
+    CHECK(other.getIndexOf("v4") == -1);
+    const auto version = global.getVersion("v3").version;
+    global.remove(global[3]);
+    CHECK(global.getVersion("v3").version != version);
+
+    // the names of a root are interned and looked up concurrently
+    auto workers = std::vector<std::thread>{};
+    auto found = std::atomic<int>{0};
+    for (int t = 0; t < 4; ++t)
+        workers.emplace_back([&, t] {
+            auto frame = frame_t::createFrame(global);
+            for (int i = 0; i < 500; ++i) {
+                frame.addSymbol("w" + std::to_string(t) + "_" + std::to_string(i), {}, {});
+                auto symbol = symbol_t{};
+                found += local.resolve("v" + std::to_string(i % 100), symbol) && symbol.getName().size() > 1;
+            }
+        });
+    for (auto& worker : workers)
+        worker.join();
+    CHECK(found == 4 * 500 - 4 * 5);  // v3 was removed
+}
+
+TEST_CASE("Dense symbol sets")
+{
+    using UTAP::expression_t;
+    using UTAP::frame_t;
+    using UTAP::symbol_set_t;
+    using UTAP::symbol_t;
+    CHECK(symbol_t{}.getId() == 0);
+    auto frame = frame_t::createFrame();
+    for (int i = 0; i < 200; ++i)
+        frame.addSymbol("s" + std::to_string(i), {}, {});
+    auto ids = std::set<uint32_t>{};
+    for (const auto& symbol : frame)
+        ids.insert(symbol.getId());
+    CHECK(ids.size() == 200);
+    CHECK(ids.count(0) == 0);
+
+    auto evens = symbol_set_t{}, low = symbol_set_t{};
+    for (int i = 0; i < 200; ++i) {
+        if (i % 2 == 0)
+            CHECK(evens.insert(frame[i]));
+        if (i < 100)
+            low.insert(frame[i]);
+    }
+    CHECK(!evens.insert(frame[0]));
+    CHECK(evens.size() == 100);
+    CHECK(evens.contains(frame[198]));
+    CHECK(!evens.contains(frame[199]));
+    CHECK(!evens.contains(symbol_t{}));
+    CHECK(evens.intersects(low));
+    auto both = evens;
+    both &= low;
+    CHECK(both.size() == 50);
+    CHECK(both.isSubsetOf(evens));
+    CHECK(!evens.isSubsetOf(both));
+    auto rest = evens;
+    rest -= low;
+    CHECK(!rest.intersects(low));
+    rest |= both;
+    CHECK(rest == evens);
+    CHECK(rest.erase(frame[0]));
+    CHECK(!rest.erase(frame[0]));
+    CHECK(rest != evens);
+    auto visited = size_t{0};
+    rest.forEachId([&](uint32_t id) { visited += ids.count(id); });
+    CHECK(visited == 99);
+    CHECK((symbol_set_t{std::set{frame[1], frame[3]}}.size() == 2));
+    CHECK(symbol_set_t{}.empty());
+    rest.clear();
+    CHECK(rest.empty());
+
+    const auto assign = expression_t::createBinary(UTAP::Constants::ASSIGN, expression_t::createIdentifier(frame[0]),
+                                                   expression_t::createIdentifier(frame[1]));
+    CHECK(assign.changesVariable(evens));
+    CHECK(assign.dependsOn(low));
+    CHECK(!assign.dependsOn(symbol_set_t{std::set{frame[2]}}));
+    CHECK(!assign.changesVariable(symbol_set_t{std::set{frame[1]}}));
+    CHECK(assign.isReferenceTo(evens));
+    auto reads = symbol_set_t{}, writes = symbol_set_t{};
+    assign.collectPossibleReads(reads);
+    assign.collectPossibleWrites(writes);
+    CHECK(reads.contains(frame[1]));
+    CHECK(writes.contains(frame[0]));
+    CHECK(!writes.contains(frame[1]));
+
+    // the symbols of a root and its siblings are numbered together, released identifiers are not handed out again
+    CHECK(*ids.begin() == 1);
+    CHECK(*ids.rbegin() == 200);
+    auto sibling = frame_t::createRoot(frame);
+    frame.remove(frame[199]);
+    CHECK(sibling.addSymbol("t", {}, {}).getId() == 201);
+    CHECK(frame_t::createFrame(sibling).addSymbol("u", {}, {}).getId() == 202);
+    CHECK(frame_t::createFrame().addSymbol("v", {}, {}).getId() == 1);
+}
+
+TEST_CASE("Flat post-order expressions")
+{
+    using namespace UTAP::Constants;
+    using exp_t = UTAP::expression_t;
+    auto frame = UTAP::frame_t::createFrame();
+    const auto x = frame.addSymbol("x", UTAP::type_t::createPrimitive(INT), {});
+    const auto y = frame.addSymbol("y", UTAP::type_t::createPrimitive(INT), {});
+    // x < 1 + y
+    const auto guard = exp_t::createBinary(
+        LT, exp_t::createIdentifier(x), exp_t::createBinary(PLUS, exp_t::createConstant(1), exp_t::createIdentifier(y)));
+    auto flat = UTAP::flat_expression_t{guard};
+    REQUIRE(flat.size() == 5);
+    CHECK((flat.getKinds() == std::vector<kind_t>{IDENTIFIER, CONSTANT, IDENTIFIER, PLUS, LT}));
+    CHECK((flat.getValues() == std::vector<int32_t>{0, 1, 0, 0, 0}));
+    CHECK((flat.getSymbolIds() == std::vector<uint32_t>{x.getId(), 0, y.getId(), 0, 0}));
+    CHECK(flat.getSymbol(2) == y);
+    CHECK(flat.getExpression(4) == guard);
+    CHECK(flat.getSize(4) == 2);
+    CHECK(flat.getChild(4, 0) == 0);
+    CHECK(flat.getChild(4, 1) == 3);
+    CHECK(flat.getChild(3, 1) == 2);
+    CHECK(flat.getSize(0) == 0);
+    CHECK(flat.getFirst(4) == 0);
+    CHECK(flat.getFirst(3) == 1);
+    CHECK(flat.getFirst(2) == 2);
+
+    // a forest of expressions, one of them deep
+    auto list = exp_t::createIdentifier(x);
+    for (int i = 0; i < 10000; ++i)
+        list = exp_t::createBinary(COMMA, list, exp_t::createConstant(i));
+    CHECK(flat.add(list) == 5 + 20000);
+    CHECK((flat.getRoots() == std::vector<uint32_t>{4, 20005}));
+    CHECK(flat.getFirst(20005) == 5);
+    CHECK(flat.getValue(flat.getChild(20005, 1)) == 9999);
+    CHECK(flat.add({}) == 20006);
+    CHECK(flat.getKind(20006) == UNKNOWN);
+}
+
+TEST_CASE("Memory report counts shared nodes once")
+{
+    using namespace UTAP::Constants;
+    using UTAP::MemoryReport;
+    using exp_t = UTAP::expression_t;
+    const auto int_type = UTAP::type_t::createPrimitive(INT);
+    const auto two = exp_t::createConstant(2);
+    const auto sum = exp_t::createBinary(PLUS, two, two, {}, int_type);
+    const auto product = exp_t::createBinary(MULT, sum, sum, {}, int_type);
+
+    auto report = MemoryReport{};
+    product.measure(report);
+    product.measure(report);
+    const auto& exprs = report.getExpressions();
+    REQUIRE(exprs.size() == 3);
+    CHECK(exprs.at(CONSTANT).count == 1);
+    CHECK(exprs.at(PLUS).count == 1);
+    CHECK(exprs.at(MULT).count == 1);
+    CHECK(exprs.at(PLUS).bytes == exprs.at(MULT).bytes);
+    CHECK(exprs.at(PLUS).bytes >= MemoryReport::nodeBytes(0));
+    CHECK(report[MemoryReport::TYPES].count == 2);  // of the constant and the one shared by the sum and product
+
+    // the cached rendering is retained by the node
+    const auto before = exprs.at(PLUS).bytes;
+    sum.toStringCached();
+    auto cached = MemoryReport{};
+    product.measure(cached);
+    CHECK(cached.getExpressions().at(PLUS).bytes >= before + sizeof(std::string));
+    CHECK(cached.getTotal() > report.getTotal());
+}
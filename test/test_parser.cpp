@@ -14,14 +14,39 @@
  * Created on 20 August 2021, 09:47
  */
 
+#include "utap/DocumentBuilder.hpp"
 #include "utap/StatementBuilder.hpp"
+#include "utap/bytecode.h"
+#include "utap/cborwriter.h"
+#include "utap/clockconstraints.h"
+#include "utap/incrementaltypechecker.h"
+#include "utap/independence.h"
+#include "utap/librarycache.h"
+#include "utap/memoryreport.h"
+#include "utap/modelreduction.h"
+#include "utap/prettyprinter.h"
+#include "utap/queryparser.h"
+#include "utap/rangeanalysis.h"
+#include "utap/signalflow.h"
+#include "utap/simplifier.h"
+#include "utap/statelayout.h"
+#include "utap/typechecker.h"
 #include "utap/utap.h"
+#include "utap/xmlelements.h"
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest/doctest.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 inline std::string read_content(const std::string& file_name)
 {
@@ -113,3 +138,1975 @@ TEST_CASE("SMC bounds in queries")
         CHECK(expr.get(0).getValue() == -1);  // number of runs
     }
 }
+
+/** Outcome of parsing a model, compared between sequential and concurrent runs. */
+struct parse_summary_t
+{
+    size_t errors{0};
+    size_t warnings{0};
+    size_t templates{0};
+    size_t processes{0};
+    size_t variables{0};
+    size_t queries{0};
+    bool operator==(const parse_summary_t& o) const
+    {
+        return errors == o.errors && warnings == o.warnings && templates == o.templates && processes == o.processes &&
+               variables == o.variables && queries == o.queries;
+    }
+};
+
+static parse_summary_t summarize(const std::string& content)
+{
+    auto doc = UTAP::Document{};
+    parseXMLBuffer(content.c_str(), &doc, true);
+    auto builder = QueryBuilder{doc};
+    parseProperty("E<> deadlock", &builder);
+    return {doc.getErrors().size(),    doc.getWarnings().size(),         doc.getTemplates().size(),
+            doc.getProcesses().size(), doc.getGlobals().variables.size(), doc.getQueries().size()};
+}
+
+TEST_CASE("Concurrent parsing of independent documents")
+{
+    const auto models = std::vector<std::string>{"ifstatement.xml",     "powers.xml",    "simpleSystem.xml",
+                                                 "simpleSMCSystem.xml", "dynamic.xml",   "clockrate2.xml",
+                                                 "double_compare.xml",  "int_invariant.xml"};
+    auto contents = std::vector<std::string>{};
+    auto expected = std::vector<parse_summary_t>{};
+    for (const auto& model : models) {
+        contents.push_back(read_content(model));
+        expected.push_back(summarize(contents.back()));
+    }
+    constexpr auto threads = 8u;
+    constexpr auto rounds = 16u;
+    auto actual = std::vector<std::vector<parse_summary_t>>(threads);
+    auto workers = std::vector<std::thread>{};
+    for (auto t = 0u; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            for (auto r = 0u; r < rounds; ++r)
+                for (auto m = 0u; m < contents.size(); ++m)
+                    actual[t].push_back(summarize(contents[(m + t) % contents.size()]));
+        });
+    for (auto& worker : workers)
+        worker.join();
+    for (auto t = 0u; t < threads; ++t) {
+        REQUIRE(actual[t].size() == rounds * contents.size());
+        for (auto i = 0u; i < actual[t].size(); ++i)
+            CHECK(actual[t][i] == expected[(i + t) % contents.size()]);
+    }
+}
+
+/** Lines describing the parsed document, for comparing sequential and prefetched parsing. */
+static std::vector<std::string> describe(UTAP::Document& doc)
+{
+    auto res = std::vector<std::string>{};
+    for (const auto& error : doc.getErrors())
+        res.push_back("error " + error.toString() + " " + std::to_string(error.position.end - error.position.start));
+    for (const auto& warning : doc.getWarnings())
+        res.push_back("warning " + warning.toString());
+    for (const auto& variable : doc.getGlobals().variables)
+        res.push_back("global " + variable.toString());
+    for (const auto& templ : doc.getTemplates()) {
+        res.push_back("template " + templ.uid.getName());
+        for (const auto& variable : templ.variables)
+            res.push_back("variable " + variable.toString());
+        for (const auto& state : templ.states)
+            res.push_back("state " + state.uid.getName() + " " + state.invariant.toString());
+        for (const auto& edge : templ.edges)
+            res.push_back("edge " + edge.guard.toString() + " " + edge.sync.toString() + " " + edge.assign.toString());
+    }
+    return res;
+}
+
+static std::vector<std::string> describe(const std::string& content, uint32_t threads)
+{
+    auto doc = UTAP::Document{};
+    parseXMLBuffer(content.c_str(), &doc, true, {}, threads);
+    return describe(doc);
+}
+
+TEST_CASE("Prefetched template parsing matches sequential parsing")
+{
+    SUBCASE("Models")
+    {
+        for (const auto& model : {"ifstatement.xml", "powers.xml", "simpleSystem.xml", "simpleSMCSystem.xml",
+                                  "dynamic.xml", "clockrate2.xml", "double_compare.xml", "int_invariant.xml"}) {
+            const auto content = read_content(model);
+            CHECK(describe(content, 4) == describe(content, 0));
+        }
+    }
+    SUBCASE("Mispredicted type names")
+    {
+        // tmp_t is only a type inside f, so the guard must be re-parsed with the real scope
+        const auto content = std::string{R"(<nta>
+<declaration>typedef int[0,3] id_t; int g;</declaration>
+<template><name>P</name><parameter>const id_t id</parameter>
+<declaration>typedef int[0,1] bit_t; bit_t b; int tmp_t; void f() { typedef int[0,2] tmp_t; tmp_t z = 0; g = z; }</declaration>
+<location id="id0"><name>A</name><label kind="invariant">tmp_t &lt; 2</label></location><init ref="id0"/>
+<transition><source ref="id0"/><target ref="id0"/><label kind="guard">tmp_t == 0 &amp;&amp; b == 0</label>
+<label kind="assignment">b = 1, f()</label></transition></template>
+<template><name>Q</name><declaration>id_t y; bit_t w;</declaration><location id="id1"/><init ref="id1"/></template>
+<system>system P, Q;</system></nta>)"};
+        const auto parallel = describe(content, 2);
+        CHECK(parallel == describe(content, 0));
+        CHECK(std::find(parallel.begin(), parallel.end(), "edge tmp_t == 0 && b == 0  b = 1, f()") != parallel.end());
+    }
+}
+
+TEST_CASE("Asynchronous parsing with progress and cancellation")
+{
+    auto content = std::string{"<nta><declaration>int g;</declaration>"};
+    auto system = std::string{"system "};
+    for (auto i = 0; i < 5; ++i) {
+        const auto name = "T" + std::to_string(i);
+        content += "<template><name>" + name + "</name><declaration>void f() { g++; }</declaration>"
+                   "<location id=\"id" + std::to_string(i) + "\"/><init ref=\"id" + std::to_string(i) +
+                   "\"/></template>";
+        system += (i > 0 ? ", " : "") + name;
+    }
+    content += "<system>" + system + ";</system></nta>";
+
+    SUBCASE("Completed")
+    {
+        auto reported = std::vector<std::string>{};
+        auto progress = [&](const std::string& name, size_t templates) {
+            reported.push_back(name + " " + std::to_string(templates));
+        };
+        auto result = parseXMLBufferAsync(content, true, UTAP::ParseMonitor{{}, progress}).get();
+        REQUIRE(result.document != nullptr);
+        CHECK(result.status == 0);
+        CHECK_FALSE(result.document->hasErrors());
+        CHECK(result.document->getTemplates().size() == 5);
+        CHECK((reported == std::vector<std::string>{"T0 1", "T1 2", "T2 3", "T3 4", "T4 5"}));
+    }
+    SUBCASE("Cancelled while reading")
+    {
+        auto token = UTAP::CancellationToken{};
+        auto reported = size_t{0};
+        auto progress = [&](const std::string& name, size_t templates) {
+            reported = templates;
+            if (name == "T1")
+                token.cancel();
+        };
+        auto result = parseXMLBufferAsync(content, true, UTAP::ParseMonitor{token, progress}).get();
+        CHECK(result.document == nullptr);
+        CHECK(reported == 2);
+        CHECK(token.isCancelled());
+    }
+    SUBCASE("Cancelled before starting")
+    {
+        auto token = UTAP::CancellationToken{};
+        token.cancel();
+        auto reported = size_t{0};
+        auto progress = [&](const std::string&, size_t templates) { reported = templates; };
+        auto future = parseXMLBufferAsync(content, true, UTAP::ParseMonitor{token, progress}, {}, 2);
+        CHECK(future.get().document == nullptr);
+        CHECK(reported == 0);
+    }
+    CHECK(UTAP::ParseMonitor::current() == nullptr);
+}
+
+TEST_CASE("Lazy parsing skips the templates never instantiated")
+{
+    auto templ = [](const std::string& name, const std::string& declaration) {
+        return "<template><name>" + name + "</name><declaration>" + declaration +
+               "</declaration><location id=\"" + name + "0\"/><init ref=\"" + name + "0\"/></template>";
+    };
+    const auto content = "<nta><declaration>int g;</declaration>" + templ("P", "void f() { g++; }") +
+                         templ("Unused", "int x = undeclared;") + templ("Q", "// uses R") +
+                         templ("R", "int y;") + templ("Alone", "clock z;") +
+                         "<instantiation>Q1 = Q();</instantiation><system>system P, Q1;</system>"
+                         "<queries><query><formula>A[] g &gt;= 0</formula></query></queries></nta>";
+
+    SUBCASE("Full")
+    {
+        auto doc = UTAP::Document{};
+        parseXMLBuffer(content, &doc, true);
+        CHECK(doc.hasErrors());
+        CHECK(doc.getTemplates().size() == 5);
+        CHECK(doc.getSkippedTemplates().empty());
+    }
+    for (auto threads : {0u, 2u}) {
+        CAPTURE(threads);
+        auto doc = UTAP::Document{};
+        doc.setLazyTemplates(true);
+        parseXMLBuffer(content, &doc, true, {}, threads);
+        CHECK_FALSE(doc.hasErrors());
+        auto built = std::vector<std::string>{};
+        for (const auto& t : doc.getTemplates())
+            built.push_back(t.uid.getName());
+        CHECK((built == std::vector<std::string>{"P", "Q", "R"}));
+        const auto& skipped = doc.getSkippedTemplates();
+        REQUIRE(skipped.size() == 2);
+        CHECK(skipped[0].name == "Unused");
+        CHECK(skipped[0].xpath == "/nta/template[2]");
+        CHECK(skipped[0].text.find("undeclared") != std::string::npos);
+        CHECK(skipped[1].name == "Alone");
+        CHECK(skipped[1].xpath == "/nta/template[5]");
+        CHECK(doc.getProcesses().size() == 2);
+    }
+}
+
+#if defined(__linux__)
+TEST_CASE("Imported libraries are loaded once per process")
+{
+    auto& cache = UTAP::LibraryCache::instance();
+    cache.purge();
+    const auto loaded = cache.size();
+    const auto text = std::string{
+        "import \"libm.so.6\" { double j0(double x); };\n"
+        "double y = 0.0;\n"
+        "process P() { state A; init A; trans A -> A { assign y = j0(y); }; }\n"
+        "system P;\n"};
+    {
+        auto first = UTAP::Document{};
+        auto second = UTAP::Document{};
+        REQUIRE(parseXTA(text.c_str(), &first, true));
+        REQUIRE(parseXTA(text.c_str(), &second, true));
+        CHECK(cache.size() == loaded + 1);
+        CHECK(cache.purge() == 0);  // still imported by the documents
+
+        const auto handle = cache.load("libm.so.6", {""});
+        REQUIRE(handle);
+        CHECK(handle.getPath() == "libm.so.6");
+        CHECK(handle.getFunction("j0") != nullptr);
+        CHECK(handle.getFunction("j0") == handle.getFunction("j0"));
+        CHECK(handle.getFunction("no_such_function") == nullptr);
+        CHECK(cache.size() == loaded + 1);
+    }
+    CHECK(cache.purge() == 1);
+    CHECK(cache.size() == loaded);
+    CHECK_FALSE(cache.load("no_such_library", {""}));
+}
+
+TEST_CASE("Imported libraries are looked up in the current working directory")
+{
+    auto& cache = UTAP::LibraryCache::instance();
+    auto libm = cache.load("libm.so.6", {""});
+    REQUIRE(libm);
+    auto maps = std::ifstream{"/proc/self/maps"};
+    auto line = std::string{}, original = std::string{};
+    while (original.empty() && std::getline(maps, line))
+        if (auto at = line.find('/'); at != std::string::npos && line.find("/libm.so", at) != std::string::npos)
+            original = line.substr(at);
+    REQUIRE(!original.empty());
+
+    // the same name in two directories is two libraries
+    const auto dir = std::filesystem::temp_directory_path() / "utap_library_cache_test";
+    std::filesystem::remove_all(dir);
+    for (const auto* sub : {"a", "b"}) {
+        std::filesystem::create_directories(dir / sub);
+        std::filesystem::copy_file(original, dir / sub / "libtwin.so");
+    }
+    const auto cwd = std::filesystem::current_path();
+    std::filesystem::current_path(dir / "a");
+    auto first = cache.load("libtwin", {});
+    std::filesystem::current_path(dir / "b");
+    auto second = cache.load("libtwin", {});
+    std::filesystem::current_path(cwd);
+    REQUIRE(first);
+    REQUIRE(second);
+    CHECK(first.getPath() == std::filesystem::weakly_canonical(dir / "a" / "libtwin.so").string());
+    CHECK(second.getPath() == std::filesystem::weakly_canonical(dir / "b" / "libtwin.so").string());
+    CHECK(cache.load("libtwin", {}).getPath().empty());
+
+    first = second = libm = UTAP::LibraryCache::Handle{};
+    CHECK(cache.purge() == 3);
+    std::filesystem::remove_all(dir);
+}
+#endif
+
+TEST_CASE("Documents with local nodes")
+{
+    const auto content = read_content("simpleSystem.xml");
+    auto guard = UTAP::expression_t{};
+    {
+        auto doc = UTAP::Document{};
+        parseXMLBuffer(content.c_str(), &doc, true);
+        REQUIRE(!doc.getTemplates().empty());
+        REQUIRE(!doc.getTemplates().front().edges.empty());
+        guard = doc.getTemplates().front().edges.front().guard;
+    }
+    const auto text = guard.toString();
+    CHECK(!text.empty());
+
+    // local nodes are counted for one thread, so the document is checked on this one
+    auto copies = std::vector<UTAP::expression_t>{};
+    {
+        auto local = UTAP::Document{};
+        local.setLocal(true);
+        CHECK(local.isLocal());
+        parseXMLBuffer(content.c_str(), &local, true, {}, 4);
+        CHECK(describe(local) == describe(content, 0));
+        copies.assign(100, local.getTemplates().front().edges.front().guard);
+        CHECK(copies.back().toString() == text);
+
+        // the counting cannot change once the nodes have been created
+        CHECK_NOTHROW(local.setLocal(true));
+        CHECK_THROWS_AS(local.setLocal(false), std::logic_error);
+        CHECK(local.isLocal());
+    }
+    CHECK(copies.back().toString() == text);  // local nodes outlive their document as well
+
+    auto fresh = UTAP::Document{};
+    CHECK_NOTHROW(fresh.setLocal(true));
+    CHECK_NOTHROW(fresh.setLocal(false));
+}
+
+TEST_CASE("Parsing from mapped files and unterminated buffers")
+{
+    for (const auto& model : {"simpleSystem.xml", "dynamic.xml", "int_invariant.xml"}) {
+        const auto content = read_content(model);
+        const auto expected = describe(content, 0);
+        auto mapped = UTAP::Document{};
+        parseXMLFile((std::filesystem::path{MODELS_DIR} / model).string().c_str(), &mapped, true);
+        CHECK(describe(mapped) == expected);
+        // a view into a larger buffer must not be read past its end
+        const auto padded = content + "<garbage/>";
+        auto viewed = UTAP::Document{};
+        parseXMLBuffer(std::string_view{padded}.substr(0, content.size()), &viewed, true);
+        CHECK(describe(viewed) == expected);
+    }
+    // XTA files are scanned in place, or read when the NUL characters do not fit the last page
+    const auto text = std::string{"int x = 3;\nprocess P() { state A; init A; }\nsystem P;\n// "};
+    const auto path = std::filesystem::temp_directory_path() / "utap_test_parser.xta";
+    for (const auto size : {text.size(), size_t{4094}, size_t{4095}, size_t{4096}, size_t{8191}}) {
+        CAPTURE(size);
+        {
+            auto file = std::ofstream{path, std::ios::binary};
+            file << text << std::string(size - text.size(), '.');
+        }
+        REQUIRE(std::filesystem::file_size(path) == size);
+        auto doc = UTAP::Document{};
+        CHECK(parseXTAFile(path.string().c_str(), &doc, true));
+        CHECK(doc.getGlobals().variables.back().uid.getName() == "x");
+        CHECK(doc.getProcesses().size() == 1);
+    }
+    std::filesystem::remove(path);
+    auto missing = UTAP::Document{};
+    CHECK(!parseXTAFile(path.string().c_str(), &missing, true));
+}
+
+TEST_CASE("Builtin declarations are shared between documents")
+{
+    const auto text = std::string{"int8_t a = INT8_MAX; uint16_t b; double c = M_PI * 2; int8_t d = e;\n"
+                                  "process P() { state A; init A; }\nsystem P;\n"};
+    SUBCASE("Document")
+    {
+        auto builtin = UTAP::Document{};
+        parseXTA(text.c_str(), &builtin, true);
+        REQUIRE(builtin.getErrors().size() == 1);  // e is not declared
+
+        auto parsed = UTAP::Document{};
+        {
+            auto builder = UTAP::DocumentBuilder{parsed};
+            parseXTA(std::string_view{utap_builtin_declarations()}, &builder, true, UTAP::S_DECLARATION, "");
+            parseXTA(std::string_view{text}, &builder, true, UTAP::S_XTA, "");
+        }
+        auto checker = UTAP::TypeChecker{parsed};
+        parsed.accept(checker);
+        CHECK(describe(builtin) == describe(parsed));
+        for (auto i = 0; i < 3; ++i) {
+            auto again = UTAP::Document{};
+            parseXTA(text.c_str(), &again, true);
+            CHECK(describe(again) == describe(builtin));
+        }
+    }
+    SUBCASE("Pretty printer")
+    {
+        auto builtin = std::ostringstream{};
+        {
+            auto pretty = UTAP::PrettyPrinter{builtin};
+            parseXTA(text.c_str(), &pretty, true);
+        }
+        auto parsed = std::ostringstream{};
+        {
+            auto pretty = UTAP::PrettyPrinter{parsed};
+            parseXTA(std::string_view{std::string{utap_builtin_declarations()} + text}, &pretty, true, UTAP::S_XTA,
+                     "");
+        }
+        CHECK(builtin.str() == parsed.str());
+        CHECK(builtin.str().find("INT8_MAX") != std::string::npos);
+    }
+}
+
+static std::vector<std::string> functions(const UTAP::declarations_t& decls)
+{
+    auto res = std::vector<std::string>{};
+    for (const auto& function : decls.functions)
+        res.push_back(function.toString());
+    return res;
+}
+
+TEST_CASE("Binary documents restore the type checked document")
+{
+    const auto path = std::filesystem::temp_directory_path() / "utap_test_parser.bin";
+    for (const auto& model : {"simpleSystem.xml", "dynamic.xml", "int_invariant.xml", "ifstatement.xml",
+                              "powers.xml", "simpleSMCSystem.xml", "rateExpressionHybrid.xml"}) {
+        CAPTURE(model);
+        auto parsed = read_document(model);
+        REQUIRE(writeBinaryDocument(path.string().c_str(), parsed.get()) == 0);
+        auto loaded = UTAP::Document{};
+        REQUIRE(loadBinaryDocument(path.string().c_str(), &loaded) == 0);
+        CHECK(describe(loaded) == describe(*parsed));
+        CHECK(functions(loaded.getGlobals()) == functions(parsed->getGlobals()));
+        REQUIRE(loaded.getTemplates().size() == parsed->getTemplates().size());
+        auto expected = parsed->getTemplates().begin();
+        for (const auto& templ : loaded.getTemplates()) {
+            CHECK(functions(templ) == functions(*expected));
+            CHECK(templ.uid.getData() == static_cast<const UTAP::instance_t*>(&templ));
+            for (const auto& state : templ.states)
+                CHECK(state.uid.getData() == &state);
+            ++expected;
+        }
+        CHECK(loaded.getProcesses().size() == parsed->getProcesses().size());
+        REQUIRE(loaded.getQueries().size() == parsed->getQueries().size());
+        for (size_t i = 0; i < loaded.getQueries().size(); ++i)
+            CHECK(loaded.getQueries()[i].formula == parsed->getQueries()[i].formula);
+    }
+    {
+        auto out = std::ofstream{path};
+        out << "<nta/>";
+    }
+    auto foreign = UTAP::Document{};
+    CHECK_THROWS_AS(loadBinaryDocument(path.string().c_str(), &foreign), UTAP::BinaryDocumentError);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Writing XML to memory as to a file")
+{
+    const auto path = std::filesystem::temp_directory_path() / "utap_test_parser.xml";
+    for (const auto& model : {"simpleSystem.xml", "ifstatement.xml", "simpleSMCSystem.xml"}) {
+        CAPTURE(model);
+        auto doc = read_document(model);
+        REQUIRE(writeXMLFile(path.string().c_str(), doc.get()) == 0);
+        auto file = std::ifstream{path};
+        const auto written = std::string{std::istreambuf_iterator<char>{file}, {}};
+        REQUIRE(written.find("<nta>") != std::string::npos);
+        auto buffer = std::string{"<!-- kept -->"};
+        REQUIRE(writeXMLBuffer(buffer, doc.get()) == 0);
+        CHECK(buffer == "<!-- kept -->" + written);
+        auto os = std::ostringstream{};
+        REQUIRE(writeXML(os, doc.get()) == 0);
+        CHECK(os.str() == written);
+    }
+    auto buffer = std::string{};
+    writeXMLBuffer(buffer, read_document("simpleSystem.xml").get());
+    CHECK(buffer.find("<label kind=\"guard\" x=\"") != std::string::npos);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Forking documents with other constants")
+{
+    auto doc = UTAP::Document{};
+    parseXTA("const int N = 3;\nconst bool B = true;\nint x;\nint a[N];\ntypedef int[0,N-1] id_t;\n"
+             "process P() { id_t i; state A; init A; trans A -> A { guard B && x < N; }; }\nsystem P;\n",
+             &doc, true);
+    REQUIRE(doc.getErrors().empty());
+    const auto init = [](UTAP::Document& doc, const std::string& name) {
+        const auto& variables = doc.getGlobals().variables;
+        return std::find_if(variables.begin(), variables.end(),
+                            [&name](const auto& var) { return var.uid.getName() == name; })
+            ->expr.toString();
+    };
+
+    const auto snapshot = UTAP::DocumentSnapshot{doc};
+    CHECK(snapshot.size() > 0);
+    auto same = UTAP::Document{};
+    snapshot.fork(same);
+    CHECK(describe(same) == describe(doc));
+
+    auto small = UTAP::Document{};
+    snapshot.fork(small, {{"N", 2}});
+    auto large = UTAP::Document{};
+    snapshot.fork(large, {{"N", 100}, {"B", 0}});
+    CHECK(init(doc, "N") == "3");
+    CHECK(init(small, "N") == "2");
+    CHECK(init(large, "N") == "100");
+    CHECK(init(large, "B") == "0");
+    CHECK(small.getErrors().empty());
+    CHECK(large.getErrors().empty());
+    CHECK(describe(large).size() == describe(doc).size());  // the same declarations and templates
+
+    auto failed = UTAP::Document{};
+    CHECK_THROWS_AS(snapshot.fork(failed, {{"x", 1}}), UTAP::TypeException);
+    auto unknown = UTAP::Document{};
+    CHECK_THROWS_AS(snapshot.fork(unknown, {{"M", 1}}), UTAP::TypeException);
+}
+
+TEST_CASE("Instances share the expressions of their template")
+{
+    auto doc = UTAP::Document{};
+    parseXTA("int x;\nprocess P(const int k, int& v) { state A; init A; trans A -> A { guard x < k; assign v = 0; }, "
+             "A -> A { guard x > 0; }; }\nQ(const int k) = P(k, x);\nR = Q(2);\nsystem R;\n",
+             &doc, true);
+    REQUIRE(doc.getErrors().empty());
+    REQUIRE(doc.getProcesses().size() == 1);
+    const auto& process = doc.getProcesses().front();
+    const auto& edges = process.templ->edges;
+    REQUIRE(edges.size() == 2);
+    const auto& k = process.templ->parameters[0];
+    CHECK(process.getArgument(k).toString() == "k");  // the parameter of Q
+    CHECK(process.getArgument(process.getArgument(k).getSymbol()).toString() == "2");
+    CHECK(process.getArgument(process.uid).empty());
+    CHECK(process.resolve(edges.front().guard[1]).toString() == "2");
+    CHECK(process.resolve(edges.front().guard[0]) == edges.front().guard[0]);
+
+    // only the paths to the parameters are copied
+    const auto guard = process.instantiate(edges.front().guard);
+    CHECK(guard.toString() == "x < 2");
+    CHECK(edges.front().guard.toString() == "x < k");
+    CHECK(guard[0] == edges.front().guard[0]);
+    CHECK(process.instantiate(edges.front().assign).toString() == "x = 0");
+    CHECK(process.instantiate(edges.back().guard) == edges.back().guard);
+}
+
+TEST_CASE("Looking up templates, instances and processes by name")
+{
+    auto doc = UTAP::Document{};
+    parseXTA("int x;\nprocess P(const int k) { state A; init A; }\nprocess Q() { state A; init A; }\n"
+             "P1 = P(1);\nP2 = P(2);\nsystem P1, Q, P2;\n",
+             &doc, true);
+    REQUIRE(doc.getErrors().empty());
+    REQUIRE(doc.findTemplate("Q") != nullptr);
+    CHECK(doc.findTemplate("Q") == &doc.getTemplates().back());
+    CHECK(doc.findTemplate("P1") == nullptr);
+    CHECK(doc.findInstance("P2") != nullptr);
+    CHECK(doc.findInstance("P2")->templ == doc.findTemplate("P"));
+    CHECK(doc.findInstance("Q") == nullptr);
+    const auto& processes = doc.getProcessIndex();
+    REQUIRE(processes.size() == 3);
+    CHECK(processes.getId("P1") == 0);
+    CHECK(processes.getId("Q") == 1);
+    CHECK(processes.getId("P2") == 2);
+    CHECK(processes.getId("P") == -1);
+    CHECK(&processes[2] == &doc.getProcesses().back());
+    CHECK(doc.findProcess("Q")->templ == doc.findTemplate("Q"));
+    CHECK(doc.getTemplateIndex().getId("Q") == 1);
+
+    doc.freeze();
+    CHECK(doc.isFrozen());
+    CHECK(doc.getProcessIndex().getId("P2") == 2);
+    CHECK_THROWS_AS(doc.addTemplate("R", UTAP::frame_t::createFrame(), {}), UTAP::TypeException);
+    CHECK_THROWS_AS(doc.removeProcess(doc.getProcesses().front()), UTAP::TypeException);
+    CHECK(doc.getProcesses().size() == 3);
+}
+
+namespace
+{
+    /** Logs the visits, skipping the templates named skip. */
+    struct LoggingVisitor : UTAP::SystemVisitor
+    {
+        std::string skip;
+        std::vector<std::string> log;
+
+        explicit LoggingVisitor(std::string skip = {}): skip{std::move(skip)} {}
+        void visitVariable(UTAP::variable_t& var) override { log.push_back("variable " + var.uid.getName()); }
+        bool visitTemplateBefore(UTAP::template_t& templ) override
+        {
+            log.push_back("template " + templ.uid.getName());
+            return templ.uid.getName() != skip;
+        }
+        void visitTemplateAfter(UTAP::template_t& templ) override { log.push_back("end " + templ.uid.getName()); }
+        void visitState(UTAP::state_t& state) override { log.push_back("state " + state.uid.getName()); }
+        void visitEdge(UTAP::edge_t& edge) override { log.push_back("edge " + edge.src->uid.getName()); }
+        void visitProcess(UTAP::instance_t& process) override { log.push_back("process " + process.uid.getName()); }
+        void visitFunction(UTAP::function_t& fun) override { log.push_back("function " + fun.uid.getName()); }
+    };
+}  // namespace
+
+TEST_CASE("Visiting a document once for several visitors")
+{
+    auto doc = UTAP::Document{};
+    parseXTA("int x;\nint f() { return x; }\nprocess P() { int y; state A, B; init A; trans A -> B {}; }\n"
+             "process Q() { state C; init C; trans C -> C {}; }\nsystem P, Q;\n",
+             &doc, true);
+    REQUIRE(doc.getErrors().empty());
+    auto separate = std::vector<LoggingVisitor>{LoggingVisitor{}, LoggingVisitor{"P"}, LoggingVisitor{"Q"}};
+    for (auto& visitor : separate)
+        doc.accept(visitor);
+    auto fused = std::vector<LoggingVisitor>{LoggingVisitor{}, LoggingVisitor{"P"}, LoggingVisitor{"Q"}};
+    doc.accept({&fused[0], &fused[1], &fused[2]});
+    for (size_t i = 0; i < fused.size(); ++i) {
+        CAPTURE(i);
+        CHECK(fused[i].log == separate[i].log);
+    }
+    CHECK(std::count(fused[1].log.begin(), fused[1].log.end(), "state A") == 0);
+    CHECK(std::count(fused[2].log.begin(), fused[2].log.end(), "state C") == 0);
+    CHECK(std::count(fused[2].log.begin(), fused[2].log.end(), "end P") == 1);
+}
+
+static std::vector<std::string> messages(const std::vector<UTAP::error_t>& diagnostics)
+{
+    auto res = std::vector<std::string>{};
+    for (const auto& diagnostic : diagnostics)
+        res.push_back(diagnostic.msg);
+    return res;
+}
+
+TEST_CASE("Incremental type checking after edits")
+{
+    const auto text = std::string{"int x;\nint f() { return 1; }\nint g() { return 2; }\nchan c;\n"
+                                  "process P() { state A, B; init A; trans A -> B { guard f() == 1; }, "
+                                  "B -> A { sync c!; }; }\n"
+                                  "process Q() { state A; init A; trans A -> A { guard g() == 2; sync c?; }; }\n"
+                                  "system P, Q;\n"};
+    auto doc = UTAP::Document{};
+    {
+        auto builder = UTAP::DocumentBuilder{doc};
+        parseXTA(text.c_str(), &builder, true);
+    }
+    REQUIRE(doc.getErrors().empty());
+    auto checker = UTAP::IncrementalTypeChecker{doc};
+    checker.check();
+    CHECK(doc.getErrors().empty());
+    CHECK(checker.recheck() == 0);
+
+    // give f a side effect, which the guard in P must not have
+    auto& f = *std::find_if(doc.getGlobals().functions.begin(), doc.getGlobals().functions.end(),
+                            [](const auto& fun) { return fun.uid.getName() == "f"; });
+    auto* ret = dynamic_cast<UTAP::ReturnStatement*>(f.body->begin()->get());
+    REQUIRE(ret != nullptr);
+    const auto& x = *std::find_if(doc.getGlobals().variables.begin(), doc.getGlobals().variables.end(),
+                                  [](const auto& var) { return var.uid.getName() == "x"; });
+    ret->value = UTAP::expression_t::createBinary(UTAP::Constants::ASSIGN, UTAP::expression_t::createIdentifier(x.uid),
+                                                  UTAP::expression_t::createConstant(1));
+    checker.invalidate(f.uid);
+    const auto checked = checker.recheck();
+    CHECK(checked > 0);
+    CHECK(checked < 10);  // Q and the other declarations are not checked again
+    CHECK(f.changes.count(x.uid) == 1);
+
+    auto edited = UTAP::Document{};
+    auto editedText = text;
+    editedText.replace(editedText.find("return 1"), 8, "return x = 1");
+    parseXTA(editedText.c_str(), &edited, true);
+    REQUIRE(!edited.getErrors().empty());
+    CHECK(messages(doc.getErrors()) == messages(edited.getErrors()));
+    CHECK(messages(doc.getWarnings()) == messages(edited.getWarnings()));
+
+    // undoing the edit removes the diagnostics of P again
+    ret->value = UTAP::expression_t::createConstant(1);
+    checker.invalidate(f.uid);
+    checker.recheck();
+    CHECK(doc.getErrors().empty());
+    CHECK(f.changes.empty());
+}
+
+TEST_CASE("Type checking templates concurrently")
+{
+    // templates sharing type definitions, one with an invalid bound, and mixing kinds of synchronisation
+    auto text = std::string{"const int N = 4;\nint v;\ntypedef int[0,N-1] id_t;\ntypedef int[0,v] bad_t;\n"
+                            "chan c;\nurgent chan u;\nclock t;\n"};
+    auto system = std::string{"system "};
+    for (auto i = 0; i < 12; ++i) {
+        const auto name = "P" + std::to_string(i);
+        const auto sync = i == 7 ? "c" : i % 2 == 1 ? "c?" : "c!";
+        text += "process " + name + "() { id_t x; bad_t y; state A, B; init A; trans A -> B { guard x == " +
+                std::to_string(i % 4) + "; sync " + sync + "; }, B -> A { guard t > 1; sync u!; assign x = 0; }; }\n";
+        system += (i == 0 ? "" : ", ") + name;
+    }
+    text += system + ";\n";
+    const auto diagnostics = [](const std::vector<UTAP::error_t>& found) {
+        auto res = std::vector<std::string>{};
+        for (const auto& diagnostic : found)
+            res.push_back(diagnostic.toString());
+        return res;
+    };
+
+    auto sequential = UTAP::Document{};
+    parseXTA(text.c_str(), &sequential, true);
+    REQUIRE(!sequential.getErrors().empty());
+    for (auto threads : {1u, 4u, 16u}) {
+        CAPTURE(threads);
+        auto doc = UTAP::Document{};
+        {
+            auto builder = UTAP::DocumentBuilder{doc};
+            parseXTA(text.c_str(), &builder, true);
+        }
+        REQUIRE(doc.getErrors().empty());
+        auto checker = UTAP::IncrementalTypeChecker{doc};
+        checker.check(threads);
+        CHECK(diagnostics(doc.getErrors()) == diagnostics(sequential.getErrors()));
+        CHECK(diagnostics(doc.getWarnings()) == diagnostics(sequential.getWarnings()));
+        CHECK(doc.hasUrgentTransition());
+        CHECK(checker.recheck() == 0);
+    }
+}
+
+TEST_CASE("Parsing queries against a built document")
+{
+    auto doc = UTAP::Document{};
+    parseXTA("int x;\nconst int N = 3;\nprocess P() { state A, B; init A; trans A -> B { guard x < N; }; }\n"
+             "system P;\n",
+             &doc, true);
+    REQUIRE(doc.getErrors().empty());
+    const auto positions = doc.getPositions().getSize();
+    const auto summary = [](const UTAP::property_t& property) {
+        auto res = property.expression.toString();
+        for (const auto& error : property.errors)
+            res += "; " + error.toString();
+        return res;
+    };
+
+    auto queries = std::vector<UTAP::query_t>{};
+    for (const auto* formula : {"E<> P.B", "A[] x <= N", "E<> y > 0", "E<> x = 1", "A[] (", "A[] forall (i : int[0,N]) x != i"})
+        queries.push_back({formula});
+    const auto parser = UTAP::QueryParser{doc};
+    const auto sequential = parser.parse(queries);
+    REQUIRE(sequential.size() == queries.size());
+    CHECK(sequential[0].errors.empty());
+    CHECK(sequential[0].expression.toString() == "E<> P.B");
+    CHECK(sequential[1].errors.empty());
+    CHECK(sequential[2].errors.size() == 1);
+    CHECK(sequential[3].errors.size() == 1);
+    CHECK(sequential[3].errors.front().msg == "$Property_must_be_side-effect_free");
+    CHECK(!sequential[4].errors.empty());
+    CHECK(sequential[5].errors.empty());
+    CHECK(sequential[2].errors.front().start.line == 1);
+    for (const auto& property : sequential)
+        CHECK(property.warnings.empty());
+
+    // the document is left as it was, so queries can be parsed concurrently
+    CHECK(doc.getErrors().empty());
+    CHECK(doc.getPositions().getSize() == positions);
+    auto batch = std::vector<UTAP::query_t>{};
+    for (auto i = 0; i < 20; ++i)
+        batch.insert(batch.end(), queries.begin(), queries.end());
+    const auto concurrent = parser.parse(batch, 4);
+    REQUIRE(concurrent.size() == batch.size());
+    for (size_t i = 0; i < concurrent.size(); ++i) {
+        CAPTURE(i);
+        CHECK(summary(concurrent[i]) == summary(sequential[i % queries.size()]));
+    }
+}
+
+TEST_CASE("Re-parsing a single template or query")
+{
+    const auto templ = [](const std::string& name, const std::string& guard) {
+        return "<template><name>" + name + "</name><declaration>int n;</declaration>" + "<location id=\"" + name +
+               "0\"><name>A</name></location><location id=\"" + name + "1\"><name>B</name></location><init ref=\"" +
+               name + "0\"/><transition><source ref=\"" + name + "0\"/><target ref=\"" + name +
+               "1\"/><label kind=\"guard\">" + guard + "</label></transition></template>";
+    };
+    const auto query = [](const std::string& formula) { return "<query><formula>" + formula + "</formula></query>"; };
+    const auto model = [&](const std::string& guard, const std::string& formula) {
+        return "<nta><declaration>int x;</declaration>" + templ("P", "x &gt; 0") + templ("Q", guard) +
+               "<system>system P, Q;</system><queries>" + query("A[] true") + query(formula) + "</queries></nta>";
+    };
+    const auto located = [](const std::vector<UTAP::error_t>& diagnostics) {
+        auto res = std::vector<std::string>{};
+        for (const auto& diagnostic : diagnostics)
+            res.push_back(diagnostic.start.path + ": " + diagnostic.msg);
+        return res;
+    };
+
+    auto doc = UTAP::Document{};
+    {
+        auto builder = UTAP::DocumentBuilder{doc};
+        REQUIRE(parseXMLBuffer(model("x &gt; 0", "E&lt;&gt; P.B"), &builder, true) == 0);
+    }
+    REQUIRE(doc.getErrors().empty());
+    auto checker = UTAP::IncrementalTypeChecker{doc};
+    checker.check();
+    REQUIRE(doc.getErrors().empty());
+    auto& q = doc.getTemplates().back();
+
+    // each edit is compared with parsing the edited document from scratch
+    auto failing = 0;
+    for (const auto* guard : {"n == 1", "x = 1", "y &gt; 0", "x &gt; 0"}) {
+        CAPTURE(guard);
+        REQUIRE(reparseXMLElement(templ("Q", guard), "/nta/template[2]", &doc, checker, true) == 0);
+        auto edited = UTAP::Document{};
+        REQUIRE(parseXMLBuffer(model(guard, "E&lt;&gt; P.B"), &edited, true) == 0);
+        CHECK(&doc.getTemplates().back() == &q);
+        REQUIRE(q.edges.size() == 1);
+        CHECK(q.edges.front().guard.toString() == edited.getTemplates().back().edges.front().guard.toString());
+        CHECK(located(doc.getErrors()) == located(edited.getErrors()));
+        CHECK(located(doc.getWarnings()) == located(edited.getWarnings()));
+        failing += !doc.getErrors().empty();
+    }
+    CHECK(failing == 2);  // the assignment and the unknown identifier
+    CHECK(doc.getErrors().empty());
+
+    REQUIRE(reparseXMLElement(query("E&lt;&gt; Q.B"), "/nta/queries/query[2]", &doc, checker, true) == 0);
+    REQUIRE(doc.getQueries().size() == 2);
+    CHECK(doc.getQueries()[0].formula == "A[] true");
+    CHECK(doc.getQueries()[1].formula == "E<> Q.B");
+    CHECK(doc.getQueries()[1].location == "/nta/queries/query[2]/formula");
+
+    // renaming a template or changing its parameters requires a full parse
+    CHECK(reparseXMLElement(templ("R", "true"), "/nta/template[2]", &doc, checker, true) == 1);
+    CHECK(reparseXMLElement(templ("Q", "true"), "/nta/system", &doc, checker, true) == 1);
+    CHECK(q.edges.front().guard.toString() == "x > 0");
+    CHECK(doc.getErrors().empty());
+
+    // the processes have the new local declarations as fields
+    const auto declaring = [&](const std::string& name, const std::string& declarations) {
+        auto res = templ(name, "true");
+        return res.replace(res.find("int n;"), 6, declarations);
+    };
+    REQUIRE(reparseXMLElement(declaring("Q", "int m; int n;"), "/nta/template[2]", &doc, checker, true) == 0);
+    const auto property = UTAP::QueryParser{doc}.parse(UTAP::query_t{"E<> Q.m == 0 && Q.n == 0 && Q.B"});
+    CHECK(property.errors.empty());
+    CHECK(property.expression.toString() == "E<> Q.m == 0 && Q.n == 0 && Q.B");
+
+    // a new local constant is known to be computable at compile time
+    REQUIRE(reparseXMLElement(declaring("Q", "const int K = 2; int[0,K] m; int n;"), "/nta/template[2]", &doc,
+                              checker, true) == 0);
+    CHECK(doc.getErrors().empty());
+
+    // and the fields the system declarations refer to are looked up again
+    auto charted = UTAP::Document{};
+    {
+        auto builder = UTAP::DocumentBuilder{charted};
+        const auto text = "<nta><declaration>int x;</declaration>" + templ("P", "true") + templ("Q", "true") +
+                          "<system>system P, Q;\ngantt { G: Q.n == 1 -&gt; 1; }</system></nta>";
+        REQUIRE(parseXMLBuffer(text.c_str(), &builder, true) == 0);
+    }
+    auto chartChecker = UTAP::IncrementalTypeChecker{charted};
+    chartChecker.check();
+    REQUIRE(charted.getErrors().empty());
+    REQUIRE(reparseXMLElement(declaring("Q", "int m; int n;"), "/nta/template[2]", &charted, chartChecker, true) ==
+            0);
+    CHECK(charted.getErrors().empty());
+    const auto& predicate = charted.getGlobals().ganttChart.front().mapping.front().predicate;
+    CHECK(predicate[0].getIndex() == charted.getTemplates().back().frame.getIndexOf("n"));
+    CHECK(predicate[0][0].getType() == charted.getProcesses().back().uid.getType());
+    CHECK(reparseXMLElement(declaring("Q", "int m;"), "/nta/template[2]", &charted, chartChecker, true) == 1);
+}
+
+TEST_CASE("Compact position table")
+{
+    const auto plainFind = [](const std::vector<UTAP::Positions::line_t>& lines, uint32_t position) {
+        auto it = std::upper_bound(lines.begin(), lines.end(), position,
+                                   [](uint32_t position, const auto& line) { return position < line.position; });
+        return it == lines.begin() ? *it : *(it - 1);
+    };
+    const auto same = [](const UTAP::Positions::line_t& a, const UTAP::Positions::line_t& b) {
+        return a.position == b.position && a.offset == b.offset && a.line == b.line && a.path == b.path;
+    };
+
+    SUBCASE("Lookups")
+    {
+        auto positions = UTAP::Positions{};
+        auto lines = std::vector<UTAP::Positions::line_t>{};
+        auto position = 10u;
+        for (auto element = 0u; element < 300; ++element) {
+            const auto path = "/nta/template[" + std::to_string(element % 17 + 1) + "]/label[" +
+                              std::to_string(element) + "]";
+            auto offset = 0u;
+            auto line = 1u;
+            for (auto i = 0u; i < element % 45; ++i) {
+                lines.emplace_back(position, offset, line, path);
+                positions.add(position, offset, line, path);
+                const auto length = (i * 7919u + element) % 5 == 0 ? 100000u : i % 3;  // long, empty and short lines
+                position += length;
+                offset += length;
+                line += i % 4 == 0 ? 2 : 1;
+            }
+            if (element % 13 == 0) {  // a line which is not the continuation of the previous one
+                lines.emplace_back(position, 3, 7, path);
+                positions.add(position, 3, 7, path);
+            }
+            ++position;
+        }
+        REQUIRE(positions.getSize() == lines.size());
+        const auto decoded = positions.getLines();
+        REQUIRE(decoded.size() == lines.size());
+        CHECK(std::equal(decoded.begin(), decoded.end(), lines.begin(), same));
+        for (auto p = 0u; p < position + 2; p += p < 1000 ? 1 : 997)
+            CHECK(same(positions.find(p), plainFind(lines, p)));
+        for (const auto& line : lines)
+            CHECK(same(positions.find(line.position), plainFind(lines, line.position)));
+        CHECK_THROWS_AS(positions.add(5, 0, 1, ""), std::logic_error);
+    }
+    SUBCASE("Memory usage of a large model")
+    {
+        auto model = std::string{"<nta><declaration>int x;\n</declaration>"};
+        for (auto t = 0; t < 200; ++t) {
+            model += "<template><name>T" + std::to_string(t) + "</name><declaration>";
+            for (auto v = 0; v < 20; ++v)
+                model += "int v" + std::to_string(v) + " = " + std::to_string(v) + ";\n";
+            model += "</declaration><location id=\"l" + std::to_string(t) + "\"/><init ref=\"l" + std::to_string(t) +
+                     "\"/>";
+            for (auto e = 0; e < 20; ++e)
+                model += "<transition><source ref=\"l" + std::to_string(t) + "\"/><target ref=\"l" +
+                         std::to_string(t) + "\"/><label kind=\"guard\">x &gt; " + std::to_string(e) +
+                         "\n&amp;&amp; v1 &lt; 5</label><label kind=\"assignment\">x = v2,\nv3 = 1</label></transition>";
+            model += "</template>";
+        }
+        model += "<system>system ";
+        for (auto t = 0; t < 200; ++t)
+            model += (t > 0 ? ", T" : "T") + std::to_string(t);
+        model += ";</system></nta>";
+        auto doc = UTAP::Document{};
+        REQUIRE(parseXMLBuffer(model, &doc, true) == 0);
+        REQUIRE(doc.getErrors().empty());
+
+        const auto& positions = doc.getPositions();
+        const auto lines = positions.getLines();
+        auto plain = lines.capacity() * sizeof(UTAP::Positions::line_t);
+        for (const auto& line : lines)
+            if (line.path.size() >= sizeof(std::string))  // not stored inline by common implementations
+                plain += line.path.capacity() + 1;
+        MESSAGE(lines.size() << " lines take " << positions.getMemoryUsage() << " bytes instead of " << plain);
+        CHECK(positions.getMemoryUsage() * 4 < plain);
+        for (const auto& line : lines)
+            CHECK(same(positions.find(line.position), plainFind(lines, line.position)));
+    }
+}
+
+TEST_CASE("Source index of expressions and symbols")
+{
+    const auto text = std::string{"int x;\nint f(int a) { return a + x; }\n"
+                                  "process P() { state A; init A; trans A -> A { guard x > 0; assign x = f(x); }; }\n"
+                                  "system P;\n"};
+    auto doc = UTAP::Document{};
+    doc.enableSourceIndex();
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    const auto* index = doc.getSourceIndex();
+    REQUIRE(index != nullptr);
+
+    // positions continue from earlier parses (and the builtin declarations), the text starts at the last first line
+    const auto lines = doc.getPositions().getLines();
+    const auto first = std::find_if(lines.rbegin(), lines.rend(), [](const auto& line) { return line.line == 1; });
+    REQUIRE(first != lines.rend());
+    const auto at = [&](const std::string& needle, size_t skip = 0) {
+        auto offset = text.find(needle);
+        while (skip-- > 0)
+            offset = text.find(needle, offset + 1);
+        REQUIRE(offset != std::string::npos);
+        return static_cast<uint32_t>(first->position - first->offset + offset);
+    };
+
+    const auto& x = *std::find_if(doc.getGlobals().variables.begin(), doc.getGlobals().variables.end(),
+                                  [](const auto& var) { return var.uid.getName() == "x"; });
+    const auto& f = *std::find_if(doc.getGlobals().functions.begin(), doc.getGlobals().functions.end(),
+                                  [](const auto& fun) { return fun.uid.getName() == "f"; });
+    CHECK(index->findSymbol(at("x", 1)) == x.uid);  // in the body of f
+    CHECK(index->findSymbol(at("a +")).getName() == "a");
+    CHECK(index->findSymbol(at("f(x)")) == f.uid);
+    CHECK(index->findSymbol(at("x > 0")) == x.uid);
+    CHECK(index->findExpression(at("x > 0")).toString() == "x");
+    CHECK(index->findExpression(at("> 0")).toString() == "x > 0");
+    CHECK(index->findExpression(at("f(x)") + 2).toString() == "x");
+    CHECK(index->findExpression(at("(x)")).toString() == "f(x)");
+    CHECK(index->findExpression(at("system")).empty());
+
+    // the body of f, the guard, the assignment and its argument
+    const auto& uses = index->getUses(x.uid);
+    REQUIRE(uses.size() == 4);
+    CHECK(std::is_sorted(uses.begin(), uses.end(), [](const auto& a, const auto& b) {
+        return a.getPosition().start < b.getPosition().start;
+    }));
+    CHECK(index->getUses(f.uid).size() == 1);
+    CHECK(index->getUses(index->findSymbol(at("a +"))).size() == 1);
+    CHECK(index->getUses(UTAP::symbol_t{}).empty());
+
+    // builders on several threads may record uses of the same symbol
+    auto threads = std::vector<std::thread>{};
+    auto* shared = doc.getSourceIndex();
+    for (uint32_t t = 0; t < 4; ++t)
+        threads.emplace_back([&, t] {
+            for (uint32_t i = 0, at = 100000 + t; i < 1000; ++i, at += 4)
+                shared->addExpression(UTAP::expression_t::createIdentifier(f.uid, {at, at + 1}));
+        });
+    for (auto& thread : threads)
+        thread.join();
+    CHECK(index->getUses(f.uid).size() == 1 + 4 * 1000);
+    CHECK(index->findSymbol(100000 + 4 * 999 + 3) == f.uid);
+
+    auto plain = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &plain, true));
+    CHECK(plain.getSourceIndex() == nullptr);
+}
+
+TEST_CASE("Cached read and write sets follow edits")
+{
+    const auto text = std::string{"int x, y, z;\nint f() { return y; }\nvoid g(int& r) { r = 1; }\n"
+                                  "process P() { state A; init A; trans A -> A { guard x > f(); assign g(z), x++; }; }\n"
+                                  "system P;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    const auto symbol = [&doc](const std::string& name) {
+        return std::find_if(doc.getGlobals().variables.begin(), doc.getGlobals().variables.end(),
+                            [&name](const auto& var) { return var.uid.getName() == name; })
+            ->uid;
+    };
+    const auto x = symbol("x"), y = symbol("y"), z = symbol("z");
+    auto& edge = doc.getTemplates().front().edges.front();
+    const auto reads = [](const UTAP::expression_t& expr) {
+        auto res = std::set<UTAP::symbol_t>{};
+        expr.collectPossibleReads(res);
+        return res;
+    };
+    const auto writes = [](const UTAP::expression_t& expr) {
+        auto res = std::set<UTAP::symbol_t>{};
+        expr.collectPossibleWrites(res);
+        return res;
+    };
+
+    CHECK(reads(edge.guard).count(x) == 1);
+    CHECK(reads(edge.guard).count(y) == 1);  // through f
+    CHECK(reads(edge.guard).count(z) == 0);
+    CHECK(edge.guard.dependsOn({y}));
+    CHECK_FALSE(edge.guard.changesAnyVariable());
+    CHECK(writes(edge.assign).count(x) == 1);
+    CHECK(writes(edge.assign).count(z) == 1);  // passed by reference
+    CHECK(edge.assign.changesVariable({z}));
+    CHECK_FALSE(edge.assign.changesVariable({y}));
+
+    // the effects of functions are looked up when used, as they may change after the cache was filled
+    auto& f = *std::find_if(doc.getGlobals().functions.begin(), doc.getGlobals().functions.end(),
+                            [](const auto& fun) { return fun.uid.getName() == "f"; });
+    f.changes.insert(z);
+    CHECK(edge.guard.changesVariable({z}));
+    f.changes.clear();
+    CHECK_FALSE(edge.guard.changesAnyVariable());
+
+    // replacing a subexpression through its parent discards the cached sets
+    edge.guard[1] = UTAP::expression_t::createConstant(0);
+    CHECK((reads(edge.guard) == std::set{x}));
+    CHECK_FALSE(edge.guard.dependsOn({y}));
+    edge.guard[0] = UTAP::expression_t::createBinary(UTAP::Constants::ASSIGN, UTAP::expression_t::createIdentifier(y),
+                                                     UTAP::expression_t::createConstant(1));
+    CHECK(edge.guard.changesVariable({y}));
+}
+
+TEST_CASE("Bytecode evaluation of guards and updates")
+{
+    const auto text = std::string{
+        "const int N = 4;\n"
+        "typedef struct { int[0,10] count; bool seen; } entry_t;\n"
+        "int x = 2, a[N] = {1, 2, 3, 4};\n"
+        "entry_t e[2];\n"
+        "int fib(int n) { int a = 0, b = 1; while (n > 0) { int t = a + b; a = b; b = t; n--; } return a; }\n"
+        "void bump(entry_t& entry, int by) { entry.count += by; entry.seen = true; }\n"
+        "int total() { int s = 0; for (i : int[0,N-1]) { if (a[i] != 3) s += a[i]; } return s; }\n"
+        "process P() { state A; init A; trans A -> A { guard x < N && forall (i : int[0,N-1]) a[i] > 0;"
+        " assign bump(e[x % 2], sum (i : int[0,N-1]) a[i]), a[x]++, x = fib(x + 4); }; }\n"
+        "system P;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    auto compiler = UTAP::BytecodeCompiler{};
+    compiler.addVariables(doc.getGlobals().variables);
+    const auto init = compiler.compileInitialiser();
+    const auto& edge = doc.getTemplates().front().edges.front();
+    const auto guard = compiler.compile(edge.guard);
+    const auto assign = compiler.compile(edge.assign);
+    const auto& program = compiler.getProgram();
+    CHECK(program.stateSize == 1 + 4 + 2 * 2);  // N is a constant and not part of the state
+
+    auto state = std::vector<int32_t>(program.stateSize, -1);
+    auto interpreter = UTAP::BytecodeInterpreter{program};
+    interpreter.run(init, state.data());
+    CHECK((state == std::vector<int32_t>{2, 1, 2, 3, 4, 0, 0, 0, 0}));
+    CHECK(interpreter.run(guard, state.data()) == 1);
+    interpreter.run(assign, state.data());
+    CHECK((state == std::vector<int32_t>{8, 1, 2, 4, 4, 10, 1, 0, 0}));
+    CHECK(interpreter.run(guard, state.data()) == 0);
+
+    const auto& functions = doc.getGlobals().functions;
+    const auto total = std::find_if(functions.begin(), functions.end(),
+                                    [](const auto& fun) { return fun.uid.getName() == "total"; });
+    REQUIRE(total != functions.end());
+    state[3] = 3;
+    const auto call = compiler.compile(
+        UTAP::expression_t::createNary(UTAP::Constants::FUNCALL, {UTAP::expression_t::createIdentifier(total->uid)},
+                                       {}, total->uid.getType()[0]));
+    CHECK(interpreter.run(call, state.data()) == 1 + 2 + 4);
+
+    // the count field is an int[0,10] and the index of e is checked
+    state[5] = 9;
+    CHECK_THROWS_AS(interpreter.run(assign, state.data()), UTAP::EvaluationError);
+    state[0] = 3;
+    CHECK(interpreter.run(guard, state.data()) == 1);
+}
+
+TEST_CASE("Bytecode evaluation of the corner cases")
+{
+    const auto text = std::string{
+        "typedef int[-2147483647-1,2147483647] big_t;\n"
+        "big_t r, z = 0, m1 = -1, lo = -2147483647-1, s = 33;\n"
+        "int[0,3] small;\n"
+        "void scale(big_t& v, big_t by) { v = v * by; }\n"
+        "void twice(big_t& v) { scale(v, 2); }\n"
+        "big_t depth(big_t n) { return n == 0 ? 0 : 1 + (n - 1); }\n"
+        "big_t loops() { big_t i, t = 0; for (i = 0; i < 10; i++) { if (i == 2) t; if (i == 5) t; t += i; }"
+        " while (true) { t++; if (t > 100) t; if (t % 2 == 0) t; t += 10; } return t; }\n"
+        "process P() { state A; init A;\n"
+        " trans A -> A { assign r = 7 / z; }, A -> A { assign r = 7 % z; },\n"
+        " A -> A { assign r = lo / m1; }, A -> A { assign r = lo % m1; },\n"
+        " A -> A { assign r = 7 / m1; }, A -> A { assign r = -7 % 2; }, A -> A { assign r = -7 / 2; },\n"
+        " A -> A { assign r = 1 << s; }, A -> A { assign r = 1 << m1; },\n"
+        " A -> A { assign r = lo >> s - 2; }, A -> A { assign r = -8 >> 1; }, A -> A { assign r = 1 >> m1; },\n"
+        " A -> A { assign small = s - 29; }, A -> A { assign small = m1; }, A -> A { assign r = lo - 1; },\n"
+        " A -> A { assign twice(s); }, A -> A { assign r = depth(1000); }, A -> A { assign r = depth(200000); },\n"
+        " A -> A { assign r = loops(); }; }\n"
+        "system P;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+
+    // the grammar has neither recursion nor break and continue, thus they are patched into the bodies
+    auto& functions = doc.getGlobals().functions;
+    const auto function = [&](const std::string& name) -> UTAP::function_t& {
+        const auto it = std::find_if(functions.begin(), functions.end(),
+                                     [&](const auto& fun) { return fun.uid.getName() == name; });
+        REQUIRE(it != functions.end());
+        return *it;
+    };
+    auto& depth = function("depth");
+    auto* ret = dynamic_cast<UTAP::ReturnStatement*>(std::prev(depth.body->end())->get());
+    REQUIRE(ret != nullptr);
+    const auto sum = ret->value[2];
+    const auto call = UTAP::expression_t::createNary(
+        UTAP::Constants::FUNCALL, {UTAP::expression_t::createIdentifier(depth.uid), sum[1]}, {},
+        sum.getType());
+    ret->value = UTAP::expression_t::createTernary(
+        UTAP::Constants::INLINEIF, ret->value[0], ret->value[1],
+        UTAP::expression_t::createBinary(UTAP::Constants::PLUS, sum[0], call, {}, sum.getType()), {},
+        ret->value.getType());
+    auto& loops = *function("loops").body;
+    const auto jump = [&](size_t loop, size_t stat, auto statement) {
+        auto* block = static_cast<UTAP::BlockStatement*>(
+            loop == 0 ? dynamic_cast<UTAP::ForStatement&>(**loops.begin()).stat.get()
+                      : dynamic_cast<UTAP::WhileStatement&>(**std::next(loops.begin())).stat.get());
+        dynamic_cast<UTAP::IfStatement&>(**std::next(block->begin(), stat)).trueCase = std::move(statement);
+    };
+    jump(0, 0, std::make_unique<UTAP::ContinueStatement>());
+    jump(0, 1, std::make_unique<UTAP::BreakStatement>());
+    jump(1, 1, std::make_unique<UTAP::BreakStatement>());
+    jump(1, 2, std::make_unique<UTAP::ContinueStatement>());
+
+    auto compiler = UTAP::BytecodeCompiler{};
+    compiler.addVariables(doc.getGlobals().variables);
+    const auto init = compiler.compileInitialiser();
+    auto updates = std::vector<uint32_t>{};
+    for (const auto& edge : doc.getTemplates().front().edges)
+        updates.push_back(compiler.compile(edge.assign));
+    REQUIRE(updates.size() == 19);
+    const auto& program = compiler.getProgram();
+    CHECK(program.stateSize == 6);
+
+    auto interpreter = UTAP::BytecodeInterpreter{program};
+    auto state = std::vector<int32_t>(program.stateSize);
+    const auto run = [&](size_t update) {
+        interpreter.run(init, state.data());
+        interpreter.run(updates[update], state.data());
+        return state[0];
+    };
+    constexpr auto int_min = std::numeric_limits<int32_t>::min();
+
+    // division by zero is an error, dividing the smallest value by -1 wraps around
+    CHECK_THROWS_AS(run(0), UTAP::EvaluationError);
+    CHECK_THROWS_AS(run(1), UTAP::EvaluationError);
+    CHECK(run(2) == int_min);
+    CHECK(run(3) == 0);
+    CHECK(run(4) == -7);
+    CHECK(run(5) == -1);
+    CHECK(run(6) == -3);
+
+    // only the lowest five bits of the shift amount are used
+    CHECK(run(7) == 2);
+    CHECK(run(8) == int_min);
+    CHECK(run(9) == -1);
+    CHECK(run(10) == -4);
+    CHECK(run(11) == 0);
+
+    // assignments check the range of the target
+    CHECK_THROWS_AS(run(12), UTAP::EvaluationError);
+    CHECK_THROWS_AS(run(13), UTAP::EvaluationError);
+    CHECK(run(14) == std::numeric_limits<int32_t>::max());  // the arithmetic itself wraps around
+    run(3);
+    CHECK(state[5] == 0);
+
+    // a reference parameter passed on writes through to the state
+    run(15);
+    CHECK(state[4] == 66);
+
+    CHECK(run(16) == 1000);
+    CHECK_THROWS_AS(run(17), UTAP::EvaluationError);
+    CHECK(run(18) == 104);
+}
+
+TEST_CASE("Bytecode compilation of unsupported constructs")
+{
+    const auto text = std::string{
+        "clock c; double d; int y;\n"
+        "void pick() { y = 1; }\n"
+        "process P() { state A; init A;\n"
+        " trans A -> A { guard c > 1; }, A -> A { assign d = 1.5; }, A -> A { assign pick(); },"
+        " A -> A { assign y = 1; }; }\n"
+        "system P;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    auto& pick = *doc.getGlobals().functions.front().body;
+    auto& assign = dynamic_cast<UTAP::ExprStatement&>(**pick.begin());
+    *pick.begin() = std::make_unique<UTAP::SwitchStatement>(UTAP::frame_t::createFrame(), assign.expr[0]);
+
+    auto compiler = UTAP::BytecodeCompiler{};
+    compiler.addVariables(doc.getGlobals().variables);
+    CHECK(compiler.getProgram().stateSize == 1);
+    auto edge = doc.getTemplates().front().edges.begin();
+    CHECK_THROWS_AS(compiler.compile((edge++)->guard), UTAP::BytecodeError);
+    CHECK_THROWS_AS(compiler.compile((edge++)->assign), UTAP::BytecodeError);
+    CHECK_THROWS_AS(compiler.compile((edge++)->assign), UTAP::BytecodeError);
+    CHECK_NOTHROW(compiler.compile(edge->assign));
+}
+
+TEST_CASE("Range analysis of the reachable values")
+{
+    const auto text = std::string{
+        "const int N = 3;\n"
+        "int x, total, w;\n"
+        "int[0,5] a[N];\n"
+        "bool flag;\n"
+        "int v = 6, m = -7, r, u;\n"
+        "int accumulate(int n) { int s = 0; for (i : int[0,N-1]) s += a[i]; return s + n; }\n"
+        "void bump(int[0,5]& v) { if (v < 4) v++; else v = 0; }\n"
+        "int clamp(int v) { while (v > 20) v = v - 7; return v; }\n"
+        "process P(const int[1,2] step) {\n"
+        "    int[0,100] n;\n"
+        "    int k = 2;\n"
+        "    state A, B { n <= 6 };\n"
+        "    init A;\n"
+        "    trans A -> A { guard x < 10; assign x++; },\n"
+        "          A -> B { guard n < 5; assign n = n + step, bump(a[1]), total = accumulate(1); },\n"
+        "          B -> A { assign flag = true, w = clamp(k * 30), r = v % 4, u = m % 3; };\n"
+        "}\n"
+        "P1 = P(1);\n"
+        "system P1;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    const auto analysis = UTAP::RangeAnalysis{doc};
+    const auto global = [&](const std::string& name) {
+        const auto& frame = doc.getGlobals().frame;
+        return analysis.getRange(frame[frame.getIndexOf(name)]);
+    };
+    using range_t = UTAP::RangeAnalysis::range_type;
+    CHECK(global("N") == 3);
+    CHECK(global("x") == range_t(0, 10));
+    CHECK(global("total") == range_t(0, 5));  // a[1] is at most 4 when summed
+    CHECK(global("w") == range_t(0, 20));
+    CHECK(global("flag") == range_t(0, 1));
+    // Dividends reaching the divisor, from above and from below zero
+    CHECK(global("r") == range_t(0, 3));
+    CHECK(global("u") == range_t(-2, 0));
+    const auto& frame = doc.getGlobals().frame;
+    const auto* a = analysis.getElements(frame[frame.getIndexOf("a")]);
+    REQUIRE(a != nullptr);
+    CHECK((*a == UTAP::RangeAnalysis::elements_t{range_t(0), range_t(0, 4), range_t(0)}));
+
+    const auto& process = doc.getProcesses().front();
+    const auto local = [&](const std::string& name) {
+        const auto& locals = process.templ->frame;
+        return analysis.getRange(process, locals[locals.getIndexOf(name)]);
+    };
+    CHECK(local("n") == range_t(0, 5));  // n is increased by 1 while below 5
+    CHECK(local("k") == 2);
+    CHECK(local("step") == 1);
+    CHECK(analysis.getElements(process, doc.getGlobals().frame[0]) == nullptr);
+}
+
+TEST_CASE("Bit-packed state layout")
+{
+    const auto text = std::string{
+        "const int N = 2;\n"
+        "int[0,5] a[N];\n"
+        "bool flag;\n"
+        "int x, y[2];\n"
+        "typedef scalar[3] id_t;\n"
+        "process P(const id_t id) {\n"
+        "    int[0,100] n;\n"
+        "    clock c;\n"
+        "    state A; init A;\n"
+        "    trans A -> A { guard n < 7; assign n++, flag = !flag; };\n"
+        "}\n"
+        "process R(int[-4,3] v) { state A; init A; }\n"
+        "R1 = R(-1);\n"
+        "system P, R1;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    const auto declared = UTAP::StateLayout{doc};
+    const auto& globals = doc.getGlobals().frame;
+    const auto global = [&](const UTAP::StateLayout& layout, const std::string& name) {
+        return layout.find(globals[globals.getIndexOf(name)]);
+    };
+    CHECK(global(declared, "N") == nullptr);
+    const auto* a = global(declared, "a");
+    REQUIRE(a != nullptr);
+    REQUIRE(a->fields.size() == 2);
+    CHECK(a->fields[0].width == 3);
+    CHECK(global(declared, "flag")->fields[0].width == 1);
+    CHECK(global(declared, "x")->fields[0].width == 16);  // int is int[-32768,32767]
+
+    const auto& processes = doc.getProcesses();
+    REQUIRE(processes.size() == 2);
+    const auto& set = processes.front();
+    const auto& locals = set.templ->frame;
+    const auto* n = declared.find(set, locals[locals.getIndexOf("n")]);
+    REQUIRE(n != nullptr);
+    CHECK(n->instances == 3);
+    CHECK(n->fields.size() == 3);
+    CHECK(n->fields[0].width == 7);
+    CHECK(declared.find(set, set.templ->parameters[0]) == nullptr);  // id is constant
+    CHECK(declared.find(set, locals[locals.getIndexOf("c")]) == nullptr);
+    const auto& r1 = processes.back();
+    const auto* v = declared.find(r1, r1.templ->parameters[0]);
+    REQUIRE(v != nullptr);
+    CHECK(v->instances == 1);
+    CHECK(v->fields[0].lower == -4);
+    CHECK(v->fields[0].width == 3);
+    CHECK(declared.getBits() == 2 * 3 + 1 + 3 * 16 + 3 * 7 + 3);
+    CHECK(declared.getWords() == 2);
+    for (const auto& variable : declared.getVariables())
+        for (const auto& field : variable.fields)
+            CHECK(field.offset / 64 == (field.offset + field.width - 1) / 64);  // no field straddles a word
+
+    auto state = std::vector<uint64_t>(declared.getWords());
+    const auto value = [](const UTAP::StateLayout::field_t& field) { return field.lower + (field.width > 1 ? 2 : 1); };
+    for (const auto& variable : declared.getVariables())
+        for (const auto& field : variable.fields)
+            UTAP::StateLayout::set(state.data(), field, value(field));
+    UTAP::StateLayout::set(state.data(), a->fields[1], 5);
+    CHECK(UTAP::StateLayout::get(state.data(), a->fields[1]) == 5);
+    CHECK(UTAP::StateLayout::get(state.data(), a->fields[0]) == 2);
+    CHECK(UTAP::StateLayout::get(state.data(), v->fields[0]) == -2);
+    for (const auto& variable : declared.getVariables())
+        for (const auto& field : variable.fields)
+            if (&field != &a->fields[1])
+                CHECK(UTAP::StateLayout::get(state.data(), field) == value(field));
+
+    const auto analysed = UTAP::StateLayout{doc, UTAP::RangeAnalysis{doc}};
+    CHECK(global(analysed, "a")->fields[0].width == 0);
+    CHECK(analysed.find(set, locals[locals.getIndexOf("n")])->fields[0].width == 3);  // n is at most 7
+    CHECK(analysed.find(r1, r1.templ->parameters[0])->fields[0].lower == -1);
+    CHECK(analysed.getBits() == 1 + 3 * 3);
+    CHECK(analysed.getWords() == 1);
+}
+
+TEST_CASE("Removing unread variables, unused functions and disabled edges")
+{
+    const auto text = std::string{
+        "const int N = 2;\n"
+        "const bool debug = false;\n"
+        "int x, used, y, z[N], last;\n"
+        "clock c, reset;\n"
+        "void record(int v) { last = v; z[0] = last; }\n"
+        "int twice(int v) { return 2 * v; }\n"
+        "int helper() { return 1; }\n"
+        "int queried() { return 2; }\n"
+        "process P(const int id) {\n"
+        "    int local, keep;\n"
+        "    void trace() { local++; }\n"
+        "    state A { c <= 5 }, B;\n"
+        "    init A;\n"
+        "    trans A -> B { guard debug && x > 0; assign x = 1; },\n"
+        "          A -> B { guard id == 2; assign x = helper(); },\n"
+        "          A -> B { guard twice(x) < 4 && c >= 1;\n"
+        "                   assign x++, y = x, local = 3, reset = 0, record(x), used = keep; },\n"
+        "          B -> A { guard used < 2; assign trace(); };\n"
+        "}\n"
+        "P1 = P(1);\n"
+        "system P1;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    doc.addQuery({"E<> queried() == 2"});
+    const auto variables = doc.getGlobals().variables.size();
+    const auto reduction = UTAP::ModelReduction{doc};
+    auto removed = std::vector<std::string>{};
+    for (const auto& removal : reduction.getRemovals())
+        removed.push_back(std::to_string(removal.kind) + " " + removal.name);
+    CHECK((removed == std::vector<std::string>{"0 P: A -> B", "0 P: A -> B", "1 y", "1 z", "1 last", "1 reset",
+                                               "1 P.local", "2 helper"}));
+
+    const auto& globals = doc.getGlobals();
+    CHECK(globals.frame.getIndexOf("y") == -1);
+    CHECK(globals.frame.getIndexOf("x") != -1);
+    CHECK(globals.frame.getIndexOf("queried") != -1);
+    CHECK(globals.variables.size() == variables - 4);
+    const auto& templ = doc.getTemplates().front();
+    REQUIRE(templ.edges.size() == 2);
+    CHECK(templ.edges[0].assign.toString() == "x++, record(x), used = keep");
+    CHECK(templ.edges[1].assign.toString() == "trace()");
+    const auto& record = globals.functions.front();
+    CHECK(record.uid.getName() == "record");
+    CHECK(record.changes.empty());
+    CHECK(record.body->toString("").find("last") == std::string::npos);
+
+    // A local read through a field of its process is kept, and the fields are looked up in the reduced frame
+    auto charted = UTAP::Document{};
+    REQUIRE(parseXTA("process P() {\n"
+                     "    int a, b;\n"
+                     "    state A;\n"
+                     "    init A;\n"
+                     "    trans A -> A { assign a = 1, b = b + 1; };\n"
+                     "}\n"
+                     "Q = P();\n"
+                     "system Q;\n"
+                     "gantt { G: Q.b == 1 -> 1; }\n",
+                     &charted, true));
+    REQUIRE(charted.getErrors().empty());
+    const auto reduced = UTAP::ModelReduction{charted};
+    REQUIRE(reduced.getRemovals().size() == 1);
+    CHECK(reduced.getRemovals().front().name == "P.a");
+    const auto& locals = charted.getTemplates().front().frame;
+    const auto field = charted.getGlobals().ganttChart.front().mapping.front().predicate[0];
+    CHECK(field.getIndex() == locals.getIndexOf("b"));
+    CHECK(field[0].getType().size() == locals.getSize());
+    CHECK(charted.getTemplates().front().edges.front().assign.toString() == "b = b + 1");
+}
+
+TEST_CASE("Constant folding and inlining")
+{
+    const auto text = std::string{
+        "const int N = 3;\n"
+        "const bool enabled = true;\n"
+        "int x, y, a[N];\n"
+        "int twice(int v) { return 2 * v; }\n"
+        "bool small(int v) { return v < N; }\n"
+        "void reset(int& v) { v = 0; y++; }\n"
+        "void swap() { int t = x; x = y; y = t; }\n"
+        "void bad(int& v) { y = 1; v = 2; }\n"
+        "process P() {\n"
+        "    state A { x <= N * 2 };\n"
+        "    init A;\n"
+        "    trans A -> A { guard enabled && small(x) && a[N - 1] < twice(N);\n"
+        "                   assign reset(a[N - 2]), x = twice(x), swap(), bad(a[y]); };\n"
+        "}\n"
+        "system P;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    auto& templ = doc.getTemplates().front();
+    // The checker adds the true conjunct
+    const auto bound = templ.states.front().invariant[1][1].getPosition();
+    auto simplifier = UTAP::Simplifier{doc};
+    simplifier.simplifyTemplates();
+    const auto& invariant = templ.states.front().invariant;
+    CHECK(invariant.toString() == "x <= 6");
+    CHECK(invariant[1].getPosition().start == bound.start);
+    CHECK(invariant[1].getPosition().end == bound.end);
+    const auto& edge = templ.edges.front();
+    CHECK(edge.guard.toString() == "x < 3 && a[2] < 6");
+    // bad writes y, which its argument reads
+    CHECK(edge.assign.toString() == "a[1] = 0, y++, x = 2 * x, swap(), bad(a[y])");
+    CHECK(simplifier.getInlined() == 4);  // small, reset and both calls of twice
+
+    // Conjunctions, disjunctions and conditionals with constant operands
+    const auto& frame = doc.getGlobals().frame;
+    const auto x = UTAP::expression_t::createIdentifier(frame[frame.getIndexOf("x")]);
+    const auto enabled = UTAP::expression_t::createIdentifier(frame[frame.getIndexOf("enabled")]);
+    const auto boolean = UTAP::type_t::createPrimitive(UTAP::Constants::BOOL);
+    const auto negated = UTAP::expression_t::createUnary(UTAP::Constants::NOT, enabled, {}, boolean);
+    const auto less = UTAP::expression_t::createBinary(UTAP::Constants::LT, x, UTAP::expression_t::createConstant(1), {},
+                                                       boolean);
+    CHECK(simplifier.simplify(UTAP::expression_t::createBinary(UTAP::Constants::OR, less, negated, {}, boolean))
+              .toString() == "x < 1");
+    CHECK(simplifier.simplify(UTAP::expression_t::createBinary(UTAP::Constants::OR, less, enabled, {}, boolean))
+              .toString() == "true");
+    CHECK(simplifier.simplify(UTAP::expression_t::createTernary(UTAP::Constants::INLINEIF, negated, x, less, {},
+                                                                boolean)).toString() == "x < 1");
+
+    // A conjunction or disjunction decided by one integer operand still yields 0 or 1
+    auto mixed = UTAP::Document{};
+    REQUIRE(parseXTA("const bool T = true;\n"
+                     "int x = 5, y, z;\n"
+                     "bool b, flag;\n"
+                     "process P() {\n"
+                     "    state A;\n"
+                     "    init A;\n"
+                     "    trans A -> A { assign y = T && x, z = x || false, b = T && flag; };\n"
+                     "}\n"
+                     "system P;\n",
+                     &mixed, true));
+    REQUIRE(mixed.getErrors().empty());
+    UTAP::Simplifier{mixed}.simplifyTemplates();
+    CHECK(mixed.getTemplates().front().edges.front().assign.toString() == "y = x != 0, z = x != 0, b = flag");
+}
+
+TEST_CASE("Streaming the document as CBOR and JSON")
+{
+    const auto text = std::string{
+        "int g;\n"
+        "double d = 1.5;\n"
+        "process P() {\n"
+        "  state s;\n"
+        "  init s;\n"
+        "  trans s -> s { guard g < 3; assign g = g + 1; };\n"
+        "}\n"
+        "system P;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+
+    auto chunks = std::vector<std::string>{};
+    auto sink = [&](std::string_view chunk) { chunks.emplace_back(chunk); };
+    UTAP::CBORWriter{sink, UTAP::CBORWriter::JSON, 128}.write(doc);
+    REQUIRE(chunks.size() > 1);
+    auto json = std::string{};
+    for (const auto& chunk : chunks) {
+        CHECK(chunk.size() < 256);
+        json += chunk;
+    }
+    CHECK(json.rfind("[{\"record\":\"document\",\"version\":1,", 0) == 0);
+    CHECK(json.find("\"initialiser\":[") != std::string::npos);
+    CHECK(json.find(",1.5]") != std::string::npos);  // the operand of the double constant
+    const auto g = json.find("\"name\":\"g\"");
+    const auto edge = json.find("{\"record\":\"edge\"");
+    REQUIRE(g != std::string::npos);
+    REQUIRE(edge != std::string::npos);
+    CHECK(g < edge);  // symbols are defined before they are referred to
+    CHECK(json.find("\"record\":\"process\"") > edge);
+
+    auto cbor = std::ostringstream{};
+    CHECK(writeCBOR(cbor, &doc) == 0);
+    const auto binary = cbor.str();
+    REQUIRE(binary.size() > 5);
+    CHECK(binary.substr(0, 4) == "\xd9\xd9\xf7\x9f");  // the self-described tag and an open array
+    CHECK(binary.back() == '\xff');
+    CHECK(binary.size() < json.size());
+}
+
+TEST_CASE("Looking up many XML elements at once")
+{
+    const auto xml = std::string{
+        "<?xml version=\"1.0\"?><nta><declaration>int g;</declaration>"
+        "<template><name>A</name><location id=\"a0\"/><init ref=\"a0\"/></template>"
+        "<template><name>B</name><parameter>int &amp;p</parameter><location id=\"b0\"/><init ref=\"b0\"/>"
+        "<transition><source ref=\"b0\"/><target ref=\"b0\"/><label kind=\"guard\">g &lt; 2</label>"
+        "<label kind=\"assignment\">g++</label></transition></template>"
+        "<system>system A, B;</system></nta>"};
+    auto elements = UTAP::XMLElements{xml};
+    REQUIRE(elements.isValid());
+    const auto paths = std::vector<std::string>{"/nta/template[2]/transition[1]/label[2]",
+                                                "/nta/declaration",
+                                                "/nta/template[1]/name",
+                                                "/nta/template[3]/name",
+                                                "/nta/template[2]/transition[1]/label[1]",
+                                                "/nta/template[2]/transition/label[2]",
+                                                "//template[name='B']/parameter",
+                                                "/nta/system"};
+    const auto texts = elements.get(paths);
+    CHECK((texts == std::vector<std::string_view>{"g++", "int g;", "A", "", "g < 2", "g++", "int &p",
+                                                  "system A, B;"}));
+    const auto again = elements.get({"/nta/template[2]/name"});
+    REQUIRE(again.size() == 1);
+    CHECK(again[0] == "B");
+    CHECK(texts[0] == "g++");  // the earlier texts are kept
+}
+
+TEST_CASE("Lexing keywords, builtins and type names")
+{
+    const auto text = std::string{
+        "double d = sqrt(2.0) + fmax(1.0, random_weibull(1.0, 2.0));\n"
+        "process P() {\n"
+        "    typedef int[0,1] bit;\n"
+        "    bit b;\n"
+        "    state A;\n"
+        "    init A;\n"
+        "}\n"
+        "const int bit = 1;\n"  // the type name of P is an identifier outside of it
+        "process Q() {\n"
+        "    const int c = bit;\n"
+        "    typedef bool bit;\n"  // and a type name again once declared here
+        "    bit e = c == 1 xor true;\n"
+        "    state A;\n"
+        "    init A;\n"
+        "}\n"
+        "system P, Q;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    CHECK(doc.getErrors().empty());
+    const auto& templates = doc.getTemplates();
+    REQUIRE(templates.size() == 2);
+    const auto& p = templates.front().frame;
+    const auto& q = templates.back().frame;
+    CHECK(p[p.getIndexOf("b")].getType().isIntegral());
+    CHECK(q[q.getIndexOf("c")].getType().isIntegral());
+    CHECK(q[q.getIndexOf("e")].getType().isBoolean());
+    CHECK(doc.getGlobals().frame.getIndexOf("bit") != -1);
+
+    // the type names are kept per document
+    auto types = UTAP::Document{};
+    REQUIRE(parseXTA("typedef int T;\nT t;\nprocess P() { state A; init A; }\nsystem P;\n", &types, true));
+    auto values = UTAP::Document{};
+    REQUIRE(parseXTA("const int T = 1;\nint u = T;\nprocess P() { state A; init A; }\nsystem P;\n", &values, true));
+    CHECK(types.getErrors().empty());
+    CHECK(values.getErrors().empty());
+}
+
+TEST_CASE("Splitting guards and invariants into clock constraints")
+{
+    const auto text = std::string{
+        "const int N = 4;\n"
+        "clock x, y;\n"
+        "int n;\n"
+        "process P(const int d) {\n"
+        "    clock z;\n"
+        "    state A { x <= 5 && z < d && n > 0 }, B { x' == 0 && y <= 3 };\n"
+        "    init A;\n"
+        "    trans A -> B { guard 2 < x && x - y <= N && n == 1 && z == 3 && (x < 1 || n > 2); };\n"
+        "}\n"
+        "Q = P(2);\n"
+        "system Q;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    auto& templ = doc.getTemplates().front();
+    const auto constraint = [](const UTAP::constraint_form_t& form, size_t k) {
+        const auto& c = form.constraints[k];
+        const auto name = [&](uint32_t i) { return i == 0 ? std::string{"0"} : form.clocks[i].toString(); };
+        return name(c.i) + " - " + name(c.j) + (c.strict ? " < " : " <= ") + c.bound.toString();
+    };
+
+    const auto& a = templ.states[0].getInvariantForm();
+    REQUIRE(a.constraints.size() == 2);
+    CHECK(constraint(a, 0) == "x - 0 <= 5");
+    CHECK(constraint(a, 1) == "z - 0 < d");
+    CHECK(a.data.toString() == "n > 0");
+    CHECK(a.isConvex());
+    CHECK(&templ.states[0].getInvariantForm() == &a);  // cached
+
+    const auto& b = templ.states[1].getInvariantForm();
+    REQUIRE(b.constraints.size() == 1);
+    CHECK(constraint(b, 0) == "y - 0 <= 3");
+    CHECK(b.data.toString() == "true");
+    REQUIRE(b.others.size() == 1);  // the rate
+    CHECK_FALSE(b.isConvex());
+
+    auto& edge = templ.edges.front();
+    const auto& guard = edge.getGuardForm();
+    REQUIRE(guard.constraints.size() == 4);
+    CHECK(constraint(guard, 0) == "0 - x < -2");
+    CHECK(constraint(guard, 1) == "x - y <= N");
+    CHECK(constraint(guard, 2) == "z - 0 <= 3");
+    CHECK(constraint(guard, 3) == "0 - z <= -3");
+    CHECK(guard.clocks.size() == 4);  // the reference clock, x, y and z
+    CHECK(guard.data.toString() == "n == 1");
+    REQUIRE(guard.others.size() == 1);
+    CHECK(guard.others.front().toString() == "x < 1 || n > 2");
+
+    // A new guard is split again
+    edge.guard = edge.guard[0][0];
+    CHECK(edge.getGuardForm().constraints.size() == 2);
+}
+
+TEST_CASE("Static independence of edges")
+{
+    const auto text = std::string{
+        "int x, y, z;\n"
+        "chan c;\n"
+        "process P(int& v) {\n"
+        "    int l;\n"
+        "    state A, B;\n"
+        "    init A;\n"
+        "    trans A -> B { guard x > 0; assign l = 1; }, B -> A { sync c!; assign v = 2; };\n"
+        "}\n"
+        "process Q() {\n"
+        "    state A;\n"
+        "    init A;\n"
+        "    trans A -> A { assign x = 1; }, A -> A { sync c?; }, A -> A { assign z = 1; };\n"
+        "}\n"
+        "P1 = P(y);\n"
+        "P2 = P(z);\n"
+        "system P1, P2, Q;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    const auto relation = UTAP::Independence{doc};
+    REQUIRE(relation.getEdges().size() == 7);
+    const auto& q = doc.getProcesses().back();
+    CHECK(relation.getEdgeNr(q, q.templ->edges[1]) == 5);
+    CHECK(relation.getEdges()[5].processNr == 2);
+
+    CHECK_FALSE(relation.isIndependent(0, 1));  // the same process
+    CHECK_FALSE(relation.isIndependent(4, 5));
+    CHECK_FALSE(relation.isIndependent(2, 2));
+    CHECK(relation.isIndependent(0, 2));  // both read x, l is local
+    CHECK_FALSE(relation.isIndependent(4, 0));
+    CHECK_FALSE(relation.isIndependent(2, 4));
+    CHECK_FALSE(relation.isIndependent(1, 3));  // c
+    CHECK_FALSE(relation.isIndependent(5, 1));
+    CHECK_FALSE(relation.isIndependent(3, 6));  // z, through the parameter of P2
+    CHECK(relation.isIndependent(1, 6));
+    CHECK(relation.isIndependent(6, 0));
+    CHECK(relation.isIndependent(1, 4));
+    CHECK((relation.getDependent(6) == std::vector<uint32_t>{3, 4, 5}));
+    CHECK(relation.getDependentPairs() == 11);
+}
+
+TEST_CASE("Symbols are numbered per document")
+{
+    const auto text = std::string{
+        "int x, y;\n"
+        "void f() { x = y; }\n"
+        "process P(int& v, const int n) {\n"
+        "    int a[n];\n"
+        "    state A;\n"
+        "    init A;\n"
+        "    trans A -> A { assign f(), v = 1; };\n"
+        "}\n"
+        "P1 = P(y, 2);\n"
+        "system P1;\n"};
+    auto first = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &first, true));
+    auto second = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &second, true));
+    auto numbers = std::vector<std::vector<uint32_t>>{};
+    for (auto* doc : {&first, &second}) {
+        auto& ids = numbers.emplace_back();
+        for (const auto& symbol : doc->getGlobals().frame)
+            ids.push_back(symbol.getId());
+        const auto& templ = doc->getTemplates().front();
+        for (const auto& symbol : templ.frame)
+            ids.push_back(symbol.getId());
+        CHECK(std::set<uint32_t>(ids.begin(), ids.end()).size() == ids.size());
+
+        const auto& fun = doc->getGlobals().functions.front();
+        CHECK(fun.changeSet == UTAP::symbol_set_t{fun.changes});
+        CHECK(fun.dependSet == UTAP::symbol_set_t{fun.depends});
+        CHECK(fun.changeSet.contains(doc->getGlobals().frame[doc->getGlobals().frame.getIndexOf("x")]));
+        CHECK(templ.restrictedSet == UTAP::symbol_set_t{templ.restricted});
+        CHECK(templ.restrictedSet.contains(templ.parameters[1]));
+        CHECK_FALSE(templ.restrictedSet.contains(templ.parameters[0]));
+    }
+    CHECK(numbers[0] == numbers[1]);  // the symbols of the first document do not take identifiers of the second
+}
+
+TEST_CASE("Builder errors are reported without exceptions")
+{
+    const auto text = std::string{
+        "typedef int T;\n"
+        "typedef int T;\n"
+        "int x = y;\n"
+        "process P() { state A; init A; trans A -> A { guard z > 0; }; }\n"
+        "system P, R;\n"};
+    auto doc = UTAP::Document{};
+    doc.reserveDiagnostics(16, 4);
+    CHECK_FALSE(parseXTA(text.c_str(), &doc, true));
+    auto codes = std::vector<std::string>{};
+    for (const auto& error : doc.getErrors())
+        codes.emplace_back(error.getCode());
+    const auto has = [&](const char* code) { return std::find(codes.begin(), codes.end(), code) != codes.end(); };
+    CHECK(has("$Duplicate_definition_of"));
+    CHECK(has("$Unknown_identifier"));
+    CHECK(has("$No_such_process"));
+    CHECK(std::count(codes.begin(), codes.end(), "$Unknown_identifier") == 2);  // y and z
+    const auto positions = doc.getErrors().front().position;
+    CHECK(positions.start < positions.end);
+
+    auto constructed = doc.getErrors().front();
+    constructed.msg = "v $shadows_a_variable";
+    CHECK(constructed.getCode() == "$shadows_a_variable");
+    constructed.msg = "Template referenced before used";
+    CHECK(constructed.getCode().empty());
+}
+
+static const char* const signalFlowModel =
+    "chan go, done[2];\n"
+    "int x, y, z;\n"
+    "void reset() { y = 0; }\n"
+    "process Sender(int& v) { state A, B; init A; trans A -> B { sync go!; assign v = x; },"
+    " B -> A { guard z > 0; sync done[1]?; assign reset(); }; }\n"
+    "process Receiver() { state A; init A; trans A -> A { guard y < x; sync go?; assign z++; }; }\n"
+    "S = Sender(x);\n"
+    "system S, Receiver;\n";
+
+TEST_CASE("Signal flow graph")
+{
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(signalFlowModel, &doc, true));
+    const auto flow = UTAP::SignalFlow{"test", doc};
+    const auto& graph = flow.getGraph();
+    CHECK((graph.processes == std::vector<std::string>{"S", "Receiver"}));
+    CHECK((graph.channels == std::vector<std::string>{"done[1]", "go"}));
+    CHECK((graph.variables == std::vector<std::string>{"x", "y", "z"}));
+    const auto list = [](const UTAP::SignalFlow::adjacency_t& adjacency, uint32_t i) {
+        return std::vector<uint32_t>(adjacency.begin(i), adjacency.end(i));
+    };
+    const auto none = UTAP::SignalFlow::graph_t::noChannel;
+    CHECK((list(graph.inputs, 0) == std::vector<uint32_t>{0}));
+    CHECK((list(graph.outputs, 0) == std::vector<uint32_t>{1}));
+    CHECK((list(graph.reads, 0) == std::vector<uint32_t>{0, 2}));  // x is read on go, z in a guard
+    CHECK((list(graph.readChannels, graph.reads.offsets[0]) == std::vector<uint32_t>{1}));
+    CHECK((list(graph.readChannels, graph.reads.offsets[0] + 1) == std::vector<uint32_t>{none}));
+    CHECK((list(graph.writes, 0) == std::vector<uint32_t>{0, 1}));  // x through the parameter and y in reset
+    CHECK((list(graph.receivers, 1) == std::vector<uint32_t>{1}));
+    CHECK((list(graph.transmitters, 1) == std::vector<uint32_t>{0}));
+    CHECK((list(graph.readers, 0) == std::vector<uint32_t>{0, 1}));
+    CHECK((list(graph.writers, 2) == std::vector<uint32_t>{1}));
+
+    // the printers list the processes in the order of their addresses, so the threads are compared on the graph
+    const auto summary = [&doc](uint32_t threads) {
+        const auto flow = UTAP::SignalFlow{"test", doc, threads};
+        const auto& g = flow.getGraph();
+        auto res = std::vector<std::vector<uint32_t>>{};
+        for (const auto* adjacency : {&g.inputs, &g.outputs, &g.reads, &g.writes, &g.readChannels, &g.writeChannels,
+                                      &g.receivers, &g.transmitters, &g.readers, &g.writers}) {
+            res.push_back(adjacency->offsets);
+            res.push_back(adjacency->targets);
+        }
+        return std::make_tuple(g.processes, g.channels, g.variables, res);
+    };
+    CHECK(summary(0) == summary(4));
+}
+
+TEST_CASE("Distances over the signal flow graph")
+{
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(signalFlowModel, &doc, true));
+    auto calculator = UTAP::DistanceCalculator{"test", doc};
+    // S reads x and z, Receiver reads x, y and z and receives from S, x and y are written by S and z by Receiver
+    const auto S = calculator.getNode("S"), receiver = calculator.getNode("Receiver"), y = calculator.getNode("y");
+    REQUIRE(calculator.getNodeCount() == 5);
+    CHECK(calculator.getNode("go") == UTAP::DistanceCalculator::unreachable);
+    const auto hops = calculator.getHops(std::vector<uint32_t>{S, receiver, y});
+    REQUIRE(hops.size() == 3);
+    CHECK((hops[0] == std::vector<uint32_t>{0, 2, 1, 3, 1}));
+    CHECK((hops[1] == std::vector<uint32_t>{1, 0, 1, 1, 1}));
+    CHECK((hops[2] == std::vector<uint32_t>{1, 3, 2, 0, 2}));
+    CHECK(calculator.getHops(UTAP::SignalFlow::strset_t{"Receiver", "S", "nothing"}, 2) ==
+          calculator.getHops(std::vector<uint32_t>{receiver, S}));
+
+    // leaving a process costs its number of edges, leaving a variable 1
+    calculator.addVariableNeedle("y");
+    CHECK(calculator.getDistance("y") == 0);
+    CHECK(calculator.getDistance("S") == 1);
+    CHECK(calculator.getDistance("z") == 1 + 2);
+    CHECK(calculator.getDistance("Receiver") == 1 + 2 + 1);
+    calculator.addProcessNeedle("Receiver");
+    CHECK(calculator.getDistance("S") == 0 + 1);
+    CHECK(calculator.getDistance("z") == 0 + 1);
+}
+
+TEST_CASE("Partitioning into environment and IUT")
+{
+    const auto text = std::string{
+        "chan in, out, internal, loose;\n"
+        "int a, b, c;\n"
+        "process Env() { state A; init A; trans A -> A { sync in!; assign a = 2; }, A -> A { sync out?; }; }\n"
+        "process Iut() { state A; init A; trans A -> A { sync in?; assign b = a; },"
+        " A -> A { sync out!; }, A -> A { sync internal!; }; }\n"
+        "process Helper() { state A; init A; trans A -> A { sync internal?; assign c = b; }; }\n"
+        "process Reader() { state A; init A; trans A -> A { guard c > 1; }; }\n"
+        "process Lone() { state A; init A; trans A -> A { sync loose!; }; }\n"
+        "system Env, Iut, Helper, Reader, Lone;\n"};
+    auto doc = UTAP::Document{};
+    REQUIRE(parseXTA(text.c_str(), &doc, true));
+    auto partitioner = UTAP::Partitioner{"test", doc};
+    using strset_t = UTAP::SignalFlow::strset_t;
+    // a is only accessed while synchronising on in, c connects Reader to Helper without synchronisation
+    CHECK(partitioner.partition(strset_t{"in"}, strset_t{"out"}) == 1);
+    auto env = strset_t{}, iut = strset_t{};
+    partitioner.fillWithEnvProcs(env);
+    partitioner.fillWithIUTProcs(iut);
+    CHECK((env == strset_t{"Env"}));
+    CHECK((iut == strset_t{"Helper", "Iut", "Reader"}));
+
+    // declaring internal as an input makes Iut, which shouts on it, part of the environment
+    auto ioinfo = std::istringstream{"input in internal output out"};
+    auto inputs = strset_t{}, outputs = strset_t{};
+    UTAP::Partitioner::readIOInfo(ioinfo, inputs, outputs);
+    CHECK((inputs == strset_t{"in", "internal"}));
+    CHECK((outputs == strset_t{"out"}));  // the last token ends at the end of the input
+    const auto partitions = partitioner.getPartitions({{strset_t{"in"}, strset_t{"out"}}, {inputs, outputs}}, 2);
+    REQUIRE(partitions.size() == 2);
+    using partition_t = UTAP::Partitioner::partition_t;
+    CHECK((partitions[0].processes ==
+           std::vector<partition_t::side_t>{partition_t::ENV, partition_t::IUT, partition_t::IUT, partition_t::IUT,
+                                            partition_t::FREE}));
+    CHECK(partitions[1].status == 2);
+    CHECK(partitions[1].processes[1] == partition_t::BAD);
+    CHECK(partitioner.partition(strset_t{"in", "internal"}, strset_t{"out"}) == 2);
+    CHECK(partitioner.partition(strset_t{"in"}, strset_t{"out"}) == 1);  // conflicts of earlier runs are gone
+    auto specification = std::istringstream{"input in(int) output out precision 1"};
+    CHECK(partitioner.partition(specification) == 1);
+    env.clear();
+    partitioner.fillWithEnvProcs(env);
+    CHECK((env == strset_t{"Env"}));
+
+    // whatever the order of the rules, everything reached from both sides is in conflict
+    auto conflicting = UTAP::Document{};
+    REQUIRE(parseXTA("chan in, out, k, link;\n"
+                     "process X() { state A; init A; trans A -> A { sync in!; }, A -> A { sync k?; },"
+                     " A -> A { sync link!; }; }\n"
+                     "process Y() { state A; init A; trans A -> A { sync link?; }; }\n"
+                     "process Z() { state A; init A; trans A -> A { sync out!; }, A -> A { sync k!; }; }\n"
+                     "system X, Y, Z;\n",
+                     &conflicting, true));
+    auto rules = UTAP::Partitioner{"test", conflicting};
+    CHECK(rules.partition(strset_t{"in"}, strset_t{"out"}) == 2);
+    env.clear();
+    iut.clear();
+    rules.fillWithEnvProcs(env);
+    rules.fillWithIUTProcs(iut);
+    CHECK(env.empty());
+    CHECK(iut.empty());
+    const auto partition = rules.getPartition(strset_t{"in"}, strset_t{"out"});
+    CHECK((partition.processes ==
+           std::vector<partition_t::side_t>{partition_t::BAD, partition_t::BAD, partition_t::BAD}));
+    CHECK((partition.channels == std::vector<partition_t::side_t>{partition_t::FREE, partition_t::BAD,
+                                                                   partition_t::BAD, partition_t::FREE}));
+}
+
+TEST_CASE("Statistics of the parsing phases")
+{
+    using UTAP::Statistics;
+    const auto text = read_content("simpleSystem.xml");
+    auto plain = UTAP::Document{};
+    REQUIRE(parseXMLBuffer(text, &plain, true) == 0);
+    CHECK(plain.getStatistics()[Statistics::XML].entries == 0);
+    CHECK(plain.getStatistics()[Statistics::EXPRESSIONS] == 0);
+
+    auto doc = UTAP::Document{};
+    doc.getStatistics().setEnabled(true);
+    REQUIRE(parseXMLBuffer(text, &doc, true) == 0);
+    const auto& stats = doc.getStatistics();
+    for (auto phase : {Statistics::XML, Statistics::PARSER, Statistics::BUILDER, Statistics::BUILTINS,
+                       Statistics::TYPECHECKER, Statistics::FEATURES})
+        CHECK(stats[phase].entries > 0);
+    CHECK(stats[Statistics::XML].entries == 1);
+    CHECK(stats[Statistics::LIBRARIES].entries == 0);
+    CHECK(stats[Statistics::BUILDER].nodes > 0);  // the nodes made by the semantic actions count for the builder
+    CHECK(stats[Statistics::XML].time.count() > 0);
+    CHECK(stats[Statistics::EXPRESSIONS] > 0);
+    CHECK(stats[Statistics::SYMBOLS] > 0);
+    CHECK(stats[Statistics::TEMPLATES] == doc.getTemplates().size());
+    CHECK(stats[Statistics::EDGES] == doc.getTemplates().front().edges.size());
+    CHECK(stats[Statistics::INSTANCES] == doc.getProcesses().size());
+    auto nodes = uint64_t{0};
+    for (auto i = 0; i < Statistics::PHASES; ++i)
+        nodes += stats[static_cast<Statistics::phase_t>(i)].nodes;
+    CHECK(nodes <= stats[Statistics::EXPRESSIONS] + stats[Statistics::TYPES] + stats[Statistics::SYMBOLS] +
+                       stats[Statistics::FRAMES]);
+
+    auto json = std::ostringstream{};
+    json << stats;
+    CHECK(json.str().find("\"typechecker\": {\"time_ns\": ") != std::string::npos);
+    CHECK(json.str().find("\"edges\": " + std::to_string(stats[Statistics::EDGES])) != std::string::npos);
+}
+
+TEST_CASE("Memory report of a document")
+{
+    using UTAP::MemoryReport;
+    auto doc = read_document("simpleSystem.xml");
+    const auto report = MemoryReport{*doc};
+    REQUIRE(report.getTemplates().size() == doc->getTemplates().size());
+    const auto& templ = report.getTemplates().front();
+    CHECK(templ.name == doc->getTemplates().front().uid.getName());
+    CHECK(templ.states.count == doc->getTemplates().front().states.size());
+    CHECK(templ.edges.count == doc->getTemplates().front().edges.size());
+    CHECK(templ.edges.bytes >= templ.edges.count * sizeof(UTAP::edge_t));
+    CHECK(!report.getExpressions().empty());
+    CHECK(report[MemoryReport::SYMBOLS].count > 0);
+    CHECK(report[MemoryReport::FRAMES].count > 0);
+    CHECK(report[MemoryReport::TYPES].count > 0);
+    CHECK(report[MemoryReport::POSITIONS].count == doc->getPositions().getSize());
+    CHECK(report[MemoryReport::POSITIONS].bytes == doc->getPositions().getMemoryUsage());
+
+    // measuring again finds the same nodes
+    const auto again = MemoryReport{*doc};
+    CHECK(again.getTotal() == report.getTotal());
+    auto text = std::ostringstream{};
+    text << report;
+    CHECK(text.str().find("symbols\t" + std::to_string(report[MemoryReport::SYMBOLS].count) + "\t") !=
+          std::string::npos);
+    CHECK(text.str().find("total\t\t" + std::to_string(report.getTotal())) != std::string::npos);
+}